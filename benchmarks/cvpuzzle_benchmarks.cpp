@@ -0,0 +1,253 @@
+// Microbenchmarks of the libimages and libbase kernels of the pipeline over sweeps of image size and strength:
+// the photos of data/ (and their downscaled copies) plus synthetic scenes of 256..4096 pixels.
+//
+// Every case is warmed up, then timed as repetitions of a batch of calls (the batch is sized so that a sample lasts
+// at least ~2 ms, so that short kernels are not dominated by the timer), the table shows per call median/p90/min.
+// Where hardware counters are available (see libbase/perf_counters.h) the timed calls also get their IPC and
+// LLC/branch misses per 1000 instructions.
+//
+// Usage: cvpuzzle_benchmarks [filter=] [repetitions=15] [warmup=2]
+//   filter - only cases whose "kernel input param" line contains it, f.e. "erode" or "synthetic_1024"
+// The kernel variants that ran (see libimages/algorithms/kernel_variants.h) are printed first,
+// CVPUZZLE_ISA=avx2 (or scalar...) compares them on the same machine.
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/cpu_features.h>
+#include <libbase/cycle_timer.h>
+#include <libbase/fast_random.h>
+#include <libbase/perf_counters.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/stats.h>
+#include <libbase/timer.h>
+#include <libimages/algorithms/blur.h>
+#include <libimages/algorithms/downsample.h>
+#include <libimages/algorithms/extract_contour.h>
+#include <libimages/algorithms/grayscale.h>
+#include <libimages/algorithms/kernel_variants.h>
+#include <libimages/algorithms/morphology.h>
+#include <libimages/algorithms/simplify_contours.h>
+#include <libimages/algorithms/split_into_parts.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+#include <libimages/image_io.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Settings {
+    std::string filter;
+    int repetitions = 15;
+    int warmup = 2;
+};
+
+struct Input {
+    std::string name;
+    image8u image;
+    BitMask mask;       // foreground after the solver morphology
+    image8u pieceMask;  // the largest component of mask
+};
+
+// Results of the kernels are summed here so that the calls are not optimized out
+std::uint64_t sink = 0;
+
+const std::vector<morphology::Op> kSolverOps = {
+    morphology::dilateOp(6), morphology::erodeOp(6), morphology::erodeOp(6), morphology::dilateOp(6), morphology::erodeOp(2),
+};
+
+void run(const Settings &settings, const std::string &kernel, const std::string &input, const std::string &param,
+         const std::function<std::uint64_t()> &f) {
+    const std::string line = kernel + " " + input + " " + param;
+    if (!settings.filter.empty() && line.find(settings.filter) == std::string::npos) return;
+
+    Timer t;
+    for (int i = 0; i < std::max(1, settings.warmup); ++i) sink += f();
+    const double one = t.elapsed() / std::max(1, settings.warmup);
+    const int batch = std::clamp(static_cast<int>(0.002 / std::max(one, 1e-9)), 1, 10000);
+
+    std::vector<double> perCall;
+    perf_counters::Values before;
+    perf_counters::Values after;
+    perf_counters::read(before);
+    for (int r = 0; r < settings.repetitions; ++r) {
+        t.restart();
+        for (int i = 0; i < batch; ++i) sink += f();
+        perCall.push_back(t.elapsed() / batch);
+    }
+    const bool counted = perf_counters::read(after);
+    const perf_counters::Values counters = after - before;
+    const std::vector<double> q = stats::quantiles(std::span<const double>(perCall), {50.0, 90.0});
+    std::cout << std::left << std::setw(22) << kernel << std::setw(34) << input << std::setw(18) << param << std::right
+              << std::fixed << std::setprecision(4) << std::setw(12) << q[0] * 1000.0 << std::setw(12) << q[1] * 1000.0
+              << std::setw(12) << stats::minValue(perCall) * 1000.0 << std::setw(8) << settings.repetitions << "x" << batch;
+    if (counted) {
+        std::cout << std::setprecision(2) << std::setw(8) << perf_counters::ipc(counters) << std::setw(12)
+                  << perf_counters::llcMissesPerKiloInstruction(counters) << std::setw(12)
+                  << perf_counters::branchMissesPerKiloInstruction(counters);
+    }
+    std::cout << std::endl;
+}
+
+// Dark noisy background with bright blobs (rectangles and discs), roughly like a photo of pieces
+image8u syntheticScene(int size, std::uint32_t seed) {
+    FastRandom r(seed);
+    image8u img(size, size, 3);
+    for (int j = 0; j < size; ++j)
+        for (int i = 0; i < size; ++i)
+            for (int c = 0; c < 3; ++c) img(j, i, c) = static_cast<std::uint8_t>(30 + r.nextInt(0, 20));
+    for (int blob = 0; blob < 12; ++blob) {
+        // not touching the border, which is the background sample of the threshold
+        const int radius = std::max(2, r.nextInt(size / 20, size / 6));
+        const int cx = r.nextInt(radius + 1, size - radius - 2);
+        const int cy = r.nextInt(radius + 1, size - radius - 2);
+        const bool disc = blob % 2 == 0;
+        const std::uint8_t value = static_cast<std::uint8_t>(r.nextInt(150, 240));
+        for (int j = cy - radius; j < cy + radius; ++j) {
+            for (int i = cx - radius; i < cx + radius; ++i) {
+                if (disc && (i - cx) * (i - cx) + (j - cy) * (j - cy) > radius * radius) continue;
+                for (int c = 0; c < 3; ++c) img(j, i, c) = value;
+            }
+        }
+    }
+    return img;
+}
+
+Input makeInput(const std::string &name, image8u image) {
+    Input input;
+    input.name = name;
+    input.image = std::move(image);
+    const float threshold = static_cast<float>(1.5 * stats::percentile(grayscale_border(input.image), 90.0));
+    input.mask = morphology::pipeline(threshold_grayscale_bitmask(input.image, threshold), kSolverOps);
+    const auto [offsets, images, masks] = splitObjects(input.image, input.mask);
+    for (const image8u &mask: masks) {
+        if (mask.width() * mask.height() > input.pieceMask.width() * input.pieceMask.height()) input.pieceMask = mask;
+    }
+    return input;
+}
+
+std::uint64_t checksum(const image8u &img) { return img.width() == 0 ? 0 : *img.ptr(img.height() / 2, img.width() / 2); }
+
+void benchmarkInput(const Settings &settings, const Input &input) {
+    const std::string &name = input.name;
+    const image8u &image = input.image;
+    const int w = image.width();
+    const int h = image.height();
+
+    const image32f gray = to_grayscale_float(image);
+    run(settings, "to_grayscale_float", name, "", [&] { return static_cast<std::uint64_t>(to_grayscale_float(image)(0, 0)); });
+    run(settings, "to_grayscale_u8", name, "", [&] { return checksum(to_grayscale_u8(image)); });
+    run(settings, "threshold_masking", name, "image32f", [&] { return checksum(threshold_masking(gray, 100.0f)); });
+    const image8u gray8 = to_grayscale_u8(image);
+    run(settings, "threshold_masking", name, "image8u->bits", [&] { return threshold_bitmask(gray8, 100.0f).count(); });
+    run(settings, "threshold_masking", name, "rgb->bits", [&] { return threshold_grayscale_bitmask(image, 100.0f).count(); });
+
+    for (float strength: {1.0f, 4.0f, 16.0f}) {
+        std::ostringstream param;
+        param << "sigma=" << strength;
+        run(settings, "blur", name, param.str(), [&] { return checksum(blur(image, strength)); });
+    }
+
+    for (int factor: {2, 4, 8}) {
+        const std::string param = "1/" + std::to_string(factor);
+        run(settings, "downsample_nearest", name, param,
+            [&] { return checksum(downsample(image, w / factor, h / factor, DownsampleMethod::Nearest)); });
+        run(settings, "downsample_area", name, param,
+            [&] { return checksum(downsample(image, w / factor, h / factor, DownsampleMethod::Area)); });
+    }
+    run(settings, "downsample_2x", name, "", [&] { return checksum(downsample_2x(image)); });
+
+    const image8u maskImage = input.mask.toImage();
+    for (int strength: {1, 6, 20}) {
+        for (bool openmp: {false, true}) {
+            const std::string param = "r=" + std::to_string(strength) + (openmp ? " mt" : " st");
+            run(settings, "erode_bits", name, param, [&] { return morphology::erode(input.mask, strength, openmp).count(); });
+            run(settings, "dilate_bits", name, param, [&] { return morphology::dilate(input.mask, strength, openmp).count(); });
+            run(settings, "erode_image8u", name, param, [&] { return checksum(morphology::erode(maskImage, strength, openmp)); });
+            run(settings, "dilate_image8u", name, param, [&] { return checksum(morphology::dilate(maskImage, strength, openmp)); });
+        }
+    }
+    for (bool openmp: {false, true}) {
+        run(settings, "morphology_pipeline", name, openmp ? "solver mt" : "solver st",
+            [&] { return morphology::pipeline(input.mask, kSolverOps, openmp).count(); });
+        run(settings, "splitObjects", name, openmp ? "mt" : "st", [&] {
+            return static_cast<std::uint64_t>(std::get<0>(splitObjects(image, input.mask, openmp)).size());
+        });
+    }
+
+    if (input.pieceMask.width() > 0) {
+        const std::string param = std::to_string(input.pieceMask.width()) + "x" + std::to_string(input.pieceMask.height());
+        const image8u contourMask = buildContourMask(input.pieceMask);
+        const std::vector<point2i> contour = extractContour(contourMask);
+        run(settings, "buildContourMask", name, param, [&] { return checksum(buildContourMask(input.pieceMask)); });
+        run(settings, "extractContour", name, param, [&] { return extractContour(contourMask).size(); });
+        run(settings, "traceContour", name, param, [&] { return traceContour(input.pieceMask).size(); });
+        run(settings, "simplifyContour", name, std::to_string(contour.size()) + " points",
+            [&] { return simplifyContour(contour, 4).size(); });
+    }
+
+    const std::vector<float> values = gray.toVector();
+    const std::vector<std::uint8_t> bytes = image.toVector();
+    run(settings, "percentile_float", name, std::to_string(values.size()),
+        [&] { return static_cast<std::uint64_t>(stats::percentile(values, 90.0)); });
+    run(settings, "percentile_uint8", name, std::to_string(bytes.size()),
+        [&] { return static_cast<std::uint64_t>(stats::percentile(bytes, 90.0)); });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        configureWorkingDirectory();
+
+        Settings settings;
+        if (argc > 1) settings.filter = argv[1];
+        if (argc > 2) settings.repetitions = std::stoi(argv[2]);
+        if (argc > 3) settings.warmup = std::stoi(argv[3]);
+        rassert(settings.repetitions >= 1 && settings.warmup >= 0, 734812401, settings.repetitions, settings.warmup);
+
+        std::vector<std::string> photos;
+        for (const auto &entry: std::filesystem::directory_iterator("data")) {
+            if (entry.path().extension() == ".jpg") photos.push_back(entry.path().string());
+        }
+        std::sort(photos.begin(), photos.end());
+
+        std::cout << "cpu: " << cpuFeatures().toString() << std::endl;
+        std::cout << "kernels: " << kernelVariants() << std::endl;
+        std::cout << std::left << std::setw(22) << "kernel" << std::setw(34) << "input" << std::setw(18) << "param" << std::right
+                  << std::setw(12) << "median ms" << std::setw(12) << "p90 ms" << std::setw(12) << "min ms" << std::setw(10)
+                  << "samples";
+        if (perf_counters::available()) std::cout << std::setw(8) << "IPC" << std::setw(12) << "LLC/Kinstr" << std::setw(12) << "br/Kinstr";
+        std::cout << std::endl;
+        // cost of a sample, f.e. per pair of compared sides
+        run(settings, "timer_overhead", "-", "Timer", [] { return static_cast<std::uint64_t>(Timer().elapsed() > 1.0); });
+        run(settings, "timer_overhead", "-", "CycleTimer", [] { return CycleTimer().elapsedTicks(); });
+        for (int size: {256, 1024, 4096}) {
+            benchmarkInput(settings, makeInput("synthetic_" + std::to_string(size), syntheticScene(size, 239 + size)));
+        }
+        for (const std::string &path: photos) {
+            const image8u photo = load_image(path);
+            const std::string name = std::filesystem::path(path).stem().string();
+            benchmarkInput(settings, makeInput(name, photo));
+            if (photo.width() >= 1024) {
+                benchmarkInput(settings, makeInput(name + "_x2", downsample(photo, photo.width() / 2, photo.height() / 2,
+                                                                            DownsampleMethod::Area)));
+            }
+        }
+        std::cout << "checksum " << sink << std::endl;
+
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,124 @@
+// Compares DisjointSetUnion with CompactDisjointSetUnion (checked and unchecked) on a pixel labelling workload:
+// 8-connectivity unions over a random square mask of n pixels, then find() (or flatten()) for every pixel.
+//
+// Usage: disjoint_set_benchmark [max_n=100000000] [density=0.6]
+
+#include <libbase/compact_disjoint_set.h>
+#include <libbase/disjoint_set.h>
+#include <libbase/fast_random.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/timer.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+    double unite = 0.0;
+    double find = 0.0;
+    std::uint64_t checksum = 0; // number of roots, must be the same for all implementations
+};
+
+template <typename Dsu, typename Unite, typename Resolve>
+Result run(Dsu &dsu, const std::vector<std::uint8_t> &mask, int w, int h, Unite unite, Resolve resolve) {
+    Result res;
+    Timer t;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const std::size_t id = static_cast<std::size_t>(y) * w + x;
+            if (!mask[id]) continue;
+            if (x > 0 && mask[id - 1]) unite(dsu, id, id - 1);
+            if (y > 0) {
+                const std::size_t up = id - w;
+                if (mask[up]) unite(dsu, id, up);
+                if (x > 0 && mask[up - 1]) unite(dsu, id, up - 1);
+                if (x + 1 < w && mask[up + 1]) unite(dsu, id, up + 1);
+            }
+        }
+    }
+    res.unite = t.elapsed();
+
+    t.restart();
+    res.checksum = resolve(dsu);
+    res.find = t.elapsed();
+    return res;
+}
+
+template <typename CompactDsuT>
+Result runCompact(const std::vector<std::uint8_t> &mask, int w, int h, std::size_t &bytes) {
+    CompactDsuT dsu(mask.size());
+    bytes = dsu.memoryBytes();
+    return run(dsu, mask, w, h,
+               [](CompactDsuT &d, std::size_t a, std::size_t b) { d.unite(static_cast<std::uint32_t>(a), static_cast<std::uint32_t>(b)); },
+               [&](CompactDsuT &d) {
+                   d.flatten();
+                   std::uint64_t roots = 0;
+                   for (std::size_t i = 0; i < mask.size(); ++i) roots += (mask[i] && d.find(static_cast<std::uint32_t>(i)) == i);
+                   return roots;
+               });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const double maxN = (argc > 1) ? std::stod(argv[1]) : 1e8;
+        const float density = (argc > 2) ? std::stof(argv[2]) : 0.6f;
+
+        std::cout << std::setw(12) << "n" << std::setw(18) << "impl" << std::setw(12) << "unite, s"
+                  << std::setw(12) << "find, s" << std::setw(14) << "memory, MB" << std::endl;
+
+        for (double n = 1e7; n <= maxN * 1.0001; n *= std::sqrt(10.0)) {
+            const int side = static_cast<int>(std::sqrt(n));
+            const int w = side;
+            const int h = side;
+            std::vector<std::uint8_t> mask(static_cast<std::size_t>(w) * h);
+            FastRandom r(239);
+            for (auto &m : mask) m = r.nextFloat() < density ? 1 : 0;
+
+            auto print = [&](const char *name, const Result &res, std::size_t bytes) {
+                std::cout << std::setw(12) << mask.size() << std::setw(18) << name
+                          << std::setw(12) << std::fixed << std::setprecision(3) << res.unite
+                          << std::setw(12) << res.find
+                          << std::setw(14) << std::setprecision(1) << bytes / 1e6 << std::endl;
+            };
+
+            std::uint64_t expectedRoots = 0;
+            {
+                DisjointSetUnion dsu(mask.size());
+                const Result res = run(dsu, mask, w, h,
+                    [](DisjointSetUnion &d, std::size_t a, std::size_t b) { d.unite(a, b); },
+                    [&](DisjointSetUnion &d) {
+                        std::uint64_t roots = 0;
+                        for (std::size_t i = 0; i < mask.size(); ++i) roots += (mask[i] && d.find(i) == i);
+                        return roots;
+                    });
+                expectedRoots = res.checksum;
+                print("DisjointSetUnion", res, 2 * mask.size() * sizeof(std::size_t));
+            }
+            {
+                std::size_t bytes = 0;
+                const Result res = runCompact<CompactDsu>(mask, w, h, bytes);
+                rassert(res.checksum == expectedRoots, 734812311, res.checksum, expectedRoots);
+                print("CompactDsu", res, bytes);
+            }
+            {
+                std::size_t bytes = 0;
+                const Result res = runCompact<UncheckedCompactDsu>(mask, w, h, bytes);
+                rassert(res.checksum == expectedRoots, 734812312, res.checksum, expectedRoots);
+                print("Unchecked", res, bytes);
+            }
+        }
+
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
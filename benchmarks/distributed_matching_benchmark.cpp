@@ -0,0 +1,162 @@
+// Distributed matching (see src/distributed_matching.h) on a generated puzzle: SideMatcher::match against matchDistributed
+// in this process and through worker processes, per block size the time, the shards and their bytes, and whether
+// the merged result is the same as of match.
+//
+// Usage: distributed_matching_benchmark [--pieces 400] [--cell 64] [--seed 239] [--prefilter] [--processes dir]
+//                                       [blocks=25 100 ...]
+//   --processes - every shard is also matched by a worker process (this executable with --worker) through files in dir
+//        distributed_matching_benchmark --worker shard.bin result.bin
+//   - the worker: matches one shard file and writes its result file (f.e. started by a cluster scheduler on another node)
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/timer.h>
+
+#include "distributed_matching.h"
+#include "puzzle_solver.h"
+#include "synthetic_puzzle.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    rassert(in.good(), 734812701, "Can't open", path);
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    return bytes.str();
+}
+
+void writeFile(const std::string &path, const std::string &bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    rassert(out.good(), 734812702, "Can't write", path);
+}
+
+int runWorker(const std::string &shardPath, const std::string &resultPath) {
+    std::istringstream in(readFile(shardPath));
+    const MatchingBlockResult result = matchShard(loadMatchingShard(in));
+    std::ostringstream out;
+    saveMatchingBlockResult(out, result);
+    writeFile(resultPath, out.str());
+    return 0;
+}
+
+bool sameMatches(const std::vector<std::vector<MatchedSide>> &a, const std::vector<std::vector<MatchedSide>> &b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t obj = 0; obj < a.size(); ++obj) {
+        if (a[obj].size() != b[obj].size()) return false;
+        for (std::size_t side = 0; side < a[obj].size(); ++side) {
+            const MatchedSide &x = a[obj][side], &y = b[obj][side];
+            if (x.objB != y.objB || x.sideB != y.sideB || x.differenceBest != y.differenceBest
+                || x.differenceSecondBest != y.differenceSecondBest || x.candidates.size != y.candidates.size) return false;
+            for (int k = 0; k < x.candidates.size; ++k) {
+                const SideCandidate &p = x.candidates.items[k], &q = y.candidates.items[k];
+                if (p.objB != q.objB || p.sideB != q.sideB || p.cost != q.cost) return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        if (argc == 4 && std::string(argv[1]) == "--worker") return runWorker(argv[2], argv[3]);
+
+        configureWorkingDirectory();
+
+        SyntheticPuzzleOptions options;
+        options.rows = 20;
+        options.cols = 20;
+        SideMatcherOptions matcherOptions;
+        std::string processesDir;
+        std::vector<int> blocks;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                rassert(i + 1 < argc, 734812703, "Missing value of", arg);
+                return argv[++i];
+            };
+            if (arg == "--pieces") {
+                const int pieces = std::stoi(value());
+                rassert(pieces >= 1, 734812704, pieces);
+                options.rows = static_cast<int>(std::sqrt(static_cast<double>(pieces)));
+                while (pieces % options.rows != 0) --options.rows;
+                options.cols = pieces / options.rows;
+            } else if (arg == "--cell") options.cellSize = std::stoi(value());
+            else if (arg == "--seed") options.seed = static_cast<std::uint32_t>(std::stoul(value()));
+            else if (arg == "--prefilter") matcherOptions.geometricPrefilter = true;
+            else if (arg == "--processes") processesDir = value();
+            else blocks.push_back(std::stoi(arg));
+        }
+        if (blocks.empty()) blocks = {25, 100};
+
+        const SyntheticPuzzle puzzle = generateSyntheticPuzzle(
+            syntheticSource(options.cols * options.cellSize, options.rows * options.cellSize, options.seed), options);
+        PuzzleSolverOptions solverOptions;
+        solverOptions.matcher = matcherOptions;
+        const PuzzleSolver solver(solverOptions);
+        const PuzzleSegmentation segmentation = solver.segment(puzzle.image);
+        const PuzzlePieces pieces = solver.extractPieces(puzzle.image, segmentation.mask, segmentation.roi);
+        const PuzzleSideDescriptors descriptors = solver.describeSides(pieces);
+        const int objects = pieces.count();
+
+        Timer t;
+        const std::vector<std::vector<MatchedSide>> expected = SideMatcher(descriptors, pieces.channels(), matcherOptions).match();
+        std::cout << objects << " pieces, SideMatcher::match in " << std::fixed << std::setprecision(3) << t.elapsed() << " sec"
+                  << std::endl;
+
+        const std::string self = std::filesystem::absolute(argv[0]).string();
+        if (!processesDir.empty()) std::filesystem::create_directories(processesDir);
+        std::cout << std::setw(8) << "block" << std::setw(8) << "shards" << std::setw(14) << "shard bytes" << std::setw(12)
+                  << "in-process" << std::setw(8) << "same" << std::setw(12) << "processes" << std::setw(8) << "same" << std::endl;
+        for (int block: blocks) {
+            const std::vector<MatchingBlock> plan = planMatchingBlocks(objects, block);
+            std::atomic<long long> shardBytes{0};
+            const MatchingShardRunner inProcess = [&](const std::string &shard) {
+                shardBytes += static_cast<long long>(shard.size());
+                std::istringstream in(shard);
+                std::ostringstream out;
+                saveMatchingBlockResult(out, matchShard(loadMatchingShard(in), false));
+                return out.str();
+            };
+            t.restart();
+            const bool same = sameMatches(matchDistributed(descriptors, pieces.channels(), matcherOptions, block, inProcess), expected);
+            const double inProcessSeconds = t.elapsed();
+
+            std::cout << std::setw(8) << block << std::setw(8) << plan.size() << std::setw(14) << shardBytes.load()
+                      << std::setw(12) << inProcessSeconds << std::setw(8) << (same ? "yes" : "NO");
+            if (!processesDir.empty()) {
+                std::atomic<int> next{0};
+                const MatchingShardRunner processes = [&](const std::string &shard) {
+                    const std::string name = processesDir + "/block_" + std::to_string(block) + "_" + std::to_string(next++);
+                    writeFile(name + ".shard", shard);
+                    const std::string command = "\"" + self + "\" --worker \"" + name + ".shard\" \"" + name + ".result\"";
+                    rassert(std::system(command.c_str()) == 0, 734812705, "Worker failed", command);
+                    return readFile(name + ".result");
+                };
+                t.restart();
+                const bool sameProcesses = sameMatches(matchDistributed(descriptors, pieces.channels(), matcherOptions, block, processes),
+                                                       expected);
+                std::cout << std::setw(12) << t.elapsed() << std::setw(8) << (sameProcesses ? "yes" : "NO");
+            }
+            std::cout << std::endl;
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
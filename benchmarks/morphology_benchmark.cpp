@@ -0,0 +1,91 @@
+// Compares morphology kernels (image8u naive/van Herk and bit-packed BitMask) on a real foreground mask for strengths 1..50.
+//
+// Usage: morphology_benchmark [max_strength=50] [image=data/00_photo_six_parts_downscaled_x4.jpg]
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/stats.h>
+#include <libbase/timer.h>
+#include <libimages/algorithms/grayscale.h>
+#include <libimages/algorithms/morphology.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+#include <libimages/image_io.h>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Best of a few runs, long kernels are run once
+double measure(const std::function<void()> &f) {
+    double best = 0.0;
+    for (int iter = 0; iter < 3; ++iter) {
+        Timer t;
+        f();
+        const double elapsed = t.elapsed();
+        best = (iter == 0) ? elapsed : std::min(best, elapsed);
+        if (elapsed > 1.0) break;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        configureWorkingDirectory();
+
+        const int maxStrength = (argc > 1) ? std::stoi(argv[1]) : 50;
+        const std::string path = (argc > 2) ? argv[2] : "data/00_photo_six_parts_downscaled_x4.jpg";
+
+        const image8u image = load_image(path);
+        const image32f grayscale = to_grayscale_float(image);
+        const image8u mask = threshold_masking(grayscale, 100);
+        const BitMask bits = BitMask::fromImage(mask);
+        std::cout << "mask " << mask.width() << "x" << mask.height() << " from " << path << std::endl;
+
+        std::cout << std::setw(8) << "strength" << std::setw(12) << "op"
+                  << std::setw(14) << "naive, ms" << std::setw(14) << "vanherk, ms" << std::setw(14) << "integral, ms"
+                  << std::setw(14) << "bitmask, ms" << std::setw(10) << "speedup" << std::endl;
+
+        for (int strength = 1; strength <= maxStrength; ++strength) {
+            for (bool isErode : {true, false}) {
+                auto run = [&](morphology::Method method) {
+                    return isErode ? morphology::erode(mask, strength, true, method)
+                                   : morphology::dilate(mask, strength, true, method);
+                };
+
+                const image8u expected = run(morphology::Method::Naive);
+                rassert(run(morphology::Method::VanHerk).toVector() == expected.toVector(), 734812301, strength);
+                rassert(run(morphology::Method::Integral).toVector() == expected.toVector(), 734812303, strength);
+
+                auto runBits = [&] {
+                    return isErode ? morphology::erode(bits, strength, true) : morphology::dilate(bits, strength, true);
+                };
+                rassert(runBits().toImage().toVector() == expected.toVector(), 734812302, strength);
+
+                const double naive = measure([&] { run(morphology::Method::Naive); });
+                const double vanHerk = measure([&] { run(morphology::Method::VanHerk); });
+                const double integral = measure([&] { run(morphology::Method::Integral); });
+                const double bitMask = measure([&] { runBits(); });
+
+                std::cout << std::setw(8) << strength << std::setw(12) << (isErode ? "erode" : "dilate")
+                          << std::setw(14) << std::fixed << std::setprecision(3) << naive * 1000.0
+                          << std::setw(14) << vanHerk * 1000.0
+                          << std::setw(14) << integral * 1000.0
+                          << std::setw(14) << bitMask * 1000.0
+                          << std::setw(9) << std::setprecision(1) << naive / std::min({vanHerk, integral, bitMask}) << "x" << std::endl;
+            }
+        }
+
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,278 @@
+// End-to-end benchmark of the solver (see src/puzzle_solver.h) on the photos of data/: every stage of every photo
+// is run a few times, the median wall time and CPU time (of the whole process, so all threads) per stage are
+// printed as a table and optionally saved as JSON (with the counters of the side matcher, see SideMatcherStats). With a saved baseline the stages slower than it by more than
+// the threshold (or failing now, f.e. if pieces are no longer assembled) are reported as regressions and the exit code is 3.
+// The CPU features and the kernel variants that ran (see libimages/algorithms/kernel_variants.h) are printed and saved too.
+//
+// Usage: pipeline_benchmark [--repetitions 3] [--output result.json] [--baseline baseline.json] [--threshold 10]
+//                           [--min-ms 1] [--counters] [image ...]
+//   counters  - print the profiler zones of all runs (stages and kernels: blur, morphology, connectedComponents,
+//               warpPerspective...) with hardware counters (IPC, LLC and branch misses) where available
+//   image     - names of data/ photos without .jpg, all data/*.jpg by default
+//   threshold - percent of the baseline median wall time, stages faster than min-ms in both runs are not compared
+//               (timer noise)
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/cpu_features.h>
+#include <libbase/perf_counters.h>
+#include <libbase/profiler.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/stats.h>
+#include <libbase/timer.h>
+#include <libimages/algorithms/kernel_variants.h>
+#include <libimages/image_io.h>
+
+#include "puzzle_solver.h"
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kStages = {"decode", "segment", "extractPieces", "describeSides", "match", "assemble", "total"};
+
+struct Sample {
+    double wall = 0.0;
+    double cpu = 0.0;
+};
+
+struct StageResult {
+    std::string image;
+    std::string stage;
+    double wallSeconds = 0.0; // medians over the repetitions
+    double cpuSeconds = 0.0;
+};
+
+double cpuSeconds() { return static_cast<double>(std::clock()) / CLOCKS_PER_SEC; }
+
+// Wall and CPU time of f
+template <typename F> Sample measure(F &&f) {
+    Timer t;
+    const double cpu0 = cpuSeconds();
+    f();
+    return {t.elapsed(), cpuSeconds() - cpu0};
+}
+
+struct MatcherResult {
+    std::string image;
+    SideMatcherStats stats; // of the last repetition
+};
+
+// Stages of a photo that failed (f.e. its pieces are not assembled) are timed up to the failed one,
+// error receives the message
+std::vector<StageResult> benchmarkImage(const PuzzleSolver &solver, const std::string &image, int repetitions, std::string &error,
+                                        SideMatcherStats &matcherStats) {
+    const std::string path = "data/" + image + ".jpg";
+    std::map<std::string, std::vector<Sample>> samples;
+    for (int r = 0; r < repetitions; ++r) {
+        image8u photo;
+        PuzzleSegmentation segmentation;
+        PuzzlePieces pieces;
+        PuzzleSideDescriptors descriptors;
+        std::vector<std::vector<MatchedSide>> matched;
+        PuzzleAssemblyResult assembly;
+        Sample total;
+        bool failed = false;
+        auto stage = [&](const std::string &name, const std::function<void()> &f) {
+            if (failed) return;
+            try {
+                const Sample sample = measure(f);
+                samples[name].push_back(sample);
+                total.wall += sample.wall;
+                total.cpu += sample.cpu;
+            } catch (const std::exception &e) {
+                failed = true;
+                error = name + ": " + e.what();
+            }
+        };
+        stage("decode", [&] { photo = load_image(path); });
+        stage("segment", [&] { segmentation = solver.segment(photo); });
+        stage("extractPieces", [&] { pieces = solver.extractPieces(photo, segmentation.mask, segmentation.roi); });
+        stage("describeSides", [&] { descriptors = solver.describeSides(pieces); });
+        stage("match", [&] { matched = solver.match(pieces, descriptors, {}, &matcherStats); });
+        stage("assemble", [&] { assembly = solver.assemble(pieces, matched); });
+        if (!failed) samples["total"].push_back(total);
+    }
+
+    std::vector<StageResult> results;
+    for (const std::string &stage: kStages) {
+        if (samples[stage].size() != static_cast<std::size_t>(repetitions)) continue;
+        std::vector<double> wall;
+        std::vector<double> cpu;
+        for (const Sample &sample: samples[stage]) {
+            wall.push_back(sample.wall);
+            cpu.push_back(sample.cpu);
+        }
+        results.push_back({image, stage, stats::median(wall), stats::median(cpu)});
+    }
+    return results;
+}
+
+std::string quantilesJson(const std::vector<float> &values) {
+    if (values.empty()) return "null";
+    const std::vector<double> q = stats::quantiles(values, {0.0, 10.0, 50.0, 90.0, 100.0});
+    std::ostringstream out;
+    out << std::setprecision(6) << "{\"min\": " << q[0] << ", \"p10\": " << q[1] << ", \"median\": " << q[2] << ", \"p90\": " << q[3]
+        << ", \"max\": " << q[4] << "}";
+    return out.str();
+}
+
+// A result per line, so that a saved file is read back by readJson without a JSON library
+void writeJson(const std::string &path, int repetitions, const std::vector<StageResult> &results,
+               const std::vector<MatcherResult> &matchers) {
+    std::ofstream out(path);
+    rassert(out.is_open(), 734812501, "Failed to open file", path);
+    out << std::setprecision(9);
+    out << "{\n  \"repetitions\": " << repetitions << ",\n  \"cpu\": \"" << cpuFeatures().toString() << "\",\n  \"kernels\": \""
+        << kernelVariants() << "\",\n  \"results\": [\n";
+    for (std::size_t k = 0; k < results.size(); ++k) {
+        const StageResult &r = results[k];
+        out << "    {\"image\": \"" << r.image << "\", \"stage\": \"" << r.stage << "\", \"wall_seconds\": " << r.wallSeconds
+            << ", \"cpu_seconds\": " << r.cpuSeconds << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"matcher\": [\n";
+    for (std::size_t k = 0; k < matchers.size(); ++k) {
+        const SideMatcherStats &m = matchers[k].stats;
+        out << "    {\"image\": \"" << matchers[k].image << "\", \"considered_pairs\": " << m.consideredPairs
+            << ", \"white_rejected_pairs\": " << m.whiteRejectedPairs << ", \"geometry_rejected_pairs\": " << m.geometryRejectedPairs
+            << ", \"pruned_pairs\": " << m.prunedPairs << ", \"compared_pairs\": " << m.comparedPairs
+            << ", \"mirrored_pairs\": " << m.mirroredPairs << ", \"abandoned_pairs\": " << m.abandonedPairs
+            << ", \"compared_samples\": " << m.comparedSamples << ", \"pairs_per_second\": " << m.pairsPerSecond()
+            << ", \"best\": " << quantilesJson(m.bestDifferences) << ", \"second_best\": " << quantilesJson(m.secondBestDifferences)
+            << ", \"margin\": " << quantilesJson(m.margins) << "}" << (k + 1 < matchers.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    rassert(out.good(), 734812502, "Failed to write file", path);
+}
+
+std::vector<StageResult> readJson(const std::string &path) {
+    std::ifstream in(path);
+    rassert(in.is_open(), 734812503, "Failed to open file", path);
+    const std::regex line(R"re(\{"image": "([^"]*)", "stage": "([^"]*)", "wall_seconds": ([^,]+), "cpu_seconds": ([^}]+)\})re");
+    std::vector<StageResult> results;
+    std::string text;
+    while (std::getline(in, text)) {
+        std::smatch m;
+        if (!std::regex_search(text, m, line)) continue;
+        results.push_back({m[1], m[2], std::stod(m[3]), std::stod(m[4])});
+    }
+    rassert(!results.empty(), 734812504, "No results in file", path);
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        configureWorkingDirectory();
+
+        int repetitions = 3;
+        std::string output;
+        std::string baseline;
+        double thresholdPercent = 10.0;
+        double minMs = 1.0;
+        bool counters = false;
+        std::vector<std::string> images;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                rassert(i + 1 < argc, 734812505, "Missing value of", arg);
+                return argv[++i];
+            };
+            if (arg == "--repetitions") repetitions = std::stoi(value());
+            else if (arg == "--output") output = value();
+            else if (arg == "--baseline") baseline = value();
+            else if (arg == "--threshold") thresholdPercent = std::stod(value());
+            else if (arg == "--min-ms") minMs = std::stod(value());
+            else if (arg == "--counters") counters = true;
+            else images.push_back(arg);
+        }
+        rassert(repetitions >= 1, 734812506, repetitions);
+        if (images.empty()) {
+            for (const auto &entry: std::filesystem::directory_iterator("data")) {
+                if (entry.path().extension() == ".jpg") images.push_back(entry.path().stem().string());
+            }
+            std::sort(images.begin(), images.end());
+        }
+
+        const PuzzleSolver solver;
+        std::vector<StageResult> results;
+        std::vector<MatcherResult> matchers;
+        profiler::setEnabled(counters);
+        profiler::setHardwareCounters(counters);
+        // the variants differ between machines (and with CVPUZZLE_ISA), so timings are only comparable with the same ones
+        std::cout << "cpu: " << cpuFeatures().toString() << std::endl;
+        std::cout << "kernels: " << kernelVariants() << std::endl;
+        std::cout << std::left << std::setw(34) << "image" << std::setw(16) << "stage" << std::right << std::setw(12) << "wall ms"
+                  << std::setw(12) << "cpu ms" << std::endl;
+        for (const std::string &image: images) {
+            std::string error;
+            SideMatcherStats matcherStats;
+            for (const StageResult &r: benchmarkImage(solver, image, repetitions, error, matcherStats)) {
+                std::cout << std::left << std::setw(34) << r.image << std::setw(16) << r.stage << std::right << std::fixed
+                          << std::setprecision(2) << std::setw(12) << r.wallSeconds * 1000.0 << std::setw(12)
+                          << r.cpuSeconds * 1000.0 << std::endl;
+                results.push_back(r);
+            }
+            if (matcherStats.consideredPairs > 0) {
+                std::cout << std::left << std::setw(34) << image << "matcher: " << matcherStats.comparedPairs << "/"
+                          << matcherStats.consideredPairs << " pairs compared (" << matcherStats.whiteRejectedPairs << " white, "
+                          << matcherStats.geometryRejectedPairs << " by shape, " << matcherStats.prunedPairs << " pruned, "
+                          << matcherStats.abandonedPairs << " abandoned), " << matcherStats.comparedSamples << " samples, "
+                          << std::fixed << std::setprecision(0) << matcherStats.pairsPerSecond() << " pairs/sec" << std::right
+                          << std::endl;
+                matchers.push_back({image, matcherStats});
+            }
+            if (!error.empty()) std::cout << std::left << std::setw(34) << image << "failed at " << error << std::right << std::endl;
+        }
+        if (counters) {
+            profiler::setEnabled(false);
+            if (!perf_counters::available()) std::cout << "hardware counters are not available, zones are timed only" << std::endl;
+            std::cout << profiler::summary();
+        }
+        if (!output.empty()) writeJson(output, repetitions, results, matchers);
+
+        if (baseline.empty()) return 0;
+        std::map<std::pair<std::string, std::string>, StageResult> before;
+        for (const StageResult &r: readJson(baseline)) before[{r.image, r.stage}] = r;
+        int regressions = 0;
+        std::cout << "compared with " << baseline << " (threshold " << thresholdPercent << "%):" << std::endl;
+        std::map<std::pair<std::string, std::string>, StageResult> after;
+        for (const StageResult &r: results) after[{r.image, r.stage}] = r;
+        for (const auto &[key, r]: before) {
+            // a stage that is timed in the baseline but fails now (only photos benchmarked now are compared)
+            if (after.count(key) || std::find(images.begin(), images.end(), key.first) == images.end()) continue;
+            ++regressions;
+            std::cout << std::left << std::setw(34) << r.image << std::setw(16) << r.stage << "missing  REGRESSION" << std::right
+                      << std::endl;
+        }
+        for (const StageResult &r: results) {
+            const auto it = before.find({r.image, r.stage});
+            if (it == before.end()) continue;
+            const double was = it->second.wallSeconds;
+            if (std::max(was, r.wallSeconds) * 1000.0 < minMs) continue;
+            const double change = was > 0.0 ? (r.wallSeconds / was - 1.0) * 100.0 : 0.0;
+            const bool regression = change > thresholdPercent;
+            regressions += regression;
+            std::cout << std::left << std::setw(34) << r.image << std::setw(16) << r.stage << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(12) << was * 1000.0 << " -> " << std::setw(10) << r.wallSeconds * 1000.0
+                      << " ms" << std::setw(9) << std::showpos << change << std::noshowpos << "%"
+                      << (regression ? "  REGRESSION" : "") << std::endl;
+        }
+        std::cout << regressions << " regressions" << std::endl;
+        return regressions > 0 ? 3 : 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
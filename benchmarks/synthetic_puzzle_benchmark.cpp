@@ -0,0 +1,115 @@
+// Scaling of the solver on synthetic puzzles (see src/synthetic_puzzle.h): a picture is cut into a grid of jigsaw pieces,
+// laid out rotated and shuffled on a dark background, then solved; per size the time of every stage and how many sides
+// are matched as in the ground truth are printed.
+//
+// Usage: synthetic_puzzle_benchmark [--cell 64] [--no-rotations] [--no-shuffle] [--noise 6] [--seed 239]
+//                                   [--source photo.jpg] [--save dir] [--greedy] [pieces=100 1000 ...]
+//   pieces - the grid is the closest to square one with that many pieces (f.e. 1000 -> 25 x 40)
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/timer.h>
+#include <libimages/image_io.h>
+
+#include "puzzle_solver.h"
+#include "synthetic_puzzle.h"
+
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    try {
+        configureWorkingDirectory();
+
+        SyntheticPuzzleOptions options;
+        PuzzleSolverOptions solverOptions;
+        std::string sourcePath;
+        std::string saveDir;
+        std::vector<int> sizes;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                rassert(i + 1 < argc, 734812601, "Missing value of", arg);
+                return argv[++i];
+            };
+            if (arg == "--cell") options.cellSize = std::stoi(value());
+            else if (arg == "--no-rotations") options.rotations = false;
+            else if (arg == "--no-shuffle") options.shuffle = false;
+            else if (arg == "--noise") options.noise = std::stoi(value());
+            else if (arg == "--seed") options.seed = static_cast<std::uint32_t>(std::stoul(value()));
+            else if (arg == "--source") sourcePath = value();
+            else if (arg == "--save") saveDir = value();
+            else if (arg == "--greedy") solverOptions.assemblyMethod = AssemblyMethod::Greedy;
+            else sizes.push_back(std::stoi(arg));
+        }
+        if (sizes.empty()) sizes = {100, 1000};
+        const image8u source = sourcePath.empty() ? image8u() : load_image(sourcePath);
+
+        const PuzzleSolver solver(solverOptions);
+        std::cout << std::setw(8) << "pieces" << std::setw(10) << "grid" << std::setw(12) << "photo" << std::setw(12) << "generate"
+                  << std::setw(10) << "segment" << std::setw(10) << "extract" << std::setw(10) << "describe" << std::setw(10)
+                  << "match" << std::setw(10) << "assemble" << std::setw(16) << "correct sides" << std::setw(12) << "pairs/sec"
+                  << std::setw(14) << "samples" << std::endl;
+        for (int pieces: sizes) {
+            rassert(pieces >= 1, 734812602, pieces);
+            int rows = static_cast<int>(std::sqrt(static_cast<double>(pieces)));
+            while (pieces % rows != 0) --rows;
+            options.rows = rows;
+            options.cols = pieces / rows;
+
+            Timer t;
+            const image8u picture = source.width() > 0
+                                        ? source
+                                        : syntheticSource(options.cols * options.cellSize, options.rows * options.cellSize, options.seed);
+            const SyntheticPuzzle puzzle = generateSyntheticPuzzle(picture, options);
+            const double generate = t.elapsed();
+            if (!saveDir.empty()) {
+                std::filesystem::create_directories(saveDir);
+                save_image(puzzle.image, saveDir + "/synthetic_" + std::to_string(pieces) + ".png");
+            }
+
+            std::vector<double> seconds;
+            t.restart();
+            const PuzzleSegmentation segmentation = solver.segment(puzzle.image);
+            seconds.push_back(t.elapsed());
+            t.restart();
+            const PuzzlePieces extracted = solver.extractPieces(puzzle.image, segmentation.mask, segmentation.roi);
+            seconds.push_back(t.elapsed());
+            t.restart();
+            const PuzzleSideDescriptors descriptors = solver.describeSides(extracted);
+            seconds.push_back(t.elapsed());
+            t.restart();
+            SideMatcherStats matcherStats;
+            const std::vector<std::vector<MatchedSide>> matched = solver.match(extracted, descriptors, {}, &matcherStats);
+            seconds.push_back(t.elapsed());
+            const SyntheticMatchScore score = scoreMatches(syntheticGroundTruth(puzzle, extracted), matched);
+            std::string assembled;
+            t.restart();
+            try {
+                solver.assemble(extracted, matched, AssemblyOutputGridOnly);
+                std::ostringstream text;
+                text << std::fixed << std::setprecision(3) << t.elapsed();
+                assembled = text.str();
+            } catch (const std::exception &) {
+                assembled = "failed";
+            }
+
+            std::cout << std::setw(8) << pieces << std::setw(10) << (std::to_string(options.rows) + "x" + std::to_string(options.cols))
+                      << std::setw(12) << (std::to_string(puzzle.image.width()) + "x" + std::to_string(puzzle.image.height()))
+                      << std::fixed << std::setprecision(3) << std::setw(12) << generate;
+            for (double s: seconds) std::cout << std::setw(10) << s;
+            std::cout << std::setw(10) << assembled << std::setw(16)
+                      << (std::to_string(score.correct) + "/" + std::to_string(score.sides)) << std::setprecision(0)
+                      << std::setw(12) << matcherStats.pairsPerSecond() << std::setw(14) << matcherStats.comparedSamples << std::endl;
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,142 @@
+#include "autotuner.h"
+
+#include "cpu_features.h"
+#include "runtime_assert.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace autotune {
+
+namespace {
+
+// Runs of each candidate, the best one counts (the first run also warms caches and the thread pool up)
+constexpr int runs_per_candidate = 2;
+
+struct State {
+    std::mutex mutex;
+    std::map<std::string, int> winners; // "kernel key" -> winner, ordered so that the file is stable
+    std::string cacheFile;
+};
+
+State &state() {
+    static State s;
+    return s;
+}
+
+std::string header() { return "cpu " + cpuFeatures().toString(); }
+
+std::string entryName(const std::string &kernel, const std::string &key) {
+    rassert(!kernel.empty() && kernel.find_first_of(" \n") == std::string::npos, 5830127461001, kernel);
+    rassert(!key.empty() && key.find_first_of(" \n") == std::string::npos, 5830127461002, key);
+    return kernel + " " + key;
+}
+
+// Under the lock
+void load(State &s) {
+    std::ifstream in(s.cacheFile);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != header()) return;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kernel, key;
+        int winner = -1;
+        if (fields >> kernel >> key >> winner && winner >= 0) s.winners.emplace(kernel + " " + key, winner);
+    }
+}
+
+// Under the lock, written to a temporary file and renamed, so that a concurrent reader never sees half of it
+void save(const State &s) {
+    if (s.cacheFile.empty()) return;
+    const std::filesystem::path path(s.cacheFile);
+    const std::filesystem::path tmp = path.string() + ".tmp";
+    std::error_code error;
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return;
+        out << header() << "\n";
+        for (const auto &[name, winner]: s.winners) out << name << " " << winner << "\n";
+        if (!out) return;
+    }
+    std::filesystem::rename(tmp, path, error);
+}
+
+} // namespace
+
+int choose(const std::string &kernel, const std::string &key, int candidates, const std::function<void(int)> &run,
+           bool *tuned) {
+    rassert(candidates > 0, 5830127461003, kernel, key, candidates);
+    const std::string name = entryName(kernel, key);
+    State &s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.winners.find(name);
+        // a winner out of range is from a version with more candidates
+        if (it != s.winners.end() && it->second < candidates) {
+            if (tuned) *tuned = false;
+            return it->second;
+        }
+    }
+
+    // measured without the lock: candidates may take long and may use other tuned kernels themselves
+    using Clock = std::chrono::steady_clock;
+    int best = 0;
+    double bestSeconds = std::numeric_limits<double>::max();
+    for (int i = 0; i < candidates; ++i) {
+        double seconds = std::numeric_limits<double>::max();
+        for (int r = 0; r < runs_per_candidate; ++r) {
+            const Clock::time_point t0 = Clock::now();
+            run(i);
+            seconds = std::min(seconds, std::chrono::duration<double>(Clock::now() - t0).count());
+        }
+        if (seconds < bestSeconds) {
+            bestSeconds = seconds;
+            best = i;
+        }
+    }
+    if (tuned) *tuned = true;
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto [it, inserted] = s.winners.emplace(name, best);
+    if (!inserted && it->second >= candidates) {
+        it->second = best;
+        inserted = true;
+    }
+    if (inserted) save(s);
+    return it->second;
+}
+
+int cached(const std::string &kernel, const std::string &key) {
+    const std::string name = entryName(kernel, key);
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.winners.find(name);
+    return it == s.winners.end() ? -1 : it->second;
+}
+
+void setCacheFile(const std::string &path) {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.cacheFile = path;
+    if (!path.empty()) load(s);
+}
+
+void clear() {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.winners.clear();
+}
+
+std::string sizeClass(std::size_t n) {
+    return "2^" + std::to_string(n <= 1 ? 0 : std::bit_width(n - 1));
+}
+
+} // namespace autotune
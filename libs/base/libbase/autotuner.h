@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Picks the fastest of interchangeable kernel variants (f.e. an algorithm and whether it runs in parallel) on this
+// machine: the first call for a (kernel, key) pair runs and times every candidate, later calls return the remembered
+// winner. Keys are size classes of the input (see sizeClass) and parameters that change the balance between variants,
+// so that a winner measured on a small image is not used for a large one.
+//
+// Winners are kept in memory for the process, and in a text file if setCacheFile was called; the file starts with
+// cpuFeatures().toString(), a file written on another CPU is ignored (and overwritten). Thread-safe: threads that tune
+// the same key at once each measure, the first result is kept.
+namespace autotune {
+
+// Index of the fastest candidate in [0, candidates). If the pair is not tuned yet, calls run(i) for every candidate
+// a few times (the best time counts), so run must produce the same result for every i and the caller may take
+// the output of the last call; returns without calling run otherwise. tuned (if not null) tells which case it was.
+int choose(const std::string &kernel, const std::string &key, int candidates, const std::function<void(int)> &run,
+           bool *tuned = nullptr);
+
+// Remembered winner, -1 if the pair is not tuned yet
+int cached(const std::string &kernel, const std::string &key);
+
+// Loads winners from path (if it exists and was written on this CPU) and saves every new winner there,
+// empty path - memory only
+void setCacheFile(const std::string &path);
+
+// Forgets the winners in memory (the cache file is kept)
+void clear();
+
+// "2^k" for the least k with n <= 2^k, f.e. sizeClass(width * height)
+std::string sizeClass(std::size_t n);
+
+} // namespace autotune
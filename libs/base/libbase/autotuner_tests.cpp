@@ -0,0 +1,115 @@
+#include "autotuner.h"
+
+#include "cpu_features.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Candidate i sleeps for delays[i] milliseconds
+std::function<void(int)> sleeper(const std::vector<int> &delays, std::vector<int> &calls) {
+    calls.assign(delays.size(), 0);
+    return [&delays, &calls](int i) {
+        ++calls[i];
+        std::this_thread::sleep_for(std::chrono::milliseconds(delays[i]));
+    };
+}
+
+fs::path tempCacheFile(const std::string &name) {
+    const fs::path path = fs::temp_directory_path() / ("autotuner_tests_" + name + ".txt");
+    fs::remove(path);
+    return path;
+}
+
+} // namespace
+
+TEST(autotuner, picksFastestAndRemembersIt) {
+    autotune::setCacheFile("");
+    autotune::clear();
+    const std::vector<int> delays = {20, 1, 10};
+    std::vector<int> calls;
+
+    bool tuned = false;
+    EXPECT_EQ(autotune::choose("sleep", "k1", 3, sleeper(delays, calls), &tuned), 1);
+    EXPECT_TRUE(tuned);
+    for (int c: calls) EXPECT_GT(c, 0);
+    EXPECT_EQ(autotune::cached("sleep", "k1"), 1);
+
+    EXPECT_EQ(autotune::choose("sleep", "k1", 3, sleeper(delays, calls), &tuned), 1);
+    EXPECT_FALSE(tuned);
+    for (int c: calls) EXPECT_EQ(c, 0);
+
+    // another key is tuned on its own
+    EXPECT_EQ(autotune::cached("sleep", "k2"), -1);
+    autotune::clear();
+    EXPECT_EQ(autotune::cached("sleep", "k1"), -1);
+}
+
+TEST(autotuner, winnerOutOfRangeIsRetuned) {
+    autotune::setCacheFile("");
+    autotune::clear();
+    std::vector<int> calls;
+    const std::vector<int> three = {10, 10, 1};
+    EXPECT_EQ(autotune::choose("sleep", "k", 3, sleeper(three, calls)), 2);
+    const std::vector<int> two = {1, 10};
+    bool tuned = false;
+    EXPECT_EQ(autotune::choose("sleep", "k", 2, sleeper(two, calls), &tuned), 0);
+    EXPECT_TRUE(tuned);
+    autotune::clear();
+}
+
+TEST(autotuner, cacheFileRoundTrip) {
+    const fs::path path = tempCacheFile("round_trip");
+    autotune::clear();
+    autotune::setCacheFile(path.string());
+    std::vector<int> calls;
+    const std::vector<int> delays = {10, 1};
+    EXPECT_EQ(autotune::choose("sleep", "2^20", 2, sleeper(delays, calls)), 1);
+    ASSERT_TRUE(fs::exists(path));
+
+    // as in a new process: winners come from the file, nothing is run
+    autotune::clear();
+    autotune::setCacheFile(path.string());
+    bool tuned = true;
+    EXPECT_EQ(autotune::choose("sleep", "2^20", 2, sleeper(delays, calls), &tuned), 1);
+    EXPECT_FALSE(tuned);
+    for (int c: calls) EXPECT_EQ(c, 0);
+
+    autotune::setCacheFile("");
+    autotune::clear();
+    fs::remove(path);
+}
+
+TEST(autotuner, cacheFileOfAnotherCpuIsIgnored) {
+    const fs::path path = tempCacheFile("another_cpu");
+    {
+        std::ofstream out(path);
+        out << "cpu some other features " << cpuFeatures().toString() << "\n";
+        out << "sleep k 1\n";
+    }
+    autotune::clear();
+    autotune::setCacheFile(path.string());
+    EXPECT_EQ(autotune::cached("sleep", "k"), -1);
+
+    autotune::setCacheFile("");
+    autotune::clear();
+    fs::remove(path);
+}
+
+TEST(autotuner, sizeClass) {
+    EXPECT_EQ(autotune::sizeClass(0), "2^0");
+    EXPECT_EQ(autotune::sizeClass(1), "2^0");
+    EXPECT_EQ(autotune::sizeClass(2), "2^1");
+    EXPECT_EQ(autotune::sizeClass(3), "2^2");
+    EXPECT_EQ(autotune::sizeClass(1024), "2^10");
+    EXPECT_EQ(autotune::sizeClass(1025), "2^11");
+}
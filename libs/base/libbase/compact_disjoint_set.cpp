@@ -0,0 +1,5 @@
+#include <libbase/compact_disjoint_set.h>
+
+// Explicit instantiations
+template class CompactDisjointSetUnion<std::uint32_t, true>;
+template class CompactDisjointSetUnion<std::uint32_t, false>;
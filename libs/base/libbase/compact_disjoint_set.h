@@ -0,0 +1,91 @@
+#pragma once
+
+#include <libbase/runtime_assert.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Disjoint set union for pixel-scale workloads: a single Index word per element (4 bytes by default instead of
+// 16 bytes of DisjointSetUnion). A root stores its rank with the top bit set, union by rank, path halving.
+// Checked = false drops per-call range checks (for hot loops that guarantee indices themselves).
+template <typename Index = std::uint32_t, bool Checked = true>
+class CompactDisjointSetUnion final {
+    static_assert(std::is_unsigned_v<Index>, "Index must be an unsigned integer type");
+
+public:
+    static constexpr Index kRootBit = Index(1) << (std::numeric_limits<Index>::digits - 1);
+    static constexpr std::size_t kMaxSize = static_cast<std::size_t>(kRootBit);
+
+    explicit CompactDisjointSetUnion(std::size_t n) : parent_(n, kRootBit) {
+        rassert(n <= kMaxSize, 2391578193421, n, kMaxSize);
+    }
+
+    std::size_t size() const noexcept { return parent_.size(); }
+    std::size_t memoryBytes() const noexcept { return parent_.capacity() * sizeof(Index); }
+
+    bool is_root(Index x) const {
+        check(x);
+        return parent_[x] & kRootBit;
+    }
+
+    Index find(Index x) {
+        check(x);
+        while (!(parent_[x] & kRootBit)) {
+            const Index p = parent_[x];
+            if (!(parent_[p] & kRootBit)) parent_[x] = parent_[p];
+            x = parent_[x];
+        }
+        return x;
+    }
+
+    // Unites sets containing a and b. Returns true if merged.
+    bool unite(Index a, Index b) {
+        const Index ra = find(a);
+        const Index rb = find(b);
+        if (ra == rb) return false;
+        unite_roots(ra, rb);
+        return true;
+    }
+
+    // Like unite(), but expects two different roots, returns the root of the merged set
+    Index unite_roots(Index ra, Index rb) {
+        check(ra);
+        check(rb);
+        if constexpr (Checked) {
+            rassert(ra != rb && is_root(ra) && is_root(rb), 2391578193422, ra, rb);
+        }
+        // both words have the root bit set, so they compare as ranks
+        if (parent_[ra] < parent_[rb]) std::swap(ra, rb);
+        if (parent_[ra] == parent_[rb]) ++parent_[ra];
+        parent_[rb] = ra;
+        return ra;
+    }
+
+    // Makes every element point directly to its root in one linear pass, so that find() is O(1) until the next union
+    void flatten() {
+        const std::size_t n = size();
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!(parent_[i] & kRootBit)) parent_[i] = find(static_cast<Index>(i));
+        }
+    }
+
+private:
+    void check(Index x) const {
+        if constexpr (Checked) {
+            rassert(x < size(), 2391578193420, x, size());
+        }
+    }
+
+    std::vector<Index> parent_;
+};
+
+using CompactDsu = CompactDisjointSetUnion<std::uint32_t, true>;
+using UncheckedCompactDsu = CompactDisjointSetUnion<std::uint32_t, false>;
+
+// Avoid implicit template instantiation in every TU
+extern template class CompactDisjointSetUnion<std::uint32_t, true>;
+extern template class CompactDisjointSetUnion<std::uint32_t, false>;
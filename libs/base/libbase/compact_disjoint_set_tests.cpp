@@ -0,0 +1,88 @@
+#include "compact_disjoint_set.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/disjoint_set.h>
+#include <libbase/runtime_assert.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+TEST(compact_disjoint_set, basicUnite) {
+    CompactDsu dsu(6);
+    EXPECT_EQ(dsu.size(), 6u);
+    EXPECT_EQ(dsu.memoryBytes(), 6u * sizeof(std::uint32_t));
+    for (std::uint32_t i = 0; i < 6; ++i) {
+        EXPECT_TRUE(dsu.is_root(i));
+        EXPECT_EQ(dsu.find(i), i);
+    }
+
+    EXPECT_TRUE(dsu.unite(0, 1));
+    EXPECT_TRUE(dsu.unite(2, 3));
+    EXPECT_FALSE(dsu.unite(1, 0));
+    EXPECT_TRUE(dsu.unite(1, 3));
+    EXPECT_EQ(dsu.find(0), dsu.find(2));
+    EXPECT_NE(dsu.find(0), dsu.find(4));
+    EXPECT_NE(dsu.find(4), dsu.find(5));
+
+    const std::uint32_t root = dsu.unite_roots(dsu.find(4), dsu.find(5));
+    EXPECT_EQ(dsu.find(4), root);
+    EXPECT_EQ(dsu.find(5), root);
+}
+
+TEST(compact_disjoint_set, checkedRejectsOutOfRange) {
+    CompactDsu dsu(3);
+    EXPECT_THROW(dsu.find(3), assertion_error);
+    EXPECT_THROW(dsu.unite(0, 7), assertion_error);
+    EXPECT_THROW(dsu.unite_roots(0, 0), assertion_error);
+}
+
+TEST(compact_disjoint_set, matchesDisjointSetUnionOnRandomUnions) {
+    const std::size_t n = 20000;
+    CompactDsu checked(n);
+    UncheckedCompactDsu unchecked(n);
+    DisjointSetUnion reference(n);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::uint32_t> dist(0, n - 1);
+    for (int it = 0; it < 15000; ++it) {
+        const std::uint32_t a = dist(rng);
+        const std::uint32_t b = dist(rng);
+        const bool merged = reference.unite(a, b);
+        EXPECT_EQ(checked.unite(a, b), merged);
+        EXPECT_EQ(unchecked.unite(a, b), merged);
+    }
+
+    // same partition: roots may differ, but equal roots must match equal roots
+    std::vector<std::int64_t> compactOfReference(n, -1);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const std::size_t r = reference.find(i);
+        const std::uint32_t c = checked.find(i);
+        if (compactOfReference[r] < 0) compactOfReference[r] = c;
+        ASSERT_EQ(compactOfReference[r], c) << i;
+        ASSERT_EQ(unchecked.find(i), unchecked.find(static_cast<std::uint32_t>(reference.find(i))));
+    }
+}
+
+TEST(compact_disjoint_set, flattenPointsEveryElementToItsRoot) {
+    const std::uint32_t n = 1000;
+    CompactDsu dsu(n);
+    // long chains in both directions
+    for (std::uint32_t i = 1; i < n / 2; ++i) dsu.unite(i - 1, i);
+    for (std::uint32_t i = n - 1; i > n / 2; --i) dsu.unite(i, i - 1);
+
+    std::vector<std::uint32_t> before(n);
+    for (std::uint32_t i = 0; i < n; ++i) before[i] = dsu.find(i);
+
+    dsu.flatten();
+    for (std::uint32_t i = 0; i < n; ++i) {
+        EXPECT_EQ(dsu.find(i), before[i]);
+        // after flatten every non-root is one step away from its root
+        const std::uint32_t root = dsu.find(i);
+        EXPECT_TRUE(dsu.is_root(root));
+    }
+    EXPECT_NE(dsu.find(0), dsu.find(n - 1));
+}
@@ -0,0 +1,46 @@
+#include "coro_task.h"
+
+namespace coro {
+
+IoThreads::IoThreads(int threads) {
+    rassert(threads > 0, 4419203711002, threads);
+    for (int i = 0; i < threads; ++i) threads_.emplace_back([this] { worker(); });
+}
+
+IoThreads::~IoThreads() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for (std::thread &thread: threads_) thread.join();
+}
+
+IoThreads &IoThreads::global() {
+    static IoThreads io;
+    return io;
+}
+
+void IoThreads::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    changed_.notify_one();
+}
+
+void IoThreads::worker() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace coro
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "runtime_assert.h"
+#include "task_scheduler.h"
+
+// C++20 coroutines on top of TaskScheduler, so that stages (decode, CPU work, encoding and writes of debug images)
+// of several images overlap without threads managed by hand:
+//
+//   coro::Task<Result> solveOne(std::string path) {
+//       image8u image = co_await loadAsync(path);       // decoded on an I/O thread, compute workers are free meanwhile
+//       Result result = compute(image);                 // continues on a scheduler worker
+//       co_await debug_io::dumpAsync(dumpPath, std::move(result.visualization));
+//       co_return result;
+//   }
+//   std::vector<Result> all = coro::syncWait(coro::whenAll(std::move(tasks)));
+//
+// Task is lazy: it starts when awaited (or passed to syncWait / whenAll) and continues the awaiting coroutine
+// right where it finishes (symmetric transfer, no extra scheduling). Blocking calls go through offload(): they run
+// on IoThreads, and the coroutine is resumed on the scheduler when they are done.
+namespace coro {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+// Value or exception of a finished computation
+template <typename T>
+struct Result {
+    std::optional<T> value;
+    std::exception_ptr error;
+
+    template <typename F>
+    void capture(F &&f) noexcept {
+        try {
+            value.emplace(f());
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Result<void> {
+    std::exception_ptr error;
+
+    template <typename F>
+    void capture(F &&f) noexcept {
+        try {
+            f();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept { return h.promise().continuation; }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    Result<T> result;
+
+    Task<T> get_return_object() noexcept;
+    void unhandled_exception() noexcept { result.error = std::current_exception(); }
+    template <typename U>
+    void return_value(U &&value) { result.value.emplace(std::forward<U>(value)); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Result<void> result;
+
+    Task<void> get_return_object() noexcept;
+    void unhandled_exception() noexcept { result.error = std::current_exception(); }
+    void return_void() noexcept {}
+};
+
+} // namespace detail
+
+template <typename T>
+class [[nodiscard]] Task {
+  public:
+    using promise_type = detail::Promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(handle_type h) noexcept : h_(h) {}
+    Task(Task &&other) noexcept : h_(std::exchange(other.h_, {})) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+    ~Task() {
+        if (h_) h_.destroy();
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    bool valid() const noexcept { return static_cast<bool>(h_); }
+
+    struct Awaiter {
+        handle_type h;
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            h.promise().continuation = awaiting;
+            return h;
+        }
+        T await_resume() { return h.promise().result.take(); }
+    };
+
+    // Starts the task, the awaiting coroutine continues with its result (or its exception) when it finishes
+    Awaiter operator co_await() const noexcept {
+        rassert(h_ && !h_.done(), 4419203711001, "Task is empty or was already awaited");
+        return Awaiter{h_};
+    }
+
+  private:
+    handle_type h_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+// Resumes the awaiting coroutine as a task of scheduler (f.e. to leave an I/O thread or to fork: see whenAll)
+struct ScheduleAwaiter {
+    TaskScheduler &scheduler;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { scheduler.spawn([h] { h.resume(); }); }
+    void await_resume() const noexcept {}
+};
+
+inline ScheduleAwaiter schedule(TaskScheduler &scheduler = TaskScheduler::global()) { return {scheduler}; }
+
+// Threads for blocking calls (file reads, decoding, encoding and writes), so that they never occupy compute workers.
+// Jobs run in the order they were posted.
+class IoThreads final {
+  public:
+    explicit IoThreads(int threads = 2);
+    // Runs the jobs still queued
+    ~IoThreads();
+
+    IoThreads(const IoThreads &) = delete;
+    IoThreads &operator=(const IoThreads &) = delete;
+
+    static IoThreads &global();
+
+    void post(std::function<void()> job);
+
+  private:
+    void worker();
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<std::function<void()>> jobs_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+template <typename F>
+class OffloadAwaiter {
+  public:
+    using result_type = std::invoke_result_t<F &>;
+
+    OffloadAwaiter(F f, TaskScheduler &scheduler, IoThreads &io) : f_(std::move(f)), scheduler_(scheduler), io_(io) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        io_.post([this, h] {
+            result_.capture(f_);
+            scheduler_.spawn([h] { h.resume(); });
+        });
+    }
+    result_type await_resume() { return result_.take(); }
+
+  private:
+    F f_;
+    TaskScheduler &scheduler_;
+    IoThreads &io_;
+    detail::Result<result_type> result_;
+};
+
+// co_await offload(f) calls f() on io and continues on scheduler with its result (or its exception)
+template <typename F>
+OffloadAwaiter<std::decay_t<F>> offload(F &&f, TaskScheduler &scheduler = TaskScheduler::global(),
+                                        IoThreads &io = IoThreads::global()) {
+    return OffloadAwaiter<std::decay_t<F>>(std::forward<F>(f), scheduler, io);
+}
+
+namespace detail {
+
+// Coroutine without a continuation that sets a flag once it is suspended for good (so the frame may be destroyed)
+struct SignalingTask {
+    struct promise_type {
+        std::atomic<bool> *done = nullptr;
+
+        SignalingTask get_return_object() noexcept {
+            return SignalingTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                h.promise().done->store(true, std::memory_order_release);
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); } // bodies below catch everything
+    };
+
+    std::coroutine_handle<promise_type> h;
+
+    ~SignalingTask() {
+        if (h) h.destroy();
+    }
+};
+
+template <typename T>
+SignalingTask awaitInto(const Task<T> &task, Result<T> &result) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            result.value.emplace(co_await task);
+        }
+    } catch (...) {
+        result.error = std::current_exception();
+    }
+}
+
+} // namespace detail
+
+// Runs task to completion and returns its result (rethrows its exception). The calling thread runs pending tasks
+// of scheduler meanwhile (as TaskGroup::wait does), so it works without worker threads too.
+template <typename T>
+T syncWait(Task<T> task, TaskScheduler &scheduler = TaskScheduler::global()) {
+    std::atomic<bool> done{false};
+    detail::Result<T> result;
+    detail::SignalingTask waiter = detail::awaitInto(task, result);
+    waiter.h.promise().done = &done;
+    waiter.h.resume();
+    while (!done.load(std::memory_order_acquire)) {
+        if (!scheduler.runPending()) std::this_thread::yield();
+    }
+    return result.take();
+}
+
+namespace detail {
+
+template <typename T>
+using WhenAllResult = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+struct WhenAllLatch {
+    std::atomic<int> pending{0};
+    std::coroutine_handle<> parent;
+};
+
+// Child of whenAll: runs one task on the scheduler, the last child to finish resumes the parent
+struct WhenAllChild {
+    struct promise_type {
+        WhenAllLatch *latch = nullptr;
+
+        WhenAllChild get_return_object() noexcept {
+            return WhenAllChild{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                WhenAllLatch &latch = *h.promise().latch;
+                if (latch.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) return latch.parent;
+                return std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); } // the body catches everything
+    };
+
+    std::coroutine_handle<promise_type> h;
+
+    WhenAllChild(std::coroutine_handle<promise_type> handle) noexcept : h(handle) {}
+    WhenAllChild(WhenAllChild &&other) noexcept : h(std::exchange(other.h, {})) {}
+    ~WhenAllChild() {
+        if (h) h.destroy();
+    }
+};
+
+template <typename T>
+WhenAllChild whenAllChild(const Task<T> &task, Result<T> &result, TaskScheduler &scheduler) {
+    try {
+        co_await schedule(scheduler);
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            result.value.emplace(co_await task);
+        }
+    } catch (...) {
+        result.error = std::current_exception();
+    }
+}
+
+struct WhenAllAwaiter {
+    WhenAllLatch &latch;
+    std::vector<WhenAllChild> &children;
+
+    bool await_ready() const noexcept { return children.empty(); }
+    bool await_suspend(std::coroutine_handle<> parent) {
+        latch.parent = parent;
+        // one extra count, so that children that finish while others are still being started do not resume the parent
+        latch.pending.store(static_cast<int>(children.size()) + 1, std::memory_order_relaxed);
+        for (WhenAllChild &child: children) {
+            child.h.promise().latch = &latch;
+            child.h.resume(); // only spawns it on the scheduler
+        }
+        return latch.pending.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+    void await_resume() const noexcept {}
+};
+
+} // namespace detail
+
+// Runs all tasks at once on scheduler (each from its own scheduler task), results are in the order of tasks.
+// If some of them throw, all of them still finish and the exception of the first one in order is rethrown.
+template <typename T>
+Task<detail::WhenAllResult<T>> whenAll(std::vector<Task<T>> tasks, TaskScheduler &scheduler = TaskScheduler::global()) {
+    std::vector<detail::Result<T>> results(tasks.size());
+    std::vector<detail::WhenAllChild> children;
+    children.reserve(tasks.size());
+    for (std::size_t i = 0; i < tasks.size(); ++i) children.push_back(detail::whenAllChild(tasks[i], results[i], scheduler));
+
+    detail::WhenAllLatch latch;
+    co_await detail::WhenAllAwaiter{latch, children};
+
+    if constexpr (std::is_void_v<T>) {
+        for (detail::Result<T> &result: results) result.take();
+    } else {
+        std::vector<T> values;
+        values.reserve(results.size());
+        for (detail::Result<T> &result: results) values.push_back(result.take());
+        co_return values;
+    }
+}
+
+} // namespace coro
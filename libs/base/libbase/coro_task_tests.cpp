@@ -0,0 +1,101 @@
+#include "coro_task.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+coro::Task<int> answer() { co_return 42; }
+
+coro::Task<int> twice(int x) {
+    const int a = co_await answer();
+    co_return a * x;
+}
+
+coro::Task<void> fail() {
+    throw std::runtime_error("failed");
+    co_return;
+}
+
+// Blocking call on an I/O thread, the most calls that were blocked at once are recorded
+coro::Task<int> slowRead(int value, coro::IoThreads &io, std::atomic<int> &blocked, std::atomic<int> &maxBlocked) {
+    const int v = co_await coro::offload([value, &blocked, &maxBlocked] {
+        const int now = ++blocked;
+        int seen = maxBlocked.load();
+        while (now > seen && !maxBlocked.compare_exchange_weak(seen, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        --blocked;
+        return value;
+    }, TaskScheduler::global(), io);
+    co_return v;
+}
+
+} // namespace
+
+TEST(coro_task, awaitsNestedTasks) {
+    EXPECT_EQ(coro::syncWait(twice(3)), 126);
+    coro::Task<int> lazy = answer(); // nothing runs before it is awaited
+    EXPECT_TRUE(lazy.valid());
+    EXPECT_EQ(coro::syncWait(std::move(lazy)), 42);
+}
+
+TEST(coro_task, exceptionsPropagateToTheAwaiter) {
+    EXPECT_THROW(coro::syncWait(fail()), std::runtime_error);
+
+    auto catching = []() -> coro::Task<std::string> {
+        try {
+            co_await fail();
+        } catch (const std::runtime_error &e) {
+            co_return std::string(e.what());
+        }
+        co_return std::string();
+    };
+    EXPECT_EQ(coro::syncWait(catching()), "failed");
+}
+
+TEST(coro_task, offloadRunsOnIoThreadsAndResumesOnScheduler) {
+    TaskScheduler scheduler;
+    coro::IoThreads io(1);
+    std::thread::id ioThread, resumedOn;
+    auto task = [&]() -> coro::Task<int> {
+        const int v = co_await coro::offload([&] {
+            ioThread = std::this_thread::get_id();
+            return 7;
+        }, scheduler, io);
+        resumedOn = std::this_thread::get_id();
+        co_return v;
+    };
+    EXPECT_EQ(coro::syncWait(task(), scheduler), 7);
+    EXPECT_NE(ioThread, std::thread::id());
+    EXPECT_NE(ioThread, resumedOn);
+
+    auto throwing = [&]() -> coro::Task<void> {
+        co_await coro::offload([] { throw std::runtime_error("io"); }, scheduler, io);
+    };
+    EXPECT_THROW(coro::syncWait(throwing(), scheduler), std::runtime_error);
+}
+
+TEST(coro_task, whenAllOverlapsBlockingCallsAndKeepsOrder) {
+    coro::IoThreads io(4);
+    const int n = 8;
+    std::atomic<int> blocked{0}, maxBlocked{0};
+    std::vector<coro::Task<int>> tasks;
+    for (int i = 0; i < n; ++i) tasks.push_back(slowRead(i * 10, io, blocked, maxBlocked));
+
+    const std::vector<int> values = coro::syncWait(coro::whenAll(std::move(tasks)));
+    ASSERT_EQ(values.size(), static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) EXPECT_EQ(values[i], i * 10);
+    EXPECT_GT(maxBlocked.load(), 1); // the calls overlapped on the I/O threads
+
+    std::vector<coro::Task<void>> failing;
+    failing.push_back(fail());
+    failing.push_back([]() -> coro::Task<void> { co_return; }());
+    EXPECT_THROW(coro::syncWait(coro::whenAll(std::move(failing))), std::runtime_error);
+    EXPECT_TRUE(coro::syncWait(coro::whenAll(std::vector<coro::Task<int>>())).empty());
+}
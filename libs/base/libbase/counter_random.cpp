@@ -0,0 +1,69 @@
+#include "counter_random.h"
+
+#include <algorithm>
+
+namespace {
+
+// 24 high bits -> exact step for float mantissa, as in FastRandom
+constexpr float inv_2_24 = 1.0f / 16777216.0f;
+
+} // namespace
+
+CounterRandom::CounterRandom(uint64_t seed) : key_(mix(seed + gamma)) {}
+
+CounterRandom CounterRandom::split(uint64_t index) const {
+    // keys of child streams are hashes again, so that neighbouring indices give unrelated streams
+    return CounterRandom(mix(key_ ^ mix(index * gamma + 0x632BE59BD9B4E019ull)), 0);
+}
+
+int32_t CounterRandom::nextInt() { return static_cast<int32_t>(nextU32()); }
+
+int32_t CounterRandom::nextInt(int32_t minVal, int32_t maxVal) {
+    if (minVal > maxVal)
+        std::swap(minVal, maxVal);
+
+    // Map uint32 -> [0, range) using multiply-high, 0 means the full uint32 range
+    const uint32_t range = static_cast<uint32_t>(
+        static_cast<uint64_t>(static_cast<uint32_t>(maxVal) - static_cast<uint32_t>(minVal)) + 1ull);
+    if (range == 0)
+        return nextInt();
+
+    const uint32_t v = static_cast<uint32_t>((static_cast<uint64_t>(nextU32()) * range) >> 32);
+    return static_cast<int32_t>(static_cast<uint32_t>(minVal) + v);
+}
+
+float CounterRandom::nextFloat() {
+    return static_cast<float>(nextU32() >> 8) * inv_2_24;
+}
+
+float CounterRandom::nextFloat(float minVal, float maxVal) {
+    if (minVal > maxVal)
+        std::swap(minVal, maxVal);
+    return minVal + (maxVal - minVal) * nextFloat();
+}
+
+void CounterRandom::fill(std::span<uint32_t> out) {
+    const uint64_t base = key_ + counter_ * gamma;
+    const std::size_t n = out.size();
+    for (std::size_t k = 0; k < n; ++k) {
+        out[k] = static_cast<uint32_t>(mix(base + k * gamma) >> 32);
+    }
+    counter_ += n;
+}
+
+void CounterRandom::fill(std::span<float> out) {
+    const uint64_t base = key_ + counter_ * gamma;
+    const std::size_t n = out.size();
+    for (std::size_t k = 0; k < n; ++k) {
+        out[k] = static_cast<float>(static_cast<uint32_t>(mix(base + k * gamma) >> 40)) * inv_2_24;
+    }
+    counter_ += n;
+}
+
+void CounterRandom::fill(std::span<float> out, float minVal, float maxVal) {
+    if (minVal > maxVal)
+        std::swap(minVal, maxVal);
+    const float scale = maxVal - minVal;
+    fill(out);
+    for (float &v : out) v = minVal + scale * v;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+// Counter-based generator: the i-th value of a stream is a splitmix64 hash of (key, i), so that there is no hidden
+// state to share between threads. A parallel task takes its own stream with split(task index) (or jumps to its offset
+// in a common stream), and the values do not depend on how tasks are scheduled or on the number of threads.
+// Same interface as FastRandom, but a different sequence (FastRandom sequences are kept as they are).
+class CounterRandom {
+public:
+    explicit CounterRandom(uint64_t seed=239);
+
+    // Independent stream number index of this one (depends on the key only, not on the values drawn so far)
+    CounterRandom split(uint64_t index) const;
+
+    // Skips n values: the same as calling nextU32() n times
+    void jump(uint64_t n) { counter_ += n; }
+
+    // Values drawn so far (with jumps counted)
+    uint64_t position() const { return counter_; }
+
+    // Value number i of the stream regardless of the position
+    uint32_t at(uint64_t i) const { return static_cast<uint32_t>(mix(key_ + i * gamma) >> 32); }
+
+    uint32_t nextU32() { return at(counter_++); }
+
+    // Returns a random signed int (full range)
+    int32_t nextInt();
+
+    // Returns a random int in [minVal, maxVal] (inclusive)
+    int32_t nextInt(int32_t minVal, int32_t maxVal);
+
+    // Returns a random float in [0, 1)
+    float nextFloat();
+
+    // Returns a random float in [minVal, maxVal)
+    float nextFloat(float minVal, float maxVal);
+
+    // Bulk versions: the next out.size() values, the same as calling the single ones in a loop
+    // (no dependency between iterations, so the loops vectorize)
+    void fill(std::span<uint32_t> out);
+    void fill(std::span<float> out); // in [0, 1)
+    void fill(std::span<float> out, float minVal, float maxVal);
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+
+private:
+    explicit CounterRandom(uint64_t key, uint64_t counter) : key_(key), counter_(counter) {}
+
+    static constexpr uint64_t gamma = 0x9E3779B97F4A7C15ull; // golden ratio increment of splitmix64
+
+    uint64_t key_;
+    uint64_t counter_ = 0;
+};
@@ -0,0 +1,94 @@
+#include "counter_random.h"
+
+#include "task_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+TEST(CounterRandom, DeterministicSameSeed) {
+    CounterRandom a(123u);
+    CounterRandom b(123u);
+    CounterRandom c(124u);
+    bool anyDiff = false;
+    for (int i = 0; i < 1000; ++i) {
+        const uint32_t v = a.nextU32();
+        EXPECT_EQ(v, b.nextU32());
+        anyDiff |= v != c.nextU32();
+    }
+    EXPECT_TRUE(anyDiff);
+}
+
+TEST(CounterRandom, JumpAndAtMatchSequentialDraws) {
+    CounterRandom sequential(7u);
+    std::vector<uint32_t> values(100);
+    for (uint32_t &v : values) v = sequential.nextU32();
+
+    CounterRandom jumped(7u);
+    jumped.jump(40);
+    EXPECT_EQ(jumped.position(), 40u);
+    for (int i = 40; i < 100; ++i) EXPECT_EQ(jumped.nextU32(), values[i]);
+    for (int i = 0; i < 100; ++i) EXPECT_EQ(jumped.at(i), values[i]);
+}
+
+TEST(CounterRandom, BulkFillMatchesSingleDraws) {
+    CounterRandom single(11u);
+    CounterRandom bulk(11u);
+    single.nextU32();
+    bulk.nextU32();
+
+    std::vector<uint32_t> ints(37);
+    bulk.fill(std::span<uint32_t>(ints));
+    for (uint32_t v : ints) EXPECT_EQ(v, single.nextU32());
+
+    std::vector<float> floats(53);
+    bulk.fill(std::span<float>(floats));
+    for (float v : floats) EXPECT_EQ(v, single.nextFloat());
+
+    bulk.fill(std::span<float>(floats), 2.0f, -3.0f);
+    for (float v : floats) {
+        EXPECT_EQ(v, single.nextFloat(-3.0f, 2.0f));
+        EXPECT_GE(v, -3.0f);
+        EXPECT_LT(v, 2.0f);
+    }
+    EXPECT_EQ(bulk.position(), single.position());
+}
+
+TEST(CounterRandom, SplitStreamsAreIndependentOfThreads) {
+    const CounterRandom root(5u);
+    EXPECT_NE(root.split(0).nextU32(), root.split(1).nextU32());
+
+    // drawing from the root does not change its children
+    CounterRandom drawn = root;
+    drawn.nextU32();
+    EXPECT_EQ(drawn.split(3).nextU32(), root.split(3).nextU32());
+
+    const int tasks = 64;
+    auto run = [&](bool parallel) {
+        std::vector<uint64_t> sums(tasks, 0);
+        parallelForEach(0, tasks, [&](int t) {
+            CounterRandom r = root.split(static_cast<uint64_t>(t));
+            for (int i = 0; i < 1000; ++i) sums[t] += r.nextInt(0, 1000);
+        }, parallel);
+        return sums;
+    };
+    const std::vector<uint64_t> serial = run(false);
+    EXPECT_EQ(run(true), serial);
+    EXPECT_EQ(std::unordered_set<uint64_t>(serial.begin(), serial.end()).size(), serial.size());
+}
+
+TEST(CounterRandom, NextIntStaysInRange) {
+    CounterRandom r(3u);
+    std::vector<int> counts(7, 0);
+    for (int i = 0; i < 7000; ++i) {
+        const int v = r.nextInt(10, 4);
+        ASSERT_GE(v, 4);
+        ASSERT_LE(v, 10);
+        ++counts[v - 4];
+    }
+    for (int count : counts) EXPECT_GT(count, 700);
+    const int32_t full = r.nextInt(INT32_MIN, INT32_MAX);
+    EXPECT_EQ(static_cast<uint32_t>(full), r.at(r.position() - 1));
+}
@@ -0,0 +1,193 @@
+#include "cpu_budget.h"
+
+#include "runtime_assert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <bit>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+thread_local int currentBudget = 0;
+
+std::mutex stagesMutex;
+std::map<std::string, int> stages;
+
+int affinityCpus() {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+    return CPU_COUNT(&set);
+#elif defined(_WIN32)
+    DWORD_PTR process = 0, system = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) return 0;
+    return std::popcount(static_cast<unsigned long long>(process));
+#else
+    return 0;
+#endif
+}
+
+#if defined(__linux__)
+
+bool readFile(const std::string &path, std::string &text) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    text = ss.str();
+    return true;
+}
+
+// The smallest positive quota of the cgroup of the process and its ancestors; in a container with its own cgroup
+// namespace /proc/self/cgroup says "0::/" and the limit is in the root cpu.max
+double cgroupV2Quota() {
+    std::string text;
+    std::string path = "/";
+    if (readFile("/proc/self/cgroup", text)) {
+        std::istringstream lines(text);
+        for (std::string line; std::getline(lines, line);) {
+            if (line.rfind("0::", 0) == 0) path = line.substr(3);
+        }
+    }
+    double quota = 0.0;
+    for (;;) {
+        std::string cpuMax;
+        if (readFile("/sys/fs/cgroup" + (path == "/" ? std::string() : path) + "/cpu.max", cpuMax)) {
+            const double q = parseCgroupCpuMax(cpuMax);
+            if (q > 0.0 && (quota == 0.0 || q < quota)) quota = q;
+        }
+        if (path.empty() || path == "/") break;
+        const std::size_t slash = path.rfind('/');
+        path = slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+    }
+    return quota;
+}
+
+double cgroupV1Quota() {
+    for (const char *dir : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"}) {
+        std::string quota, period;
+        if (readFile(std::string(dir) + "/cpu.cfs_quota_us", quota) && readFile(std::string(dir) + "/cpu.cfs_period_us", period)) {
+            return cgroupQuotaCpus(std::atoll(quota.c_str()), std::atoll(period.c_str()));
+        }
+    }
+    return 0.0;
+}
+
+#endif
+
+double quotaCpus() {
+#if defined(__linux__)
+    const double v2 = cgroupV2Quota();
+    return v2 > 0.0 ? v2 : cgroupV1Quota();
+#else
+    return 0.0;
+#endif
+}
+
+} // namespace
+
+std::string CpuLimits::toString() const {
+    std::ostringstream ss;
+    ss << available << " of " << hardware << " CPUs (affinity ";
+    if (affinity > 0) ss << affinity; else ss << "unknown";
+    ss << ", quota ";
+    if (quota > 0.0) ss << quota; else ss << "none";
+    ss << ")";
+    return ss.str();
+}
+
+CpuLimits detectCpuLimits() {
+    CpuLimits limits;
+    limits.hardware = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    limits.affinity = affinityCpus();
+    limits.quota = quotaCpus();
+    limits.available = limits.hardware;
+    if (limits.affinity > 0) limits.available = std::min(limits.available, limits.affinity);
+    if (limits.quota > 0.0) {
+        // a quota of 1.5 CPUs still lets two threads run half of the time each
+        limits.available = std::min(limits.available, std::max(1, static_cast<int>(std::ceil(limits.quota - 1e-9))));
+    }
+    return limits;
+}
+
+int availableCpus() {
+    static const int cpus = detectCpuLimits().available;
+    return cpus;
+}
+
+double parseCgroupCpuMax(const std::string &cpuMax) {
+    std::istringstream in(cpuMax);
+    std::string quota;
+    long long period = 100000;
+    if (!(in >> quota) || quota == "max") return 0.0;
+    in >> period;
+    return cgroupQuotaCpus(std::atoll(quota.c_str()), period);
+}
+
+double cgroupQuotaCpus(long long quotaUs, long long periodUs) {
+    if (quotaUs <= 0 || periodUs <= 0) return 0.0;
+    return static_cast<double>(quotaUs) / static_cast<double>(periodUs);
+}
+
+void setStageThreads(const std::string &stage, int threads) {
+    rassert(!stage.empty(), 48120937561001);
+    std::lock_guard<std::mutex> lock(stagesMutex);
+    stages[stage] = threads;
+}
+
+void clearStageThreads() {
+    std::lock_guard<std::mutex> lock(stagesMutex);
+    stages.clear();
+}
+
+int stageThreads(const std::string &stage) {
+    const int cpus = availableCpus();
+    int threads = cpus;
+    {
+        std::lock_guard<std::mutex> lock(stagesMutex);
+        auto it = stages.find(stage);
+        if (it != stages.end()) threads = it->second > 0 ? it->second : cpus + it->second;
+    }
+    return std::clamp(threads, 1, cpus);
+}
+
+ThreadBudgetScope::ThreadBudgetScope(int threads) : previous_(currentBudget) {
+    if (threads > 0) currentBudget = previous_ > 0 ? std::min(previous_, threads) : threads;
+#ifdef _OPENMP
+    previousOpenMP_ = omp_get_max_threads();
+    if (currentBudget > 0) omp_set_num_threads(std::min(previousOpenMP_, currentBudget));
+#endif
+}
+
+ThreadBudgetScope::~ThreadBudgetScope() {
+    currentBudget = previous_;
+#ifdef _OPENMP
+    omp_set_num_threads(previousOpenMP_);
+#endif
+}
+
+int threadBudget() noexcept { return currentBudget; }
+
+void limitOpenMPToAvailableCpus() {
+#ifdef _OPENMP
+    if (std::getenv("OMP_NUM_THREADS") == nullptr) omp_set_num_threads(availableCpus());
+#endif
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+
+// CPUs the process may really use, not the cores of the host: in a container with a CPU limit the cgroup quota
+// (cgroup v2 cpu.max or v1 cpu.cfs_quota_us / cpu.cfs_period_us, the smallest one up the cgroup hierarchy) throttles
+// every thread above it, and the affinity mask (taskset, cpuset) leaves only some cores.
+struct CpuLimits final {
+    int hardware = 1;   // std::thread::hardware_concurrency()
+    int affinity = 0;   // CPUs in the affinity mask of the process, 0 - unknown
+    double quota = 0.0; // CPUs worth of the cgroup quota, f.e. 2.5, 0 - no quota (or unknown)
+    int available = 1;  // min of the above, the quota rounded up, at least 1
+
+    // F.e. "2 of 64 CPUs (affinity 64, quota 1.5)"
+    std::string toString() const;
+};
+
+// Reads the system on every call
+CpuLimits detectCpuLimits();
+// detectCpuLimits().available of the first call
+int availableCpus();
+
+// Contents of cgroup v2 cpu.max ("max 100000" or "150000 100000") as CPUs, 0 - no quota
+double parseCgroupCpuMax(const std::string &cpuMax);
+// cgroup v1 cpu.cfs_quota_us and cpu.cfs_period_us as CPUs, 0 - no quota (quota -1)
+double cgroupQuotaCpus(long long quotaUs, long long periodUs);
+
+// Thread budgets of pipeline stages by name (f.e. "decode", "match"): threads > 0 - at most that many,
+// threads <= 0 - all available CPUs but -threads (f.e. -2 for matching next to a two-threaded decode),
+// always clamped to [1, availableCpus()]. Stages that were not set get availableCpus(). Thread-safe.
+void setStageThreads(const std::string &stage, int threads);
+void clearStageThreads();
+int stageThreads(const std::string &stage);
+
+// Runs the code of the calling thread within a thread budget until destroyed: parallelFor on this thread
+// runs on at most threads threads (see task_scheduler.h) and OpenMP regions opened by this thread get at most that many
+// threads (omp_set_num_threads, never more than before). Scopes nest, an inner one can only lower the budget.
+// threads <= 0 - no limit of its own.
+class ThreadBudgetScope final {
+  public:
+    explicit ThreadBudgetScope(int threads);
+    ~ThreadBudgetScope();
+
+    ThreadBudgetScope(const ThreadBudgetScope &) = delete;
+    ThreadBudgetScope &operator=(const ThreadBudgetScope &) = delete;
+
+  private:
+    int previous_ = 0;
+    int previousOpenMP_ = 0;
+};
+
+// Budget of the calling thread, 0 - none
+int threadBudget() noexcept;
+
+// Default number of threads of OpenMP regions = availableCpus() (OpenMP counts the cores of the host and knows nothing
+// of cgroup quotas), unless OMP_NUM_THREADS is set. Only affects the calling thread and threads started by it later,
+// so call it at the start of main. Does nothing without OpenMP.
+void limitOpenMPToAvailableCpus();
@@ -0,0 +1,87 @@
+#include "cpu_budget.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "task_scheduler.h"
+
+TEST(cpu_budget, parsesCgroupQuotas) {
+    EXPECT_EQ(parseCgroupCpuMax("max 100000\n"), 0.0);
+    EXPECT_DOUBLE_EQ(parseCgroupCpuMax("150000 100000\n"), 1.5);
+    EXPECT_DOUBLE_EQ(parseCgroupCpuMax("200000"), 2.0); // the period defaults to 100 ms
+    EXPECT_EQ(parseCgroupCpuMax(""), 0.0);
+
+    EXPECT_EQ(cgroupQuotaCpus(-1, 100000), 0.0);
+    EXPECT_DOUBLE_EQ(cgroupQuotaCpus(50000, 100000), 0.5);
+}
+
+TEST(cpu_budget, availableCpusWithinHardware) {
+    const CpuLimits limits = detectCpuLimits();
+    EXPECT_GE(limits.available, 1);
+    EXPECT_LE(limits.available, limits.hardware);
+    if (limits.affinity > 0) EXPECT_LE(limits.available, limits.affinity);
+    EXPECT_EQ(availableCpus(), limits.available);
+    EXPECT_FALSE(limits.toString().empty());
+}
+
+TEST(cpu_budget, stageThreadsAreClamped) {
+    const int cpus = availableCpus();
+    clearStageThreads();
+    EXPECT_EQ(stageThreads("decode"), cpus);
+
+    setStageThreads("decode", 2);
+    setStageThreads("match", -2);
+    setStageThreads("assemble", 1000);
+    EXPECT_EQ(stageThreads("decode"), std::min(2, cpus));
+    EXPECT_EQ(stageThreads("match"), std::max(1, cpus - 2));
+    EXPECT_EQ(stageThreads("assemble"), cpus);
+
+    clearStageThreads();
+    EXPECT_EQ(stageThreads("match"), cpus);
+}
+
+TEST(cpu_budget, scopesNestAndRestore) {
+    EXPECT_EQ(threadBudget(), 0);
+    {
+        ThreadBudgetScope outer(3);
+        EXPECT_EQ(threadBudget(), 3);
+        {
+            ThreadBudgetScope inner(5); // can not raise the budget of the outer one
+            EXPECT_EQ(threadBudget(), 3);
+            ThreadBudgetScope lower(2);
+            EXPECT_EQ(threadBudget(), 2);
+        }
+        ThreadBudgetScope none(0);
+        EXPECT_EQ(threadBudget(), 3);
+    }
+    EXPECT_EQ(threadBudget(), 0);
+}
+
+TEST(cpu_budget, parallelForStaysWithinBudget) {
+    TaskScheduler::Options options;
+    options.threads = 5;
+    TaskScheduler scheduler(options);
+
+    for (int budget : {1, 2, 3}) {
+        ThreadBudgetScope scope(budget);
+        std::atomic<int> running{0};
+        std::atomic<int> maxRunning{0};
+        std::vector<std::atomic<int>> hits(200);
+        parallelFor(0, 200, 3, [&](int from, int to) {
+            const int now = running.fetch_add(1) + 1;
+            int seen = maxRunning.load();
+            while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {}
+            EXPECT_EQ(threadBudget(), 1); // nested loops of a range run on its thread
+            for (int i = from; i < to; ++i) hits[i].fetch_add(1);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            running.fetch_sub(1);
+        }, true, scheduler);
+        EXPECT_LE(maxRunning.load(), budget);
+        for (const std::atomic<int> &h : hits) EXPECT_EQ(h.load(), 1);
+    }
+}
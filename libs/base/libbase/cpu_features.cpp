@@ -0,0 +1,89 @@
+#include "cpu_features.h"
+
+#include "runtime_assert.h"
+
+#include <cstdlib>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures f;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    f.sse42 = __builtin_cpu_supports("sse4.2");
+    f.avx2 = __builtin_cpu_supports("avx2");
+    f.fma = __builtin_cpu_supports("fma");
+    f.f16c = __builtin_cpu_supports("f16c");
+    // libgcc also checks that the OS saves the opmask and ZMM registers
+    f.avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4] = {};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    f.sse42 = (info[2] & (1 << 20)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool f16c = (info[2] & (1 << 29)) != 0;
+    // OS must save YMM registers on context switch (and the opmask and ZMM ones for AVX-512)
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+    const bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    if (maxLeaf >= 7 && ymmEnabled) {
+        __cpuidex(info, 7, 0);
+        f.avx2 = (info[1] & (1 << 5)) != 0;
+        f.fma = fma;
+        f.f16c = f16c;
+        const unsigned mask = (1u << 16) | (1u << 30) | (1u << 31); // F, BW, VL
+        f.avx512 = zmmEnabled && (static_cast<unsigned>(info[1]) & mask) == mask;
+    }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    f.neon = true; // mandatory on AArch64
+#endif
+    return f;
+}
+
+} // namespace
+
+std::string CpuFeatures::toString() const {
+    std::string s;
+    auto add = [&](bool has, const char *name) {
+        if (!has) return;
+        if (!s.empty()) s += " ";
+        s += name;
+    };
+    add(avx512, "avx512");
+    add(avx2, "avx2");
+    add(fma, "fma");
+    add(f16c, "f16c");
+    add(sse42, "sse4.2");
+    add(neon, "neon");
+    return s.empty() ? "none" : s;
+}
+
+const CpuFeatures &cpuFeatures() {
+    static const CpuFeatures features = [] {
+        const char *isa = std::getenv("CVPUZZLE_ISA");
+        return isa ? limitCpuFeatures(detectCpuFeatures(), isa) : detectCpuFeatures();
+    }();
+    return features;
+}
+
+CpuFeatures limitCpuFeatures(CpuFeatures features, const std::string &isa) {
+    const int levels = 5;
+    const char *names[levels] = {"scalar", "sse4.2", "avx2", "avx512", "native"};
+    int level = 0;
+    while (level < levels && isa != names[level]) ++level;
+    rassert(level < levels, 2398147610032, "Unknown instruction set, expected scalar, sse4.2, avx2, avx512 or native", isa);
+    if (level < 3) features.avx512 = false;
+    if (level < 2) features.avx2 = features.fma = features.f16c = false;
+    if (level < 1) features.sse42 = features.neon = false;
+    return features;
+}
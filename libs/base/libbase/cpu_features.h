@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+// Instruction sets available on the current CPU (and enabled by the OS), detected once at first call.
+// Used to pick SIMD kernels at runtime, so that binaries built for generic x86-64 still use AVX2 or AVX-512 when possible.
+struct CpuFeatures {
+    bool sse42 = false;
+    bool avx2 = false;
+    bool avx512 = false; // AVX-512 F, BW and VL with the ZMM state saved by the OS
+    bool fma = false;
+    bool f16c = false; // float <-> half conversions
+    bool neon = false;
+
+    // F.e. "avx512 avx2 fma f16c sse4.2"
+    std::string toString() const;
+};
+
+// The features of the CPU, at most up to the instruction set named by the CVPUZZLE_ISA environment variable if it is set
+// (see limitCpuFeatures), f.e. CVPUZZLE_ISA=avx2 to run the AVX2 kernels on an AVX-512 machine
+const CpuFeatures &cpuFeatures();
+
+// features without the instruction sets above isa: "scalar" (none of them), "sse4.2", "avx2" (with fma and f16c),
+// "avx512" or "native" (all). NEON is the baseline of AArch64 and is only turned off by "scalar".
+CpuFeatures limitCpuFeatures(CpuFeatures features, const std::string &isa);
@@ -0,0 +1,36 @@
+#include "cpu_features.h"
+
+#include <gtest/gtest.h>
+
+#include "runtime_assert.h"
+
+#include <iostream>
+
+TEST(cpu_features, detectionIsStable) {
+    const CpuFeatures &a = cpuFeatures();
+    const CpuFeatures &b = cpuFeatures();
+    EXPECT_EQ(&a, &b);
+    EXPECT_FALSE(a.toString().empty());
+    if (a.avx2) EXPECT_TRUE(a.sse42);
+    if (a.avx512) EXPECT_TRUE(a.avx2);
+    std::cout << "cpu features: " << a.toString() << std::endl;
+}
+
+TEST(cpu_features, limitedByInstructionSet) {
+    CpuFeatures all;
+    all.sse42 = all.avx2 = all.avx512 = all.fma = all.f16c = true;
+
+    const CpuFeatures avx2 = limitCpuFeatures(all, "avx2");
+    EXPECT_FALSE(avx2.avx512);
+    EXPECT_TRUE(avx2.avx2 && avx2.fma && avx2.f16c && avx2.sse42);
+
+    const CpuFeatures sse = limitCpuFeatures(all, "sse4.2");
+    EXPECT_FALSE(sse.avx2 || sse.fma || sse.f16c);
+    EXPECT_TRUE(sse.sse42);
+
+    EXPECT_EQ(limitCpuFeatures(all, "scalar").toString(), "none");
+    EXPECT_EQ(limitCpuFeatures(all, "native").toString(), all.toString());
+    EXPECT_EQ(limitCpuFeatures(CpuFeatures(), "avx512").toString(), "none"); // never adds features
+
+    EXPECT_THROW(limitCpuFeatures(all, "avx3"), assertion_error);
+}
@@ -0,0 +1,38 @@
+#include "cycle_timer.h"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+namespace {
+
+double calibrate() {
+#if defined(__aarch64__) && !defined(_MSC_VER)
+    std::uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    if (frequency > 0) return 1.0 / static_cast<double>(frequency);
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) || defined(__aarch64__)
+    // median of a few short windows, so that a preemption between the paired reads of one of them does not skew it
+    using Clock = std::chrono::steady_clock;
+    std::array<double, 5> ratios{};
+    for (double &ratio: ratios) {
+        const Clock::time_point t0 = Clock::now();
+        const std::uint64_t c0 = CycleTimer::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(4));
+        const Clock::time_point t1 = Clock::now();
+        const std::uint64_t c1 = CycleTimer::now();
+        if (c1 > c0) ratio = std::chrono::duration<double>(t1 - t0).count() / static_cast<double>(c1 - c0);
+    }
+    std::sort(ratios.begin(), ratios.end());
+    if (ratios[ratios.size() / 2] > 0.0) return ratios[ratios.size() / 2];
+#endif
+    return 1e-9; // steady_clock nanoseconds
+}
+
+} // namespace
+
+double CycleTimer::secondsPerTick() {
+    static const double seconds = calibrate();
+    return seconds;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timer for many short samples (f.e. a sample per pair of sides): reads the CPU time stamp counter (rdtsc on x86,
+// cntvct_el0 on ARM64, a few ns instead of ~20 ns of steady_clock), steady_clock nanoseconds elsewhere.
+// Ticks are converted to seconds with secondsPerTick(), calibrated once against steady_clock on x86
+// (assumes an invariant TSC, true for every x86-64 CPU of the last decade) and read from cntfrq_el0 on ARM64.
+//
+// rdtsc is not serializing, so a sample of a few dozen cycles is only approximate;
+// feed the samples to stats::LatencyHistogram (see latency_histogram.h) to aggregate millions of them.
+class CycleTimer final {
+  public:
+    CycleTimer() noexcept : start_(now()) {}
+
+    static std::uint64_t now() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        std::uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // The first call calibrates (~20 ms on x86), thread-safe
+    static double secondsPerTick();
+    static double toSeconds(std::uint64_t ticks) { return static_cast<double>(ticks) * secondsPerTick(); }
+
+    std::uint64_t elapsedTicks() const noexcept { return now() - start_; }
+    // In seconds
+    double elapsed() const { return toSeconds(elapsedTicks()); }
+
+    // Returns ticks before the restart, so that consecutive samples need a single counter read
+    std::uint64_t restart() noexcept {
+        const std::uint64_t t = now();
+        const std::uint64_t ticks = t - start_;
+        start_ = t;
+        return ticks;
+    }
+
+  private:
+    std::uint64_t start_ = 0;
+};
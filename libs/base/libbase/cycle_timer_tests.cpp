@@ -0,0 +1,30 @@
+#include "cycle_timer.h"
+
+#include <gtest/gtest.h>
+
+#include "timer.h"
+
+#include <chrono>
+#include <thread>
+
+TEST(cycle_timer, calibratedAgainstSteadyClock) {
+    const double secondsPerTick = CycleTimer::secondsPerTick();
+    EXPECT_GT(secondsPerTick, 0.0);
+    EXPECT_EQ(CycleTimer::secondsPerTick(), secondsPerTick);
+
+    Timer wall;
+    CycleTimer cycles;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const double measured = cycles.elapsed();
+    const double expected = wall.elapsed();
+    EXPECT_NEAR(measured, expected, 0.1 * expected);
+}
+
+TEST(cycle_timer, restartReturnsTheSample) {
+    CycleTimer outer;
+    CycleTimer t;
+    std::uint64_t total = 0;
+    for (int i = 0; i < 1000; ++i) total += t.restart();
+    // consecutive samples cover the time without gaps or overlaps
+    EXPECT_LE(total, outer.elapsedTicks());
+}
@@ -8,7 +8,7 @@ DisjointSetUnion::DisjointSetUnion(std::size_t n) : parent_(n), sz_(n, 1) {
 }
 
 std::size_t DisjointSetUnion::find(std::size_t x, std::source_location loc) {
-    rassert(x < size(), 2391578193411, x, size(), format_code_location(loc));
+    rassert_debug(x < size(), 2391578193411, x, size(), format_code_location(loc));
     while (parent_[x] != x) {
         parent_[x] = parent_[parent_[x]];
         x = parent_[x];
@@ -17,7 +17,7 @@ std::size_t DisjointSetUnion::find(std::size_t x, std::source_location loc) {
 }
 
 std::size_t DisjointSetUnion::find(std::size_t x, std::source_location loc) const {
-    rassert(x < size(), 2391578193412, x, size(), format_code_location(loc));
+    rassert_debug(x < size(), 2391578193412, x, size(), format_code_location(loc));
     while (parent_[x] != x)
         x = parent_[x];
     return x;
@@ -25,8 +25,8 @@ std::size_t DisjointSetUnion::find(std::size_t x, std::source_location loc) cons
 
 std::pair<std::size_t, std::size_t> DisjointSetUnion::unite_roots(std::size_t ra, std::size_t rb,
                                                                   std::source_location loc) {
-    rassert(ra < size(), 2391578193413, ra, size(), format_code_location(loc));
-    rassert(rb < size(), 2391578193414, rb, size(), format_code_location(loc));
+    rassert_debug(ra < size(), 2391578193413, ra, size(), format_code_location(loc));
+    rassert_debug(rb < size(), 2391578193414, rb, size(), format_code_location(loc));
     if (ra == rb)
         return {ra, ra};
 
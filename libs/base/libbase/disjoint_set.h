@@ -10,6 +10,7 @@ public:
 
     std::size_t size() const noexcept { return parent_.size(); }
 
+    // Out of range elements are checked by rassert_debug (compiled out in release, see libbase/runtime_assert.h)
     std::size_t find(std::size_t x, std::source_location loc = std::source_location::current());
     std::size_t find(std::size_t x, std::source_location loc = std::source_location::current()) const; // no path compression
 
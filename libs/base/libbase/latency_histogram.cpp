@@ -0,0 +1,103 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace stats {
+
+void LatencyHistogram::merge(const LatencyHistogram &other) noexcept {
+    for (int b = 0; b < buckets_count; ++b) buckets_[b] += other.buckets_[b];
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::clear() noexcept { *this = LatencyHistogram(); }
+
+std::uint64_t LatencyHistogram::min() const {
+    if (count_ == 0)
+        throw std::invalid_argument("LatencyHistogram::min: empty");
+    return min_;
+}
+
+std::uint64_t LatencyHistogram::max() const {
+    if (count_ == 0)
+        throw std::invalid_argument("LatencyHistogram::max: empty");
+    return max_;
+}
+
+std::uint64_t LatencyHistogram::bucketLower(int bucket) noexcept {
+    if (bucket < sub_buckets) return static_cast<std::uint64_t>(bucket);
+    const int shift = bucket / sub_buckets - 1;
+    return static_cast<std::uint64_t>(sub_buckets + bucket % sub_buckets) << shift;
+}
+
+std::uint64_t LatencyHistogram::bucketWidth(int bucket) noexcept {
+    return bucket < sub_buckets ? 1 : std::uint64_t(1) << (bucket / sub_buckets - 1);
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (count_ == 0)
+        throw std::invalid_argument("LatencyHistogram::percentile: empty");
+    if (!(p >= 0.0 && p <= 100.0))
+        throw std::invalid_argument("LatencyHistogram::percentile: p out of range [0,100]");
+
+    if (p <= 0.0)
+        return static_cast<double>(min_);
+    if (p >= 100.0)
+        return static_cast<double>(max_);
+
+    // Same rank convention as stats::percentile: interpolation between values of ranks floor(pos) and ceil(pos)
+    const double pos = p / 100.0 * static_cast<double>(count_ - 1);
+    const std::size_t i = static_cast<std::size_t>(std::floor(pos));
+    const std::size_t j = std::min(count_ - 1, static_cast<std::size_t>(std::ceil(pos)));
+    const double a = valueOfRank(i);
+    if (j == i)
+        return a;
+    const double b = valueOfRank(j);
+    return a + (pos - static_cast<double>(i)) * (b - a);
+}
+
+std::vector<double> LatencyHistogram::quantiles(std::initializer_list<double> ps) const {
+    std::vector<double> result;
+    result.reserve(ps.size());
+    for (double p: ps) result.push_back(percentile(p));
+    return result;
+}
+
+double LatencyHistogram::valueOfRank(std::size_t rank) const {
+    // k values of a bucket are assumed to be spread uniformly: value number m is at (m + 0.5) / k of its width,
+    // buckets of a single value are exact
+    std::size_t below = 0;
+    for (int b = 0; b < buckets_count; ++b) {
+        if (below + buckets_[b] > rank) {
+            const std::uint64_t width = bucketWidth(b);
+            if (width == 1) return static_cast<double>(bucketLower(b));
+            const double fraction = (static_cast<double>(rank - below) + 0.5) / static_cast<double>(buckets_[b]);
+            const double value = static_cast<double>(bucketLower(b)) + static_cast<double>(width) * fraction;
+            return std::clamp(value, static_cast<double>(min_), static_cast<double>(max_));
+        }
+        below += buckets_[b];
+    }
+    return static_cast<double>(max_);
+}
+
+std::string LatencyHistogram::summary(double scale, int decimals) const {
+    std::ostringstream oss;
+    oss << count_ << " values - ";
+    if (count_ == 0) {
+        oss << "(empty)";
+        return oss.str();
+    }
+    oss.setf(std::ios::fixed);
+    oss << std::setprecision(decimals);
+    oss << "(min=" << static_cast<double>(min_) * scale << " 10%=" << percentile(10.0) * scale
+        << " median=" << percentile(50.0) * scale << " 90%=" << percentile(90.0) * scale
+        << " max=" << static_cast<double>(max_) * scale << ")";
+    return oss.str();
+}
+
+} // namespace stats
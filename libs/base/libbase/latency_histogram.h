@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace stats {
+
+// Fixed-bucket log-scale histogram of non-negative integer samples (f.e. CycleTimer ticks or nanoseconds):
+// values below 2^sub_bucket_bits have a bucket each, every next power of two is split into 2^sub_bucket_bits
+// buckets of equal width, so that quantiles are within 1/2^sub_bucket_bits (~3%) of the true value over the whole
+// uint64 range. add() is a bit scan and an increment into a fixed array (no allocations), so millions of samples per
+// run are cheap; histograms filled in different threads are merged by adding the buckets.
+class LatencyHistogram final {
+  public:
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr int sub_buckets = 1 << sub_bucket_bits;
+    static constexpr int buckets_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    void add(std::uint64_t value) noexcept {
+        ++buckets_[bucketOf(value)];
+        ++count_;
+        if (value < min_) min_ = value;
+        if (value > max_) max_ = value;
+    }
+
+    void merge(const LatencyHistogram &other) noexcept;
+    void clear() noexcept;
+
+    std::size_t count() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+
+    // Exact. Throw std::invalid_argument if empty
+    std::uint64_t min() const;
+    std::uint64_t max() const;
+
+    // p in [0, 100], the same rank convention as stats::percentile, within a bucket width of the true value
+    // (p = 0 and p = 100 are exact min and max). Throws std::invalid_argument if empty or p out of range.
+    double percentile(double p) const;
+    std::vector<double> quantiles(std::initializer_list<double> ps) const;
+
+    // "N values - (min=... 10%=... median=... 90%=... max=...)" in the format of stats::summaryStats,
+    // values multiplied by scale (f.e. CycleTimer::secondsPerTick() * 1e6 for microseconds)
+    std::string summary(double scale = 1.0, int decimals = 2) const;
+
+    // Bucket of value and the range [lower, lower + width) of a bucket
+    static int bucketOf(std::uint64_t value) noexcept {
+        if (value < static_cast<std::uint64_t>(sub_buckets)) return static_cast<int>(value);
+        const int shift = static_cast<int>(std::bit_width(value)) - 1 - sub_bucket_bits;
+        return (shift + 1) * sub_buckets + static_cast<int>((value >> shift) - sub_buckets);
+    }
+    static std::uint64_t bucketLower(int bucket) noexcept;
+    static std::uint64_t bucketWidth(int bucket) noexcept;
+
+  private:
+    // Estimated value of given rank in sorted order
+    double valueOfRank(std::size_t rank) const;
+
+    std::array<std::uint64_t, buckets_count> buckets_{};
+    std::size_t count_ = 0;
+    std::uint64_t min_ = UINT64_MAX;
+    std::uint64_t max_ = 0;
+};
+
+} // namespace stats
@@ -0,0 +1,69 @@
+#include "latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include "fast_random.h"
+#include "stats.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST(latency_histogram, bucketsCoverTheRange) {
+    using H = stats::LatencyHistogram;
+    for (std::uint64_t v = 0; v < 5000; ++v) {
+        const int b = H::bucketOf(v);
+        EXPECT_LE(H::bucketLower(b), v);
+        EXPECT_LT(v, H::bucketLower(b) + H::bucketWidth(b));
+    }
+    EXPECT_EQ(H::bucketOf(UINT64_MAX), H::buckets_count - 1);
+    for (int b = 0; b + 1 < H::buckets_count; ++b) EXPECT_EQ(H::bucketLower(b) + H::bucketWidth(b), H::bucketLower(b + 1));
+    // relative width of a bucket is at most 1 / sub_buckets
+    for (int b = H::sub_buckets; b < H::buckets_count; ++b) {
+        EXPECT_LE(static_cast<double>(H::bucketWidth(b)) / static_cast<double>(H::bucketLower(b)), 1.0 / H::sub_buckets);
+    }
+}
+
+TEST(latency_histogram, smallValuesAreExact) {
+    stats::LatencyHistogram h;
+    std::vector<int> values;
+    for (int v: {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5}) {
+        h.add(static_cast<std::uint64_t>(v));
+        values.push_back(v);
+    }
+    EXPECT_EQ(h.count(), values.size());
+    EXPECT_EQ(h.min(), 1u);
+    EXPECT_EQ(h.max(), 9u);
+    for (double p: {0.0, 10.0, 25.0, 50.0, 90.0, 100.0}) EXPECT_DOUBLE_EQ(h.percentile(p), stats::percentile(values, p)) << p;
+    EXPECT_EQ(h.summary(1.0, 2), stats::summaryStats(std::vector<double>(values.begin(), values.end()), 2));
+}
+
+TEST(latency_histogram, quantilesOfManySamplesAreClose) {
+    FastRandom r(239);
+    stats::LatencyHistogram a;
+    stats::LatencyHistogram b;
+    std::vector<double> values;
+    for (int i = 0; i < 1000000; ++i) {
+        // log-uniform over ~6 orders of magnitude, like latencies
+        const std::uint64_t v = static_cast<std::uint64_t>(std::exp(r.nextFloat() * 14.0f)) + 10;
+        (i % 2 ? a : b).add(v);
+        values.push_back(static_cast<double>(v));
+    }
+    a.merge(b);
+    EXPECT_EQ(a.count(), values.size());
+    const std::vector<double> expected = stats::quantiles(values, {1.0, 10.0, 50.0, 90.0, 99.0, 99.9});
+    const std::vector<double> actual = a.quantiles({1.0, 10.0, 50.0, 90.0, 99.0, 99.9});
+    for (std::size_t k = 0; k < expected.size(); ++k) EXPECT_NEAR(actual[k], expected[k], expected[k] / 32.0) << k;
+    EXPECT_EQ(a.percentile(100.0), stats::maxValue(values));
+}
+
+TEST(latency_histogram, emptyThrows) {
+    stats::LatencyHistogram h;
+    EXPECT_THROW(h.percentile(50.0), std::invalid_argument);
+    EXPECT_THROW(h.min(), std::invalid_argument);
+    EXPECT_EQ(h.summary(), "0 values - (empty)");
+    h.add(7);
+    EXPECT_THROW(h.percentile(101.0), std::invalid_argument);
+    h.clear();
+    EXPECT_TRUE(h.empty());
+}
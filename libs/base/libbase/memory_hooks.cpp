@@ -0,0 +1,72 @@
+// Replacement of the global operator new/delete that counts every allocation as memory::heap (see memory_tracker.h).
+// Linked only into executables that opt in via libbase_memory_hooks (see CMake of libbase).
+// Sizes are taken from malloc_usable_size, so that unsized delete is counted exactly like its new.
+
+#include "memory_tracker.h"
+
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+
+void *allocate(std::size_t bytes, std::size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    while (true) {
+        void *data = nullptr;
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            data = std::malloc(bytes);
+        } else if (posix_memalign(&data, alignment, bytes) != 0) {
+            data = nullptr;
+        }
+        if (data) {
+            memory::allocated(memory::heap, malloc_usable_size(data));
+            return data;
+        }
+        const std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *allocateNoThrow(std::size_t bytes, std::size_t alignment) noexcept {
+    try {
+        return allocate(bytes, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void release(void *data) noexcept {
+    if (!data) return;
+    memory::freed(memory::heap, malloc_usable_size(data));
+    std::free(data);
+}
+
+} // namespace
+
+void *operator new(std::size_t bytes) { return allocate(bytes, 0); }
+void *operator new[](std::size_t bytes) { return allocate(bytes, 0); }
+void *operator new(std::size_t bytes, std::align_val_t alignment) { return allocate(bytes, static_cast<std::size_t>(alignment)); }
+void *operator new[](std::size_t bytes, std::align_val_t alignment) { return allocate(bytes, static_cast<std::size_t>(alignment)); }
+void *operator new(std::size_t bytes, const std::nothrow_t &) noexcept { return allocateNoThrow(bytes, 0); }
+void *operator new[](std::size_t bytes, const std::nothrow_t &) noexcept { return allocateNoThrow(bytes, 0); }
+void *operator new(std::size_t bytes, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocateNoThrow(bytes, static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t bytes, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocateNoThrow(bytes, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *data) noexcept { release(data); }
+void operator delete[](void *data) noexcept { release(data); }
+void operator delete(void *data, std::size_t) noexcept { release(data); }
+void operator delete[](void *data, std::size_t) noexcept { release(data); }
+void operator delete(void *data, std::align_val_t) noexcept { release(data); }
+void operator delete[](void *data, std::align_val_t) noexcept { release(data); }
+void operator delete(void *data, std::size_t, std::align_val_t) noexcept { release(data); }
+void operator delete[](void *data, std::size_t, std::align_val_t) noexcept { release(data); }
+void operator delete(void *data, const std::nothrow_t &) noexcept { release(data); }
+void operator delete[](void *data, const std::nothrow_t &) noexcept { release(data); }
+void operator delete(void *data, std::align_val_t, const std::nothrow_t &) noexcept { release(data); }
+void operator delete[](void *data, std::align_val_t, const std::nothrow_t &) noexcept { release(data); }
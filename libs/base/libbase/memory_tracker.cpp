@@ -0,0 +1,110 @@
+#include "memory_tracker.h"
+
+#include "runtime_assert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace memory {
+
+namespace {
+
+// Constant-initialized, since operator new may be called before any dynamic initialization
+struct Category final {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<std::int64_t> live{0};
+    std::atomic<std::int64_t> peak{0};
+    std::atomic<std::uint64_t> allocations{0};
+};
+
+constinit Category categories[max_categories];
+constinit std::atomic<int> categoriesCount{1}; // heap is always there
+constinit thread_local ThreadCounters thread;
+
+std::mutex &registration() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+const char *nameOf(int id) { return id == heap ? "heap" : categories[id].name.load(std::memory_order_acquire); }
+
+} // namespace
+
+int category(const char *name) {
+    rassert(name != nullptr, 52310740001);
+    if (std::strcmp(name, "heap") == 0) return heap;
+    std::lock_guard lock(registration());
+    const int count = categoriesCount.load(std::memory_order_relaxed);
+    for (int id = 1; id < count; ++id) {
+        if (std::strcmp(categories[id].name.load(std::memory_order_relaxed), name) == 0) return id;
+    }
+    rassert(count < max_categories, 52310740002, "Too many memory categories", name);
+    categories[count].name.store(name, std::memory_order_release);
+    categoriesCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void allocated(int category, std::size_t bytes) noexcept {
+    Category &c = categories[category];
+    const std::int64_t n = static_cast<std::int64_t>(bytes);
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::int64_t live = c.live.fetch_add(n, std::memory_order_relaxed) + n;
+    std::int64_t peak = c.peak.load(std::memory_order_relaxed);
+    while (live > peak && !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+    if (category != heap) return;
+    ++thread.allocations;
+    thread.liveBytes += n;
+    thread.peakBytes = std::max(thread.peakBytes, thread.liveBytes);
+}
+
+void freed(int category, std::size_t bytes) noexcept {
+    const std::int64_t n = static_cast<std::int64_t>(bytes);
+    categories[category].live.fetch_sub(n, std::memory_order_relaxed);
+    if (category == heap) thread.liveBytes -= n;
+}
+
+Counters counters(int category) noexcept {
+    const Category &c = categories[category];
+    Counters result;
+    result.liveBytes = c.live.load(std::memory_order_relaxed);
+    result.peakBytes = c.peak.load(std::memory_order_relaxed);
+    result.allocations = c.allocations.load(std::memory_order_relaxed);
+    return result;
+}
+
+void resetPeaks() noexcept {
+    for (Category &c: categories) c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+std::vector<CategorySummary> summarize() {
+    std::vector<CategorySummary> result;
+    const int count = categoriesCount.load(std::memory_order_acquire);
+    for (int id = 0; id < count; ++id) {
+        const Counters c = counters(id);
+        if (c.allocations > 0) result.push_back({nameOf(id), c});
+    }
+    return result;
+}
+
+std::string summary() {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << std::left << std::setw(12) << "memory" << std::right << std::setw(14) << "allocations" << std::setw(12) << "live MB"
+        << std::setw(12) << "peak MB" << "\n";
+    for (const CategorySummary &s: summarize()) {
+        out << std::left << std::setw(12) << s.name << std::right << std::setw(14) << s.counters.allocations << std::setw(12)
+            << s.counters.liveBytes / 1048576.0 << std::setw(12) << s.counters.peakBytes / 1048576.0 << "\n";
+    }
+    return out.str();
+}
+
+ThreadCounters threadCounters() noexcept { return thread; }
+
+void setThreadPeak(std::int64_t peakBytes) noexcept { thread.peakBytes = peakBytes; }
+
+} // namespace memory
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Process-wide counters of allocated memory per category: bytes live right now, their peak and the number of
+// allocations. Category 0 is "heap" - every operator new/delete, counted only in executables that link
+// libbase_memory_hooks (see CMake of libbase), other categories are registered by their owners
+// (f.e. Image<T> buffers of libimages count as "image8u", "image32i" and "image32f").
+//
+// Heap allocations are also counted per thread, so that the profiler (see profiler.h) attributes allocation count,
+// peak and still live bytes to zones. Counters are relaxed atomics and allocate nothing themselves.
+namespace memory {
+
+constexpr int heap = 0;
+constexpr int max_categories = 16;
+
+struct Counters final {
+    std::int64_t liveBytes = 0;
+    std::int64_t peakBytes = 0;   // of liveBytes since the start (or since resetPeaks)
+    std::uint64_t allocations = 0;
+};
+
+// Id of the category name (must be a string literal or live as long as the process), the same for the same name
+int category(const char *name);
+
+void allocated(int category, std::size_t bytes) noexcept;
+void freed(int category, std::size_t bytes) noexcept;
+
+Counters counters(int category) noexcept;
+// Peaks start over from the bytes live right now (f.e. before the next photo)
+void resetPeaks() noexcept;
+
+struct CategorySummary final {
+    std::string name;
+    Counters counters;
+};
+
+// Categories with at least one allocation in the id order
+std::vector<CategorySummary> summarize();
+
+// Text table of summarize()
+std::string summary();
+
+// Heap allocations of the calling thread: frees count against the thread that frees, so liveBytes may go negative
+struct ThreadCounters final {
+    std::uint64_t allocations = 0;
+    std::int64_t liveBytes = 0;
+    std::int64_t peakBytes = 0;
+};
+ThreadCounters threadCounters() noexcept;
+// Restarts the peak of the thread (the profiler saves it when a zone opens and restores the maximum when it closes)
+void setThreadPeak(std::int64_t peakBytes) noexcept;
+
+} // namespace memory
@@ -0,0 +1,48 @@
+#include "memory_tracker.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+TEST(memory_tracker, categoriesAreRegisteredOnce) {
+    const int a = memory::category("test_a");
+    EXPECT_NE(a, memory::heap);
+    EXPECT_EQ(memory::category("test_a"), a);
+    EXPECT_NE(memory::category("test_b"), a);
+    EXPECT_EQ(memory::category("heap"), memory::heap);
+}
+
+TEST(memory_tracker, liveAndPeakBytes) {
+    const int c = memory::category("test_counts");
+    memory::allocated(c, 100);
+    memory::allocated(c, 50);
+    memory::freed(c, 100);
+    EXPECT_EQ(memory::counters(c).liveBytes, 50);
+    EXPECT_EQ(memory::counters(c).peakBytes, 150);
+    EXPECT_EQ(memory::counters(c).allocations, 2u);
+
+    memory::resetPeaks();
+    EXPECT_EQ(memory::counters(c).peakBytes, 50);
+    memory::freed(c, 50);
+    EXPECT_EQ(memory::counters(c).liveBytes, 0);
+
+    EXPECT_NE(memory::summary().find("test_counts"), std::string::npos);
+}
+
+#if defined(LIBBASE_MEMORY_HOOKS)
+
+TEST(memory_tracker, heapAllocationsAreCounted) {
+    const memory::ThreadCounters before = memory::threadCounters();
+    const std::int64_t liveBefore = memory::counters(memory::heap).liveBytes;
+    auto data = std::make_unique<char[]>(1 << 20);
+    const memory::ThreadCounters during = memory::threadCounters();
+    EXPECT_EQ(during.allocations, before.allocations + 1);
+    EXPECT_GE(during.liveBytes - before.liveBytes, 1 << 20);
+    EXPECT_GE(during.peakBytes, during.liveBytes);
+    EXPECT_GE(memory::counters(memory::heap).peakBytes, liveBefore + (1 << 20));
+
+    data.reset();
+    EXPECT_EQ(memory::threadCounters().liveBytes, before.liveBytes);
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#endif
+
+namespace perf_counters {
+
+Values operator-(const Values &a, const Values &b) noexcept {
+    return {a.cycles - b.cycles, a.instructions - b.instructions, a.llcMisses - b.llcMisses, a.branchMisses - b.branchMisses};
+}
+
+Values &operator+=(Values &a, const Values &b) noexcept {
+    a.cycles += b.cycles;
+    a.instructions += b.instructions;
+    a.llcMisses += b.llcMisses;
+    a.branchMisses += b.branchMisses;
+    return a;
+}
+
+#if defined(__linux__)
+
+namespace {
+
+constexpr int events_count = 4;
+
+// Group of the calling thread, the descriptors are closed when the thread exits
+class ThreadGroup final {
+  public:
+    ThreadGroup() {
+        const std::array<std::uint64_t, events_count> configs = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                                 PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int e = 0; e < events_count; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[e];
+            attr.disabled = e == 0 ? 1 : 0; // the group starts with its leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, e == 0 ? -1 : fds_[0], 0));
+            if (fd < 0) {
+                if (e == 0) return; // without cycles there is nothing to measure
+                continue;
+            }
+            fds_[e] = fd;
+            ioctl(fd, PERF_EVENT_IOC_ID, &ids_[e]);
+        }
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~ThreadGroup() {
+        for (int fd: fds_) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    ThreadGroup(const ThreadGroup &) = delete;
+    ThreadGroup &operator=(const ThreadGroup &) = delete;
+
+    bool opened() const noexcept { return fds_[0] >= 0; }
+
+    bool read(Values &values) const noexcept {
+        values = {};
+        if (!opened()) return false;
+        // nr, time_enabled, time_running, then {value, id} per opened event
+        std::array<std::uint64_t, 3 + 2 * events_count> buffer{};
+        if (::read(fds_[0], buffer.data(), sizeof(buffer)) <= 0) return false;
+        const std::uint64_t n = buffer[0];
+        const double scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 0.0;
+        std::array<std::uint64_t, events_count> byEvent{};
+        for (std::uint64_t k = 0; k < n && k < events_count; ++k) {
+            for (int e = 0; e < events_count; ++e) {
+                if (fds_[e] >= 0 && ids_[e] == buffer[4 + 2 * k]) {
+                    byEvent[e] = static_cast<std::uint64_t>(static_cast<double>(buffer[3 + 2 * k]) * scale);
+                }
+            }
+        }
+        values = {byEvent[0], byEvent[1], byEvent[2], byEvent[3]};
+        return true;
+    }
+
+  private:
+    std::array<int, events_count> fds_ = {-1, -1, -1, -1};
+    std::array<std::uint64_t, events_count> ids_{};
+};
+
+const ThreadGroup &threadGroup() {
+    thread_local ThreadGroup group;
+    return group;
+}
+
+} // namespace
+
+bool read(Values &values) noexcept { return threadGroup().read(values); }
+
+bool available() noexcept { return threadGroup().opened(); }
+
+#else
+
+bool read(Values &values) noexcept {
+    values = {};
+    return false;
+}
+
+bool available() noexcept { return false; }
+
+#endif
+
+double ipc(const Values &values) noexcept {
+    return values.cycles > 0 ? static_cast<double>(values.instructions) / static_cast<double>(values.cycles) : 0.0;
+}
+
+double llcMissesPerKiloInstruction(const Values &values) noexcept {
+    return values.instructions > 0 ? 1000.0 * static_cast<double>(values.llcMisses) / static_cast<double>(values.instructions) : 0.0;
+}
+
+double branchMissesPerKiloInstruction(const Values &values) noexcept {
+    return values.instructions > 0 ? 1000.0 * static_cast<double>(values.branchMisses) / static_cast<double>(values.instructions)
+                                   : 0.0;
+}
+
+} // namespace perf_counters
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// Hardware performance counters of the calling thread (user space only): cycles, instructions, last level cache
+// misses and branch misses. On Linux they are a perf_event_open group opened on the first read in every thread,
+// elsewhere (and when the kernel refuses - no PMU in a VM, perf_event_paranoid, seccomp) reads report unavailable.
+// When the kernel multiplexes counters, values are scaled by the time they were actually running.
+//
+// The profiler reads them when a zone opens and closes (see profiler::setHardwareCounters).
+namespace perf_counters {
+
+struct Values final {
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t llcMisses = 0;
+    std::uint64_t branchMisses = 0;
+};
+
+Values operator-(const Values &a, const Values &b) noexcept;
+Values &operator+=(Values &a, const Values &b) noexcept;
+
+// Counters of the calling thread since they were opened, false (and zeros) if unavailable.
+// Counters the CPU lacks (f.e. LLC misses on some hypervisors) stay zero.
+bool read(Values &values) noexcept;
+
+// Whether the calling thread has the counters (opens them if needed)
+bool available() noexcept;
+
+// Instructions per cycle, 0 without cycles
+double ipc(const Values &values) noexcept;
+// Misses per 1000 instructions, 0 without instructions
+double llcMissesPerKiloInstruction(const Values &values) noexcept;
+double branchMissesPerKiloInstruction(const Values &values) noexcept;
+
+} // namespace perf_counters
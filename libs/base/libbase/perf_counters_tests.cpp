@@ -0,0 +1,77 @@
+#include "perf_counters.h"
+
+#include <gtest/gtest.h>
+
+#include "profiler.h"
+
+#include <cstdint>
+
+namespace {
+
+std::uint64_t busyLoop(int n) {
+    volatile std::uint64_t sum = 0;
+    for (int i = 0; i < n; ++i) sum = sum + static_cast<std::uint64_t>(i) * 3;
+    return sum;
+}
+
+} // namespace
+
+TEST(perf_counters, valuesArithmetic) {
+    perf_counters::Values a{100, 250, 5, 7};
+    const perf_counters::Values b{40, 50, 1, 2};
+    const perf_counters::Values d = a - b;
+    EXPECT_EQ(d.cycles, 60u);
+    EXPECT_EQ(d.instructions, 200u);
+    EXPECT_EQ(d.llcMisses, 4u);
+    EXPECT_EQ(d.branchMisses, 5u);
+    a += b;
+    EXPECT_EQ(a.cycles, 140u);
+    EXPECT_DOUBLE_EQ(perf_counters::ipc(d), 200.0 / 60.0);
+    EXPECT_DOUBLE_EQ(perf_counters::llcMissesPerKiloInstruction(d), 20.0);
+    EXPECT_DOUBLE_EQ(perf_counters::branchMissesPerKiloInstruction(d), 25.0);
+    EXPECT_EQ(perf_counters::ipc({}), 0.0);
+    EXPECT_EQ(perf_counters::llcMissesPerKiloInstruction({}), 0.0);
+}
+
+TEST(perf_counters, readMatchesAvailability) {
+    perf_counters::Values before;
+    const bool ok = perf_counters::read(before);
+    EXPECT_EQ(ok, perf_counters::available());
+    busyLoop(1000000);
+    perf_counters::Values after;
+    EXPECT_EQ(perf_counters::read(after), ok);
+    if (ok) {
+        EXPECT_GT(after.cycles, before.cycles);
+        EXPECT_GT(after.instructions, before.instructions + 1000000);
+    } else {
+        EXPECT_EQ(after.cycles, 0u);
+        EXPECT_EQ(after.instructions, 0u);
+    }
+}
+
+#if defined(LIBBASE_PROFILER)
+
+TEST(perf_counters, profilerZonesSumCounters) {
+    profiler::reset();
+    profiler::setEnabled(true);
+    profiler::setHardwareCounters(true);
+    for (int i = 0; i < 2; ++i) {
+        PROFILE_SCOPE("counted");
+        busyLoop(100000);
+    }
+    profiler::setHardwareCounters(false);
+    profiler::setEnabled(false);
+
+    const std::vector<profiler::ZoneSummary> zones = profiler::summarize();
+    ASSERT_EQ(zones.size(), 1u);
+    if (perf_counters::available()) {
+        EXPECT_GT(zones[0].counters.cycles, 0u);
+        EXPECT_GT(zones[0].counters.instructions, 200000u);
+        EXPECT_NE(profiler::summary().find("IPC"), std::string::npos);
+    } else {
+        EXPECT_EQ(zones[0].counters.cycles, 0u);
+        EXPECT_EQ(profiler::summary().find("IPC"), std::string::npos);
+    }
+}
+
+#endif
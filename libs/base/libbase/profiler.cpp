@@ -0,0 +1,319 @@
+#include "profiler.h"
+
+#include "memory_tracker.h"
+#include "runtime_assert.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+namespace profiler {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t no_zone = std::numeric_limits<std::uint32_t>::max();
+
+struct Event final {
+    std::uint32_t zone = 0;
+    Clock::time_point start;
+    Clock::duration duration{};
+    std::uint64_t allocations = 0;
+    std::int64_t peakBytes = 0;
+    std::int64_t liveBytes = 0;
+    perf_counters::Values counters;
+};
+
+// Events of one thread, outlives the thread (the registry holds it too)
+struct ThreadBuffer final {
+    int tid = 0;
+    std::mutex mutex; // uncontended except while summarizing
+    std::vector<Event> events;
+};
+
+// Zones by path, ids are never reused (threads cache them)
+struct ZoneTable final {
+    std::mutex mutex;
+    std::vector<std::string> paths;
+    std::vector<std::string> names;
+    std::vector<std::uint32_t> parents;
+    std::vector<int> depths;
+    std::unordered_map<std::string, std::uint32_t> byPath;
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+ZoneTable &table() {
+    static ZoneTable instance;
+    return instance;
+}
+
+std::atomic<bool> enabled_{false};
+std::atomic<bool> hardwareCounters_{false};
+
+struct ThreadState final {
+    std::shared_ptr<ThreadBuffer> buffer;
+    std::vector<std::uint32_t> stack;
+    std::map<std::pair<std::uint32_t, const char *>, std::uint32_t> children; // (parent, name) -> zone
+};
+
+ThreadState &threadState() {
+    thread_local ThreadState state;
+    if (!state.buffer) {
+        ZoneTable &t = table();
+        std::lock_guard lock(t.mutex);
+        state.buffer = std::make_shared<ThreadBuffer>();
+        state.buffer->tid = static_cast<int>(t.buffers.size());
+        t.buffers.push_back(state.buffer);
+    }
+    return state;
+}
+
+std::uint32_t zoneOf(ThreadState &state, const char *name) {
+    const std::uint32_t parent = state.stack.empty() ? no_zone : state.stack.back();
+    const auto key = std::make_pair(parent, name);
+    const auto cached = state.children.find(key);
+    if (cached != state.children.end()) return cached->second;
+
+    ZoneTable &t = table();
+    std::lock_guard lock(t.mutex);
+    const std::string path = parent == no_zone ? std::string(name) : t.paths[parent] + "/" + name;
+    auto [it, inserted] = t.byPath.try_emplace(path, static_cast<std::uint32_t>(t.paths.size()));
+    if (inserted) {
+        t.paths.push_back(path);
+        t.names.push_back(name);
+        t.parents.push_back(parent);
+        t.depths.push_back(parent == no_zone ? 0 : t.depths[parent] + 1);
+    }
+    state.children.emplace(key, it->second);
+    return it->second;
+}
+
+std::string escapeJson(const std::string &s) {
+    std::string out;
+    for (char ch: s) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            std::ostringstream code;
+            code << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(ch);
+            out += code.str();
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+void setEnabled(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+
+bool enabled() noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+void setHardwareCounters(bool enabled) noexcept { hardwareCounters_.store(enabled, std::memory_order_relaxed); }
+
+bool hardwareCounters() noexcept { return hardwareCounters_.load(std::memory_order_relaxed); }
+
+void reset() {
+    ZoneTable &t = table();
+    std::lock_guard lock(t.mutex);
+    for (const std::shared_ptr<ThreadBuffer> &buffer: t.buffers) {
+        std::lock_guard bufferLock(buffer->mutex);
+        buffer->events.clear();
+    }
+}
+
+ScopedTimer::ScopedTimer(const char *name) {
+    if (!enabled()) return;
+    ThreadState &state = threadState();
+    state.stack.push_back(zoneOf(state, name));
+    active_ = true;
+    const memory::ThreadCounters counters = memory::threadCounters();
+    startAllocations_ = counters.allocations;
+    startLiveBytes_ = counters.liveBytes;
+    outerPeakBytes_ = counters.peakBytes;
+    memory::setThreadPeak(counters.liveBytes);
+    counted_ = hardwareCounters() && perf_counters::read(startCounters_);
+    start_ = Clock::now();
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (!active_) return;
+    const Clock::time_point end = Clock::now();
+    perf_counters::Values hardware;
+    if (counted_ && perf_counters::read(hardware)) hardware = hardware - startCounters_;
+    const memory::ThreadCounters counters = memory::threadCounters();
+    memory::setThreadPeak(std::max(outerPeakBytes_, counters.peakBytes));
+    ThreadState &state = threadState();
+    const std::uint32_t zone = state.stack.back();
+    state.stack.pop_back();
+    std::lock_guard lock(state.buffer->mutex);
+    state.buffer->events.push_back({zone, start_, end - start_, counters.allocations - startAllocations_,
+                                    counters.peakBytes - startLiveBytes_, counters.liveBytes - startLiveBytes_, hardware});
+}
+
+std::vector<ZoneSummary> summarize() {
+    ZoneTable &t = table();
+    std::lock_guard lock(t.mutex);
+    const std::size_t n = t.paths.size();
+    std::vector<std::vector<double>> seconds(n);
+    std::vector<std::vector<int>> tids(n);
+    std::vector<Clock::time_point> firstStart(n, Clock::time_point::max());
+    std::vector<ZoneSummary> memory(n);
+    for (const std::shared_ptr<ThreadBuffer> &buffer: t.buffers) {
+        std::lock_guard bufferLock(buffer->mutex);
+        for (const Event &event: buffer->events) {
+            seconds[event.zone].push_back(std::chrono::duration<double>(event.duration).count());
+            memory[event.zone].allocations += event.allocations;
+            memory[event.zone].peakBytes = std::max(memory[event.zone].peakBytes, event.peakBytes);
+            memory[event.zone].liveBytes += event.liveBytes;
+            memory[event.zone].counters += event.counters;
+            if (tids[event.zone].empty() || tids[event.zone].back() != buffer->tid) tids[event.zone].push_back(buffer->tid);
+            firstStart[event.zone] = std::min(firstStart[event.zone], event.start);
+        }
+    }
+
+    // tree order: depth-first from the roots, siblings by their first start;
+    // a zone without events of its own is kept if a descendant has some (f.e. it was open during reset)
+    std::vector<bool> used(n);
+    for (std::uint32_t zone = static_cast<std::uint32_t>(n); zone-- > 0;) { // a parent has a smaller id than its children
+        used[zone] = used[zone] || !seconds[zone].empty();
+        if (used[zone] && t.parents[zone] != no_zone) {
+            used[t.parents[zone]] = true;
+            firstStart[t.parents[zone]] = std::min(firstStart[t.parents[zone]], firstStart[zone]);
+        }
+    }
+    std::vector<std::vector<std::uint32_t>> children(n + 1); // children[n] - roots
+    for (std::uint32_t zone = 0; zone < n; ++zone) {
+        if (used[zone]) children[t.parents[zone] == no_zone ? n : t.parents[zone]].push_back(zone);
+    }
+    for (std::vector<std::uint32_t> &siblings: children) {
+        std::stable_sort(siblings.begin(), siblings.end(), [&](std::uint32_t a, std::uint32_t b) { return firstStart[a] < firstStart[b]; });
+    }
+
+    std::vector<ZoneSummary> result;
+    std::vector<std::uint32_t> todo(children[n].rbegin(), children[n].rend());
+    while (!todo.empty()) {
+        const std::uint32_t zone = todo.back();
+        todo.pop_back();
+        const std::vector<double> &values = seconds[zone];
+        ZoneSummary s;
+        s.path = t.paths[zone];
+        s.name = t.names[zone];
+        s.depth = t.depths[zone];
+        s.count = values.size();
+        std::vector<int> zoneTids = tids[zone];
+        std::sort(zoneTids.begin(), zoneTids.end());
+        s.threads = static_cast<int>(std::unique(zoneTids.begin(), zoneTids.end()) - zoneTids.begin());
+        if (!values.empty()) {
+            s.totalSeconds = stats::sum(values);
+            s.minSeconds = stats::minValue(values);
+            s.maxSeconds = stats::maxValue(values);
+            const std::vector<double> q = stats::quantiles(std::span<const double>(values), {50.0, 90.0});
+            s.medianSeconds = q[0];
+            s.p90Seconds = q[1];
+        }
+        s.allocations = memory[zone].allocations;
+        s.peakBytes = memory[zone].peakBytes;
+        s.liveBytes = memory[zone].liveBytes;
+        s.counters = memory[zone].counters;
+        result.push_back(std::move(s));
+        todo.insert(todo.end(), children[zone].rbegin(), children[zone].rend());
+    }
+    return result;
+}
+
+std::string summary() {
+    const std::vector<ZoneSummary> zones = summarize();
+    std::size_t nameWidth = 4;
+    bool withMemory = false;
+    bool withCounters = false;
+    for (const ZoneSummary &zone: zones) {
+        nameWidth = std::max(nameWidth, 2 * zone.depth + zone.name.size());
+        withMemory = withMemory || zone.allocations > 0;
+        withCounters = withCounters || zone.counters.cycles > 0;
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << std::left << std::setw(static_cast<int>(nameWidth)) << "zone" << std::right << std::setw(8) << "count"
+        << std::setw(8) << "threads" << std::setw(12) << "total ms" << std::setw(12) << "min ms" << std::setw(12) << "median ms"
+        << std::setw(12) << "p90 ms" << std::setw(12) << "max ms";
+    if (withMemory) out << std::setw(12) << "allocs" << std::setw(12) << "peak MB" << std::setw(12) << "live MB";
+    if (withCounters) out << std::setw(12) << "Mcycles" << std::setw(8) << "IPC" << std::setw(12) << "LLC/Kinstr" << std::setw(12) << "br/Kinstr";
+    out << "\n";
+    for (const ZoneSummary &zone: zones) {
+        out << std::left << std::setw(static_cast<int>(nameWidth)) << (std::string(2 * zone.depth, ' ') + zone.name) << std::right
+            << std::setw(8) << zone.count << std::setw(8) << zone.threads << std::setw(12) << zone.totalSeconds * 1000.0
+            << std::setw(12) << zone.minSeconds * 1000.0 << std::setw(12) << zone.medianSeconds * 1000.0 << std::setw(12)
+            << zone.p90Seconds * 1000.0 << std::setw(12) << zone.maxSeconds * 1000.0;
+        if (withMemory) {
+            out << std::setw(12) << zone.allocations << std::setw(12) << zone.peakBytes / 1048576.0 << std::setw(12)
+                << zone.liveBytes / 1048576.0;
+        }
+        if (withCounters) {
+            out << std::setw(12) << zone.counters.cycles / 1e6 << std::setw(8) << perf_counters::ipc(zone.counters) << std::setw(12)
+                << perf_counters::llcMissesPerKiloInstruction(zone.counters) << std::setw(12)
+                << perf_counters::branchMissesPerKiloInstruction(zone.counters);
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+std::string chromeTrace() {
+    ZoneTable &t = table();
+    std::lock_guard lock(t.mutex);
+    Clock::time_point origin = Clock::time_point::max();
+    for (const std::shared_ptr<ThreadBuffer> &buffer: t.buffers) {
+        std::lock_guard bufferLock(buffer->mutex);
+        for (const Event &event: buffer->events) origin = std::min(origin, event.start);
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const std::shared_ptr<ThreadBuffer> &buffer: t.buffers) {
+        std::lock_guard bufferLock(buffer->mutex);
+        for (const Event &event: buffer->events) {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":\"" << escapeJson(t.names[event.zone]) << "\",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+                << buffer->tid << ",\"ts\":" << std::chrono::duration<double, std::micro>(event.start - origin).count()
+                << ",\"dur\":" << std::chrono::duration<double, std::micro>(event.duration).count() << ",\"args\":{\"path\":\""
+                << escapeJson(t.paths[event.zone]) << "\",\"allocations\":" << event.allocations << ",\"peak_bytes\":" << event.peakBytes
+                << ",\"live_bytes\":" << event.liveBytes;
+            if (event.counters.cycles > 0) {
+                out << ",\"cycles\":" << event.counters.cycles << ",\"instructions\":" << event.counters.instructions
+                    << ",\"llc_misses\":" << event.counters.llcMisses << ",\"branch_misses\":" << event.counters.branchMisses;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+void writeChromeTrace(const std::string &path) {
+    const std::string json = chromeTrace();
+    std::ofstream out(path, std::ios::binary);
+    rassert(out.is_open(), 41820360001, "Failed to open file", path);
+    out << json;
+    rassert(out.good(), 41820360002, "Failed to write file", path);
+}
+
+} // namespace profiler
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+// Hierarchical profiler of scopes: PROFILE_SCOPE("name") measures the rest of the enclosing block as a zone,
+// zones opened inside it (in the same thread) are its children, so every zone is identified by its path -
+// "image/segment/morphology". Every thread has its own stack of zones (a task on a worker thread starts a root
+// of that thread) and its own buffer of events, so threads do not contend while recording.
+//
+// Nothing is recorded until profiler::setEnabled(true) (a relaxed atomic load per zone when disabled),
+// and without LIBBASE_PROFILER (see CMake option of libbase) PROFILE_SCOPE compiles to nothing at all.
+//
+// Zones are aggregated per path across threads and calls (count, total, min/median/p90/max via stats)
+// and can be exported as Chrome trace JSON (chrome://tracing, https://ui.perfetto.dev).
+//
+// With heap allocations counted (see memory_tracker.h) every zone also gets the number of allocations
+// made inside it, their peak above the bytes live when it opened and the bytes still live when it closed -
+// of its own thread only. With profiler::setHardwareCounters(true) zones also sum cycles, instructions, LLC and
+// branch misses of their thread (see perf_counters.h), so that IPC and miss rates are printed per zone.
+namespace profiler {
+
+void setEnabled(bool enabled) noexcept;
+bool enabled() noexcept;
+
+// Reads perf_counters (two syscalls per zone) while enabled, no-op where they are unavailable
+void setHardwareCounters(bool enabled) noexcept;
+bool hardwareCounters() noexcept;
+
+// Drops recorded events (zones open right now are still recorded when they close)
+void reset();
+
+// Measures its lifetime as zone name (must be a string literal or live as long as the profiler)
+class ScopedTimer final {
+  public:
+    explicit ScopedTimer(const char *name);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    bool active_ = false;
+    Clock::time_point start_{};
+    std::uint64_t startAllocations_ = 0;
+    std::int64_t startLiveBytes_ = 0;
+    std::int64_t outerPeakBytes_ = 0; // peak of the thread before the zone, restored with the maximum
+    bool counted_ = false;
+    perf_counters::Values startCounters_;
+};
+
+struct ZoneSummary final {
+    std::string path;   // names from the root, separated by '/'
+    std::string name;   // the last one
+    int depth = 0;      // 0 - root zone
+    std::size_t count = 0;
+    int threads = 0;    // threads the zone was recorded in
+    double totalSeconds = 0.0;
+    double minSeconds = 0.0;
+    double medianSeconds = 0.0;
+    double p90Seconds = 0.0;
+    double maxSeconds = 0.0;
+    std::uint64_t allocations = 0; // heap allocations over all calls
+    std::int64_t peakBytes = 0;    // maximum over the calls of the heap peak above the zone start
+    std::int64_t liveBytes = 0;    // heap bytes allocated and not freed by the end of the zone, summed over the calls
+    perf_counters::Values counters; // summed over the calls, zeros without hardware counters
+};
+
+// Aggregated zones in the tree order (a zone is followed by its children, siblings in the order they first started).
+// Should be called when other threads do not record zones (f.e. after the parallel stage).
+std::vector<ZoneSummary> summarize();
+
+// Text table of summarize(): a line per zone indented by depth (with the memory columns if heap allocations were counted
+// and IPC, LLC and branch misses per 1000 instructions if hardware counters were read)
+std::string summary();
+
+// Chrome trace JSON ("X" events with microsecond timestamps since the first event, a tid per thread)
+std::string chromeTrace();
+void writeChromeTrace(const std::string &path);
+
+} // namespace profiler
+
+#if defined(LIBBASE_PROFILER)
+#define LIBBASE_PROFILER_CONCAT_IMPL(a, b) a##b
+#define LIBBASE_PROFILER_CONCAT(a, b) LIBBASE_PROFILER_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ::profiler::ScopedTimer LIBBASE_PROFILER_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,161 @@
+#include "profiler.h"
+
+#include <gtest/gtest.h>
+
+#include "task_scheduler.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+const profiler::ZoneSummary *findZone(const std::vector<profiler::ZoneSummary> &zones, const std::string &path) {
+    for (const profiler::ZoneSummary &zone: zones) {
+        if (zone.path == path) return &zone;
+    }
+    return nullptr;
+}
+
+void leaf() {
+    PROFILE_SCOPE("leaf");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+} // namespace
+
+#if defined(LIBBASE_PROFILER)
+
+TEST(profiler, nestedZonesAreAggregatedByPath) {
+    profiler::reset();
+    profiler::setEnabled(true);
+    for (int i = 0; i < 3; ++i) {
+        PROFILE_SCOPE("outer");
+        leaf();
+        leaf();
+        {
+            PROFILE_SCOPE("inner");
+            leaf();
+        }
+    }
+    leaf();
+    profiler::setEnabled(false);
+
+    const std::vector<profiler::ZoneSummary> zones = profiler::summarize();
+    ASSERT_EQ(zones.size(), 5u);
+    // tree order: a zone is followed by its children, siblings by their first start
+    EXPECT_EQ(zones[0].path, "outer");
+    EXPECT_EQ(zones[1].path, "outer/leaf");
+    EXPECT_EQ(zones[2].path, "outer/inner");
+    EXPECT_EQ(zones[3].path, "outer/inner/leaf");
+    EXPECT_EQ(zones[4].path, "leaf");
+    EXPECT_EQ(zones[3].depth, 2);
+    EXPECT_EQ(zones[3].name, "leaf");
+
+    EXPECT_EQ(zones[0].count, 3u);
+    EXPECT_EQ(zones[1].count, 6u);
+    EXPECT_EQ(zones[3].count, 3u);
+    EXPECT_EQ(zones[4].count, 1u);
+    for (const profiler::ZoneSummary &zone: zones) {
+        EXPECT_EQ(zone.threads, 1);
+        EXPECT_LE(zone.minSeconds, zone.medianSeconds);
+        EXPECT_LE(zone.medianSeconds, zone.p90Seconds);
+        EXPECT_LE(zone.p90Seconds, zone.maxSeconds);
+        EXPECT_GE(zone.minSeconds, 0.001);
+    }
+    EXPECT_GE(zones[0].totalSeconds, zones[1].totalSeconds + zones[2].totalSeconds);
+
+    const std::string text = profiler::summary();
+    EXPECT_NE(text.find("    leaf"), std::string::npos);
+}
+
+TEST(profiler, threadsHaveTheirOwnStacks) {
+    profiler::reset();
+    profiler::setEnabled(true);
+    {
+        PROFILE_SCOPE("main");
+        std::thread a([] { leaf(); });
+        std::thread b([] {
+            PROFILE_SCOPE("task");
+            leaf();
+        });
+        a.join();
+        b.join();
+    }
+    parallelForEach(0, 16, [](int) { leaf(); });
+    profiler::setEnabled(false);
+
+    const std::vector<profiler::ZoneSummary> zones = profiler::summarize();
+    ASSERT_NE(findZone(zones, "main"), nullptr);
+    EXPECT_EQ(findZone(zones, "main/leaf"), nullptr);
+    ASSERT_NE(findZone(zones, "task/leaf"), nullptr);
+    const profiler::ZoneSummary *roots = findZone(zones, "leaf");
+    ASSERT_NE(roots, nullptr);
+    EXPECT_GE(roots->count, 2u);
+    EXPECT_GE(roots->threads, 1);
+}
+
+TEST(profiler, chromeTraceHasAnEventPerZone) {
+    profiler::reset();
+    profiler::setEnabled(true);
+    {
+        PROFILE_SCOPE("quote\"d");
+        leaf();
+    }
+    profiler::setEnabled(false);
+
+    const std::string json = profiler::chromeTrace();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find("\"name\":\"quote\\\"d\""), std::string::npos);
+    EXPECT_NE(json.find("\"path\":\"quote\\\"d/leaf\""), std::string::npos);
+    std::size_t events = 0;
+    for (std::size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1)) ++events;
+    EXPECT_EQ(events, 2u);
+}
+
+#if defined(LIBBASE_MEMORY_HOOKS)
+
+TEST(profiler, zonesCountHeapAllocations) {
+    profiler::reset();
+    profiler::setEnabled(true);
+    std::unique_ptr<char[]> kept;
+    {
+        PROFILE_SCOPE("memory");
+        {
+            PROFILE_SCOPE("temporary");
+            auto temporary = std::make_unique<char[]>(4 << 20);
+        }
+        kept = std::make_unique<char[]>(1 << 20);
+    }
+    profiler::setEnabled(false);
+    kept.reset();
+
+    const std::vector<profiler::ZoneSummary> zones = profiler::summarize();
+    const profiler::ZoneSummary *outer = findZone(zones, "memory");
+    const profiler::ZoneSummary *inner = findZone(zones, "memory/temporary");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_GE(inner->allocations, 1u);
+    EXPECT_GE(inner->peakBytes, 4 << 20);
+    EXPECT_LT(inner->liveBytes, 1 << 20);
+    // the peak of the child is the peak of its parent too
+    EXPECT_GE(outer->allocations, inner->allocations + 1);
+    EXPECT_GE(outer->peakBytes, 4 << 20);
+    EXPECT_GE(outer->liveBytes, 1 << 20);
+    EXPECT_NE(profiler::summary().find("peak MB"), std::string::npos);
+}
+
+#endif
+
+#endif
+
+TEST(profiler, disabledRecordsNothing) {
+    profiler::reset();
+    profiler::setEnabled(false);
+    {
+        PROFILE_SCOPE("never");
+        leaf();
+    }
+    EXPECT_TRUE(profiler::summarize().empty());
+    EXPECT_EQ(profiler::chromeTrace(), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n]}\n");
+}
@@ -58,6 +58,41 @@ inline std::string format_code_location(std::source_location loc) {
 
 #define rassert(condition, error_code, ...) rassert_ex((condition), assertion_error, (error_code), ##__VA_ARGS__)
 
+// Assertion tiers, RASSERT_LEVEL selects which of them are compiled in. Libraries set it for their own sources and
+// tests (LIBBASE_ASSERT_LEVEL, LIBIMAGES_ASSERT_LEVEL in their CMakeLists.txt), the default depends on NDEBUG:
+//   rassert       - always checked: input validation and API contracts (including checked accessors)
+//   rassert_debug - RASSERT_LEVEL >= 1 (Debug builds by default): internal invariants, and per-call checks of
+//                   functions called per element (f.e. DisjointSetUnion::find)
+//   rassert_hot   - RASSERT_LEVEL >= 2: per-pixel/per-point checks in inner loops
+// A compiled out assertion evaluates neither the condition nor the arguments (the condition still has to compile).
+// The level is per translation unit, so it must be the same everywhere for code used through headers (inline
+// functions and templates): headers use only rassert, or a switch that their library defines PUBLIC
+// (f.e. LIBIMAGES_CHECKED_FAST_ACCESS), otherwise one inline function gets different definitions (ODR violation).
+#if !defined(RASSERT_LEVEL)
+#if defined(NDEBUG)
+#define RASSERT_LEVEL 0
+#else
+#define RASSERT_LEVEL 1
+#endif
+#endif
+
+#define rassert_disabled(condition)                                                                                    \
+    do {                                                                                                               \
+        (void) sizeof(!(condition));                                                                                   \
+    } while (0)
+
+#if RASSERT_LEVEL >= 1
+#define rassert_debug(condition, error_code, ...) rassert((condition), (error_code), ##__VA_ARGS__)
+#else
+#define rassert_debug(condition, error_code, ...) rassert_disabled(condition)
+#endif
+
+#if RASSERT_LEVEL >= 2
+#define rassert_hot(condition, error_code, ...) rassert((condition), (error_code), ##__VA_ARGS__)
+#else
+#define rassert_hot(condition, error_code, ...) rassert_disabled(condition)
+#endif
+
 // Usage:
 // rassert(<condition>, <pseudo unique code>); // unique code is helpful to find with Ctrl+F the failed line
 // rassert(p.x() >= 0 && p.y() >= 0, 85974627394081);
@@ -65,3 +100,5 @@ inline std::string format_code_location(std::source_location loc) {
 // rassert(p.x() >= 0 && p.y() >= 0, 7894732123523, "Wrong position", p.x(), p.y());
 // rassert(p.x() >= 0 && p.y() >= 0, "Wrong position", p.x(), p.y());
 // rassert(p.x() >= 0 && p.y() >= 0, "Wrong position", p.x(), p.y(), format_location(loc));
+// rassert_debug(x < size(), 2391578193411, x, size(), format_code_location(loc)); // per-element call
+// rassert_hot(p.x >= 0 && p.x < w, 2347823412); // per-point loop
@@ -0,0 +1,49 @@
+#include "runtime_assert.h"
+
+#include <gtest/gtest.h>
+
+#include "disjoint_set.h"
+
+TEST(runtime_assert, alwaysChecked) {
+    EXPECT_NO_THROW(rassert(1 + 1 == 2, 6610293847001));
+    EXPECT_THROW(rassert(1 + 1 == 3, 6610293847002, "args", 1, 2.5), assertion_error);
+    try {
+        rassert(false, 6610293847003);
+    } catch (const assertion_error &e) {
+        EXPECT_EQ(e.code(), "6610293847003");
+    }
+}
+
+TEST(runtime_assert, tiersFollowLevel) {
+    int evaluated = 0;
+    auto fails = [&evaluated]() {
+        ++evaluated;
+        return false;
+    };
+#if RASSERT_LEVEL >= 1
+    EXPECT_THROW(rassert_debug(fails(), 6610293847004), assertion_error);
+    EXPECT_EQ(evaluated, 1);
+#else
+    EXPECT_NO_THROW(rassert_debug(fails(), 6610293847004));
+    EXPECT_EQ(evaluated, 0); // compiled out: the condition is not evaluated
+#endif
+    evaluated = 0;
+#if RASSERT_LEVEL >= 2
+    EXPECT_THROW(rassert_hot(fails(), 6610293847005), assertion_error);
+    EXPECT_EQ(evaluated, 1);
+#else
+    EXPECT_NO_THROW(rassert_hot(fails(), 6610293847005));
+    EXPECT_EQ(evaluated, 0);
+#endif
+}
+
+// libbase_tests are built with the RASSERT_LEVEL of libbase
+TEST(runtime_assert, disjointSetChecksAreDebugTier) {
+    DisjointSetUnion dsu(3);
+#if RASSERT_LEVEL >= 1
+    EXPECT_THROW(dsu.find(3), assertion_error);
+    EXPECT_THROW(dsu.unite_roots(0, 5), assertion_error);
+#else
+    EXPECT_EQ(dsu.find(2), 2u);
+#endif
+}
@@ -1,14 +1,17 @@
 #include "stats.h"
 
 #include <algorithm>
+#include <array>
 #include <charconv>
 #include <cmath>
 #include <iomanip>
 #include <limits>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace stats {
@@ -73,12 +76,142 @@ template <typename T> std::string formatPreviewValue(T v) {
     }
 }
 
-template <typename T> std::vector<double> toDoubles(const std::vector<T> &values) {
-    std::vector<double> v;
-    v.reserve(values.size());
-    for (const auto &x : values)
-        v.push_back(static_cast<double>(x));
-    return v;
+// Largest value range (max - min + 1) of integers counted by histogram instead of partitioning, f.e. per-pixel SAD <= 765
+constexpr std::size_t histogram_max_range = 4096;
+
+// Values of given ranks (ascending, < values.size()) in sorted order via counting, values are offsets from minVal
+template <typename T, std::size_t Bins>
+void valuesAtRanksByHistogram(std::span<const T> values, T minVal, std::array<std::uint32_t, Bins> &counts,
+                              const std::vector<std::size_t> &ranks, std::vector<double> &out) {
+    for (const T &x : values)
+        ++counts[static_cast<std::size_t>(x - minVal)];
+
+    std::size_t below = 0; // number of values in bins before `bin`
+    std::size_t bin = 0;
+    for (std::size_t rank : ranks) {
+        while (below + counts[bin] <= rank) {
+            below += counts[bin];
+            ++bin;
+        }
+        out.push_back(static_cast<double>(minVal + static_cast<T>(bin)));
+    }
+}
+
+// Values of given ranks (ascending, < values.size()) in sorted order, without sorting:
+// - uint8_t: 256-bin counting histogram, O(n) and no allocation
+// - integers with max - min < histogram_max_range: counting histogram as well
+// - otherwise: nth_element on a copy, each next rank partitions only the part to the right of the previous one
+template <typename T> std::vector<double> valuesAtRanks(std::span<const T> values, const std::vector<std::size_t> &ranks) {
+    std::vector<double> out;
+    out.reserve(ranks.size());
+
+    if constexpr (std::is_same_v<T, std::uint8_t>) {
+        std::array<std::uint32_t, 256> counts{};
+        valuesAtRanksByHistogram(values, std::uint8_t{0}, counts, ranks, out);
+        return out;
+    } else {
+        if constexpr (std::is_integral_v<T>) {
+            const auto [mn, mx] = std::minmax_element(values.begin(), values.end());
+            using U = std::make_unsigned_t<T>;
+            if (static_cast<U>(static_cast<U>(*mx) - static_cast<U>(*mn)) < histogram_max_range) {
+                std::array<std::uint32_t, histogram_max_range> counts{};
+                valuesAtRanksByHistogram(values, *mn, counts, ranks, out);
+                return out;
+            }
+        }
+
+        std::vector<T> v(values.begin(), values.end());
+        std::size_t from = 0; // all values before `from` are already in their sorted places
+        for (std::size_t rank : ranks) {
+            if (rank >= from) {
+                std::nth_element(v.begin() + static_cast<std::ptrdiff_t>(from), v.begin() + static_cast<std::ptrdiff_t>(rank), v.end());
+                from = rank + 1;
+            }
+            out.push_back(static_cast<double>(v[rank]));
+        }
+        return out;
+    }
+}
+
+// Shared by percentile/quantiles: linear interpolation between ranks floor(pos) and ceil(pos), pos = p/100 * (n - 1)
+template <typename T> std::vector<double> percentilesImpl(std::span<const T> values, const double *ps, std::size_t count) {
+    if (values.empty())
+        throw std::invalid_argument("percentile: empty input");
+
+    const std::size_t n = values.size();
+    std::vector<std::size_t> ranks;
+    ranks.reserve(2 * count);
+    for (std::size_t k = 0; k < count; ++k) {
+        const double p = ps[k];
+        if (!(p >= 0.0 && p <= 100.0))
+            throw std::invalid_argument("percentile: p out of range [0,100]");
+        const double pos = p / 100.0 * static_cast<double>(n - 1);
+        ranks.push_back(static_cast<std::size_t>(std::floor(pos)));
+        ranks.push_back(std::min(n - 1, static_cast<std::size_t>(std::ceil(pos))));
+    }
+    std::vector<std::size_t> sortedRanks = ranks;
+    std::sort(sortedRanks.begin(), sortedRanks.end());
+    sortedRanks.erase(std::unique(sortedRanks.begin(), sortedRanks.end()), sortedRanks.end());
+
+    const std::vector<double> rankValues = valuesAtRanks(values, sortedRanks);
+    auto valueOfRank = [&](std::size_t rank) {
+        const auto it = std::lower_bound(sortedRanks.begin(), sortedRanks.end(), rank);
+        return rankValues[static_cast<std::size_t>(it - sortedRanks.begin())];
+    };
+
+    std::vector<double> result;
+    result.reserve(count);
+    for (std::size_t k = 0; k < count; ++k) {
+        const std::size_t i = ranks[2 * k];
+        const std::size_t j = ranks[2 * k + 1];
+        const double a = valueOfRank(i);
+        if (j == i) {
+            result.push_back(a);
+            continue;
+        }
+        const double b = valueOfRank(j);
+        const double pos = ps[k] / 100.0 * static_cast<double>(n - 1);
+        const double t = pos - static_cast<double>(i);
+        result.push_back(a + t * (b - a));
+    }
+    return result;
+}
+
+template <typename T> std::string summaryStatsImpl(std::span<const T> values, int decimals) {
+    const std::size_t n = values.size();
+
+    std::string out;
+    out.reserve(128);
+    out += std::to_string(n);
+    out += " values - ";
+
+    if (n == 0) {
+        out += "(empty)";
+        return out;
+    }
+
+    // min/max are ranks 0 and n - 1, so all five numbers come from a single partitioning (or histogram)
+    const double ps[] = {0.0, 10.0, 50.0, 90.0, 100.0};
+    const std::vector<double> q = percentilesImpl(values, ps, 5);
+
+    if constexpr (std::is_floating_point_v<T>) {
+        out += "(min=" + formatDoubleFixed(q[0], decimals);
+        out += " 10%=" + formatDoubleFixed(q[1], decimals);
+        out += " median=" + formatDoubleFixed(q[2], decimals);
+        out += " 90%=" + formatDoubleFixed(q[3], decimals);
+        out += " max=" + formatDoubleFixed(q[4], decimals);
+    } else {
+        // exact min/max (size_t may not fit into double)
+        const auto [mn, mx] = std::minmax_element(values.begin(), values.end());
+        out += "(min=" + formatInt(*mn);
+        out += " 10%=" + formatDoublePretty(q[1], 10);
+        out += " median=" + formatDoublePretty(q[2], 10);
+        out += " 90%=" + formatDoublePretty(q[3], 10);
+        out += " max=" + formatInt(*mx);
+    }
+    out += ")";
+
+    return out;
 }
 
 } // namespace
@@ -88,53 +221,27 @@ template <AllowedType T> std::string toPercent(T part, T total) {
     return std::to_string(percent) + "%";
 }
 
-template <AllowedType T> T minValue(const std::vector<T> &values) {
+template <AllowedType T> T minValue(std::span<const T> values) {
     if (values.empty())
         throw std::invalid_argument("minValue: empty input");
     return *std::min_element(values.begin(), values.end());
 }
 
-template <AllowedType T> T maxValue(const std::vector<T> &values) {
+template <AllowedType T> T maxValue(std::span<const T> values) {
     if (values.empty())
         throw std::invalid_argument("maxValue: empty input");
     return *std::max_element(values.begin(), values.end());
 }
 
-template <AllowedType T> double percentile(const std::vector<T> &values, double p) {
-    if (values.empty())
-        throw std::invalid_argument("percentile: empty input");
-    if (!(p >= 0.0 && p <= 100.0))
-        throw std::invalid_argument("percentile: p out of range [0,100]");
-
-    const std::size_t n = values.size();
-    if (n == 1)
-        return static_cast<double>(values[0]);
-
-    auto v = toDoubles(values);
-
-    if (p <= 0.0)
-        return *std::min_element(v.begin(), v.end());
-    if (p >= 100.0)
-        return *std::max_element(v.begin(), v.end());
-
-    const double q = p / 100.0;
-    const double pos = q * static_cast<double>(n - 1);
-    const std::size_t i = static_cast<std::size_t>(std::floor(pos));
-    const std::size_t j = static_cast<std::size_t>(std::ceil(pos));
-
-    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(i), v.end());
-    const double a = v[i];
-    if (j == i)
-        return a;
-
-    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(j), v.end());
-    const double b = v[j];
+template <AllowedType T> double percentile(std::span<const T> values, double p) {
+    return percentilesImpl(values, &p, 1)[0];
+}
 
-    const double t = pos - static_cast<double>(i);
-    return a + t * (b - a);
+template <AllowedType T> std::vector<double> quantiles(std::span<const T> values, std::initializer_list<double> ps) {
+    return percentilesImpl(values, ps.begin(), ps.size());
 }
 
-template <AllowedType T> double sum(const std::vector<T> &values) {
+template <AllowedType T> double sum(std::span<const T> values) {
     double total_sum = 0.0;
     for (const T &value: values) {
         total_sum += value;
@@ -142,9 +249,9 @@ template <AllowedType T> double sum(const std::vector<T> &values) {
     return total_sum;
 }
 
-template <AllowedType T> double median(const std::vector<T> &values) { return percentile(values, 50.0); }
+template <AllowedType T> double median(std::span<const T> values) { return percentile(values, 50.0); }
 
-template <AllowedType T> std::string previewValues(const std::vector<T> &values) {
+template <AllowedType T> std::string previewValues(std::span<const T> values) {
     const std::size_t n = values.size();
 
     std::string out;
@@ -189,95 +296,13 @@ template <AllowedType T> std::string previewValues(const std::vector<T> &values)
 
 template <AllowedType T>
     requires(!std::is_floating_point_v<T>)
-std::string summaryStats(const std::vector<T> &values) {
-    const std::size_t n = values.size();
-
-    std::string out;
-    out.reserve(128);
-    out += std::to_string(n);
-    out += " values - ";
-
-    if (n == 0) {
-        out += "(empty)";
-        return out;
-    }
-
-    const T mnT = minValue(values);
-    const T mxT = maxValue(values);
-
-    const double p10 = percentile(values, 10.0);
-    const double med = median(values);
-    const double p90 = percentile(values, 90.0);
-
-    out += "(min=" + formatInt(mnT);
-    out += " 10%=" + formatDoublePretty(p10, 10);
-    out += " median=" + formatDoublePretty(med, 10);
-    out += " 90%=" + formatDoublePretty(p90, 10);
-    out += " max=" + formatInt(mxT);
-    out += ")";
-
-    return out;
-}
-
-std::string summaryStats(const std::vector<float> &values, int decimals) {
-    const std::size_t n = values.size();
-
-    std::string out;
-    out.reserve(128);
-    out += std::to_string(n);
-    out += " values - ";
-
-    if (n == 0) {
-        out += "(empty)";
-        return out;
-    }
-
-    const float mn = minValue(values);
-    const float mx = maxValue(values);
-
-    const double p10 = percentile(values, 10.0);
-    const double med = median(values);
-    const double p90 = percentile(values, 90.0);
-
-    out += "(min=" + formatDoubleFixed(static_cast<double>(mn), decimals);
-    out += " 10%=" + formatDoubleFixed(p10, decimals);
-    out += " median=" + formatDoubleFixed(med, decimals);
-    out += " 90%=" + formatDoubleFixed(p90, decimals);
-    out += " max=" + formatDoubleFixed(static_cast<double>(mx), decimals);
-    out += ")";
-
-    return out;
+std::string summaryStats(std::span<const T> values) {
+    return summaryStatsImpl(values, 0);
 }
 
-std::string summaryStats(const std::vector<double> &values, int decimals) {
-    const std::size_t n = values.size();
-
-    std::string out;
-    out.reserve(128);
-    out += std::to_string(n);
-    out += " values - ";
-
-    if (n == 0) {
-        out += "(empty)";
-        return out;
-    }
+std::string summaryStats(std::span<const float> values, int decimals) { return summaryStatsImpl(values, decimals); }
 
-    const double mn = minValue(values);
-    const double mx = maxValue(values);
-
-    const double p10 = percentile(values, 10.0);
-    const double med = median(values);
-    const double p90 = percentile(values, 90.0);
-
-    out += "(min=" + formatDoubleFixed(mn, decimals);
-    out += " 10%=" + formatDoubleFixed(p10, decimals);
-    out += " median=" + formatDoubleFixed(med, decimals);
-    out += " 90%=" + formatDoubleFixed(p90, decimals);
-    out += " max=" + formatDoubleFixed(mx, decimals);
-    out += ")";
-
-    return out;
-}
+std::string summaryStats(std::span<const double> values, int decimals) { return summaryStatsImpl(values, decimals); }
 
 // ---- Explicit instantiations (only allowed types) ----
 template std::string toPercent<int>(int part, int total);
@@ -286,44 +311,50 @@ template std::string toPercent<double>(double part, double total);
 template std::string toPercent<std::size_t>(std::size_t part, std::size_t total);
 template std::string toPercent<std::uint8_t>(std::uint8_t part, std::uint8_t total);
 
-template int minValue<int>(const std::vector<int> &);
-template float minValue<float>(const std::vector<float> &);
-template double minValue<double>(const std::vector<double> &);
-template std::size_t minValue<std::size_t>(const std::vector<std::size_t> &);
-template std::uint8_t minValue<std::uint8_t>(const std::vector<std::uint8_t> &);
-
-template int maxValue<int>(const std::vector<int> &);
-template float maxValue<float>(const std::vector<float> &);
-template double maxValue<double>(const std::vector<double> &);
-template std::size_t maxValue<std::size_t>(const std::vector<std::size_t> &);
-template std::uint8_t maxValue<std::uint8_t>(const std::vector<std::uint8_t> &);
-
-template double sum<int>(const std::vector<int> &);
-template double sum<float>(const std::vector<float> &);
-template double sum<double>(const std::vector<double> &);
-template double sum<std::size_t>(const std::vector<std::size_t> &);
-template double sum<std::uint8_t>(const std::vector<std::uint8_t> &);
-
-template double median<int>(const std::vector<int> &);
-template double median<float>(const std::vector<float> &);
-template double median<double>(const std::vector<double> &);
-template double median<std::size_t>(const std::vector<std::size_t> &);
-template double median<std::uint8_t>(const std::vector<std::uint8_t> &);
-
-template double percentile<int>(const std::vector<int> &, double);
-template double percentile<float>(const std::vector<float> &, double);
-template double percentile<double>(const std::vector<double> &, double);
-template double percentile<std::size_t>(const std::vector<std::size_t> &, double);
-template double percentile<std::uint8_t>(const std::vector<std::uint8_t> &, double);
-
-template std::string previewValues<int>(const std::vector<int> &);
-template std::string previewValues<float>(const std::vector<float> &);
-template std::string previewValues<double>(const std::vector<double> &);
-template std::string previewValues<std::size_t>(const std::vector<std::size_t> &);
-template std::string previewValues<std::uint8_t>(const std::vector<std::uint8_t> &);
-
-template std::string summaryStats<int>(const std::vector<int> &);
-template std::string summaryStats<std::size_t>(const std::vector<std::size_t> &);
-template std::string summaryStats<std::uint8_t>(const std::vector<std::uint8_t> &);
+template int minValue<int>(std::span<const int>);
+template float minValue<float>(std::span<const float>);
+template double minValue<double>(std::span<const double>);
+template std::size_t minValue<std::size_t>(std::span<const std::size_t>);
+template std::uint8_t minValue<std::uint8_t>(std::span<const std::uint8_t>);
+
+template int maxValue<int>(std::span<const int>);
+template float maxValue<float>(std::span<const float>);
+template double maxValue<double>(std::span<const double>);
+template std::size_t maxValue<std::size_t>(std::span<const std::size_t>);
+template std::uint8_t maxValue<std::uint8_t>(std::span<const std::uint8_t>);
+
+template double sum<int>(std::span<const int>);
+template double sum<float>(std::span<const float>);
+template double sum<double>(std::span<const double>);
+template double sum<std::size_t>(std::span<const std::size_t>);
+template double sum<std::uint8_t>(std::span<const std::uint8_t>);
+
+template double median<int>(std::span<const int>);
+template double median<float>(std::span<const float>);
+template double median<double>(std::span<const double>);
+template double median<std::size_t>(std::span<const std::size_t>);
+template double median<std::uint8_t>(std::span<const std::uint8_t>);
+
+template double percentile<int>(std::span<const int>, double);
+template double percentile<float>(std::span<const float>, double);
+template double percentile<double>(std::span<const double>, double);
+template double percentile<std::size_t>(std::span<const std::size_t>, double);
+template double percentile<std::uint8_t>(std::span<const std::uint8_t>, double);
+
+template std::vector<double> quantiles<int>(std::span<const int>, std::initializer_list<double>);
+template std::vector<double> quantiles<float>(std::span<const float>, std::initializer_list<double>);
+template std::vector<double> quantiles<double>(std::span<const double>, std::initializer_list<double>);
+template std::vector<double> quantiles<std::size_t>(std::span<const std::size_t>, std::initializer_list<double>);
+template std::vector<double> quantiles<std::uint8_t>(std::span<const std::uint8_t>, std::initializer_list<double>);
+
+template std::string previewValues<int>(std::span<const int>);
+template std::string previewValues<float>(std::span<const float>);
+template std::string previewValues<double>(std::span<const double>);
+template std::string previewValues<std::size_t>(std::span<const std::size_t>);
+template std::string previewValues<std::uint8_t>(std::span<const std::uint8_t>);
+
+template std::string summaryStats<int>(std::span<const int>);
+template std::string summaryStats<std::size_t>(std::span<const std::size_t>);
+template std::string summaryStats<std::uint8_t>(std::span<const std::uint8_t>);
 
 } // namespace stats
\ No newline at end of file
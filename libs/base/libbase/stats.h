@@ -2,6 +2,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <initializer_list>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -14,34 +16,68 @@ concept AllowedType = std::is_same_v<T, int> || std::is_same_v<T, float> || std:
 
 template <typename T> std::string toPercent(T part, T total);
 
+// All functions take std::span, so any contiguous range (std::vector, part of an array, ...) is read without copying.
+// std::vector overloads below forward to them (template argument can't be deduced through the implicit conversion).
+
 // Throws std::invalid_argument if values is empty.
-template <AllowedType T> T minValue(const std::vector<T> &values);
+template <AllowedType T> T minValue(std::span<const T> values);
 
-template <AllowedType T> T maxValue(const std::vector<T> &values);
+template <AllowedType T> T maxValue(std::span<const T> values);
 
-template <AllowedType T> double sum(const std::vector<T> &values);
+template <AllowedType T> double sum(std::span<const T> values);
 
 // Median / percentile return double (because interpolation).
 // Throws std::invalid_argument if values is empty.
-template <AllowedType T> double median(const std::vector<T> &values);
+template <AllowedType T> double median(std::span<const T> values);
 
 // p in [0, 100]. Linear interpolation on sorted data.
+// Does not sort: uint8_t and integers with a small value range (max - min < 4096) use a counting histogram (O(n)),
+// other types use nth_element.
 // Throws std::invalid_argument if values is empty or p out of range.
-template <AllowedType T> double percentile(const std::vector<T> &values, double p);
+template <AllowedType T> double percentile(std::span<const T> values, double p);
+
+// Same as percentile for each of ps, but the data is counted/partitioned only once for all of them.
+// F.e. quantiles(values, {10, 50, 90}) -> {p10, median, p90}
+template <AllowedType T> std::vector<double> quantiles(std::span<const T> values, std::initializer_list<double> ps);
 
 // "N values - [v0, v1, v2, v3, v4, ... vN-5, vN-4, vN-3, vN-2, vN-1]"
 // If N <= 10: list all values.
 // If N == 0: "0 values - []"
-template <AllowedType T> std::string previewValues(const std::vector<T> &values);
+template <AllowedType T> std::string previewValues(std::span<const T> values);
 
 // Summary:
 // - for int/size_t/uint8_t: "N values - (min=... 10%=... median=... 90%=... max=...)"
 // - for float/double: same, but with fixed decimals (default 2)
 template <AllowedType T>
     requires(!std::is_floating_point_v<T>)
-std::string summaryStats(const std::vector<T> &values);
+std::string summaryStats(std::span<const T> values);
+
+std::string summaryStats(std::span<const float> values, int decimals = 2);
+std::string summaryStats(std::span<const double> values, int decimals = 2);
 
-std::string summaryStats(const std::vector<float> &values, int decimals = 2);
-std::string summaryStats(const std::vector<double> &values, int decimals = 2);
+template <AllowedType T> T minValue(const std::vector<T> &values) { return minValue(std::span<const T>(values)); }
+template <AllowedType T> T maxValue(const std::vector<T> &values) { return maxValue(std::span<const T>(values)); }
+template <AllowedType T> double sum(const std::vector<T> &values) { return sum(std::span<const T>(values)); }
+template <AllowedType T> double median(const std::vector<T> &values) { return median(std::span<const T>(values)); }
+template <AllowedType T> double percentile(const std::vector<T> &values, double p) {
+    return percentile(std::span<const T>(values), p);
+}
+template <AllowedType T> std::vector<double> quantiles(const std::vector<T> &values, std::initializer_list<double> ps) {
+    return quantiles(std::span<const T>(values), ps);
+}
+template <AllowedType T> std::string previewValues(const std::vector<T> &values) {
+    return previewValues(std::span<const T>(values));
+}
+template <AllowedType T>
+    requires(!std::is_floating_point_v<T>)
+std::string summaryStats(const std::vector<T> &values) {
+    return summaryStats(std::span<const T>(values));
+}
+inline std::string summaryStats(const std::vector<float> &values, int decimals = 2) {
+    return summaryStats(std::span<const float>(values), decimals);
+}
+inline std::string summaryStats(const std::vector<double> &values, int decimals = 2) {
+    return summaryStats(std::span<const double>(values), decimals);
+}
 
 } // namespace stats
\ No newline at end of file
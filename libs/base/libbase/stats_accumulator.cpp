@@ -0,0 +1,156 @@
+#include "stats_accumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace stats {
+
+template <AllowedType T>
+Accumulator<T>::Accumulator(double histogramMin, double histogramMax, int buckets)
+    : histogramMin_(histogramMin), histogramMax_(histogramMax) {
+    if (!(histogramMin < histogramMax) || buckets <= 0)
+        throw std::invalid_argument("Accumulator: invalid histogram range or buckets count");
+    buckets_.assign(static_cast<std::size_t>(buckets), 0);
+}
+
+template <AllowedType T> void Accumulator<T>::add(T value) {
+    const double x = static_cast<double>(value);
+    if (count_ == 0) {
+        min_ = value;
+        max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    ++count_;
+    const double delta = x - mean_;
+    mean_ += delta / static_cast<double>(count_);
+    m2_ += delta * (x - mean_);
+
+    if (!buckets_.empty()) {
+        const double pos = (x - histogramMin_) / (histogramMax_ - histogramMin_) * static_cast<double>(buckets_.size());
+        const double clamped = std::clamp(pos, 0.0, static_cast<double>(buckets_.size() - 1));
+        ++buckets_[static_cast<std::size_t>(clamped)];
+    }
+}
+
+template <AllowedType T> void Accumulator<T>::add(std::span<const T> values) {
+    for (const T &value : values)
+        add(value);
+}
+
+template <AllowedType T> void Accumulator<T>::merge(const Accumulator &other) {
+    if (buckets_.size() != other.buckets_.size() || histogramMin_ != other.histogramMin_ || histogramMax_ != other.histogramMax_)
+        throw std::invalid_argument("Accumulator::merge: different histogram layouts");
+    if (other.count_ == 0)
+        return;
+    if (count_ == 0) {
+        *this = other;
+        return;
+    }
+
+    // Chan et al. parallel variance
+    const double n1 = static_cast<double>(count_);
+    const double n2 = static_cast<double>(other.count_);
+    const double delta = other.mean_ - mean_;
+    mean_ += delta * n2 / (n1 + n2);
+    m2_ += other.m2_ + delta * delta * n1 * n2 / (n1 + n2);
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    for (std::size_t i = 0; i < buckets_.size(); ++i)
+        buckets_[i] += other.buckets_[i];
+}
+
+template <AllowedType T> T Accumulator<T>::min() const {
+    if (count_ == 0)
+        throw std::invalid_argument("Accumulator::min: empty");
+    return min_;
+}
+
+template <AllowedType T> T Accumulator<T>::max() const {
+    if (count_ == 0)
+        throw std::invalid_argument("Accumulator::max: empty");
+    return max_;
+}
+
+template <AllowedType T> double Accumulator<T>::mean() const {
+    if (count_ == 0)
+        throw std::invalid_argument("Accumulator::mean: empty");
+    return mean_;
+}
+
+template <AllowedType T> double Accumulator<T>::variance() const {
+    if (count_ == 0)
+        throw std::invalid_argument("Accumulator::variance: empty");
+    return m2_ / static_cast<double>(count_);
+}
+
+template <AllowedType T> double Accumulator<T>::stddev() const { return std::sqrt(variance()); }
+
+template <AllowedType T> double Accumulator<T>::quantile(double p) const {
+    if (count_ == 0)
+        throw std::invalid_argument("Accumulator::quantile: empty");
+    if (!(p >= 0.0 && p <= 100.0))
+        throw std::invalid_argument("Accumulator::quantile: p out of range [0,100]");
+    if (buckets_.empty())
+        throw std::invalid_argument("Accumulator::quantile: no histogram");
+
+    if (p <= 0.0)
+        return static_cast<double>(min_);
+    if (p >= 100.0)
+        return static_cast<double>(max_);
+
+    // Same rank convention as stats::percentile: interpolation between values of ranks floor(pos) and ceil(pos)
+    const double pos = p / 100.0 * static_cast<double>(count_ - 1);
+    const std::size_t i = static_cast<std::size_t>(std::floor(pos));
+    const std::size_t j = std::min(count_ - 1, static_cast<std::size_t>(std::ceil(pos)));
+    const double a = valueOfRank(i);
+    if (j == i)
+        return a;
+    const double b = valueOfRank(j);
+    return a + (pos - static_cast<double>(i)) * (b - a);
+}
+
+template <AllowedType T> double Accumulator<T>::valueOfRank(std::size_t rank) const {
+    // k values of a bucket are assumed to be spread uniformly: value number m is at (m + 0.5) / k of its width
+    const double width = (histogramMax_ - histogramMin_) / static_cast<double>(buckets_.size());
+    std::size_t below = 0;
+    for (std::size_t b = 0; b < buckets_.size(); ++b) {
+        if (below + buckets_[b] > rank) {
+            const double fraction = (static_cast<double>(rank - below) + 0.5) / static_cast<double>(buckets_[b]);
+            const double value = histogramMin_ + width * (static_cast<double>(b) + fraction);
+            return std::clamp(value, static_cast<double>(min_), static_cast<double>(max_));
+        }
+        below += buckets_[b];
+    }
+    return static_cast<double>(max_);
+}
+
+template <AllowedType T> std::string Accumulator<T>::summary(int decimals) const {
+    std::ostringstream oss;
+    oss << count_ << " values - ";
+    if (count_ == 0) {
+        oss << "(empty)";
+        return oss.str();
+    }
+    oss.setf(std::ios::fixed);
+    oss << std::setprecision(decimals);
+    oss << "(min=" << static_cast<double>(min_) << " mean=" << mean_;
+    if (hasHistogram()) {
+        oss << " 10%=" << quantile(10.0) << " median=" << quantile(50.0) << " 90%=" << quantile(90.0);
+    }
+    oss << " max=" << static_cast<double>(max_) << ")";
+    return oss.str();
+}
+
+template class Accumulator<int>;
+template class Accumulator<float>;
+template class Accumulator<double>;
+template class Accumulator<std::size_t>;
+template class Accumulator<std::uint8_t>;
+
+} // namespace stats
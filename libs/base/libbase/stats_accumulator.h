@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "stats.h"
+
+namespace stats {
+
+// Streaming statistics in constant memory: count/min/max/mean/variance (Welford) and approximate quantiles
+// from a fixed-bucket histogram over [histogramMin, histogramMax) (values outside go to the first/last bucket).
+// Accumulators filled in different threads can be merged (histograms must have the same layout).
+template <AllowedType T> class Accumulator final {
+  public:
+    static constexpr int default_buckets = 1024;
+
+    // Without histogram: quantile() is unavailable
+    Accumulator() = default;
+    Accumulator(double histogramMin, double histogramMax, int buckets = default_buckets);
+
+    void add(T value);
+    void add(std::span<const T> values);
+
+    // Throws std::invalid_argument if histogram layouts differ
+    void merge(const Accumulator &other);
+
+    std::size_t count() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+    bool hasHistogram() const noexcept { return !buckets_.empty(); }
+
+    // Throw std::invalid_argument if empty
+    T min() const;
+    T max() const;
+    double mean() const;
+    // Population variance
+    double variance() const;
+    double stddev() const;
+
+    // p in [0, 100], error is at most one bucket width (p = 0 and p = 100 are exact min and max).
+    // Throws std::invalid_argument if empty, p out of range or no histogram.
+    double quantile(double p) const;
+
+    // "N values - (min=... mean=... 10%=... median=... 90%=... max=...)" (quantiles only if there is a histogram)
+    std::string summary(int decimals = 2) const;
+
+  private:
+    // Estimated value of given rank in sorted order (from histogram)
+    double valueOfRank(std::size_t rank) const;
+
+    std::size_t count_ = 0;
+    T min_{};
+    T max_{};
+    double mean_ = 0.0;
+    double m2_ = 0.0; // sum of squared deviations from mean
+
+    double histogramMin_ = 0.0;
+    double histogramMax_ = 0.0;
+    std::vector<std::uint64_t> buckets_;
+};
+
+} // namespace stats
@@ -0,0 +1,92 @@
+#include "stats_accumulator.h"
+
+#include <gtest/gtest.h>
+
+#include "fast_random.h"
+#include "stats.h"
+
+#include <stdexcept>
+#include <vector>
+
+TEST(StatsAccumulator, MomentsMatchDirectComputation) {
+    FastRandom r(8);
+    std::vector<double> values(1000);
+    for (double &v : values)
+        v = r.nextFloat(-10.0f, 30.0f);
+
+    stats::Accumulator<double> acc;
+    acc.add(values);
+
+    double mean = 0.0;
+    for (double v : values)
+        mean += v;
+    mean /= values.size();
+    double var = 0.0;
+    for (double v : values)
+        var += (v - mean) * (v - mean);
+    var /= values.size();
+
+    EXPECT_EQ(acc.count(), values.size());
+    EXPECT_EQ(acc.min(), stats::minValue(values));
+    EXPECT_EQ(acc.max(), stats::maxValue(values));
+    EXPECT_NEAR(acc.mean(), mean, 1e-9);
+    EXPECT_NEAR(acc.variance(), var, 1e-7);
+    EXPECT_FALSE(acc.hasHistogram());
+    EXPECT_THROW(acc.quantile(50.0), std::invalid_argument);
+}
+
+TEST(StatsAccumulator, QuantilesWithinBucketWidth) {
+    FastRandom r(9);
+    std::vector<float> values(5000);
+    for (float &v : values)
+        v = r.nextFloat(0.0f, 1.0f) * r.nextFloat(0.0f, 255.0f);
+
+    const int buckets = 512;
+    stats::Accumulator<float> acc(0.0, 256.0, buckets);
+    acc.add(values);
+    const double width = 256.0 / buckets;
+
+    for (double p : {1.0, 10.0, 50.0, 90.0, 99.0}) {
+        EXPECT_NEAR(acc.quantile(p), stats::percentile(values, p), width) << p;
+    }
+    EXPECT_EQ(acc.quantile(0.0), stats::minValue(values));
+    EXPECT_EQ(acc.quantile(100.0), stats::maxValue(values));
+}
+
+TEST(StatsAccumulator, MergeEqualsSingleAccumulator) {
+    FastRandom r(10);
+    stats::Accumulator<int> all(0, 1000, 100);
+    std::vector<stats::Accumulator<int>> parts(4, stats::Accumulator<int>(0, 1000, 100));
+    for (int i = 0; i < 4000; ++i) {
+        const int v = r.nextInt(0, 999);
+        all.add(v);
+        parts[i % 3].add(v); // parts[3] stays empty
+    }
+
+    stats::Accumulator<int> merged(0, 1000, 100);
+    for (const auto &part : parts)
+        merged.merge(part);
+
+    EXPECT_EQ(merged.count(), all.count());
+    EXPECT_EQ(merged.min(), all.min());
+    EXPECT_EQ(merged.max(), all.max());
+    EXPECT_NEAR(merged.mean(), all.mean(), 1e-9);
+    EXPECT_NEAR(merged.variance(), all.variance(), 1e-6);
+    EXPECT_DOUBLE_EQ(merged.quantile(50.0), all.quantile(50.0));
+    EXPECT_EQ(merged.summary(), all.summary());
+
+    stats::Accumulator<int> other(0, 500, 100);
+    EXPECT_THROW(merged.merge(other), std::invalid_argument);
+}
+
+TEST(StatsAccumulator, EmptyAndSummary) {
+    stats::Accumulator<std::uint8_t> acc(0, 256, 256);
+    EXPECT_TRUE(acc.empty());
+    EXPECT_THROW(acc.min(), std::invalid_argument);
+    EXPECT_EQ(acc.summary(), "0 values - (empty)");
+
+    for (int v : {10, 20, 30})
+        acc.add(static_cast<std::uint8_t>(v));
+    // exact: 10%=12 median=20 90%=28, histogram places each value in the middle of its 1-wide bucket
+    EXPECT_EQ(acc.summary(), "3 values - (min=10.00 mean=20.00 10%=12.50 median=20.50 90%=28.10 max=30.00)");
+}
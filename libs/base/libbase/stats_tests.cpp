@@ -2,8 +2,14 @@
 
 #include <gtest/gtest.h>
 
+#include "fast_random.h"
+
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 TEST(Stats, MinMax_Int) {
@@ -90,3 +96,80 @@ TEST(Stats, SummaryEmpty) {
     EXPECT_EQ(stats::summaryStats(v), "0 values - (empty)");
     EXPECT_EQ(stats::summaryStats(v, 5), "0 values - (empty)");
 }
+
+namespace {
+
+template <typename T> double sortedPercentile(std::vector<T> v, double p) {
+    std::sort(v.begin(), v.end());
+    const double pos = p / 100.0 * static_cast<double>(v.size() - 1);
+    const std::size_t i = static_cast<std::size_t>(std::floor(pos));
+    const std::size_t j = static_cast<std::size_t>(std::ceil(pos));
+    const double a = static_cast<double>(v[i]);
+    const double b = static_cast<double>(v[j]);
+    return a + (pos - static_cast<double>(i)) * (b - a);
+}
+
+} // namespace
+
+TEST(Stats, PercentileMatchesSortedReference) {
+    FastRandom r(3);
+    for (std::size_t n : {1u, 2u, 3u, 10u, 101u, 1000u}) {
+        std::vector<std::uint8_t> u8(n);
+        std::vector<int> smallInts(n), wideInts(n);
+        std::vector<float> floats(n);
+        for (std::size_t k = 0; k < n; ++k) {
+            u8[k] = static_cast<std::uint8_t>(r.nextInt(0, 255));
+            smallInts[k] = r.nextInt(-300, 765);
+            wideInts[k] = r.nextInt(-1000000, 1000000);
+            floats[k] = r.nextFloat(-5.0f, 5.0f);
+        }
+        for (double p : {0.0, 1.0, 10.0, 33.3, 50.0, 90.0, 99.9, 100.0}) {
+            EXPECT_DOUBLE_EQ(stats::percentile(u8, p), sortedPercentile(u8, p)) << n << " " << p;
+            EXPECT_DOUBLE_EQ(stats::percentile(smallInts, p), sortedPercentile(smallInts, p)) << n << " " << p;
+            EXPECT_DOUBLE_EQ(stats::percentile(wideInts, p), sortedPercentile(wideInts, p)) << n << " " << p;
+            EXPECT_DOUBLE_EQ(stats::percentile(floats, p), sortedPercentile(floats, p)) << n << " " << p;
+        }
+    }
+
+    // duplicates around the interpolated rank
+    std::vector<std::uint8_t> dups{7, 7, 7, 9, 9, 200};
+    EXPECT_DOUBLE_EQ(stats::percentile(dups, 50.0), 8.0);
+    std::vector<std::size_t> sizes{5, 5, 5, 5};
+    EXPECT_DOUBLE_EQ(stats::median(sizes), 5.0);
+}
+
+TEST(Stats, QuantilesMatchPercentile) {
+    FastRandom r(4);
+    std::vector<float> floats(333);
+    std::vector<int> ints(333);
+    for (std::size_t k = 0; k < floats.size(); ++k) {
+        floats[k] = r.nextFloat(0.0f, 1.0f);
+        ints[k] = r.nextInt(0, 765);
+    }
+
+    const std::vector<double> qf = stats::quantiles(floats, {90.0, 0.0, 50.0, 10.0, 100.0, 50.0});
+    ASSERT_EQ(qf.size(), 6u);
+    EXPECT_DOUBLE_EQ(qf[0], stats::percentile(floats, 90.0));
+    EXPECT_DOUBLE_EQ(qf[1], stats::minValue(floats));
+    EXPECT_DOUBLE_EQ(qf[2], stats::median(floats));
+    EXPECT_DOUBLE_EQ(qf[3], stats::percentile(floats, 10.0));
+    EXPECT_DOUBLE_EQ(qf[4], stats::maxValue(floats));
+    EXPECT_DOUBLE_EQ(qf[5], qf[2]);
+
+    const std::vector<double> qi = stats::quantiles(ints, {25.0, 75.0});
+    EXPECT_DOUBLE_EQ(qi[0], sortedPercentile(ints, 25.0));
+    EXPECT_DOUBLE_EQ(qi[1], sortedPercentile(ints, 75.0));
+
+    EXPECT_THROW(stats::quantiles(ints, {50.0, 101.0}), std::invalid_argument);
+}
+
+TEST(Stats, SpanOfPartOfVector) {
+    const std::vector<int> v{100, 1, 2, 3, 4, -100};
+    const std::span<const int> middle(v.data() + 1, 4);
+    EXPECT_EQ(stats::minValue(middle), 1);
+    EXPECT_EQ(stats::maxValue(middle), 4);
+    EXPECT_DOUBLE_EQ(stats::median(middle), 2.5);
+    EXPECT_DOUBLE_EQ(stats::sum(middle), 10.0);
+    EXPECT_EQ(stats::summaryStats(middle), "4 values - (min=1 10%=1.3 median=2.5 90%=3.7 max=4)");
+    EXPECT_EQ(stats::previewValues(middle), "4 values - [1, 2, 3, 4]");
+}
@@ -0,0 +1,226 @@
+#include "task_scheduler.h"
+
+#include "cpu_budget.h"
+#include "runtime_assert.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Scheduler and worker index of the current thread, -1 for threads that are not its workers
+thread_local TaskScheduler *currentScheduler = nullptr;
+thread_local int currentWorker = -1;
+
+std::mutex globalMutex;
+TaskScheduler::Options globalOptions;
+bool globalCreated = false;
+
+TaskScheduler::Options takeGlobalOptions() {
+    std::lock_guard<std::mutex> lock(globalMutex);
+    globalCreated = true;
+    return globalOptions;
+}
+
+void pinThread(std::thread &thread, int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set); // best effort, f.e. the CPU can be offline
+#else
+    (void) thread;
+    (void) cpu;
+#endif
+}
+
+} // namespace
+
+TaskScheduler::TaskScheduler() : TaskScheduler(Options()) {}
+
+TaskScheduler::TaskScheduler(const Options &options) {
+    rassert(options.threads >= 0, 12390847561001, options.threads);
+    for (int cpu: options.affinity) rassert(cpu >= 0, 12390847561002, cpu);
+
+    const int threads = options.threads > 0 ? options.threads : availableCpus() - 1;
+    for (int i = 0; i < threads; ++i) workers_.push_back(std::make_unique<Worker>());
+    // all deques exist before any worker can steal from them
+    for (int i = 0; i < threads; ++i) {
+        workers_[i]->thread = std::thread([this, i] { workerLoop(i); });
+        if (!options.affinity.empty()) pinThread(workers_[i]->thread, options.affinity[i % options.affinity.size()]);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::unique_ptr<Worker> &worker: workers_) worker->thread.join();
+}
+
+TaskScheduler &TaskScheduler::global() {
+    static TaskScheduler scheduler(takeGlobalOptions());
+    return scheduler;
+}
+
+void TaskScheduler::setGlobalOptions(const Options &options) {
+    std::lock_guard<std::mutex> lock(globalMutex);
+    rassert(!globalCreated, 12390847561003);
+    globalOptions = options;
+}
+
+void TaskScheduler::spawn(std::function<void()> task) {
+    if (currentScheduler == this && currentWorker >= 0) {
+        Worker &self = *workers_[currentWorker];
+        std::lock_guard<std::mutex> lock(self.mutex);
+        self.tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> lock(sharedMutex_);
+        shared_.push_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+    // a worker that checked queued_ just before the increment is either still holding sleepMutex_ or already waiting
+    { std::lock_guard<std::mutex> lock(sleepMutex_); }
+    wake_.notify_one();
+}
+
+bool TaskScheduler::popTask(int self, std::function<void()> &task) {
+    if (queued_.load() == 0) return false;
+    auto take = [&](std::mutex &mutex, std::deque<std::function<void()>> &tasks, bool back) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        if (back) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        queued_.fetch_sub(1);
+        return true;
+    };
+    if (self >= 0 && take(workers_[self]->mutex, workers_[self]->tasks, true)) return true;
+    if (take(sharedMutex_, shared_, false)) return true;
+    const int n = workers();
+    for (int k = 1; k <= n; ++k) {
+        const int victim = (std::max(self, 0) + k) % n;
+        if (victim != self && take(workers_[victim]->mutex, workers_[victim]->tasks, false)) return true;
+    }
+    return false;
+}
+
+bool TaskScheduler::runPending() {
+    std::function<void()> task;
+    if (!popTask(currentScheduler == this ? currentWorker : -1, task)) return false;
+    task();
+    return true;
+}
+
+void TaskScheduler::workerLoop(int self) {
+    currentScheduler = this;
+    currentWorker = self;
+    std::function<void()> task;
+    while (true) {
+        if (popTask(self, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_) return;
+    }
+}
+
+TaskGroup::TaskGroup(TaskScheduler &scheduler) : scheduler_(scheduler) {}
+
+TaskGroup::~TaskGroup() {
+    join();
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending_.fetch_add(1);
+    scheduler_.spawn([this, task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+        pending_.fetch_sub(1); // the last access to the group, it can be destroyed right after
+    });
+}
+
+void TaskGroup::join() noexcept {
+    while (pending_.load() > 0) {
+        if (!scheduler_.runPending()) std::this_thread::yield();
+    }
+}
+
+void TaskGroup::wait() {
+    join();
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        std::swap(error, error_);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+namespace {
+
+void splitRange(TaskGroup &group, int from, int to, int grain, const std::function<void(int, int)> &body) {
+    while (to - from > grain) {
+        const int mid = from + (to - from) / 2;
+        group.run([&group, mid, to, grain, &body] { splitRange(group, mid, to, grain, body); });
+        to = mid;
+    }
+    body(from, to);
+}
+
+// budget threads (the calling one and budget - 1 tasks) take grain-long ranges while there are any
+void budgetedRanges(TaskScheduler &scheduler, int begin, int end, int grain, int budget, const std::function<void(int, int)> &body) {
+    std::atomic<long long> next{begin};
+    auto participant = [&] {
+        ThreadBudgetScope serial(1);
+        for (;;) {
+            const long long from = next.fetch_add(grain);
+            if (from >= end) break;
+            body(static_cast<int>(from), static_cast<int>(std::min<long long>(end, from + grain)));
+        }
+    };
+    TaskGroup group(scheduler);
+    for (int i = 1; i < budget; ++i) group.run(participant);
+    participant();
+    group.wait();
+}
+
+} // namespace
+
+void parallelFor(int begin, int end, int grain, const std::function<void(int from, int to)> &body, bool parallel,
+                 TaskScheduler &scheduler) {
+    rassert(grain >= 0, 12390847561004, grain);
+    if (begin >= end) return;
+    const int n = end - begin;
+    const int budget = threadBudget();
+    if (!parallel || scheduler.workers() == 0 || budget == 1) {
+        body(begin, end);
+        return;
+    }
+    if (budget > 0 && budget < scheduler.concurrency()) {
+        if (grain == 0) grain = std::max(1, n / (8 * budget));
+        budgetedRanges(scheduler, begin, end, grain, budget, body);
+        return;
+    }
+    if (grain == 0) grain = std::max(1, n / (8 * scheduler.concurrency()));
+
+    TaskGroup group(scheduler); // if body throws here, the destructor still waits for the spawned ranges (they use body)
+    splitRange(group, begin, end, grain, body);
+    group.wait();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool (std::thread, so it does not depend on OpenMP being available).
+// Each worker has its own deque: tasks spawned on a worker go to the back of its deque and are taken by it from
+// the back (the most recent ones, hot in cache), idle workers steal from the front of the others (the oldest ones -
+// usually the largest halves of a recursively split range). Tasks of other threads go to a shared queue.
+// A thread waiting for a TaskGroup runs pending tasks meanwhile, so nested parallelism does not deadlock
+// and does not need more threads.
+class TaskScheduler final {
+  public:
+    struct Options {
+        // Worker threads, 0 - availableCpus() - 1 (the thread that waits also works), so that under a cgroup CPU quota
+        // or an affinity mask the pool does not oversubscribe what it gets (see cpu_budget.h)
+        int threads = 0;
+        // Worker i is pinned to CPU affinity[i % affinity.size()], empty - not pinned (Linux only, ignored elsewhere)
+        std::vector<int> affinity;
+    };
+
+    explicit TaskScheduler(const Options &options);
+    TaskScheduler();
+    // Pending tasks must be waited for before
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    // Worker threads (without the waiting thread)
+    int workers() const noexcept { return static_cast<int>(workers_.size()); }
+    // Threads that can run tasks at once: workers and the waiting thread
+    int concurrency() const noexcept { return workers() + 1; }
+
+    // Used by TaskGroup and parallelFor unless another scheduler is passed.
+    // Created at first use with the options of setGlobalOptions (the defaults if it was not called).
+    static TaskScheduler &global();
+    // Only before the first use of global()
+    static void setGlobalOptions(const Options &options);
+
+    void spawn(std::function<void()> task);
+    // Runs one pending task on the calling thread (its own deque first, then the shared queue, then steals),
+    // false if there was none
+    bool runPending();
+
+  private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+    bool popTask(int self, std::function<void()> &task);
+    void workerLoop(int self);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex sharedMutex_;
+    std::deque<std::function<void()>> shared_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<int> queued_{0}; // tasks in all deques
+    bool stopping_ = false;
+};
+
+// Fork/join: tasks run on the scheduler, wait() joins them and rethrows the first exception of a task
+class TaskGroup final {
+  public:
+    explicit TaskGroup(TaskScheduler &scheduler = TaskScheduler::global());
+    // Waits for the tasks (their exceptions are dropped, call wait() to get them)
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    void run(std::function<void()> task);
+    // Runs pending tasks on the calling thread until all tasks of the group are done
+    void wait();
+
+  private:
+    void join() noexcept;
+
+    TaskScheduler &scheduler_;
+    std::atomic<int> pending_{0};
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+};
+
+// Calls body(from, to) for disjoint ranges covering [begin, end), each at most grain long (0 - about 8 ranges per thread).
+// The range is split in halves recursively, so that idle threads steal large parts. parallel = false (or a scheduler
+// without workers) - one call on the calling thread. Exceptions of body are rethrown (the first one) after all ranges are done.
+// Within a ThreadBudgetScope of fewer threads than the scheduler has, the ranges are taken one by one from a shared counter
+// by just that many threads (the calling one included), and parallel loops nested in body run on the thread of their range.
+void parallelFor(int begin, int end, int grain, const std::function<void(int from, int to)> &body, bool parallel = true,
+                 TaskScheduler &scheduler = TaskScheduler::global());
+
+// The same by indices: body(i) for every i in [begin, end)
+template <typename Body>
+void parallelForEach(int begin, int end, Body &&body, bool parallel = true, TaskScheduler &scheduler = TaskScheduler::global()) {
+    parallelFor(begin, end, 0, [&](int from, int to) {
+        for (int i = from; i < to; ++i) body(i);
+    }, parallel, scheduler);
+}
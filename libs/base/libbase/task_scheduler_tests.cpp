@@ -0,0 +1,99 @@
+#include "task_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+TEST(TaskScheduler, ParallelForCoversRangeOnce) {
+    TaskScheduler::Options options;
+    options.threads = 3;
+    TaskScheduler scheduler(options);
+    EXPECT_EQ(scheduler.workers(), 3);
+    EXPECT_EQ(scheduler.concurrency(), 4);
+
+    for (int grain : {0, 1, 7, 1000}) {
+        std::vector<std::atomic<int>> hits(1000);
+        parallelFor(0, 1000, grain, [&](int from, int to) {
+            EXPECT_LT(from, to);
+            if (grain > 0) EXPECT_LE(to - from, grain);
+            for (int i = from; i < to; ++i) hits[i].fetch_add(1);
+        }, true, scheduler);
+        for (const std::atomic<int> &h : hits) EXPECT_EQ(h.load(), 1);
+    }
+}
+
+TEST(TaskScheduler, SerialAndWithoutWorkersIsOneCall) {
+    TaskScheduler::Options options;
+    options.threads = 2;
+    TaskScheduler scheduler(options);
+    int calls = 0;
+    parallelFor(5, 100, 1, [&](int from, int to) {
+        ++calls;
+        EXPECT_EQ(from, 5);
+        EXPECT_EQ(to, 100);
+    }, false, scheduler);
+    EXPECT_EQ(calls, 1);
+
+    parallelFor(3, 3, 1, [&](int, int) { ++calls; }, true, scheduler);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(TaskScheduler, NestedForkJoin) {
+    TaskScheduler::Options options;
+    options.threads = 2;
+    TaskScheduler scheduler(options);
+
+    // every outer range waits for its own inner parallelFor - it must not deadlock even with fewer threads than ranges
+    std::vector<long long> sums(64, 0);
+    parallelForEach(0, 64, [&](int i) {
+        std::atomic<long long> sum = 0;
+        parallelForEach(0, 1000, [&](int j) { sum += j * (i + 1); }, true, scheduler);
+        sums[i] = sum;
+    }, true, scheduler);
+    for (int i = 0; i < 64; ++i) EXPECT_EQ(sums[i], 499500LL * (i + 1));
+
+    TaskGroup group(scheduler);
+    std::atomic<int> done = 0;
+    for (int i = 0; i < 10; ++i) {
+        group.run([&] {
+            TaskGroup inner(scheduler);
+            for (int k = 0; k < 10; ++k) inner.run([&] { done++; });
+            inner.wait();
+        });
+    }
+    group.wait();
+    EXPECT_EQ(done.load(), 100);
+}
+
+TEST(TaskScheduler, ExceptionsAreRethrownAfterJoin) {
+    TaskScheduler::Options options;
+    options.threads = 2;
+    TaskScheduler scheduler(options);
+
+    std::atomic<int> finished = 0;
+    EXPECT_THROW(parallelFor(0, 100, 1, [&](int from, int) {
+        if (from == 50) throw std::runtime_error("range 50");
+        finished++;
+    }, true, scheduler), std::runtime_error);
+    EXPECT_EQ(finished.load(), 99);
+
+    TaskGroup group(scheduler);
+    group.run([] { throw std::runtime_error("task"); });
+    group.run([&] { finished++; });
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(finished.load(), 100);
+    group.wait(); // the error is reported once
+}
+
+TEST(TaskScheduler, PinnedWorkersRun) {
+    TaskScheduler::Options options;
+    options.threads = 2;
+    options.affinity = {0};
+    TaskScheduler scheduler(options);
+    std::vector<int> values(100);
+    parallelForEach(0, 100, [&](int i) { values[i] = i; }, true, scheduler);
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), 0), 4950);
+}
@@ -0,0 +1,155 @@
+#include "vantage_point_tree.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <queue>
+#include <utility>
+
+namespace {
+
+constexpr std::uint32_t kFileMagic = 0x31545056; // "VPT1"
+
+bool closer(const VantagePointIndex::Neighbour &a, const VantagePointIndex::Neighbour &b) {
+    return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+}
+
+} // namespace
+
+VantagePointIndex::VantagePointIndex(int dimension) : dimension_(dimension) {
+    rassert(dimension > 0, 3481290471001, dimension);
+}
+
+const std::uint8_t *VantagePointIndex::point(int id) const {
+    rassert(id >= 0 && id < size(), 3481290471002, id, size());
+    return points_.data() + static_cast<std::size_t>(id) * dimension_;
+}
+
+int VantagePointIndex::distance(const std::uint8_t *a, int id) const {
+    const std::uint8_t *b = points_.data() + static_cast<std::size_t>(id) * dimension_;
+    int d = 0;
+    for (int i = 0; i < dimension_; ++i) d += std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+    return d;
+}
+
+int VantagePointIndex::build(Tree &tree, std::vector<int> &ids, std::size_t from, std::size_t to) const {
+    if (from == to) return -1;
+
+    // the first point is the vantage point, the rest are split by the median distance to it
+    const int node = static_cast<int>(tree.nodes.size());
+    tree.nodes.push_back({ids[from], 0, -1, -1});
+    const std::uint8_t *vantage = point(ids[from]);
+    ++from;
+    if (from == to) return node;
+
+    std::vector<std::pair<int, int>> byDistance;
+    byDistance.reserve(to - from);
+    for (std::size_t k = from; k < to; ++k) byDistance.emplace_back(distance(vantage, ids[k]), ids[k]);
+    const std::size_t middle = byDistance.size() / 2;
+    std::nth_element(byDistance.begin(), byDistance.begin() + middle, byDistance.end());
+    for (std::size_t k = 0; k < byDistance.size(); ++k) ids[from + k] = byDistance[k].second;
+
+    tree.nodes[node].threshold = byDistance[middle].first;
+    const int inside = build(tree, ids, from, from + middle);
+    const int outside = build(tree, ids, from + middle, to);
+    tree.nodes[node].inside = inside;
+    tree.nodes[node].outside = outside;
+    return node;
+}
+
+int VantagePointIndex::add(const std::uint8_t *p) {
+    const int id = size();
+    points_.insert(points_.end(), p, p + dimension_);
+
+    // binary counter: the new point and all full trees below the first empty level are merged into that level
+    std::vector<int> ids = {id};
+    std::size_t level = 0;
+    while (level < trees_.size() && !trees_[level].nodes.empty()) {
+        for (const Node &node : trees_[level].nodes) ids.push_back(node.id);
+        trees_[level].nodes.clear();
+        ++level;
+    }
+    if (level == trees_.size()) trees_.emplace_back();
+    std::sort(ids.begin(), ids.end());
+    trees_[level].nodes.reserve(ids.size());
+    build(trees_[level], ids, 0, ids.size());
+    return id;
+}
+
+std::vector<VantagePointIndex::Neighbour> VantagePointIndex::nearest(const std::uint8_t *query, int k,
+                                                                     const std::function<bool(int)> &accept) const {
+    rassert(k >= 0, 3481290471003, k);
+    if (k == 0) return {};
+
+    // max-heap of the best k found so far, its top is the farthest of them
+    auto farther = [](const Neighbour &a, const Neighbour &b) { return closer(a, b); };
+    std::priority_queue<Neighbour, std::vector<Neighbour>, decltype(farther)> best(farther);
+    auto tau = [&]() { return static_cast<int>(best.size()) < k ? std::numeric_limits<int>::max() : best.top().distance; };
+
+    std::vector<int> stack;
+    for (const Tree &tree : trees_) {
+        if (tree.nodes.empty()) continue;
+        stack.assign(1, 0);
+        while (!stack.empty()) {
+            const Node &node = tree.nodes[stack.back()];
+            stack.pop_back();
+
+            const int d = distance(query, node.id);
+            if (!accept || accept(node.id)) {
+                const Neighbour candidate{node.id, d};
+                if (static_cast<int>(best.size()) < k) {
+                    best.push(candidate);
+                } else if (closer(candidate, best.top())) {
+                    best.pop();
+                    best.push(candidate);
+                }
+            }
+
+            // equal distances are kept on both sides, because ties are resolved by ids
+            const int t = tau();
+            const bool visitInside = node.inside != -1 && (t == std::numeric_limits<int>::max() || d - t <= node.threshold);
+            const bool visitOutside = node.outside != -1 && (t == std::numeric_limits<int>::max() || d + t >= node.threshold);
+            // the side with the query is pushed last, so it is searched first and tightens tau sooner
+            if (d <= node.threshold) {
+                if (visitOutside) stack.push_back(node.outside);
+                if (visitInside) stack.push_back(node.inside);
+            } else {
+                if (visitInside) stack.push_back(node.inside);
+                if (visitOutside) stack.push_back(node.outside);
+            }
+        }
+    }
+
+    std::vector<Neighbour> res(best.size());
+    for (std::size_t i = res.size(); i-- > 0;) {
+        res[i] = best.top();
+        best.pop();
+    }
+    return res;
+}
+
+void VantagePointIndex::save(std::ostream &out) const {
+    const std::uint32_t header[3] = {kFileMagic, static_cast<std::uint32_t>(dimension_), static_cast<std::uint32_t>(size())};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(points_.data()), static_cast<std::streamsize>(points_.size()));
+    rassert(out.good(), 3481290471004);
+}
+
+VantagePointIndex VantagePointIndex::load(std::istream &in) {
+    std::uint32_t header[3] = {};
+    in.read(reinterpret_cast<char *>(header), sizeof(header));
+    rassert(in.good() && header[0] == kFileMagic, 3481290471005, header[0]);
+
+    VantagePointIndex index(static_cast<int>(header[1]));
+    std::vector<std::uint8_t> p(header[1]);
+    for (std::uint32_t id = 0; id < header[2]; ++id) {
+        in.read(reinterpret_cast<char *>(p.data()), static_cast<std::streamsize>(p.size()));
+        rassert(in.good(), 3481290471006, id, header[2]);
+        index.add(p.data());
+    }
+    return index;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
+// Exact k nearest neighbours of fixed-size byte vectors by L1 distance (a metric, so a vantage-point tree prunes
+// by the triangle inequality in sub-linear time on clustered data).
+// Points can be added one by one: they are kept in trees of 1, 2, 4, ... points (logarithmic method),
+// adding rebuilds only the small trees, so n additions cost O(n log^2 n) distance computations.
+class VantagePointIndex final {
+public:
+    struct Neighbour {
+        int id = -1;
+        int distance = 0;
+    };
+
+    explicit VantagePointIndex(int dimension);
+
+    int dimension() const noexcept { return dimension_; }
+    int size() const noexcept { return static_cast<int>(points_.size() / static_cast<std::size_t>(dimension_)); }
+    const std::uint8_t *point(int id) const;
+
+    // Returns id of the added point, ids are consecutive from 0
+    int add(const std::uint8_t *point);
+
+    // Up to k nearest points sorted by (distance, id), points with accept(id) == false are skipped
+    std::vector<Neighbour> nearest(const std::uint8_t *query, int k, const std::function<bool(int)> &accept = {}) const;
+
+    // Binary format: the points in the order of ids, so that an index can be reused by the next run on the same data
+    void save(std::ostream &out) const;
+    static VantagePointIndex load(std::istream &in);
+
+private:
+    struct Node {
+        int id = -1;        // vantage point
+        int threshold = 0;  // points of inside subtree are not farther than threshold, of outside - not closer
+        int inside = -1;
+        int outside = -1;
+    };
+
+    struct Tree {
+        std::vector<Node> nodes;  // nodes[0] is the root
+    };
+
+    int distance(const std::uint8_t *a, int id) const;
+    int build(Tree &tree, std::vector<int> &ids, std::size_t from, std::size_t to) const;
+
+    int dimension_;
+    std::vector<std::uint8_t> points_;
+    std::vector<Tree> trees_;  // trees_[i] has either 0 or 2^i points
+};
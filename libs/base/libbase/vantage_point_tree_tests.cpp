@@ -0,0 +1,92 @@
+#include "vantage_point_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+std::vector<VantagePointIndex::Neighbour> bruteForce(const VantagePointIndex &index, const std::uint8_t *query, int k, int excludedParity = -1) {
+    std::vector<VantagePointIndex::Neighbour> all;
+    for (int id = 0; id < index.size(); ++id) {
+        if (id % 2 == excludedParity) continue;
+        int d = 0;
+        for (int i = 0; i < index.dimension(); ++i) d += std::abs(int(query[i]) - int(index.point(id)[i]));
+        all.push_back({id, d});
+    }
+    std::sort(all.begin(), all.end(), [](const auto &a, const auto &b) { return a.distance != b.distance ? a.distance < b.distance : a.id < b.id; });
+    all.resize(std::min<size_t>(all.size(), k));
+    return all;
+}
+
+void expectSame(const std::vector<VantagePointIndex::Neighbour> &a, const std::vector<VantagePointIndex::Neighbour> &b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        EXPECT_EQ(a[i].id, b[i].id) << i;
+        EXPECT_EQ(a[i].distance, b[i].distance) << i;
+    }
+}
+
+std::vector<std::uint8_t> randomPoint(FastRandom &r, int dimension, int maxValue) {
+    std::vector<std::uint8_t> p(static_cast<size_t>(dimension));
+    for (std::uint8_t &x : p) x = static_cast<std::uint8_t>(r.nextInt(0, maxValue));
+    return p;
+}
+
+} // namespace
+
+TEST(vantage_point_tree, emptyIndex) {
+    VantagePointIndex index(4);
+    const std::uint8_t q[4] = {1, 2, 3, 4};
+    EXPECT_EQ(index.size(), 0);
+    EXPECT_TRUE(index.nearest(q, 3).empty());
+}
+
+TEST(vantage_point_tree, matchesBruteForceWhileGrowing) {
+    FastRandom r(21);
+    for (int maxValue : {2, 255}) { // small value range makes a lot of equal distances
+        VantagePointIndex index(12);
+        for (int n = 1; n <= 150; ++n) {
+            index.add(randomPoint(r, 12, maxValue).data());
+            if (n % 7 != 0 && n != 1 && n != 64 && n != 65) continue;
+            for (int q = 0; q < 5; ++q) {
+                const std::vector<std::uint8_t> query = randomPoint(r, 12, maxValue);
+                for (int k : {1, 4, 200}) {
+                    expectSame(index.nearest(query.data(), k), bruteForce(index, query.data(), k));
+                }
+            }
+        }
+    }
+}
+
+TEST(vantage_point_tree, acceptFilter) {
+    FastRandom r(22);
+    VantagePointIndex index(8);
+    for (int n = 0; n < 100; ++n) index.add(randomPoint(r, 8, 255).data());
+    for (int q = 0; q < 10; ++q) {
+        const std::vector<std::uint8_t> query = randomPoint(r, 8, 255);
+        expectSame(index.nearest(query.data(), 5, [](int id) { return id % 2 != 1; }), bruteForce(index, query.data(), 5, 1));
+    }
+}
+
+TEST(vantage_point_tree, saveLoadRoundTrip) {
+    FastRandom r(23);
+    VantagePointIndex index(6);
+    for (int n = 0; n < 37; ++n) index.add(randomPoint(r, 6, 255).data());
+
+    std::stringstream stream;
+    index.save(stream);
+    const VantagePointIndex loaded = VantagePointIndex::load(stream);
+    EXPECT_EQ(loaded.dimension(), 6);
+    ASSERT_EQ(loaded.size(), 37);
+    for (int q = 0; q < 10; ++q) {
+        const std::vector<std::uint8_t> query = randomPoint(r, 6, 255);
+        expectSame(loaded.nearest(query.data(), 3), index.nearest(query.data(), 3));
+    }
+}
@@ -0,0 +1,63 @@
+#include "bilinear_kernels.h"
+
+#include <libbase/cpu_features.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace bilinear_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// bilinear_kernels_avx2.cpp (compiled with AVX2 enabled)
+const Kernels &avx2Kernels();
+#endif
+
+namespace {
+
+void sampleScalar(const Source &src, const float *sx, const float *sy, int n, std::uint8_t *dst, std::size_t channelStride) {
+    const int W = src.width;
+    const int H = src.height;
+    const int C = src.channels;
+    for (int i = 0; i < n; ++i) {
+        const float x = std::clamp(sx[i], 0.0f, float(W - 1));
+        const float y = std::clamp(sy[i], 0.0f, float(H - 1));
+        const int x0 = static_cast<int>(x);
+        const int y0 = static_cast<int>(y);
+        const int x1 = std::min(x0 + 1, W - 1);
+        const int y1 = std::min(y0 + 1, H - 1);
+        const float fx = x - float(x0);
+        const float fy = y - float(y0);
+
+        const std::uint8_t *r0 = src.image + static_cast<std::size_t>(y0) * src.stride;
+        const std::uint8_t *r1 = src.image + static_cast<std::size_t>(y1) * src.stride;
+        for (int c = 0; c < C; ++c) {
+            const float c00 = r0[x0 * C + c], c10 = r0[x1 * C + c];
+            const float c01 = r1[x0 * C + c], c11 = r1[x1 * C + c];
+            const float top = c00 * (1 - fx) + c10 * fx;
+            const float bottom = c01 * (1 - fx) + c11 * fx;
+            const long v = std::lround(top * (1 - fy) + bottom * fy);
+            dst[static_cast<std::size_t>(c) * channelStride + i] = static_cast<std::uint8_t>(std::clamp(v, 0L, 255L));
+        }
+    }
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", sampleScalar};
+    return kernels;
+}
+
+const Kernels *avx2() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2) return &avx2Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = avx2() ? *avx2() : scalar();
+    return kernels;
+}
+
+} // namespace bilinear_kernels
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Bilinear sampling of an 8-bit image at arbitrary fractional positions (f.e. along a side of a piece straight from
+// the photo), one implementation per instruction set (picked at runtime by CPU features).
+// All of them do the same IEEE operations in the same order (no fused multiply-add), so results are identical.
+namespace bilinear_kernels {
+
+// 1 or 3 channels, rows are stride bytes apart
+struct Source {
+    const std::uint8_t *image = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::size_t stride = 0;
+};
+
+// Samples of n positions (coordinates clamped to the image, values rounded as std::lround), planar:
+// channel c of sample i is written to dst[c * channelStride + i]. Integer positions give exactly the pixels.
+using SampleFn = void (*)(const Source &src, const float *sx, const float *sy, int n, std::uint8_t *dst, std::size_t channelStride);
+
+struct Kernels {
+    const char *name;
+    SampleFn sample;
+};
+
+// Portable loops
+const Kernels &scalar();
+// nullptr if not compiled in or not supported by current CPU
+const Kernels *avx2();
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace bilinear_kernels
@@ -0,0 +1,97 @@
+#include "bilinear_kernels.h"
+
+#include <immintrin.h>
+
+#include <cstdint>
+#include <limits>
+
+namespace bilinear_kernels {
+
+const Kernels &scalar();
+
+namespace {
+
+// std::lround for non-negative floats: truncated value plus a unit if the fraction (exact in float) is at least a half
+__m256i roundNonNegative(__m256 v) {
+    const __m256 t = _mm256_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256 up = _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(v, t), _mm256_set1_ps(0.5f), _CMP_GE_OQ), _mm256_set1_ps(1.0f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(t, up));
+}
+
+// 8 samples per step: clamping, weights and interpolation are vectorized, the 4 neighbours of every sample are
+// fetched with 32-bit gathers (all channels of a pixel at once), the last pixels of the image (where a 4-byte
+// read would cross its end) go to the scalar loop
+void sampleAvx2(const Source &src, const float *sx, const float *sy, int n, std::uint8_t *dst, std::size_t channelStride) {
+    const int C = src.channels;
+    const std::size_t bytes = static_cast<std::size_t>(src.height - 1) * src.stride + static_cast<std::size_t>(src.width) * C;
+    if (bytes > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+        scalar().sample(src, sx, sy, n, dst, channelStride);
+        return;
+    }
+    const int *base = reinterpret_cast<const int *>(src.image);
+    const __m256i lastSafe = _mm256_set1_epi32(static_cast<int>(bytes) - 4);
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 maxX = _mm256_set1_ps(float(src.width - 1));
+    const __m256 maxY = _mm256_set1_ps(float(src.height - 1));
+    const __m256i lastX = _mm256_set1_epi32(src.width - 1);
+    const __m256i lastY = _mm256_set1_epi32(src.height - 1);
+    const __m256i channels = _mm256_set1_epi32(C);
+    const __m256i stride = _mm256_set1_epi32(static_cast<int>(src.stride));
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+
+    alignas(32) int out[8];
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(sx + i), zero), maxX);
+        const __m256 y = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(sy + i), zero), maxY);
+        const __m256i ix0 = _mm256_cvttps_epi32(x);
+        const __m256i iy0 = _mm256_cvttps_epi32(y);
+        const __m256i ix1 = _mm256_min_epi32(_mm256_add_epi32(ix0, _mm256_set1_epi32(1)), lastX);
+        const __m256i iy1 = _mm256_min_epi32(_mm256_add_epi32(iy0, _mm256_set1_epi32(1)), lastY);
+        const __m256 fx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix0));
+        const __m256 fy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy0));
+
+        const __m256i row0 = _mm256_mullo_epi32(iy0, stride);
+        const __m256i row1 = _mm256_mullo_epi32(iy1, stride);
+        const __m256i col0 = _mm256_mullo_epi32(ix0, channels);
+        const __m256i col1 = _mm256_mullo_epi32(ix1, channels);
+        const __m256i o11 = _mm256_add_epi32(row1, col1);
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(o11, lastSafe)) != 0) {
+            scalar().sample(src, sx + i, sy + i, 8, dst + i, channelStride);
+            continue;
+        }
+        const __m256i p00 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row0, col0), 1);
+        const __m256i p10 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row0, col1), 1);
+        const __m256i p01 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row1, col0), 1);
+        const __m256i p11 = _mm256_i32gather_epi32(base, o11, 1);
+
+        const __m256 gx = _mm256_sub_ps(one, fx);
+        const __m256 gy = _mm256_sub_ps(one, fy);
+        for (int c = 0; c < C; ++c) {
+            const __m128i shift = _mm_cvtsi32_si128(8 * c);
+            const __m256 c00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p00, shift), byteMask));
+            const __m256 c10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p10, shift), byteMask));
+            const __m256 c01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p01, shift), byteMask));
+            const __m256 c11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p11, shift), byteMask));
+            const __m256 top = _mm256_add_ps(_mm256_mul_ps(c00, gx), _mm256_mul_ps(c10, fx));
+            const __m256 bottom = _mm256_add_ps(_mm256_mul_ps(c01, gx), _mm256_mul_ps(c11, fx));
+            const __m256 v = _mm256_add_ps(_mm256_mul_ps(top, gy), _mm256_mul_ps(bottom, fy));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(out), roundNonNegative(v));
+            std::uint8_t *to = dst + static_cast<std::size_t>(c) * channelStride + i;
+            for (int l = 0; l < 8; ++l) to[l] = static_cast<std::uint8_t>(out[l]);
+        }
+    }
+    if (i < n) scalar().sample(src, sx + i, sy + i, n - i, dst + i, channelStride);
+}
+
+} // namespace
+
+const Kernels &avx2Kernels() {
+    static const Kernels kernels{"avx2", sampleAvx2};
+    return kernels;
+}
+
+} // namespace bilinear_kernels
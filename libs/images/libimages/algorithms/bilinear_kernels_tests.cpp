@@ -0,0 +1,60 @@
+#include "bilinear_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+TEST(bilinear_kernels, bestIsAvailable) {
+    const bilinear_kernels::Kernels &best = bilinear_kernels::best();
+    EXPECT_NE(best.sample, nullptr);
+    std::cout << "bilinear kernels: " << best.name << std::endl;
+}
+
+TEST(bilinear_kernels, scalarSamples) {
+    const std::uint8_t image[] = {10, 20, 30, 40}; // 2x2, 1 channel
+    bilinear_kernels::Source src{image, 2, 2, 1, 2};
+    const float sx[] = {0.0f, 1.0f, 0.5f, 0.5f, 5.0f, -1.0f};
+    const float sy[] = {0.0f, 1.0f, 1.0f, 0.5f, 0.0f, 0.24f};
+    std::uint8_t dst[6];
+    bilinear_kernels::scalar().sample(src, sx, sy, 6, dst, 6);
+    EXPECT_EQ(dst[0], 10); // exact pixels
+    EXPECT_EQ(dst[1], 40);
+    EXPECT_EQ(dst[2], 35); // (30 + 40) / 2
+    EXPECT_EQ(dst[3], 25);
+    EXPECT_EQ(dst[4], 20); // clamped to the image
+    EXPECT_EQ(dst[5], 15); // 10 * 0.76 + 30 * 0.24 = 14.8
+}
+
+TEST(bilinear_kernels, avx2MatchesScalar) {
+    const bilinear_kernels::Kernels *avx2 = bilinear_kernels::avx2();
+    if (!avx2) GTEST_SKIP() << "AVX2 kernels are not available";
+
+    FastRandom r(239);
+    for (int channels : {1, 3}) {
+        const int w = 37, h = 23;
+        const std::size_t stride = static_cast<std::size_t>(w) * channels + 5; // rows with padding
+        // the image ends right after its last pixel, so that a wrong gather would read out of bounds (under sanitizers)
+        std::vector<std::uint8_t> image(stride * (h - 1) + static_cast<std::size_t>(w) * channels);
+        for (std::uint8_t &v : image) v = static_cast<std::uint8_t>(r.nextInt(0, 255));
+        const bilinear_kernels::Source src{image.data(), w, h, channels, stride};
+        for (int iter = 0; iter < 50; ++iter) {
+            const int n = r.nextInt(1, 70);
+            std::vector<float> sx(static_cast<size_t>(n)), sy(static_cast<size_t>(n));
+            for (int i = 0; i < n; ++i) {
+                // half-integers hit the rounding ties, the rest spans outside of the image and its last pixels too
+                const bool tie = r.nextInt(0, 3) == 0;
+                sx[i] = tie ? r.nextInt(-4, 80) * 0.5f : r.nextFloat(-3.0f, 40.0f);
+                sy[i] = tie ? r.nextInt(-4, 50) * 0.5f : r.nextFloat(-3.0f, 26.0f);
+            }
+            std::vector<std::uint8_t> expected(static_cast<size_t>(n) * channels, 1);
+            std::vector<std::uint8_t> actual(static_cast<size_t>(n) * channels, 1);
+            bilinear_kernels::scalar().sample(src, sx.data(), sy.data(), n, expected.data(), static_cast<size_t>(n));
+            avx2->sample(src, sx.data(), sy.data(), n, actual.data(), static_cast<size_t>(n));
+            ASSERT_EQ(actual, expected);
+        }
+    }
+}
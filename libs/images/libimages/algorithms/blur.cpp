@@ -1,333 +1,345 @@
 #include "blur.h"
 
+#include "blur_kernels.h"
+#include "filter_utils.h"
+#include "integral_image.h"
+
+#include <libbase/profiler.h>
 #include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/channels.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
+#include <memory>
 #include <type_traits>
 #include <vector>
 
 namespace {
 
-inline int clampi(int v, int lo, int hi) noexcept {
-    return std::max(lo, std::min(hi, v));
-}
-
-struct Kernel1D {
-    std::vector<float> w;
-    int r = 0;
-};
-
-inline Kernel1D makeGaussianKernel(float sigma) {
-    Kernel1D k;
-    if (!(sigma > 0.0f)) return k;
-
-    const float s = std::max(0.001f, sigma);
-    k.r = std::max(0, static_cast<int>(std::ceil(3.0f * s)));
-    const int R = k.r;
-    if (R == 0) return k;
-
-    k.w.assign(static_cast<size_t>(2 * R + 1), 0.0f);
-
-    const float inv2s2 = 1.0f / (2.0f * s * s);
-
-    float sum = 0.0f;
-    for (int i = 0; i <= R; ++i) {
-        const float v = std::exp(-(float)(i * i) * inv2s2);
-        k.w[static_cast<size_t>(R + i)] = v;
-        k.w[static_cast<size_t>(R - i)] = v;
-        sum += (i == 0) ? v : (2.0f * v);
+using filter_utils::clampi;
+using filter_utils::from_f;
+using filter_utils::Kernel1D;
+using filter_utils::cachedGaussianKernel;
+using filter_utils::to_f;
+
+// --------------------- Image blur: 1 or 3 channels ---------------------
+
+// Row pixels [x0 - R, x0 + n + R) with C channels as floats, pixels outside of [0, W) replicate the border ones
+template <int C, typename T>
+void padRowPart(const T* src, int W, int R, int x0, int n, float* padded) {
+    for (int x = x0 - R; x < x0 + n + R; ++x) {
+        const T* px = src + static_cast<size_t>(clampi(x, 0, W - 1)) * C;
+        float* dst = padded + static_cast<size_t>(x - x0 + R) * C;
+        for (int c = 0; c < C; ++c) dst[c] = to_f(px[c]);
     }
-
-    const float invSum = (sum > 0.0f) ? (1.0f / sum) : 1.0f;
-    for (float& v : k.w) v *= invSum;
-
-    return k;
 }
 
-template <typename T>
-inline float to_f(T v) noexcept {
-    if constexpr (std::is_same_v<T, float>) return v;
-    return static_cast<float>(v);
-}
+// Horizontally filtered rows of a tile take about this much (so that they stay in L2 with the output rows)
+constexpr size_t kTileRingBytes = 256 * 1024;
 
-template <typename T>
-inline T from_f(float v) noexcept {
-    if constexpr (std::is_same_v<T, float>) {
-        return v;
-    } else if constexpr (std::is_same_v<T, std::uint8_t>) {
-        v = std::clamp(v, 0.0f, 255.0f);
-        return static_cast<std::uint8_t>(std::lround(v));
-    } else if constexpr (std::is_integral_v<T>) {
-        return static_cast<T>(std::lround(v));
-    } else {
-        return static_cast<T>(v);
-    }
+// Pixels per column strip, so that taps rows of a strip fit into kTileRingBytes (the whole row if it is narrower)
+int stripPixels(int W, int C, int taps) {
+    const size_t floats = kTileRingBytes / sizeof(float) / static_cast<size_t>(taps);
+    const int pixels = static_cast<int>(std::max<size_t>(64, floats / static_cast<size_t>(C)));
+    return std::min(pixels, W);
 }
 
-// --------------------- Image blur: 1 channel ---------------------
-
+// Separable pass, horizontal then vertical, by tiles of rows x column strips. Each tile keeps a ring of taps
+// horizontally filtered rows of its strip that slides down with the output row, so that every source row
+// is filtered once per tile (plus 2R halo rows per band) and the vertical taps read rows hot in cache,
+// instead of a full-image float buffer and a vertical pass over taps full-width rows per output row.
+// Channels are interleaved, so a horizontal tap is just a shift by C floats and both passes are plain 1D row kernels;
+// every value is computed by the same kernel calls in the same tap order as with whole rows.
 template <typename T>
-Image<T> blur_gray(const Image<T>& image, const Kernel1D& k) {
+void blur_image(ImageView<const T> image, const Kernel1D& k, const blur_kernels::Kernels& kernels, Image<T>& out) {
     const int W = image.width();
     const int H = image.height();
+    const int C = image.channels();
     const int R = k.r;
+    const int taps = 2 * R + 1;
     const float* kw = k.w.data();
 
-    std::vector<float> tmp(static_cast<size_t>(W) * static_cast<size_t>(H), 0.0f);
-
-    #pragma omp parallel for
-    for (int y = 0; y < H; ++y) {
-        const size_t row = static_cast<size_t>(y) * static_cast<size_t>(W);
-
-        const int leftEnd = std::min(R, W);
-        for (int x = 0; x < leftEnd; ++x) {
-            float acc = 0.0f;
-            for (int dx = -R; dx <= R; ++dx) {
-                const int sx = clampi(x + dx, 0, W - 1);
-                acc += kw[dx + R] * to_f(image(y, sx));
-            }
-            tmp[row + static_cast<size_t>(x)] = acc;
-        }
-
-        const int midBegin = R;
-        const int midEnd = W - R;
-        if (midBegin < midEnd) {
-            for (int x = midBegin; x < midEnd; ++x) {
-                float acc = 0.0f;
-                for (int dx = -R; dx <= R; ++dx) {
-                    acc += kw[dx + R] * to_f(image(y, x + dx));
+    out.ensureSize(W, H, C);
+
+    const int strip = stripPixels(W, C, taps);
+    const int strips = (W + strip - 1) / strip;
+    const int bandRows = std::max(64, 16 * taps); // halo rows are at most 1/8 of the band
+    const int bands = (H + bandRows - 1) / bandRows;
+
+    parallelForEach(0, bands * strips, [&](int tile) {
+        const int y0 = (tile / strips) * bandRows;
+        const int y1 = std::min(H, y0 + bandRows);
+        const int x0 = (tile % strips) * strip;
+        const int w = std::min(strip, W - x0);
+        const size_t n = static_cast<size_t>(w) * static_cast<size_t>(C);
+
+        std::vector<float> padded(static_cast<size_t>(w + 2 * R) * static_cast<size_t>(C));
+        std::vector<float> ring(n * static_cast<size_t>(taps));
+        std::vector<int> ringRow(static_cast<size_t>(taps), -1); // source row in each slot
+        std::vector<const float*> rows(static_cast<size_t>(taps));
+        std::vector<float> acc(std::is_same_v<T, float> ? 0 : n);
+
+        for (int y = y0; y < y1; ++y) {
+            // rows of the window are consecutive (clamped), so slot row % taps never holds another row of it
+            for (int d = 0; d < taps; ++d) {
+                const int row = clampi(y + d - R, 0, H - 1);
+                float* filtered = ring.data() + static_cast<size_t>(row % taps) * n;
+                if (ringRow[row % taps] != row) {
+                    dispatch_channels(C, [&](auto c) { padRowPart<decltype(c)::value>(image.ptr(row), W, R, x0, w, padded.data()); });
+                    kernels.convolveStrided(padded.data(), filtered, static_cast<int>(n), kw, taps, C);
+                    ringRow[row % taps] = row;
                 }
-                tmp[row + static_cast<size_t>(x)] = acc;
+                rows[d] = filtered;
             }
-        }
-
-        const int rightBegin = std::max(leftEnd, midEnd);
-        for (int x = rightBegin; x < W; ++x) {
-            float acc = 0.0f;
-            for (int dx = -R; dx <= R; ++dx) {
-                const int sx = clampi(x + dx, 0, W - 1);
-                acc += kw[dx + R] * to_f(image(y, sx));
+            T* dst = out.ptr(y) + static_cast<size_t>(x0) * C;
+            if constexpr (std::is_same_v<T, float>) {
+                kernels.convolveRows(rows.data(), dst, static_cast<int>(n), kw, taps);
+            } else {
+                kernels.convolveRows(rows.data(), acc.data(), static_cast<int>(n), kw, taps);
+                for (size_t i = 0; i < n; ++i) dst[i] = from_f<T>(acc[i]);
             }
-            tmp[row + static_cast<size_t>(x)] = acc;
         }
-    }
-
-    Image<T> out(W, H, 1);
-
-    #pragma omp parallel for
-    for (int y = 0; y < H; ++y) {
-        const bool midY = (y >= R && y < H - R);
-
-        for (int x = 0; x < W; ++x) {
-            float acc = 0.0f;
+    });
+}
 
-            if (midY) {
-                for (int dy = -R; dy <= R; ++dy) {
-                    const int sy = y + dy;
-                    acc += kw[dy + R] * tmp[static_cast<size_t>(sy) * static_cast<size_t>(W) + static_cast<size_t>(x)];
-                }
-            } else {
-                for (int dy = -R; dy <= R; ++dy) {
-                    const int sy = clampi(y + dy, 0, H - 1);
-                    acc += kw[dy + R] * tmp[static_cast<size_t>(sy) * static_cast<size_t>(W) + static_cast<size_t>(x)];
-                }
-            }
+// --------------------- Box cascade (large sigma) ---------------------
+
+// Widths of 3 boxes whose cascade has variance sigma^2 (box of width w has variance (w^2 - 1) / 12), see
+// P. Kovesi "Fast Almost-Gaussian Filtering", returned as radii
+std::array<int, 3> boxRadii(float sigma) {
+    constexpr int n = 3;
+    const double s2 = static_cast<double>(sigma) * sigma;
+    int wl = static_cast<int>(std::floor(std::sqrt(12.0 * s2 / n + 1.0)));
+    if (wl % 2 == 0) --wl;
+    const int wu = wl + 2;
+    const int m = static_cast<int>(std::lround((12.0 * s2 - n * wl * wl - 4.0 * n * wl - 3.0 * n) / (-4.0 * wl - 4.0)));
+
+    std::array<int, 3> radii{};
+    for (int i = 0; i < n; ++i) radii[i] = ((i < m ? wl : wu) - 1) / 2;
+    return radii;
+}
 
-            out(y, x) = from_f<T>(acc);
+// In-place box filter of radius r along a line of len pixels with C interleaved channels, borders are replicated
+template <int C>
+void boxLine(float* line, int len, int r, std::vector<float>& src) {
+    src.assign(line, line + static_cast<size_t>(len) * C);
+    const double inv = 1.0 / (2 * r + 1);
+    auto at = [&](int x, int c) { return static_cast<double>(src[static_cast<size_t>(clampi(x, 0, len - 1)) * C + c]); };
+
+    for (int c = 0; c < C; ++c) {
+        double sum = 0.0;
+        for (int d = -r; d <= r; ++d) sum += at(d, c);
+        for (int x = 0; x < len; ++x) {
+            line[static_cast<size_t>(x) * C + c] = static_cast<float>(sum * inv);
+            sum += at(x + r + 1, c) - at(x - r, c);
         }
     }
-
-    return out;
 }
 
-// --------------------- Image blur: 3 channels ---------------------
+// Vertical box filter of radius r: dst row y = mean of src rows [y - r, y + r] (replicated borders), rows have n floats
+void boxColumns(const float* src, float* dst, size_t n, int H, int r) {
+    const double inv = 1.0 / (2 * r + 1);
+    auto row = [&](int y) { return src + static_cast<size_t>(clampi(y, 0, H - 1)) * n; };
+
+    constexpr size_t chunk = 256;
+    const int chunks = static_cast<int>((n + chunk - 1) / chunk);
+
+    parallelForEach(0, chunks, [&](int ci) {
+        const size_t i0 = static_cast<size_t>(ci) * chunk;
+        const size_t i1 = std::min(n, i0 + chunk);
+        double sum[chunk] = {};
+        for (int d = -r; d <= r; ++d) {
+            const float* s = row(d);
+            for (size_t i = i0; i < i1; ++i) sum[i - i0] += s[i];
+        }
+        for (int y = 0; y < H; ++y) {
+            float* out = dst + static_cast<size_t>(y) * n;
+            const float* add = row(y + r + 1);
+            const float* sub = row(y - r);
+            for (size_t i = i0; i < i1; ++i) {
+                out[i] = static_cast<float>(sum[i - i0] * inv);
+                sum[i - i0] += static_cast<double>(add[i]) - static_cast<double>(sub[i]);
+            }
+        }
+    });
+}
 
 template <typename T>
-Image<T> blur_rgb(const Image<T>& image, const Kernel1D& k) {
+void blur_box_image(ImageView<const T> image, float sigma, Image<T>& out) {
     const int W = image.width();
     const int H = image.height();
-    const int R = k.r;
-    const float* kw = k.w.data();
-
-    std::vector<float> tmp(static_cast<size_t>(W) * static_cast<size_t>(H) * 3u, 0.0f);
-
-    auto idx3 = [&](int x, int y) -> size_t {
-        return (static_cast<size_t>(y) * static_cast<size_t>(W) + static_cast<size_t>(x)) * 3u;
-    };
-
-    #pragma omp parallel for
-    for (int y = 0; y < H; ++y) {
-        const int leftEnd = std::min(R, W);
-        for (int x = 0; x < leftEnd; ++x) {
-            float a0 = 0, a1 = 0, a2 = 0;
-            for (int dx = -R; dx <= R; ++dx) {
-                const int sx = clampi(x + dx, 0, W - 1);
-                const float w = kw[dx + R];
-                a0 += w * to_f(image(y, sx, 0));
-                a1 += w * to_f(image(y, sx, 1));
-                a2 += w * to_f(image(y, sx, 2));
-            }
-            const size_t o = idx3(x, y);
-            tmp[o + 0] = a0; tmp[o + 1] = a1; tmp[o + 2] = a2;
-        }
-
-        const int midBegin = R;
-        const int midEnd = W - R;
-        if (midBegin < midEnd) {
-            for (int x = midBegin; x < midEnd; ++x) {
-                float a0 = 0, a1 = 0, a2 = 0;
-                for (int dx = -R; dx <= R; ++dx) {
-                    const int sx = x + dx;
-                    const float w = kw[dx + R];
-                    a0 += w * to_f(image(y, sx, 0));
-                    a1 += w * to_f(image(y, sx, 1));
-                    a2 += w * to_f(image(y, sx, 2));
-                }
-                const size_t o = idx3(x, y);
-                tmp[o + 0] = a0; tmp[o + 1] = a1; tmp[o + 2] = a2;
-            }
+    const int C = image.channels();
+    const size_t n = static_cast<size_t>(W) * static_cast<size_t>(C);
+    const std::array<int, 3> radii = boxRadii(sigma);
+
+    std::vector<float> a(n * static_cast<size_t>(H));
+    std::vector<float> b(n * static_cast<size_t>(H));
+
+    parallelFor(0, H, 0, [&](int from, int to) {
+        std::vector<float> scratch;
+
+        for (int y = from; y < to; ++y) {
+            const T* src = image.ptr(y);
+            float* line = a.data() + static_cast<size_t>(y) * n;
+            for (size_t i = 0; i < n; ++i) line[i] = to_f(src[i]);
+            dispatch_channels(C, [&](auto c) {
+                for (int r : radii) boxLine<decltype(c)::value>(line, W, r, scratch);
+            });
         }
+    });
+
+    boxColumns(a.data(), b.data(), n, H, radii[0]);
+    boxColumns(b.data(), a.data(), n, H, radii[1]);
+    boxColumns(a.data(), b.data(), n, H, radii[2]);
+
+    out.ensureSize(W, H, C);
+    parallelForEach(0, H, [&](int y) {
+        const float* src = b.data() + static_cast<size_t>(y) * n;
+        T* dst = out.ptr(y);
+        for (size_t i = 0; i < n; ++i) dst[i] = from_f<T>(src[i]);
+    });
+}
 
-        const int rightBegin = std::max(leftEnd, midEnd);
-        for (int x = rightBegin; x < W; ++x) {
-            float a0 = 0, a1 = 0, a2 = 0;
-            for (int dx = -R; dx <= R; ++dx) {
-                const int sx = clampi(x + dx, 0, W - 1);
-                const float w = kw[dx + R];
-                a0 += w * to_f(image(y, sx, 0));
-                a1 += w * to_f(image(y, sx, 1));
-                a2 += w * to_f(image(y, sx, 2));
-            }
-            const size_t o = idx3(x, y);
-            tmp[o + 0] = a0; tmp[o + 1] = a1; tmp[o + 2] = a2;
+// Same cascade of boxRadii through summed-area tables: a box is the mean over its window clipped to the image
+template <typename T>
+void blur_integral_image(ImageView<const T> image, float sigma, Image<T>& out) {
+    const int W = image.width();
+    const int H = image.height();
+    const int C = image.channels();
+    const size_t n = static_cast<size_t>(W) * static_cast<size_t>(C);
+
+    Image<float> a(W, H, C, ImageInit::Uninitialized);
+    parallelForEach(0, H, [&](int y) {
+        const T* src = image.ptr(y);
+        float* dst = a.ptr(y);
+        for (size_t i = 0; i < n; ++i) dst[i] = to_f(src[i]);
+    });
+
+    dispatch_channels(C, [&](auto channels) {
+        for (int r : boxRadii(sigma)) {
+            const IntegralImage<double> sums = integral_image<double>(a);
+            parallelForEach(0, H, [&](int y) {
+                float* dst = a.ptr(y);
+                for (int x = 0; x < W; ++x)
+                    for (int c = 0; c < channels; ++c) {
+                        dst[static_cast<size_t>(x) * channels + c] = static_cast<float>(sums.windowMean(x, y, r, c));
+                    }
+            });
         }
-    }
-
-    Image<T> out(W, H, 3);
-
-    #pragma omp parallel for
-    for (int y = 0; y < H; ++y) {
-        const bool midY = (y >= R && y < H - R);
+    });
+
+    out.ensureSize(W, H, C);
+    parallelForEach(0, H, [&](int y) {
+        const float* src = a.ptr(y);
+        T* dst = out.ptr(y);
+        for (size_t i = 0; i < n; ++i) dst[i] = from_f<T>(src[i]);
+    });
+}
 
-        for (int x = 0; x < W; ++x) {
-            float a0 = 0, a1 = 0, a2 = 0;
+template <typename T>
+void copy_into(ImageView<const T> image, Image<T>& out) {
+    out.ensureSize(image.width(), image.height(), image.channels());
+    const size_t n = static_cast<size_t>(image.width()) * static_cast<size_t>(image.channels());
+    for (int y = 0; y < image.height(); ++y) std::copy(image.ptr(y), image.ptr(y) + n, out.ptr(y));
+}
 
-            if (midY) {
-                for (int dy = -R; dy <= R; ++dy) {
-                    const int sy = y + dy;
-                    const float w = kw[dy + R];
-                    const size_t o = idx3(x, sy);
-                    a0 += w * tmp[o + 0];
-                    a1 += w * tmp[o + 1];
-                    a2 += w * tmp[o + 2];
-                }
-            } else {
-                for (int dy = -R; dy <= R; ++dy) {
-                    const int sy = clampi(y + dy, 0, H - 1);
-                    const float w = kw[dy + R];
-                    const size_t o = idx3(x, sy);
-                    a0 += w * tmp[o + 0];
-                    a1 += w * tmp[o + 1];
-                    a2 += w * tmp[o + 2];
-                }
-            }
+inline bool useBox(float strength, BlurMethod method, float box_sigma_threshold) {
+    return method == BlurMethod::Box || (method == BlurMethod::Auto && strength > box_sigma_threshold);
+}
 
-            out(y, x, 0) = from_f<T>(a0);
-            out(y, x, 1) = from_f<T>(a1);
-            out(y, x, 2) = from_f<T>(a2);
-        }
-    }
+} // namespace
 
+template <typename T>
+Image<T> blur(const Image<T> &image, float strength, BlurMethod method, float box_sigma_threshold) {
+    if (!(strength > 0.0f)) return image;
+    Image<T> out;
+    blur(image, out, strength, method, box_sigma_threshold);
     return out;
 }
 
-} // namespace
+template <typename T>
+Image<T> blur(ImageView<const T> image, float strength, BlurMethod method, float box_sigma_threshold) {
+    Image<T> out;
+    blur(image, out, strength, method, box_sigma_threshold);
+    return out;
+}
 
 template <typename T>
-Image<T> blur(const Image<T> &image, float strength) {
-    if (!(strength > 0.0f)) return image;
+void blur(const Image<T> &image, Image<T> &dst, float strength, BlurMethod method, float box_sigma_threshold) {
+    rassert(image.width() > 0 && image.height() > 0, 981234001);
+    rassert(image.channels() == 1 || image.channels() == 3, 981234002, image.channels());
+    blur(ImageView<const T>(image), dst, strength, method, box_sigma_threshold);
+}
 
+template <typename T>
+void blur(ImageView<const T> image, Image<T> &dst, float strength, BlurMethod method, float box_sigma_threshold) {
+    PROFILE_SCOPE("blur");
     const int W = image.width();
     const int H = image.height();
     const int C = image.channels();
-    rassert(W > 0 && H > 0, 981234001);
-    rassert(C == 1 || C == 3, 981234002, C);
+    rassert(W > 0 && H > 0, 981234004);
+    rassert(C == 1 || C == 3, 981234005, C);
+
+    if (overlaps(image, dst)) {
+        // f.e. blur(img, img, ...): into a new buffer that replaces the one being read
+        Image<T> out;
+        blur(image, out, strength, method, box_sigma_threshold);
+        dst = std::move(out);
+        return;
+    }
 
-    const Kernel1D k = makeGaussianKernel(strength);
-    if (k.r == 0) return image;
+    if (!(strength > 0.0f)) return copy_into(image, dst);
+    if (method == BlurMethod::Integral) return blur_integral_image(image, strength, dst);
+    if (useBox(strength, method, box_sigma_threshold)) return blur_box_image(image, strength, dst);
 
-    return (C == 1) ? blur_gray(image, k) : blur_rgb(image, k);
+    const std::shared_ptr<const Kernel1D> kernel = cachedGaussianKernel(strength);
+    const Kernel1D& k = *kernel;
+    if (k.r == 0) return copy_into(image, dst);
+
+    blur_image(image, k, blur_kernels::best(), dst);
 }
 
 template <typename T>
-std::vector<Color<T>> blur(const std::vector<Color<T>> &colors, float strength) {
+std::vector<Color<T>> blur(const std::vector<Color<T>> &colors, float strength, BlurMethod method, float box_sigma_threshold) {
     if (!(strength > 0.0f)) return colors;
     if (colors.empty()) return {};
 
-    const Kernel1D k = makeGaussianKernel(strength);
-    if (k.r == 0) return colors;
-
-    const int R = k.r;
-    const float* kw = k.w.data();
     const int n = static_cast<int>(colors.size());
     const int C = colors[0].channels();
     rassert(C == 1 || C == 3, 981234003, C);
 
-    // flat tmp: [c*n + i]
-    std::vector<float> tmp(static_cast<size_t>(n) * static_cast<size_t>(C), 0.0f);
-
-    auto t = [&](int c, int i) -> float& {
-        return tmp[static_cast<size_t>(c) * static_cast<size_t>(n) + static_cast<size_t>(i)];
-    };
-
-    for (int i = 0; i < n; ++i) {
-        const bool mid = (i >= R && i < n - R);
-
-        if (C == 1) {
-            float acc = 0.0f;
-            if (mid) {
-                for (int d = -R; d <= R; ++d) {
-                    const float w = kw[d + R];
-                    const auto& col = colors[i + d];
-                    acc += w * to_f(col(0));
-                }
-            } else {
-                for (int d = -R; d <= R; ++d) {
-                    const int si = clampi(i + d, 0, n - 1);
-                    const float w = kw[d + R];
-                    const auto& col = colors[si];
-                    acc += w * to_f(col(0));
-                }
-            }
-            t(0, i) = acc;
-        } else {
-            float a0 = 0, a1 = 0, a2 = 0;
-            if (mid) {
-                for (int d = -R; d <= R; ++d) {
-                    const float w = kw[d + R];
-                    const auto& col = colors[static_cast<size_t>(i + d)];
-                    a0 += w * to_f(col(0));
-                    a1 += w * to_f(col(1));
-                    a2 += w * to_f(col(2));
-                }
-            } else {
-                for (int d = -R; d <= R; ++d) {
-                    const int si = clampi(i + d, 0, n - 1);
-                    const float w = kw[d + R];
-                    const auto& col = colors[static_cast<size_t>(si)];
-                    a0 += w * to_f(col(0));
-                    a1 += w * to_f(col(1));
-                    a2 += w * to_f(col(2));
-                }
-            }
-            t(0, i) = a0;
-            t(1, i) = a1;
-            t(2, i) = a2;
+    std::vector<float> tmp(static_cast<size_t>(n) * static_cast<size_t>(C));
+    if (useBox(strength, method, box_sigma_threshold) || method == BlurMethod::Integral) { // lines are O(1) per pixel anyway
+        for (int i = 0; i < n; ++i) {
+            for (int c = 0; c < C; ++c) tmp[static_cast<size_t>(i) * C + c] = to_f(colors[static_cast<size_t>(i)].at(c));
+        }
+        std::vector<float> scratch;
+        dispatch_channels(C, [&](auto c) {
+            for (int r : boxRadii(strength)) boxLine<decltype(c)::value>(tmp.data(), n, r, scratch);
+        });
+    } else {
+        const std::shared_ptr<const Kernel1D> kernel = cachedGaussianKernel(strength);
+    const Kernel1D& k = *kernel;
+        if (k.r == 0) return colors;
+
+        // same horizontal kernel as images: interleaved channels padded by replicated border colors
+        const int R = k.r;
+        std::vector<float> padded(static_cast<size_t>(n + 2 * R) * static_cast<size_t>(C));
+        for (int i = -R; i < n + R; ++i) {
+            const Color<T>& col = colors[static_cast<size_t>(clampi(i, 0, n - 1))];
+            float* dst = padded.data() + static_cast<size_t>(i + R) * C;
+            for (int c = 0; c < C; ++c) dst[c] = to_f(col.at(c));
         }
+        blur_kernels::best().convolveStrided(padded.data(), tmp.data(), n * C, k.w.data(), 2 * R + 1, C);
     }
 
+    auto t = [&](int c, int i) -> float {
+        return tmp[static_cast<size_t>(i) * static_cast<size_t>(C) + static_cast<size_t>(c)];
+    };
+
     std::vector<Color<T>> out;
     out.reserve(static_cast<size_t>(n));
 
@@ -349,8 +361,23 @@ std::vector<Color<T>> blur(const std::vector<Color<T>> &colors, float strength)
 }
 
 // explicit instantiations
-template Image<std::uint8_t> blur(const Image<std::uint8_t>& image, float strength);
-template Image<float>        blur(const Image<float>& image, float strength);
-
-template std::vector<Color<std::uint8_t>> blur(const std::vector<Color<std::uint8_t>>& colors, float strength);
-template std::vector<Color<float>>        blur(const std::vector<Color<float>>& colors, float strength);
+template Image<std::uint8_t> blur(const Image<std::uint8_t>& image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<float>        blur(const Image<float>& image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<std::uint16_t> blur(const Image<std::uint16_t>& image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<float16>      blur(const Image<float16>& image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<std::uint8_t> blur(ImageView<const std::uint8_t> image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<float>        blur(ImageView<const float> image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<std::uint16_t> blur(ImageView<const std::uint16_t> image, float strength, BlurMethod method, float box_sigma_threshold);
+template Image<float16>      blur(ImageView<const float16> image, float strength, BlurMethod method, float box_sigma_threshold);
+
+template void blur(const Image<std::uint8_t>& image, Image<std::uint8_t>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(const Image<float>& image, Image<float>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(const Image<std::uint16_t>& image, Image<std::uint16_t>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(const Image<float16>& image, Image<float16>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(ImageView<const std::uint8_t> image, Image<std::uint8_t>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(ImageView<const float> image, Image<float>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(ImageView<const std::uint16_t> image, Image<std::uint16_t>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+template void blur(ImageView<const float16> image, Image<float16>& dst, float strength, BlurMethod method, float box_sigma_threshold);
+
+template std::vector<Color<std::uint8_t>> blur(const std::vector<Color<std::uint8_t>>& colors, float strength, BlurMethod method, float box_sigma_threshold);
+template std::vector<Color<float>>        blur(const std::vector<Color<float>>& colors, float strength, BlurMethod method, float box_sigma_threshold);
@@ -4,9 +4,39 @@
 
 #include <libimages/color.h>
 #include <libimages/image.h>
+#include <libimages/image_view.h>
 
+// Gaussian blur with sigma = strength, borders are replicated.
+//
+// Method selects the kernel:
+//   Gaussian - exact sampled kernel of radius ceil(3 * sigma), O(sigma) per pixel
+//   Box      - cascade of 3 box filters with the same variance, O(1) per pixel (close approximation, max error of a few percent)
+//   Integral - the same box cascade through summed-area tables (see integral_image.h), windows are clipped to the image
+//              instead of replicating borders (different values near borders only), vectors of colors use Box
+//   Auto     - Gaussian for sigma <= box_sigma_threshold, Box above it
+enum class BlurMethod { Auto, Gaussian, Box, Integral };
+
+inline constexpr float default_box_blur_sigma_threshold = 10.0f;
+
+template <typename T>
+Image<T> blur(const Image<T> &image, float strength,
+              BlurMethod method=BlurMethod::Auto, float box_sigma_threshold=default_box_blur_sigma_threshold);
+
+// Same as above but reads pixels through a view (f.e. a piece region of the whole photo)
+template <typename T>
+Image<T> blur(ImageView<const T> image, float strength,
+              BlurMethod method=BlurMethod::Auto, float box_sigma_threshold=default_box_blur_sigma_threshold);
+
+// Into dst, reusing its buffer if it already has the size of image (see Image::ensureSize), so that blurring
+// same-sized images one after another allocates only the temporaries. dst may be image itself (or the image a view
+// is of): then the result replaces its buffer.
+template <typename T>
+void blur(const Image<T> &image, Image<T> &dst, float strength,
+          BlurMethod method=BlurMethod::Auto, float box_sigma_threshold=default_box_blur_sigma_threshold);
 template <typename T>
-Image<T> blur(const Image<T> &image, float strength);
+void blur(ImageView<const T> image, Image<T> &dst, float strength,
+          BlurMethod method=BlurMethod::Auto, float box_sigma_threshold=default_box_blur_sigma_threshold);
 
 template <typename T>
-std::vector<Color<T>> blur(const std::vector<Color<T>> &colors, float strength);
+std::vector<Color<T>> blur(const std::vector<Color<T>> &colors, float strength,
+                           BlurMethod method=BlurMethod::Auto, float box_sigma_threshold=default_box_blur_sigma_threshold);
@@ -0,0 +1,68 @@
+#include "blur_kernels.h"
+
+#include <libbase/cpu_features.h>
+
+#include <algorithm>
+
+namespace blur_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// blur_kernels_avx2.cpp (compiled with AVX2 enabled)
+const Kernels &avx2Kernels();
+#endif
+#if defined(LIBIMAGES_WITH_AVX512)
+// blur_kernels_avx512.cpp (compiled with AVX-512 enabled)
+const Kernels &avx512Kernels();
+#endif
+
+namespace {
+
+void convolveStridedScalar(const float *in, float *out, int n, const float *w, int taps, int stride) {
+    std::fill(out, out + n, 0.0f);
+    for (int k = 0; k < taps; ++k) {
+        const float wk = w[k];
+        const float *src = in + k * stride;
+        for (int i = 0; i < n; ++i) {
+            out[i] += wk * src[i];
+        }
+    }
+}
+
+void convolveRowsScalar(const float *const *rows, float *out, int n, const float *w, int taps) {
+    std::fill(out, out + n, 0.0f);
+    for (int k = 0; k < taps; ++k) {
+        const float wk = w[k];
+        const float *src = rows[k];
+        for (int i = 0; i < n; ++i) {
+            out[i] += wk * src[i];
+        }
+    }
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", convolveStridedScalar, convolveRowsScalar};
+    return kernels;
+}
+
+const Kernels *avx2() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2) return &avx2Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels *avx512() {
+#if defined(LIBIMAGES_WITH_AVX512)
+    if (cpuFeatures().avx512) return &avx512Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = avx512() ? *avx512() : avx2() ? *avx2() : scalar();
+    return kernels;
+}
+
+} // namespace blur_kernels
@@ -0,0 +1,26 @@
+#pragma once
+
+// Row kernels behind blur(), one implementation per instruction set (picked at runtime by CPU features).
+// All implementations accumulate taps in the same order without FMA, so their results are bit-identical.
+namespace blur_kernels {
+
+// out[i] = sum_k w[k] * in[i + k * stride] for i in [0, n), k in [0, taps)
+using ConvolveStridedFn = void (*)(const float *in, float *out, int n, const float *w, int taps, int stride);
+// out[i] = sum_k w[k] * rows[k][i] for i in [0, n), k in [0, taps)
+using ConvolveRowsFn = void (*)(const float *const *rows, float *out, int n, const float *w, int taps);
+
+struct Kernels {
+    const char *name;
+    ConvolveStridedFn convolveStrided;
+    ConvolveRowsFn convolveRows;
+};
+
+// Portable loops (auto-vectorized by compiler for the baseline instruction set, f.e. SSE2 or NEON)
+const Kernels &scalar();
+// nullptr if not compiled in or not supported by current CPU
+const Kernels *avx2();
+const Kernels *avx512(); // AVX-512 F, BW and VL
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace blur_kernels
@@ -0,0 +1,74 @@
+#include "blur_kernels.h"
+
+#include <immintrin.h>
+
+namespace blur_kernels {
+
+namespace {
+
+// The tail of < 16 values is one masked step, masked-off lanes are neither read nor written
+inline __mmask16 tailMask(int m) { return static_cast<__mmask16>((1u << m) - 1u); }
+
+// Taps are accumulated one by one as mul + add (no FMA) to stay bit-identical with the scalar kernels
+void convolveStridedAvx512(const float *in, float *out, int n, const float *w, int taps, int stride) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        for (int k = 0; k < taps; ++k) {
+            const __m512 wk = _mm512_set1_ps(w[k]);
+            const float *src = in + k * stride + i;
+            a0 = _mm512_add_ps(a0, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 0)));
+            a1 = _mm512_add_ps(a1, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 16)));
+            a2 = _mm512_add_ps(a2, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 32)));
+            a3 = _mm512_add_ps(a3, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 48)));
+        }
+        _mm512_storeu_ps(out + i + 0, a0);
+        _mm512_storeu_ps(out + i + 16, a1);
+        _mm512_storeu_ps(out + i + 32, a2);
+        _mm512_storeu_ps(out + i + 48, a3);
+    }
+    for (; i < n; i += 16) {
+        const __mmask16 m = n - i >= 16 ? __mmask16(0xFFFF) : tailMask(n - i);
+        __m512 a = _mm512_setzero_ps();
+        for (int k = 0; k < taps; ++k) {
+            a = _mm512_add_ps(a, _mm512_mul_ps(_mm512_set1_ps(w[k]), _mm512_maskz_loadu_ps(m, in + k * stride + i)));
+        }
+        _mm512_mask_storeu_ps(out + i, m, a);
+    }
+}
+
+void convolveRowsAvx512(const float *const *rows, float *out, int n, const float *w, int taps) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        for (int k = 0; k < taps; ++k) {
+            const __m512 wk = _mm512_set1_ps(w[k]);
+            const float *src = rows[k] + i;
+            a0 = _mm512_add_ps(a0, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 0)));
+            a1 = _mm512_add_ps(a1, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 16)));
+            a2 = _mm512_add_ps(a2, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 32)));
+            a3 = _mm512_add_ps(a3, _mm512_mul_ps(wk, _mm512_loadu_ps(src + 48)));
+        }
+        _mm512_storeu_ps(out + i + 0, a0);
+        _mm512_storeu_ps(out + i + 16, a1);
+        _mm512_storeu_ps(out + i + 32, a2);
+        _mm512_storeu_ps(out + i + 48, a3);
+    }
+    for (; i < n; i += 16) {
+        const __mmask16 m = n - i >= 16 ? __mmask16(0xFFFF) : tailMask(n - i);
+        __m512 a = _mm512_setzero_ps();
+        for (int k = 0; k < taps; ++k) {
+            a = _mm512_add_ps(a, _mm512_mul_ps(_mm512_set1_ps(w[k]), _mm512_maskz_loadu_ps(m, rows[k] + i)));
+        }
+        _mm512_mask_storeu_ps(out + i, m, a);
+    }
+}
+
+} // namespace
+
+const Kernels &avx512Kernels() {
+    static const Kernels kernels{"avx512", convolveStridedAvx512, convolveRowsAvx512};
+    return kernels;
+}
+
+} // namespace blur_kernels
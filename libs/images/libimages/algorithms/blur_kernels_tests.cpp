@@ -0,0 +1,68 @@
+#include "blur_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <iostream>
+#include <vector>
+
+namespace {
+
+std::vector<float> randomFloats(FastRandom &r, int n) {
+    std::vector<float> v(static_cast<size_t>(n));
+    for (float &x : v) x = r.nextFloat(0.0f, 255.0f);
+    return v;
+}
+
+} // namespace
+
+TEST(blur_kernels, bestIsAvailable) {
+    const blur_kernels::Kernels &best = blur_kernels::best();
+    EXPECT_NE(best.convolveStrided, nullptr);
+    EXPECT_NE(best.convolveRows, nullptr);
+    std::cout << "blur kernels: " << best.name << std::endl;
+}
+
+namespace {
+
+void expectMatchesScalarExactly(const blur_kernels::Kernels *simd) {
+    const blur_kernels::Kernels &scalar = blur_kernels::scalar();
+
+    FastRandom r(5);
+    for (int n : {1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1027}) {
+        for (int taps : {1, 3, 19, 61}) {
+            for (int stride : {1, 3}) {
+                const std::vector<float> w = randomFloats(r, taps);
+                const std::vector<float> in = randomFloats(r, n + (taps - 1) * stride);
+
+                std::vector<float> a(static_cast<size_t>(n)), b(static_cast<size_t>(n));
+                scalar.convolveStrided(in.data(), a.data(), n, w.data(), taps, stride);
+                simd->convolveStrided(in.data(), b.data(), n, w.data(), taps, stride);
+                EXPECT_EQ(a, b) << "n=" << n << " taps=" << taps << " stride=" << stride;
+
+                std::vector<std::vector<float>> rowsData;
+                std::vector<const float *> rows;
+                for (int k = 0; k < taps; ++k) rowsData.push_back(randomFloats(r, n));
+                for (const auto &row : rowsData) rows.push_back(row.data());
+                scalar.convolveRows(rows.data(), a.data(), n, w.data(), taps);
+                simd->convolveRows(rows.data(), b.data(), n, w.data(), taps);
+                EXPECT_EQ(a, b) << "n=" << n << " taps=" << taps;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(blur_kernels, simdMatchesScalarExactly) {
+    const blur_kernels::Kernels *simd = blur_kernels::avx2();
+    if (!simd) GTEST_SKIP() << "AVX2 kernels are not available";
+    expectMatchesScalarExactly(simd);
+}
+
+TEST(blur_kernels, avx512MatchesScalarExactly) {
+    const blur_kernels::Kernels *simd = blur_kernels::avx512();
+    if (!simd) GTEST_SKIP() << "AVX-512 kernels are not available";
+    expectMatchesScalarExactly(simd);
+}
@@ -146,3 +146,164 @@ TEST(blur, image_rgb_edge_smooths) {
     debug_io::dump_image(getUnitCaseDebugDir() + "00_src.png", src);
     debug_io::dump_image(getUnitCaseDebugDir() + "01_blur.png", dst);
 }
+
+TEST(blur, image_view_matches_cropped_copy) {
+    configureWorkingDirectory();
+
+    image8u src(50, 40, 3);
+    for (int y = 0; y < src.height(); ++y) {
+        for (int x = 0; x < src.width(); ++x) {
+            src(y, x, 0) = static_cast<uint8_t>((x * 13 + y * 7) % 256);
+            src(y, x, 1) = static_cast<uint8_t>((x * x + y) % 256);
+            src(y, x, 2) = static_cast<uint8_t>((y * 31) % 256);
+        }
+    }
+
+    const image8u_cview region = image8u_cview(src).subview(7, 5, 30, 20);
+    const image8u fromView = blur(region, 2.0f);
+    const image8u fromCopy = blur(region.toImage(), 2.0f);
+
+    ASSERT_EQ(fromView.size(), fromCopy.size());
+    EXPECT_EQ(fromView.toVector(), fromCopy.toVector());
+
+    debug_io::dump_image(getUnitCaseDebugDir() + "00_region.png", region.toImage());
+    debug_io::dump_image(getUnitCaseDebugDir() + "01_blur.png", fromView);
+}
+
+TEST(blur, matchesFloatReferenceWithin1Lsb) {
+    // Direct 2D sum with replicated borders, same kernel as blur() (radius = ceil(3 * sigma))
+    auto reference = [](const image8u& src, float sigma, int x, int y, int c) {
+        const int R = static_cast<int>(std::ceil(3.0f * sigma));
+        double sum = 0.0, norm = 0.0;
+        for (int dy = -R; dy <= R; ++dy) {
+            for (int dx = -R; dx <= R; ++dx) {
+                const double w = std::exp(-(dx * dx + dy * dy) / (2.0 * sigma * sigma));
+                const int sx = std::clamp(x + dx, 0, src.width() - 1);
+                const int sy = std::clamp(y + dy, 0, src.height() - 1);
+                sum += w * src(sy, sx, c);
+                norm += w;
+            }
+        }
+        return sum / norm;
+    };
+
+    for (int channels : {1, 3}) {
+        image8u src(37, 23, channels);
+        for (int y = 0; y < src.height(); ++y)
+            for (int x = 0; x < src.width(); ++x)
+                for (int c = 0; c < channels; ++c)
+                    src(y, x, c) = static_cast<uint8_t>((x * 37 + y * 91 + c * 53 + (x * y) % 17) % 256);
+
+        for (float sigma : {0.7f, 2.0f, 5.0f}) {
+            const image8u dst = blur(src, sigma);
+            for (int y = 0; y < src.height(); ++y)
+                for (int x = 0; x < src.width(); ++x)
+                    for (int c = 0; c < channels; ++c)
+                        EXPECT_LE(std::abs(dst(y, x, c) - reference(src, sigma, x, y, c)), 1.0)
+                                << "x=" << x << " y=" << y << " c=" << c << " sigma=" << sigma;
+        }
+    }
+}
+
+TEST(blur, boxCascadeApproximatesGaussian) {
+    image8u src(400, 300, 3);
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            for (int c = 0; c < 3; ++c)
+                src(y, x, c) = static_cast<uint8_t>(((x / 80 + y / 60 + c) % 2) ? 230 : 20);
+
+    for (float sigma : {4.0f, 12.0f, 30.0f}) {
+        const image8u gauss = blur(src, sigma, BlurMethod::Gaussian);
+        const image8u box = blur(src, sigma, BlurMethod::Box);
+        int maxDiff = 0;
+        for (int y = 0; y < src.height(); ++y)
+            for (int x = 0; x < src.width(); ++x)
+                for (int c = 0; c < 3; ++c)
+                    maxDiff = std::max(maxDiff, std::abs(int(gauss(y, x, c)) - int(box(y, x, c))));
+        EXPECT_LE(maxDiff, 12) << "sigma=" << sigma; // out of 210 contrast
+    }
+
+    configureWorkingDirectory();
+    debug_io::dump_image(getUnitCaseDebugDir() + "00_src.png", src);
+    debug_io::dump_image(getUnitCaseDebugDir() + "01_gaussian.png", blur(src, 12.0f, BlurMethod::Gaussian));
+    debug_io::dump_image(getUnitCaseDebugDir() + "02_box.png", blur(src, 12.0f, BlurMethod::Box));
+}
+
+TEST(blur, autoSwitchesToBoxAboveThreshold) {
+    image32f src(50, 40, 1);
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            src(y, x) = static_cast<float>((x * 7 + y * 13) % 29);
+
+    EXPECT_EQ(blur(src, 5.0f).toVector(), blur(src, 5.0f, BlurMethod::Gaussian).toVector());
+    EXPECT_EQ(blur(src, 25.0f).toVector(), blur(src, 25.0f, BlurMethod::Box).toVector());
+    EXPECT_EQ(blur(src, 5.0f, BlurMethod::Auto, 4.0f).toVector(), blur(src, 5.0f, BlurMethod::Box).toVector());
+
+    // constant stays constant
+    image32f flat(30, 20, 1);
+    flat.fill(42.0f);
+    for (float v : blur(flat, 40.0f, BlurMethod::Box).toVector()) EXPECT_NEAR(v, 42.0f, 1e-3f);
+
+    const std::vector<color8u> line = makeRedGradient(300);
+    const std::vector<color8u> gauss = blur(line, 20.0f, BlurMethod::Gaussian);
+    const std::vector<color8u> box = blur(line, 20.0f);
+    ASSERT_EQ(gauss.size(), box.size());
+    for (size_t i = 0; i < line.size(); ++i) {
+        EXPECT_LE(std::abs(int(gauss[i](0)) - int(box[i](0))), 3) << i;
+    }
+}
+
+TEST(blur, integralMatchesBoxAwayFromBorders) {
+    image8u src(160, 120, 3);
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            for (int c = 0; c < 3; ++c)
+                src(y, x, c) = static_cast<uint8_t>((x * 7 + y * 13 + c * 50) % 251);
+
+    // three boxes of radius <= 4 each for sigma = 4: the windows are inside of the image farther than 12 from borders
+    const int margin = 12;
+    const image8u box = blur(src, 4.0f, BlurMethod::Box);
+    const image8u integral = blur(src, 4.0f, BlurMethod::Integral);
+    for (int y = margin; y < src.height() - margin; ++y)
+        for (int x = margin; x < src.width() - margin; ++x)
+            for (int c = 0; c < 3; ++c)
+                EXPECT_LE(std::abs(int(box(y, x, c)) - int(integral(y, x, c))), 1) << x << " " << y;
+
+    // clipped windows keep a constant image constant up to the borders
+    image32f flat(30, 20, 1);
+    flat.fill(42.0f);
+    for (float v : blur(flat, 40.0f, BlurMethod::Integral).toVector()) EXPECT_NEAR(v, 42.0f, 1e-3f);
+
+    const std::vector<color8u> line = makeRedGradient(300);
+    EXPECT_EQ(blur(line, 20.0f, BlurMethod::Integral), blur(line, 20.0f, BlurMethod::Box));
+}
+
+TEST(blur, intoDstReusesBufferAndAllowsInPlace) {
+    image8u src(64, 48, 3);
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            for (int c = 0; c < 3; ++c)
+                src(y, x, c) = static_cast<uint8_t>((x * 11 + y * 5 + c * 70) % 256);
+
+    for (BlurMethod method : {BlurMethod::Gaussian, BlurMethod::Box, BlurMethod::Integral}) {
+        const image8u expected = blur(src, 2.5f, method);
+
+        image8u dst;
+        blur(src, dst, 2.5f, method);
+        EXPECT_EQ(dst.toVector(), expected.toVector());
+        const uint8_t *buffer = dst.ptr(0);
+        blur(src, dst, 2.5f, method);
+        EXPECT_EQ(dst.ptr(0), buffer);
+        EXPECT_EQ(dst.toVector(), expected.toVector());
+
+        image8u inPlace = src;
+        blur(inPlace, inPlace, 2.5f, method);
+        EXPECT_EQ(inPlace.toVector(), expected.toVector());
+
+        // the region of a view into the same image
+        image8u ofView = src;
+        const image8u expectedRegion = blur(image8u_cview(src).subview(5, 3, 40, 30), 2.5f, method);
+        blur(image8u_cview(ofView).subview(5, 3, 40, 30), ofView, 2.5f, method);
+        EXPECT_EQ(ofView.toVector(), expectedRegion.toVector());
+    }
+}
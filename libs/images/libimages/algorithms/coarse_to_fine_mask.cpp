@@ -0,0 +1,134 @@
+#include "coarse_to_fine_mask.h"
+
+#include <libimages/algorithms/downsample.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/image_pyramid.h>
+#include <libimages/image_view.h>
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+namespace {
+
+using word_type = BitMask::word_type;
+
+inline void putBit(word_type *row, int x, bool value) {
+    const word_type bit = word_type(1) << (x % BitMask::bits_per_word);
+    if (value) {
+        row[x / BitMask::bits_per_word] |= bit;
+    } else {
+        row[x / BitMask::bits_per_word] &= ~bit;
+    }
+}
+
+// Pyramid level the coarse one is (checks the options: the scale is a power of 2)
+int levelOfScale(const CoarseToFineOptions &options) {
+    rassert(options.scale >= 2, 81203400001, options.scale);
+    rassert(options.band >= 1, 81203400002, options.band);
+    rassert(options.blockSize >= 1, 81203400003, options.blockSize);
+    rassert((options.scale & (options.scale - 1)) == 0, 81203400004, options.scale);
+    int level = 0;
+    while ((1 << level) < options.scale) ++level;
+    return level;
+}
+
+BitMask coarseToFine(const image8u &image, const image8u &coarseImage, float threshold, const std::vector<morphology::Op> &ops,
+                     const CoarseToFineOptions &options, bool with_openmp, CoarseToFineStats *stats) {
+    const int w = image.width(), h = image.height();
+    const int scale = options.scale;
+    const int cw = coarseImage.width(), ch = coarseImage.height();
+    rassert(cw == (w + scale - 1) / scale && ch == (h + scale - 1) / scale, 81203400005, cw, ch, w, h, scale);
+
+    std::vector<morphology::Op> coarseOps;
+    int support = 0; // how far an input pixel affects the full resolution mask
+    for (const morphology::Op &op: ops) {
+        coarseOps.push_back({op.type, (op.strength + scale / 2) / scale});
+        support += op.strength;
+    }
+    const BitMask coarse = morphology::pipeline(threshold_grayscale_bitmask(coarseImage, threshold), coarseOps, with_openmp);
+    // coarse pixels within band of a boundary: in the dilated mask, but not in the eroded one
+    const BitMask grown = morphology::dilate(coarse, options.band, with_openmp);
+    const BitMask shrunk = morphology::erode(coarse, options.band, with_openmp);
+
+    std::vector<int> coarseX(w), coarseY(h); // coarse pixel covering a full resolution one
+    for (int x = 0; x < w; ++x) coarseX[x] = x / scale;
+    for (int y = 0; y < h; ++y) coarseY[y] = y / scale;
+
+    const int block = options.blockSize * scale;
+    const int blocksX = (w + block - 1) / block, blocksY = (h + block - 1) / block;
+    BitMask result(w, h);
+    std::vector<std::size_t> refined(blocksY, 0);
+    // a task per row of blocks: tasks write disjoint rows, so they never share words of the result
+    parallelForEach(0, blocksY, [&](int by) {
+        const int y0 = by * block, y1 = std::min(h, y0 + block);
+        for (int y = y0; y < y1; ++y) {
+            word_type *dst = result.row(y);
+            const int cy = coarseY[y];
+            for (int x = 0; x < w; ++x) {
+                if (coarse.test(cy, coarseX[x])) putBit(dst, x, true);
+            }
+        }
+
+        auto refine = [&](int x0, int x1) {
+            const int cx0 = std::max(0, x0 - support), cx1 = std::min(w, x1 + support);
+            const int cy0 = std::max(0, y0 - support), cy1 = std::min(h, y1 + support);
+            const image8u crop = image8u_cview(image).subview(cx0, cy0, cx1 - cx0, cy1 - cy0).toImage();
+            // the mask of [x0, x1) x [y0, y1) depends only on the crop, at the image border the crop is clamped
+            // the same way as the zero padding of the morphology
+            const BitMask cropMask = morphology::pipeline(threshold_grayscale_bitmask(crop, threshold), ops, false);
+            for (int y = y0; y < y1; ++y) {
+                word_type *dst = result.row(y);
+                for (int x = x0; x < x1; ++x) putBit(dst, x, cropMask.test(y - cy0, x - cx0));
+            }
+            refined[by] += static_cast<std::size_t>(x1 - x0) * (y1 - y0);
+        };
+
+        int runFrom = -1;
+        for (int bx = 0; bx <= blocksX; ++bx) {
+            bool boundary = false;
+            if (bx < blocksX) {
+                const int x0 = bx * block, x1 = std::min(w, x0 + block);
+                for (int cy = coarseY[y0]; cy <= coarseY[y1 - 1] && !boundary; ++cy) {
+                    for (int cx = coarseX[x0]; cx <= coarseX[x1 - 1]; ++cx) {
+                        if (grown.test(cy, cx) && !shrunk.test(cy, cx)) {
+                            boundary = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (boundary && runFrom < 0) runFrom = bx;
+            if (!boundary && runFrom >= 0) {
+                refine(runFrom * block, std::min(w, bx * block));
+                runFrom = -1;
+            }
+        }
+    }, with_openmp);
+
+    if (stats) {
+        stats->pixels = static_cast<std::size_t>(w) * h;
+        stats->refinedPixels = std::accumulate(refined.begin(), refined.end(), std::size_t(0));
+    }
+    return result;
+}
+
+} // namespace
+
+BitMask thresholdMorphologyCoarseToFine(const image8u &image, float threshold, const std::vector<morphology::Op> &ops,
+                                        const CoarseToFineOptions &options, bool with_openmp, CoarseToFineStats *stats) {
+    const int level = levelOfScale(options);
+    image8u coarseImage = downsample_2x(image);
+    for (int k = 1; k < level; ++k) downsample_2x(coarseImage, coarseImage);
+    return coarseToFine(image, coarseImage, threshold, ops, options, with_openmp, stats);
+}
+
+BitMask thresholdMorphologyCoarseToFine(pyramid8u &pyramid, float threshold, const std::vector<morphology::Op> &ops,
+                                        const CoarseToFineOptions &options, bool with_openmp, CoarseToFineStats *stats) {
+    // the last level is 1x1, as are all the coarser ones of the chain
+    const int level = std::min(levelOfScale(options), pyramid.levels() - 1);
+    return coarseToFine(pyramid.level(0), pyramid.level(level), threshold, ops, options, with_openmp, stats);
+}
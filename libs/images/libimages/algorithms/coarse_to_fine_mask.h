@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <libimages/algorithms/morphology.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+#include <libimages/image_pyramid.h>
+
+struct CoarseToFineOptions {
+    // The coarse level is level log2(scale) of the 2x pyramid of the image (ceil(width / scale) x ceil(height / scale)),
+    // scale is a power of 2
+    int scale = 4;
+    // Coarse pixels on both sides of a coarse boundary whose full resolution pixels are computed exactly
+    int band = 2;
+    // Full resolution work is done by blocks of blockSize x blockSize coarse pixels (runs of them in a row of blocks),
+    // each with a margin of the support of the morphology
+    int blockSize = 16;
+};
+
+struct CoarseToFineStats {
+    std::size_t pixels = 0;        // of the full resolution mask
+    std::size_t refinedPixels = 0; // of it computed at full resolution (without margins), the others are taken from the coarse mask
+};
+
+// The same mask as morphology::pipeline(threshold_grayscale_bitmask(image, threshold), ops), but coarse to fine:
+// the whole chain runs on the coarse level (with strengths divided by scale), then only the blocks within band of
+// a coarse boundary are thresholded and go through ops at full resolution (exactly, the margins of the blocks cover
+// the support of ops), the rest is filled from the coarse mask. So full resolution work is proportional to the length
+// of the boundaries, not to the area. The result differs from the full resolution one only where the coarse level
+// misses a boundary by more than band coarse pixels (f.e. objects or holes thinner than a few coarse pixels).
+BitMask thresholdMorphologyCoarseToFine(const image8u &image, float threshold, const std::vector<morphology::Op> &ops,
+                                        const CoarseToFineOptions &options = {}, bool with_openmp = true,
+                                        CoarseToFineStats *stats = nullptr);
+// The same with both levels fetched from the pyramid of the image (level 0 is the image), so the coarse level
+// is built once for every consumer of it (and taken as is if it is already cached)
+BitMask thresholdMorphologyCoarseToFine(pyramid8u &pyramid, float threshold, const std::vector<morphology::Op> &ops,
+                                        const CoarseToFineOptions &options = {}, bool with_openmp = true,
+                                        CoarseToFineStats *stats = nullptr);
@@ -0,0 +1,116 @@
+#include "coarse_to_fine_mask.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/stats.h>
+#include <libimages/algorithms/grayscale.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/image_io.h>
+
+namespace {
+
+const std::vector<morphology::Op> kOps = {
+    morphology::dilateOp(6), morphology::erodeOp(6), morphology::erodeOp(6), morphology::dilateOp(6), morphology::erodeOp(2),
+};
+
+// Dark background with bright rectangles and a ring (a hole in the middle)
+image8u makeScene(int w, int h) {
+    image8u img(w, h, 3);
+    img.fill(static_cast<std::uint8_t>(20));
+    auto fillRect = [&](int x0, int y0, int x1, int y1, std::uint8_t v) {
+        for (int j = y0; j < y1; ++j)
+            for (int i = x0; i < x1; ++i)
+                for (int c = 0; c < 3; ++c) img(j, i, c) = v;
+    };
+    fillRect(40, 30, 200, 150, 210);
+    fillRect(300, 60, 470, 300, 180);
+    fillRect(340, 120, 420, 220, 20);
+    fillRect(0, 320, 120, h, 230); // touches the border
+    return img;
+}
+
+std::size_t differentPixels(const BitMask &a, const BitMask &b) {
+    std::size_t n = 0;
+    for (int j = 0; j < a.height(); ++j)
+        for (int i = 0; i < a.width(); ++i) n += a.get(j, i) != b.get(j, i);
+    return n;
+}
+
+} // namespace
+
+TEST(coarse_to_fine_mask, matchesFullResolutionOnLargeShapes) {
+    const image8u img = makeScene(517, 389); // not a multiple of any scale
+    const BitMask expected = morphology::pipeline(threshold_grayscale_bitmask(img, 100.0f), kOps);
+    for (int scale: {2, 4, 8}) {
+        CoarseToFineOptions options;
+        options.scale = scale;
+        CoarseToFineStats stats;
+        const BitMask mask = thresholdMorphologyCoarseToFine(img, 100.0f, kOps, options, true, &stats);
+        EXPECT_TRUE(mask == expected) << scale;
+        EXPECT_EQ(stats.pixels, std::size_t(517) * 389);
+        EXPECT_LT(stats.refinedPixels, stats.pixels) << scale;
+    }
+}
+
+TEST(coarse_to_fine_mask, refinesOnlyAroundBoundaries) {
+    image8u img(2048, 2048, 3);
+    img.fill(static_cast<std::uint8_t>(10));
+    for (int j = 500; j < 1500; ++j)
+        for (int i = 600; i < 1700; ++i)
+            for (int c = 0; c < 3; ++c) img(j, i, c) = 200;
+    CoarseToFineStats stats;
+    const BitMask mask = thresholdMorphologyCoarseToFine(img, 100.0f, kOps, {}, true, &stats);
+    EXPECT_TRUE(mask == morphology::pipeline(threshold_grayscale_bitmask(img, 100.0f), kOps));
+    EXPECT_LT(stats.refinedPixels * 4, stats.pixels);
+
+    image8u empty(300, 200, 3);
+    empty.fill(static_cast<std::uint8_t>(10));
+    const BitMask emptyMask = thresholdMorphologyCoarseToFine(empty, 100.0f, kOps, {}, true, &stats);
+    EXPECT_EQ(emptyMask.count(), 0u);
+    EXPECT_EQ(stats.refinedPixels, 0u);
+}
+
+TEST(coarse_to_fine_mask, photoIsCloseToFullResolution) {
+    configureWorkingDirectory();
+
+    const image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const float threshold = static_cast<float>(1.5 * stats::percentile(grayscale_border(img), 90.0));
+    const BitMask expected = morphology::pipeline(threshold_grayscale_bitmask(img, threshold), kOps);
+    CoarseToFineStats stats;
+    const BitMask mask = thresholdMorphologyCoarseToFine(img, threshold, kOps, {}, true, &stats);
+    EXPECT_LT(differentPixels(mask, expected) * 10000, stats.pixels); // less than 0.01%
+}
+
+TEST(coarse_to_fine_mask, pyramidLevelsAreShared) {
+    pyramid8u pyramid(makeScene(517, 389));
+    for (int scale: {2, 4, 8}) {
+        CoarseToFineOptions options;
+        options.scale = scale;
+        const BitMask mask = thresholdMorphologyCoarseToFine(pyramid, 100.0f, kOps, options);
+        EXPECT_TRUE(mask == thresholdMorphologyCoarseToFine(pyramid.level(0), 100.0f, kOps, options)) << scale;
+    }
+    // the levels are cached: the next consumer takes them as they are
+    EXPECT_TRUE(pyramid.isBuilt(1) && pyramid.isBuilt(2) && pyramid.isBuilt(3));
+    const image8u *coarse = &pyramid.level(3);
+    thresholdMorphologyCoarseToFine(pyramid, 100.0f, kOps, {});
+    EXPECT_EQ(&pyramid.level(3), coarse);
+
+    // coarser than the last level of a tiny image
+    image8u tiny(3, 2, 3);
+    tiny.fill(static_cast<std::uint8_t>(200));
+    pyramid8u tinyPyramid(tiny);
+    CoarseToFineOptions options;
+    options.scale = 8;
+    EXPECT_EQ(thresholdMorphologyCoarseToFine(tinyPyramid, 100.0f, {morphology::dilateOp(1)}, options).count(), 6u);
+}
+
+TEST(coarse_to_fine_mask, rejectsBadOptions) {
+    const image8u img = makeScene(517, 389);
+    CoarseToFineOptions options;
+    options.scale = 1;
+    EXPECT_THROW(thresholdMorphologyCoarseToFine(img, 100.0f, kOps, options), assertion_error);
+    options.scale = 3;
+    EXPECT_THROW(thresholdMorphologyCoarseToFine(img, 100.0f, kOps, options), assertion_error);
+}
@@ -0,0 +1,366 @@
+#include "connected_components.h"
+
+#include <libbase/profiler.h>
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+constexpr unsigned char kObject = 255;
+
+// Row accessors, so that labelling works both on image8u (0/255) and bit-packed masks
+struct Image8uMaskRow {
+    const unsigned char* p;
+    bool operator[](int x) const noexcept { return p[x] == kObject; }
+};
+
+struct BitMaskRow {
+    const BitMask::word_type* p;
+    bool operator[](int x) const noexcept { return (p[x / BitMask::bits_per_word] >> (x % BitMask::bits_per_word)) & 1u; }
+};
+
+inline Image8uMaskRow maskRow(const image8u& mask, int y) noexcept { return {mask.ptr(y)}; }
+inline BitMaskRow maskRow(const BitMask& mask, int y) noexcept { return {mask.row(y)}; }
+
+// Equivalences of provisional labels, label 0 is background. Roots are always the smallest label of a set,
+// so that unite never has to look at ranks and flattening is a single forward pass.
+class LabelEquivalences {
+public:
+    LabelEquivalences() : parent_{0} {}
+
+    int newLabel() {
+        const int l = static_cast<int>(parent_.size());
+        parent_.push_back(l);
+        return l;
+    }
+
+    int find(int l) {
+        int root = l;
+        while (parent_[root] != root) root = parent_[root];
+        while (parent_[l] != root) {
+            const int next = parent_[l];
+            parent_[l] = root;
+            l = next;
+        }
+        return root;
+    }
+
+    int unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a > b) std::swap(a, b);
+        parent_[b] = a;
+        return a;
+    }
+
+    int size() const noexcept { return static_cast<int>(parent_.size()); }
+    std::size_t bytes() const noexcept { return parent_.capacity() * sizeof(int); }
+
+    // Appends flattened labels of other shifted by size() - 1 and frees other, so that both never coexist in full
+    void append(LabelEquivalences &other) {
+        const int base = size() - 1;
+        parent_.reserve(parent_.size() + other.parent_.size() - 1);
+        for (int l = 1; l < other.size(); ++l) parent_.push_back(base + other.find(l));
+        other.parent_ = {};
+    }
+
+    // Flattened parents (parent[l] is the root of l), equivalences are left empty
+    std::vector<int> releaseFlattened() {
+        for (int l = 1; l < size(); ++l) find(l);
+        return std::move(parent_);
+    }
+
+private:
+    std::vector<int> parent_;
+};
+
+// Bookkeeping per provisional label (there are at most w * h / 4 of them), kept compact: 32 bytes
+struct ProvisionalStats {
+    int minX = std::numeric_limits<int>::max();
+    int minY = std::numeric_limits<int>::max();
+    int maxX = std::numeric_limits<int>::min(); // exclusive
+    int maxY = std::numeric_limits<int>::min(); // exclusive
+    std::int64_t area = 0;
+    std::int64_t firstPixel = std::numeric_limits<std::int64_t>::max(); // raster index, tie-breaker for ordering
+
+    void includePixel(int x, int y) noexcept {
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x + 1);
+        maxY = std::max(maxY, y + 1);
+        ++area;
+    }
+
+    void merge(const ProvisionalStats &other) noexcept {
+        minX = std::min(minX, other.minX);
+        minY = std::min(minY, other.minY);
+        maxX = std::max(maxX, other.maxX);
+        maxY = std::max(maxY, other.maxY);
+        area += other.area;
+        firstPixel = std::min(firstPixel, other.firstPixel);
+    }
+
+    ComponentInfo info() const {
+        ComponentInfo res;
+        res.bbox.include_pixel(minX, minY);
+        res.bbox.include_pixel(maxX - 1, maxY - 1);
+        res.area = area;
+        return res;
+    }
+};
+
+// A block at (x, y) is connected to an already labelled block above it only through row y - 1
+struct UpConnections {
+    bool up = false;
+    bool upLeft = false;
+    bool upRight = false;
+};
+
+template <typename Row>
+inline UpConnections upConnections(const Row& up, bool o, bool p, int x, int w) noexcept {
+    const bool hasX1 = x + 1 < w;
+    return {(o || p) && (up[x] || (hasX1 && up[x + 1])),
+            o && x > 0 && up[x - 1],
+            p && x + 2 < w && up[x + 2]};
+}
+
+// First sweep over rows [y0, y1) (y0 is even) as if the mask started at y0: every 2x2 block with at least one
+// foreground pixel gets a provisional label stored in its top-left pixel (all foreground pixels of a block are
+// 8-connected). A block is connected to an already labelled neighbouring block (left, up-left, up, up-right) only
+// through the rows/columns adjacent to it.
+template <typename Mask>
+void labelStrip(const Mask &mask, image32i &labelsImage, int y0, int y1,
+                LabelEquivalences &eq, std::vector<ProvisionalStats> &stats) {
+    const int w = mask.width();
+    stats.assign(1, ProvisionalStats{});
+
+    for (int y = y0; y < y1; y += 2) {
+        const auto r0 = maskRow(mask, y);
+        const bool hasR1 = y + 1 < y1;
+        const auto r1 = maskRow(mask, hasR1 ? y + 1 : y);
+        const bool hasUp = y > y0;
+        const auto up = maskRow(mask, hasUp ? y - 1 : y);
+        int* labels = labelsImage.ptr(y);
+        const int* labelsUp = hasUp ? labelsImage.ptr(y - 2) : nullptr;
+
+        for (int x = 0; x < w; x += 2) {
+            const bool hasX1 = x + 1 < w;
+            const bool o = r0[x];
+            const bool p = hasX1 && r0[x + 1];
+            const bool s = hasR1 && r1[x];
+            const bool t = hasR1 && hasX1 && r1[x + 1];
+            if (!(o || p || s || t)) continue;
+
+            int label = 0;
+            auto connect = [&](int neighbour) { label = label ? eq.unite(label, neighbour) : neighbour; };
+
+            if (hasUp) {
+                const UpConnections c = upConnections(up, o, p, x, w);
+                if (c.up) connect(labelsUp[x]);
+                if (c.upLeft) connect(labelsUp[x - 2]);
+                if (c.upRight) connect(labelsUp[x + 2]);
+            }
+            if (x > 0 && (o || s) && (r0[x - 1] || (hasR1 && r1[x - 1]))) connect(labels[x - 2]);
+
+            if (!label) {
+                label = eq.newLabel();
+                stats.emplace_back();
+            }
+            labels[x] = label;
+
+            ProvisionalStats &st = stats[static_cast<std::size_t>(label)];
+            const std::int64_t rowStart = static_cast<std::int64_t>(y) * w;
+            auto include = [&](bool fg, int px, int py) {
+                if (fg) st.includePixel(px, py);
+            };
+            include(o, x, y);
+            include(p, x + 1, y);
+            include(s, x, y + 1);
+            include(t, x + 1, y + 1);
+            st.firstPixel = std::min(st.firstPixel, (o || p) ? rowStart + (o ? x : x + 1) : rowStart + w + (s ? x : x + 1));
+        }
+    }
+}
+
+struct Strip {
+    int y0 = 0;
+    int y1 = 0;
+    int base = 0; // global label = base + local label
+    LabelEquivalences eq;
+    std::vector<ProvisionalStats> stats;
+};
+
+template <typename Mask>
+ConnectedComponents connectedComponentsImpl(const Mask &mask, bool with_openmp) {
+    PROFILE_SCOPE("connectedComponents");
+    const int w = mask.width();
+    const int h = mask.height();
+    rassert(w > 0 && h > 0, 981350001, w, h);
+
+    ConnectedComponents res;
+    res.labels = image32i(w, h, 1, ImageInit::Zero);
+
+    // Strips are labelled independently with local labels, strip heights are even so blocks never cross strips
+    static_assert(kCclStripHeight % 2 == 0);
+    const int stripHeight = with_openmp ? kCclStripHeight : h + (h % 2);
+    const int nStrips = (h + stripHeight - 1) / stripHeight;
+    std::vector<Strip> strips(static_cast<std::size_t>(nStrips));
+
+    #pragma omp parallel for schedule(dynamic, 1) if(with_openmp && nStrips > 1)
+    for (int si = 0; si < nStrips; ++si) {
+        Strip &strip = strips[static_cast<std::size_t>(si)];
+        strip.y0 = si * stripHeight;
+        strip.y1 = std::min(h, strip.y0 + stripHeight);
+        labelStrip(mask, res.labels, strip.y0, strip.y1, strip.eq, strip.stats);
+    }
+
+    std::size_t stripsBytes = strips.capacity() * sizeof(Strip);
+    for (const Strip &strip : strips) {
+        stripsBytes += strip.eq.bytes() + strip.stats.capacity() * sizeof(ProvisionalStats);
+    }
+
+    // Global equivalences: local ones first, then unions along strip borders (labels of upper strips are smaller,
+    // so roots stay the smallest labels of their sets). Stats stay in their strips.
+    LabelEquivalences eq;
+    for (Strip &strip : strips) {
+        strip.base = eq.size() - 1;
+        eq.append(strip.eq);
+    }
+    res.scratchBytes = stripsBytes + eq.bytes();
+
+    for (int si = 1; si < nStrips; ++si) {
+        const Strip &strip = strips[static_cast<std::size_t>(si)];
+        const Strip &above = strips[static_cast<std::size_t>(si - 1)];
+        const int y = strip.y0;
+        const auto r0 = maskRow(mask, y);
+        const auto up = maskRow(mask, y - 1);
+        const int* labels = res.labels.ptr(y);
+        const int* labelsUp = res.labels.ptr(y - 2);
+
+        for (int x = 0; x < w; x += 2) {
+            if (!labels[x]) continue;
+            const bool o = r0[x];
+            const bool p = x + 1 < w && r0[x + 1];
+            const UpConnections c = upConnections(up, o, p, x, w);
+            const int g = strip.base + labels[x];
+            if (c.up) eq.unite(g, above.base + labelsUp[x]);
+            if (c.upLeft) eq.unite(g, above.base + labelsUp[x - 2]);
+            if (c.upRight) eq.unite(g, above.base + labelsUp[x + 2]);
+        }
+    }
+
+    // Global label -> its stats in the owning strip
+    auto statsOf = [&](int g) -> ProvisionalStats& {
+        auto it = std::upper_bound(strips.begin(), strips.end(), g, [](int v, const Strip &st) { return v <= st.base; });
+        Strip &strip = *(it - 1);
+        return strip.stats[static_cast<std::size_t>(g - strip.base)];
+    };
+
+    // Merge stats of provisional labels into their roots (roots are the smallest labels, so they are visited first).
+    std::vector<int> parent = eq.releaseFlattened();
+    const int provisional = static_cast<int>(parent.size());
+    std::vector<int> roots;
+    for (int l = 1; l < provisional; ++l) {
+        const int root = parent[static_cast<std::size_t>(l)];
+        if (root == l) {
+            roots.push_back(l);
+        } else {
+            statsOf(root).merge(statsOf(l));
+        }
+    }
+
+    // Deterministic order: by bbox top-left (y, then x).
+    std::sort(roots.begin(), roots.end(), [&](int a, int b) {
+        const ProvisionalStats &A = statsOf(a);
+        const ProvisionalStats &B = statsOf(b);
+        if (A.minY != B.minY) return A.minY < B.minY;
+        if (A.minX != B.minX) return A.minX < B.minX;
+        return A.firstPixel < B.firstPixel;
+    });
+    res.scratchBytes = std::max(res.scratchBytes, stripsBytes + parent.capacity() * sizeof(int) + roots.capacity() * sizeof(int));
+
+    res.components.reserve(roots.size());
+    for (int root : roots) res.components.push_back(statsOf(root).info());
+    for (Strip &strip : strips) strip.stats = {};
+
+    // Final labels replace parents in place: roots are marked by negated final labels first, then every other label
+    // takes the value of its root, which is never overwritten before that.
+    for (std::size_t k = 0; k < roots.size(); ++k) parent[static_cast<std::size_t>(roots[k])] = -(static_cast<int>(k) + 1);
+    for (int l = 1; l < provisional; ++l) {
+        int &v = parent[static_cast<std::size_t>(l)];
+        if (v > 0) v = parent[static_cast<std::size_t>(v)];
+    }
+    for (int &v : parent) v = -v;
+    const std::vector<int> &finalLabel = parent;
+
+    // Second sweep: spread final label of each block over its foreground pixels.
+    #pragma omp parallel for schedule(dynamic, 1) if(with_openmp && nStrips > 1)
+    for (int si = 0; si < nStrips; ++si) {
+        const Strip &strip = strips[static_cast<std::size_t>(si)];
+        for (int y = strip.y0; y < strip.y1; y += 2) {
+            const auto r0 = maskRow(mask, y);
+            const bool hasR1 = y + 1 < strip.y1;
+            const auto r1 = maskRow(mask, hasR1 ? y + 1 : y);
+            int* labels0 = res.labels.ptr(y);
+            int* labels1 = hasR1 ? res.labels.ptr(y + 1) : nullptr;
+
+            for (int x = 0; x < w; x += 2) {
+                const int provisionalLabel = labels0[x];
+                if (!provisionalLabel) continue;
+                const int label = finalLabel[static_cast<std::size_t>(strip.base + provisionalLabel)];
+                const bool hasX1 = x + 1 < w;
+
+                labels0[x] = r0[x] ? label : 0;
+                if (hasX1) labels0[x + 1] = r0[x + 1] ? label : 0;
+                if (hasR1) {
+                    labels1[x] = r1[x] ? label : 0;
+                    if (hasX1) labels1[x + 1] = r1[x + 1] ? label : 0;
+                }
+            }
+        }
+    }
+
+    return res;
+}
+
+} // namespace
+
+ConnectedComponents connectedComponents(const image8u &mask, bool with_openmp) {
+    rassert(mask.channels() == 1, 981350002, mask.channels());
+    return connectedComponentsImpl(mask, with_openmp);
+}
+
+ConnectedComponents connectedComponents(const BitMask &mask, bool with_openmp) {
+    return connectedComponentsImpl(mask, with_openmp);
+}
+
+std::vector<RunLengthMask> componentRunLengthMasks(const ConnectedComponents &components) {
+    std::vector<RunLengthMask> res;
+    res.reserve(components.components.size());
+    for (const ComponentInfo &component : components.components) {
+        res.emplace_back(component.bbox.width(), component.bbox.height());
+    }
+
+    const image32i &labels = components.labels;
+    for (int y = 0; y < labels.height(); ++y) {
+        const int* row = labels.ptr(y);
+        int x = 0;
+        while (x < labels.width()) {
+            const int label = row[x];
+            if (!label) {
+                ++x;
+                continue;
+            }
+            const int x0 = x;
+            while (x < labels.width() && row[x] == label) ++x;
+            const point2i offset = components.components[static_cast<std::size_t>(label - 1)].bbox.min;
+            res[static_cast<std::size_t>(label - 1)].appendRun(y - offset.y, x0 - offset.x, x - offset.x);
+        }
+    }
+    return res;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+#include <libimages/run_length_mask.h>
+#include <libbase/bbox2.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Rows per strip when labelling runs strips in parallel (even, so that 2x2 blocks never cross strips)
+inline constexpr int kCclStripHeight = 128;
+
+struct ComponentInfo final {
+    bbox2i bbox = bbox2i::make_empty();
+    std::int64_t area = 0; // number of pixels
+};
+
+struct ConnectedComponents final {
+    image32i labels;                       // same size as mask: component index + 1, or 0 for background
+    std::vector<ComponentInfo> components;
+    std::size_t scratchBytes = 0;          // peak temporary bookkeeping besides labels (per provisional label, not per pixel)
+
+    int count() const noexcept { return static_cast<int>(components.size()); }
+};
+
+// Two-pass 8-connectivity labelling over 2x2 blocks (block-based scan in the spirit of BBDT, C. Grana et al. 2010):
+// the first sweep labels blocks and merges label equivalences, the second one writes final labels and nothing else.
+// Components are ordered by bbox top-left (y, then x), ties are broken by the first pixel in raster order.
+// With OpenMP the first sweep runs over horizontal strips in parallel, their local labels are then merged along
+// strip borders; the result does not depend on with_openmp.
+ConnectedComponents connectedComponents(const image8u &mask, bool with_openmp = true); // 255 - foreground
+ConnectedComponents connectedComponents(const BitMask &mask, bool with_openmp = true);
+
+// Mask of every component over its bbox (coordinates relative to bbox min), in one pass over labels
+std::vector<RunLengthMask> componentRunLengthMasks(const ConnectedComponents &components);
@@ -0,0 +1,219 @@
+#include "connected_components.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
+#include <libimages/debug_io.h>
+#include <libimages/tests_utils.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Straightforward flood fill in raster order, components sorted by bbox top-left (y, then x)
+ConnectedComponents referenceComponents(const image8u &mask) {
+    const int w = mask.width();
+    const int h = mask.height();
+    image32i seed(w, h, 1, ImageInit::Zero);
+    std::vector<ComponentInfo> found;
+    std::vector<std::pair<int, int>> stack;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            if (mask(y, x) != 255 || seed(y, x)) continue;
+            found.emplace_back();
+            const int id = static_cast<int>(found.size());
+            seed(y, x) = id;
+            stack.push_back({x, y});
+            while (!stack.empty()) {
+                auto [cx, cy] = stack.back();
+                stack.pop_back();
+                found.back().bbox.include_pixel(cx, cy);
+                ++found.back().area;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const int nx = cx + dx;
+                        const int ny = cy + dy;
+                        if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+                        if (mask(ny, nx) != 255 || seed(ny, nx)) continue;
+                        seed(ny, nx) = id;
+                        stack.push_back({nx, ny});
+                    }
+                }
+            }
+        }
+    }
+
+    // stable sort keeps raster order of first pixels for equal bbox corners
+    std::vector<int> order(found.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        if (found[a].bbox.min.y != found[b].bbox.min.y) return found[a].bbox.min.y < found[b].bbox.min.y;
+        return found[a].bbox.min.x < found[b].bbox.min.x;
+    });
+    std::vector<int> remap(found.size() + 1, 0);
+    ConnectedComponents res;
+    for (size_t k = 0; k < order.size(); ++k) {
+        remap[order[k] + 1] = static_cast<int>(k) + 1;
+        res.components.push_back(found[order[k]]);
+    }
+    res.labels = image32i(w, h, 1, ImageInit::Zero);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) res.labels(y, x) = remap[seed(y, x)];
+    }
+    return res;
+}
+
+void expectSameComponents(const ConnectedComponents &actual, const ConnectedComponents &expected) {
+    ASSERT_EQ(actual.count(), expected.count());
+    EXPECT_EQ(actual.labels.toVector(), expected.labels.toVector());
+    for (int i = 0; i < expected.count(); ++i) {
+        const ComponentInfo &a = actual.components[i];
+        const ComponentInfo &e = expected.components[i];
+        EXPECT_EQ(a.area, e.area) << i;
+        EXPECT_EQ(a.bbox.min, e.bbox.min) << i;
+        EXPECT_EQ(a.bbox.max, e.bbox.max) << i;
+    }
+}
+
+image8u randomMask(int w, int h, float density, uint32_t seed) {
+    FastRandom r(seed);
+    image8u mask(w, h, 1);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) mask(y, x) = r.nextFloat() < density ? 255 : 0;
+    }
+    return mask;
+}
+
+} // namespace
+
+TEST(connected_components, diagonalPixelsAreConnected) {
+    image8u mask(5, 5, 1);
+    for (int i = 0; i < 5; ++i) mask(i, i) = 255;
+    mask(0, 4) = 255;
+    mask(4, 0) = 255;
+
+    ConnectedComponents cc = connectedComponents(mask);
+    ASSERT_EQ(cc.count(), 3);
+    EXPECT_EQ(cc.components[0].area, 5);
+    EXPECT_EQ(cc.labels(2, 2), 1);
+    EXPECT_EQ(cc.labels(0, 4), 2);
+    EXPECT_EQ(cc.labels(4, 0), 3);
+    EXPECT_EQ(cc.labels(0, 1), 0);
+}
+
+TEST(connected_components, uShapeMergesLabels) {
+    // two arms get different provisional labels and are merged at the bottom
+    image8u mask(7, 6, 1);
+    for (int y = 0; y < 6; ++y) {
+        mask(y, 0) = 255;
+        mask(y, 6) = 255;
+    }
+    for (int x = 0; x < 7; ++x) mask(5, x) = 255;
+    mask(1, 3) = 255;
+
+    ConnectedComponents cc = connectedComponents(mask);
+    ASSERT_EQ(cc.count(), 2);
+    EXPECT_EQ(cc.components[0].area, 6 + 6 + 5);
+    EXPECT_EQ(cc.components[0].bbox.min, point2i(0, 0));
+    EXPECT_EQ(cc.components[0].bbox.max, point2i(7, 6));
+    EXPECT_EQ(cc.labels(0, 6), 1);
+    EXPECT_EQ(cc.labels(1, 3), 2);
+}
+
+TEST(connected_components, matchesFloodFillOnRandomMasks) {
+    configureWorkingDirectory();
+
+    // odd sizes cover partial 2x2 blocks on the right and bottom borders
+    const int sizes[][2] = {{1, 1}, {1, 7}, {7, 1}, {2, 2}, {3, 5}, {64, 48}, {101, 77}, {130, 3}};
+    const float densities[] = {0.1f, 0.35f, 0.5f, 0.65f, 0.9f};
+    uint32_t seed = 1;
+    for (auto [w, h] : sizes) {
+        for (float density : densities) {
+            const image8u mask = randomMask(w, h, density, seed++);
+            const ConnectedComponents expected = referenceComponents(mask);
+
+            SCOPED_TRACE(testing::Message() << w << "x" << h << " density=" << density);
+            expectSameComponents(connectedComponents(mask), expected);
+            expectSameComponents(connectedComponents(BitMask::fromImage(mask)), expected);
+        }
+    }
+
+    const image8u mask = randomMask(101, 77, 0.5f, 239);
+    debug_io::dump_image(getUnitCaseDebugDir() + "00_mask.png", mask);
+    debug_io::dump_image(getUnitCaseDebugDir() + "01_labels.png", debug_io::colorize_labels(connectedComponents(mask).labels, 0));
+}
+
+TEST(connected_components, stripsMergeAcrossBorders) {
+    // several strips, including an odd-height last one, and shapes crossing every strip border
+    const int w = 93;
+    const int h = 3 * kCclStripHeight + 7;
+    for (float density : {0.3f, 0.5f, 0.6f}) {
+        image8u mask = randomMask(w, h, density, 17);
+        for (int y = 0; y < h; ++y) mask(y, 40) = 255;                              // vertical line through all strips
+        for (int i = 0; i < 2 * kCclStripHeight && i < w; ++i) mask(kCclStripHeight - 5 + i % 11, i) = 255; // zigzag
+        for (int x = 0; x < w; ++x) mask(kCclStripHeight, x) = (x % 3 == 0) ? 255 : 0; // first row of a strip
+
+        const ConnectedComponents expected = referenceComponents(mask);
+        SCOPED_TRACE(testing::Message() << "density=" << density);
+        expectSameComponents(connectedComponents(mask, true), expected);
+        expectSameComponents(connectedComponents(mask, false), expected);
+        expectSameComponents(connectedComponents(BitMask::fromImage(mask), true), expected);
+    }
+
+    // diagonal touching exactly at a strip border
+    image8u mask(8, 2 * kCclStripHeight, 1);
+    mask(kCclStripHeight - 1, 2) = 255;
+    mask(kCclStripHeight, 3) = 255;
+    mask(kCclStripHeight - 1, 6) = 255;
+    mask(kCclStripHeight, 5) = 255;
+    const ConnectedComponents cc = connectedComponents(mask, true);
+    EXPECT_EQ(cc.count(), 2);
+    expectSameComponents(cc, referenceComponents(mask));
+}
+
+TEST(connected_components, scratchIsPerLabelNotPerPixel) {
+    // a few big blobs: bookkeeping does not grow with image area
+    const int w = 1000;
+    const int h = 800;
+    image8u mask(w, h, 1);
+    for (int y = 100; y < 300; ++y) {
+        for (int x = 50; x < 400; ++x) mask(y, x) = 255;
+    }
+    for (int y = 400; y < 750; ++y) {
+        for (int x = 500; x < 950; ++x) mask(y, x) = ((x - 725) * (x - 725) + (y - 575) * (y - 575) < 150 * 150) ? 255 : 0;
+    }
+    const ConnectedComponents cc = connectedComponents(mask);
+    ASSERT_EQ(cc.count(), 2);
+    EXPECT_LT(cc.scratchBytes, static_cast<std::size_t>(w) * h / 50);
+
+    // worst case (isolated pixels in every 2x2 block) stays within a small constant per pixel
+    image8u dots(w, h, 1);
+    for (int y = 0; y < h; y += 2) {
+        for (int x = 0; x < w; x += 2) dots(y, x) = 255;
+    }
+    const ConnectedComponents ccDots = connectedComponents(dots);
+    ASSERT_EQ(ccDots.count(), (w / 2) * (h / 2));
+    EXPECT_LT(ccDots.scratchBytes, static_cast<std::size_t>(w) * h * 12);
+}
+
+TEST(connected_components, runLengthMasksMatchLabels) {
+    const image8u mask = randomMask(57, 41, 0.55f, 3);
+    const ConnectedComponents cc = connectedComponents(mask);
+    const std::vector<RunLengthMask> masks = componentRunLengthMasks(cc);
+    ASSERT_EQ(static_cast<int>(masks.size()), cc.count());
+
+    for (int i = 0; i < cc.count(); ++i) {
+        const bbox2i &bb = cc.components[i].bbox;
+        ASSERT_EQ(masks[i].width(), bb.width());
+        ASSERT_EQ(masks[i].height(), bb.height());
+        EXPECT_EQ(masks[i].area(), cc.components[i].area);
+        for (int y = 0; y < bb.height(); ++y) {
+            for (int x = 0; x < bb.width(); ++x) {
+                ASSERT_EQ(masks[i].get(y, x), cc.labels(bb.min.y + y, bb.min.x + x) == i + 1) << i;
+            }
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "convert.h"
+
+#include "float16_kernels.h"
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+constexpr int void_label32 = std::numeric_limits<int>::max();
+constexpr std::uint16_t void_label16 = std::numeric_limits<std::uint16_t>::max();
+
+} // namespace
+
+image16f to_float16(const image32f &image) {
+    image16f out(image.width(), image.height(), image.channels(), ImageInit::Uninitialized);
+    const float16_kernels::Kernels &kernels = float16_kernels::best();
+    const int n = image.width() * image.channels();
+    parallelForEach(0, image.height(), [&](int j) { kernels.fromFloatRow(image.ptr(j), n, out.ptr(j)); });
+    return out;
+}
+
+image32f to_float32(const image16f &image) {
+    image32f out(image.width(), image.height(), image.channels(), ImageInit::Uninitialized);
+    const float16_kernels::Kernels &kernels = float16_kernels::best();
+    const int n = image.width() * image.channels();
+    parallelForEach(0, image.height(), [&](int j) { kernels.toFloatRow(image.ptr(j), n, out.ptr(j)); });
+    return out;
+}
+
+image16u to_labels16(const image32i &labels) {
+    image16u out(labels.width(), labels.height(), labels.channels(), ImageInit::Uninitialized);
+    const int n = labels.width() * labels.channels();
+    std::atomic<bool> inRange{true};
+    parallelForEach(0, labels.height(), [&](int j) {
+        const int *src = labels.ptr(j);
+        std::uint16_t *dst = out.ptr(j);
+        bool ok = true;
+        for (int i = 0; i < n; ++i) {
+            const int v = src[i];
+            ok = ok && ((v >= 0 && v < void_label16) || v == void_label32);
+            dst[i] = v == void_label32 ? void_label16 : static_cast<std::uint16_t>(v);
+        }
+        if (!ok) inRange = false;
+    });
+    rassert(inRange.load(), 771042401, "labels do not fit into 16 bits");
+    return out;
+}
+
+image32i to_labels32(const image16u &labels) {
+    image32i out(labels.width(), labels.height(), labels.channels(), ImageInit::Uninitialized);
+    const int n = labels.width() * labels.channels();
+    parallelForEach(0, labels.height(), [&](int j) {
+        const std::uint16_t *src = labels.ptr(j);
+        int *dst = out.ptr(j);
+        for (int i = 0; i < n; ++i) dst[i] = src[i] == void_label16 ? void_label32 : src[i];
+    });
+    return out;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <libimages/image.h>
+
+// Conversions to and from the 16-bit element types (half the memory and bandwidth of their 32-bit counterparts),
+// rows are converted in parallel, float16 ones by SIMD kernels (see float16_kernels.h)
+
+// Rounds to nearest even, values beyond +-65504 become infinities
+image16f to_float16(const image32f &image);
+image32f to_float32(const image16f &image);
+
+// Labels must be in [0, 65534], std::numeric_limits<int>::max() (the usual void label) maps to 65535 and back
+image16u to_labels16(const image32i &labels);
+image32i to_labels32(const image16u &labels);
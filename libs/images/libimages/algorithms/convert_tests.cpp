@@ -0,0 +1,70 @@
+#include "convert.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/runtime_assert.h>
+#include <libimages/algorithms/blur.h>
+#include <libimages/algorithms/downsample.h>
+#include <libimages/debug_io.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+TEST(convert, float16RoundTrip) {
+    image32f img(67, 5, 3);
+    for (int y = 0; y < img.height(); ++y)
+        for (int x = 0; x < img.width(); ++x)
+            for (int c = 0; c < 3; ++c) img(y, x, c) = float(x * 3 + c) + float(y) / 8.0f;
+
+    const image16f half = to_float16(img);
+    ASSERT_EQ(half.size(), img.size());
+    const image32f back = to_float32(half);
+    for (int y = 0; y < img.height(); ++y)
+        for (int x = 0; x < img.width(); ++x)
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_EQ(half(y, x, c), float16(img(y, x, c)));
+                ASSERT_EQ(back(y, x, c), img(y, x, c)); // all of these fit into 11 bits
+            }
+}
+
+TEST(convert, labels16RoundTrip) {
+    image32i labels(10, 4, 1);
+    labels.fill(std::numeric_limits<int>::max());
+    labels(1, 2) = 0;
+    labels(2, 3) = 65534;
+    const image16u labels16 = to_labels16(labels);
+    EXPECT_EQ(labels16(0, 0), 65535);
+    EXPECT_EQ(labels16(2, 3), 65534);
+    EXPECT_EQ(to_labels32(labels16).toVector(), labels.toVector());
+    EXPECT_EQ(debug_io::colorize_labels(labels16).toVector(), debug_io::colorize_labels(labels).toVector());
+
+    labels(3, 3) = 70000;
+    EXPECT_THROW(to_labels16(labels), assertion_error);
+    labels(3, 3) = -1;
+    EXPECT_THROW(to_labels16(labels), assertion_error);
+}
+
+TEST(convert, halfImagesInFilters) {
+    image32f img(40, 30, 1);
+    for (int y = 0; y < img.height(); ++y)
+        for (int x = 0; x < img.width(); ++x) img(y, x) = float((x * 7 + y * 13) % 29);
+    const image16f half = to_float16(img);
+
+    // filters compute in float either way, so the results differ only by the final rounding to float16
+    const image32f blurred = blur(img, 2.0f);
+    const image32f blurredHalf = to_float32(blur(half, 2.0f));
+    const image32f small = downsample_2x(img);
+    const image32f smallHalf = to_float32(downsample_2x(half));
+    for (int y = 0; y < img.height(); ++y)
+        for (int x = 0; x < img.width(); ++x) EXPECT_NEAR(blurredHalf(y, x), blurred(y, x), 0.02f);
+    for (int y = 0; y < small.height(); ++y)
+        for (int x = 0; x < small.width(); ++x) EXPECT_EQ(smallHalf(y, x), small(y, x)); // quarters of integers are exact
+
+    image16u counts(8, 8, 1);
+    counts.fill(60000);
+    EXPECT_EQ(blur(counts, 1.5f)(3, 3), 60000);
+    EXPECT_EQ(downsample(counts, 3, 3, DownsampleMethod::Area)(1, 1), 60000);
+
+    EXPECT_EQ(debug_io::normalize(half).toVector(), debug_io::normalize(img).toVector());
+}
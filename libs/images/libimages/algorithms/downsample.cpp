@@ -1,18 +1,20 @@
 // downsample.cpp
 #include "downsample.h"
 
+#include "filter_utils.h"
+
 #include <libbase/runtime_assert.h>
+#include <libimages/channels.h>
 
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <type_traits>
 #include <vector>
 
 namespace {
 
-inline int clampi(int v, int lo, int hi) noexcept {
-    return std::max(lo, std::min(hi, v));
-}
+using filter_utils::clampi;
 
 inline int map_index_round(int i, int n, int m) {
     // Map i in [0..n-1] to idx in [0..m-1], preserving endpoints with rounding.
@@ -22,15 +24,139 @@ inline int map_index_round(int i, int n, int m) {
     return clampi(idx, 0, m - 1);
 }
 
+} // namespace
+
+int downsample_source_index(int i, int n, int m) {
+    if (n == 1) return (m <= 0) ? 0 : (m / 2);
+    return map_index_round(i, n, m);
+}
+
+namespace {
+
+using filter_utils::from_f;
+
+// Source pixels covered by each destination pixel of an axis and their weights (sum to 1)
+struct AreaWeights {
+    std::vector<int> begin;    // [n + 1] ranges into src/w
+    std::vector<int> src;
+    std::vector<float> w;
+};
+
+AreaWeights makeAreaWeights(int n, int m) {
+    AreaWeights aw;
+    aw.begin.reserve(static_cast<size_t>(n) + 1);
+    const double scale = static_cast<double>(m) / n;
+    for (int i = 0; i < n; ++i) {
+        aw.begin.push_back(static_cast<int>(aw.src.size()));
+        const double from = i * scale;
+        const double to = (i + 1) * scale;
+        const int j0 = clampi(static_cast<int>(std::floor(from)), 0, m - 1);
+        const int j1 = clampi(static_cast<int>(std::ceil(to)), j0 + 1, m);
+        for (int j = j0; j < j1; ++j) {
+            const double overlap = std::min<double>(to, j + 1) - std::max<double>(from, j);
+            if (overlap <= 0.0) continue;
+            aw.src.push_back(j);
+            aw.w.push_back(static_cast<float>(overlap / scale));
+        }
+    }
+    aw.begin.push_back(static_cast<int>(aw.src.size()));
+    return aw;
+}
+
+template <typename T>
+void downsample_nearest(ImageView<const T> image, int w, int h, Image<T>& out) {
+    const int srcW = image.width();
+    const int srcH = image.height();
+
+    out.ensureSize(w, h, image.channels());
+
+    dispatch_channels(image.channels(), [&](auto C) {
+        // Column mapping is the same for all rows, so it is computed once (already multiplied by channels)
+        std::vector<int> sxs(static_cast<size_t>(w));
+        for (int x = 0; x < w; ++x) sxs[x] = downsample_source_index(x, w, srcW) * C;
+
+        #pragma omp parallel for
+        for (int y = 0; y < h; ++y) {
+            const T* src = image.ptr(downsample_source_index(y, h, srcH));
+            T* dst = out.ptr(y);
+            for (int x = 0; x < w; ++x) {
+                const T* px = src + sxs[x];
+                for (int c = 0; c < C; ++c) dst[C * x + c] = px[c];
+            }
+        }
+    });
+}
+
 template <typename T>
-inline int safe_mid_index(int m) {
-    return (m <= 0) ? 0 : (m / 2);
+void downsample_area(ImageView<const T> image, int w, int h, Image<T>& out) {
+    const int srcW = image.width();
+    const int srcH = image.height();
+    const int ch = image.channels();
+
+    const AreaWeights ax = makeAreaWeights(w, srcW);
+    const AreaWeights ay = makeAreaWeights(h, srcH);
+
+    // Horizontal pass: every source row to w columns
+    const size_t n = static_cast<size_t>(w) * static_cast<size_t>(ch);
+    std::vector<float> tmp(n * static_cast<size_t>(srcH));
+
+    dispatch_channels(ch, [&](auto C) {
+        #pragma omp parallel for
+        for (int y = 0; y < srcH; ++y) {
+            const T* src = image.ptr(y);
+            float* dst = tmp.data() + static_cast<size_t>(y) * n;
+            for (int x = 0; x < w; ++x) {
+                float acc[decltype(C)::value] = {};
+                for (int k = ax.begin[x]; k < ax.begin[x + 1]; ++k) {
+                    const T* px = src + static_cast<size_t>(ax.src[k]) * C;
+                    for (int c = 0; c < C; ++c) acc[c] += ax.w[k] * static_cast<float>(px[c]);
+                }
+                for (int c = 0; c < C; ++c) dst[static_cast<size_t>(x) * C + c] = acc[c];
+            }
+        }
+    });
+
+    out.ensureSize(w, h, ch);
+
+    #pragma omp parallel
+    {
+        std::vector<float> acc(n);
+
+        #pragma omp for
+        for (int y = 0; y < h; ++y) {
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int k = ay.begin[y]; k < ay.begin[y + 1]; ++k) {
+                const float wk = ay.w[k];
+                const float* row = tmp.data() + static_cast<size_t>(ay.src[k]) * n;
+                for (size_t i = 0; i < n; ++i) acc[i] += wk * row[i];
+            }
+            T* dst = out.ptr(y);
+            for (size_t i = 0; i < n; ++i) dst[i] = from_f<T>(acc[i]);
+        }
+    }
 }
 
 } // namespace
 
 template <typename T>
-Image<T> downsample(const Image<T> &image, int w, int h) {
+Image<T> downsample(const Image<T> &image, int w, int h, DownsampleMethod method) {
+    return downsample(ImageView<const T>(image), w, h, method);
+}
+
+template <typename T>
+Image<T> downsample(ImageView<const T> image, int w, int h, DownsampleMethod method) {
+    Image<T> out;
+    downsample(image, out, w, h, method);
+    return out;
+}
+
+template <typename T>
+void downsample(const Image<T> &image, Image<T> &dst, int w, int h, DownsampleMethod method) {
+    downsample(ImageView<const T>(image), dst, w, h, method);
+}
+
+template <typename T>
+void downsample(ImageView<const T> image, Image<T> &dst, int w, int h, DownsampleMethod method) {
     rassert(w > 0 && h > 0, 781234981);
 
     const int srcW = image.width();
@@ -39,28 +165,81 @@ Image<T> downsample(const Image<T> &image, int w, int h) {
     rassert(srcW > 0 && srcH > 0, 781234982);
     rassert(ch == 1 || ch == 3, 781234983, ch);
 
-    Image<T> out(w, h, ch);
+    if (overlaps(image, dst)) {
+        dst = downsample(image, w, h, method);
+        return;
+    }
+    if (method == DownsampleMethod::Area) {
+        downsample_area(image, w, h, dst);
+    } else {
+        downsample_nearest(image, w, h, dst);
+    }
+}
 
-    // Handle degenerate mappings (target size 1) by sampling center in that axis.
-    const int sx_center = safe_mid_index<T>(srcW);
-    const int sy_center = safe_mid_index<T>(srcH);
+template <typename T>
+Image<T> downsample_2x(const Image<T> &image) {
+    return downsample_2x(ImageView<const T>(image));
+}
 
-    for (int y = 0; y < h; ++y) {
-        const int sy = (h == 1) ? sy_center : map_index_round(y, h, srcH);
-        for (int x = 0; x < w; ++x) {
-            const int sx = (w == 1) ? sx_center : map_index_round(x, w, srcW);
+template <typename T>
+Image<T> downsample_2x(ImageView<const T> image) {
+    Image<T> out;
+    downsample_2x(image, out);
+    return out;
+}
 
-            if (ch == 1) {
-                out(y, x) = image(sy, sx);
-            } else {
-                out(y, x, 0) = image(sy, sx, 0);
-                out(y, x, 1) = image(sy, sx, 1);
-                out(y, x, 2) = image(sy, sx, 2);
-            }
-        }
+template <typename T>
+void downsample_2x(const Image<T> &image, Image<T> &dst) {
+    downsample_2x(ImageView<const T>(image), dst);
+}
+
+template <typename T>
+void downsample_2x(ImageView<const T> image, Image<T> &out) {
+    const int srcW = image.width();
+    const int srcH = image.height();
+    const int ch = image.channels();
+    rassert(srcW > 0 && srcH > 0, 781234984);
+
+    if (overlaps(image, out)) {
+        out = downsample_2x(image);
+        return;
     }
 
-    return out;
+    const int w = (srcW + 1) / 2;
+    const int h = (srcH + 1) / 2;
+    const size_t srcN = static_cast<size_t>(srcW) * ch;
+    out.ensureSize(w, h, ch);
+
+    using Sum = std::conditional_t<std::is_integral_v<T>, std::int64_t, float>;
+
+    dispatch_channels(ch, [&](auto C) {
+        #pragma omp parallel
+        {
+            // Vertical pair sum over contiguous row first (vectorizes well), then horizontal pairs
+            std::vector<Sum> rowSum(srcN);
+
+            #pragma omp for
+            for (int y = 0; y < h; ++y) {
+                const T* r0 = image.ptr(2 * y);
+                const T* r1 = image.ptr(std::min(2 * y + 1, srcH - 1));
+                for (size_t i = 0; i < srcN; ++i) rowSum[i] = static_cast<Sum>(r0[i]) + static_cast<Sum>(r1[i]);
+
+                T* dst = out.ptr(y);
+                for (int x = 0; x < w; ++x) {
+                    const size_t i0 = static_cast<size_t>(2 * x) * C;
+                    const size_t i1 = static_cast<size_t>(std::min(2 * x + 1, srcW - 1)) * C;
+                    for (int c = 0; c < C; ++c) {
+                        const Sum s = rowSum[i0 + c] + rowSum[i1 + c];
+                        if constexpr (std::is_integral_v<T>) {
+                            dst[static_cast<size_t>(x) * C + c] = static_cast<T>((s + 2) >> 2);
+                        } else {
+                            dst[static_cast<size_t>(x) * C + c] = static_cast<T>(s * 0.25f);
+                        }
+                    }
+                }
+            }
+        }
+    });
 }
 
 template <typename T>
@@ -74,13 +253,8 @@ std::vector<Color<T>> downsample(const std::vector<Color<T>> &colors, int n) {
     std::vector<Color<T>> out;
     out.reserve(static_cast<size_t>(n));
 
-    if (n == 1) {
-        out.push_back(colors[m / 2]);
-        return out;
-    }
-
     for (int i = 0; i < n; ++i) {
-        const int idx = map_index_round(i, n, m);
+        const int idx = downsample_source_index(i, n, m);
         out.push_back(colors[idx]);
     }
 
@@ -88,9 +262,49 @@ std::vector<Color<T>> downsample(const std::vector<Color<T>> &colors, int n) {
 }
 
 // ---- explicit instantiations ----
-template Image<std::uint8_t> downsample(const Image<std::uint8_t>& image, int w, int h);
-template Image<float>        downsample(const Image<float>& image, int w, int h);
-template Image<int>          downsample(const Image<int>& image, int w, int h);
+template Image<std::uint8_t> downsample(const Image<std::uint8_t>& image, int w, int h, DownsampleMethod method);
+template Image<float>        downsample(const Image<float>& image, int w, int h, DownsampleMethod method);
+template Image<int>          downsample(const Image<int>& image, int w, int h, DownsampleMethod method);
+template Image<std::uint16_t> downsample(const Image<std::uint16_t>& image, int w, int h, DownsampleMethod method);
+template Image<float16>      downsample(const Image<float16>& image, int w, int h, DownsampleMethod method);
+template Image<std::uint8_t> downsample(ImageView<const std::uint8_t> image, int w, int h, DownsampleMethod method);
+template Image<float>        downsample(ImageView<const float> image, int w, int h, DownsampleMethod method);
+template Image<int>          downsample(ImageView<const int> image, int w, int h, DownsampleMethod method);
+template Image<std::uint16_t> downsample(ImageView<const std::uint16_t> image, int w, int h, DownsampleMethod method);
+template Image<float16>      downsample(ImageView<const float16> image, int w, int h, DownsampleMethod method);
+
+template Image<std::uint8_t> downsample_2x(const Image<std::uint8_t>& image);
+template Image<float>        downsample_2x(const Image<float>& image);
+template Image<int>          downsample_2x(const Image<int>& image);
+template Image<std::uint16_t> downsample_2x(const Image<std::uint16_t>& image);
+template Image<float16>      downsample_2x(const Image<float16>& image);
+template Image<std::uint8_t> downsample_2x(ImageView<const std::uint8_t> image);
+template Image<float>        downsample_2x(ImageView<const float> image);
+template Image<int>          downsample_2x(ImageView<const int> image);
+template Image<std::uint16_t> downsample_2x(ImageView<const std::uint16_t> image);
+template Image<float16>      downsample_2x(ImageView<const float16> image);
+
+template void downsample(const Image<std::uint8_t>& image, Image<std::uint8_t>& dst, int w, int h, DownsampleMethod method);
+template void downsample(const Image<float>& image, Image<float>& dst, int w, int h, DownsampleMethod method);
+template void downsample(const Image<int>& image, Image<int>& dst, int w, int h, DownsampleMethod method);
+template void downsample(const Image<std::uint16_t>& image, Image<std::uint16_t>& dst, int w, int h, DownsampleMethod method);
+template void downsample(const Image<float16>& image, Image<float16>& dst, int w, int h, DownsampleMethod method);
+template void downsample(ImageView<const std::uint8_t> image, Image<std::uint8_t>& dst, int w, int h, DownsampleMethod method);
+template void downsample(ImageView<const float> image, Image<float>& dst, int w, int h, DownsampleMethod method);
+template void downsample(ImageView<const int> image, Image<int>& dst, int w, int h, DownsampleMethod method);
+template void downsample(ImageView<const std::uint16_t> image, Image<std::uint16_t>& dst, int w, int h, DownsampleMethod method);
+template void downsample(ImageView<const float16> image, Image<float16>& dst, int w, int h, DownsampleMethod method);
+
+template void downsample_2x(const Image<std::uint8_t>& image, Image<std::uint8_t>& dst);
+template void downsample_2x(const Image<float>& image, Image<float>& dst);
+template void downsample_2x(const Image<int>& image, Image<int>& dst);
+template void downsample_2x(const Image<std::uint16_t>& image, Image<std::uint16_t>& dst);
+template void downsample_2x(const Image<float16>& image, Image<float16>& dst);
+template void downsample_2x(ImageView<const std::uint8_t> image, Image<std::uint8_t>& dst);
+template void downsample_2x(ImageView<const float> image, Image<float>& dst);
+template void downsample_2x(ImageView<const int> image, Image<int>& dst);
+template void downsample_2x(ImageView<const std::uint16_t> image, Image<std::uint16_t>& dst);
+template void downsample_2x(ImageView<const float16> image, Image<float16>& dst);
 
 template std::vector<Color<std::uint8_t>> downsample(const std::vector<Color<std::uint8_t>>& colors, int n);
 template std::vector<Color<float>>        downsample(const std::vector<Color<float>>& colors, int n);
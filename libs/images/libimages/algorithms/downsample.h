@@ -4,9 +4,41 @@
 
 #include <libimages/color.h>
 #include <libimages/image.h>
+#include <libimages/image_view.h>
 
+// Nearest-neighbour sampling: destination index i in [0, n) maps to source index round(i * (m - 1) / (n - 1)),
+// so both endpoints are preserved (n == 1 takes the middle one)
+int downsample_source_index(int i, int n, int m);
+
+//   Nearest - takes single source pixel per destination pixel (see downsample_source_index)
+//   Area    - averages all source pixels covered by the destination pixel footprint (weighted by fractional coverage),
+//             no aliasing on strong downscaling
+enum class DownsampleMethod { Nearest, Area };
+
+template <typename T>
+Image<T> downsample(const Image<T> &image, int w, int h, DownsampleMethod method=DownsampleMethod::Nearest);
+
+template <typename T>
+Image<T> downsample(ImageView<const T> image, int w, int h, DownsampleMethod method=DownsampleMethod::Nearest);
+
+// Averages 2x2 blocks (pyramid level), result is ceil(w/2) x ceil(h/2), the last odd column/row is replicated.
+// Integer types are rounded half up.
+template <typename T>
+Image<T> downsample_2x(const Image<T> &image);
+
+template <typename T>
+Image<T> downsample_2x(ImageView<const T> image);
+
+// Into dst, reusing its buffer if it already has the size of the result (see Image::ensureSize).
+// dst may be image itself (or the image a view is of): then the result replaces its buffer.
+template <typename T>
+void downsample(const Image<T> &image, Image<T> &dst, int w, int h, DownsampleMethod method=DownsampleMethod::Nearest);
+template <typename T>
+void downsample(ImageView<const T> image, Image<T> &dst, int w, int h, DownsampleMethod method=DownsampleMethod::Nearest);
+template <typename T>
+void downsample_2x(const Image<T> &image, Image<T> &dst);
 template <typename T>
-Image<T> downsample(const Image<T> &image, int w, int h);
+void downsample_2x(ImageView<const T> image, Image<T> &dst);
 
 template <typename T>
 std::vector<Color<T>> downsample(const std::vector<Color<T>> &colors, int n);
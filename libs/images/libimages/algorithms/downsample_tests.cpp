@@ -241,3 +241,98 @@ TEST(downsample, image_rgb_preserves_channels) {
     debug_io::dump_image(getUnitCaseDebugDir() + "00_src.png", src);
     debug_io::dump_image(getUnitCaseDebugDir() + "01_ds_2x2.png", ds);
 }
+
+TEST(downsample, area_integer_factor_is_block_mean) {
+    image8u src(12, 9, 3);
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            set_rgb(src, x, y, static_cast<uint8_t>(x * 20), static_cast<uint8_t>(y * 25), static_cast<uint8_t>((x * y) % 200));
+
+    const image8u dst = downsample(src, 4, 3, DownsampleMethod::Area);
+    ASSERT_EQ(dst.width(), 4);
+    ASSERT_EQ(dst.height(), 3);
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                double sum = 0;
+                for (int dy = 0; dy < 3; ++dy)
+                    for (int dx = 0; dx < 3; ++dx)
+                        sum += src(3 * y + dy, 3 * x + dx, c);
+                EXPECT_NEAR(dst(y, x, c), sum / 9.0, 0.5 + 1e-3) << x << " " << y << " " << c;
+            }
+        }
+    }
+}
+
+TEST(downsample, area_fractional_factor_preserves_mean_and_constants) {
+    image32f src(10, 7, 1);
+    double mean = 0;
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x) {
+            src(y, x) = static_cast<float>(x * 3 + y * 5);
+            mean += src(y, x);
+        }
+    mean /= 70.0;
+
+    const image32f dst = downsample(src, 4, 3, DownsampleMethod::Area);
+    double dstMean = 0;
+    for (float v : dst.toVector()) dstMean += v;
+    EXPECT_NEAR(dstMean / 12.0, mean, 1e-3);
+
+    image8u flat(13, 11, 1);
+    flat.fill(77);
+    for (auto v : downsample(flat, 5, 4, DownsampleMethod::Area).toVector()) EXPECT_EQ(v, 77);
+
+    // same size is identity
+    EXPECT_EQ(downsample(src, 10, 7, DownsampleMethod::Area).toVector(), src.toVector());
+}
+
+TEST(downsample, half_averages_2x2_and_replicates_odd_border) {
+    image8u src(5, 3, 1);
+    for (int y = 0; y < 3; ++y)
+        for (int x = 0; x < 5; ++x)
+            src(y, x) = static_cast<uint8_t>(10 * x + 50 * y);
+
+    const image8u dst = downsample_2x(src);
+    ASSERT_EQ(dst.width(), 3);
+    ASSERT_EQ(dst.height(), 2);
+    EXPECT_EQ(dst(0, 0), (0 + 10 + 50 + 60 + 2) / 4);
+    EXPECT_EQ(dst(0, 2), (40 + 40 + 90 + 90 + 2) / 4);
+    EXPECT_EQ(dst(1, 1), (120 + 130 + 120 + 130 + 2) / 4);
+    EXPECT_EQ(dst(1, 2), 140);
+
+    image32f f(4, 4, 3);
+    f.fill(1.5f);
+    for (float v : downsample_2x(f).toVector()) EXPECT_EQ(v, 1.5f);
+}
+
+TEST(downsample, intoDstReusesBufferAndAllowsInPlace) {
+    image8u src(37, 29, 3);
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            for (int c = 0; c < 3; ++c)
+                src(y, x, c) = static_cast<uint8_t>((x * 13 + y * 3 + c * 50) % 256);
+
+    for (DownsampleMethod method : {DownsampleMethod::Nearest, DownsampleMethod::Area}) {
+        const image8u expected = downsample(src, 15, 11, method);
+        image8u dst;
+        downsample(src, dst, 15, 11, method);
+        EXPECT_EQ(dst.toVector(), expected.toVector());
+        const uint8_t *buffer = dst.ptr(0);
+        downsample(src, dst, 15, 11, method);
+        EXPECT_EQ(dst.ptr(0), buffer);
+        EXPECT_EQ(dst.toVector(), expected.toVector());
+
+        image8u inPlace = src;
+        downsample(inPlace, inPlace, 15, 11, method);
+        EXPECT_EQ(inPlace.width(), 15);
+        EXPECT_EQ(inPlace.toVector(), expected.toVector());
+    }
+
+    image8u half;
+    downsample_2x(src, half);
+    EXPECT_EQ(half.toVector(), downsample_2x(src).toVector());
+    image8u inPlace = src;
+    downsample_2x(image8u_cview(inPlace), inPlace);
+    EXPECT_EQ(inPlace.toVector(), half.toVector());
+}
@@ -1,6 +1,7 @@
 #include "extract_contour.h"
 
 #include <libbase/runtime_assert.h>
+#include <libimages/algorithms/morphology.h>
 
 #include <algorithm>
 #include <cstddef>
@@ -62,72 +63,20 @@ inline void rotateToMinYX(std::vector<point2i>& pts) {
     std::rotate(pts.begin(), pts.begin() + best, pts.end());
 }
 
-} // namespace
-
-image8u buildContourMask(const image8u &objectMask) {
-    rassert(objectMask.channels() == 1, 918273645);
-
-    const int w = objectMask.width();
-    const int h = objectMask.height();
-
-    // это новая маска которую мы хотим построить, изначально она заполнена нулями (черная)
-    image8u contour(w, h, 1);
-
-    // DONE для каждого пикселя вам надо сделать следующее
-    // посмотреть на 8 соседей - по стороне и диагонали (будьте аккуратны - не выйдите за пределы картинки)
-    // если среди них только 255 - то наш пиксель внутри объекта, то есть наш пиксель - не граница
-    // если среди них только 0 - то наш пиксель снаружи объекта (фон), то есть наш пиксель - не граница
-    // а вот если среди соседей есть и те и те - то мы на границе!
-    // и в таком случае надо сохранить в нашем пикселе в contour(j, i) число 255
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            if (objectMask(y, x) != kFg) continue;
-
-            bool isBoundary = false;
-            for (int k = 0; k < 8; ++k) {
-                const int nx = x + dx8[k];
-                const int ny = y + dy8[k];
-                if (!inBounds(nx, ny, w, h) || objectMask(ny, nx) != kFg) {
-                    isBoundary = true;
-                    break;
-                }
-            }
-            if (isBoundary) contour(y, x) = kFg;
-        }
-    }
-
-    return contour;
-}
-
-std::vector<point2i> extractContour(const image8u &objectContourMask) {
-    rassert(objectContourMask.channels() == 1, 918273646);
-
-    const int w = objectContourMask.width();
-    const int h = objectContourMask.height();
-
-    // Find start: top-most, then left-most contour pixel.
-    point2i start{-1, -1};
-    for (int y = 0; y < h && start.x < 0; ++y) {
-        for (int x = 0; x < w; ++x) {
-            if (objectContourMask(y, x) == kFg) {
-                start = {x, y};
-                break;
-            }
-        }
-    }
-    if (start.x < 0) return {};
-
+// Moore neighbor tracing (8-connected) from start (top-most, then left-most pixel), using clockwise neighbor order.
+// isFg(x, y) tells whether a pixel (possibly out of image) belongs to the traced contour.
+template <typename IsFg>
+std::vector<point2i> traceMoore(int w, int h, point2i start, const IsFg &isFg) {
     // Degenerate: single pixel contour.
     bool hasNeighbor = false;
     for (int k = 0; k < 8; ++k) {
-        if (isFg(objectContourMask, start.x + dx8[k], start.y + dy8[k])) {
+        if (isFg(start.x + dx8[k], start.y + dy8[k])) {
             hasNeighbor = true;
             break;
         }
     }
     if (!hasNeighbor) return {start};
 
-    // Moore neighbor tracing (8-connected), using clockwise neighbor order.
     // backtrack starts at west of start (can be out-of-bounds; still treated as direction W).
     point2i p0 = start;
     point2i b = {p0.x - 1, p0.y}; // west
@@ -142,7 +91,7 @@ std::vector<point2i> extractContour(const image8u &objectContourMask) {
             const int d = (startDir + t) & 7;
             const int nx = p.x + dx8[d];
             const int ny = p.y + dy8[d];
-            if (isFg(objectContourMask, nx, ny)) {
+            if (isFg(nx, ny)) {
                 // new backtrack is neighbor preceding d in clockwise order
                 const int prevd = (d + 7) & 7;
                 point2i newBack{p.x + dx8[prevd], p.y + dy8[prevd]};
@@ -154,7 +103,7 @@ std::vector<point2i> extractContour(const image8u &objectContourMask) {
     };
 
     std::vector<point2i> contour;
-    contour.reserve(static_cast<std::size_t>(w) * static_cast<std::size_t>(h) / 4);
+    contour.reserve(static_cast<std::size_t>(2 * (w + h)));
 
     contour.push_back(p0);
 
@@ -188,8 +137,114 @@ std::vector<point2i> extractContour(const image8u &objectContourMask) {
     rotateToMinYX(contour);
 
     for (point2i p: contour) {
-        rassert(p.x >= 0 && p.x < w && p.y >= 0 && p.y < h, 2347823412);
+        rassert_hot(p.x >= 0 && p.x < w && p.y >= 0 && p.y < h, 2347823412);
+    }
+
+    return contour;
+}
+
+// Contour pixel: object pixel with at least one 8-neighbour outside of the object (or of the image),
+// the same as buildContourMask but evaluated only for pixels visited by the walk
+template <typename IsObject>
+auto contourPredicate(IsObject isObject) {
+    return [isObject](int x, int y) {
+        if (!isObject(x, y)) return false;
+        for (int k = 0; k < 8; ++k) {
+            if (!isObject(x + dx8[k], y + dy8[k])) return true;
+        }
+        return false;
+    };
+}
+
+// Top-most, then left-most foreground pixel, or {-1, -1}
+point2i findStart(const image8u& m) {
+    for (int y = 0; y < m.height(); ++y) {
+        const unsigned char* row = m.ptr(y);
+        for (int x = 0; x < m.width(); ++x) {
+            if (row[x] == kFg) return {x, y};
+        }
     }
+    return {-1, -1};
+}
+
+} // namespace
+
+image8u buildContourMask(const image8u &objectMask) {
+    rassert(objectMask.channels() == 1, 918273645);
 
+    const int w = objectMask.width();
+    const int h = objectMask.height();
+
+    // это новая маска которую мы хотим построить, изначально она заполнена нулями (черная)
+    image8u contour(w, h, 1);
+
+    // DONE для каждого пикселя вам надо сделать следующее
+    // посмотреть на 8 соседей - по стороне и диагонали (будьте аккуратны - не выйдите за пределы картинки)
+    // если среди них только 255 - то наш пиксель внутри объекта, то есть наш пиксель - не граница
+    // если среди них только 0 - то наш пиксель снаружи объекта (фон), то есть наш пиксель - не граница
+    // а вот если среди соседей есть и те и те - то мы на границе!
+    // и в таком случае надо сохранить в нашем пикселе в contour(j, i) число 255
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            if (objectMask(y, x) != kFg) continue;
+
+            bool isBoundary = false;
+            for (int k = 0; k < 8; ++k) {
+                const int nx = x + dx8[k];
+                const int ny = y + dy8[k];
+                if (!inBounds(nx, ny, w, h) || objectMask(ny, nx) != kFg) {
+                    isBoundary = true;
+                    break;
+                }
+            }
+            if (isBoundary) contour(y, x) = kFg;
+        }
+    }
+
+    return contour;
+}
+
+BitMask buildContourMask(const BitMask &objectMask) {
+    // Pixel is inner iff its whole 3x3 neighbourhood is inside the object and the image - that is erosion with radius 1
+    BitMask contour = morphology::erode(objectMask, 1, false);
+    for (int y = 0; y < contour.height(); ++y) {
+        const BitMask::word_type* src = objectMask.row(y);
+        BitMask::word_type* dst = contour.row(y);
+        for (int k = 0; k < contour.words_per_row(); ++k) {
+            dst[k] = src[k] & ~dst[k];
+        }
+    }
     return contour;
 }
+
+std::vector<point2i> extractContour(const image8u &objectContourMask) {
+    rassert(objectContourMask.channels() == 1, 918273646);
+
+    const point2i start = findStart(objectContourMask);
+    if (start.x < 0) return {};
+
+    return traceMoore(objectContourMask.width(), objectContourMask.height(), start,
+                      [&](int x, int y) { return isFg(objectContourMask, x, y); });
+}
+
+std::vector<point2i> traceContour(const image8u &objectMask) {
+    rassert(objectMask.channels() == 1, 918273647);
+
+    // Top-most object pixel always has background above it, so it is a contour pixel too
+    const point2i start = findStart(objectMask);
+    if (start.x < 0) return {};
+
+    return traceMoore(objectMask.width(), objectMask.height(), start,
+                      contourPredicate([&](int x, int y) { return isFg(objectMask, x, y); }));
+}
+
+std::vector<point2i> traceContour(const RunLengthMask &objectMask) {
+    if (objectMask.runs().empty()) return {};
+    const RunLengthMask::Run &first = objectMask.runs().front();
+
+    const int w = objectMask.width();
+    const int h = objectMask.height();
+    return traceMoore(w, h, point2i{first.x0, first.y}, contourPredicate([&](int x, int y) {
+        return inBounds(x, y, w, h) && objectMask.get(y, x);
+    }));
+}
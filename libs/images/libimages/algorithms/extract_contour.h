@@ -1,6 +1,8 @@
 #pragma once
 
+#include <libimages/bit_mask.h>
 #include <libimages/image.h>
+#include <libimages/run_length_mask.h>
 #include <libbase/point2.h>
 
 #include <vector>
@@ -8,7 +10,15 @@
 // Input: object mask (0 = background, 255 = object).
 // Output: contour mask (0 = not contour, 255 = contour pixel).
 image8u buildContourMask(const image8u &objectMask);
+// Same for bit-packed masks: object pixels with at least one 8-neighbour outside of the object (or of the image)
+BitMask buildContourMask(const BitMask &objectMask);
 
 // Input: contour mask (0 = background, 255 = contour pixel).
 // Output: single closed loop of contour pixels in clockwise order (image coords: x right, y down).
 std::vector<point2i> extractContour(const image8u &objectContourMask);
+
+// Input: object mask (0 = background, 255 = object).
+// Output: same as extractContour(buildContourMask(objectMask)), but the walk goes along the object mask directly,
+// without building the contour mask (and scanning it).
+std::vector<point2i> traceContour(const image8u &objectMask);
+std::vector<point2i> traceContour(const RunLengthMask &objectMask);
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
 #include <libimages/debug_io.h>
 #include <libimages/tests_utils.h>
 
@@ -163,3 +164,68 @@ TEST(extract_contour, singlePixel) {
     ASSERT_EQ(contour.size(), 1u);
     EXPECT_EQ(contour[0], (point2i{4, 3}));
 }
+
+TEST(extract_contour, buildContourMask_bitMaskMatchesImage8u) {
+    configureWorkingDirectory();
+
+    image8u obj(70, 20, 1);
+    obj.fill(0);
+    fillRect(obj, point2i{0, 0}, point2i{66, 12}, static_cast<unsigned char>(255)); // touches image border
+    fillRect(obj, point2i{30, 12}, point2i{40, 20}, static_cast<unsigned char>(255));
+    obj(5, 10) = 0; // hole
+
+    const image8u contour = buildContourMask(obj);
+    const BitMask contourBits = buildContourMask(BitMask::fromImage(obj));
+    debug_io::dump_image(getUnitCaseDebugDir() + "01_contour_mask.png", contourBits);
+
+    EXPECT_EQ(contourBits.toImage().toVector(), contour.toVector());
+}
+
+TEST(extract_contour, traceContourMatchesContourMaskWalk) {
+    configureWorkingDirectory();
+
+    // shapes with concave corners, a hole, image border contact and a one-pixel-wide tail
+    image8u obj(40, 30, 1);
+    obj.fill(0);
+    fillRect(obj, point2i{0, 4}, point2i{25, 20}, kFg);
+    fillRect(obj, point2i{10, 20}, point2i{18, 30}, kFg);
+    fillRect(obj, point2i{25, 10}, point2i{38, 11}, kFg);
+    obj(8, 8) = 0;
+    obj(4, 24) = 0;
+
+    const auto contour = traceContour(obj);
+    debug_io::dump_image(getUnitCaseDebugDir() + "01_contour_trace.jpg", visualizeContourTrace(obj.width(), obj.height(), contour));
+    EXPECT_EQ(contour, extractContour(buildContourMask(obj)));
+    EXPECT_GT(signedArea2_imageCoords(contour), 0);
+
+    // single pixel and empty mask
+    image8u dot(5, 5, 1);
+    dot(2, 3) = kFg;
+    EXPECT_EQ(traceContour(dot), (std::vector<point2i>{{3, 2}}));
+    EXPECT_TRUE(traceContour(image8u(5, 5, 1)).empty());
+
+    // random blobs: any mask gives the same walk
+    FastRandom r(7);
+    for (int iter = 0; iter < 20; ++iter) {
+        image8u blob(31, 23, 1);
+        blob.fill(0);
+        for (int k = 0; k < 6; ++k) {
+            const int x0 = r.nextInt(0, 25);
+            const int y0 = r.nextInt(0, 17);
+            fillRect(blob, point2i{x0, y0}, point2i{x0 + r.nextInt(1, 6), y0 + r.nextInt(1, 6)}, kFg);
+        }
+        EXPECT_EQ(traceContour(blob), extractContour(buildContourMask(blob))) << iter;
+    }
+}
+
+TEST(extract_contour, traceContourOnRunLengthMask) {
+    image8u obj(40, 30, 1);
+    obj.fill(0);
+    fillRect(obj, point2i{0, 4}, point2i{25, 20}, kFg);
+    fillRect(obj, point2i{10, 20}, point2i{18, 30}, kFg);
+    fillRect(obj, point2i{25, 10}, point2i{38, 11}, kFg);
+    obj(8, 8) = 0;
+
+    EXPECT_EQ(traceContour(RunLengthMask::fromImage(obj)), traceContour(obj));
+    EXPECT_TRUE(traceContour(RunLengthMask(5, 5)).empty());
+}
@@ -0,0 +1,67 @@
+#include "filter_utils.h"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace filter_utils {
+
+namespace {
+
+constexpr std::size_t cache_capacity = 32;
+
+// Most recently used first, a linear search over a few entries is faster than any map
+struct KernelCache {
+    std::mutex mutex;
+    std::vector<std::pair<std::uint32_t, std::shared_ptr<const Kernel1D>>> entries;
+};
+
+KernelCache &kernelCache() {
+    static KernelCache cache;
+    return cache;
+}
+
+} // namespace
+
+std::shared_ptr<const Kernel1D> cachedGaussianKernel(float sigma) {
+    const std::uint32_t key = std::bit_cast<std::uint32_t>(sigma);
+
+    // repeated calls with the same sigma from one thread skip the lock
+    thread_local std::uint32_t lastKey = 0;
+    thread_local std::shared_ptr<const Kernel1D> last;
+    if (last && lastKey == key) return last;
+
+    KernelCache &cache = kernelCache();
+    // moves the entry of key to the front, nullptr if there is none
+    auto find = [&]() -> std::shared_ptr<const Kernel1D> {
+        auto it = cache.entries.begin();
+        while (it != cache.entries.end() && it->first != key) ++it;
+        if (it == cache.entries.end()) return nullptr;
+        std::rotate(cache.entries.begin(), it, it + 1);
+        return cache.entries.front().second;
+    };
+
+    std::shared_ptr<const Kernel1D> kernel;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        kernel = find();
+    }
+    if (!kernel) {
+        // computed outside of the lock, if another thread inserted it meanwhile its copy wins
+        std::shared_ptr<const Kernel1D> computed = std::make_shared<const Kernel1D>(makeGaussianKernel(sigma));
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        kernel = find();
+        if (!kernel) {
+            kernel = std::move(computed);
+            cache.entries.insert(cache.entries.begin(), {key, kernel});
+            if (cache.entries.size() > cache_capacity) cache.entries.pop_back();
+        }
+    }
+    lastKey = key;
+    last = kernel;
+    return kernel;
+}
+
+} // namespace filter_utils
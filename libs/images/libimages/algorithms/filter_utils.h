@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Helpers shared by blur, resample and downsample (not a public API)
+namespace filter_utils {
+
+inline int clampi(int v, int lo, int hi) noexcept {
+    return std::max(lo, std::min(hi, v));
+}
+
+struct Kernel1D {
+    std::vector<float> w;
+    int r = 0;
+};
+
+inline Kernel1D makeGaussianKernel(float sigma) {
+    Kernel1D k;
+    if (!(sigma > 0.0f)) return k;
+
+    const float s = std::max(0.001f, sigma);
+    k.r = std::max(0, static_cast<int>(std::ceil(3.0f * s)));
+    const int R = k.r;
+    if (R == 0) return k;
+
+    k.w.assign(static_cast<size_t>(2 * R + 1), 0.0f);
+
+    const float inv2s2 = 1.0f / (2.0f * s * s);
+
+    float sum = 0.0f;
+    for (int i = 0; i <= R; ++i) {
+        const float v = std::exp(-(float)(i * i) * inv2s2);
+        k.w[static_cast<size_t>(R + i)] = v;
+        k.w[static_cast<size_t>(R - i)] = v;
+        sum += (i == 0) ? v : (2.0f * v);
+    }
+
+    const float invSum = (sum > 0.0f) ? (1.0f / sum) : 1.0f;
+    for (float& v : k.w) v *= invSum;
+
+    return k;
+}
+
+// makeGaussianKernel through a process-wide LRU cache keyed by sigma, thread-safe: blur and resample are called with
+// the same few sigmas over and over (f.e. every side profile), so the exp weights are computed once per sigma.
+// A kernel stays alive while it is held, even if it was evicted meanwhile.
+std::shared_ptr<const Kernel1D> cachedGaussianKernel(float sigma);
+
+// Tap counts that kernels are specialized for at compile time (so that their loops unroll):
+// 2 * ceil(3 * sigma) + 1 for sigma = 1, 2, 3, 4 (4 - the side profile blur, see PuzzleSolverOptions::sideBlurStrength)
+inline constexpr int fixed_gaussian_taps[] = {7, 13, 19, 25};
+
+template <typename T>
+inline float to_f(T v) noexcept {
+    if constexpr (std::is_same_v<T, float>) return v;
+    return static_cast<float>(v);
+}
+
+template <typename T>
+inline T from_f(float v) noexcept {
+    if constexpr (std::is_same_v<T, float>) {
+        return v;
+    } else if constexpr (std::is_same_v<T, std::uint8_t>) {
+        v = std::clamp(v, 0.0f, 255.0f);
+        return static_cast<std::uint8_t>(std::lround(v));
+    } else if constexpr (std::is_same_v<T, std::uint16_t>) {
+        v = std::clamp(v, 0.0f, 65535.0f);
+        return static_cast<std::uint16_t>(std::lround(v));
+    } else if constexpr (std::is_integral_v<T>) {
+        return static_cast<T>(std::lround(v));
+    } else {
+        return static_cast<T>(v);
+    }
+}
+
+} // namespace filter_utils
@@ -0,0 +1,51 @@
+#include "filter_utils.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using filter_utils::cachedGaussianKernel;
+using filter_utils::Kernel1D;
+using filter_utils::makeGaussianKernel;
+
+TEST(filter_utils, cachedGaussianKernelMatchesFreshOne) {
+    for (float sigma : {0.0f, 0.5f, 1.0f, 4.0f, 13.7f}) {
+        const std::shared_ptr<const Kernel1D> cached = cachedGaussianKernel(sigma);
+        const Kernel1D fresh = makeGaussianKernel(sigma);
+        EXPECT_EQ(cached->r, fresh.r) << sigma;
+        EXPECT_EQ(cached->w, fresh.w) << sigma;
+        EXPECT_EQ(cachedGaussianKernel(sigma).get(), cached.get()) << sigma; // no recomputation
+    }
+}
+
+TEST(filter_utils, evictedKernelsStayValidWhileHeld) {
+    const std::shared_ptr<const Kernel1D> held = cachedGaussianKernel(2.5f);
+    const std::vector<float> weights = held->w;
+    for (int i = 1; i <= 100; ++i) cachedGaussianKernel(0.1f * float(i));
+    EXPECT_EQ(held->w, weights);
+    EXPECT_EQ(cachedGaussianKernel(2.5f)->w, weights);
+}
+
+TEST(filter_utils, fixedTapsAreTheCommonSigmas) {
+    for (int s = 1; s <= 4; ++s) {
+        EXPECT_EQ(2 * makeGaussianKernel(float(s)).r + 1, filter_utils::fixed_gaussian_taps[s - 1]) << s;
+    }
+}
+
+TEST(filter_utils, cachedGaussianKernelIsThreadSafe) {
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 2000; ++i) {
+                const float sigma = 0.25f * float((i * 7 + t) % 60 + 1);
+                if (cachedGaussianKernel(sigma)->w != makeGaussianKernel(sigma).w) ++mismatches;
+            }
+        });
+    }
+    for (std::thread &thread : threads) thread.join();
+    EXPECT_EQ(mismatches.load(), 0);
+}
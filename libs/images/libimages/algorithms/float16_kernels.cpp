@@ -0,0 +1,41 @@
+#include "float16_kernels.h"
+
+#include <libbase/cpu_features.h>
+
+namespace float16_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// float16_kernels_f16c.cpp (compiled with AVX2 and F16C enabled)
+const Kernels &f16cKernels();
+#endif
+
+namespace {
+
+void fromFloatRowScalar(const float *src, int n, float16 *dst) {
+    for (int i = 0; i < n; ++i) dst[i] = float16(src[i]);
+}
+
+void toFloatRowScalar(const float16 *src, int n, float *dst) {
+    for (int i = 0; i < n; ++i) dst[i] = static_cast<float>(src[i]);
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", fromFloatRowScalar, toFloatRowScalar};
+    return kernels;
+}
+
+const Kernels *f16c() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2 && cpuFeatures().f16c) return &f16cKernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = f16c() ? *f16c() : scalar();
+    return kernels;
+}
+
+} // namespace float16_kernels
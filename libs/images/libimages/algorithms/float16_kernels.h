@@ -0,0 +1,25 @@
+#pragma once
+
+#include <libimages/float16.h>
+
+// Row conversions between float and float16, one implementation per instruction set (picked at runtime by CPU features).
+// Both round to nearest even (as float16::fromFloat), so results of all implementations are identical.
+namespace float16_kernels {
+
+using FromFloatRowFn = void (*)(const float *src, int n, float16 *dst);
+using ToFloatRowFn = void (*)(const float16 *src, int n, float *dst);
+
+struct Kernels {
+    const char *name;
+    FromFloatRowFn fromFloatRow;
+    ToFloatRowFn toFloatRow;
+};
+
+// Portable loops (float16::fromFloat/toFloat)
+const Kernels &scalar();
+// F16C conversions, nullptr if not compiled in or not supported by current CPU
+const Kernels *f16c();
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace float16_kernels
@@ -0,0 +1,34 @@
+#include "float16_kernels.h"
+
+#include <immintrin.h>
+
+namespace float16_kernels {
+
+namespace {
+
+// 8 values per step, float16 is a plain 16-bit word
+void fromFloatRowF16c(const float *src, int n, float16 *dst) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+    }
+    if (i < n) scalar().fromFloatRow(src + i, n - i, dst + i);
+}
+
+void toFloatRowF16c(const float16 *src, int n, float *dst) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+    }
+    if (i < n) scalar().toFloatRow(src + i, n - i, dst + i);
+}
+
+} // namespace
+
+const Kernels &f16cKernels() {
+    static const Kernels kernels{"f16c", fromFloatRowF16c, toFloatRowF16c};
+    return kernels;
+}
+
+} // namespace float16_kernels
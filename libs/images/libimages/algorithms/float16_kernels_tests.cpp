@@ -0,0 +1,42 @@
+#include "float16_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+TEST(float16_kernels, bestIsAvailable) {
+    const float16_kernels::Kernels &best = float16_kernels::best();
+    EXPECT_NE(best.fromFloatRow, nullptr);
+    EXPECT_NE(best.toFloatRow, nullptr);
+    std::cout << "float16 kernels: " << best.name << std::endl;
+}
+
+TEST(float16_kernels, f16cMatchesScalar) {
+    const float16_kernels::Kernels *f16c = float16_kernels::f16c();
+    if (!f16c) GTEST_SKIP() << "F16C kernels are not available";
+
+    FastRandom r(239);
+    for (int iter = 0; iter < 100; ++iter) {
+        const int n = r.nextInt(1, 100);
+        std::vector<float> src(static_cast<size_t>(n));
+        for (float &v : src) {
+            const int kind = r.nextInt(0, 3);
+            v = kind == 0 ? r.nextFloat(-70000.0f, 70000.0f) : kind == 1 ? r.nextFloat(-1e-5f, 1e-5f)
+                                                                         : float(r.nextInt(0, 4096)) + 0.5f;
+        }
+        std::vector<float16> expected(static_cast<size_t>(n)), actual(static_cast<size_t>(n));
+        float16_kernels::scalar().fromFloatRow(src.data(), n, expected.data());
+        f16c->fromFloatRow(src.data(), n, actual.data());
+        ASSERT_EQ(actual, expected);
+
+        std::vector<float> back(static_cast<size_t>(n)), backF16c(static_cast<size_t>(n));
+        float16_kernels::scalar().toFloatRow(expected.data(), n, back.data());
+        f16c->toFloatRow(expected.data(), n, backF16c.data());
+        ASSERT_EQ(backF16c, back);
+    }
+}
@@ -1,26 +1,82 @@
 #include "grayscale.h"
 
+#include "grayscale_kernels.h"
+
 #include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
 
-image32f to_grayscale_float(const image8u& img) {
-    rassert(img.channels() == 1 || img.channels() == 3 || img.channels() == 4, "Unsupported channel count", img.channels());
+#include <algorithm>
 
-    image32f gray(img.width(), img.height(), 1);
+namespace {
 
-    if (img.channels() == 1) {
-        for (int j = 0; j < img.height(); ++j)
-            for (int i = 0; i < img.width(); ++i)
-                gray(j, i) = (float) img(j, i);
-        return gray;
-    }
+template <typename T, typename Intensity>
+std::vector<T> border(const image8u& img, Intensity intensity_of) {
+    const int c = img.channels();
+    rassert(c == 1 || c == 3 || c == 4, "Unsupported channel count", c);
 
-    for (int j = 0; j < img.height(); ++j) {
-        for (int i = 0; i < img.width(); ++i) {
-            const float r = (float) img(j, i, 0);
-            const float g = (float) img(j, i, 1);
-            const float b = (float) img(j, i, 2);
-            gray(j, i) = 0.299f * r + 0.587f * g + 0.114f * b;
+    const int w = img.width();
+    const int h = img.height();
+    auto intensity = [&](int j, int i) {
+        const std::uint8_t* px = img.ptr(j, i);
+        return (c == 1) ? static_cast<T>(px[0]) : intensity_of(px[0], px[1], px[2]);
+    };
+
+    std::vector<T> border;
+    border.reserve(static_cast<std::size_t>(2 * w + 2 * std::max(0, h - 2)));
+    for (int j = 0; j < h; ++j) {
+        if (j == 0 || j == h - 1) {
+            for (int i = 0; i < w; ++i) border.push_back(intensity(j, i));
+        } else {
+            border.push_back(intensity(j, 0));
+            if (w > 1) border.push_back(intensity(j, w - 1));
         }
     }
+    return border;
+}
+
+} // namespace
+
+image32f to_grayscale_float(const image8u& img, bool with_openmp) {
+    image32f gray;
+    to_grayscale_float(img, gray, with_openmp);
+    return gray;
+}
+
+image8u to_grayscale_u8(const image8u& img, bool with_openmp) {
+    image8u gray;
+    to_grayscale_u8(img, gray, with_openmp);
     return gray;
 }
+
+void to_grayscale_float(const image8u& img, image32f& gray, bool with_openmp) {
+    rassert(img.channels() == 1 || img.channels() == 3 || img.channels() == 4, "Unsupported channel count", img.channels());
+
+    gray.ensureSize(img.width(), img.height(), 1);
+    const grayscale_kernels::Kernels& kernels = grayscale_kernels::best();
+    parallelForEach(0, img.height(), [&](int j) {
+        kernels.toFloatRow(img.ptr(j), img.channels(), img.width(), gray.ptr(j));
+    }, with_openmp);
+}
+
+void to_grayscale_u8(const image8u& img, image8u& gray, bool with_openmp) {
+    rassert(img.channels() == 1 || img.channels() == 3 || img.channels() == 4, "Unsupported channel count", img.channels());
+    if (&gray == &img) {
+        // resizing gray would free img
+        gray = to_grayscale_u8(img, with_openmp);
+        return;
+    }
+
+    gray.ensureSize(img.width(), img.height(), 1);
+    const grayscale_kernels::Kernels& kernels = grayscale_kernels::best();
+    parallelForEach(0, img.height(), [&](int j) {
+        kernels.toU8Row(img.ptr(j), img.channels(), img.width(), gray.ptr(j));
+    }, with_openmp);
+}
+
+std::vector<float> grayscale_border(const image8u& img) {
+    return border<float>(img, grayscale_intensity);
+}
+
+std::vector<std::uint8_t> grayscale_border_u8(const image8u& img) {
+    return border<std::uint8_t>(img, grayscale_intensity_u8);
+}
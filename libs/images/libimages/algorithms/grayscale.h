@@ -2,4 +2,33 @@
 
 #include <libimages/image.h>
 
-image32f to_grayscale_float(const image8u& img);
+#include <cstdint>
+#include <vector>
+
+// Luma (BT.601 weights), same float expression everywhere so that fused kernels match to_grayscale_float exactly
+inline float grayscale_intensity(std::uint8_t r, std::uint8_t g, std::uint8_t b) noexcept {
+    return 0.299f * (float) r + 0.587f * (float) g + 0.114f * (float) b;
+}
+
+// Fixed-point luma with the same weights ((77, 150, 29) / 256 with rounding), within 1 of std::lround(grayscale_intensity)
+inline std::uint8_t grayscale_intensity_u8(std::uint8_t r, std::uint8_t g, std::uint8_t b) noexcept {
+    return static_cast<std::uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+// Supports 1, 3 (RGB) and 4 (RGBA, alpha ignored) channels, rows are converted in parallel by SIMD kernels
+// (see grayscale_kernels.h), the result does not depend on with_openmp
+image32f to_grayscale_float(const image8u& img, bool with_openmp = true);
+
+// Same with grayscale_intensity_u8: a quarter of the memory of the float image, for thresholds that are whole numbers anyway
+image8u to_grayscale_u8(const image8u& img, bool with_openmp = true);
+
+// Same into a caller-owned gray: its buffer is reused if the size matches (reallocated otherwise), gray may be img
+void to_grayscale_float(const image8u& img, image32f& gray, bool with_openmp = true);
+void to_grayscale_u8(const image8u& img, image8u& gray, bool with_openmp = true);
+
+// Grayscale intensities of the image perimeter only (2 * w + 2 * h - 4 values for w, h >= 2) in row-major order,
+// same values as to_grayscale_float would give there, without converting the whole image
+std::vector<float> grayscale_border(const image8u& img);
+
+// Same as grayscale_border with grayscale_intensity_u8 values
+std::vector<std::uint8_t> grayscale_border_u8(const image8u& img);
@@ -0,0 +1,53 @@
+#include "grayscale_kernels.h"
+
+#include "grayscale.h"
+
+#include <libbase/cpu_features.h>
+
+#include <cstring>
+
+namespace grayscale_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// grayscale_kernels_avx2.cpp (compiled with AVX2 enabled)
+const Kernels &avx2Kernels();
+#endif
+
+namespace {
+
+void toFloatRowScalar(const std::uint8_t *src, int channels, int n, float *dst) {
+    if (channels == 1) {
+        for (int i = 0; i < n; ++i) dst[i] = (float) src[i];
+        return;
+    }
+    for (int i = 0; i < n; ++i, src += channels) dst[i] = grayscale_intensity(src[0], src[1], src[2]);
+}
+
+void toU8RowScalar(const std::uint8_t *src, int channels, int n, std::uint8_t *dst) {
+    if (channels == 1) {
+        std::memcpy(dst, src, static_cast<std::size_t>(n));
+        return;
+    }
+    for (int i = 0; i < n; ++i, src += channels) dst[i] = grayscale_intensity_u8(src[0], src[1], src[2]);
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", toFloatRowScalar, toU8RowScalar};
+    return kernels;
+}
+
+const Kernels *avx2() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2) return &avx2Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = avx2() ? *avx2() : scalar();
+    return kernels;
+}
+
+} // namespace grayscale_kernels
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Kernels behind to_grayscale_float/to_grayscale_u8, one implementation per instruction set (picked at runtime by CPU features).
+// Float kernels do the operations of grayscale_intensity in the same order (no fused multiply-add),
+// integer kernels - the ones of grayscale_intensity_u8, so results of all implementations are identical.
+namespace grayscale_kernels {
+
+// n pixels of interleaved 1, 3 (RGB) or 4 (RGBA, alpha ignored) channels to n intensities
+using ToFloatRowFn = void (*)(const std::uint8_t *src, int channels, int n, float *dst);
+using ToU8RowFn = void (*)(const std::uint8_t *src, int channels, int n, std::uint8_t *dst);
+
+struct Kernels {
+    const char *name;
+    ToFloatRowFn toFloatRow;
+    ToU8RowFn toU8Row;
+};
+
+// Portable loops
+const Kernels &scalar();
+// nullptr if not compiled in or not supported by current CPU
+const Kernels *avx2();
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace grayscale_kernels
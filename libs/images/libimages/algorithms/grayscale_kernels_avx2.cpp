@@ -0,0 +1,94 @@
+#include "grayscale_kernels.h"
+
+#include <immintrin.h>
+
+namespace grayscale_kernels {
+
+namespace {
+
+// pshufb control gathering channel ch of 4 pixels that start at byte first of a 16-byte register into its low 4 bytes
+__m128i channelShuffle(int channels, int first, int ch) {
+    alignas(16) std::uint8_t control[16];
+    for (int k = 0; k < 16; ++k) control[k] = 0x80;
+    for (int k = 0; k < 4; ++k) control[k] = static_cast<std::uint8_t>(first + k * channels + ch);
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(control));
+}
+
+// Deinterleaves 8 pixels of 3 or 4 channels into r, g, b of 8 bytes each (in the low halves),
+// loads stay within the 8 * channels bytes of these pixels
+struct Deinterleave8 {
+    __m128i lo[3], hi[3];
+    int hiOffset;
+
+    explicit Deinterleave8(int channels) {
+        // pixels 0..3 are at the start of the first load, pixels 4..7 end with the second one
+        hiOffset = 8 * channels - 16;
+        const int hiFirst = 4 * channels - hiOffset;
+        for (int ch = 0; ch < 3; ++ch) {
+            lo[ch] = channelShuffle(channels, 0, ch);
+            hi[ch] = channelShuffle(channels, hiFirst, ch);
+        }
+    }
+
+    void operator()(const std::uint8_t *px, __m128i rgb[3]) const {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(px));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(px + hiOffset));
+        for (int ch = 0; ch < 3; ++ch) rgb[ch] = _mm_unpacklo_epi32(_mm_shuffle_epi8(a, lo[ch]), _mm_shuffle_epi8(b, hi[ch]));
+    }
+};
+
+__m256 toFloat8(__m128i bytes) { return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)); }
+
+// 8 pixels per step, (0.299 r + 0.587 g) + 0.114 b as grayscale_intensity evaluates it
+void toFloatRowAvx2(const std::uint8_t *src, int channels, int n, float *dst) {
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, toFloat8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i))));
+    } else {
+        const Deinterleave8 deinterleave(channels);
+        const __m256 wr = _mm256_set1_ps(0.299f), wg = _mm256_set1_ps(0.587f), wb = _mm256_set1_ps(0.114f);
+        __m128i rgb[3];
+        for (; i + 8 <= n; i += 8) {
+            deinterleave(src + static_cast<std::size_t>(i) * channels, rgb);
+            const __m256 rg = _mm256_add_ps(_mm256_mul_ps(wr, toFloat8(rgb[0])), _mm256_mul_ps(wg, toFloat8(rgb[1])));
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(rg, _mm256_mul_ps(wb, toFloat8(rgb[2]))));
+        }
+    }
+    if (i < n) scalar().toFloatRow(src + static_cast<std::size_t>(i) * channels, channels, n - i, dst + i);
+}
+
+// 16 pixels per step in 16-bit lanes: (77 r + 150 g + 29 b + 128) >> 8 never exceeds 65535
+void toU8RowAvx2(const std::uint8_t *src, int channels, int n, std::uint8_t *dst) {
+    if (channels == 1) {
+        scalar().toU8Row(src, channels, n, dst); // a copy
+        return;
+    }
+    const Deinterleave8 deinterleave(channels);
+    const __m256i wr = _mm256_set1_epi16(77), wg = _mm256_set1_epi16(150), wb = _mm256_set1_epi16(29);
+    const __m256i half = _mm256_set1_epi16(128);
+    int i = 0;
+    __m128i a[3], b[3];
+    for (; i + 16 <= n; i += 16) {
+        deinterleave(src + static_cast<std::size_t>(i) * channels, a);
+        deinterleave(src + static_cast<std::size_t>(i + 8) * channels, b);
+        __m256i sum = half;
+        const __m256i w[3] = {wr, wg, wb};
+        for (int ch = 0; ch < 3; ++ch) {
+            const __m256i v = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(a[ch], b[ch]));
+            sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(v, w[ch]));
+        }
+        const __m256i y = _mm256_srli_epi16(sum, 8);
+        const __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+    }
+    if (i < n) scalar().toU8Row(src + static_cast<std::size_t>(i) * channels, channels, n - i, dst + i);
+}
+
+} // namespace
+
+const Kernels &avx2Kernels() {
+    static const Kernels kernels{"avx2", toFloatRowAvx2, toU8RowAvx2};
+    return kernels;
+}
+
+} // namespace grayscale_kernels
@@ -0,0 +1,71 @@
+#include "grayscale_kernels.h"
+
+#include "grayscale.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+TEST(grayscale_kernels, bestIsAvailable) {
+    const grayscale_kernels::Kernels &best = grayscale_kernels::best();
+    EXPECT_NE(best.toFloatRow, nullptr);
+    EXPECT_NE(best.toU8Row, nullptr);
+    std::cout << "grayscale kernels: " << best.name << std::endl;
+}
+
+TEST(grayscale_kernels, scalarMatchesIntensities) {
+    const std::uint8_t px[] = {255, 255, 255, 7, 0, 0, 0, 0, 255, 9, 10, 20, 30, 11};
+    float f[3];
+    std::uint8_t u[3];
+    grayscale_kernels::scalar().toFloatRow(px, 4, 3, f);
+    grayscale_kernels::scalar().toU8Row(px, 4, 3, u);
+    EXPECT_EQ(f[0], grayscale_intensity(255, 255, 255));
+    EXPECT_EQ(f[1], grayscale_intensity(0, 0, 0));
+    EXPECT_EQ(f[2], grayscale_intensity(255, 9, 10)); // alpha is skipped
+    EXPECT_EQ(u[0], 255);
+    EXPECT_EQ(u[1], 0);
+    EXPECT_EQ(u[2], grayscale_intensity_u8(255, 9, 10));
+
+    grayscale_kernels::scalar().toU8Row(px, 1, 3, u);
+    EXPECT_EQ(u[2], 255);
+}
+
+TEST(grayscale_kernels, u8IsWithinOneOfRoundedFloat) {
+    for (int r = 0; r < 256; r += 3)
+        for (int g = 0; g < 256; g += 5)
+            for (int b = 0; b < 256; b += 7) {
+                const long expected = std::lround(grayscale_intensity(r, g, b));
+                ASSERT_LE(std::abs(expected - long(grayscale_intensity_u8(r, g, b))), 1) << r << " " << g << " " << b;
+            }
+}
+
+TEST(grayscale_kernels, avx2MatchesScalar) {
+    const grayscale_kernels::Kernels *avx2 = grayscale_kernels::avx2();
+    if (!avx2) GTEST_SKIP() << "AVX2 kernels are not available";
+
+    FastRandom r(239);
+    for (int channels : {1, 3, 4}) {
+        for (int iter = 0; iter < 50; ++iter) {
+            const int n = r.nextInt(1, 100);
+            // exactly n pixels, so that reads past the row would be caught by sanitizers
+            std::vector<std::uint8_t> src(static_cast<size_t>(n) * channels);
+            for (std::uint8_t &v : src) v = static_cast<std::uint8_t>(r.nextInt(0, 255));
+
+            std::vector<float> expectedF(static_cast<size_t>(n)), actualF(static_cast<size_t>(n));
+            grayscale_kernels::scalar().toFloatRow(src.data(), channels, n, expectedF.data());
+            avx2->toFloatRow(src.data(), channels, n, actualF.data());
+            ASSERT_EQ(actualF, expectedF);
+
+            std::vector<std::uint8_t> expectedU(static_cast<size_t>(n)), actualU(static_cast<size_t>(n));
+            grayscale_kernels::scalar().toU8Row(src.data(), channels, n, expectedU.data());
+            avx2->toU8Row(src.data(), channels, n, actualU.data());
+            ASSERT_EQ(actualU, expectedU);
+        }
+    }
+}
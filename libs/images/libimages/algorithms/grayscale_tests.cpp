@@ -8,6 +8,8 @@
 #include <libimages/image_io.h>
 #include <libimages/tests_utils.h>
 
+#include <vector>
+
 TEST(grayscale, loadImageAndThresholdByConstant) {
     configureWorkingDirectory();
 
@@ -15,3 +17,80 @@ TEST(grayscale, loadImageAndThresholdByConstant) {
     image32f grayscale = to_grayscale_float(img);
     debug_io::dump_image(getUnitCaseDebugDir() + "grayscale.jpg", grayscale);
 }
+
+TEST(grayscale, borderMatchesFullConversion) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const image32f grayscale = to_grayscale_float(img);
+    const int w = img.width();
+    const int h = img.height();
+
+    std::vector<float> expected;
+    for (int j = 0; j < h; ++j)
+        for (int i = 0; i < w; ++i)
+            if (i == 0 || i == w - 1 || j == 0 || j == h - 1)
+                expected.push_back(grayscale(j, i));
+
+    const std::vector<float> border = grayscale_border(img);
+    EXPECT_EQ(border.size(), static_cast<size_t>(2 * w + 2 * h - 4));
+    EXPECT_EQ(border, expected);
+
+    EXPECT_EQ(grayscale_border(image8u(1, 1, 3)).size(), 1u);
+    EXPECT_EQ(grayscale_border(image8u(1, 5, 1)).size(), 5u);
+    EXPECT_EQ(grayscale_border(image8u(4, 1, 1)).size(), 4u);
+}
+
+TEST(grayscale, u8MatchesPerPixelIntensity) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const image8u gray = to_grayscale_u8(img);
+    const image8u serial = to_grayscale_u8(img, false);
+    ASSERT_EQ(gray.width(), img.width());
+    ASSERT_EQ(gray.height(), img.height());
+    ASSERT_EQ(gray.channels(), 1);
+
+    const image32f grayFloat = to_grayscale_float(img);
+    const image32f grayFloatSerial = to_grayscale_float(img, false);
+    for (int j = 0; j < img.height(); ++j) {
+        for (int i = 0; i < img.width(); ++i) {
+            ASSERT_EQ(gray(j, i), grayscale_intensity_u8(img(j, i, 0), img(j, i, 1), img(j, i, 2)));
+            ASSERT_EQ(serial(j, i), gray(j, i));
+            ASSERT_EQ(grayFloat(j, i), grayscale_intensity(img(j, i, 0), img(j, i, 1), img(j, i, 2)));
+            ASSERT_EQ(grayFloatSerial(j, i), grayFloat(j, i));
+        }
+    }
+
+    const std::vector<std::uint8_t> border = grayscale_border_u8(img);
+    ASSERT_EQ(border.size(), static_cast<size_t>(2 * img.width() + 2 * img.height() - 4));
+    EXPECT_EQ(border.front(), gray(0, 0));
+    EXPECT_EQ(border[img.width()], gray(1, 0));
+    EXPECT_EQ(border.back(), gray(img.height() - 1, img.width() - 1));
+
+    image8u single(5, 2, 1);
+    single(1, 3) = 200;
+    EXPECT_EQ(to_grayscale_u8(single)(1, 3), 200);
+}
+
+TEST(grayscale, intoDstReusesBufferAndAllowsInPlace) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    image32f grayFloat;
+    image8u gray;
+    to_grayscale_float(img, grayFloat);
+    to_grayscale_u8(img, gray);
+    const float *floatBuffer = grayFloat.ptr(0);
+    const std::uint8_t *buffer = gray.ptr(0);
+    to_grayscale_float(img, grayFloat);
+    to_grayscale_u8(img, gray);
+    EXPECT_EQ(grayFloat.ptr(0), floatBuffer);
+    EXPECT_EQ(gray.ptr(0), buffer);
+    EXPECT_EQ(grayFloat.toVector(), to_grayscale_float(img).toVector());
+    EXPECT_EQ(gray.toVector(), to_grayscale_u8(img).toVector());
+
+    to_grayscale_u8(img, img);
+    EXPECT_EQ(img.channels(), 1);
+    EXPECT_EQ(img.toVector(), gray.toVector());
+}
@@ -0,0 +1,50 @@
+#include "integral_image.h"
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+
+template <typename S>
+IntegralImage<S>::IntegralImage(int width, int height, int channels)
+    : w_(width), h_(height), c_(channels), sums_(static_cast<std::size_t>(width + 1) * (height + 1) * channels, S(0)) {
+    rassert(width >= 0 && height >= 0 && channels > 0, 771042301, width, height, channels);
+}
+
+template <typename S, typename T>
+IntegralImage<S> integral_image(const Image<T> &image, bool with_openmp) {
+    const int w = image.width();
+    const int h = image.height();
+    const int c = image.channels();
+    IntegralImage<S> sums(w, h, c);
+    const std::size_t n = static_cast<std::size_t>(w) * c;
+
+    // row j + 1 of sums gets the prefix sums of source row j (the first c entries stay zero)
+    parallelForEach(0, h, [&](int j) {
+        const T *src = image.ptr(j);
+        S *dst = sums.row(j + 1) + c;
+        for (int k = 0; k < c; ++k) dst[k] = static_cast<S>(src[k]);
+        for (std::size_t i = c; i < n; ++i) dst[i] = dst[i - c] + static_cast<S>(src[i]);
+    }, with_openmp);
+
+    // then every row adds the one above it, columns are independent so they are split in chunks
+    constexpr std::size_t chunk = 1024;
+    const int chunks = static_cast<int>((n + chunk - 1) / chunk);
+    parallelForEach(0, chunks, [&](int ci) {
+        const std::size_t i0 = c + static_cast<std::size_t>(ci) * chunk;
+        const std::size_t i1 = std::min(c + n, i0 + chunk);
+        for (int j = 2; j <= h; ++j) {
+            const S *above = sums.row(j - 1);
+            S *dst = sums.row(j);
+            for (std::size_t i = i0; i < i1; ++i) dst[i] += above[i];
+        }
+    }, with_openmp);
+    return sums;
+}
+
+template class IntegralImage<std::uint32_t>;
+template class IntegralImage<std::uint64_t>;
+template class IntegralImage<double>;
+
+template IntegralImage<std::uint32_t> integral_image(const Image<std::uint8_t> &image, bool with_openmp);
+template IntegralImage<std::uint64_t> integral_image(const Image<std::uint8_t> &image, bool with_openmp);
+template IntegralImage<double>        integral_image(const Image<std::uint8_t> &image, bool with_openmp);
+template IntegralImage<double>        integral_image(const Image<float> &image, bool with_openmp);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <libimages/image.h>
+
+// Summed-area table of an image: at(j, i, c) = sum of channel c over pixels [0, i) x [0, j), so it has
+// (width + 1) x (height + 1) entries per channel with a zero first row and column, and the sum over any box
+// is 4 lookups regardless of its size (count-based morphology, box filters, local means).
+//
+// Accumulators:
+//   uint32_t/uint64_t - integer images, arithmetic wraps modulo 2^32/2^64, so box sums are exact as long as the sum
+//                       over the queried box fits (f.e. uint32_t is enough for any 8-bit window of up to 16M pixels,
+//                       even if the sum over the whole image overflows)
+//   double            - any images, rounding errors grow with the distance from the top-left corner
+template <typename S>
+class IntegralImage final {
+  public:
+    IntegralImage() = default;
+    IntegralImage(int width, int height, int channels);
+
+    // Of the source image
+    int width() const noexcept { return w_; }
+    int height() const noexcept { return h_; }
+    int channels() const noexcept { return c_; }
+
+    // Row j of (width + 1) * channels interleaved sums, j in [0, height]
+    S *row(int j) noexcept { return sums_.data() + static_cast<std::size_t>(j) * stride(); }
+    const S *row(int j) const noexcept { return sums_.data() + static_cast<std::size_t>(j) * stride(); }
+    S at(int j, int i, int c = 0) const noexcept { return row(j)[static_cast<std::size_t>(i) * c_ + c]; }
+
+    // Sum over pixels [x0, x1) x [y0, y1), the box must be within the image
+    S sum(int x0, int y0, int x1, int y1, int c = 0) const noexcept {
+        return at(y1, x1, c) - at(y0, x1, c) - at(y1, x0, c) + at(y0, x0, c);
+    }
+
+    // Same for any box: it is clipped to the image first, area (if not nullptr) receives the number of pixels inside
+    S clippedSum(int x0, int y0, int x1, int y1, int c = 0, int *area = nullptr) const noexcept {
+        x0 = std::clamp(x0, 0, w_);
+        x1 = std::clamp(x1, x0, w_);
+        y0 = std::clamp(y0, 0, h_);
+        y1 = std::clamp(y1, y0, h_);
+        if (area) *area = (x1 - x0) * (y1 - y0);
+        return sum(x0, y0, x1, y1, c);
+    }
+
+    // Mean over the part of the (2r+1)^2 window around pixel (x, y) that is inside of the image
+    double windowMean(int x, int y, int r, int c = 0) const noexcept {
+        int area = 0;
+        const S s = clippedSum(x - r, y - r, x + r + 1, y + r + 1, c, &area);
+        return area > 0 ? static_cast<double>(s) / area : 0.0;
+    }
+
+  private:
+    std::size_t stride() const noexcept { return static_cast<std::size_t>(w_ + 1) * static_cast<std::size_t>(c_); }
+
+    int w_ = 0;
+    int h_ = 0;
+    int c_ = 0;
+    std::vector<S> sums_;
+};
+
+// Row prefix sums of every row in parallel, then column prefix sums in parallel over chunks of columns
+template <typename S, typename T>
+IntegralImage<S> integral_image(const Image<T> &image, bool with_openmp = true);
+
+using integral32u = IntegralImage<std::uint32_t>;
+using integral64u = IntegralImage<std::uint64_t>;
+using integral64f = IntegralImage<double>;
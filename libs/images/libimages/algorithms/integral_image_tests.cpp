@@ -0,0 +1,65 @@
+#include "integral_image.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cstdint>
+
+namespace {
+
+template <typename T>
+double bruteSum(const Image<T> &image, int x0, int y0, int x1, int y1, int c) {
+    double sum = 0.0;
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x) sum += image(y, x, c);
+    return sum;
+}
+
+} // namespace
+
+TEST(integral_image, sumsMatchBruteForce) {
+    FastRandom r(239);
+    for (auto [w, h, c] : {std::tuple{37, 23, 1}, std::tuple{5, 64, 3}, std::tuple{1, 1, 1}, std::tuple{1500, 3, 3}}) {
+        image8u img(w, h, c);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                for (int k = 0; k < c; ++k) img(y, x, k) = static_cast<std::uint8_t>(r.nextInt(0, 255));
+
+        const integral32u sums32 = integral_image<std::uint32_t>(img);
+        const integral64u sums64 = integral_image<std::uint64_t>(img, false);
+        const integral64f sumsF = integral_image<double>(img);
+        ASSERT_EQ(sums32.width(), w);
+        ASSERT_EQ(sums32.height(), h);
+        ASSERT_EQ(sums32.channels(), c);
+        EXPECT_EQ(sums32.at(0, w), 0u);
+        EXPECT_EQ(sums32.at(h, 0), 0u);
+
+        for (int iter = 0; iter < 100; ++iter) {
+            const int x0 = r.nextInt(0, w), x1 = r.nextInt(x0, w);
+            const int y0 = r.nextInt(0, h), y1 = r.nextInt(y0, h);
+            const int k = r.nextInt(0, c - 1);
+            const double expected = bruteSum(img, x0, y0, x1, y1, k);
+            ASSERT_EQ(double(sums32.sum(x0, y0, x1, y1, k)), expected);
+            ASSERT_EQ(double(sums64.sum(x0, y0, x1, y1, k)), expected);
+            ASSERT_EQ(sumsF.sum(x0, y0, x1, y1, k), expected);
+        }
+    }
+}
+
+TEST(integral_image, clippedWindows) {
+    image32f img(10, 6, 1);
+    for (int y = 0; y < img.height(); ++y)
+        for (int x = 0; x < img.width(); ++x) img(y, x) = 0.5f * float(x + y);
+    const integral64f sums = integral_image<double>(img);
+
+    int area = -1;
+    EXPECT_EQ(sums.clippedSum(-5, -5, 100, 100, 0, &area), bruteSum(img, 0, 0, 10, 6, 0));
+    EXPECT_EQ(area, 60);
+    EXPECT_EQ(sums.clippedSum(20, 0, 30, 6, 0, &area), 0.0);
+    EXPECT_EQ(area, 0);
+
+    // window of radius 1 around the corner covers 2x2 pixels: 0, 0.5, 0.5, 1
+    EXPECT_DOUBLE_EQ(sums.windowMean(0, 0, 1), 0.5);
+    EXPECT_DOUBLE_EQ(sums.windowMean(4, 3, 2), 3.5);
+}
@@ -0,0 +1,25 @@
+#include "kernel_variants.h"
+
+#include "bilinear_kernels.h"
+#include "blur_kernels.h"
+#include "float16_kernels.h"
+#include "grayscale_kernels.h"
+#include "profile_kernels.h"
+#include "threshold_kernels.h"
+#include "warp_kernels.h"
+
+std::string kernelVariants() {
+    std::string s;
+    auto add = [&](const char *family, const char *name) {
+        if (!s.empty()) s += " ";
+        s += std::string(family) + "=" + name;
+    };
+    add("bilinear", bilinear_kernels::best().name);
+    add("blur", blur_kernels::best().name);
+    add("float16", float16_kernels::best().name);
+    add("grayscale", grayscale_kernels::best().name);
+    add("profile", profile_kernels::best().name);
+    add("threshold", threshold_kernels::best().name);
+    add("warp", warp_kernels::best().name);
+    return s;
+}
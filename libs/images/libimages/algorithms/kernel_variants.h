@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Implementations picked by best() of every kernel family, f.e.
+// "bilinear=avx2 blur=avx512 float16=f16c grayscale=avx2 profile=avx512 threshold=avx512 warp=avx2".
+// They depend on the CPU and on CVPUZZLE_ISA (see libbase/cpu_features.h), so benchmarks report them next to their timings.
+std::string kernelVariants();
@@ -0,0 +1,19 @@
+#include "kernel_variants.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/cpu_features.h>
+
+#include <iostream>
+
+#include "blur_kernels.h"
+
+TEST(kernel_variants, listsEveryFamily) {
+    const std::string variants = kernelVariants();
+    for (const char *family : {"bilinear=", "blur=", "float16=", "grayscale=", "profile=", "threshold=", "warp="}) {
+        EXPECT_NE(variants.find(family), std::string::npos) << family;
+    }
+    EXPECT_NE(variants.find(std::string("blur=") + blur_kernels::best().name), std::string::npos);
+    if (!cpuFeatures().avx2) EXPECT_EQ(variants.find("avx"), std::string::npos); // f.e. CVPUZZLE_ISA=scalar
+    std::cout << "kernel variants: " << variants << std::endl;
+}
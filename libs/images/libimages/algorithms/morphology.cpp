@@ -1,76 +1,74 @@
 #include "morphology.h"
 
 #include <algorithm>
+#include <bit>
+#include <string>
+#include <vector>
 
+#include <libimages/algorithms/integral_image.h>
+
+#include <libbase/autotuner.h>
+#include <libbase/profiler.h>
 #include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
 
 namespace morphology {
 
 static void check_binary_01_255(const image8u& src) {
     rassert(src.channels() == 1, "morphology expects 1-channel image", src.channels());
+#if RASSERT_LEVEL >= 1
+    // a whole pass over the image, so only in debug builds
     for (int j = 0; j < src.height(); ++j) {
+        const std::uint8_t* row = src.ptr(j);
         for (int i = 0; i < src.width(); ++i) {
-            const std::uint8_t v = src(j, i);
-            rassert(v == 0 || v == 255, "morphology expects binary pixels {0,255}", int(v), j, i);
+            const std::uint8_t v = row[i];
+            rassert_debug(v == 0 || v == 255, "morphology expects binary pixels {0,255}", int(v), j, i);
         }
     }
+#endif
 }
 
-image8u erode(const image8u& src, int strength, bool with_openmp) {
-    rassert(strength >= 0, "erode: strength must be >= 0", strength);
-    check_binary_01_255(src);
+namespace {
 
+// Direct (2r+1)^2 window scan, kept as a reference implementation
+void erode_naive(const image8u& src, int strength, bool with_openmp, image8u& dst) {
     const int w = src.width();
     const int h = src.height();
 
-    image8u dst(w, h, 1);
+    dst.ensureSize(w, h, 1);
 
-    if (strength == 0) {
-        dst = src;
-        return dst;
-    }
-
-    #pragma omp parallel for if(with_openmp)
-    for (int j = 0; j < h; ++j) {
+    parallelForEach(0, h, [&](int j) {
+        std::uint8_t* out = dst.ptr(j);
         for (int i = 0; i < w; ++i) {
             // Zero padding: if the neighborhood goes outside, erosion must be 0.
             if (j - strength < 0 || j + strength >= h || i - strength < 0 || i + strength >= w) {
-                dst(j, i) = 0;
+                out[i] = 0;
                 continue;
             }
 
             bool all_on = true;
             for (int y = j - strength; y <= j + strength && all_on; ++y) {
+                const std::uint8_t* row = src.ptr(y);
                 for (int x = i - strength; x <= i + strength; ++x) {
-                    if (src(y, x) == 0) {
+                    if (row[x] == 0) {
                         all_on = false;
                         break;
                     }
                 }
             }
-            dst(j, i) = all_on ? 255 : 0;
+            out[i] = all_on ? 255 : 0;
         }
-    }
-
-    return dst;
+    }, with_openmp);
 }
 
-image8u dilate(const image8u& src, int strength, bool with_openmp) {
-    rassert(strength >= 0, "dilate: strength must be >= 0", strength);
-    check_binary_01_255(src);
-
+void dilate_naive(const image8u& src, int strength, bool with_openmp, image8u& dst) {
     const int w = src.width();
     const int h = src.height();
 
-    image8u dst(w, h, 1);
-
-    if (strength == 0) {
-        dst = src;
-        return dst;
-    }
+    dst.ensureSize(w, h, 1);
 
-    #pragma omp parallel for if(with_openmp)
-    for (int j = 0; j < h; ++j) {
+    parallelForEach(0, h, [&](int j) {
+        std::uint8_t* out = dst.ptr(j);
         for (int i = 0; i < w; ++i) {
             const int y0 = std::max(0, j - strength);
             const int y1 = std::min(h - 1, j + strength);
@@ -79,18 +77,543 @@ image8u dilate(const image8u& src, int strength, bool with_openmp) {
 
             bool any_on = false;
             for (int y = y0; y <= y1 && !any_on; ++y) {
+                const std::uint8_t* row = src.ptr(y);
                 for (int x = x0; x <= x1; ++x) {
-                    if (src(y, x) == 255) {
+                    if (row[x] == 255) {
                         any_on = true;
                         break;
                     }
                 }
             }
-            dst(j, i) = any_on ? 255 : 0;
+            out[i] = any_on ? 255 : 0;
+        }
+    }, with_openmp);
+}
+
+// Count-based kernel on a summed-area table: a window is all 255 iff its sum is 255 * (2r+1)^2 (windows that cross
+// the border have fewer pixels, so they never reach it - zero padding), it has a 255 iff its clipped sum is positive
+template <bool IsErode, typename S>
+void integral_count(const image8u& src, int strength, bool with_openmp, image8u& dst) {
+    const int w = src.width();
+    const int h = src.height();
+    const IntegralImage<S> sums = integral_image<S>(src, with_openmp);
+    const S full = S(255) * S(2 * strength + 1) * S(2 * strength + 1);
+
+    dst.ensureSize(w, h, 1);
+    parallelForEach(0, h, [&](int j) {
+        std::uint8_t* out = dst.ptr(j);
+        for (int i = 0; i < w; ++i) {
+            const S s = sums.clippedSum(i - strength, j - strength, i + strength + 1, j + strength + 1);
+            out[i] = (IsErode ? s == full : s > 0) ? 255 : 0;
         }
+    }, with_openmp);
+}
+
+template <bool IsErode>
+void integral_count(const image8u& src, int strength, bool with_openmp, image8u& dst) {
+    // uint32 sums wrap, but window sums stay exact while the whole window fits
+    const std::uint64_t side = 2 * static_cast<std::uint64_t>(strength) + 1;
+    if (255 * side * side <= UINT32_MAX) return integral_count<IsErode, std::uint32_t>(src, strength, with_openmp, dst);
+    integral_count<IsErode, std::uint64_t>(src, strength, with_openmp, dst);
+}
+
+// van Herk / Gil-Werman running min/max with window k = 2r+1: ~3 comparisons per pixel and pass regardless of radius.
+// Padded sequence is split into blocks of k, g = prefix min/max inside block, hh = suffix min/max inside block,
+// window [s, s+k-1] always covers a suffix of one block plus a prefix of the next: op(hh[s], g[s+k-1]).
+// Both erosion and dilation pad with zeros: for {0,255} max(0, x) == x, so zero padding is the same as clipping the window.
+template <bool IsMin>
+inline std::uint8_t op(std::uint8_t a, std::uint8_t b) noexcept {
+    if constexpr (IsMin) {
+        return std::min(a, b);
+    } else {
+        return std::max(a, b);
     }
+}
+
+template <bool IsMin>
+void van_herk_line(const std::uint8_t* in, std::uint8_t* out, int n, int r, std::vector<std::uint8_t>& g, std::vector<std::uint8_t>& hh) {
+    const int k = 2 * r + 1;
+    const int padded = (n + 2 * r + k - 1) / k * k;
+    g.resize(static_cast<std::size_t>(padded));
+    hh.resize(static_cast<std::size_t>(padded));
+
+    auto value = [&](int p) -> std::uint8_t {
+        const int i = p - r;
+        return (i >= 0 && i < n) ? in[i] : std::uint8_t(0);
+    };
+
+    for (int b = 0; b < padded; b += k) {
+        g[b] = value(b);
+        for (int p = b + 1; p < b + k; ++p) g[p] = op<IsMin>(g[p - 1], value(p));
+        hh[b + k - 1] = value(b + k - 1);
+        for (int p = b + k - 2; p >= b; --p) hh[p] = op<IsMin>(hh[p + 1], value(p));
+    }
+
+    for (int i = 0; i < n; ++i) {
+        out[i] = op<IsMin>(hh[i], g[i + k - 1]);
+    }
+}
+
+template <bool IsMin>
+void van_herk(const image8u& src, int r, bool with_openmp, image8u& dst) {
+    const int w = src.width();
+    const int h = src.height();
+    const int k = 2 * r + 1;
+
+    // Horizontal pass
+    image8u horizontal(w, h, 1, ImageInit::Uninitialized);
+    parallelFor(0, h, 0, [&](int from, int to) {
+        std::vector<std::uint8_t> g, hh;
+        for (int j = from; j < to; ++j) {
+            van_herk_line<IsMin>(src.ptr(j), horizontal.ptr(j), w, r, g, hh);
+        }
+    }, with_openmp);
+
+    // Vertical pass: same recurrence but on whole rows at once, so memory is walked row by row
+    const int paddedH = (h + 2 * r + k - 1) / k * k;
+    const std::size_t rowBytes = static_cast<std::size_t>(w);
+    std::vector<std::uint8_t> g(static_cast<std::size_t>(paddedH) * rowBytes);
+    std::vector<std::uint8_t> hh(static_cast<std::size_t>(paddedH) * rowBytes);
+    const std::vector<std::uint8_t> zeros(rowBytes, 0);
 
+    auto inRow = [&](int p) -> const std::uint8_t* {
+        const int y = p - r;
+        return (y >= 0 && y < h) ? horizontal.ptr(y) : zeros.data();
+    };
+    auto gRow = [&](int p) { return g.data() + static_cast<std::size_t>(p) * rowBytes; };
+    auto hhRow = [&](int p) { return hh.data() + static_cast<std::size_t>(p) * rowBytes; };
+
+    const int blocks = paddedH / k;
+    parallelForEach(0, blocks, [&](int bi) {
+        const int b = bi * k;
+        std::copy(inRow(b), inRow(b) + rowBytes, gRow(b));
+        for (int p = b + 1; p < b + k; ++p) {
+            const std::uint8_t* prev = gRow(p - 1);
+            const std::uint8_t* cur = inRow(p);
+            std::uint8_t* dst = gRow(p);
+            for (int i = 0; i < w; ++i) dst[i] = op<IsMin>(prev[i], cur[i]);
+        }
+        std::copy(inRow(b + k - 1), inRow(b + k - 1) + rowBytes, hhRow(b + k - 1));
+        for (int p = b + k - 2; p >= b; --p) {
+            const std::uint8_t* next = hhRow(p + 1);
+            const std::uint8_t* cur = inRow(p);
+            std::uint8_t* dst = hhRow(p);
+            for (int i = 0; i < w; ++i) dst[i] = op<IsMin>(next[i], cur[i]);
+        }
+    }, with_openmp);
+
+    dst.ensureSize(w, h, 1);
+    parallelForEach(0, h, [&](int j) {
+        const std::uint8_t* a = hhRow(j);
+        const std::uint8_t* b = gRow(j + k - 1);
+        std::uint8_t* out = dst.ptr(j);
+        for (int i = 0; i < w; ++i) out[i] = op<IsMin>(a[i], b[i]);
+    }, with_openmp);
+}
+
+// dst must not be src
+template <bool IsErode>
+void apply(const image8u& src, int strength, bool with_openmp, Method method, image8u& dst) {
+    switch (method) {
+        case Method::Naive: return IsErode ? erode_naive(src, strength, with_openmp, dst) : dilate_naive(src, strength, with_openmp, dst);
+        case Method::Integral: return integral_count<IsErode>(src, strength, with_openmp, dst);
+        default:            return van_herk<IsErode>(src, strength, with_openmp, dst);
+    }
+}
+
+// Smaller images take less time than the tuning is worth, VanHerk is never much slower there
+constexpr std::size_t autotune_min_pixels = 1 << 16;
+
+// Auto: VanHerk or Integral, parallel or not (only serial ones if the caller asked for serial),
+// whichever is the fastest on this machine for the size class and the strength (see libbase/autotuner.h)
+template <bool IsErode>
+void applyAuto(const image8u& src, int strength, bool with_openmp, image8u& dst) {
+    const std::size_t pixels = static_cast<std::size_t>(src.width()) * src.height();
+    if (pixels < autotune_min_pixels) return van_herk<IsErode>(src, strength, with_openmp, dst);
+
+    struct Variant { Method method; bool parallel; };
+    static constexpr Variant variants[] = {{Method::VanHerk, false}, {Method::Integral, false},
+                                           {Method::VanHerk, true}, {Method::Integral, true}};
+    const int candidates = with_openmp ? 4 : 2;
+    const std::string key = autotune::sizeClass(pixels) + "/r" + std::to_string(std::bit_width(static_cast<unsigned>(strength)))
+                            + (with_openmp ? "/mt" : "/st");
+
+    bool tuned = false;
+    const int winner = autotune::choose(IsErode ? "morphology.erode" : "morphology.dilate", key, candidates, [&](int i) {
+        apply<IsErode>(src, strength, variants[i].parallel, variants[i].method, dst);
+    }, &tuned);
+    if (!tuned) apply<IsErode>(src, strength, variants[winner].parallel, variants[winner].method, dst);
+}
+
+template <bool IsErode>
+void morphology_image(const image8u& src, image8u& dst, int strength, bool with_openmp, Method method) {
+    if (strength == 0) {
+        dst = src;
+        return;
+    }
+    if (&dst == &src) {
+        // kernels read src while writing dst
+        image8u res;
+        morphology_image<IsErode>(src, res, strength, with_openmp, method);
+        dst = std::move(res);
+        return;
+    }
+
+    if (method == Method::Auto) return applyAuto<IsErode>(src, strength, with_openmp, dst);
+    apply<IsErode>(src, strength, with_openmp, method, dst);
+}
+
+} // namespace
+
+image8u erode(const image8u& src, int strength, bool with_openmp, Method method) {
+    image8u dst;
+    erode(src, dst, strength, with_openmp, method);
     return dst;
 }
 
-} // namespace morphology
\ No newline at end of file
+image8u dilate(const image8u& src, int strength, bool with_openmp, Method method) {
+    image8u dst;
+    dilate(src, dst, strength, with_openmp, method);
+    return dst;
+}
+
+void erode(const image8u& src, image8u& dst, int strength, bool with_openmp, Method method) {
+    PROFILE_SCOPE("morphology");
+    rassert(strength >= 0, "erode: strength must be >= 0", strength);
+    check_binary_01_255(src);
+    morphology_image<true>(src, dst, strength, with_openmp, method);
+}
+
+void dilate(const image8u& src, image8u& dst, int strength, bool with_openmp, Method method) {
+    PROFILE_SCOPE("morphology");
+    rassert(strength >= 0, "dilate: strength must be >= 0", strength);
+    check_binary_01_255(src);
+    morphology_image<false>(src, dst, strength, with_openmp, method);
+}
+
+namespace {
+
+// Word-parallel kernels for bit-packed masks: every operation below processes 64 pixels at once.
+using word_type = BitMask::word_type;
+constexpr int kBits = BitMask::bits_per_word;
+
+template <bool IsErode>
+inline word_type op_words(word_type a, word_type b) noexcept {
+    if constexpr (IsErode) {
+        return a & b;
+    } else {
+        return a | b;
+    }
+}
+
+// dst bit i = src bit (i + s), zeros come from the right end of the row
+inline void shift_towards_start(const word_type* src, word_type* dst, int words, int s) noexcept {
+    const int ws = s / kBits;
+    const int bs = s % kBits;
+    for (int k = 0; k < words; ++k) {
+        const word_type lo = (k + ws < words) ? src[k + ws] : 0;
+        const word_type hi = (k + ws + 1 < words) ? src[k + ws + 1] : 0;
+        dst[k] = (bs == 0) ? lo : ((lo >> bs) | (hi << (kBits - bs)));
+    }
+}
+
+// dst bit i = src bit (i - s), zeros come from the left end of the row
+inline void shift_towards_end(const word_type* src, word_type* dst, int words, int s) noexcept {
+    const int ws = s / kBits;
+    const int bs = s % kBits;
+    for (int k = 0; k < words; ++k) {
+        const word_type lo = (k - ws >= 0) ? src[k - ws] : 0;
+        const word_type lower = (k - ws - 1 >= 0) ? src[k - ws - 1] : 0;
+        dst[k] = (bs == 0) ? lo : ((lo << bs) | (lower >> (kBits - bs)));
+    }
+}
+
+// In-place acc bit i = op over acc bits [i, i+len) (Forward) or (i-len, i] (backward), outside bits are zeros.
+// Doubling: log2(len) steps of shift + AND/OR, the last step uses two overlapping power-of-two windows.
+template <bool IsErode, bool Forward>
+void window_words(std::vector<word_type>& acc, std::vector<word_type>& tmp, int words, int len) {
+    int covered = 1;
+    while (covered < len) {
+        const int step = std::min(covered, len - covered);
+        if constexpr (Forward) {
+            shift_towards_start(acc.data(), tmp.data(), words, step);
+        } else {
+            shift_towards_end(acc.data(), tmp.data(), words, step);
+        }
+        for (int w = 0; w < words; ++w) acc[w] = op_words<IsErode>(acc[w], tmp[w]);
+        covered += step;
+    }
+}
+
+// Horizontal AND/OR over window [i-r, i+r] for a single row: forward window [i, i+r] followed by backward window [i-r, i].
+// Zeros outside of the row make erosion near the border 0 and do not affect dilation - same as zero padding.
+template <bool IsErode>
+void horizontal_words(const word_type* in, word_type* out, int words, int r, word_type lastWordMask,
+                      std::vector<word_type>& acc, std::vector<word_type>& tmp) {
+    acc.assign(in, in + words);
+    tmp.resize(static_cast<std::size_t>(words));
+
+    window_words<IsErode, true>(acc, tmp, words, r + 1);
+    window_words<IsErode, false>(acc, tmp, words, r + 1);
+
+    std::copy(acc.begin(), acc.end(), out);
+    out[words - 1] &= lastWordMask;
+}
+
+// Square element as horizontal doubling pass + vertical van Herk pass on whole row words.
+// Erosion treats pixels outside as 0, dilation simply clips the window - same as image8u versions.
+// dst must not be src
+template <bool IsErode>
+void morphology_bits(const BitMask& src, int strength, bool with_openmp, BitMask& dst) {
+    PROFILE_SCOPE("morphology");
+    const int w = src.width();
+    const int h = src.height();
+    const int wpr = src.words_per_row();
+    const int r = strength;
+    const int k = 2 * r + 1;
+
+    BitMask horizontal(w, h);
+    parallelFor(0, h, 0, [&](int from, int to) {
+        std::vector<word_type> acc, tmp;
+        for (int j = from; j < to; ++j) {
+            horizontal_words<IsErode>(src.row(j), horizontal.row(j), wpr, r, src.last_word_mask(), acc, tmp);
+        }
+    }, with_openmp);
+
+    // Vertical van Herk: rows are padded with r zero rows on both sides and split into blocks of k rows
+    const int paddedH = (h + 2 * r + k - 1) / k * k;
+    const std::size_t rowWords = static_cast<std::size_t>(wpr);
+    std::vector<word_type> g(static_cast<std::size_t>(paddedH) * rowWords);
+    std::vector<word_type> hh(static_cast<std::size_t>(paddedH) * rowWords);
+    const std::vector<word_type> zeros(rowWords, 0);
+
+    auto inRow = [&](int p) -> const word_type* {
+        const int y = p - r;
+        return (y >= 0 && y < h) ? horizontal.row(y) : zeros.data();
+    };
+    auto gRow = [&](int p) { return g.data() + static_cast<std::size_t>(p) * rowWords; };
+    auto hhRow = [&](int p) { return hh.data() + static_cast<std::size_t>(p) * rowWords; };
+
+    const int blocks = paddedH / k;
+    parallelForEach(0, blocks, [&](int bi) {
+        const int b = bi * k;
+        std::copy(inRow(b), inRow(b) + rowWords, gRow(b));
+        for (int p = b + 1; p < b + k; ++p) {
+            const word_type* prev = gRow(p - 1);
+            const word_type* cur = inRow(p);
+            word_type* dst = gRow(p);
+            for (int i = 0; i < wpr; ++i) dst[i] = op_words<IsErode>(prev[i], cur[i]);
+        }
+        std::copy(inRow(b + k - 1), inRow(b + k - 1) + rowWords, hhRow(b + k - 1));
+        for (int p = b + k - 2; p >= b; --p) {
+            const word_type* next = hhRow(p + 1);
+            const word_type* cur = inRow(p);
+            word_type* dst = hhRow(p);
+            for (int i = 0; i < wpr; ++i) dst[i] = op_words<IsErode>(next[i], cur[i]);
+        }
+    }, with_openmp);
+
+    dst.ensureSize(w, h);
+    parallelForEach(0, h, [&](int j) {
+        const word_type* a = hhRow(j);
+        const word_type* b = gRow(j + k - 1);
+        word_type* out = dst.row(j);
+        for (int i = 0; i < wpr; ++i) out[i] = op_words<IsErode>(a[i], b[i]);
+    }, with_openmp);
+}
+
+template <bool IsErode>
+void morphology_mask(const BitMask& src, BitMask& dst, int strength, bool with_openmp) {
+    if (strength == 0) {
+        dst = src;
+    } else if (&dst == &src) {
+        BitMask res;
+        morphology_bits<IsErode>(src, strength, with_openmp, res);
+        dst = std::move(res);
+    } else {
+        morphology_bits<IsErode>(src, strength, with_openmp, dst);
+    }
+}
+
+// One op of the streaming pipeline: keeps horizontally processed input rows [j-r, j+r] in a ring buffer
+// and produces output rows one by one in increasing order.
+struct StreamStage {
+    bool isErode = true;
+    int r = 0;
+    int nextOut = 0;  // next output row to produce
+    int nextIn = 0;   // next input row to load into the ring
+    std::vector<word_type> ring; // (2r+1) rows
+    std::vector<word_type> out;  // last produced output row
+};
+
+class StreamingPipeline {
+public:
+    StreamingPipeline(const BitMask& src, const std::vector<Op>& ops)
+        : src_(src), h_(src.height()), wpr_(src.words_per_row())
+    {
+        stages_.resize(ops.size());
+        for (std::size_t s = 0; s < ops.size(); ++s) {
+            stages_[s].isErode = ops[s].type == OpType::Erode;
+            stages_[s].r = ops[s].strength;
+            stages_[s].ring.assign(static_cast<std::size_t>(2 * ops[s].strength + 1) * wpr_, 0);
+            stages_[s].out.assign(static_cast<std::size_t>(wpr_), 0);
+        }
+    }
+
+    // Produces rows [from, to) of every stage that are needed for rows [from, to) of the last one.
+    // Rows of stage s are passed to sink(s, j, row) only if j is in [from, to).
+    template <typename Sink>
+    void run(int from, int to, Sink&& sink) {
+        // Stage s has to start from row lo[s], its input (stage s-1 output) from lo[s] - r[s]
+        int lo = from;
+        for (int s = static_cast<int>(stages_.size()) - 1; s >= 0; --s) {
+            stages_[s].nextOut = lo;
+            lo = std::max(0, lo - stages_[s].r);
+            stages_[s].nextIn = lo;
+        }
+        for (int j = from; j < to; ++j) {
+            pull(static_cast<int>(stages_.size()) - 1, j, from, to, sink);
+        }
+    }
+
+private:
+    template <typename Sink>
+    const word_type* pull(int s, int j, int from, int to, Sink& sink) {
+        if (s < 0) return src_.row(j);
+
+        StreamStage& st = stages_[s];
+        rassert_debug(j == st.nextOut, 734812310, j, st.nextOut);
+        const int ringRows = 2 * st.r + 1;
+
+        const int need = std::min(h_ - 1, j + st.r);
+        while (st.nextIn <= need) {
+            const word_type* in = pull(s - 1, st.nextIn, from, to, sink);
+            word_type* dst = st.ring.data() + static_cast<std::size_t>(st.nextIn % ringRows) * wpr_;
+            if (st.isErode) {
+                horizontal_words<true>(in, dst, wpr_, st.r, src_.last_word_mask(), acc_, tmp_);
+            } else {
+                horizontal_words<false>(in, dst, wpr_, st.r, src_.last_word_mask(), acc_, tmp_);
+            }
+            ++st.nextIn;
+        }
+
+        word_type* out = st.out.data();
+        if (st.isErode && (j - st.r < 0 || j + st.r >= h_)) {
+            std::fill(st.out.begin(), st.out.end(), 0);
+        } else {
+            const int y0 = std::max(0, j - st.r);
+            const int y1 = std::min(h_ - 1, j + st.r);
+            std::copy_n(st.ring.data() + static_cast<std::size_t>(y0 % ringRows) * wpr_, wpr_, out);
+            for (int y = y0 + 1; y <= y1; ++y) {
+                const word_type* row = st.ring.data() + static_cast<std::size_t>(y % ringRows) * wpr_;
+                if (st.isErode) {
+                    for (int i = 0; i < wpr_; ++i) out[i] &= row[i];
+                } else {
+                    for (int i = 0; i < wpr_; ++i) out[i] |= row[i];
+                }
+            }
+        }
+        ++st.nextOut;
+
+        if (j >= from && j < to) sink(s, j, out);
+        return out;
+    }
+
+    const BitMask& src_;
+    const int h_;
+    const int wpr_;
+    std::vector<StreamStage> stages_;
+    std::vector<word_type> acc_, tmp_;
+};
+
+} // namespace
+
+BitMask pipeline(const BitMask& src, const std::vector<Op>& ops, bool with_openmp, std::vector<BitMask>* intermediates) {
+    BitMask dst;
+    pipeline(src, dst, ops, with_openmp, intermediates);
+    return dst;
+}
+
+void pipeline(const BitMask& src, BitMask& dst, const std::vector<Op>& ops, bool with_openmp,
+              std::vector<BitMask>* intermediates) {
+    PROFILE_SCOPE("morphology");
+    for (const Op& op : ops) {
+        rassert(op.strength >= 0, "pipeline: strength must be >= 0", op.strength);
+    }
+    if (ops.empty()) {
+        if (intermediates) intermediates->clear();
+        dst = src;
+        return;
+    }
+    if (&dst == &src) {
+        // strips re-read halo rows of src that other strips have already written
+        BitMask res;
+        pipeline(src, res, ops, with_openmp, intermediates);
+        dst = std::move(res);
+        return;
+    }
+
+    const int w = src.width();
+    const int h = src.height();
+    const int nOps = static_cast<int>(ops.size());
+
+    // every row of every target is written below, so buffers of the previous call are reused as is
+    dst.ensureSize(w, h);
+    if (intermediates) {
+        intermediates->resize(static_cast<std::size_t>(nOps - 1));
+        for (BitMask& m : *intermediates) m.ensureSize(w, h);
+    }
+
+    // Strips are independent: each one re-reads a halo of sum(strength) rows above it
+    int halo = 0;
+    for (const Op& op : ops) halo += op.strength;
+    const int stripHeight = with_openmp ? std::max(kMinStripHeight, 4 * halo) : h;
+    const int strips = (h + stripHeight - 1) / stripHeight;
+
+    parallelForEach(0, strips, [&](int strip) {
+        const int from = strip * stripHeight;
+        const int to = std::min(h, from + stripHeight);
+
+        StreamingPipeline stream(src, ops);
+        stream.run(from, to, [&](int s, int j, const word_type* row) {
+            if (s != nOps - 1 && !intermediates) return;
+            BitMask& target = (s == nOps - 1) ? dst : (*intermediates)[static_cast<std::size_t>(s)];
+            std::copy_n(row, target.words_per_row(), target.row(j));
+        });
+    }, with_openmp && strips > 1);
+}
+
+image8u pipeline(const image8u& src, const std::vector<Op>& ops, bool with_openmp, std::vector<image8u>* intermediates) {
+    check_binary_01_255(src);
+    std::vector<BitMask> bitIntermediates;
+    const BitMask res = pipeline(BitMask::fromImage(src), ops, with_openmp, intermediates ? &bitIntermediates : nullptr);
+    if (intermediates) {
+        intermediates->clear();
+        for (const BitMask& m : bitIntermediates) intermediates->push_back(m.toImage());
+    }
+    return res.toImage();
+}
+
+BitMask erode(const BitMask& src, int strength, bool with_openmp) {
+    BitMask dst;
+    erode(src, dst, strength, with_openmp);
+    return dst;
+}
+
+BitMask dilate(const BitMask& src, int strength, bool with_openmp) {
+    BitMask dst;
+    dilate(src, dst, strength, with_openmp);
+    return dst;
+}
+
+void erode(const BitMask& src, BitMask& dst, int strength, bool with_openmp) {
+    rassert(strength >= 0, "erode: strength must be >= 0", strength);
+    morphology_mask<true>(src, dst, strength, with_openmp);
+}
+
+void dilate(const BitMask& src, BitMask& dst, int strength, bool with_openmp) {
+    rassert(strength >= 0, "dilate: strength must be >= 0", strength);
+    morphology_mask<false>(src, dst, strength, with_openmp);
+}
+
+} // namespace morphology
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
+#include <libimages/bit_mask.h>
 #include <libimages/image.h>
 
 namespace morphology {
@@ -11,8 +13,53 @@ namespace morphology {
     // Border handling: zero-padding outside the image.
     //
     // strength == 0 -> returns a copy.
+    //
+    // Method selects the kernel, all of them give identical results:
+    //   Naive   - scans the whole (2r+1)^2 window per pixel, O(r^2)
+    //   VanHerk - separable van Herk/Gil-Werman running min/max, O(1) per pixel regardless of radius
+    //   Integral - window sums from a summed-area table (see integral_image.h), O(1) per pixel, 4 bytes of sums per pixel
+    //   Auto    - VanHerk or Integral, in parallel or not, whichever is the fastest on this machine for the image size
+    //             and the strength: timed at the first call (see libbase/autotuner.h), with_openmp=false allows
+    //             only serial variants; VanHerk for images below 64K pixels
+    enum class Method { Auto, Naive, VanHerk, Integral };
+
+    image8u erode(const image8u& src, int strength, bool with_openmp=true, Method method=Method::Auto);
+    image8u dilate(const image8u& src, int strength, bool with_openmp=true, Method method=Method::Auto);
+
+    // Same into a caller-owned dst: its buffer is reused if the size matches (reallocated otherwise),
+    // dst may be src itself (then the result is computed aside and moved in)
+    void erode(const image8u& src, image8u& dst, int strength, bool with_openmp=true, Method method=Method::Auto);
+    void dilate(const image8u& src, image8u& dst, int strength, bool with_openmp=true, Method method=Method::Auto);
+
+    // Same semantics on bit-packed masks (1 bit per pixel). Works on whole 64-bit words:
+    // rows via log2(2r+1) shift+AND/OR steps, columns via van Herk on row words.
+    BitMask erode(const BitMask& src, int strength, bool with_openmp=true);
+    BitMask dilate(const BitMask& src, int strength, bool with_openmp=true);
+    void erode(const BitMask& src, BitMask& dst, int strength, bool with_openmp=true);
+    void dilate(const BitMask& src, BitMask& dst, int strength, bool with_openmp=true);
+
+    // Sequence of erosions/dilations, f.e. closing = {dilateOp(r), erodeOp(r)}
+    enum class OpType { Erode, Dilate };
+    struct Op {
+        OpType type;
+        int strength;
+    };
+    inline Op erodeOp(int strength) { return {OpType::Erode, strength}; }
+    inline Op dilateOp(int strength) { return {OpType::Dilate, strength}; }
+
+    // Minimal rows per strip when pipeline runs strips in parallel
+    inline constexpr int kMinStripHeight = 128;
 
-    image8u erode(const image8u& src, int strength, bool with_openmp=true);
-    image8u dilate(const image8u& src, int strength, bool with_openmp=true);
+    // Applies ops in order in one streaming sweep: rows flow through per-op rolling line buffers,
+    // so no full-size intermediate masks are written and only the result is allocated.
+    // Result is identical to calling erode/dilate one after another.
+    // If intermediates != nullptr it receives results of all ops except the last one (f.e. for debug dumps).
+    BitMask pipeline(const BitMask& src, const std::vector<Op>& ops, bool with_openmp=true,
+                     std::vector<BitMask>* intermediates=nullptr);
+    // Into a caller-owned dst (and intermediates), reusing their buffers when sizes match
+    void pipeline(const BitMask& src, BitMask& dst, const std::vector<Op>& ops, bool with_openmp=true,
+                  std::vector<BitMask>* intermediates=nullptr);
+    image8u pipeline(const image8u& src, const std::vector<Op>& ops, bool with_openmp=true,
+                     std::vector<image8u>* intermediates=nullptr);
 
 } // namespace morphology
\ No newline at end of file
@@ -2,10 +2,13 @@
 
 #include <filesystem>
 #include <string>
+#include <utility>
 
 #include <gtest/gtest.h>
 
+#include <libbase/autotuner.h>
 #include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
 #include <libimages/debug_io.h>
 #include <libimages/image.h>
 #include <libimages/image_io.h>
@@ -126,3 +129,189 @@ TEST(morphology, thresholdByConstant100AndUseMorphology) {
         debug_io::dump_image(getUnitCaseDebugDir() + "22_eroded_and_dilated.jpg", eroded_and_dilated);
     }
 }
+
+TEST(morphology, bitMaskMatchesImage8u) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    image32f grayscale = to_grayscale_float(img);
+    image8u mask = threshold_masking(grayscale, 100);
+    const BitMask bits = threshold_bitmask(grayscale, 100);
+    ASSERT_EQ(bits.toImage().toVector(), mask.toVector());
+
+    for (int strength : {0, 1, 2, 6, 63, 64, 70}) {
+        const image8u eroded = morphology::erode(mask, strength);
+        const image8u dilated = morphology::dilate(mask, strength);
+        EXPECT_EQ(morphology::erode(bits, strength).toImage().toVector(), eroded.toVector()) << strength;
+        EXPECT_EQ(morphology::dilate(bits, strength).toImage().toVector(), dilated.toVector()) << strength;
+    }
+
+    debug_io::dump_image(getUnitCaseDebugDir() + "00_mask.png", bits);
+    debug_io::dump_image(getUnitCaseDebugDir() + "01_dilated_r6.png", morphology::dilate(bits, 6));
+}
+
+TEST(morphology, vanHerkMatchesNaive) {
+    FastRandom r(239);
+    for (auto [w, h] : {std::pair{37, 23}, std::pair{5, 64}, std::pair{1, 1}}) {
+        image8u in = make_black(w, h);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                in(j, i) = (r.nextInt(0, 9) < 7) ? 255 : 0;
+
+        for (int strength : {1, 2, 3, 5, 11, 40}) {
+            EXPECT_EQ(morphology::erode(in, strength, true, morphology::Method::VanHerk).toVector(),
+                      morphology::erode(in, strength, true, morphology::Method::Naive).toVector()) << w << "x" << h << " r=" << strength;
+            EXPECT_EQ(morphology::dilate(in, strength, true, morphology::Method::VanHerk).toVector(),
+                      morphology::dilate(in, strength, true, morphology::Method::Naive).toVector()) << w << "x" << h << " r=" << strength;
+        }
+    }
+}
+
+TEST(morphology, autoIsTunedAndMatchesVanHerk) {
+    autotune::clear();
+    FastRandom r(243);
+    const int w = 300, h = 250; // above the size from which Auto is tuned
+    image8u in = make_black(w, h);
+    for (int j = 0; j < h; ++j)
+        for (int i = 0; i < w; ++i)
+            in(j, i) = (r.nextInt(0, 9) < 7) ? 255 : 0;
+
+    for (bool with_openmp : {true, false}) {
+        const std::string key = autotune::sizeClass(w * h) + "/r2" + (with_openmp ? "/mt" : "/st");
+        for (int pass = 0; pass < 2; ++pass) {
+            EXPECT_EQ(morphology::erode(in, 3, with_openmp).toVector(),
+                      morphology::erode(in, 3, with_openmp, morphology::Method::VanHerk).toVector()) << with_openmp << " " << pass;
+            EXPECT_EQ(morphology::dilate(in, 3, with_openmp).toVector(),
+                      morphology::dilate(in, 3, with_openmp, morphology::Method::VanHerk).toVector()) << with_openmp << " " << pass;
+        }
+        const int erodeWinner = autotune::cached("morphology.erode", key);
+        EXPECT_GE(erodeWinner, 0);
+        // serial calls choose from serial variants only
+        EXPECT_LT(erodeWinner, with_openmp ? 4 : 2);
+        EXPECT_GE(autotune::cached("morphology.dilate", key), 0);
+    }
+    autotune::clear();
+}
+
+TEST(morphology, integralMatchesNaive) {
+    FastRandom r(241);
+    for (auto [w, h] : {std::pair{37, 23}, std::pair{5, 64}, std::pair{1, 1}}) {
+        image8u in = make_black(w, h);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                in(j, i) = (r.nextInt(0, 9) < 8) ? 255 : 0;
+
+        for (int strength : {1, 2, 5, 11, 40}) {
+            EXPECT_EQ(morphology::erode(in, strength, true, morphology::Method::Integral).toVector(),
+                      morphology::erode(in, strength, true, morphology::Method::Naive).toVector()) << w << "x" << h << " r=" << strength;
+            EXPECT_EQ(morphology::dilate(in, strength, false, morphology::Method::Integral).toVector(),
+                      morphology::dilate(in, strength, false, morphology::Method::Naive).toVector()) << w << "x" << h << " r=" << strength;
+        }
+    }
+}
+
+TEST(morphology, bitMaskWordBoundaries) {
+    FastRandom r(17);
+    for (int w : {1, 63, 64, 65, 130, 200}) {
+        const int h = 9;
+        image8u in = make_black(w, h);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                in(j, i) = (r.nextInt(0, 9) < 8) ? 255 : 0;
+        const BitMask bits = BitMask::fromImage(in);
+
+        for (int strength : {1, 2, 3, 31, 32, 33, 64, 100}) {
+            EXPECT_EQ(morphology::erode(bits, strength).toImage().toVector(),
+                      morphology::erode(in, strength, true, morphology::Method::Naive).toVector()) << "w=" << w << " r=" << strength;
+            EXPECT_EQ(morphology::dilate(bits, strength).toImage().toVector(),
+                      morphology::dilate(in, strength, true, morphology::Method::Naive).toVector()) << "w=" << w << " r=" << strength;
+        }
+    }
+}
+
+TEST(morphology, pipelineMatchesSequential) {
+    FastRandom r(23);
+    const std::vector<morphology::Op> ops = {
+        morphology::dilateOp(6), morphology::erodeOp(6), morphology::erodeOp(6), morphology::dilateOp(6),
+        morphology::erodeOp(2), morphology::dilateOp(0),
+    };
+    for (auto [w, h] : {std::pair{1, 1}, std::pair{70, 5}, std::pair{130, 300}, std::pair{257, 611}}) {
+        image8u in = make_black(w, h);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                in(j, i) = (r.nextInt(0, 9) < 7) ? 255 : 0;
+        const BitMask bits = BitMask::fromImage(in);
+
+        std::vector<BitMask> expected;
+        BitMask cur = bits;
+        for (const morphology::Op& op : ops) {
+            cur = (op.type == morphology::OpType::Erode) ? morphology::erode(cur, op.strength) : morphology::dilate(cur, op.strength);
+            expected.push_back(cur);
+        }
+
+        for (bool with_openmp : {false, true}) {
+            std::vector<BitMask> intermediates;
+            const BitMask res = morphology::pipeline(bits, ops, with_openmp, &intermediates);
+            EXPECT_TRUE(res == expected.back()) << "w=" << w << " h=" << h;
+            ASSERT_EQ(intermediates.size(), ops.size() - 1);
+            for (std::size_t k = 0; k + 1 < ops.size(); ++k) {
+                EXPECT_TRUE(intermediates[k] == expected[k]) << "w=" << w << " h=" << h << " op=" << k;
+            }
+            EXPECT_TRUE(morphology::pipeline(bits, ops, with_openmp) == expected.back());
+        }
+
+        EXPECT_EQ(morphology::pipeline(in, ops).toVector(), expected.back().toImage().toVector());
+    }
+}
+
+TEST(morphology, intoDstReusesBufferAndAllowsInPlace) {
+    FastRandom r(29);
+    image8u in = make_black(150, 90);
+    for (int j = 0; j < in.height(); ++j)
+        for (int i = 0; i < in.width(); ++i)
+            in(j, i) = (r.nextInt(0, 9) < 6) ? 255 : 0;
+    const BitMask bits = BitMask::fromImage(in);
+
+    for (morphology::Method method : {morphology::Method::Auto, morphology::Method::Naive, morphology::Method::VanHerk,
+                                      morphology::Method::Integral}) {
+        for (int strength : {0, 3}) {
+            const image8u eroded = morphology::erode(in, strength, true, method);
+            const image8u dilated = morphology::dilate(in, strength, true, method);
+
+            image8u dst;
+            morphology::erode(in, dst, strength, true, method);
+            EXPECT_EQ(dst.toVector(), eroded.toVector());
+            const std::uint8_t *buffer = dst.ptr(0);
+            morphology::dilate(in, dst, strength, true, method);
+            EXPECT_EQ(dst.ptr(0), buffer);
+            EXPECT_EQ(dst.toVector(), dilated.toVector());
+
+            image8u inPlace = in;
+            morphology::erode(inPlace, inPlace, strength, true, method);
+            EXPECT_EQ(inPlace.toVector(), eroded.toVector());
+        }
+    }
+
+    BitMask dst;
+    morphology::dilate(bits, dst, 4);
+    const BitMask::word_type *words = dst.row(0);
+    morphology::erode(bits, dst, 4);
+    EXPECT_EQ(dst.row(0), words);
+    EXPECT_TRUE(dst == morphology::erode(bits, 4));
+    BitMask inPlace = bits;
+    morphology::dilate(inPlace, inPlace, 4);
+    EXPECT_TRUE(inPlace == morphology::dilate(bits, 4));
+
+    const std::vector<morphology::Op> closing = {morphology::dilateOp(5), morphology::erodeOp(5)};
+    std::vector<BitMask> intermediates;
+    morphology::pipeline(bits, dst, closing, true, &intermediates);
+    const BitMask::word_type *intermediateWords = intermediates[0].row(0);
+    morphology::pipeline(bits, dst, closing, true, &intermediates);
+    EXPECT_EQ(dst.row(0), words);
+    EXPECT_EQ(intermediates[0].row(0), intermediateWords);
+    EXPECT_TRUE(dst == morphology::pipeline(bits, closing));
+    EXPECT_TRUE(intermediates[0] == morphology::dilate(bits, 5));
+    inPlace = bits;
+    morphology::pipeline(inPlace, inPlace, closing);
+    EXPECT_TRUE(inPlace == dst);
+}
@@ -0,0 +1,145 @@
+#include "profile_alignment.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <numbers>
+
+namespace {
+
+using Complex = std::complex<double>;
+
+// In-place iterative radix-2 FFT, n a power of two; inverse is not normalized
+void fft(std::vector<Complex> &data, bool inverse) {
+    const std::size_t n = data.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    for (std::size_t len = 2; len <= n; len <<= 1) {
+        const double angle = 2.0 * std::numbers::pi / static_cast<double>(len) * (inverse ? 1.0 : -1.0);
+        const Complex step = std::polar(1.0, angle);
+        for (std::size_t i = 0; i < n; i += len) {
+            Complex w = 1.0;
+            for (std::size_t k = 0; k < len / 2; ++k) {
+                const Complex u = data[i + k];
+                const Complex v = data[i + k + len / 2] * w;
+                data[i + k] = u + v;
+                data[i + k + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+}
+
+// Sum over i of a[i] * b[i + s] for s in [-maxShift, maxShift], summed over channels: channel c of a goes into
+// the real part and of b into the imaginary part of one FFT, their spectra are separated by conjugate symmetry
+std::vector<std::int64_t> crossCorrelation(const PlanarProfileView &a, const PlanarProfileView &b, int maxShift) {
+    const int length = a.length;
+    // no circular wrap for |s| < length
+    const std::size_t n = std::bit_ceil(static_cast<std::size_t>(2 * length));
+    thread_local std::vector<Complex> packed, sum;
+    sum.assign(n, 0.0);
+    for (int c = 0; c < a.channels; ++c) {
+        packed.assign(n, 0.0);
+        const std::uint8_t *pa = a.channel(c);
+        const std::uint8_t *pb = b.channel(c);
+        for (int i = 0; i < length; ++i) packed[i] = Complex(pa[i], pb[i]);
+        fft(packed, false);
+        for (std::size_t k = 0; k < n; ++k) {
+            const Complex z = packed[k];
+            const Complex zm = std::conj(packed[(n - k) & (n - 1)]);
+            const Complex fa = 0.5 * (z + zm);
+            const Complex fb = Complex(0.0, -0.5) * (z - zm);
+            sum[k] += std::conj(fa) * fb;
+        }
+    }
+    fft(sum, true);
+    std::vector<std::int64_t> res(static_cast<std::size_t>(2 * maxShift + 1));
+    for (int s = -maxShift; s <= maxShift; ++s) {
+        const std::size_t k = static_cast<std::size_t>(s < 0 ? static_cast<std::ptrdiff_t>(n) + s : s);
+        res[s + maxShift] = std::llround(sum[k].real() / static_cast<double>(n));
+    }
+    return res;
+}
+
+} // namespace
+
+std::vector<std::int64_t> profileShiftSSD(PlanarProfileView a, PlanarProfileView b, int maxShift) {
+    rassert(a.length == b.length && a.channels == b.channels, 63748201101, a.length, b.length);
+    rassert(a.length > 0 && maxShift >= 0 && maxShift < a.length, 63748201102, a.length, maxShift);
+    const int length = a.length;
+
+    // energies of prefixes, so that the energy of any overlap is a difference of two of them
+    std::vector<std::int64_t> energyA(static_cast<std::size_t>(length) + 1, 0), energyB(static_cast<std::size_t>(length) + 1, 0);
+    for (int i = 0; i < length; ++i) {
+        std::int64_t ea = 0, eb = 0;
+        for (int c = 0; c < a.channels; ++c) {
+            ea += static_cast<std::int64_t>(a.channel(c)[i]) * a.channel(c)[i];
+            eb += static_cast<std::int64_t>(b.channel(c)[i]) * b.channel(c)[i];
+        }
+        energyA[i + 1] = energyA[i] + ea;
+        energyB[i + 1] = energyB[i] + eb;
+    }
+
+    std::vector<std::int64_t> res = crossCorrelation(a, b, maxShift);
+    for (int s = -maxShift; s <= maxShift; ++s) {
+        // a[i] against b[i + s] for i in [fromA, fromA + overlap)
+        const int overlap = length - std::abs(s);
+        const int fromA = std::max(0, -s);
+        const int fromB = fromA + s;
+        std::int64_t &value = res[s + maxShift];
+        value = (energyA[fromA + overlap] - energyA[fromA]) + (energyB[fromB + overlap] - energyB[fromB]) - 2 * value;
+    }
+    return res;
+}
+
+ProfileShift bestProfileShift(PlanarProfileView a, PlanarProfileView b, int maxShift) {
+    rassert(maxShift >= 0, 63748201103, maxShift);
+    maxShift = std::min(maxShift, a.length / 2);
+    const std::vector<std::int64_t> ssd = profileShiftSSD(a, b, maxShift);
+
+    ProfileShift best;
+    best.overlap = a.length;
+    best.ssd = ssd[maxShift];
+    for (int d = 1; d <= maxShift; ++d) {
+        for (int s : {-d, d}) {
+            const int overlap = a.length - d;
+            const std::int64_t value = ssd[s + maxShift];
+            // value / overlap < best.ssd / best.overlap, exactly
+            if (value * best.overlap < best.ssd * overlap) best = {s, overlap, value};
+        }
+    }
+    return best;
+}
+
+void shiftedOverlap(PlanarProfileView a, PlanarProfileView b, int shift, PlanarProfileView &overlapA, PlanarProfileView &overlapB,
+                    PlanarProfile8u &scratchA, PlanarProfile8u &scratchB) {
+    rassert(a.length == b.length && a.channels == b.channels, 63748201104, a.length, b.length);
+    rassert(std::abs(shift) < a.length, 63748201105, shift, a.length);
+    if (shift == 0) {
+        overlapA = a;
+        overlapB = b;
+        return;
+    }
+    const int overlap = a.length - std::abs(shift);
+    const int fromA = std::max(0, -shift);
+    const int fromB = fromA + shift;
+    for (PlanarProfile8u *scratch : {&scratchA, &scratchB}) {
+        scratch->length = overlap;
+        scratch->channels = a.channels;
+        scratch->data.resize(static_cast<std::size_t>(overlap) * a.channels);
+    }
+    for (int c = 0; c < a.channels; ++c) {
+        std::copy_n(a.channel(c) + fromA, overlap, scratchA.data.data() + static_cast<std::size_t>(c) * overlap);
+        std::copy_n(b.channel(c) + fromB, overlap, scratchB.data.data() + static_cast<std::size_t>(c) * overlap);
+    }
+    overlapA = scratchA;
+    overlapB = scratchB;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <libimages/algorithms/profile_distance.h>
+
+// Sliding alignment of two profiles of the same length: b is shifted along a, so that a corner found a few samples
+// off does not make a true match look bad. All shifts are evaluated at once by FFT cross-correlation
+// (O(L log L) per pair instead of O(L * shifts) for comparing at every shift).
+
+// res[s + maxShift] = sum over channels and samples i of (a[i] - b[i + s])^2, only the samples where both exist
+// (length - |s| of them), for every s in [-maxShift, maxShift]. Exact: correlations are rounded to integers.
+// maxShift must be less than the length.
+std::vector<std::int64_t> profileShiftSSD(PlanarProfileView a, PlanarProfileView b, int maxShift);
+
+struct ProfileShift final {
+    int shift = 0;
+    int overlap = 0; // length - |shift|
+    std::int64_t ssd = 0;
+};
+
+// Shift within [-maxShift, maxShift] (at most length / 2) with the least SSD per overlapping sample,
+// ties - the smaller |shift|, then the negative one. Swapping a and b while reversing both gives the same shift.
+ProfileShift bestProfileShift(PlanarProfileView a, PlanarProfileView b, int maxShift);
+
+// The overlapping parts of a and b at shift (a[i] against b[i + shift]) as two profiles of length - |shift|,
+// views of a and b themselves for shift 0, otherwise copies into scratchA and scratchB
+void shiftedOverlap(PlanarProfileView a, PlanarProfileView b, int shift, PlanarProfileView &overlapA, PlanarProfileView &overlapB,
+                    PlanarProfile8u &scratchA, PlanarProfile8u &scratchB);
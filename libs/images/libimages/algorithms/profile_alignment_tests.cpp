@@ -0,0 +1,105 @@
+#include "profile_alignment.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+PlanarProfile8u randomPlanarProfile(FastRandom &r, int length, int channels) {
+    PlanarProfile8u res;
+    res.length = length;
+    res.channels = channels;
+    res.data.resize(static_cast<std::size_t>(length) * channels);
+    for (std::uint8_t &v : res.data) v = static_cast<std::uint8_t>(r.nextInt(0, 255));
+    return res;
+}
+
+std::int64_t referenceSSD(const PlanarProfile8u &a, const PlanarProfile8u &b, int shift) {
+    std::int64_t sum = 0;
+    for (int i = 0; i < a.length; ++i) {
+        if (i + shift < 0 || i + shift >= a.length) continue;
+        for (int c = 0; c < a.channels; ++c) {
+            const int d = a.channel(c)[i] - b.channel(c)[i + shift];
+            sum += d * d;
+        }
+    }
+    return sum;
+}
+
+PlanarProfile8u reversed(const PlanarProfile8u &p) {
+    PlanarProfile8u res = p;
+    for (int c = 0; c < p.channels; ++c) {
+        std::reverse(res.data.begin() + static_cast<std::ptrdiff_t>(c) * p.length,
+                     res.data.begin() + static_cast<std::ptrdiff_t>(c + 1) * p.length);
+    }
+    return res;
+}
+
+} // namespace
+
+TEST(profile_alignment, shiftSSDMatchesBruteForce) {
+    FastRandom r(29);
+    for (int channels : {1, 3}) {
+        for (int length : {1, 2, 7, 64, 300, 1000}) {
+            const PlanarProfile8u a = randomPlanarProfile(r, length, channels);
+            const PlanarProfile8u b = randomPlanarProfile(r, length, channels);
+            const int maxShift = std::min(length - 1, 20);
+            const std::vector<std::int64_t> ssd = profileShiftSSD(a, b, maxShift);
+            ASSERT_EQ(ssd.size(), static_cast<std::size_t>(2 * maxShift + 1));
+            for (int s = -maxShift; s <= maxShift; ++s) {
+                EXPECT_EQ(ssd[s + maxShift], referenceSSD(a, b, s)) << "length=" << length << " shift=" << s;
+            }
+        }
+    }
+}
+
+TEST(profile_alignment, bestShiftFindsMisregistration) {
+    FastRandom r(31);
+    const int length = 120;
+    for (int trueShift : {-5, -1, 0, 2, 6}) {
+        // b is a with its samples moved by trueShift (the new tail random), plus a little noise
+        const PlanarProfile8u a = randomPlanarProfile(r, length, 3);
+        PlanarProfile8u b = randomPlanarProfile(r, length, 3);
+        for (int c = 0; c < 3; ++c) {
+            for (int i = 0; i < length; ++i) {
+                if (i - trueShift < 0 || i - trueShift >= length) continue;
+                const int v = a.channel(c)[i - trueShift] + r.nextInt(-2, 2);
+                b.data[static_cast<std::size_t>(c) * length + i] = static_cast<std::uint8_t>(std::clamp(v, 0, 255));
+            }
+        }
+        const ProfileShift best = bestProfileShift(a, b, 8);
+        EXPECT_EQ(best.shift, trueShift);
+        EXPECT_EQ(best.overlap, length - std::abs(trueShift));
+        EXPECT_EQ(best.ssd, referenceSSD(a, b, trueShift));
+
+        // the same pair seen from the other side
+        EXPECT_EQ(bestProfileShift(reversed(b), reversed(a), 8).shift, best.shift);
+
+        PlanarProfile8u scratchA, scratchB;
+        PlanarProfileView overlapA, overlapB;
+        shiftedOverlap(a, b, best.shift, overlapA, overlapB, scratchA, scratchB);
+        ASSERT_EQ(overlapA.length, best.overlap);
+        ASSERT_EQ(overlapB.length, best.overlap);
+        for (int i = 0; i < best.overlap; ++i) {
+            EXPECT_EQ(overlapA.channel(1)[i], a.channel(1)[i + std::max(0, -best.shift)]);
+            EXPECT_EQ(overlapB.channel(1)[i], b.channel(1)[i + std::max(0, best.shift)]);
+        }
+    }
+}
+
+TEST(profile_alignment, tiesPreferSmallerShift) {
+    // constant profiles: every shift has the same SSD per sample
+    PlanarProfile8u a, b;
+    a.length = b.length = 10;
+    a.channels = b.channels = 1;
+    a.data.assign(10, 100);
+    b.data.assign(10, 90);
+    EXPECT_EQ(bestProfileShift(a, b, 4).shift, 0);
+    // the window is at most half of the length
+    EXPECT_EQ(bestProfileShift(a, b, 100).overlap, 10);
+}
@@ -0,0 +1,114 @@
+#include "profile_cost_policies.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace profile_cost {
+
+template <int P>
+double Percentile<P>::aggregate(int *values, std::size_t n) {
+    const double pos = P / 100.0 * static_cast<double>(n - 1);
+    const std::size_t i = static_cast<std::size_t>(std::floor(pos));
+    const std::size_t j = std::min(n - 1, static_cast<std::size_t>(std::ceil(pos)));
+    std::nth_element(values, values + i, values + n);
+    const double a = values[i];
+    if (j == i) return a;
+    // the next rank is the minimum of the values above rank i
+    const double b = *std::min_element(values + i + 1, values + n);
+    return a + (pos - static_cast<double>(i)) * (b - a);
+}
+
+double Mean::aggregate(int *values, std::size_t n) {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) sum += values[i];
+    return sum / static_cast<double>(n);
+}
+
+template <int TrimPercent>
+double TrimmedMean<TrimPercent>::aggregate(int *values, std::size_t n) {
+    const std::size_t trim = std::min(n * TrimPercent / 100, (n - 1) / 2);
+    if (trim > 0) {
+        std::nth_element(values, values + trim, values + n);
+        std::nth_element(values + trim, values + (n - trim), values + n);
+    }
+    double sum = 0.0;
+    for (std::size_t i = trim; i < n - trim; ++i) sum += values[i];
+    return sum / static_cast<double>(n - 2 * trim);
+}
+
+template struct Percentile<50>;
+template struct Percentile<75>;
+template struct TrimmedMean<10>;
+
+} // namespace profile_cost
+
+namespace {
+
+constexpr int kStackSamples = 1024;
+
+} // namespace
+
+template <typename Policy>
+double evaluateProfileCost(PlanarProfileView a, PlanarProfileView b) {
+    constexpr int C = Policy::channels;
+    rassert(a.length == b.length && a.length > 0, 63748201101, a.length, b.length);
+    rassert(a.channels == C && b.channels == C, 63748201102, a.channels, b.channels, C);
+
+    const int n = a.length;
+    std::array<int, kStackSamples> stackValues;
+    std::vector<int> heapValues(n > kStackSamples ? n : 0);
+    int *values = n > kStackSamples ? heapValues.data() : stackValues.data();
+
+    // the channel loop has a compile-time trip count, so the sample loop is vectorized as a whole
+    std::array<const std::uint8_t *, C> pa, pb;
+    for (int c = 0; c < C; ++c) {
+        pa[c] = a.channel(c);
+        pb[c] = b.channel(c);
+    }
+    for (int i = 0; i < n; ++i) {
+        int v = 0;
+        for (int c = 0; c < C; ++c) v += Policy::distance::channel(static_cast<int>(pa[c][i]) - static_cast<int>(pb[c][i]));
+        values[i] = v;
+    }
+    return Policy::aggregation::aggregate(values, static_cast<std::size_t>(n));
+}
+
+template <typename Distance, typename Aggregation>
+ProfileCostFunction profileCostFunction(int channels) {
+    rassert(channels == 1 || channels == 3, 63748201103, channels);
+    if (channels == 1) return &evaluateProfileCost<profile_cost::Policy<Distance, Aggregation, 1>>;
+    return &evaluateProfileCost<profile_cost::Policy<Distance, Aggregation, 3>>;
+}
+
+// explicit instantiations
+using namespace profile_cost;
+
+template double evaluateProfileCost<Policy<L1, Median, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, Median, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, Percentile<75>, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, Percentile<75>, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, Mean, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, Mean, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, TrimmedMean<10>, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L1, TrimmedMean<10>, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, Median, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, Median, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, Percentile<75>, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, Percentile<75>, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, Mean, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, Mean, 3>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, TrimmedMean<10>, 1>>(PlanarProfileView a, PlanarProfileView b);
+template double evaluateProfileCost<Policy<L2, TrimmedMean<10>, 3>>(PlanarProfileView a, PlanarProfileView b);
+template ProfileCostFunction profileCostFunction<L1, Median>(int channels);
+template ProfileCostFunction profileCostFunction<L1, Percentile<75>>(int channels);
+template ProfileCostFunction profileCostFunction<L1, Mean>(int channels);
+template ProfileCostFunction profileCostFunction<L1, TrimmedMean<10>>(int channels);
+template ProfileCostFunction profileCostFunction<L2, Median>(int channels);
+template ProfileCostFunction profileCostFunction<L2, Percentile<75>>(int channels);
+template ProfileCostFunction profileCostFunction<L2, Mean>(int channels);
+template ProfileCostFunction profileCostFunction<L2, TrimmedMean<10>>(int channels);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+#include <libimages/algorithms/profile_distance.h>
+
+// Compile-time matching cost of two planar profiles: a per-sample distance (summed over a fixed number of channels)
+// aggregated over all samples. Every combination is its own instantiation with a fully inlined inner loop,
+// a choice between them costs one indirect call per pair of profiles (see profileCostFunction).
+namespace profile_cost {
+
+// Per-channel distance of two samples, summed over channels
+struct L1 {
+    static int channel(int d) noexcept { return d < 0 ? -d : d; }
+};
+struct L2 { // squared euclidean
+    static int channel(int d) noexcept { return d * d; }
+};
+
+// Aggregations of per-sample distances (values may be reordered)
+template <int P>
+struct Percentile { // linear interpolation between ranks like stats::percentile
+    static_assert(P >= 0 && P <= 100);
+    static double aggregate(int *values, std::size_t n);
+};
+using Median = Percentile<50>;
+
+struct Mean {
+    static double aggregate(int *values, std::size_t n);
+};
+
+template <int TrimPercent>
+struct TrimmedMean { // mean without TrimPercent% smallest and TrimPercent% largest values
+    static_assert(TrimPercent >= 0 && TrimPercent < 50);
+    static double aggregate(int *values, std::size_t n);
+};
+
+template <typename Distance, typename Aggregation, int Channels>
+struct Policy {
+    static_assert(Channels == 1 || Channels == 3);
+    using distance = Distance;
+    using aggregation = Aggregation;
+    static constexpr int channels = Channels;
+};
+
+} // namespace profile_cost
+
+using ProfileCostFunction = double (*)(PlanarProfileView a, PlanarProfileView b);
+
+// Instantiated (see profile_cost_policies.cpp) for L1 and L2 distances, each with Median, Percentile<75>, Mean
+// and TrimmedMean<10>, for 1 and 3 channels.
+// Profiles must have the same length and Policy::channels channels.
+template <typename Policy>
+double evaluateProfileCost(PlanarProfileView a, PlanarProfileView b);
+
+// Instantiation for images with channels channels (1 or 3)
+template <typename Distance, typename Aggregation>
+ProfileCostFunction profileCostFunction(int channels);
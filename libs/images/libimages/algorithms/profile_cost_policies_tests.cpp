@@ -0,0 +1,94 @@
+#include "profile_cost_policies.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+#include <libbase/stats.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+std::vector<color8u> randomProfile(FastRandom &r, int n, int channels, int maxValue) {
+    std::vector<color8u> colors;
+    for (int i = 0; i < n; ++i) {
+        const auto v = [&]() { return static_cast<std::uint8_t>(r.nextInt(0, maxValue)); };
+        if (channels == 1) {
+            colors.emplace_back(v());
+        } else {
+            const std::uint8_t x = v(), y = v(), z = v();
+            colors.emplace_back(x, y, z);
+        }
+    }
+    return colors;
+}
+
+std::vector<int> referenceDistances(const std::vector<color8u> &a, const std::vector<color8u> &b, bool squared) {
+    std::vector<int> res;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int d = 0;
+        for (int c = 0; c < a[i].channels(); ++c) {
+            const int diff = int(a[i].at(c)) - int(b[i].at(c));
+            d += squared ? diff * diff : std::abs(diff);
+        }
+        res.push_back(d);
+    }
+    return res;
+}
+
+double referenceTrimmedMean(std::vector<int> values, int percent) {
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    const size_t trim = std::min(n * percent / 100, (n - 1) / 2);
+    double sum = 0.0;
+    for (size_t i = trim; i < n - trim; ++i) sum += values[i];
+    return sum / static_cast<double>(n - 2 * trim);
+}
+
+template <typename Distance>
+void checkAggregations(bool squared) {
+    using namespace profile_cost;
+    FastRandom r(squared ? 29 : 31);
+    for (int n : {1, 2, 3, 10, 99, 1000, 1500}) {
+        for (int channels : {1, 3}) {
+            for (int maxValue : {3, 255}) {
+                const std::vector<color8u> a = randomProfile(r, n, channels, maxValue);
+                const std::vector<color8u> b = randomProfile(r, n, channels, maxValue);
+                const PlanarProfile8u pa = toPlanarProfile(a);
+                const PlanarProfile8u pb = toPlanarProfile(b);
+                const std::vector<int> d = referenceDistances(a, b, squared);
+
+                const ProfileCostFunction median = profileCostFunction<Distance, Median>(channels);
+                const ProfileCostFunction p75 = profileCostFunction<Distance, Percentile<75>>(channels);
+                const ProfileCostFunction mean = profileCostFunction<Distance, Mean>(channels);
+                const ProfileCostFunction trimmed = profileCostFunction<Distance, TrimmedMean<10>>(channels);
+                EXPECT_EQ(median(pa, pb), stats::median(d)) << n;
+                EXPECT_EQ(p75(pa, pb), stats::percentile(d, 75)) << n;
+                EXPECT_DOUBLE_EQ(mean(pa, pb), stats::sum(d) / n) << n;
+                EXPECT_DOUBLE_EQ(trimmed(pa, pb), referenceTrimmedMean(d, 10)) << n;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(profile_cost_policies, l1Aggregations) {
+    checkAggregations<profile_cost::L1>(false);
+}
+
+TEST(profile_cost_policies, l2Aggregations) {
+    checkAggregations<profile_cost::L2>(true);
+}
+
+TEST(profile_cost_policies, l1MedianMatchesProfileCost) {
+    FastRandom r(37);
+    for (int n : {5, 256, 300}) {
+        const PlanarProfile8u a = toPlanarProfile(randomProfile(r, n, 3, 255));
+        const PlanarProfile8u b = toPlanarProfile(randomProfile(r, n, 3, 255));
+        using Policy = profile_cost::Policy<profile_cost::L1, profile_cost::Median, 3>;
+        EXPECT_EQ(evaluateProfileCost<Policy>(a, b), profileCost(a, b).median);
+    }
+}
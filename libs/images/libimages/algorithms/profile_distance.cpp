@@ -0,0 +1,279 @@
+#include "profile_distance.h"
+
+#include "profile_kernels.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+constexpr int kChunk = 256;
+constexpr int kBoundCheckStep = 64; // early abandon granularity, two iterations of the AVX2 kernel
+constexpr int kMaxDifference = 255 * Color<std::uint8_t>::max_channels;
+
+void checkComparable(const PlanarProfileView &a, const PlanarProfileView &b) {
+    rassert(a.length == b.length, 63748201001, a.length, b.length);
+    rassert(a.channels == b.channels, 63748201002, a.channels, b.channels);
+    rassert(a.length > 0, 63748201003);
+}
+
+// Calls f(chunk, from, count) for consecutive chunks of at most step differences while f returns true,
+// returns false if f stopped the iteration
+template <typename F>
+bool forEachDifferencesChunkWhile(const PlanarProfileView &a, const PlanarProfileView &b, int step, F f) {
+    const profile_kernels::Kernels &kernels = profile_kernels::best();
+    std::array<const std::uint8_t *, Color<std::uint8_t>::max_channels> pa{}, pb{};
+    std::array<std::uint16_t, kChunk> chunk{};
+    for (int from = 0; from < a.length; from += step) {
+        const int count = std::min(step, a.length - from);
+        for (int c = 0; c < a.channels; ++c) {
+            pa[c] = a.channel(c) + from;
+            pb[c] = b.channel(c) + from;
+        }
+        kernels.differences(pa.data(), pb.data(), a.channels, count, chunk.data());
+        if (!f(chunk.data(), from, count)) return false;
+    }
+    return true;
+}
+
+template <typename F>
+void forEachDifferencesChunk(const PlanarProfileView &a, const PlanarProfileView &b, F f) {
+    forEachDifferencesChunkWhile(a, b, kChunk, [&](const std::uint16_t *chunk, int from, int count) {
+        f(chunk, from, count);
+        return true;
+    });
+}
+
+// the same interpolation as stats::percentile: between ranks floor(pos) and ceil(pos), pos = (n - 1) / 2
+template <typename ValueOfRank>
+double interpolatedMedian(std::size_t n, ValueOfRank valueOfRank) {
+    const double pos = 0.5 * static_cast<double>(n - 1);
+    const std::size_t i = static_cast<std::size_t>(std::floor(pos));
+    const std::size_t j = std::min(n - 1, static_cast<std::size_t>(std::ceil(pos)));
+    const double va = valueOfRank(i);
+    return (j == i) ? va : va + (pos - static_cast<double>(i)) * (valueOfRank(j) - va);
+}
+
+double histogramMedian(const std::array<int, kMaxDifference + 1> &counts, std::size_t n) {
+    return interpolatedMedian(n, [&](std::size_t rank) {
+        std::size_t below = 0;
+        int v = 0;
+        while (below + counts[v] <= rank) below += counts[v++];
+        return static_cast<double>(v);
+    });
+}
+
+// All-pairs matrices are computed by tiles of block x block pairs, so that the rows of both blocks stay in L2
+// while every pair of them is compared, instead of streaming all rows of b past each row of a
+constexpr std::size_t kMatrixBlockBytes = 64 * 1024;
+constexpr int kMatrixMaxBlockRows = 128;
+// Rows of a compared with each row of b inside a tile: together they fit into L1 next to the row of b
+constexpr int kMatrixMicroRows = 4;
+
+struct MatrixTile {
+    int fromA, toA;
+    int fromB, toB;
+};
+
+int matrixBlockRows(const PlanarProfileMatrix8u &m) {
+    const std::size_t rowBytes = static_cast<std::size_t>(m.channels) * static_cast<std::size_t>(m.length);
+    const std::size_t rows = kMatrixBlockBytes / std::max<std::size_t>(1, rowBytes);
+    return static_cast<int>(std::clamp<std::size_t>(rows, kMatrixMicroRows, kMatrixMaxBlockRows));
+}
+
+// res[i * b.rows + j] for the pairs of the tile; symmetric - only j >= i, mirrored to res[j * b.rows + i]
+void medianTile(const PlanarProfileMatrix8u &a, const PlanarProfileMatrix8u &b, const MatrixTile &tile, bool symmetric, double *res) {
+    const std::size_t stride = static_cast<std::size_t>(b.rows);
+    for (int i0 = tile.fromA; i0 < tile.toA; i0 += kMatrixMicroRows) {
+        const int i1 = std::min(tile.toA, i0 + kMatrixMicroRows);
+        for (int j = tile.fromB; j < tile.toB; ++j) {
+            const PlanarProfileView rowB = b.row(j);
+            for (int i = i0; i < i1; ++i) {
+                if (symmetric && j < i) continue;
+                const double median = profileCost(a.row(i), rowB).median;
+                res[static_cast<std::size_t>(i) * stride + j] = median;
+                if (symmetric) res[static_cast<std::size_t>(j) * stride + i] = median;
+            }
+        }
+    }
+}
+
+} // namespace
+
+PlanarProfileMatrix8u::PlanarProfileMatrix8u(int rows, int length, int channels)
+    : rows(rows), length(length), channels(channels),
+      data(static_cast<std::size_t>(rows) * static_cast<std::size_t>(channels) * static_cast<std::size_t>(length)) {
+    rassert(rows >= 0 && length > 0 && (channels == 1 || channels == 3), 63748201005, rows, length, channels);
+}
+
+void PlanarProfileMatrix8u::setRow(int r, const std::vector<color8u> &colors) {
+    rassert(r >= 0 && r < rows, 63748201006, r, rows);
+    rassert(static_cast<int>(colors.size()) == length, 63748201007, colors.size(), length);
+    std::uint8_t *dst = data.data() + static_cast<std::size_t>(r) * channels * length;
+    for (int i = 0; i < length; ++i) {
+        rassert(colors[i].channels() == channels, 63748201008, colors[i].channels(), channels);
+        for (int c = 0; c < channels; ++c) {
+            dst[static_cast<std::size_t>(c) * length + i] = colors[i].at(c);
+        }
+    }
+}
+
+PlanarProfile8u toPlanarProfile(const std::vector<color8u> &colors) {
+    PlanarProfile8u res;
+    res.length = static_cast<int>(colors.size());
+    res.channels = colors.empty() ? 0 : colors[0].channels();
+    res.data.resize(static_cast<std::size_t>(res.length) * res.channels);
+    for (int i = 0; i < res.length; ++i) {
+        rassert(colors[i].channels() == res.channels, 63748201004, colors[i].channels(), res.channels);
+        for (int c = 0; c < res.channels; ++c) {
+            res.data[static_cast<std::size_t>(c) * res.length + i] = colors[i].at(c);
+        }
+    }
+    return res;
+}
+
+std::vector<color8u> toColors(PlanarProfileView profile) {
+    std::vector<color8u> colors;
+    colors.reserve(static_cast<std::size_t>(profile.length));
+    for (int i = 0; i < profile.length; ++i) {
+        if (profile.channels == 1) {
+            colors.emplace_back(profile.channel(0)[i]);
+        } else {
+            colors.emplace_back(profile.channel(0)[i], profile.channel(1)[i], profile.channel(2)[i]);
+        }
+    }
+    return colors;
+}
+
+void profileDifferences(PlanarProfileView a, PlanarProfileView b, std::vector<int> &out) {
+    checkComparable(a, b);
+    out.resize(static_cast<std::size_t>(a.length));
+    forEachDifferencesChunk(a, b, [&](const std::uint16_t *chunk, int from, int count) {
+        std::copy(chunk, chunk + count, out.begin() + from);
+    });
+}
+
+ProfileCost profileCost(PlanarProfileView a, PlanarProfileView b) {
+    checkComparable(a, b);
+    const std::size_t n = static_cast<std::size_t>(a.length);
+    ProfileCost res;
+
+    if (a.length <= kChunk) {
+        // a short profile fits into one chunk: selecting in it is cheaper than clearing a histogram
+        forEachDifferencesChunk(a, b, [&](const std::uint16_t *chunk, int, int count) {
+            std::array<std::uint16_t, kChunk> values;
+            std::copy(chunk, chunk + count, values.begin());
+            double sum = 0.0;
+            for (int i = 0; i < count; ++i) sum += values[i];
+            std::size_t selected = n;
+            res.median = interpolatedMedian(n, [&](std::size_t rank) {
+                if (selected == n) {
+                    std::nth_element(values.begin(), values.begin() + rank, values.begin() + count);
+                } else {
+                    // the next rank is the minimum of the values above the selected one
+                    std::nth_element(values.begin() + selected + 1, values.begin() + rank, values.begin() + count);
+                }
+                selected = rank;
+                return static_cast<double>(values[rank]);
+            });
+            res.mean = sum / static_cast<double>(n);
+        });
+        return res;
+    }
+
+    std::array<int, kMaxDifference + 1> counts{};
+    double sum = 0.0;
+    forEachDifferencesChunk(a, b, [&](const std::uint16_t *chunk, int, int count) {
+        for (int i = 0; i < count; ++i) {
+            ++counts[chunk[i]];
+            sum += chunk[i];
+        }
+    });
+    res.median = histogramMedian(counts, n);
+    res.mean = sum / static_cast<double>(n);
+    return res;
+}
+
+bool profileMedianWithBound(PlanarProfileView a, PlanarProfileView b, double bound, double &median, int *samples) {
+    checkComparable(a, b);
+    const std::size_t n = static_cast<std::size_t>(a.length);
+
+    // the median is not less than the value of rank floor((n - 1) / 2), and that value exceeds the bound
+    // as soon as at least n - floor((n - 1) / 2) values exceed it
+    const std::size_t rank = static_cast<std::size_t>(std::floor(0.5 * static_cast<double>(n - 1)));
+    const std::size_t abandonAbove = n - rank;
+    std::array<int, kMaxDifference + 1> counts{};
+    std::size_t above = 0;
+    const bool complete = forEachDifferencesChunkWhile(a, b, kBoundCheckStep, [&](const std::uint16_t *chunk, int from, int count) {
+        for (int i = 0; i < count; ++i) {
+            ++counts[chunk[i]];
+            above += chunk[i] > bound ? 1 : 0;
+        }
+        if (samples) *samples = from + count;
+        return above < abandonAbove;
+    });
+    if (!complete) return false;
+    median = histogramMedian(counts, n);
+    return true;
+}
+
+bool profileMeanWithBound(PlanarProfileView a, PlanarProfileView b, double bound, double &mean) {
+    checkComparable(a, b);
+    const double n = static_cast<double>(a.length);
+    // partial sums only grow (compared as sum / n, so that a full sum within the bound is never abandoned by rounding)
+    double sum = 0.0;
+    const bool complete = forEachDifferencesChunkWhile(a, b, kBoundCheckStep, [&](const std::uint16_t *chunk, int, int count) {
+        for (int i = 0; i < count; ++i) sum += chunk[i];
+        return sum / n <= bound;
+    });
+    if (!complete) return false;
+    mean = sum / n;
+    return true;
+}
+
+std::vector<double> profileMedianMatrix(const PlanarProfileMatrix8u &a, const PlanarProfileMatrix8u &b, bool with_openmp) {
+    rassert(a.length == b.length && a.channels == b.channels, 63748201009, a.length, b.length);
+    std::vector<double> res(static_cast<std::size_t>(a.rows) * static_cast<std::size_t>(b.rows));
+
+    const int block = matrixBlockRows(a);
+    std::vector<MatrixTile> tiles;
+    for (int i = 0; i < a.rows; i += block) {
+        for (int j = 0; j < b.rows; j += block) {
+            tiles.push_back({i, std::min(a.rows, i + block), j, std::min(b.rows, j + block)});
+        }
+    }
+
+    const int tilesCount = static_cast<int>(tiles.size());
+    #pragma omp parallel for schedule(dynamic, 1) if(with_openmp)
+    for (int t = 0; t < tilesCount; ++t) {
+        medianTile(a, b, tiles[t], false, res.data());
+    }
+    return res;
+}
+
+std::vector<double> profileMedianMatrixSymmetric(const PlanarProfileMatrix8u &a, const PlanarProfileMatrix8u &b, bool with_openmp) {
+    rassert(a.length == b.length && a.channels == b.channels, 63748201010, a.length, b.length);
+    rassert(a.rows == b.rows, 63748201011, a.rows, b.rows);
+    const int rows = a.rows;
+    std::vector<double> res(static_cast<std::size_t>(rows) * static_cast<std::size_t>(rows));
+
+    // only the tiles on and above the diagonal, each pair j >= i is in exactly one of them
+    const int block = matrixBlockRows(a);
+    std::vector<MatrixTile> tiles;
+    for (int i = 0; i < rows; i += block) {
+        for (int j = i; j < rows; j += block) {
+            tiles.push_back({i, std::min(rows, i + block), j, std::min(rows, j + block)});
+        }
+    }
+
+    const int tilesCount = static_cast<int>(tiles.size());
+    #pragma omp parallel for schedule(dynamic, 1) if(with_openmp)
+    for (int t = 0; t < tilesCount; ++t) {
+        medianTile(a, b, tiles[t], true, res.data());
+    }
+    return res;
+}
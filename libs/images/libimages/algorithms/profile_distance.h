@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <libimages/color.h>
+
+struct PlanarProfile8u;
+
+// Side profile with planar channels: channel c of sample i is data[c * length + i],
+// so that kernels compare many samples per instruction
+struct PlanarProfileView final {
+    int length = 0;
+    int channels = 0;
+    const std::uint8_t *data = nullptr;
+
+    PlanarProfileView() = default;
+    PlanarProfileView(const std::uint8_t *data, int length, int channels) noexcept : length(length), channels(channels), data(data) {}
+    PlanarProfileView(const PlanarProfile8u &profile) noexcept;
+
+    const std::uint8_t *channel(int c) const noexcept { return data + static_cast<std::size_t>(c) * length; }
+};
+
+struct PlanarProfile8u final {
+    int length = 0;
+    int channels = 0;
+    std::vector<std::uint8_t> data;
+
+    const std::uint8_t *channel(int c) const noexcept { return data.data() + static_cast<std::size_t>(c) * length; }
+};
+
+inline PlanarProfileView::PlanarProfileView(const PlanarProfile8u &profile) noexcept
+    : PlanarProfileView(profile.data.data(), profile.length, profile.channels) {}
+
+// Many profiles of the same length in one contiguous buffer, row r is a planar profile at data[r * channels * length]
+struct PlanarProfileMatrix8u final {
+    int rows = 0;
+    int length = 0;
+    int channels = 0;
+    std::vector<std::uint8_t> data;
+
+    PlanarProfileMatrix8u() = default;
+    PlanarProfileMatrix8u(int rows, int length, int channels);
+
+    PlanarProfileView row(int r) const noexcept {
+        return {data.data() + static_cast<std::size_t>(r) * channels * length, length, channels};
+    }
+    std::uint8_t *rowData(int r) noexcept { return data.data() + static_cast<std::size_t>(r) * channels * length; }
+    // colors must have exactly length samples with channels channels
+    void setRow(int r, const std::vector<color8u> &colors);
+};
+
+PlanarProfile8u toPlanarProfile(const std::vector<color8u> &colors);
+std::vector<color8u> toColors(PlanarProfileView profile);
+
+// out[i] = sum over channels of |a - b| of sample i, profiles must have the same length and channels
+void profileDifferences(PlanarProfileView a, PlanarProfileView b, std::vector<int> &out);
+
+struct ProfileCost final {
+    double median = 0.0; // same as stats::median of profileDifferences
+    double mean = 0.0;
+};
+
+// Statistics of profileDifferences without materializing them (differences go straight into a histogram)
+ProfileCost profileCost(PlanarProfileView a, PlanarProfileView b);
+
+// Early abandon: false if the statistic is surely greater than bound (the profiles are not compared to the end),
+// otherwise true and exactly the same value as profileCost. samples (if any) gets the number of samples compared.
+bool profileMedianWithBound(PlanarProfileView a, PlanarProfileView b, double bound, double &median, int *samples = nullptr);
+bool profileMeanWithBound(PlanarProfileView a, PlanarProfileView b, double bound, double &mean);
+
+// Dense res[i * b.rows + j] = profileCost(a.row(i), b.row(j)).median, computed by cache-sized tiles of rows of a
+// against rows of b (in parallel over tiles), so that large matrices do not stream all of b past each row of a
+std::vector<double> profileMedianMatrix(const PlanarProfileMatrix8u &a, const PlanarProfileMatrix8u &b, bool with_openmp = true);
+
+// Same as profileMedianMatrix(a, b) when b.row(j) is a.row(j) reversed: then both (i, j) and (j, i) compare
+// the same two profiles from opposite ends and have equal medians, so only j >= i are computed
+std::vector<double> profileMedianMatrixSymmetric(const PlanarProfileMatrix8u &a, const PlanarProfileMatrix8u &b, bool with_openmp = true);
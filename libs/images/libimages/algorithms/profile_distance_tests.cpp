@@ -0,0 +1,187 @@
+#include "profile_distance.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+#include <libbase/stats.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+std::vector<color8u> randomProfile(FastRandom &r, int n, int channels, int maxValue) {
+    std::vector<color8u> colors;
+    for (int i = 0; i < n; ++i) {
+        if (channels == 1) {
+            colors.emplace_back(static_cast<std::uint8_t>(r.nextInt(0, maxValue)));
+        } else {
+            colors.emplace_back(static_cast<std::uint8_t>(r.nextInt(0, maxValue)),
+                                static_cast<std::uint8_t>(r.nextInt(0, maxValue)),
+                                static_cast<std::uint8_t>(r.nextInt(0, maxValue)));
+        }
+    }
+    return colors;
+}
+
+std::vector<int> referenceDifferences(const std::vector<color8u> &a, const std::vector<color8u> &b) {
+    std::vector<int> res;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int d = 0;
+        for (int c = 0; c < a[i].channels(); ++c) d += std::abs(int(a[i].at(c)) - int(b[i].at(c)));
+        res.push_back(d);
+    }
+    return res;
+}
+
+} // namespace
+
+TEST(profile_distance, planarLayout) {
+    const std::vector<color8u> colors = {color8u(1, 2, 3), color8u(4, 5, 6)};
+    const PlanarProfile8u p = toPlanarProfile(colors);
+    EXPECT_EQ(p.length, 2);
+    EXPECT_EQ(p.channels, 3);
+    EXPECT_EQ(p.data, (std::vector<std::uint8_t>{1, 4, 2, 5, 3, 6}));
+    EXPECT_EQ(p.channel(2)[1], 6);
+}
+
+TEST(profile_distance, matchesReferenceStatistics) {
+    FastRandom r(11);
+    for (int n : {1, 2, 3, 10, 255, 256, 257, 1000}) {
+        for (int channels : {1, 3}) {
+            // small value range makes a lot of equal differences (ties at the median)
+            for (int maxValue : {3, 255}) {
+                const std::vector<color8u> a = randomProfile(r, n, channels, maxValue);
+                const std::vector<color8u> b = randomProfile(r, n, channels, maxValue);
+                const std::vector<int> expected = referenceDifferences(a, b);
+
+                const PlanarProfile8u pa = toPlanarProfile(a);
+                const PlanarProfile8u pb = toPlanarProfile(b);
+                std::vector<int> differences;
+                profileDifferences(pa, pb, differences);
+                EXPECT_EQ(differences, expected);
+
+                const ProfileCost cost = profileCost(pa, pb);
+                EXPECT_EQ(cost.median, stats::median(expected)) << "n=" << n;
+                EXPECT_DOUBLE_EQ(cost.mean, stats::sum(expected) / n) << "n=" << n;
+            }
+        }
+    }
+}
+
+TEST(profile_distance, toColorsRoundTrip) {
+    FastRandom r(3);
+    for (int channels : {1, 3}) {
+        const std::vector<color8u> colors = randomProfile(r, 17, channels, 255);
+        const std::vector<color8u> back = toColors(toPlanarProfile(colors));
+        ASSERT_EQ(back.size(), colors.size());
+        for (size_t i = 0; i < colors.size(); ++i) EXPECT_TRUE(back[i] == colors[i]);
+    }
+}
+
+TEST(profile_distance, medianMatrixMatchesPairwiseCosts) {
+    FastRandom r(13);
+    for (int length : {16, 300}) {
+        const int rowsA = 5;
+        const int rowsB = 7;
+        PlanarProfileMatrix8u a(rowsA, length, 3), b(rowsB, length, 3);
+        std::vector<PlanarProfile8u> profilesA, profilesB;
+        for (int i = 0; i < rowsA; ++i) {
+            const std::vector<color8u> colors = randomProfile(r, length, 3, 255);
+            a.setRow(i, colors);
+            profilesA.push_back(toPlanarProfile(colors));
+        }
+        for (int j = 0; j < rowsB; ++j) {
+            const std::vector<color8u> colors = randomProfile(r, length, 3, 255);
+            b.setRow(j, colors);
+            profilesB.push_back(toPlanarProfile(colors));
+        }
+
+        for (bool with_openmp : {false, true}) {
+            const std::vector<double> medians = profileMedianMatrix(a, b, with_openmp);
+            ASSERT_EQ(medians.size(), static_cast<size_t>(rowsA * rowsB));
+            for (int i = 0; i < rowsA; ++i) {
+                for (int j = 0; j < rowsB; ++j) {
+                    EXPECT_EQ(medians[i * rowsB + j], profileCost(profilesA[i], profilesB[j]).median);
+                }
+            }
+        }
+    }
+}
+
+TEST(profile_distance, symmetricMedianMatrixForReversedRows) {
+    FastRandom r(17);
+    for (int length : {9, 300}) {
+        const int rows = 6;
+        PlanarProfileMatrix8u a(rows, length, 3), b(rows, length, 3);
+        for (int i = 0; i < rows; ++i) {
+            std::vector<color8u> colors = randomProfile(r, length, 3, 255);
+            a.setRow(i, colors);
+            std::reverse(colors.begin(), colors.end());
+            b.setRow(i, colors);
+        }
+        for (bool with_openmp : {false, true}) {
+            EXPECT_EQ(profileMedianMatrixSymmetric(a, b, with_openmp), profileMedianMatrix(a, b, with_openmp));
+        }
+    }
+}
+
+TEST(profile_distance, medianMatricesAcrossTileEdges) {
+    // short rows make blocks of the maximal height, so that these sizes have partial tiles and partial micro tiles
+    FastRandom r(23);
+    const int length = 5;
+    for (int rows : {1, 130, 261}) {
+        PlanarProfileMatrix8u a(rows, length, 1), b(rows, length, 1), reversed(rows, length, 1);
+        std::vector<PlanarProfile8u> profilesA, profilesB;
+        for (int i = 0; i < rows; ++i) {
+            std::vector<color8u> colors = randomProfile(r, length, 1, 255);
+            a.setRow(i, colors);
+            profilesA.push_back(toPlanarProfile(colors));
+            std::reverse(colors.begin(), colors.end());
+            reversed.setRow(i, colors);
+            colors = randomProfile(r, length, 1, 255);
+            b.setRow(i, colors);
+            profilesB.push_back(toPlanarProfile(colors));
+        }
+        const std::vector<double> medians = profileMedianMatrix(a, b);
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < rows; ++j) {
+                ASSERT_EQ(medians[i * rows + j], profileCost(profilesA[i], profilesB[j]).median) << i << " " << j;
+            }
+        }
+        EXPECT_EQ(profileMedianMatrixSymmetric(a, reversed), profileMedianMatrix(a, reversed, false));
+    }
+}
+
+TEST(profile_distance, boundedCostsAbandonOnlyAboveBound) {
+    FastRandom r(19);
+    for (int n : {1, 2, 63, 64, 65, 300}) {
+        for (int maxValue : {3, 255}) {
+            const PlanarProfile8u a = toPlanarProfile(randomProfile(r, n, 3, maxValue));
+            const PlanarProfile8u b = toPlanarProfile(randomProfile(r, n, 3, maxValue));
+            const ProfileCost cost = profileCost(a, b);
+            for (double bound : {-1.0, 0.0, cost.median - 0.5, cost.median, cost.median + 0.5, cost.mean - 1.0, cost.mean, 1000.0}) {
+                double median = -1.0;
+                int samples = -1;
+                if (profileMedianWithBound(a, b, bound, median, &samples)) {
+                    EXPECT_EQ(median, cost.median) << "n=" << n << " bound=" << bound;
+                    EXPECT_EQ(samples, n);
+                } else {
+                    EXPECT_GT(cost.median, bound) << "n=" << n;
+                    EXPECT_GT(samples, 0);
+                    EXPECT_LE(samples, n);
+                }
+                if (cost.median <= bound) EXPECT_TRUE(profileMedianWithBound(a, b, bound, median));
+
+                double mean = -1.0;
+                if (profileMeanWithBound(a, b, bound, mean)) {
+                    EXPECT_DOUBLE_EQ(mean, cost.mean) << "n=" << n << " bound=" << bound;
+                } else {
+                    EXPECT_GT(cost.mean, bound) << "n=" << n;
+                }
+                if (cost.mean <= bound) EXPECT_TRUE(profileMeanWithBound(a, b, bound, mean));
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#include "profile_kernels.h"
+
+#include <libbase/cpu_features.h>
+
+#include <algorithm>
+
+namespace profile_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// profile_kernels_avx2.cpp (compiled with AVX2 enabled)
+const Kernels &avx2Kernels();
+#endif
+#if defined(LIBIMAGES_WITH_AVX512)
+// profile_kernels_avx512.cpp (compiled with AVX-512 enabled)
+const Kernels &avx512Kernels();
+#endif
+
+namespace {
+
+void differencesScalar(const std::uint8_t *const *a, const std::uint8_t *const *b, int channels, int n, std::uint16_t *out) {
+    std::fill(out, out + n, std::uint16_t(0));
+    for (int c = 0; c < channels; ++c) {
+        const std::uint8_t *pa = a[c];
+        const std::uint8_t *pb = b[c];
+        for (int i = 0; i < n; ++i) {
+            const std::uint8_t hi = std::max(pa[i], pb[i]);
+            const std::uint8_t lo = std::min(pa[i], pb[i]);
+            out[i] = static_cast<std::uint16_t>(out[i] + (hi - lo));
+        }
+    }
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", differencesScalar};
+    return kernels;
+}
+
+const Kernels *avx2() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2) return &avx2Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels *avx512() {
+#if defined(LIBIMAGES_WITH_AVX512)
+    if (cpuFeatures().avx512) return &avx512Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = avx512() ? *avx512() : avx2() ? *avx2() : scalar();
+    return kernels;
+}
+
+} // namespace profile_kernels
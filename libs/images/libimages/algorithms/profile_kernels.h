@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Kernels behind profileDifferences/profileCost, one implementation per instruction set (picked at runtime by CPU features).
+// Differences are exact integers, so all implementations give identical results.
+namespace profile_kernels {
+
+// out[i] = sum_c |a[c][i] - b[c][i]| for i in [0, n), c in [0, channels)
+using DifferencesFn = void (*)(const std::uint8_t *const *a, const std::uint8_t *const *b, int channels, int n, std::uint16_t *out);
+
+struct Kernels {
+    const char *name;
+    DifferencesFn differences;
+};
+
+// Portable loops (auto-vectorized by compiler for the baseline instruction set, f.e. SSE2 or NEON)
+const Kernels &scalar();
+// nullptr if not compiled in or not supported by current CPU
+const Kernels *avx2();
+const Kernels *avx512(); // AVX-512 F, BW and VL
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace profile_kernels
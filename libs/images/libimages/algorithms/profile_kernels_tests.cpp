@@ -0,0 +1,81 @@
+#include "profile_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint8_t> randomBytes(FastRandom &r, int n) {
+    std::vector<std::uint8_t> v(static_cast<size_t>(n));
+    for (std::uint8_t &x : v) x = static_cast<std::uint8_t>(r.nextInt(0, 255));
+    return v;
+}
+
+} // namespace
+
+TEST(profile_kernels, bestIsAvailable) {
+    const profile_kernels::Kernels &best = profile_kernels::best();
+    EXPECT_NE(best.differences, nullptr);
+    std::cout << "profile kernels: " << best.name << std::endl;
+}
+
+TEST(profile_kernels, scalarIsSumOfAbsoluteDifferences) {
+    const std::uint8_t a0[] = {0, 255, 10, 200};
+    const std::uint8_t a1[] = {0, 255, 20, 100};
+    const std::uint8_t b0[] = {255, 0, 10, 100};
+    const std::uint8_t b1[] = {255, 0, 25, 200};
+    const std::uint8_t *a[] = {a0, a1};
+    const std::uint8_t *b[] = {b0, b1};
+    std::uint16_t out[4] = {};
+    profile_kernels::scalar().differences(a, b, 2, 4, out);
+    EXPECT_EQ(out[0], 510);
+    EXPECT_EQ(out[1], 510);
+    EXPECT_EQ(out[2], 5);
+    EXPECT_EQ(out[3], 200);
+}
+
+namespace {
+
+void expectMatchesScalarExactly(const profile_kernels::Kernels *simd) {
+    const profile_kernels::Kernels &scalar = profile_kernels::scalar();
+
+    FastRandom r(7);
+    for (int n : {1, 15, 31, 32, 33, 63, 64, 65, 100, 257}) {
+        for (int channels : {1, 3}) {
+            std::vector<std::vector<std::uint8_t>> aData, bData;
+            std::vector<const std::uint8_t *> a, b;
+            for (int c = 0; c < channels; ++c) {
+                aData.push_back(randomBytes(r, n));
+                bData.push_back(randomBytes(r, n));
+            }
+            for (int c = 0; c < channels; ++c) {
+                a.push_back(aData[c].data());
+                b.push_back(bData[c].data());
+            }
+
+            std::vector<std::uint16_t> x(static_cast<size_t>(n)), y(static_cast<size_t>(n));
+            scalar.differences(a.data(), b.data(), channels, n, x.data());
+            simd->differences(a.data(), b.data(), channels, n, y.data());
+            EXPECT_EQ(x, y) << "n=" << n << " channels=" << channels;
+        }
+    }
+}
+
+} // namespace
+
+TEST(profile_kernels, simdMatchesScalarExactly) {
+    const profile_kernels::Kernels *simd = profile_kernels::avx2();
+    if (!simd) GTEST_SKIP() << "AVX2 kernels are not available";
+    expectMatchesScalarExactly(simd);
+}
+
+TEST(profile_kernels, avx512MatchesScalarExactly) {
+    const profile_kernels::Kernels *simd = profile_kernels::avx512();
+    if (!simd) GTEST_SKIP() << "AVX-512 kernels are not available";
+    expectMatchesScalarExactly(simd);
+}
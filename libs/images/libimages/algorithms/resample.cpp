@@ -0,0 +1,240 @@
+#include "resample.h"
+
+#include "downsample.h"
+#include "filter_utils.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using filter_utils::clampi;
+using filter_utils::from_f;
+using filter_utils::Kernel1D;
+using filter_utils::cachedGaussianKernel;
+using filter_utils::to_f;
+
+// Taps == 0 - any kernel size, otherwise the kernel has exactly Taps taps and the loops over taps and channels unroll.
+// Taps are accumulated in the same order either way, so the results are identical.
+template <int Taps, int C, typename T>
+void resampleColors(const std::vector<Color<T>> &colors, int n, int outN, const Kernel1D &k, std::vector<Color<T>> &out) {
+    const int m = static_cast<int>(colors.size());
+    const int R = Taps > 0 ? (Taps - 1) / 2 : k.r;
+    const int taps = Taps > 0 ? Taps : 2 * R + 1;
+    const float* kw = k.w.data();
+
+    for (int i = 0; i < outN; ++i) {
+        const int si = (n >= m) ? i : downsample_source_index(i, n, m);
+        float acc[C] = {};
+        if (si - R >= 0 && si + R < m) {
+            const Color<T>* window = colors.data() + (si - R);
+            for (int d = 0; d < taps; ++d)
+                for (int c = 0; c < C; ++c) acc[c] += kw[d] * to_f(window[d].at(c));
+        } else {
+            for (int d = 0; d < taps; ++d) {
+                const Color<T>& col = colors[static_cast<size_t>(clampi(si + d - R, 0, m - 1))];
+                for (int c = 0; c < C; ++c) acc[c] += kw[d] * to_f(col.at(c));
+            }
+        }
+        if constexpr (C == 1) {
+            out.emplace_back(from_f<T>(acc[0]));
+        } else {
+            out.emplace_back(from_f<T>(acc[0]), from_f<T>(acc[1]), from_f<T>(acc[2]));
+        }
+    }
+}
+
+template <int C, typename T>
+void resampleColors(const std::vector<Color<T>> &colors, int n, int outN, const Kernel1D &k, std::vector<Color<T>> &out) {
+    static_assert(std::size(filter_utils::fixed_gaussian_taps) == 4);
+    constexpr int t0 = filter_utils::fixed_gaussian_taps[0], t1 = filter_utils::fixed_gaussian_taps[1];
+    constexpr int t2 = filter_utils::fixed_gaussian_taps[2], t3 = filter_utils::fixed_gaussian_taps[3];
+    switch (2 * k.r + 1) {
+        case t0: return resampleColors<t0, C>(colors, n, outN, k, out);
+        case t1: return resampleColors<t1, C>(colors, n, outN, k, out);
+        case t2: return resampleColors<t2, C>(colors, n, outN, k, out);
+        case t3: return resampleColors<t3, C>(colors, n, outN, k, out);
+        default: return resampleColors<0, C>(colors, n, outN, k, out);
+    }
+}
+
+// The same taps in the same order as resampleColors, channel by channel over planar samples,
+// sample i is written to dst[i * step] (step -1 - in reverse order)
+template <int Taps, typename T>
+void resamplePlanarChannel(const T *src, int m, int n, int outN, const Kernel1D &k, T *dst, std::ptrdiff_t step) {
+    const int R = Taps > 0 ? (Taps - 1) / 2 : k.r;
+    const int taps = Taps > 0 ? Taps : 2 * R + 1;
+    const float* kw = k.w.data();
+
+    for (int i = 0; i < outN; ++i) {
+        const int si = (n >= m) ? i : downsample_source_index(i, n, m);
+        float acc = 0.0f;
+        if (si - R >= 0 && si + R < m) {
+            const T* window = src + (si - R);
+            for (int d = 0; d < taps; ++d) acc += kw[d] * to_f(window[d]);
+        } else {
+            for (int d = 0; d < taps; ++d) acc += kw[d] * to_f(src[clampi(si + d - R, 0, m - 1)]);
+        }
+        dst[i * step] = from_f<T>(acc);
+    }
+}
+
+template <typename T>
+void resamplePlanarChannel(const T *src, int m, int n, int outN, const Kernel1D &k, T *dst, std::ptrdiff_t step) {
+    constexpr int t0 = filter_utils::fixed_gaussian_taps[0], t1 = filter_utils::fixed_gaussian_taps[1];
+    constexpr int t2 = filter_utils::fixed_gaussian_taps[2], t3 = filter_utils::fixed_gaussian_taps[3];
+    switch (2 * k.r + 1) {
+        case t0: return resamplePlanarChannel<t0>(src, m, n, outN, k, dst, step);
+        case t1: return resamplePlanarChannel<t1>(src, m, n, outN, k, dst, step);
+        case t2: return resamplePlanarChannel<t2>(src, m, n, outN, k, dst, step);
+        case t3: return resamplePlanarChannel<t3>(src, m, n, outN, k, dst, step);
+        default: return resamplePlanarChannel<0>(src, m, n, outN, k, dst, step);
+    }
+}
+
+} // namespace
+
+template <typename T>
+Image<T> resample(const Image<T> &image, int w, int h, float sigma) {
+    return resample(ImageView<const T>(image), w, h, sigma);
+}
+
+template <typename T>
+Image<T> resample(ImageView<const T> image, int w, int h, float sigma) {
+    rassert(w > 0 && h > 0, 781234991);
+
+    const int W = image.width();
+    const int H = image.height();
+    const int C = image.channels();
+    rassert(W > 0 && H > 0, 781234992);
+    rassert(C == 1 || C == 3, 781234993, C);
+
+    const std::shared_ptr<const Kernel1D> kernel = cachedGaussianKernel(sigma);
+    const Kernel1D& k = *kernel;
+    if (k.r == 0) return downsample(image, w, h);
+
+    const int R = k.r;
+    const int taps = 2 * R + 1;
+    const float* kw = k.w.data();
+
+    std::vector<int> sxs(static_cast<size_t>(w));
+    for (int x = 0; x < w; ++x) sxs[x] = downsample_source_index(x, w, W);
+    std::vector<int> sys(static_cast<size_t>(h));
+    for (int y = 0; y < h; ++y) sys[y] = downsample_source_index(y, h, H);
+
+    // Source rows touched by the vertical taps, each one is filtered horizontally once (only at sampled columns)
+    std::vector<int> tmpRow(static_cast<size_t>(H), -1);
+    std::vector<int> rows;
+    for (int y = 0; y < h; ++y) {
+        for (int d = -R; d <= R; ++d) {
+            const int sy = clampi(sys[y] + d, 0, H - 1);
+            if (tmpRow[sy] == -1) {
+                tmpRow[sy] = 0;
+                rows.push_back(sy);
+            }
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    for (size_t i = 0; i < rows.size(); ++i) tmpRow[rows[i]] = static_cast<int>(i);
+
+    // Taps are accumulated in the same order as in blur(), so results are bit-identical
+    const size_t n = static_cast<size_t>(w) * static_cast<size_t>(C);
+    std::vector<float> tmp(rows.size() * n);
+
+    #pragma omp parallel for
+    for (int ri = 0; ri < static_cast<int>(rows.size()); ++ri) {
+        const T* src = image.ptr(rows[ri]);
+        float* dst = tmp.data() + static_cast<size_t>(ri) * n;
+        for (int x = 0; x < w; ++x) {
+            for (int c = 0; c < C; ++c) {
+                float acc = 0.0f;
+                for (int d = 0; d < taps; ++d) {
+                    acc += kw[d] * to_f(src[static_cast<size_t>(clampi(sxs[x] + d - R, 0, W - 1)) * C + c]);
+                }
+                dst[static_cast<size_t>(x) * C + c] = acc;
+            }
+        }
+    }
+
+    Image<T> out(w, h, C, ImageInit::Uninitialized);
+
+    #pragma omp parallel for
+    for (int y = 0; y < h; ++y) {
+        T* dst = out.ptr(y);
+        for (size_t i = 0; i < n; ++i) {
+            float acc = 0.0f;
+            for (int d = 0; d < taps; ++d) {
+                const int sy = clampi(sys[y] + d - R, 0, H - 1);
+                acc += kw[d] * tmp[static_cast<size_t>(tmpRow[sy]) * n + i];
+            }
+            dst[i] = from_f<T>(acc);
+        }
+    }
+
+    return out;
+}
+
+template <typename T>
+std::vector<Color<T>> resample(const std::vector<Color<T>> &colors, int n, float sigma) {
+    if (n <= 0) return {};
+    if (colors.empty()) return {};
+
+    const int m = static_cast<int>(colors.size());
+    const std::shared_ptr<const Kernel1D> kernel = cachedGaussianKernel(sigma);
+    const Kernel1D& k = *kernel;
+    if (k.r == 0) return downsample(colors, n);
+
+    const int C = colors[0].channels();
+    rassert(C == 1 || C == 3, 781234994, C);
+
+    // downsample() keeps all samples if n >= m
+    const int outN = std::min(n, m);
+
+    std::vector<Color<T>> out;
+    out.reserve(static_cast<size_t>(outN));
+    if (C == 1) {
+        resampleColors<1>(colors, n, outN, k, out);
+    } else {
+        resampleColors<3>(colors, n, outN, k, out);
+    }
+    return out;
+}
+
+template <typename T>
+int resamplePlanar(const T *src, int m, int channels, int n, float sigma, T *dst, bool reversed) {
+    rassert(channels == 1 || channels == 3, 781234995, channels);
+    if (n <= 0 || m <= 0) return 0;
+
+    const int outN = std::min(n, m);
+    const std::shared_ptr<const Kernel1D> kernel = cachedGaussianKernel(sigma);
+    const Kernel1D& k = *kernel;
+    for (int c = 0; c < channels; ++c) {
+        const T *channel = src + static_cast<size_t>(c) * m;
+        const std::ptrdiff_t step = reversed ? -1 : 1;
+        T *out = dst + static_cast<size_t>(c) * outN + (reversed ? outN - 1 : 0);
+        if (k.r == 0) {
+            for (int i = 0; i < outN; ++i) out[i * step] = channel[n >= m ? i : downsample_source_index(i, n, m)];
+        } else {
+            resamplePlanarChannel(channel, m, n, outN, k, out, step);
+        }
+    }
+    return outN;
+}
+
+// explicit instantiations
+template Image<std::uint8_t> resample(const Image<std::uint8_t>& image, int w, int h, float sigma);
+template Image<float>        resample(const Image<float>& image, int w, int h, float sigma);
+template Image<std::uint8_t> resample(ImageView<const std::uint8_t> image, int w, int h, float sigma);
+template Image<float>        resample(ImageView<const float> image, int w, int h, float sigma);
+
+template std::vector<Color<std::uint8_t>> resample(const std::vector<Color<std::uint8_t>>& colors, int n, float sigma);
+template std::vector<Color<float>>        resample(const std::vector<Color<float>>& colors, int n, float sigma);
+
+template int resamplePlanar(const std::uint8_t *src, int m, int channels, int n, float sigma, std::uint8_t *dst, bool reversed);
+template int resamplePlanar(const float *src, int m, int channels, int n, float sigma, float *dst, bool reversed);
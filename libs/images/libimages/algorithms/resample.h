@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include <libimages/color.h>
+#include <libimages/image.h>
+#include <libimages/image_view.h>
+
+// Same result as downsample(blur(image, sigma, BlurMethod::Gaussian), w, h), but the Gaussian is evaluated
+// only at the destination sample positions (and only on the source rows they need),
+// so the cost is O(w * h * kernel) instead of O(source pixels * kernel).
+// sigma <= 0 means plain downsample.
+template <typename T>
+Image<T> resample(const Image<T> &image, int w, int h, float sigma);
+
+template <typename T>
+Image<T> resample(ImageView<const T> image, int w, int h, float sigma);
+
+// Same as downsample(blur(colors, sigma, BlurMethod::Gaussian), n)
+template <typename T>
+std::vector<Color<T>> resample(const std::vector<Color<T>> &colors, int n, float sigma);
+
+// Same as resample(colors, n, sigma) for planar samples (channel c of sample i is src[c * m + i]),
+// the min(n, m) resampled samples are written planar to dst (channel c at dst + c * min(n, m)), reversed - last to first
+// (exactly the reverse of the forward result, without a separate pass). Returns min(n, m).
+template <typename T>
+int resamplePlanar(const T *src, int m, int channels, int n, float sigma, T *dst, bool reversed = false);
@@ -0,0 +1,94 @@
+#include "resample.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+#include <libimages/algorithms/blur.h>
+#include <libimages/algorithms/downsample.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+template <typename T>
+Image<T> randomImage(FastRandom &r, int w, int h, int c) {
+    Image<T> img(w, h, c);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            for (int ch = 0; ch < c; ++ch)
+                img(y, x, ch) = static_cast<T>(r.nextInt(0, 255));
+    return img;
+}
+
+} // namespace
+
+TEST(resample, matchesBlurThenDownsample) {
+    FastRandom r(11);
+    for (int channels : {1, 3}) {
+        const image8u src8 = randomImage<std::uint8_t>(r, 97, 61, channels);
+        const image32f src32 = randomImage<float>(r, 97, 61, channels);
+        for (auto [w, h] : {std::pair{1, 1}, std::pair{10, 7}, std::pair{48, 30}, std::pair{97, 61}, std::pair{120, 70}}) {
+            for (float sigma : {0.0f, 0.5f, 1.5f, 4.0f}) {
+                EXPECT_EQ(resample(src8, w, h, sigma).toVector(),
+                          downsample(blur(src8, sigma, BlurMethod::Gaussian), w, h).toVector())
+                        << "c=" << channels << " " << w << "x" << h << " sigma=" << sigma;
+                EXPECT_EQ(resample(src32, w, h, sigma).toVector(),
+                          downsample(blur(src32, sigma, BlurMethod::Gaussian), w, h).toVector())
+                        << "c=" << channels << " " << w << "x" << h << " sigma=" << sigma;
+            }
+        }
+    }
+}
+
+TEST(resample, colorsMatchBlurThenDownsample) {
+    FastRandom r(12);
+    std::vector<color8u> colors;
+    for (int i = 0; i < 150; ++i) {
+        colors.emplace_back(r.nextInt(0, 255), r.nextInt(0, 255), r.nextInt(0, 255));
+    }
+    for (int n : {1, 2, 37, 149, 150, 300}) {
+        for (float sigma : {0.0f, 1.0f, 4.0f}) {
+            const std::vector<color8u> expected = downsample(blur(colors, sigma, BlurMethod::Gaussian), n);
+            const std::vector<color8u> actual = resample(colors, n, sigma);
+            ASSERT_EQ(actual.size(), expected.size()) << "n=" << n;
+            for (size_t i = 0; i < actual.size(); ++i) {
+                EXPECT_EQ(actual[i].toVector(), expected[i].toVector()) << "n=" << n << " sigma=" << sigma << " i=" << i;
+            }
+        }
+    }
+}
+
+TEST(resample, planarMatchesColors) {
+    FastRandom r(13);
+    for (int channels : {1, 3}) {
+        std::vector<color8u> colors;
+        for (int i = 0; i < 150; ++i) {
+            if (channels == 1) {
+                colors.emplace_back(static_cast<std::uint8_t>(r.nextInt(0, 255)));
+            } else {
+                colors.emplace_back(r.nextInt(0, 255), r.nextInt(0, 255), r.nextInt(0, 255));
+            }
+        }
+        std::vector<std::uint8_t> planar(colors.size() * channels);
+        for (size_t i = 0; i < colors.size(); ++i)
+            for (int c = 0; c < channels; ++c) planar[c * colors.size() + i] = colors[i].at(c);
+
+        for (int n : {1, 37, 149, 150, 300}) {
+            for (float sigma : {0.0f, 1.0f, 2.3f, 4.0f}) {
+                const std::vector<color8u> expected = resample(colors, n, sigma);
+                std::vector<std::uint8_t> actual(colors.size() * channels);
+                const int outN = resamplePlanar(planar.data(), static_cast<int>(colors.size()), channels, n, sigma, actual.data());
+                ASSERT_EQ(outN, static_cast<int>(expected.size()));
+                std::vector<std::uint8_t> reversed(colors.size() * channels);
+                ASSERT_EQ(resamplePlanar(planar.data(), static_cast<int>(colors.size()), channels, n, sigma, reversed.data(), true), outN);
+                for (int i = 0; i < outN; ++i)
+                    for (int c = 0; c < channels; ++c) {
+                        ASSERT_EQ(actual[c * outN + i], expected[i].at(c)) << "n=" << n << " sigma=" << sigma << " i=" << i;
+                        ASSERT_EQ(reversed[c * outN + outN - 1 - i], expected[i].at(c)) << "n=" << n << " sigma=" << sigma << " i=" << i;
+                    }
+            }
+        }
+    }
+}
@@ -6,7 +6,7 @@
 #include <cmath>
 #include <cstddef>
 #include <limits>
-#include <queue>
+#include <span>
 #include <tuple>
 #include <vector>
 
@@ -28,21 +28,77 @@ double dist2_point_to_line(point2i p, point2i a, point2i b) {
     return cross2 / static_cast<double>(vv);
 }
 
-struct HeapItem {
-    double cost = 0.0;
-    int idx = -1;
-    std::size_t ver = 0;
+// Binary min-heap of vertex indices keyed by (cost, index) with in-place key updates:
+// every alive vertex has exactly one entry, so there are no stale entries to skip.
+class VertexHeap {
+public:
+    explicit VertexHeap(const std::vector<double>& cost) : cost_(cost), heap_(cost.size()), pos_(cost.size()) {
+        for (int i = 0; i < static_cast<int>(heap_.size()); ++i) heap_[i] = i;
+        std::make_heap(heap_.begin(), heap_.end(), [&](int a, int b) { return less(b, a); });
+        for (int k = 0; k < static_cast<int>(heap_.size()); ++k) pos_[heap_[k]] = k;
+    }
+
+    int top() const { return heap_.front(); }
 
-    bool operator>(const HeapItem& o) const noexcept {
-        if (cost != o.cost) return cost > o.cost;
-        return idx > o.idx;
+    void pop() {
+        const int last = static_cast<int>(heap_.size()) - 1;
+        swapAt(0, last);
+        pos_[heap_.back()] = -1;
+        heap_.pop_back();
+        if (!heap_.empty()) siftDown(0);
     }
-};
 
-} // namespace
+    // Call after cost of i changed
+    void update(int i) {
+        const int k = pos_[i];
+        if (k < 0) return;
+        siftUp(k);
+        siftDown(pos_[i]);
+    }
 
-std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t targetVertexSize) {
-    const int n = contour.size();
+private:
+    bool less(int a, int b) const {
+        if (cost_[a] != cost_[b]) return cost_[a] < cost_[b];
+        return a < b;
+    }
+
+    void swapAt(int k1, int k2) {
+        std::swap(heap_[k1], heap_[k2]);
+        pos_[heap_[k1]] = k1;
+        pos_[heap_[k2]] = k2;
+    }
+
+    void siftUp(int k) {
+        while (k > 0) {
+            const int parent = (k - 1) / 2;
+            if (!less(heap_[k], heap_[parent])) break;
+            swapAt(k, parent);
+            k = parent;
+        }
+    }
+
+    void siftDown(int k) {
+        const int size = static_cast<int>(heap_.size());
+        while (true) {
+            const int l = 2 * k + 1;
+            const int r = l + 1;
+            int best = k;
+            if (l < size && less(heap_[l], heap_[best])) best = l;
+            if (r < size && less(heap_[r], heap_[best])) best = r;
+            if (best == k) break;
+            swapAt(k, best);
+            k = best;
+        }
+    }
+
+    const std::vector<double>& cost_;
+    std::vector<int> heap_;
+    std::vector<int> pos_; // position of vertex in heap_, -1 if removed
+};
+
+// pointAt(i) - point i of a closed contour of n points
+template <typename PointAt>
+std::vector<point2i> simplifyClosedContour(int n, PointAt pointAt, size_t targetVertexSize) {
     std::vector<point2i> result;
 
     // DONE нам дан контур - это зацикленный обход границы объекта по пикселям
@@ -56,12 +112,10 @@ std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t
     // а значит эта вершина и соседние с ней - лежат на одной прямой
     // тогда в конечном итоге останутся вершины на углах
 
-    if (targetVertexSize == 0 || contour.empty()) return {};
-    if (static_cast<size_t>(n) <= targetVertexSize) return contour;
+    if (targetVertexSize == 0 || n == 0) return {};
 
     std::vector<int> prev(n), next(n);
     std::vector<bool> alive(n, true);
-    std::vector<std::size_t> version(n, 0);
 
     for (int i = 0; i < n; ++i) {
         prev[i] = (i - 1 + n) % n;
@@ -69,30 +123,19 @@ std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t
     }
 
     auto compute_cost = [&](int i) -> double {
-        if (!alive[i]) return std::numeric_limits<double>::infinity();
-        const int a = prev[i];
-        const int b = next[i];
-        if (!alive[a] || !alive[b]) return std::numeric_limits<double>::infinity();
-        return dist2_point_to_line(contour[i], contour[a], contour[b]);
+        return dist2_point_to_line(pointAt(i), pointAt(prev[i]), pointAt(next[i]));
     };
 
-    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> pq;
-    for (int i = 0; i < n; ++i) {
-        pq.push(HeapItem{compute_cost(i), i, version[i]});
-    }
+    // Vertices are removed in the order of (cost, index) among alive ones
+    std::vector<double> cost(n);
+    for (int i = 0; i < n; ++i) cost[i] = compute_cost(i);
+    VertexHeap heap(cost);
 
     int aliveCount = n;
 
     while (aliveCount > static_cast<int>(targetVertexSize)) {
-        rassert(!pq.empty(), 71238123);
-
-        HeapItem it = pq.top();
-        pq.pop();
-
-        const int i = it.idx;
-        if (i < 0 || i >= n) continue;
-        if (!alive[i]) continue;
-        if (it.ver != version[i]) continue;
+        const int i = heap.top();
+        heap.pop();
 
         const int a = prev[i];
         const int b = next[i];
@@ -105,10 +148,10 @@ std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t
         prev[b] = a;
 
         // Update neighbors' costs
-        version[a] += 1;
-        version[b] += 1;
-        pq.push(HeapItem{compute_cost(a), a, version[a]});
-        pq.push(HeapItem{compute_cost(b), b, version[b]});
+        cost[a] = compute_cost(a);
+        cost[b] = compute_cost(b);
+        heap.update(a);
+        heap.update(b);
     }
 
     // Collect remaining vertices in contour order starting from the smallest original index still alive.
@@ -125,61 +168,126 @@ std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t
 
     int cur = start;
     do {
-        result.push_back(contour[cur]);
+        result.push_back(pointAt(cur));
         cur = next[cur];
     } while (cur != start && static_cast<int>(result.size()) <= aliveCount + 1);
 
     return result;
 }
 
-std::vector<std::vector<point2i>> splitContourByCorners(
-    const std::vector<point2i> &contour,
-    const std::vector<point2i> &corners)
-{
-    if (contour.empty()) return {};
-    if (corners.empty()) return {contour};
+// Index of the first occurrence of every point in the contour, -1 if there is none
+std::vector<int> firstIndices(const std::vector<point2i> &contour, const std::vector<point2i> &points) {
+    std::vector<int> res;
+    res.reserve(points.size());
+    for (const point2i &p : points) {
+        const auto it = std::find(contour.begin(), contour.end(), p);
+        res.push_back(it == contour.end() ? -1 : static_cast<int>(it - contour.begin()));
+    }
+    return res;
+}
 
-    const int n = static_cast<int>(contour.size());
+// One walk along the chain for all points
+std::vector<int> firstIndices(const ChainContour &contour, const std::vector<point2i> &points) {
+    std::vector<int> res(points.size(), -1);
+    contour.forEach([&](int i, point2i p) {
+        for (size_t k = 0; k < points.size(); ++k) {
+            if (res[k] == -1 && points[k] == p) res[k] = i;
+        }
+    });
+    return res;
+}
 
-    std::vector<int> cornerIdx;
-    cornerIdx.reserve(corners.size());
+// Points [from, to) to out, returns the end of the written ones
+point2i *copyPoints(const std::vector<point2i> &contour, int from, int to, point2i *out) {
+    return std::copy(contour.begin() + from, contour.begin() + to, out);
+}
 
-    for (const auto& c : corners) {
-        int idx = -1;
-        for (int i = 0; i < n; ++i) {
-            if (contour[i] == c) { idx = i; break; }
-        }
-        rassert(idx >= 0, 918273650);
-        cornerIdx.push_back(idx);
+point2i *copyPoints(const ChainContour &contour, int from, int to, point2i *out) {
+    if (from == to) return out;
+    ChainContour::Cursor cursor = contour.cursor(from);
+    for (int i = from; i < to; ++i, cursor.next()) *out++ = cursor.point();
+    return out;
+}
+
+template <typename Contour>
+int splitClosedContour(const Contour &contour, const std::vector<point2i> &corners, std::span<point2i> points, std::span<int> partEnds)
+{
+    if (contour.empty()) return 0;
+
+    const int n = static_cast<int>(contour.size());
+    if (corners.empty()) {
+        rassert(points.size() >= static_cast<size_t>(n) && !partEnds.empty(), 918273652, points.size(), partEnds.size());
+        copyPoints(contour, 0, n, points.data());
+        partEnds[0] = n;
+        return 1;
     }
 
+    std::vector<int> cornerIdx = firstIndices(contour, corners);
+    for (int idx : cornerIdx) rassert(idx >= 0, 918273650);
+
     std::sort(cornerIdx.begin(), cornerIdx.end());
     cornerIdx.erase(std::unique(cornerIdx.begin(), cornerIdx.end()), cornerIdx.end());
 
     rassert(cornerIdx.size() >= 2, 918273651);
 
+    // every part has its both corners, so m parts of a closed contour have n + m points
     const int m = static_cast<int>(cornerIdx.size());
-    std::vector<std::vector<point2i>> parts;
-    parts.reserve(static_cast<size_t>(m));
+    rassert(points.size() >= static_cast<size_t>(n + m) && partEnds.size() >= static_cast<size_t>(m), 918273653,
+            points.size(), partEnds.size(), n, m);
 
+    point2i *out = points.data();
     for (int k = 0; k < m; ++k) {
         const int i = cornerIdx[k];
         const int j = cornerIdx[(k + 1) % m];
 
-        std::vector<point2i> part;
-        part.reserve(static_cast<size_t>(n / m + 4));
-
-        part.push_back(contour[i]);
-
         if (i < j) {
-            for (int t = i + 1; t <= j; ++t) part.push_back(contour[t]);
+            out = copyPoints(contour, i, j + 1, out);
         } else {
-            for (int t = i + 1; t < n; ++t) part.push_back(contour[t]);
-            for (int t = 0; t <= j; ++t) part.push_back(contour[t]);
+            out = copyPoints(contour, i, n, out);
+            out = copyPoints(contour, 0, j + 1, out);
         }
-
-        parts.push_back(std::move(part));
+        partEnds[k] = static_cast<int>(out - points.data());
     }
 
+    return m;
+}
+
+} // namespace
+
+std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t targetVertexSize) {
+    if (contour.size() <= targetVertexSize) return targetVertexSize == 0 ? std::vector<point2i>{} : contour;
+    return simplifyClosedContour(static_cast<int>(contour.size()), [&](int i) { return contour[i]; }, targetVertexSize);
+}
+
+std::vector<point2i> simplifyContour(const ChainContour &contour, size_t targetVertexSize) {
+    if (static_cast<size_t>(contour.size()) <= targetVertexSize) return targetVertexSize == 0 ? std::vector<point2i>{} : contour.toPoints();
+    return simplifyClosedContour(contour.size(), [&](int i) { return contour.at(i); }, targetVertexSize);
+}
+
+int splitContourByCorners(const std::vector<point2i> &contour, const std::vector<point2i> &corners,
+                          std::span<point2i> points, std::span<int> partEnds)
+{
+    return splitClosedContour(contour, corners, points, partEnds);
+}
+
+int splitContourByCorners(const ChainContour &contour, const std::vector<point2i> &corners,
+                          std::span<point2i> points, std::span<int> partEnds)
+{
+    return splitClosedContour(contour, corners, points, partEnds);
+}
+
+std::vector<std::vector<point2i>> splitContourByCorners(
+    const std::vector<point2i> &contour,
+    const std::vector<point2i> &corners)
+{
+    std::vector<point2i> points(contour.size() + corners.size());
+    std::vector<int> partEnds(std::max<size_t>(corners.size(), 1));
+    const int m = splitContourByCorners(contour, corners, points, partEnds);
+
+    std::vector<std::vector<point2i>> parts;
+    parts.reserve(static_cast<size_t>(m));
+    for (int k = 0; k < m; ++k) {
+        parts.emplace_back(points.begin() + (k == 0 ? 0 : partEnds[k - 1]), points.begin() + partEnds[k]);
+    }
     return parts;
 }
@@ -1,9 +1,23 @@
 #pragma once
 
 #include <libbase/point2.h>
+#include <libimages/chain_contour.h>
 
+#include <span>
 #include <vector>
 
 std::vector<point2i> simplifyContour(const std::vector<point2i> &contour, size_t targetVertexSize);
 
 std::vector<std::vector<point2i>> splitContourByCorners(const std::vector<point2i> &contour, const std::vector<point2i> &corners);
+
+// The same parts written one after another into points (at least contour.size() + corners.size() items,
+// neighbouring parts share their corner), the end of part k in points is written to partEnds[k]
+// (at least corners.size() items, one if there are no corners). Returns the number of parts.
+int splitContourByCorners(const std::vector<point2i> &contour, const std::vector<point2i> &corners,
+                          std::span<point2i> points, std::span<int> partEnds);
+
+// The same walking a chain-coded contour directly (simplification reads its vertices with ChainContour::at,
+// splitting copies the parts out with one cursor walk each)
+std::vector<point2i> simplifyContour(const ChainContour &contour, size_t targetVertexSize);
+int splitContourByCorners(const ChainContour &contour, const std::vector<point2i> &corners,
+                          std::span<point2i> points, std::span<int> partEnds);
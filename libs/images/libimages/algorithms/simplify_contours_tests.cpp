@@ -4,10 +4,15 @@
 
 #include <libimages/tests_utils.h>
 #include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
+#include <libbase/runtime_assert.h>
 #include <libimages/debug_io.h>
 #include <libimages/image.h>
 
 #include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
 #include <vector>
 
 namespace {
@@ -147,3 +152,120 @@ TEST(simplify_contours, splitContourByCorners_rectangle_sides) {
         debug_io::dump_image(getUnitCaseDebugDir() + "01_parts.jpg", img);
     }
 }
+
+namespace {
+
+// Previous implementation (lazy priority queue with versions), kept as a reference for vertex removal order
+std::vector<point2i> simplifyContourLazyHeap(const std::vector<point2i> &contour, size_t target) {
+    const int n = contour.size();
+    if (target == 0 || contour.empty()) return {};
+    if (static_cast<size_t>(n) <= target) return contour;
+
+    auto dist2 = [](point2i p, point2i a, point2i b) {
+        const long long vx = b.x - a.x, vy = b.y - a.y, wx = p.x - a.x, wy = p.y - a.y;
+        const long long vv = vx * vx + vy * vy;
+        if (vv == 0) return static_cast<double>(wx * wx + wy * wy);
+        const double cross = static_cast<double>(vx * wy - vy * wx);
+        return cross * cross / static_cast<double>(vv);
+    };
+
+    std::vector<int> prev(n), next(n), version(n, 0);
+    std::vector<bool> alive(n, true);
+    for (int i = 0; i < n; ++i) {
+        prev[i] = (i - 1 + n) % n;
+        next[i] = (i + 1) % n;
+    }
+    using Item = std::tuple<double, int, int>; // cost, idx, version
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+    auto push = [&](int i) { pq.push({dist2(contour[i], contour[prev[i]], contour[next[i]]), i, version[i]}); };
+    for (int i = 0; i < n; ++i) push(i);
+
+    int aliveCount = n;
+    while (aliveCount > static_cast<int>(target)) {
+        auto [c, i, ver] = pq.top();
+        pq.pop();
+        if (!alive[i] || ver != version[i]) continue;
+        alive[i] = false;
+        --aliveCount;
+        const int a = prev[i], b = next[i];
+        next[a] = b;
+        prev[b] = a;
+        ++version[a];
+        ++version[b];
+        push(a);
+        push(b);
+    }
+
+    std::vector<point2i> res;
+    int start = 0;
+    while (!alive[start]) ++start;
+    int cur = start;
+    do {
+        res.push_back(contour[cur]);
+        cur = next[cur];
+    } while (cur != start);
+    return res;
+}
+
+} // namespace
+
+TEST(simplify_contours, simplifyContour_matchesLazyHeapOnNoisyContours) {
+    FastRandom r(239);
+    for (int iter = 0; iter < 30; ++iter) {
+        // jittered rectangle perimeter with bumps, similar to piece contours
+        std::vector<point2i> contour = makeRectContour({10, 10}, {10 + r.nextInt(20, 300), 10 + r.nextInt(20, 300)});
+        for (auto &p : contour) {
+            if (r.nextInt(0, 9) == 0) p.x += r.nextInt(-1, 1);
+            if (r.nextInt(0, 9) == 0) p.y += r.nextInt(-1, 1);
+        }
+        for (size_t target : {size_t(4), size_t(7), size_t(40)}) {
+            EXPECT_EQ(simplifyContour(contour, target), simplifyContourLazyHeap(contour, target)) << iter << " " << target;
+        }
+    }
+}
+
+TEST(simplify_contours, splitContourByCorners_flat_matches_parts) {
+    const auto contour = makeRectContour(point2i{0, 0}, point2i{9, 6});
+    // duplicated and unordered corners
+    const std::vector<point2i> corners = {{8, 5}, {0, 0}, {8, 0}, {0, 0}, {0, 5}};
+    const auto parts = splitContourByCorners(contour, corners);
+    ASSERT_EQ(parts.size(), 4u);
+
+    std::vector<point2i> points(contour.size() + corners.size(), point2i{-1, -1});
+    std::vector<int> partEnds(corners.size(), -1);
+    ASSERT_EQ(splitContourByCorners(contour, corners, points, partEnds), 4);
+    EXPECT_EQ(partEnds[3], static_cast<int>(contour.size()) + 4);
+    for (int k = 0; k < 4; ++k) {
+        const std::vector<point2i> part(points.begin() + (k == 0 ? 0 : partEnds[k - 1]), points.begin() + partEnds[k]);
+        EXPECT_EQ(part, parts[k]) << k;
+    }
+
+    std::vector<point2i> tooSmall(contour.size() + 3);
+    EXPECT_THROW(splitContourByCorners(contour, corners, tooSmall, partEnds), assertion_error);
+}
+
+TEST(simplify_contours, chainContourMatchesPoints) {
+    // staircase-like closed loop of 8-neighbours: a rectangle with a diagonal cut corner
+    std::vector<point2i> contour;
+    for (int x = 0; x < 300; ++x) contour.push_back({x, 0});
+    for (int k = 1; k < 40; ++k) contour.push_back({299 + k, k});
+    for (int y = 40; y < 200; ++y) contour.push_back({339, y});
+    for (int x = 338; x >= 0; --x) contour.push_back({x, 199});
+    for (int y = 198; y > 0; --y) contour.push_back({0, y});
+    const ChainContour chain(contour);
+
+    for (size_t target : {size_t(0), size_t(4), size_t(5), size_t(40), contour.size(), contour.size() + 1}) {
+        EXPECT_EQ(simplifyContour(chain, target), simplifyContour(contour, target)) << target;
+    }
+
+    const std::vector<point2i> corners = simplifyContour(contour, 5);
+    std::vector<point2i> points(contour.size() + corners.size()), chainPoints(points.size());
+    std::vector<int> partEnds(corners.size()), chainPartEnds(corners.size());
+    ASSERT_EQ(splitContourByCorners(chain, corners, chainPoints, chainPartEnds), splitContourByCorners(contour, corners, points, partEnds));
+    EXPECT_EQ(chainPoints, points);
+    EXPECT_EQ(chainPartEnds, partEnds);
+
+    std::vector<int> oneEnd(1);
+    ASSERT_EQ(splitContourByCorners(chain, {}, chainPoints, oneEnd), 1);
+    EXPECT_EQ(std::vector<point2i>(chainPoints.begin(), chainPoints.begin() + oneEnd[0]), contour);
+}
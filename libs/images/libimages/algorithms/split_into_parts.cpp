@@ -1,12 +1,13 @@
 #include "split_into_parts.h"
 
-#include <libbase/disjoint_set.h>
+#include "connected_components.h"
+#include "convert.h"
+
 #include <libbase/bbox2.h>
 
-#include <algorithm>
 #include <cstddef>
-#include <limits>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include <libbase/runtime_assert.h>
@@ -15,118 +16,124 @@ namespace {
 
 constexpr unsigned char kObject = 255;
 
-inline std::size_t linearIndex(int x, int y, int w) noexcept {
-    return static_cast<std::size_t>(y) * static_cast<std::size_t>(w) + static_cast<std::size_t>(x);
-}
-
-} // namespace
-
-std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
-    const image8u &image, const image8u &objectsMask)
+template <typename Mask>
+SplitObjectsViews splitObjectsViewsImpl(const image8u_cview &image, const Mask &objectsMask, bool with_openmp)
 {
     rassert(image.width() == objectsMask.width(), 980123741);
     rassert(image.height() == objectsMask.height(), 980123742);
 
-    const int w = image.width();
-    const int h = image.height();
+    ConnectedComponents components = connectedComponents(objectsMask, with_openmp);
 
-    const std::size_t n = static_cast<std::size_t>(w) * static_cast<std::size_t>(h);
-    DisjointSetUnion dsu(n);
-
-    // Build DSU for object pixels (8-connectivity).
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            if (objectsMask(y, x) != kObject) continue;
-
-            const std::size_t id = linearIndex(x, y, w);
-
-            // Left
-            if (x > 0 && objectsMask(y, x - 1) == kObject) {
-                dsu.unite(id, linearIndex(x - 1, y, w));
-            }
-            // Up
-            if (y > 0 && objectsMask(y - 1, x) == kObject) {
-                dsu.unite(id, linearIndex(x, y - 1, w));
-            }
-            // Up-left
-            if (x > 0 && y > 0 && objectsMask(y - 1, x - 1) == kObject) {
-                dsu.unite(id, linearIndex(x - 1, y - 1, w));
-            }
-            // Up-right
-            if (x + 1 < w && y > 0 && objectsMask(y - 1, x + 1) == kObject) {
-                dsu.unite(id, linearIndex(x + 1, y - 1, w));
-            }
-        }
+    SplitObjectsViews res;
+    res.offsets.reserve(components.components.size());
+    res.images.reserve(components.components.size());
+    for (const ComponentInfo &component : components.components) {
+        const bbox2i &bb = component.bbox;
+        res.offsets.push_back(bb.min);
+        res.images.push_back(image.subview(bb.min.x, bb.min.y, bb.width(), bb.height()));
     }
+    res.labels = std::move(components.labels);
+    res.scratchBytes = components.scratchBytes;
 
-    // Compute bbox per component root and remember root for each object pixel.
-    std::vector<bbox2i> boxes(n, bbox2i::make_empty());
-    std::vector<std::size_t> rootOfPixel(n, static_cast<std::size_t>(-1));
+    return res;
+}
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            if (objectsMask(y, x) != kObject) continue;
+template <typename Mask>
+std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjectsImpl(
+    const image8u_cview &image, const Mask &objectsMask, bool with_openmp, ObjectLabels *labels)
+{
+    SplitObjectsViews views = splitObjectsViewsImpl(image, objectsMask, with_openmp);
 
-            const std::size_t id = linearIndex(x, y, w);
-            const std::size_t r = dsu.find(id);
-            rootOfPixel[id] = r;
-            boxes[r].include_pixel(x, y);
-        }
+    std::vector<image8u> partsImages;
+    std::vector<image8u> partsMasks;
+    partsImages.reserve(views.images.size());
+    partsMasks.reserve(views.images.size());
+
+    // Extract crops.
+    for (int obj = 0; obj < views.objectsCount(); ++obj) {
+        partsImages.push_back(views.images[static_cast<std::size_t>(obj)].toImage());
+        partsMasks.push_back(views.objectMask(obj));
     }
 
-    // Collect roots.
-    std::vector<std::size_t> roots;
-    roots.reserve(128);
-    for (std::size_t r = 0; r < n; ++r) {
-        if (!boxes[r].is_empty()) roots.push_back(r);
+    if (labels) {
+        *labels = {};
+        if (views.objectsCount() < 65535) {
+            labels->labels16 = to_labels16(views.labels);
+        } else {
+            labels->labels32 = std::move(views.labels);
+        }
     }
 
-    // Deterministic order: by bbox top-left (y, then x).
-    std::sort(roots.begin(), roots.end(), [&](std::size_t a, std::size_t b) {
-        const auto &A = boxes[a];
-        const auto &B = boxes[b];
-        if (A.min.y != B.min.y) return A.min.y < B.min.y;
-        return A.min.x < B.min.x;
-    });
+    return {std::move(views.offsets), std::move(partsImages), std::move(partsMasks)};
+}
 
-    std::vector<point2i> offsets;
-    std::vector<image8u> partsImages;
-    std::vector<image8u> partsMasks;
+} // namespace
 
-    offsets.reserve(roots.size());
-    partsImages.reserve(roots.size());
-    partsMasks.reserve(roots.size());
+SplitObjectsViews splitObjectsViews(const image8u &image, const image8u &objectsMask, bool with_openmp) {
+    return splitObjectsViewsImpl(image, objectsMask, with_openmp);
+}
 
-    // Extract crops.
-    for (std::size_t r : roots) {
-        const bbox2i &bb = boxes[r];
-        const int outW = bb.width();
-        const int outH = bb.height();
+SplitObjectsViews splitObjectsViews(const image8u &image, const BitMask &objectsMask, bool with_openmp) {
+    return splitObjectsViewsImpl(image, objectsMask, with_openmp);
+}
 
-        point2i offset = bb.min;
-        offsets.push_back(offset);
+std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
+    const image8u &image, const image8u &objectsMask, bool with_openmp, ObjectLabels *labels)
+{
+    return splitObjectsImpl(image, objectsMask, with_openmp, labels);
+}
 
-        image8u partImage(outW, outH, image.channels());
-        image8u partMask(outW, outH, 1);
+std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
+    const image8u &image, const BitMask &objectsMask, bool with_openmp, ObjectLabels *labels)
+{
+    return splitObjectsImpl(image, objectsMask, with_openmp, labels);
+}
 
-        for (int yy = 0; yy < outH; ++yy) {
-            const int srcY = offset.y + yy;
-            for (int xx = 0; xx < outW; ++xx) {
-                const int srcX = offset.x + xx;
+std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
+    const image8u_cview &image, const BitMask &objectsMask, bool with_openmp, ObjectLabels *labels)
+{
+    return splitObjectsImpl(image, objectsMask, with_openmp, labels);
+}
 
-                for (int c = 0; c < image.channels(); ++c) {
-                    partImage(yy, xx, c) = image(srcY, srcX, c);
-                }
+image32i_cview SplitObjectsViews::objectLabels(int obj) const {
+    rassert(obj >= 0 && obj < objectsCount(), 980123743, obj, objectsCount());
+    const point2i offset = offsets[static_cast<std::size_t>(obj)];
+    const image8u_cview &part = images[static_cast<std::size_t>(obj)];
+    return image32i_cview(labels).subview(offset.x, offset.y, part.width(), part.height());
+}
 
-                const std::size_t sid = linearIndex(srcX, srcY, w);
-                const bool belongs = (objectsMask(srcY, srcX) == kObject) && (rootOfPixel[sid] == r);
-                partMask(yy, xx) = belongs ? kObject : 0;
+RunLengthMask SplitObjectsViews::objectRunLengthMask(int obj) const {
+    const image32i_cview objLabels = objectLabels(obj);
+    const int label = obj + 1;
+
+    RunLengthMask mask(objLabels.width(), objLabels.height());
+    for (int y = 0; y < objLabels.height(); ++y) {
+        const int* src = objLabels.ptr(y);
+        int x = 0;
+        while (x < objLabels.width()) {
+            if (src[x] != label) {
+                ++x;
+                continue;
             }
+            const int x0 = x;
+            while (x < objLabels.width() && src[x] == label) ++x;
+            mask.appendRun(y, x0, x);
         }
-
-        partsImages.push_back(std::move(partImage));
-        partsMasks.push_back(std::move(partMask));
     }
+    return mask;
+}
+
+image8u SplitObjectsViews::objectMask(int obj) const {
+    const image32i_cview objLabels = objectLabels(obj);
+    const int label = obj + 1;
 
-    return {offsets, partsImages, partsMasks};
+    image8u mask(objLabels.width(), objLabels.height(), 1, ImageInit::Uninitialized);
+    for (int y = 0; y < objLabels.height(); ++y) {
+        const int* src = objLabels.ptr(y);
+        unsigned char* dst = mask.ptr(y);
+        for (int x = 0; x < objLabels.width(); ++x) {
+            dst[x] = (src[x] == label) ? kObject : 0;
+        }
+    }
+    return mask;
 }
@@ -1,8 +1,52 @@
 #pragma once
 
+#include <libimages/bit_mask.h>
 #include <libimages/image.h>
+#include <libimages/image_view.h>
+#include <libimages/run_length_mask.h>
 #include <libbase/point2.h>
 
+#include <cstddef>
+#include <tuple>
+#include <vector>
 
+// Label image of the objects of splitObjects as they were labelled (the same labels as SplitObjectsViews::labels):
+// object index + 1, 0 - background, in 16 bits (half the memory) while the objects fit into them
+struct ObjectLabels final {
+    image16u labels16; // if there are less than 65535 objects (see to_labels16)
+    image32i labels32; // otherwise
+
+    bool empty() const noexcept { return labels16.width() == 0 && labels32.width() == 0; }
+};
+
+// labels (if not null) get the label image instead of a scatter of the masks by the caller
+std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
+    const image8u &image, const image8u &objectsMask, bool with_openmp = true, ObjectLabels *labels = nullptr);
 std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
-    const image8u &image, const image8u &objectsMask);
+    const image8u &image, const BitMask &objectsMask, bool with_openmp = true, ObjectLabels *labels = nullptr);
+// Of a region of a larger image (f.e. the roi of a photo) without copying the region first, offsets are within it
+std::tuple<std::vector<point2i>, std::vector<image8u>, std::vector<image8u>> splitObjects(
+    const image8u_cview &image, const BitMask &objectsMask, bool with_openmp = true, ObjectLabels *labels = nullptr);
+
+// Objects are 8-connected components of objectsMask (see connectedComponents), with_openmp labels strips in parallel.
+
+// Zero-copy variant of splitObjects: pieces are views into the source image plus a label image.
+// Views point into `image` passed to splitObjectsViews, so it must outlive the result.
+struct SplitObjectsViews final {
+    std::vector<point2i> offsets;       // top-left corner of each object bbox in the source image
+    std::vector<image8u_cview> images;  // bbox of each object in the source image
+    image32i labels;                    // same size as source image: object index + 1, or 0 for background
+    std::size_t scratchBytes = 0;       // peak temporary memory of labelling besides labels (see connectedComponents)
+
+    int objectsCount() const noexcept { return static_cast<int>(images.size()); }
+
+    // Bbox region of labels for object obj (may contain labels of neighbouring objects)
+    image32i_cview objectLabels(int obj) const;
+    // Mask of object obj over its bbox (255 - object pixel, 0 - otherwise), same as splitObjects masks
+    image8u objectMask(int obj) const;
+    // Same mask as runs, O(bbox) to build, O(runs) to store
+    RunLengthMask objectRunLengthMask(int obj) const;
+};
+
+SplitObjectsViews splitObjectsViews(const image8u &image, const image8u &objectsMask, bool with_openmp = true);
+SplitObjectsViews splitObjectsViews(const image8u &image, const BitMask &objectsMask, bool with_openmp = true);
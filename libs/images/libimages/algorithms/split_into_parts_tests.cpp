@@ -184,3 +184,130 @@ TEST(split_into_parts, twoComponents) {
     debug_io::dump_image(getUnitCaseDebugDir() + "02_result_components.jpg", debug_io::colorize_labels(labels, 0));
 }
 
+
+TEST(split_into_parts, viewsMatchCopies) {
+    configureWorkingDirectory();
+
+    int w = 105;
+    int h = 95;
+    image8u image(w, h, 1);
+    image8u objectsMask(w, h, 1);
+    unsigned char objectMaskValue = 255;
+
+    // B bbox overlaps A bbox, so labels views of A contain pixels of B
+    drawCross(image, {10, 20}, {50, 60}, uint8_t(239));
+    drawCross(objectsMask, {10, 20}, {50, 60}, objectMaskValue);
+    drawCross(image, {35, 25}, {70, 50}, uint8_t(123));
+    drawCross(objectsMask, {35, 25}, {70, 50}, objectMaskValue);
+
+    auto [objectsOffsets, objectsImages, objectsMasks] = splitObjects(image, objectsMask);
+    const SplitObjectsViews views = splitObjectsViews(image, objectsMask);
+
+    ASSERT_EQ(views.objectsCount(), 2);
+    ASSERT_EQ(views.objectsCount(), static_cast<int>(objectsImages.size()));
+    ASSERT_EQ(views.labels.width(), w);
+    ASSERT_EQ(views.labels.height(), h);
+
+    for (int i = 0; i < views.objectsCount(); ++i) {
+        EXPECT_EQ(views.offsets[i], objectsOffsets[i]);
+
+        const image8u_cview& view = views.images[i];
+        EXPECT_EQ(view.data(), image.ptr(objectsOffsets[i].y, objectsOffsets[i].x));
+        EXPECT_EQ(view.toImage().toVector(), objectsImages[i].toVector());
+        EXPECT_EQ(views.objectMask(i).toVector(), objectsMasks[i].toVector());
+
+        debug_io::dump_image(getUnitCaseDebugDir() + "10_object" + std::to_string(i) + "_mask.png", views.objectMask(i));
+    }
+
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            EXPECT_EQ(views.labels(y, x) != 0, objectsMask(y, x) == objectMaskValue);
+        }
+    }
+
+    debug_io::dump_image(getUnitCaseDebugDir() + "02_labels.jpg", debug_io::colorize_labels(views.labels, 0));
+}
+
+TEST(split_into_parts, bitMaskMatchesImage8u) {
+    configureWorkingDirectory();
+
+    image8u image(90, 80, 1);
+    image8u objectsMask(90, 80, 1);
+    drawCross(image, {3, 5}, {40, 70}, uint8_t(200));
+    drawCross(objectsMask, {3, 5}, {40, 70}, uint8_t(255));
+    drawCross(image, {50, 2}, {89, 30}, uint8_t(100));
+    drawCross(objectsMask, {50, 2}, {89, 30}, uint8_t(255));
+
+    auto [offsets, images, masks] = splitObjects(image, objectsMask);
+    auto [offsetsBits, imagesBits, masksBits] = splitObjects(image, BitMask::fromImage(objectsMask));
+
+    ASSERT_EQ(offsets.size(), 2);
+    ASSERT_EQ(offsetsBits, offsets);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        EXPECT_EQ(imagesBits[i].toVector(), images[i].toVector());
+        EXPECT_EQ(masksBits[i].toVector(), masks[i].toVector());
+    }
+
+    const SplitObjectsViews views = splitObjectsViews(image, objectsMask);
+    for (int obj = 0; obj < views.objectsCount(); ++obj) {
+        EXPECT_EQ(views.objectRunLengthMask(obj).toImage().toVector(), masks[obj].toVector());
+    }
+}
+
+TEST(split_into_parts, returnsLabelsOfViews) {
+    configureWorkingDirectory();
+
+    image8u image(90, 80, 1);
+    image8u objectsMask(90, 80, 1);
+    drawCross(image, {3, 5}, {40, 70}, uint8_t(200));
+    drawCross(objectsMask, {3, 5}, {40, 70}, uint8_t(255));
+    drawCross(image, {50, 2}, {89, 30}, uint8_t(100));
+    drawCross(objectsMask, {50, 2}, {89, 30}, uint8_t(255));
+
+    ObjectLabels labels;
+    auto [offsets, images, masks] = splitObjects(image, BitMask::fromImage(objectsMask), true, &labels);
+    const SplitObjectsViews views = splitObjectsViews(image, objectsMask);
+
+    ASSERT_EQ(offsets.size(), 2);
+    ASSERT_FALSE(labels.empty());
+    EXPECT_EQ(labels.labels32.width(), 0); // two objects fit into 16 bits
+    ASSERT_EQ(labels.labels16.width(), image.width());
+    ASSERT_EQ(labels.labels16.height(), image.height());
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            ASSERT_EQ(labels.labels16(y, x), views.labels(y, x));
+        }
+    }
+    // the same as the masks scattered into a label image
+    for (size_t obj = 0; obj < masks.size(); ++obj) {
+        for (int j = 0; j < masks[obj].height(); ++j) {
+            for (int i = 0; i < masks[obj].width(); ++i) {
+                if (masks[obj](j, i) == 255) EXPECT_EQ(labels.labels16(offsets[obj].y + j, offsets[obj].x + i), obj + 1);
+            }
+        }
+    }
+}
+
+TEST(split_into_parts, viewOfRegionMatchesCopiedRegion) {
+    configureWorkingDirectory();
+
+    image8u image(90, 80, 3);
+    image8u objectsMask(90, 80, 1);
+    for (int j = 0; j < image.height(); ++j)
+        for (int i = 0; i < image.width(); ++i)
+            for (int c = 0; c < 3; ++c) image(j, i, c) = static_cast<uint8_t>(j * 7 + i * 3 + c);
+    drawCross(objectsMask, {3, 5}, {40, 70}, uint8_t(255));
+    drawCross(objectsMask, {50, 2}, {89, 30}, uint8_t(255));
+
+    const BitMask mask = BitMask::fromImage(objectsMask);
+    const int x = 2, y = 1, w = 87, h = 75;
+    auto [offsets, images, masks] = splitObjects(image8u_cview(image).subview(x, y, w, h).toImage(), mask.crop(x, y, w, h));
+    auto [offsetsView, imagesView, masksView] = splitObjects(image8u_cview(image).subview(x, y, w, h), mask.crop(x, y, w, h));
+
+    ASSERT_EQ(offsets.size(), 2);
+    ASSERT_EQ(offsetsView, offsets);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        EXPECT_EQ(imagesView[i].toVector(), images[i].toVector());
+        EXPECT_EQ(masksView[i].toVector(), masks[i].toVector());
+    }
+}
@@ -0,0 +1,90 @@
+#include "threshold_kernels.h"
+
+#include <libbase/cpu_features.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace threshold_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// threshold_kernels_avx2.cpp (compiled with AVX2 enabled)
+const Kernels &avx2Kernels();
+#endif
+#if defined(LIBIMAGES_WITH_AVX512)
+// threshold_kernels_avx512.cpp (compiled with AVX-512 enabled)
+const Kernels &avx512Kernels();
+#endif
+
+namespace {
+
+int floatToBytesScalar(const float *src, int n, float threshold, std::uint8_t *dst) {
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        const bool foreground = !(src[i] < threshold);
+        dst[i] = foreground ? 255 : 0;
+        count += foreground;
+    }
+    return count;
+}
+
+int u8ToBytesScalar(const std::uint8_t *src, int n, float threshold, std::uint8_t *dst) {
+    const int first = firstForegroundByte(threshold);
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        const bool foreground = src[i] >= first;
+        dst[i] = foreground ? 255 : 0;
+        count += foreground;
+    }
+    return count;
+}
+
+template <typename T, typename IsForeground>
+int toBits(const T *src, int n, BitMask::word_type *dst, IsForeground is_foreground) {
+    int count = 0;
+    for (int i0 = 0; i0 < n; i0 += BitMask::bits_per_word) {
+        const int m = std::min(BitMask::bits_per_word, n - i0);
+        BitMask::word_type word = 0;
+        for (int k = 0; k < m; ++k) word |= BitMask::word_type(is_foreground(src[i0 + k])) << k;
+        dst[i0 / BitMask::bits_per_word] = word;
+        count += std::popcount(word);
+    }
+    return count;
+}
+
+int floatToBitsScalar(const float *src, int n, float threshold, BitMask::word_type *dst) {
+    return toBits(src, n, dst, [threshold](float v) { return !(v < threshold); });
+}
+
+int u8ToBitsScalar(const std::uint8_t *src, int n, float threshold, BitMask::word_type *dst) {
+    const int first = firstForegroundByte(threshold);
+    return toBits(src, n, dst, [first](std::uint8_t v) { return v >= first; });
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", floatToBytesScalar, u8ToBytesScalar, floatToBitsScalar, u8ToBitsScalar};
+    return kernels;
+}
+
+const Kernels *avx2() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2) return &avx2Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels *avx512() {
+#if defined(LIBIMAGES_WITH_AVX512)
+    if (cpuFeatures().avx512) return &avx512Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = avx512() ? *avx512() : avx2() ? *avx2() : scalar();
+    return kernels;
+}
+
+} // namespace threshold_kernels
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <libimages/bit_mask.h>
+
+#include <cstdint>
+
+// Kernels behind threshold_masking/threshold_bitmask, one implementation per instruction set (picked at runtime by CPU features).
+// A pixel is foreground if !(value < threshold) (so NaN values are foreground), results of all implementations are identical.
+namespace threshold_kernels {
+
+// n values to n bytes (0 - background, 255 - foreground), returns the number of foreground pixels
+using FloatToBytesFn = int (*)(const float *src, int n, float threshold, std::uint8_t *dst);
+using U8ToBytesFn = int (*)(const std::uint8_t *src, int n, float threshold, std::uint8_t *dst);
+
+// n values to (n + 63) / 64 words in the layout of a BitMask row (bits past n are zero), returns the number of set bits
+using FloatToBitsFn = int (*)(const float *src, int n, float threshold, BitMask::word_type *dst);
+using U8ToBitsFn = int (*)(const std::uint8_t *src, int n, float threshold, BitMask::word_type *dst);
+
+struct Kernels {
+    const char *name;
+    FloatToBytesFn floatToBytes;
+    U8ToBytesFn u8ToBytes;
+    FloatToBitsFn floatToBits;
+    U8ToBitsFn u8ToBits;
+};
+
+// Smallest byte value that is foreground for threshold, 256 if none of them is
+inline int firstForegroundByte(float threshold) noexcept {
+    if (!(threshold > 0.0f)) return 0; // NaN threshold too: no value is less than it
+    if (threshold > 255.0f) return 256;
+    const int t = static_cast<int>(threshold);
+    return (float) t < threshold ? t + 1 : t;
+}
+
+// Portable loops
+const Kernels &scalar();
+// nullptr if not compiled in or not supported by current CPU
+const Kernels *avx2();
+const Kernels *avx512(); // AVX-512 F, BW and VL
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace threshold_kernels
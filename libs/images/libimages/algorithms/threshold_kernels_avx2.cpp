@@ -0,0 +1,94 @@
+#include "threshold_kernels.h"
+
+#include <immintrin.h>
+
+#include <bit>
+
+namespace threshold_kernels {
+
+namespace {
+
+// Bits of 8 floats that are not less than threshold (unordered compare, so NaN is foreground as in !(v < t))
+inline unsigned floatMask8(const float *src, __m256 t) {
+    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(src), t, _CMP_NLT_UQ)));
+}
+
+// 0xFF bytes where v >= first, i.e. max(v, first) == v
+inline __m256i u8Foreground32(const std::uint8_t *src, __m256i first) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(v, first), v);
+}
+
+// 32 pixels per step: 4 compares are packed with saturation (-1 stays 0xFF) and the lanes are put back in order
+int floatToBytesAvx2(const float *src, int n, float threshold, std::uint8_t *dst) {
+    const __m256 t = _mm256_set1_ps(threshold);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int count = 0;
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i m[4];
+        for (int k = 0; k < 4; ++k) m[k] = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(src + i + 8 * k), t, _CMP_NLT_UQ));
+        const __m256i bytes = _mm256_packs_epi16(_mm256_packs_epi32(m[0], m[1]), _mm256_packs_epi32(m[2], m[3]));
+        const __m256i ordered = _mm256_permutevar8x32_epi32(bytes, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), ordered);
+        count += std::popcount(static_cast<unsigned>(_mm256_movemask_epi8(ordered)));
+    }
+    if (i < n) count += scalar().floatToBytes(src + i, n - i, threshold, dst + i);
+    return count;
+}
+
+int u8ToBytesAvx2(const std::uint8_t *src, int n, float threshold, std::uint8_t *dst) {
+    const int firstByte = firstForegroundByte(threshold);
+    if (firstByte > 255) return scalar().u8ToBytes(src, n, threshold, dst); // all background
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(firstByte));
+    int count = 0;
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i m = u8Foreground32(src + i, first);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), m);
+        count += std::popcount(static_cast<unsigned>(_mm256_movemask_epi8(m)));
+    }
+    if (i < n) count += scalar().u8ToBytes(src + i, n - i, threshold, dst + i);
+    return count;
+}
+
+// Whole words are vectorized, the last partial word is left to the scalar kernel
+int floatToBitsAvx2(const float *src, int n, float threshold, BitMask::word_type *dst) {
+    const __m256 t = _mm256_set1_ps(threshold);
+    int count = 0;
+    int i = 0;
+    for (; i + BitMask::bits_per_word <= n; i += BitMask::bits_per_word) {
+        BitMask::word_type word = 0;
+        for (int k = 0; k < BitMask::bits_per_word; k += 8) word |= BitMask::word_type(floatMask8(src + i + k, t)) << k;
+        dst[i / BitMask::bits_per_word] = word;
+        count += std::popcount(word);
+    }
+    if (i < n) count += scalar().floatToBits(src + i, n - i, threshold, dst + i / BitMask::bits_per_word);
+    return count;
+}
+
+int u8ToBitsAvx2(const std::uint8_t *src, int n, float threshold, BitMask::word_type *dst) {
+    const int firstByte = firstForegroundByte(threshold);
+    if (firstByte > 255) return scalar().u8ToBits(src, n, threshold, dst);
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(firstByte));
+    int count = 0;
+    int i = 0;
+    for (; i + BitMask::bits_per_word <= n; i += BitMask::bits_per_word) {
+        const auto lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(u8Foreground32(src + i, first)));
+        const auto hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(u8Foreground32(src + i + 32, first)));
+        const BitMask::word_type word = BitMask::word_type(lo) | (BitMask::word_type(hi) << 32);
+        dst[i / BitMask::bits_per_word] = word;
+        count += std::popcount(word);
+    }
+    if (i < n) count += scalar().u8ToBits(src + i, n - i, threshold, dst + i / BitMask::bits_per_word);
+    return count;
+}
+
+} // namespace
+
+const Kernels &avx2Kernels() {
+    static const Kernels kernels{"avx2", floatToBytesAvx2, u8ToBytesAvx2, floatToBitsAvx2, u8ToBitsAvx2};
+    return kernels;
+}
+
+} // namespace threshold_kernels
@@ -0,0 +1,92 @@
+#include "threshold_kernels.h"
+
+#include <immintrin.h>
+
+#include <bit>
+
+namespace threshold_kernels {
+
+namespace {
+
+// Bits of 64 floats that are not less than threshold (unordered compare, so NaN is foreground as in !(v < t))
+inline std::uint64_t floatMask64(const float *src, __m512 t) {
+    std::uint64_t bits = 0;
+    for (int k = 0; k < 4; ++k) {
+        const __mmask16 m = _mm512_cmp_ps_mask(_mm512_loadu_ps(src + 16 * k), t, _CMP_NLT_UQ);
+        bits |= std::uint64_t(_cvtmask16_u32(m)) << (16 * k);
+    }
+    return bits;
+}
+
+// Bits of 64 bytes where v >= first
+inline std::uint64_t u8Mask64(const std::uint8_t *src, __m512i first) {
+    return _cvtmask64_u64(_mm512_cmpge_epu8_mask(_mm512_loadu_si512(src), first));
+}
+
+// 64 pixels per step, the compare masks are expanded to 0x00/0xFF bytes
+int floatToBytesAvx512(const float *src, int n, float threshold, std::uint8_t *dst) {
+    const __m512 t = _mm512_set1_ps(threshold);
+    int count = 0;
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const std::uint64_t bits = floatMask64(src + i, t);
+        _mm512_storeu_si512(dst + i, _mm512_movm_epi8(_cvtu64_mask64(bits)));
+        count += std::popcount(bits);
+    }
+    if (i < n) count += scalar().floatToBytes(src + i, n - i, threshold, dst + i);
+    return count;
+}
+
+int u8ToBytesAvx512(const std::uint8_t *src, int n, float threshold, std::uint8_t *dst) {
+    const int firstByte = firstForegroundByte(threshold);
+    if (firstByte > 255) return scalar().u8ToBytes(src, n, threshold, dst); // all background
+    const __m512i first = _mm512_set1_epi8(static_cast<char>(firstByte));
+    int count = 0;
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const std::uint64_t bits = u8Mask64(src + i, first);
+        _mm512_storeu_si512(dst + i, _mm512_movm_epi8(_cvtu64_mask64(bits)));
+        count += std::popcount(bits);
+    }
+    if (i < n) count += scalar().u8ToBytes(src + i, n - i, threshold, dst + i);
+    return count;
+}
+
+// A mask of 64 lanes is a whole BitMask word, the last partial word is left to the scalar kernel
+int floatToBitsAvx512(const float *src, int n, float threshold, BitMask::word_type *dst) {
+    static_assert(BitMask::bits_per_word == 64);
+    const __m512 t = _mm512_set1_ps(threshold);
+    int count = 0;
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const BitMask::word_type word = floatMask64(src + i, t);
+        dst[i / 64] = word;
+        count += std::popcount(word);
+    }
+    if (i < n) count += scalar().floatToBits(src + i, n - i, threshold, dst + i / 64);
+    return count;
+}
+
+int u8ToBitsAvx512(const std::uint8_t *src, int n, float threshold, BitMask::word_type *dst) {
+    const int firstByte = firstForegroundByte(threshold);
+    if (firstByte > 255) return scalar().u8ToBits(src, n, threshold, dst);
+    const __m512i first = _mm512_set1_epi8(static_cast<char>(firstByte));
+    int count = 0;
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const BitMask::word_type word = u8Mask64(src + i, first);
+        dst[i / 64] = word;
+        count += std::popcount(word);
+    }
+    if (i < n) count += scalar().u8ToBits(src + i, n - i, threshold, dst + i / 64);
+    return count;
+}
+
+} // namespace
+
+const Kernels &avx512Kernels() {
+    static const Kernels kernels{"avx512", floatToBytesAvx512, u8ToBytesAvx512, floatToBitsAvx512, u8ToBitsAvx512};
+    return kernels;
+}
+
+} // namespace threshold_kernels
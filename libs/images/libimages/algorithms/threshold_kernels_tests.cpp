@@ -0,0 +1,97 @@
+#include "threshold_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+TEST(threshold_kernels, bestIsAvailable) {
+    const threshold_kernels::Kernels &best = threshold_kernels::best();
+    EXPECT_NE(best.floatToBytes, nullptr);
+    EXPECT_NE(best.u8ToBits, nullptr);
+    std::cout << "threshold kernels: " << best.name << std::endl;
+}
+
+TEST(threshold_kernels, firstForegroundByte) {
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(-3.0f), 0);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(0.0f), 0);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(0.5f), 1);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(100.0f), 100);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(100.01f), 101);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(255.0f), 255);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(255.5f), 256);
+    EXPECT_EQ(threshold_kernels::firstForegroundByte(std::numeric_limits<float>::quiet_NaN()), 0);
+    for (int v = 0; v < 256; ++v)
+        for (float t : {-1.0f, 0.0f, 17.5f, 128.0f, 255.0f, 300.0f})
+            ASSERT_EQ(v >= threshold_kernels::firstForegroundByte(t), !((float) v < t)) << v << " " << t;
+}
+
+TEST(threshold_kernels, scalarPacksBitsAndCounts) {
+    std::vector<float> src(70, 0.0f);
+    src[0] = 5.0f;
+    src[63] = 5.0f;
+    src[64] = std::numeric_limits<float>::quiet_NaN(); // !(NaN < t) - foreground
+    src[69] = 1.0f; // == threshold
+    BitMask::word_type words[2] = {7, 7};
+    EXPECT_EQ(threshold_kernels::scalar().floatToBits(src.data(), 70, 1.0f, words), 4);
+    EXPECT_EQ(words[0], (BitMask::word_type(1) << 63) | 1u);
+    EXPECT_EQ(words[1], (BitMask::word_type(1) << 5) | 1u);
+
+    std::vector<std::uint8_t> bytes(70, 7);
+    EXPECT_EQ(threshold_kernels::scalar().floatToBytes(src.data(), 70, 1.0f, bytes.data()), 4);
+    EXPECT_EQ(bytes[0], 255);
+    EXPECT_EQ(bytes[1], 0);
+    EXPECT_EQ(bytes[64], 255);
+}
+
+namespace {
+
+void expectMatchesScalar(const threshold_kernels::Kernels *simd) {
+    const threshold_kernels::Kernels &scalar = threshold_kernels::scalar();
+
+    FastRandom r(239);
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int iter = 0; iter < 200; ++iter) {
+        const int n = r.nextInt(1, 300);
+        std::vector<float> f(static_cast<size_t>(n));
+        std::vector<std::uint8_t> u(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) {
+            u[i] = static_cast<std::uint8_t>(r.nextInt(0, 255));
+            f[i] = r.nextInt(0, 20) == 0 ? nan : (float) u[i] + (r.nextInt(0, 1) ? 0.0f : 0.5f);
+        }
+        const float thresholds[] = {-1.0f, 0.0f, (float) r.nextInt(0, 255), r.nextFloat(0.0f, 255.0f), 255.0f, 256.0f, nan};
+        for (float t : thresholds) {
+            std::vector<std::uint8_t> eb(static_cast<size_t>(n)), ab(static_cast<size_t>(n));
+            ASSERT_EQ(simd->floatToBytes(f.data(), n, t, ab.data()), scalar.floatToBytes(f.data(), n, t, eb.data()));
+            ASSERT_EQ(ab, eb);
+            ASSERT_EQ(simd->u8ToBytes(u.data(), n, t, ab.data()), scalar.u8ToBytes(u.data(), n, t, eb.data()));
+            ASSERT_EQ(ab, eb);
+
+            const size_t words = static_cast<size_t>((n + BitMask::bits_per_word - 1) / BitMask::bits_per_word);
+            std::vector<BitMask::word_type> ew(words), aw(words);
+            ASSERT_EQ(simd->floatToBits(f.data(), n, t, aw.data()), scalar.floatToBits(f.data(), n, t, ew.data()));
+            ASSERT_EQ(aw, ew);
+            ASSERT_EQ(simd->u8ToBits(u.data(), n, t, aw.data()), scalar.u8ToBits(u.data(), n, t, ew.data()));
+            ASSERT_EQ(aw, ew);
+        }
+    }
+}
+
+} // namespace
+
+TEST(threshold_kernels, avx2MatchesScalar) {
+    const threshold_kernels::Kernels *simd = threshold_kernels::avx2();
+    if (!simd) GTEST_SKIP() << "AVX2 kernels are not available";
+    expectMatchesScalar(simd);
+}
+
+TEST(threshold_kernels, avx512MatchesScalar) {
+    const threshold_kernels::Kernels *simd = threshold_kernels::avx512();
+    if (!simd) GTEST_SKIP() << "AVX-512 kernels are not available";
+    expectMatchesScalar(simd);
+}
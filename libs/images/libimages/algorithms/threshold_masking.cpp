@@ -1,15 +1,166 @@
 #include "threshold_masking.h"
 
+#include <libimages/algorithms/grayscale_kernels.h>
+#include <libimages/algorithms/threshold_kernels.h>
+
 #include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
 
-image8u threshold_masking(const image32f &image, float threshold) {
-    rassert(image.channels() == 1, 2321431421, image.channels());
-    image8u mask(image.size());
-    for (int j = 0; j < image.height(); ++j) {
-        for (int i = 0; i < image.width(); ++i) {
-            mask(j, i) = (image(j, i) < threshold) ? 0 : 255;
+namespace {
+
+// Per-row foreground count and [x0, x1) span, reduced after the parallel pass so that the result is deterministic
+class RowStats {
+  public:
+    RowStats(ThresholdStats *stats, int height) : stats_(stats) {
+        if (stats_) rows_.resize(static_cast<std::size_t>(height));
+    }
+
+    bool enabled() const { return stats_ != nullptr; }
+
+    void addBytes(int j, const std::uint8_t *row, int width, int count) {
+        if (!stats_ || count == 0) return;
+        int x0 = 0, x1 = width;
+        while (row[x0] == 0) ++x0;
+        while (row[x1 - 1] == 0) --x1;
+        rows_[j] = {count, x0, x1};
+    }
+
+    void addBits(int j, const BitMask::word_type *row, int words, int count) {
+        if (!stats_ || count == 0) return;
+        int k0 = 0, k1 = words - 1;
+        while (row[k0] == 0) ++k0;
+        while (row[k1] == 0) --k1;
+        const int x0 = k0 * BitMask::bits_per_word + std::countr_zero(row[k0]);
+        const int x1 = k1 * BitMask::bits_per_word + BitMask::bits_per_word - std::countl_zero(row[k1]);
+        rows_[j] = {count, x0, x1};
+    }
+
+    void finish() {
+        if (!stats_) return;
+        *stats_ = ThresholdStats{};
+        for (int j = 0; j < static_cast<int>(rows_.size()); ++j) {
+            const Row &row = rows_[j];
+            if (row.count == 0) continue;
+            stats_->count += static_cast<std::size_t>(row.count);
+            stats_->bounds.include_pixel(row.x0, j);
+            stats_->bounds.include_pixel(row.x1 - 1, j);
         }
     }
+
+  private:
+    struct Row {
+        int count = 0;
+        int x0 = 0, x1 = 0;
+    };
+
+    ThresholdStats *stats_;
+    std::vector<Row> rows_;
+};
+
+// Every byte of mask is written, so a buffer of the right size is reused as is; mask may be image itself (elementwise)
+template <typename T, typename ToBytes>
+void toBytes(const Image<T> &image, image8u &mask, float threshold, ThresholdStats *stats, ToBytes kernel) {
+    mask.ensureSize(image.width(), image.height(), 1);
+    RowStats rows(stats, image.height());
+    parallelForEach(0, image.height(), [&](int j) {
+        const int count = kernel(image.ptr(j), image.width(), threshold, mask.ptr(j));
+        rows.addBytes(j, mask.ptr(j), image.width(), count);
+    });
+    rows.finish();
+}
+
+// Kernels assign whole words (bits past the width are zeros), so mask is not cleared
+template <typename T, typename ToBits>
+void toBits(const Image<T> &image, BitMask &mask, float threshold, ThresholdStats *stats, ToBits kernel) {
+    mask.ensureSize(image.width(), image.height());
+    RowStats rows(stats, image.height());
+    parallelForEach(0, image.height(), [&](int j) {
+        const int count = kernel(image.ptr(j), image.width(), threshold, mask.row(j));
+        rows.addBits(j, mask.row(j), mask.words_per_row(), count);
+    });
+    rows.finish();
+}
+
+} // namespace
+
+image8u threshold_masking(const image32f &image, float threshold, ThresholdStats *stats) {
+    image8u mask;
+    threshold_masking(image, mask, threshold, stats);
+    return mask;
+}
+
+BitMask threshold_bitmask(const image32f &image, float threshold, ThresholdStats *stats) {
+    BitMask mask;
+    threshold_bitmask(image, mask, threshold, stats);
+    return mask;
+}
+
+image8u threshold_masking(const image8u &gray, float threshold, ThresholdStats *stats) {
+    image8u mask;
+    threshold_masking(gray, mask, threshold, stats);
+    return mask;
+}
+
+BitMask threshold_bitmask(const image8u &gray, float threshold, ThresholdStats *stats) {
+    BitMask mask;
+    threshold_bitmask(gray, mask, threshold, stats);
     return mask;
 }
+
+BitMask threshold_grayscale_bitmask(const image8u &image, float threshold, ThresholdStats *stats) {
+    BitMask mask;
+    threshold_grayscale_bitmask(image, mask, threshold, stats);
+    return mask;
+}
+
+void threshold_masking(const image32f &image, image8u &mask, float threshold, ThresholdStats *stats) {
+    rassert(image.channels() == 1, 2321431421, image.channels());
+    toBytes(image, mask, threshold, stats, threshold_kernels::best().floatToBytes);
+}
+
+void threshold_bitmask(const image32f &image, BitMask &mask, float threshold, ThresholdStats *stats) {
+    rassert(image.channels() == 1, 2321431422, image.channels());
+    toBits(image, mask, threshold, stats, threshold_kernels::best().floatToBits);
+}
+
+void threshold_masking(const image8u &gray, image8u &mask, float threshold, ThresholdStats *stats) {
+    rassert(gray.channels() == 1, 2321431424, gray.channels());
+    toBytes(gray, mask, threshold, stats, threshold_kernels::best().u8ToBytes);
+}
+
+void threshold_bitmask(const image8u &gray, BitMask &mask, float threshold, ThresholdStats *stats) {
+    rassert(gray.channels() == 1, 2321431425, gray.channels());
+    toBits(gray, mask, threshold, stats, threshold_kernels::best().u8ToBits);
+}
+
+void threshold_grayscale_bitmask(const image8u &image, BitMask &mask, float threshold, ThresholdStats *stats) {
+    const int c = image.channels();
+    rassert(c == 1 || c == 3 || c == 4, 2321431423, c);
+
+    const int w = image.width();
+    const int h = image.height();
+    mask.ensureSize(w, h);
+    RowStats rows(stats, h);
+    const grayscale_kernels::Kernels& grayscale = grayscale_kernels::best();
+    const threshold_kernels::Kernels& thresholds = threshold_kernels::best();
+
+    parallelForEach(0, h, [&](int j) {
+        const std::uint8_t* src = image.ptr(j);
+        BitMask::word_type* dst = mask.row(j);
+        // per word: intensities of 64 pixels first, then packing of comparisons into bits (both SIMD kernels)
+        float gray[BitMask::bits_per_word];
+        int count = 0;
+        for (int i0 = 0; i0 < w; i0 += BitMask::bits_per_word) {
+            const int n = std::min(BitMask::bits_per_word, w - i0);
+            grayscale.toFloatRow(src + static_cast<std::size_t>(i0) * c, c, n, gray);
+            count += thresholds.floatToBits(gray, n, threshold, dst + i0 / BitMask::bits_per_word);
+        }
+        rows.addBits(j, dst, mask.words_per_row(), count);
+    });
+    rows.finish();
+}
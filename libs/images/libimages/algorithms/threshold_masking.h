@@ -1,7 +1,37 @@
 #pragma once
 
+#include <libbase/bbox2.h>
+#include <libimages/bit_mask.h>
 #include <libimages/image.h>
 
+#include <cstddef>
+
+// Foreground statistics gathered in the same pass as the mask (f.e. to limit later processing to the bounds)
+struct ThresholdStats {
+    std::size_t count = 0; // foreground pixels
+    bbox2i bounds;         // of the foreground pixels, empty if there are none
+};
+
+// All of these are SIMD kernels (see threshold_kernels.h) over rows in parallel, stats is filled if not nullptr
 
 // returns mask that has 0 if < threshold, 255 otherwise
-image8u threshold_masking(const image32f &image, float threshold);
+image8u threshold_masking(const image32f &image, float threshold, ThresholdStats *stats = nullptr);
+
+// same as threshold_masking but bit-packed: bit is set if >= threshold
+BitMask threshold_bitmask(const image32f &image, float threshold, ThresholdStats *stats = nullptr);
+
+// Same for 8-bit grayscale (f.e. to_grayscale_u8), a quarter of the memory traffic of the float image
+image8u threshold_masking(const image8u &gray, float threshold, ThresholdStats *stats = nullptr);
+BitMask threshold_bitmask(const image8u &gray, float threshold, ThresholdStats *stats = nullptr);
+
+// Fused to_grayscale_float + threshold_bitmask: goes straight from 8-bit image (1, 3 or 4 channels)
+// to the bit-packed mask without materializing the float grayscale image, result is identical
+BitMask threshold_grayscale_bitmask(const image8u &image, float threshold, ThresholdStats *stats = nullptr);
+
+// Same into a caller-owned mask: its buffer is reused if the size matches (reallocated otherwise).
+// threshold_masking of 8-bit gray may write into gray itself
+void threshold_masking(const image32f &image, image8u &mask, float threshold, ThresholdStats *stats = nullptr);
+void threshold_bitmask(const image32f &image, BitMask &mask, float threshold, ThresholdStats *stats = nullptr);
+void threshold_masking(const image8u &gray, image8u &mask, float threshold, ThresholdStats *stats = nullptr);
+void threshold_bitmask(const image8u &gray, BitMask &mask, float threshold, ThresholdStats *stats = nullptr);
+void threshold_grayscale_bitmask(const image8u &image, BitMask &mask, float threshold, ThresholdStats *stats = nullptr);
@@ -17,3 +17,111 @@ TEST(threshold_masking, thresholdByConstant100) {
     image8u is_foreground_mask = threshold_masking(grayscale, 100);
     debug_io::dump_image(getUnitCaseDebugDir() + "is_foreground_by_100.jpg", is_foreground_mask);
 }
+
+TEST(threshold_masking, fusedGrayscaleBitmaskMatchesTwoPasses) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    for (float threshold : {0.0f, 57.3f, 100.0f, 255.0f}) {
+        const BitMask expected = threshold_bitmask(to_grayscale_float(img), threshold);
+        EXPECT_TRUE(threshold_grayscale_bitmask(img, threshold) == expected) << threshold;
+    }
+
+    image8u gray(70, 3, 1);
+    for (int j = 0; j < gray.height(); ++j)
+        for (int i = 0; i < gray.width(); ++i)
+            gray(j, i) = static_cast<uint8_t>((i * 7 + j * 31) % 256);
+    EXPECT_TRUE(threshold_grayscale_bitmask(gray, 128.0f) == threshold_bitmask(to_grayscale_float(gray), 128.0f));
+}
+
+TEST(threshold_masking, u8GrayscaleMatchesFloat) {
+    image8u gray(70, 3, 1);
+    for (int j = 0; j < gray.height(); ++j)
+        for (int i = 0; i < gray.width(); ++i)
+            gray(j, i) = static_cast<uint8_t>((i * 7 + j * 31) % 256);
+    const image32f grayFloat = to_grayscale_float(gray);
+    for (float threshold : {0.0f, 99.5f, 128.0f, 256.0f}) {
+        EXPECT_TRUE(threshold_bitmask(gray, threshold) == threshold_bitmask(grayFloat, threshold)) << threshold;
+        const image8u expected = threshold_masking(grayFloat, threshold);
+        const image8u actual = threshold_masking(gray, threshold);
+        for (int j = 0; j < gray.height(); ++j)
+            for (int i = 0; i < gray.width(); ++i)
+                ASSERT_EQ(actual(j, i), expected(j, i));
+    }
+}
+
+TEST(threshold_masking, statsMatchMask) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const image32f grayscale = to_grayscale_float(img);
+    const image8u gray8 = to_grayscale_u8(img);
+    for (float threshold : {57.3f, 100.0f, 1000.0f}) {
+        ThresholdStats fromBits, fromBytes, fromFused, fromU8Bits, fromU8Bytes;
+        const BitMask bits = threshold_bitmask(grayscale, threshold, &fromBits);
+        threshold_masking(grayscale, threshold, &fromBytes);
+        threshold_grayscale_bitmask(img, threshold, &fromFused);
+        const BitMask u8bits = threshold_bitmask(gray8, threshold, &fromU8Bits);
+        threshold_masking(gray8, threshold, &fromU8Bytes);
+
+        EXPECT_EQ(fromBits.count, bits.count()) << threshold;
+        EXPECT_EQ(fromBits.bounds.is_empty(), bits.bounds().is_empty());
+        if (!bits.bounds().is_empty()) {
+            EXPECT_EQ(fromBits.bounds.min, bits.bounds().min);
+            EXPECT_EQ(fromBits.bounds.max, bits.bounds().max);
+        }
+        for (const ThresholdStats *s : {&fromBytes, &fromFused}) {
+            EXPECT_EQ(s->count, fromBits.count);
+            EXPECT_EQ(s->bounds.is_empty(), fromBits.bounds.is_empty());
+            EXPECT_EQ(s->bounds.min, fromBits.bounds.min);
+            EXPECT_EQ(s->bounds.max, fromBits.bounds.max);
+        }
+        EXPECT_EQ(fromU8Bits.count, u8bits.count());
+        EXPECT_EQ(fromU8Bytes.count, fromU8Bits.count);
+        EXPECT_EQ(fromU8Bytes.bounds.min, fromU8Bits.bounds.min);
+        EXPECT_EQ(fromU8Bytes.bounds.max, fromU8Bits.bounds.max);
+    }
+
+    image8u single(130, 4, 1);
+    single(2, 100) = 200;
+    ThresholdStats stats;
+    threshold_bitmask(single, 100.0f, &stats);
+    EXPECT_EQ(stats.count, 1u);
+    EXPECT_EQ(stats.bounds.min, point2i(100, 2));
+    EXPECT_EQ(stats.bounds.max, point2i(101, 3));
+}
+
+TEST(threshold_masking, intoDstReusesBufferAndAllowsInPlace) {
+    configureWorkingDirectory();
+
+    const image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const image32f grayFloat = to_grayscale_float(img);
+    image8u gray = to_grayscale_u8(img);
+    const float threshold = 100.0f;
+
+    // a different picture of the same size first, so that reused buffers hold stale values
+    image8u mask;
+    BitMask bits, fusedBits;
+    threshold_masking(grayFloat, mask, 10.0f);
+    threshold_bitmask(grayFloat, bits, 10.0f);
+    threshold_grayscale_bitmask(img, fusedBits, 250.0f);
+    const std::uint8_t *buffer = mask.ptr(0);
+    const BitMask::word_type *words = bits.row(0);
+
+    ThresholdStats stats;
+    threshold_masking(grayFloat, mask, threshold, &stats);
+    threshold_bitmask(grayFloat, bits, threshold);
+    threshold_grayscale_bitmask(img, fusedBits, threshold);
+    EXPECT_EQ(mask.ptr(0), buffer);
+    EXPECT_EQ(bits.row(0), words);
+    EXPECT_EQ(mask.toVector(), threshold_masking(grayFloat, threshold).toVector());
+    EXPECT_TRUE(bits == threshold_bitmask(grayFloat, threshold));
+    EXPECT_TRUE(fusedBits == bits);
+    EXPECT_EQ(stats.count, bits.count());
+
+    const image8u expected = threshold_masking(gray, threshold);
+    threshold_bitmask(gray, bits, threshold);
+    EXPECT_TRUE(bits == threshold_bitmask(gray, threshold));
+    threshold_masking(gray, gray, threshold);
+    EXPECT_EQ(gray.toVector(), expected.toVector());
+}
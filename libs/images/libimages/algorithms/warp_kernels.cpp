@@ -0,0 +1,85 @@
+#include "warp_kernels.h"
+
+#include <libbase/cpu_features.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace warp_kernels {
+
+#if defined(LIBIMAGES_WITH_AVX2)
+// warp_kernels_avx2.cpp (compiled with AVX2 enabled)
+const Kernels &avx2Kernels();
+#endif
+
+namespace {
+
+bool mapRowScalar(const double *m, double x0, double y, int n, float *sx, float *sy) {
+    bool ok = true;
+    for (int i = 0; i < n; ++i) {
+        const double x = x0 + i;
+        const double w = m[6] * x + m[7] * y + m[8];
+        ok = ok && std::abs(w) > 1e-12;
+        sx[i] = static_cast<float>((m[0] * x + m[1] * y + m[2]) / w);
+        sy[i] = static_cast<float>((m[3] * x + m[4] * y + m[5]) / w);
+    }
+    return ok;
+}
+
+std::uint8_t roundToByte(float v) {
+    const long r = std::lround(v);
+    return static_cast<std::uint8_t>(std::clamp(r, 0L, 255L));
+}
+
+void sampleRowScalar(const Source &src, const float *sx, const float *sy, int n, std::uint8_t *dst) {
+    const int W = src.width;
+    const int H = src.height;
+    const int C = src.channels;
+    for (int i = 0; i < n; ++i, dst += 3) {
+        const long mx = std::lround(sx[i]);
+        const long my = std::lround(sy[i]);
+        if (mx < 0 || mx >= src.maskWidth || my < 0 || my >= src.maskHeight) continue;
+        if (src.mask[static_cast<std::size_t>(my) * src.maskStride + static_cast<std::size_t>(mx)] != 255) continue;
+
+        const float x = std::clamp(sx[i], 0.0f, float(W - 1));
+        const float y = std::clamp(sy[i], 0.0f, float(H - 1));
+        const int x0 = static_cast<int>(std::floor(x));
+        const int y0 = static_cast<int>(std::floor(y));
+        const int x1 = std::min(x0 + 1, W - 1);
+        const int y1 = std::min(y0 + 1, H - 1);
+        const float fx = x - float(x0);
+        const float fy = y - float(y0);
+
+        const std::uint8_t *r0 = src.image + static_cast<std::size_t>(y0) * src.stride;
+        const std::uint8_t *r1 = src.image + static_cast<std::size_t>(y1) * src.stride;
+        for (int c = 0; c < 3; ++c) {
+            const int cc = C == 1 ? 0 : c;
+            const float c00 = r0[x0 * C + cc], c10 = r0[x1 * C + cc];
+            const float c01 = r1[x0 * C + cc], c11 = r1[x1 * C + cc];
+            const float top = c00 * (1 - fx) + c10 * fx;
+            const float bottom = c01 * (1 - fx) + c11 * fx;
+            dst[c] = roundToByte(top * (1 - fy) + bottom * fy);
+        }
+    }
+}
+
+} // namespace
+
+const Kernels &scalar() {
+    static const Kernels kernels{"scalar", mapRowScalar, sampleRowScalar};
+    return kernels;
+}
+
+const Kernels *avx2() {
+#if defined(LIBIMAGES_WITH_AVX2)
+    if (cpuFeatures().avx2) return &avx2Kernels();
+#endif
+    return nullptr;
+}
+
+const Kernels &best() {
+    static const Kernels &kernels = avx2() ? *avx2() : scalar();
+    return kernels;
+}
+
+} // namespace warp_kernels
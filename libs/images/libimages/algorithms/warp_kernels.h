@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels behind warpPerspectiveMasked, one implementation per instruction set (picked at runtime by CPU features).
+// All of them do the same IEEE operations in the same order (no fused multiply-add), so results are identical.
+namespace warp_kernels {
+
+// Source image and its mask (255 - object), 1 or 3 channels, rows are stride bytes apart
+struct Source {
+    const std::uint8_t *image = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::size_t stride = 0;
+
+    const std::uint8_t *mask = nullptr;
+    int maskWidth = 0;
+    int maskHeight = 0;
+    std::size_t maskStride = 0;
+};
+
+// Source positions of n pixel centers (x0 + i, y) of a destination row, m is a row-major 3x3 projective map:
+// sx = float((m0 x + m1 y + m2) / w), sy = float((m3 x + m4 y + m5) / w), w = m6 x + m7 y + m8.
+// Numerator and denominator are affine along the row, so only x changes from one pixel to the next.
+// Returns false if |w| <= 1e-12 for some pixel (its position is then undefined).
+using MapRowFn = bool (*)(const double *m, double x0, double y, int n, float *sx, float *sy);
+
+// For every position: if the nearest (std::lround) source pixel is inside of mask and is 255, writes a bilinear sample
+// (coordinates clamped to the image, 1-channel images are replicated to 3 channels) to 3 bytes of dst, otherwise skips them
+using SampleRowFn = void (*)(const Source &src, const float *sx, const float *sy, int n, std::uint8_t *dst);
+
+struct Kernels {
+    const char *name;
+    MapRowFn mapRow;
+    SampleRowFn sampleRow;
+};
+
+// Portable loops
+const Kernels &scalar();
+// nullptr if not compiled in or not supported by current CPU
+const Kernels *avx2();
+// Fastest of the above for current CPU
+const Kernels &best();
+
+} // namespace warp_kernels
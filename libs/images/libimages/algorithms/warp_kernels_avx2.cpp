@@ -0,0 +1,147 @@
+#include "warp_kernels.h"
+
+#include <immintrin.h>
+
+#include <cmath>
+
+namespace warp_kernels {
+
+namespace {
+
+// 4 pixels per step in double precision, exactly the scalar expressions
+bool mapRowAvx2(const double *m, double x0, double y, int n, float *sx, float *sy) {
+    const __m256d vy = _mm256_set1_pd(y);
+    const __m256d uy = _mm256_mul_pd(_mm256_set1_pd(m[1]), vy);
+    const __m256d vyy = _mm256_mul_pd(_mm256_set1_pd(m[4]), vy);
+    const __m256d wy = _mm256_mul_pd(_mm256_set1_pd(m[7]), vy);
+    const __m256d m0 = _mm256_set1_pd(m[0]), m2 = _mm256_set1_pd(m[2]);
+    const __m256d m3 = _mm256_set1_pd(m[3]), m5 = _mm256_set1_pd(m[5]);
+    const __m256d m6 = _mm256_set1_pd(m[6]), m8 = _mm256_set1_pd(m[8]);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+    const __m256d eps = _mm256_set1_pd(1e-12);
+    const __m256d step = _mm256_set1_pd(4.0);
+    const __m256d vx0 = _mm256_set1_pd(x0);
+
+    bool ok = true;
+    int i = 0;
+    __m256d idx = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+    for (; i + 4 <= n; i += 4, idx = _mm256_add_pd(idx, step)) {
+        const __m256d x = _mm256_add_pd(vx0, idx);
+        const __m256d w = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m6, x), wy), m8);
+        ok = ok && _mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(w, absMask), eps, _CMP_GT_OQ)) == 0xF;
+        const __m256d u = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m0, x), uy), m2);
+        const __m256d v = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m3, x), vyy), m5);
+        _mm_storeu_ps(sx + i, _mm256_cvtpd_ps(_mm256_div_pd(u, w)));
+        _mm_storeu_ps(sy + i, _mm256_cvtpd_ps(_mm256_div_pd(v, w)));
+    }
+    for (; i < n; ++i) {
+        const double x = x0 + i;
+        const double w = m[6] * x + m[7] * y + m[8];
+        ok = ok && std::abs(w) > 1e-12;
+        sx[i] = static_cast<float>((m[0] * x + m[1] * y + m[2]) / w);
+        sy[i] = static_cast<float>((m[3] * x + m[4] * y + m[5]) / w);
+    }
+    return ok;
+}
+
+// std::lround for floats: truncated value plus a unit if the fraction (exact in float) is at least a half away
+__m256 roundHalfAwayFromZero(__m256 v) {
+    const __m256 t = _mm256_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256 f = _mm256_sub_ps(v, t);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 up = _mm256_and_ps(_mm256_cmp_ps(f, half, _CMP_GE_OQ), _mm256_set1_ps(1.0f));
+    const __m256 down = _mm256_and_ps(_mm256_cmp_ps(f, _mm256_set1_ps(-0.5f), _CMP_LE_OQ), _mm256_set1_ps(1.0f));
+    return _mm256_sub_ps(_mm256_add_ps(t, up), down);
+}
+
+// 8 pixels per step: nearest mask pixel, clamping, weights and interpolation are vectorized,
+// only the fetches of 4 neighbours of the pixels inside of the mask are scalar
+void sampleRowAvx2(const Source &src, const float *sx, const float *sy, int n, std::uint8_t *dst) {
+    const int C = src.channels;
+    const __m256i maskW = _mm256_set1_epi32(src.maskWidth);
+    const __m256i maskH = _mm256_set1_epi32(src.maskHeight);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 maxX = _mm256_set1_ps(float(src.width - 1));
+    const __m256 maxY = _mm256_set1_ps(float(src.height - 1));
+    const __m256i lastX = _mm256_set1_epi32(src.width - 1);
+    const __m256i lastY = _mm256_set1_epi32(src.height - 1);
+
+    alignas(32) int mx[8], my[8], x0[8], x1[8], y0[8], y1[8];
+    alignas(32) float c[4][3][8];
+    alignas(32) int out[3][8];
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 vx = _mm256_loadu_ps(sx + i);
+        const __m256 vy = _mm256_loadu_ps(sy + i);
+
+        const __m256i nx = _mm256_cvttps_epi32(roundHalfAwayFromZero(vx));
+        const __m256i ny = _mm256_cvttps_epi32(roundHalfAwayFromZero(vy));
+        const __m256i inside = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(nx, minusOne), _mm256_cmpgt_epi32(maskW, nx)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(ny, minusOne), _mm256_cmpgt_epi32(maskH, ny)));
+        int lanes = _mm256_movemask_ps(_mm256_castsi256_ps(inside));
+        if (lanes == 0) continue;
+        _mm256_store_si256(reinterpret_cast<__m256i *>(mx), nx);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(my), ny);
+        for (int l = 0; l < 8; ++l) {
+            if ((lanes >> l & 1) && src.mask[static_cast<std::size_t>(my[l]) * src.maskStride + static_cast<std::size_t>(mx[l])] != 255) {
+                lanes &= ~(1 << l);
+            }
+        }
+        if (lanes == 0) continue;
+
+        const __m256 x = _mm256_min_ps(_mm256_max_ps(vx, zero), maxX);
+        const __m256 y = _mm256_min_ps(_mm256_max_ps(vy, zero), maxY);
+        const __m256i ix0 = _mm256_cvttps_epi32(x);
+        const __m256i iy0 = _mm256_cvttps_epi32(y);
+        const __m256 fx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix0));
+        const __m256 fy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy0));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(x0), ix0);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(y0), iy0);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(x1), _mm256_min_epi32(_mm256_add_epi32(ix0, _mm256_set1_epi32(1)), lastX));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(y1), _mm256_min_epi32(_mm256_add_epi32(iy0, _mm256_set1_epi32(1)), lastY));
+
+        for (int l = 0; l < 8; ++l) {
+            if (!(lanes >> l & 1)) {
+                for (int k = 0; k < 4; ++k) c[k][0][l] = c[k][1][l] = c[k][2][l] = 0.0f;
+                continue;
+            }
+            const std::uint8_t *r0 = src.image + static_cast<std::size_t>(y0[l]) * src.stride;
+            const std::uint8_t *r1 = src.image + static_cast<std::size_t>(y1[l]) * src.stride;
+            const std::uint8_t *p[4] = {r0 + x0[l] * C, r0 + x1[l] * C, r1 + x0[l] * C, r1 + x1[l] * C};
+            for (int k = 0; k < 4; ++k) {
+                for (int ch = 0; ch < 3; ++ch) c[k][ch][l] = p[k][C == 1 ? 0 : ch];
+            }
+        }
+
+        const __m256 gx = _mm256_sub_ps(one, fx);
+        const __m256 gy = _mm256_sub_ps(one, fy);
+        for (int ch = 0; ch < 3; ++ch) {
+            const __m256 top = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(c[0][ch]), gx), _mm256_mul_ps(_mm256_load_ps(c[1][ch]), fx));
+            const __m256 bottom = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(c[2][ch]), gx), _mm256_mul_ps(_mm256_load_ps(c[3][ch]), fx));
+            const __m256 v = _mm256_add_ps(_mm256_mul_ps(top, gy), _mm256_mul_ps(bottom, fy));
+            const __m256i r = _mm256_cvttps_epi32(roundHalfAwayFromZero(v));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(out[ch]), _mm256_min_epi32(_mm256_max_epi32(r, _mm256_setzero_si256()), _mm256_set1_epi32(255)));
+        }
+        for (int l = 0; l < 8; ++l) {
+            if (!(lanes >> l & 1)) continue;
+            std::uint8_t *px = dst + static_cast<std::size_t>(i + l) * 3;
+            px[0] = static_cast<std::uint8_t>(out[0][l]);
+            px[1] = static_cast<std::uint8_t>(out[1][l]);
+            px[2] = static_cast<std::uint8_t>(out[2][l]);
+        }
+    }
+    if (i < n) scalar().sampleRow(src, sx + i, sy + i, n - i, dst + static_cast<std::size_t>(i) * 3);
+}
+
+} // namespace
+
+const Kernels &avx2Kernels() {
+    static const Kernels kernels{"avx2", mapRowAvx2, sampleRowAvx2};
+    return kernels;
+}
+
+} // namespace warp_kernels
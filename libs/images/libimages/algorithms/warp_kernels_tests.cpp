@@ -0,0 +1,118 @@
+#include "warp_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct RandomSource {
+    std::vector<std::uint8_t> image;
+    std::vector<std::uint8_t> mask;
+    warp_kernels::Source source;
+
+    RandomSource(FastRandom &r, int w, int h, int channels) {
+        image.resize(static_cast<size_t>(w) * h * channels);
+        mask.resize(static_cast<size_t>(w) * h);
+        for (std::uint8_t &v : image) v = static_cast<std::uint8_t>(r.nextInt(0, 255));
+        for (std::uint8_t &v : mask) v = r.nextInt(0, 3) == 0 ? 0 : 255;
+        source.image = image.data();
+        source.width = w;
+        source.height = h;
+        source.channels = channels;
+        source.stride = static_cast<size_t>(w) * channels;
+        source.mask = mask.data();
+        source.maskWidth = w;
+        source.maskHeight = h;
+        source.maskStride = static_cast<size_t>(w);
+    }
+};
+
+} // namespace
+
+TEST(warp_kernels, bestIsAvailable) {
+    const warp_kernels::Kernels &best = warp_kernels::best();
+    EXPECT_NE(best.mapRow, nullptr);
+    EXPECT_NE(best.sampleRow, nullptr);
+    std::cout << "warp kernels: " << best.name << std::endl;
+}
+
+TEST(warp_kernels, scalarMapsRowByHomography) {
+    const double m[9] = {2, 0, 1, 0, 1, -3, 0, 0, 1};
+    float sx[3], sy[3];
+    EXPECT_TRUE(warp_kernels::scalar().mapRow(m, 0.5, 10.5, 3, sx, sy));
+    EXPECT_FLOAT_EQ(sx[0], 2.0f);
+    EXPECT_FLOAT_EQ(sx[2], 6.0f);
+    EXPECT_FLOAT_EQ(sy[1], 7.5f);
+
+    const double degenerate[9] = {1, 0, 0, 0, 1, 0, 0, 0, 0};
+    EXPECT_FALSE(warp_kernels::scalar().mapRow(degenerate, 0.0, 0.0, 3, sx, sy));
+}
+
+TEST(warp_kernels, scalarSamplesOnlyInsideOfMask) {
+    const std::uint8_t image[] = {10, 20, 30, 40}; // 2x2, 1 channel
+    const std::uint8_t mask[] = {255, 0, 255, 255};
+    warp_kernels::Source src;
+    src.image = image;
+    src.width = src.height = 2;
+    src.channels = 1;
+    src.stride = 2;
+    src.mask = mask;
+    src.maskWidth = src.maskHeight = 2;
+    src.maskStride = 2;
+
+    const float sx[] = {0.0f, 1.0f, 0.5f, -0.6f, 0.25f};
+    const float sy[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.49f};
+    std::uint8_t dst[15];
+    std::memset(dst, 7, sizeof(dst));
+    warp_kernels::scalar().sampleRow(src, sx, sy, 5, dst);
+    EXPECT_EQ(dst[0], 10);  // exact pixel, replicated to 3 channels
+    EXPECT_EQ(dst[2], 10);
+    EXPECT_EQ(dst[3], 7);   // masked out
+    EXPECT_EQ(dst[6], 35);  // (30 + 40) / 2, nearest (1, 1) is inside
+    EXPECT_EQ(dst[9], 7);   // nearest pixel is outside of mask
+    EXPECT_EQ(dst[12], 22); // 12.5 * 0.51 + 32.5 * 0.49 = 22.3
+}
+
+TEST(warp_kernels, avx2MatchesScalar) {
+    const warp_kernels::Kernels *avx2 = warp_kernels::avx2();
+    if (!avx2) GTEST_SKIP() << "AVX2 kernels are not available";
+
+    FastRandom r(239);
+    for (int channels : {1, 3}) {
+        RandomSource src(r, 37, 23, channels);
+        for (int iter = 0; iter < 50; ++iter) {
+            const int n = r.nextInt(1, 70);
+            std::vector<float> sx(static_cast<size_t>(n)), sy(static_cast<size_t>(n));
+            for (int i = 0; i < n; ++i) {
+                // half-integers hit the rounding ties, the rest spans outside of the image too
+                const bool tie = r.nextInt(0, 3) == 0;
+                sx[i] = tie ? r.nextInt(-4, 80) * 0.5f : r.nextFloat(-3.0f, 40.0f);
+                sy[i] = tie ? r.nextInt(-4, 50) * 0.5f : r.nextFloat(-3.0f, 26.0f);
+            }
+            std::vector<std::uint8_t> expected(static_cast<size_t>(n) * 3, 1);
+            std::vector<std::uint8_t> actual(static_cast<size_t>(n) * 3, 1);
+            warp_kernels::scalar().sampleRow(src.source, sx.data(), sy.data(), n, expected.data());
+            avx2->sampleRow(src.source, sx.data(), sy.data(), n, actual.data());
+            ASSERT_EQ(actual, expected);
+
+            double m[9];
+            for (double &v : m) v = r.nextFloat(-2.0f, 2.0f);
+            m[6] *= 0.01;
+            m[7] *= 0.01;
+            m[8] = 1.0;
+            std::vector<float> ex(static_cast<size_t>(n)), ey(static_cast<size_t>(n));
+            std::vector<float> ax(static_cast<size_t>(n)), ay(static_cast<size_t>(n));
+            const bool expectedOk = warp_kernels::scalar().mapRow(m, 3.5, 7.5, n, ex.data(), ey.data());
+            const bool actualOk = avx2->mapRow(m, 3.5, 7.5, n, ax.data(), ay.data());
+            EXPECT_EQ(actualOk, expectedOk);
+            ASSERT_EQ(ax, ex);
+            ASSERT_EQ(ay, ey);
+        }
+    }
+}
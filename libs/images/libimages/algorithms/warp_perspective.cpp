@@ -0,0 +1,134 @@
+#include "warp_perspective.h"
+
+#include "warp_kernels.h"
+
+#include <libbase/profiler.h>
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct SourceBox {
+    int x0 = 0, y0 = 0, x1 = -1, y1 = -1; // inclusive, empty if x1 < x0
+};
+
+// Bounding box of the 255 pixels of mask
+SourceBox maskBox(const image8u &mask) {
+    SourceBox box;
+    box.x0 = mask.width();
+    box.y0 = mask.height();
+    for (int y = 0; y < mask.height(); ++y) {
+        const std::uint8_t *row = mask.ptr(y);
+        int first = -1, last = -1;
+        for (int x = 0; x < mask.width(); ++x) {
+            if (row[x] != 255) continue;
+            if (first == -1) first = x;
+            last = x;
+        }
+        if (first == -1) continue;
+        box.x0 = std::min(box.x0, first);
+        box.x1 = std::max(box.x1, last);
+        box.y0 = std::min(box.y0, y);
+        box.y1 = y;
+    }
+    return box;
+}
+
+// Pixels [from, to) of destination row y whose centers can map into the box (with a margin of a pixel for roundings).
+// A projective map turns the row into a segment, while w keeps its sign each bound of the source box is a half-line
+// of x, so their intersection is the span. If w changes its sign along the row the whole row is kept.
+void rowSpan(const double *m, const SourceBox &box, int y, int x0, int x1, int &from, int &to) {
+    from = x0;
+    to = x1;
+    const double cy = y + 0.5;
+    const double wa = m[6] * (x0 + 0.5) + m[7] * cy + m[8];
+    const double wb = m[6] * (x1 - 0.5) + m[7] * cy + m[8];
+    if (!(wa > 0 && wb > 0) && !(wa < 0 && wb < 0)) return;
+    const double sign = wa > 0 ? 1.0 : -1.0;
+
+    double lo = x0 + 0.5, hi = x1 - 0.5; // centers
+    // sign * (k * x + c) >= 0, where numerator - bound * w = k * x + c
+    auto clip = [&](double k, double c) {
+        k *= sign;
+        c *= sign;
+        if (k > 0) lo = std::max(lo, -c / k);
+        else if (k < 0) hi = std::min(hi, -c / k);
+        else if (c < 0) hi = lo - 1.0;
+    };
+    const double margin = 1.5;
+    const double wy = m[7] * cy + m[8];
+    const double uy = m[1] * cy + m[2];
+    const double vy = m[4] * cy + m[5];
+    clip(m[0] - (box.x0 - margin) * m[6], uy - (box.x0 - margin) * wy);    // sx >= x0 - margin
+    clip((box.x1 + margin) * m[6] - m[0], (box.x1 + margin) * wy - uy);    // sx <= x1 + margin
+    clip(m[3] - (box.y0 - margin) * m[6], vy - (box.y0 - margin) * wy);    // sy >= y0 - margin
+    clip((box.y1 + margin) * m[6] - m[3], (box.y1 + margin) * wy - vy);    // sy <= y1 + margin
+    if (!(lo <= hi)) {
+        from = to = x0;
+        return;
+    }
+    from = std::max(x0, static_cast<int>(std::floor(lo - 0.5)) - 1);
+    to = std::min(x1, static_cast<int>(std::ceil(hi - 0.5)) + 2);
+    if (from > to) from = to;
+}
+
+} // namespace
+
+void warpPerspectiveMasked(const image8u &src, const image8u &mask, const Homography &dstToSrc,
+                           image8u &dst, int x0, int y0, int x1, int y1, bool with_openmp) {
+    warpPerspectiveMaskedBand(src, mask, dstToSrc, dst, 0, x0, y0, x1, y1, with_openmp);
+}
+
+void warpPerspectiveMaskedBand(const image8u &src, const image8u &mask, const Homography &dstToSrc,
+                               image8u &band, int bandY0, int x0, int y0, int x1, int y1, bool with_openmp) {
+    PROFILE_SCOPE("warpPerspective");
+    rassert(src.width() > 0 && src.height() > 0, 5712390812001);
+    rassert(src.channels() == 1 || src.channels() == 3, 5712390812002, src.channels());
+    rassert(mask.channels() == 1, 5712390812003, mask.channels());
+    rassert(band.channels() == 3, 5712390812004, band.channels());
+
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, bandY0);
+    x1 = std::min(x1, band.width());
+    y1 = std::min(y1, bandY0 + band.height());
+    if (x0 >= x1 || y0 >= y1) return;
+
+    warp_kernels::Source source;
+    source.image = src.ptr(0);
+    source.width = src.width();
+    source.height = src.height();
+    source.channels = src.channels();
+    source.stride = src.stride_elements();
+    source.mask = mask.ptr(0);
+    source.maskWidth = mask.width();
+    source.maskHeight = mask.height();
+    source.maskStride = mask.stride_elements();
+
+    // only the part of every row that can reach the masked pixels is mapped and sampled
+    const SourceBox box = maskBox(mask);
+    if (box.x1 < box.x0) return;
+
+    const warp_kernels::Kernels &kernels = warp_kernels::best();
+    const int n = x1 - x0;
+    bool ok = true;
+
+    #pragma omp parallel if(with_openmp) reduction(&&:ok)
+    {
+        std::vector<float> sx(static_cast<size_t>(n));
+        std::vector<float> sy(static_cast<size_t>(n));
+
+        #pragma omp for schedule(static)
+        for (int y = y0; y < y1; ++y) {
+            int from = x0, to = x1;
+            rowSpan(dstToSrc.m, box, y, x0, x1, from, to);
+            if (from >= to) continue;
+            const bool rowOk = kernels.mapRow(dstToSrc.m, from + 0.5, y + 0.5, to - from, sx.data(), sy.data());
+            ok = ok && rowOk;
+            if (rowOk) kernels.sampleRow(source, sx.data(), sy.data(), to - from, band.ptr(y - bandY0, from));
+        }
+    }
+    rassert(ok, 5712390812005, "Invalid homography w");
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <libimages/image.h>
+
+// Row-major 3x3 projective map of pixel coordinates: (x, y) -> ((m0 x + m1 y + m2) / w, (m3 x + m4 y + m5) / w),
+// w = m6 x + m7 y + m8
+struct Homography final {
+    double m[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+};
+
+// Inverse warping of src (1 or 3 channels) into the rectangle [x0, x1) x [y0, y1) of 3-channel dst (clipped to dst):
+// the center (X + 0.5, Y + 0.5) of every pixel is mapped by dstToSrc, pixels whose nearest source pixel is not 255 in mask
+// (or is outside of it) are left as is, others get a bilinear sample of src (coordinates clamped to src).
+// Rows are processed in parallel by SIMD kernels (see warp_kernels.h), the result does not depend on either.
+void warpPerspectiveMasked(const image8u &src, const image8u &mask, const Homography &dstToSrc,
+                           image8u &dst, int x0, int y0, int x1, int y1, bool with_openmp = true);
+
+// The same into a band of the destination plane: band holds the plane rows [bandY0, bandY0 + band.height()) and
+// the rectangle is in plane coordinates, so a plane rendered band by band gets exactly the pixels of the whole one
+void warpPerspectiveMaskedBand(const image8u &src, const image8u &mask, const Homography &dstToSrc,
+                               image8u &band, int bandY0, int x0, int y0, int x1, int y1, bool with_openmp = true);
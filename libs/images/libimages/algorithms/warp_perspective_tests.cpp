@@ -0,0 +1,169 @@
+#include "warp_perspective.h"
+
+#include "warp_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+image8u randomImage(FastRandom &r, int w, int h, int c) {
+    image8u img(w, h, c);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            for (int ch = 0; ch < c; ++ch) img.at(y, x, ch) = static_cast<std::uint8_t>(r.nextInt(0, 255));
+        }
+    }
+    return img;
+}
+
+image8u fullMask(int w, int h) {
+    image8u mask(w, h, 1);
+    mask.fill(255);
+    return mask;
+}
+
+} // namespace
+
+TEST(warp_perspective, pixelCentersToPixelsCopiesImage) {
+    FastRandom r(1);
+    const image8u src = randomImage(r, 21, 13, 3);
+    image8u dst(21, 13, 3);
+    dst.fill(0);
+    Homography centers; // dst pixel center (x + 0.5, y + 0.5) -> src pixel (x, y)
+    centers.m[2] = -0.5;
+    centers.m[5] = -0.5;
+    warpPerspectiveMasked(src, fullMask(21, 13), centers, dst, 0, 0, 21, 13);
+    for (int y = 0; y < 13; ++y) {
+        for (int x = 0; x < 21; ++x) {
+            for (int c = 0; c < 3; ++c) ASSERT_EQ(dst.at(y, x, c), src.at(y, x, c));
+        }
+    }
+}
+
+TEST(warp_perspective, translationIsClippedAndMasked) {
+    FastRandom r(2);
+    const image8u src = randomImage(r, 10, 10, 1);
+    image8u mask = fullMask(10, 10);
+    mask.at(4, 4) = 0;
+
+    Homography shift;  // dst pixel (x, y) -> src pixel (x - 5, y - 3)
+    shift.m[2] = -5.5;
+    shift.m[5] = -3.5;
+    image8u dst(12, 12, 3);
+    dst.fill(7);
+    warpPerspectiveMasked(src, mask, shift, dst, -100, -100, 100, 100);
+    for (int y = 0; y < 12; ++y) {
+        for (int x = 0; x < 12; ++x) {
+            const int sx = x - 5;
+            const int sy = y - 3;
+            const bool covered = sx >= 0 && sx < 10 && sy >= 0 && sy < 10 && !(sx == 4 && sy == 4);
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_EQ(dst.at(y, x, c), covered ? src.at(sy, sx) : 7) << x << " " << y;
+            }
+        }
+    }
+}
+
+TEST(warp_perspective, sameResultWithoutOpenMP) {
+    FastRandom r(3);
+    const image8u src = randomImage(r, 64, 48, 3);
+    Homography h;
+    const double m[9] = {0.9, 0.1, 2.0, -0.05, 1.1, 1.0, 0.0005, -0.0007, 1.0};
+    for (int i = 0; i < 9; ++i) h.m[i] = m[i];
+    image8u a(80, 60, 3), b(80, 60, 3);
+    a.fill(0);
+    b.fill(0);
+    warpPerspectiveMasked(src, fullMask(64, 48), h, a, 0, 0, 80, 60, true);
+    warpPerspectiveMasked(src, fullMask(64, 48), h, b, 0, 0, 80, 60, false);
+    for (int y = 0; y < 60; ++y) {
+        for (int x = 0; x < 80; ++x) {
+            for (int c = 0; c < 3; ++c) ASSERT_EQ(a.at(y, x, c), b.at(y, x, c));
+        }
+    }
+}
+
+TEST(warp_perspective, bandsMatchTheWholePlane) {
+    FastRandom r(5);
+    const image8u src = randomImage(r, 64, 48, 3);
+    Homography h;
+    const double m[9] = {0.8, -0.1, 3.0, 0.07, 0.9, -2.0, -0.0004, 0.0009, 1.0};
+    for (int i = 0; i < 9; ++i) h.m[i] = m[i];
+    image8u whole(70, 57, 3);
+    whole.fill(0);
+    warpPerspectiveMasked(src, fullMask(64, 48), h, whole, 3, 2, 66, 55);
+    for (int bandRows : {1, 7, 57}) {
+        for (int bandY0 = 0; bandY0 < 57; bandY0 += bandRows) {
+            image8u band(70, std::min(bandRows, 57 - bandY0), 3);
+            band.fill(0);
+            warpPerspectiveMaskedBand(src, fullMask(64, 48), h, band, bandY0, 3, 2, 66, 55);
+            for (int y = 0; y < band.height(); ++y) {
+                for (int x = 0; x < 70; ++x) {
+                    for (int c = 0; c < 3; ++c) ASSERT_EQ(band.at(y, x, c), whole.at(bandY0 + y, x, c));
+                }
+            }
+        }
+    }
+}
+
+TEST(warp_perspective, degenerateHomographyFails) {
+    const image8u src(4, 4, 3);
+    image8u dst(4, 4, 3);
+    Homography h;
+    h.m[8] = 0.0;
+    EXPECT_ANY_THROW(warpPerspectiveMasked(src, fullMask(4, 4), h, dst, 0, 0, 4, 4));
+}
+
+TEST(warp_perspective, rowSpansDoNotLosePixels) {
+    // rows are clipped to the part that maps into the bounding box of the mask, compare with every pixel of them
+    FastRandom r(4);
+    for (int iter = 0; iter < 20; ++iter) {
+        const int w = r.nextInt(5, 40), h = r.nextInt(5, 40);
+        const image8u src = randomImage(r, w, h, 3);
+        image8u mask(w, h, 1);
+        mask.fill(0);
+        const int bx = r.nextInt(0, w - 1), by = r.nextInt(0, h - 1);
+        for (int y = by; y < std::min(h, by + r.nextInt(1, 10)); ++y) {
+            for (int x = bx; x < std::min(w, bx + r.nextInt(1, 10)); ++x) mask.at(y, x) = 255;
+        }
+
+        Homography hom;
+        const double m[9] = {r.nextFloat(0.5f, 1.5f), r.nextFloat(-0.3f, 0.3f), r.nextFloat(-10.0f, 10.0f),
+                             r.nextFloat(-0.3f, 0.3f), r.nextFloat(0.5f, 1.5f), r.nextFloat(-10.0f, 10.0f),
+                             r.nextFloat(-0.002f, 0.002f), r.nextFloat(-0.002f, 0.002f), 1.0};
+        for (int i = 0; i < 9; ++i) hom.m[i] = m[i];
+
+        image8u actual(64, 64, 3), expected(64, 64, 3);
+        actual.fill(1);
+        expected.fill(1);
+        warpPerspectiveMasked(src, mask, hom, actual, 0, 0, 64, 64);
+
+        warp_kernels::Source source;
+        source.image = src.ptr(0);
+        source.width = w;
+        source.height = h;
+        source.channels = 3;
+        source.stride = src.stride_elements();
+        source.mask = mask.ptr(0);
+        source.maskWidth = w;
+        source.maskHeight = h;
+        source.maskStride = mask.stride_elements();
+        std::vector<float> sx(64), sy(64);
+        for (int y = 0; y < 64; ++y) {
+            warp_kernels::scalar().mapRow(hom.m, 0.5, y + 0.5, 64, sx.data(), sy.data());
+            warp_kernels::scalar().sampleRow(source, sx.data(), sy.data(), 64, expected.ptr(y));
+        }
+        for (int y = 0; y < 64; ++y) {
+            for (int x = 0; x < 64; ++x) {
+                for (int c = 0; c < 3; ++c) ASSERT_EQ(actual.at(y, x, c), expected.at(y, x, c)) << iter << ": " << x << " " << y;
+            }
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#include "async_io.h"
+
+#include <utility>
+
+coro::Task<image8u> loadAsync(std::string path, TaskScheduler &scheduler, coro::IoThreads &io) {
+    co_return co_await coro::offload([&path] { return load_image(path); }, scheduler, io);
+}
+
+namespace debug_io {
+
+coro::Task<void> dumpAsync(std::string path, image8u img, SavePreset preset, TaskScheduler &scheduler, coro::IoThreads &io) {
+    co_await coro::offload([&] { dump_image(path, std::move(img), preset); }, scheduler, io);
+}
+
+} // namespace debug_io
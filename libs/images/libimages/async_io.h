@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include <libbase/coro_task.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/debug_io.h>
+#include <libimages/image.h>
+#include <libimages/image_io.h>
+
+// Awaitable image I/O for coroutine pipelines (see libbase/coro_task.h): the blocking part runs on io threads, the
+// awaiting coroutine continues on scheduler, so compute workers never wait for the disk or for a codec.
+
+// load_image off the compute threads, rethrows its load error
+coro::Task<image8u> loadAsync(std::string path, TaskScheduler &scheduler = TaskScheduler::global(),
+                              coro::IoThreads &io = coro::IoThreads::global());
+
+namespace debug_io {
+
+// dump_image of the moved image off the compute threads (queued to AsyncDumps if it is active, as dump_image does)
+coro::Task<void> dumpAsync(std::string path, image8u img, SavePreset preset = SavePreset::Small,
+                           TaskScheduler &scheduler = TaskScheduler::global(), coro::IoThreads &io = coro::IoThreads::global());
+
+} // namespace debug_io
@@ -0,0 +1,51 @@
+#include "async_io.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libimages/tests_utils.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace {
+
+const std::string kImage = "data/00_photo_six_parts_downscaled_x4.jpg";
+
+// Decode, a CPU stage and a debug dump of one image
+coro::Task<int> loadInvertAndDump(std::string path, std::string dumpPath) {
+    image8u image = co_await loadAsync(path);
+    for (int j = 0; j < image.height(); ++j) {
+        std::uint8_t *row = image.ptr(j);
+        for (int i = 0; i < image.width() * image.channels(); ++i) row[i] = 255 - row[i];
+    }
+    const int width = image.width();
+    co_await debug_io::dumpAsync(dumpPath, std::move(image), SavePreset::Fastest);
+    co_return width;
+}
+
+} // namespace
+
+TEST(async_io, pipelinesOfSeveralImagesOverlap) {
+    configureWorkingDirectory();
+
+    const image8u expected = load_image(kImage);
+    const std::string dir = getUnitCaseDebugDir();
+    std::vector<coro::Task<int>> tasks;
+    for (int k = 0; k < 3; ++k) tasks.push_back(loadInvertAndDump(kImage, dir + std::to_string(k) + ".png"));
+    const std::vector<int> widths = coro::syncWait(coro::whenAll(std::move(tasks)));
+
+    ASSERT_EQ(widths.size(), 3u);
+    for (int k = 0; k < 3; ++k) {
+        EXPECT_EQ(widths[k], expected.width());
+        const image8u written = load_image(dir + std::to_string(k) + ".png");
+        ASSERT_EQ(written.size(), expected.size());
+        EXPECT_EQ(written(10, 20, 1), 255 - expected(10, 20, 1));
+    }
+}
+
+TEST(async_io, loadErrorIsRethrown) {
+    configureWorkingDirectory();
+
+    EXPECT_ANY_THROW(coro::syncWait(loadAsync("data/no_such_image.jpg")));
+}
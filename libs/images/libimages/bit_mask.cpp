@@ -0,0 +1,165 @@
+#include "bit_mask.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <bit>
+#include <string>
+
+namespace {
+
+using word_type = BitMask::word_type;
+constexpr int kBits = BitMask::bits_per_word;
+
+// kBits bits of a row starting at bit `bit` (bits past the end of the row are zero)
+inline word_type loadBits(const word_type *row, int words, int bit) {
+    const int k = bit / kBits, s = bit % kBits;
+    word_type v = k < words ? row[k] >> s : 0;
+    if (s != 0 && k + 1 < words) v |= row[k + 1] << (kBits - s);
+    return v;
+}
+
+// Writes the low n (1..kBits) bits of v to a row at bit `bit`, the other bits are kept
+inline void storeBits(word_type *row, int bit, word_type v, int n) {
+    const word_type m = n == kBits ? ~word_type(0) : ((word_type(1) << n) - 1);
+    v &= m;
+    const int k = bit / kBits, s = bit % kBits;
+    row[k] = (row[k] & ~(m << s)) | (v << s);
+    if (s != 0 && s + n > kBits) row[k + 1] = (row[k + 1] & ~(m >> (kBits - s))) | (v >> (kBits - s));
+}
+
+} // namespace
+
+BitMask::BitMask(int width, int height) {
+    rassert(width > 0 && height > 0, "Invalid mask size", width, height);
+    w_ = width;
+    h_ = height;
+    words_per_row_ = (width + bits_per_word - 1) / bits_per_word;
+    words_.assign(static_cast<std::size_t>(words_per_row_) * static_cast<std::size_t>(height), 0);
+}
+
+BitMask BitMask::fromImage(const image8u &mask) {
+    rassert(mask.channels() == 1, 57381902801, mask.channels());
+
+    BitMask res(mask.width(), mask.height());
+    for (int j = 0; j < res.h_; ++j) {
+        const std::uint8_t *src = mask.ptr(j);
+        word_type *dst = res.row(j);
+        for (int i = 0; i < res.w_; ++i) {
+            rassert(src[i] == 0 || src[i] == 255, 57381902802, "mask must be 0/255", int(src[i]));
+            if (src[i]) dst[i / bits_per_word] |= word_type(1) << (i % bits_per_word);
+        }
+    }
+    return res;
+}
+
+image8u BitMask::toImage() const {
+    image8u res(w_, h_, 1, ImageInit::Uninitialized);
+    for (int j = 0; j < h_; ++j) {
+        const word_type *src = row(j);
+        std::uint8_t *dst = res.ptr(j);
+        for (int i = 0; i < w_; ++i) {
+            dst[i] = ((src[i / bits_per_word] >> (i % bits_per_word)) & 1u) ? 255 : 0;
+        }
+    }
+    return res;
+}
+
+bool BitMask::get(int j, int i) const {
+    rassert(i >= 0 && i < w_ && j >= 0 && j < h_, 57381902803,
+            "Pixel out of bounds:", "j=" + std::to_string(j) + "/height=" + std::to_string(h_),
+            "i=" + std::to_string(i) + "/width=" + std::to_string(w_));
+    return test(j, i);
+}
+
+void BitMask::set(int j, int i, bool value) {
+    rassert(i >= 0 && i < w_ && j >= 0 && j < h_, 57381902804,
+            "Pixel out of bounds:", "j=" + std::to_string(j) + "/height=" + std::to_string(h_),
+            "i=" + std::to_string(i) + "/width=" + std::to_string(w_));
+    word_type &word = row(j)[i / bits_per_word];
+    const word_type bit = word_type(1) << (i % bits_per_word);
+    word = value ? (word | bit) : (word & ~bit);
+}
+
+void BitMask::ensureSize(int width, int height) {
+    if (w_ == width && h_ == height) return;
+    rassert(width > 0 && height > 0, "Invalid mask size", width, height);
+    w_ = width;
+    h_ = height;
+    words_per_row_ = (width + bits_per_word - 1) / bits_per_word;
+    // assign keeps the capacity, so a smaller mask after a larger one does not allocate either
+    words_.assign(static_cast<std::size_t>(words_per_row_) * static_cast<std::size_t>(height), 0);
+}
+
+void BitMask::fill(bool value) {
+    if (!value) {
+        std::fill(words_.begin(), words_.end(), 0);
+        return;
+    }
+    std::fill(words_.begin(), words_.end(), ~word_type(0));
+    const word_type tail = last_word_mask();
+    for (int j = 0; j < h_; ++j) {
+        row(j)[words_per_row_ - 1] = tail;
+    }
+}
+
+std::size_t BitMask::count() const noexcept {
+    std::size_t n = 0;
+    for (word_type word : words_) {
+        n += static_cast<std::size_t>(std::popcount(word));
+    }
+    return n;
+}
+
+bbox2i BitMask::bounds() const {
+    bbox2i box;
+    std::vector<word_type> columns(static_cast<std::size_t>(words_per_row_), 0); // OR of the rows that have set pixels
+    int y0 = -1, y1 = -1;
+    for (int j = 0; j < h_; ++j) {
+        const word_type *src = row(j);
+        word_type any = 0;
+        for (int k = 0; k < words_per_row_; ++k) {
+            columns[k] |= src[k];
+            any |= src[k];
+        }
+        if (any) {
+            if (y0 < 0) y0 = j;
+            y1 = j;
+        }
+    }
+    if (y0 < 0) return box;
+    int k0 = 0, k1 = words_per_row_ - 1;
+    while (columns[k0] == 0) ++k0;
+    while (columns[k1] == 0) --k1;
+    box.include_pixel(k0 * bits_per_word + std::countr_zero(columns[k0]), y0);
+    box.include_pixel(k1 * bits_per_word + bits_per_word - 1 - std::countl_zero(columns[k1]), y1);
+    return box;
+}
+
+BitMask BitMask::crop(int x, int y, int width, int height) const {
+    rassert(x >= 0 && y >= 0 && width > 0 && height > 0 && x + width <= w_ && y + height <= h_, 57381902805,
+            x, y, width, height, w_, h_);
+    BitMask res(width, height);
+    for (int j = 0; j < height; ++j) {
+        const word_type *src = row(y + j);
+        word_type *dst = res.row(j);
+        for (int k = 0; k < res.words_per_row_; ++k) dst[k] = loadBits(src, words_per_row_, x + k * bits_per_word);
+        dst[res.words_per_row_ - 1] &= res.last_word_mask();
+    }
+    return res;
+}
+
+void BitMask::paste(const BitMask &src, int x, int y) {
+    rassert(x >= 0 && y >= 0 && x + src.w_ <= w_ && y + src.h_ <= h_, 57381902806, x, y, src.w_, src.h_, w_, h_);
+    for (int j = 0; j < src.h_; ++j) {
+        const word_type *from = src.row(j);
+        word_type *dst = row(y + j);
+        for (int k = 0; k < src.words_per_row_; ++k) {
+            storeBits(dst, x + k * bits_per_word, from[k], std::min(bits_per_word, src.w_ - k * bits_per_word));
+        }
+    }
+}
+
+bool BitMask::operator==(const BitMask &other) const noexcept {
+    return w_ == other.w_ && h_ == other.h_ && words_ == other.words_;
+}
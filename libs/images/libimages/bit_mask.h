@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <libbase/bbox2.h>
+#include <libimages/image.h>
+
+// Binary mask with 64 pixels per word.
+// Pixel (j, i) is bit (i % 64) of word (i / 64) in row j, bits past width() in the last word of each row are always zero.
+// Converts to/from image8u masks (0 = background, 255 = object) used by debug_io and older algorithms.
+class BitMask final {
+  public:
+    using word_type = std::uint64_t;
+    static constexpr int bits_per_word = 64;
+
+    BitMask() = default;
+    // All pixels are zero
+    BitMask(int width, int height);
+
+    // Pixels of the mask must be 0 or 255
+    static BitMask fromImage(const image8u &mask);
+    image8u toImage() const;
+
+    int width() const noexcept { return w_; }
+    int height() const noexcept { return h_; }
+    std::tuple<int, int> size() const noexcept { return {w_, h_}; }
+    int words_per_row() const noexcept { return words_per_row_; }
+
+    bool get(int j, int i) const;
+    void set(int j, int i, bool value);
+
+    // Unchecked versions for hot loops (see LIBIMAGES_CHECKED_FAST_ACCESS)
+    bool test(int j, int i) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(i >= 0 && i < w_, 57381902811, i, w_);
+        return (row(j)[i / bits_per_word] >> (i % bits_per_word)) & 1u;
+    }
+
+    word_type *row(int j) LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(j >= 0 && j < h_, 57381902812, j, h_);
+        return words_.data() + static_cast<std::size_t>(j) * static_cast<std::size_t>(words_per_row_);
+    }
+    const word_type *row(int j) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(j >= 0 && j < h_, 57381902813, j, h_);
+        return words_.data() + static_cast<std::size_t>(j) * static_cast<std::size_t>(words_per_row_);
+    }
+
+    // Mask of meaningful bits in the last word of a row
+    word_type last_word_mask() const noexcept {
+        const int tail = w_ % bits_per_word;
+        return tail == 0 ? ~word_type(0) : ((word_type(1) << tail) - 1);
+    }
+
+    void fill(bool value);
+    // Keeps the words (and whatever bits they have) if the mask already is width x height, otherwise all pixels
+    // become zero, see Image::ensureSize
+    void ensureSize(int width, int height);
+    // Number of set pixels
+    std::size_t count() const noexcept;
+    // Bbox of the set pixels (empty if there are none)
+    bbox2i bounds() const;
+
+    // Region [x, x+width) x [y, y+height) as a mask of its own, by word shifts
+    BitMask crop(int x, int y, int width, int height) const;
+    // Overwrites the region of src size at (x, y) with src
+    void paste(const BitMask &src, int x, int y);
+
+    bool operator==(const BitMask &other) const noexcept;
+    bool operator!=(const BitMask &other) const noexcept { return !(*this == other); }
+
+  private:
+    int w_ = 0;
+    int h_ = 0;
+    int words_per_row_ = 0;
+    std::vector<word_type> words_;
+};
@@ -0,0 +1,110 @@
+#include "bit_mask.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
+#include <libimages/debug_io.h>
+#include <libimages/tests_utils.h>
+
+TEST(bit_mask, roundTripThroughImage) {
+    configureWorkingDirectory();
+
+    // width is not a multiple of 64 to check the padding bits
+    const int w = 131;
+    const int h = 7;
+    image8u img(w, h, 1);
+    FastRandom r(239);
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            img(j, i) = r.nextInt(0, 1) ? 255 : 0;
+        }
+    }
+
+    const BitMask mask = BitMask::fromImage(img);
+    EXPECT_EQ(mask.width(), w);
+    EXPECT_EQ(mask.height(), h);
+    EXPECT_EQ(mask.words_per_row(), 3);
+
+    std::size_t ones = 0;
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            EXPECT_EQ(mask.get(j, i), img(j, i) == 255);
+            ones += img(j, i) == 255;
+        }
+        EXPECT_EQ(mask.row(j)[2] & ~mask.last_word_mask(), 0);
+    }
+    EXPECT_EQ(mask.count(), ones);
+    EXPECT_EQ(mask.toImage().toVector(), img.toVector());
+
+    debug_io::dump_image(getUnitCaseDebugDir() + "mask.png", mask);
+}
+
+TEST(bit_mask, setFillAndCompare) {
+    BitMask a(70, 3);
+    EXPECT_EQ(a.count(), 0);
+
+    a.set(1, 69, true);
+    a.set(2, 0, true);
+    EXPECT_TRUE(a.get(1, 69));
+    EXPECT_TRUE(a.test(2, 0));
+    EXPECT_EQ(a.count(), 2);
+
+    a.set(1, 69, false);
+    EXPECT_EQ(a.count(), 1);
+
+    BitMask b(70, 3);
+    EXPECT_NE(a, b);
+    b.set(2, 0, true);
+    EXPECT_EQ(a, b);
+
+    a.fill(true);
+    EXPECT_EQ(a.count(), 70 * 3);
+    EXPECT_EQ(a.row(0)[1], a.last_word_mask());
+
+    EXPECT_THROW(a.get(3, 0), assertion_error);
+    EXPECT_THROW(a.set(0, 70, true), assertion_error);
+    EXPECT_THROW(BitMask::fromImage(image8u(4, 4, 3)), assertion_error);
+}
+
+TEST(bit_mask, cropPasteAndBounds) {
+    const int w = 203;
+    const int h = 9;
+    BitMask mask(w, h);
+    EXPECT_TRUE(mask.bounds().is_empty());
+    FastRandom r(7);
+    for (int j = 2; j < 7; ++j) {
+        for (int i = 37; i < 170; ++i) {
+            mask.set(j, i, r.nextInt(0, 1) != 0);
+        }
+    }
+    mask.set(2, 37, true);
+    mask.set(6, 169, true);
+    const bbox2i box = mask.bounds();
+    EXPECT_EQ(box.min, point2i(37, 2));
+    EXPECT_EQ(box.max, point2i(170, 7));
+
+    // offsets and widths that are not multiples of 64, so that words are split
+    for (int x: {0, 1, 37, 63, 64, 100}) {
+        const int cw = w - x - 3;
+        const BitMask part = mask.crop(x, 1, cw, 7);
+        for (int j = 0; j < 7; ++j) {
+            for (int i = 0; i < cw; ++i) {
+                ASSERT_EQ(part.get(j, i), mask.get(j + 1, i + x)) << x << " " << j << " " << i;
+            }
+        }
+        EXPECT_EQ(part.row(0)[part.words_per_row() - 1] & ~part.last_word_mask(), 0u);
+
+        BitMask canvas(w, h);
+        canvas.fill(true);
+        canvas.paste(part, x, 1);
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                const bool inside = j >= 1 && j < 8 && i >= x && i < x + cw;
+                ASSERT_EQ(canvas.get(j, i), inside ? mask.get(j, i) : true) << x << " " << j << " " << i;
+            }
+        }
+    }
+    EXPECT_THROW(mask.crop(200, 0, 4, 1), assertion_error);
+    EXPECT_THROW(mask.paste(BitMask(4, 1), 200, 0), assertion_error);
+}
@@ -0,0 +1,66 @@
+#include "chain_contour.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <cstdlib>
+
+namespace {
+
+// Direction of a step to an 8-neighbour, -1 if it is not one
+int directionOf(point2i from, point2i to) {
+    const int dx = to.x - from.x;
+    const int dy = to.y - from.y;
+    if (std::abs(dx) > 1 || std::abs(dy) > 1 || (dx == 0 && dy == 0)) return -1;
+    for (int d = 0; d < 8; ++d) {
+        if (ChainContour::dx[d] == dx && ChainContour::dy[d] == dy) return d;
+    }
+    return -1;
+}
+
+} // namespace
+
+ChainContour::ChainContour(std::span<const point2i> points) : size_(static_cast<int>(points.size())) {
+    if (points.empty()) return;
+    const int steps = size_ - 1;
+    codes_.assign(static_cast<std::size_t>((steps + steps_per_word - 1) / steps_per_word), 0);
+    checkpoints_.reserve(static_cast<std::size_t>((size_ + checkpoint_step - 1) / checkpoint_step));
+    for (int i = 0; i < size_; ++i) {
+        if (i % checkpoint_step == 0) checkpoints_.push_back(points[i]);
+        if (i == steps) break;
+        const int d = directionOf(points[i], points[i + 1]);
+        rassert(d >= 0, 918273701, i, points[i].x, points[i].y, points[i + 1].x, points[i + 1].y);
+        codes_[i / steps_per_word] |= static_cast<std::uint64_t>(d) << (3 * (i % steps_per_word));
+    }
+}
+
+ChainContour ChainContour::fromCodes(point2i first, int size, std::span<const std::uint64_t> codes) {
+    rassert(size >= 0, 918273703, size);
+    ChainContour contour;
+    if (size == 0) return contour;
+    const int steps = size - 1;
+    rassert(codes.size() == static_cast<std::size_t>((steps + steps_per_word - 1) / steps_per_word), 918273704, codes.size(), size);
+    contour.size_ = size;
+    contour.codes_.assign(codes.begin(), codes.end());
+    contour.checkpoints_.reserve(static_cast<std::size_t>((size + checkpoint_step - 1) / checkpoint_step));
+    point2i p = first;
+    for (int i = 0; i < size; ++i) {
+        if (i > 0) advance(p, contour.direction(i - 1));
+        if (i % checkpoint_step == 0) contour.checkpoints_.push_back(p);
+    }
+    return contour;
+}
+
+point2i ChainContour::at(int i) const {
+    rassert(i >= 0 && i < size_, 918273702, i, size_);
+    const int k = i / checkpoint_step;
+    point2i p = checkpoints_[k];
+    for (int j = k * checkpoint_step; j < i; ++j) advance(p, direction(j));
+    return p;
+}
+
+std::vector<point2i> ChainContour::toPoints() const {
+    std::vector<point2i> points;
+    points.reserve(static_cast<std::size_t>(size_));
+    forEach([&](int, point2i p) { points.push_back(p); });
+    return points;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <libbase/point2.h>
+
+// Closed contour of 8-neighbour pixels (as extractContour and traceContour output) stored as a chain code:
+// the first point and a 3-bit direction per step, 21 steps per 64-bit word, plus the point of every
+// checkpoint_step-th index, so that a contour takes ~0.4 byte per pixel instead of sizeof(point2i) and any
+// point is at most checkpoint_step steps away. Sequential walks (Cursor, forEach) decode one step per point.
+class ChainContour final {
+  public:
+    static constexpr int checkpoint_step = 128;
+    static constexpr int steps_per_word = 21;
+
+    ChainContour() = default;
+    // Consecutive points must be 8-neighbours (the last and the first are not checked, the contour is closed)
+    explicit ChainContour(std::span<const point2i> points);
+    // Of the first point and the words of codes() of a contour of size points (f.e. stored in a file),
+    // checkpoints are walked again
+    static ChainContour fromCodes(point2i first, int size, std::span<const std::uint64_t> codes);
+
+    int size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // O(checkpoint_step)
+    point2i at(int i) const;
+    std::vector<point2i> toPoints() const;
+
+    // Walks the contour from a point on, wrapping around after the last one
+    class Cursor final {
+      public:
+        point2i point() const noexcept { return point_; }
+        int index() const noexcept { return index_; }
+        void next() noexcept {
+            if (++index_ == contour_->size_) {
+                index_ = 0;
+                point_ = contour_->checkpoints_[0];
+            } else {
+                ChainContour::advance(point_, contour_->direction(index_ - 1));
+            }
+        }
+
+      private:
+        friend class ChainContour;
+        Cursor(const ChainContour &contour, int index) : contour_(&contour), index_(index), point_(contour.at(index)) {}
+
+        const ChainContour *contour_;
+        int index_;
+        point2i point_;
+    };
+
+    Cursor cursor(int i = 0) const { return Cursor(*this, i); }
+
+    // f(index, point) for every point in order
+    template <typename F>
+    void forEach(F &&f) const {
+        if (size_ == 0) return;
+        point2i p = checkpoints_[0];
+        for (int i = 0; i < size_; ++i) {
+            if (i > 0) advance(p, direction(i - 1));
+            f(i, p);
+        }
+    }
+
+    // (size() - 1 + steps_per_word - 1) / steps_per_word words of 3-bit directions, the first step in the lowest bits
+    std::span<const std::uint64_t> codes() const noexcept { return codes_; }
+
+    std::size_t memoryBytes() const noexcept {
+        return codes_.capacity() * sizeof(std::uint64_t) + checkpoints_.capacity() * sizeof(point2i);
+    }
+
+    bool operator==(const ChainContour &other) const = default;
+
+    // Offsets of directions [0, 8): clockwise from +x in image coords (x right, y down)
+    static constexpr int dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    static constexpr int dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+  private:
+    static void advance(point2i &p, int d) noexcept {
+        p.x += dx[d];
+        p.y += dy[d];
+    }
+
+    // Direction of the step from point i to point i + 1
+    int direction(int i) const noexcept {
+        return static_cast<int>((codes_[i / steps_per_word] >> (3 * (i % steps_per_word))) & 7u);
+    }
+
+    int size_ = 0;
+    std::vector<std::uint64_t> codes_;
+    std::vector<point2i> checkpoints_; // point k * checkpoint_step
+};
@@ -0,0 +1,91 @@
+#include "chain_contour.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+#include <libbase/runtime_assert.h>
+#include <libimages/algorithms/extract_contour.h>
+#include <libimages/image.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Contour of a wobbly disc, so that steps go in all 8 directions
+std::vector<point2i> blobContour(FastRandom &r, int radius) {
+    const int size = 2 * radius + 8;
+    image8u mask(size, size, 1);
+    mask.fill(0);
+    const double a = r.nextFloat() * 0.2, b = r.nextFloat() * 0.2;
+    for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+            const double dx = i - size / 2, dy = j - size / 2;
+            const double angle = std::atan2(dy, dx);
+            const double limit = radius * (1.0 + a * std::sin(3 * angle) + b * std::cos(5 * angle)) / 1.4;
+            if (dx * dx + dy * dy <= limit * limit) mask(j, i) = 255;
+        }
+    }
+    return traceContour(mask);
+}
+
+} // namespace
+
+TEST(chain_contour, pointsRoundTripThroughAllAccessors) {
+    FastRandom r(239);
+    for (int radius : {3, 20, 150}) {
+        const std::vector<point2i> points = blobContour(r, radius);
+        ASSERT_GT(points.size(), 4u);
+        const ChainContour chain(points);
+        ASSERT_EQ(chain.size(), static_cast<int>(points.size()));
+        EXPECT_EQ(chain.toPoints(), points);
+
+        for (int i = 0; i < chain.size(); ++i) EXPECT_EQ(chain.at(i), points[i]) << i;
+
+        std::vector<point2i> visited;
+        chain.forEach([&](int i, point2i p) {
+            EXPECT_EQ(i, static_cast<int>(visited.size()));
+            visited.push_back(p);
+        });
+        EXPECT_EQ(visited, points);
+
+        // a cursor from the middle wraps around to the start
+        const int from = chain.size() / 2 + 1;
+        ChainContour::Cursor cursor = chain.cursor(from);
+        for (int k = 0; k < chain.size() + 3; ++k, cursor.next()) {
+            const int i = (from + k) % chain.size();
+            ASSERT_EQ(cursor.index(), i);
+            ASSERT_EQ(cursor.point(), points[i]);
+        }
+    }
+}
+
+TEST(chain_contour, rebuiltFromCodes) {
+    FastRandom r(23);
+    for (int radius : {3, 40, 300}) {
+        const ChainContour chain(blobContour(r, radius));
+        const ChainContour copy = ChainContour::fromCodes(chain.at(0), chain.size(), chain.codes());
+        EXPECT_EQ(copy, chain);
+        EXPECT_EQ(copy.at(chain.size() - 1), chain.at(chain.size() - 1));
+    }
+    EXPECT_TRUE(ChainContour::fromCodes({1, 2}, 0, {}).empty());
+    EXPECT_EQ(ChainContour::fromCodes({1, 2}, 1, {}).at(0), point2i(1, 2));
+    EXPECT_THROW(ChainContour::fromCodes({0, 0}, 100, {}), assertion_error); // too few words
+}
+
+TEST(chain_contour, compactAndChecked) {
+    FastRandom r(17);
+    const std::vector<point2i> points = blobContour(r, 400);
+    const ChainContour chain(points);
+    EXPECT_LT(chain.memoryBytes() * 15, points.size() * sizeof(point2i));
+
+    EXPECT_TRUE(ChainContour(std::vector<point2i>{}).empty());
+    const ChainContour single(std::vector<point2i>{{5, 7}});
+    EXPECT_EQ(single.size(), 1);
+    EXPECT_EQ(single.at(0), point2i(5, 7));
+
+    // consecutive points must be distinct 8-neighbours
+    EXPECT_THROW(ChainContour(std::vector<point2i>{{0, 0}, {2, 0}}), assertion_error);
+    EXPECT_THROW(ChainContour(std::vector<point2i>{{0, 0}, {0, 0}}), assertion_error);
+    EXPECT_THROW(chain.at(chain.size()), assertion_error);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <type_traits>
+
+#include <libbase/runtime_assert.h>
+
+// Compile-time channel count for image kernels:
+//   dispatch_channels(image.channels(), [&](auto C) { ... });
+// calls the lambda once with C = channels_constant<1>, <3> or <4>, so that loops over channels inside it unroll
+// and loops over pixels vectorize, instead of branching on channels() for every pixel.
+template <int C>
+using channels_constant = std::integral_constant<int, C>;
+
+template <typename F>
+decltype(auto) dispatch_channels(int channels, F &&f) {
+    switch (channels) {
+        case 1: return f(channels_constant<1>{});
+        case 3: return f(channels_constant<3>{});
+        case 4: return f(channels_constant<4>{});
+        default: break;
+    }
+    rassert(false, 7720345001, "Unsupported channel count", channels);
+    return f(channels_constant<1>{}); // unreachable, rassert throws
+}
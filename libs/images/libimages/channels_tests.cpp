@@ -0,0 +1,18 @@
+#include "channels.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/runtime_assert.h>
+
+TEST(channels, dispatchPassesCompileTimeCount) {
+    for (int channels : {1, 3, 4}) {
+        const int seen = dispatch_channels(channels, [](auto C) {
+            static_assert(decltype(C)::value == 1 || decltype(C)::value == 3 || decltype(C)::value == 4);
+            int sum = 0;
+            for (int c = 0; c < C; ++c) ++sum; // C converts to int in loops
+            return sum;
+        });
+        EXPECT_EQ(seen, channels);
+    }
+    EXPECT_THROW(dispatch_channels(2, [](auto) { return 0; }), assertion_error);
+}
@@ -5,61 +5,14 @@
 #include <algorithm>
 #include <string>
 
-template <typename T>
-Color<T>::Color() {
-    init(1);
-    data_[0] = T(0);
-}
-
-template <typename T>
-void Color<T>::init(int channels) {
-    rassert(channels == 1 || channels == 3, "Invalid color channels count", channels);
-    c_ = channels;
-    data_.assign(static_cast<std::size_t>(c_), T(0));
-}
-
-template <typename T>
-Color<T>::Color(T gray) {
-    init(1);
-    data_[0] = gray;
-}
-
-template <typename T>
-Color<T>::Color(T r, T g, T b) {
-    init(3);
-    data_[0] = r;
-    data_[1] = g;
-    data_[2] = b;
-}
-
-template <typename T>
-int Color<T>::channels() const noexcept {
-    return c_;
-}
-
-template <typename T>
-std::tuple<int> Color<T>::size() const noexcept {
-    return {c_};
-}
-
-template <typename T>
-T* Color<T>::data() noexcept {
-    return data_.data();
-}
-
-template <typename T>
-const T* Color<T>::data() const noexcept {
-    return data_.data();
-}
-
 template <typename T>
 std::vector<T> Color<T>::toVector() const {
-    return data_;
+    return std::vector<T>(data_.begin(), data_.begin() + c_);
 }
 
 template <typename T>
 void Color<T>::fill(const T& v) {
-    std::fill(data_.begin(), data_.end(), v);
+    std::fill(data_.begin(), data_.begin() + c_, v);
 }
 
 template <typename T>
@@ -84,7 +37,7 @@ const T& Color<T>::operator()(int c, std::source_location loc) const {
 template <typename T>
 bool Color<T>::operator==(const Color<T>& other) const noexcept {
     if (c_ != other.c_) return false;
-    return data_ == other.data_;
+    return std::equal(data_.begin(), data_.begin() + c_, other.data_.begin());
 }
 
 // Explicit instantiations
@@ -1,25 +1,31 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <cstddef>
 #include <source_location>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 #include <variant>
 
+// Gray or RGB pixel value. Channels are stored inline, so Color is trivially copyable
+// and vectors of colors (side profiles etc.) do not allocate per element.
 template <typename T> class Color final {
 public:
     using value_type = T;
+    static constexpr int max_channels = 3;
 
-    Color();
-    explicit Color(T gray);
-    Color(T r, T g, T b);
+    Color() noexcept : c_(1), data_{} {}
+    explicit Color(T gray) noexcept : c_(1), data_{gray, T(0), T(0)} {}
+    Color(T r, T g, T b) noexcept : c_(3), data_{r, g, b} {}
 
-    int channels() const noexcept;
-    std::tuple<int> size() const noexcept;
+    int channels() const noexcept { return c_; }
+    std::tuple<int> size() const noexcept { return {c_}; }
 
-    T* data() noexcept;
-    const T* data() const noexcept;
+    T* data() noexcept { return data_.data(); }
+    const T* data() const noexcept { return data_.data(); }
+    // Dynamic channel count copy, for code that needs an owning container
     std::vector<T> toVector() const;
 
     void fill(const T& v);
@@ -27,14 +33,17 @@ public:
     T& operator()(int c, std::source_location loc = std::source_location::current());
     const T& operator()(int c, std::source_location loc = std::source_location::current()) const;
 
+    // Unchecked channel access for hot loops
+    T& at(int c) noexcept { return data_[static_cast<std::size_t>(c)]; }
+    const T& at(int c) const noexcept { return data_[static_cast<std::size_t>(c)]; }
+
     bool operator==(const Color& other) const noexcept;
     bool operator!=(const Color& other) const noexcept { return !(*this == other); }
 
 private:
     int c_ = 0;
-    std::vector<T> data_;
+    std::array<T, max_channels> data_{};
 
-    void init(int channels);
     void check_bounds(int c, std::source_location loc) const;
 };
 
@@ -43,3 +52,6 @@ extern template class Color<float>;
 
 using color8u = Color<std::uint8_t>;
 using color32f = Color<float>;
+
+static_assert(std::is_trivially_copyable_v<color8u>);
+static_assert(std::is_trivially_copyable_v<color32f>);
@@ -0,0 +1,26 @@
+#include "color.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(color, inlineChannels) {
+    const color8u gray(static_cast<std::uint8_t>(42));
+    EXPECT_EQ(gray.channels(), 1);
+    EXPECT_EQ(gray(0), 42);
+    EXPECT_EQ(gray.toVector(), std::vector<std::uint8_t>({42}));
+
+    color8u rgb(1, 2, 3);
+    EXPECT_EQ(rgb.channels(), 3);
+    EXPECT_EQ(rgb.at(2), 3);
+    EXPECT_EQ(rgb.toVector(), std::vector<std::uint8_t>({1, 2, 3}));
+
+    color8u copy = rgb;
+    copy.at(0) = 10;
+    EXPECT_EQ(rgb(0), 1);
+    EXPECT_NE(copy, rgb);
+
+    copy.fill(7);
+    EXPECT_EQ(copy, color8u(7, 7, 7));
+    EXPECT_NE(gray, color8u(42, 0, 0));
+}
@@ -1,17 +1,49 @@
 #include "debug_io.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <filesystem>
 #include <iostream>
 #include <libbase/runtime_assert.h>
 #include <libbase/fast_random.h>
+#include <libbase/task_scheduler.h>
 
+#include <libimages/algorithms/convert.h>
+#include <libimages/channels.h>
 #include <libimages/image_io.h>
 #include <limits>
 #include <map>
+#include <vector>
 
 namespace debug_io {
 
+static constexpr int categories_count = static_cast<int>(Category::Assembly) + 1;
+static std::atomic<Level> levels[categories_count] = {Level::All, Level::All, Level::All, Level::All};
+
+static std::atomic<Level> &level_of(Category category) {
+    const int index = static_cast<int>(category);
+    rassert(index >= 0 && index < categories_count, "Unknown debug category", index);
+    return levels[index];
+}
+
+void set_level(Level level) {
+    for (std::atomic<Level> &l: levels) l.store(level);
+}
+
+void set_level(Category category, Level level) {
+    level_of(category).store(level);
+}
+
+Level level(Category category) {
+    return level_of(category).load();
+}
+
+bool enabled(Category category, Level level) {
+    return level != Level::Off && level_of(category).load() >= level;
+}
+
 void ensure_dir_exists_for_file(const std::string &filepath) {
     namespace fs = std::filesystem;
     fs::path p(filepath);
@@ -28,89 +60,311 @@ void ensure_dir_exists_for_file(const std::string &filepath) {
 image8u normalize(const image32f &img, float void_value) {
     rassert(img.channels() == 1 || img.channels() == 3, "normalize expects 1/3-channel float image", img.channels());
 
-    float maxv = 0.0f;
-    for (int j = 0; j < img.height(); ++j) {
-        for (int i = 0; i < img.width(); ++i) {
-            for (int c = 0; c < img.channels(); ++c) {
-                float v = img(j, i, c);
-                if (v == void_value)
-                    continue;
-                maxv = std::max(maxv, v);
-            }
+    const int w = img.width();
+    const int h = img.height();
+    const int n = w * img.channels();
+
+    // per-row maxima reduced afterwards, std::max order as in a serial scan (NaN never wins)
+    std::vector<float> rowMax(static_cast<std::size_t>(h), 0.0f);
+    parallelForEach(0, h, [&](int j) {
+        const float* src = img.ptr(j);
+        float maxv = 0.0f;
+        for (int i = 0; i < n; ++i) {
+            const float v = src[i];
+            maxv = (v != void_value && maxv < v) ? v : maxv;
         }
-    }
+        rowMax[j] = maxv;
+    });
+    float maxv = 0.0f;
+    for (float v : rowMax) maxv = std::max(maxv, v);
 
-    image8u out(img.width(), img.height(), 3);
+    image8u out(w, h, 3, ImageInit::Uninitialized);
 
     const float inv = 255.0f / maxv;
-    for (int j = 0; j < img.height(); ++j) {
-        for (int i = 0; i < img.width(); ++i) {
-            for (int c = 0; c < img.channels(); ++c) {
-                float v = img(j, i, c);
-                if (v == void_value) {
-                    // green pixel if void value
-                    out(j, i, 0) = 0;
-                    out(j, i, 1) = 255;
-                    out(j, i, 2) = 0;
-                    continue;
-                }
-                float x = v * inv;
-                for (int c = 0; c < 3; ++c) {
-                    out(j, i, c) = (uint8_t) std::lround(x);
+    dispatch_channels(img.channels(), [&](auto C) {
+        parallelForEach(0, h, [&](int j) {
+            const float* src = img.ptr(j);
+            std::uint8_t* dst = out.ptr(j);
+            for (int i = 0; i < w; ++i, src += C, dst += 3) {
+                // the last channel wins, a void channel paints the pixel green
+                for (int c = 0; c < C; ++c) {
+                    if (src[c] == void_value) {
+                        dst[0] = 0;
+                        dst[1] = 255;
+                        dst[2] = 0;
+                        continue;
+                    }
+                    const std::uint8_t v = (uint8_t) std::lround(src[c] * inv);
+                    dst[0] = dst[1] = dst[2] = v;
                 }
+                for (int c = C; c < 3; ++c) dst[c] = dst[c - 1];
             }
-            for (int c = img.channels(); c < out.channels(); ++c) {
-                out(j, i, c) = out(j, i, c - 1);
-            }
-        }
-    }
+        });
+    });
     return out;
 }
 
-image8u colorize_labels(const image32i &labels, int void_value, std::uint32_t seed) {
-    rassert(labels.channels() == 1, "colorize_labels expects 1-channel labels", labels.channels());
+image8u normalize(const image16f &img, float void_value) {
+    // void_value is rounded as the stored values were (the default max float becomes infinity)
+    return normalize(to_float32(img), static_cast<float>(float16(void_value)));
+}
+
+namespace {
 
+using label_color = std::array<std::uint8_t, 3>;
+
+label_color random_label_color(FastRandom &r) {
+    const auto red = static_cast<std::uint8_t>(r.nextInt(0, 255));
+    const auto green = static_cast<std::uint8_t>(r.nextInt(0, 255));
+    const auto blue = static_cast<std::uint8_t>(r.nextInt(0, 255));
+    return {red, green, blue};
+}
+
+// Colors are drawn in the order labels first appear in row-major order
+image8u colorize_labels_serial(const image32i &labels, int void_value, std::uint32_t seed) {
     FastRandom r(seed);
-    std::map<int, std::tuple<uint8_t, uint8_t, uint8_t>> mapped_colors;
+    std::map<int, label_color> mapped_colors;
 
     int w = labels.width();
     int h = labels.height();
-    image8u out(w, h, 3);
+    image8u out(w, h, 3, ImageInit::Uninitialized);
     for (int j = 0; j < h; ++j) {
         for (int i = 0; i < w; ++i) {
             const int label = labels(j, i);
+            std::uint8_t *px = out.ptr(j, i);
             if (label == void_value) {
                 // black color
-                out(j, i, 0) = 0;
-                out(j, i, 1) = 0;
-                out(j, i, 2) = 0;
+                px[0] = px[1] = px[2] = 0;
                 continue;
             }
 
-            if (mapped_colors.count(label) == 0) {
-                std::tuple<uint8_t, uint8_t, uint8_t> random_color = {r.nextInt(0, 255), r.nextInt(0, 255), r.nextInt(0, 255)};
-                mapped_colors[label] = random_color;
-            }
+            auto it = mapped_colors.find(label);
+            if (it == mapped_colors.end()) it = mapped_colors.emplace(label, random_label_color(r)).first;
+            std::copy(it->second.begin(), it->second.end(), px);
+        }
+    }
+
+    return out;
+}
+
+} // namespace
+
+image8u colorize_labels(const image32i &labels, int void_value, std::uint32_t seed) {
+    rassert(labels.channels() == 1, "colorize_labels expects 1-channel labels", labels.channels());
+
+    const int w = labels.width();
+    const int h = labels.height();
+
+    // label range, per row in parallel
+    struct Range { int lo = std::numeric_limits<int>::max(), hi = std::numeric_limits<int>::min(); };
+    std::vector<Range> rowRanges(static_cast<std::size_t>(h));
+    parallelForEach(0, h, [&](int j) {
+        const int* row = labels.ptr(j);
+        Range range;
+        for (int i = 0; i < w; ++i) {
+            const int label = row[i];
+            const bool valid = label != void_value;
+            range.lo = (valid && label < range.lo) ? label : range.lo;
+            range.hi = (valid && label > range.hi) ? label : range.hi;
+        }
+        rowRanges[j] = range;
+    });
+    Range range;
+    for (const Range &r : rowRanges) {
+        range.lo = std::min(range.lo, r.lo);
+        range.hi = std::max(range.hi, r.hi);
+    }
 
-            std::tuple<uint8_t, uint8_t, uint8_t> label_color = mapped_colors[label];
-            out(j, i, 0) = std::get<0>(label_color);
-            out(j, i, 1) = std::get<1>(label_color);
-            out(j, i, 2) = std::get<2>(label_color);
+    const std::size_t pixels = static_cast<std::size_t>(w) * h;
+    if (range.lo > range.hi) return colorize_labels_serial(labels, void_value, seed); // all void
+    const std::size_t span = static_cast<std::size_t>(static_cast<std::int64_t>(range.hi) - range.lo) + 1;
+    // sparse labels (f.e. hashes) - a table over the range would not pay off
+    if (span > std::max<std::size_t>(pixels, 1 << 16)) return colorize_labels_serial(labels, void_value, seed);
+
+    // first appearance (row-major index) of every label: the same colors as in the serial order
+    constexpr std::int64_t never = std::numeric_limits<std::int64_t>::max();
+    std::vector<std::atomic<std::int64_t>> first(span);
+    for (std::atomic<std::int64_t> &f : first) f.store(never, std::memory_order_relaxed);
+    parallelForEach(0, h, [&](int j) {
+        const int* row = labels.ptr(j);
+        int prev = void_value;
+        for (int i = 0; i < w; ++i) {
+            const int label = row[i];
+            if (label == void_value || label == prev) continue; // labels come in runs
+            prev = label;
+            std::atomic<std::int64_t> &f = first[static_cast<std::size_t>(static_cast<std::int64_t>(label) - range.lo)];
+            const std::int64_t pos = static_cast<std::int64_t>(j) * w + i;
+            std::int64_t cur = f.load(std::memory_order_relaxed);
+            while (pos < cur && !f.compare_exchange_weak(cur, pos, std::memory_order_relaxed)) {}
         }
+    });
+
+    std::vector<std::pair<std::int64_t, std::size_t>> order; // (first appearance, label - lo)
+    for (std::size_t k = 0; k < span; ++k) {
+        const std::int64_t pos = first[k].load(std::memory_order_relaxed);
+        if (pos != never) order.emplace_back(pos, k);
     }
+    std::sort(order.begin(), order.end());
 
+    FastRandom r(seed);
+    std::vector<label_color> lut(span);
+    for (const auto &[pos, k] : order) lut[k] = random_label_color(r);
+
+    image8u out(w, h, 3, ImageInit::Uninitialized);
+    parallelForEach(0, h, [&](int j) {
+        const int* row = labels.ptr(j);
+        std::uint8_t* dst = out.ptr(j);
+        for (int i = 0; i < w; ++i, dst += 3) {
+            const int label = row[i];
+            if (label == void_value) {
+                dst[0] = dst[1] = dst[2] = 0;
+                continue;
+            }
+            const label_color &c = lut[static_cast<std::size_t>(static_cast<std::int64_t>(label) - range.lo)];
+            dst[0] = c[0];
+            dst[1] = c[1];
+            dst[2] = c[2];
+        }
+    });
     return out;
 }
 
-void dump_image(const std::string &path, const image8u &img) {
+image8u colorize_labels(const image16u &labels, int void_value, std::uint32_t seed) {
+    const image32i widened = to_labels32(labels);
+    return colorize_labels(widened, void_value == std::numeric_limits<std::uint16_t>::max() ? std::numeric_limits<int>::max() : void_value, seed);
+}
+
+static std::atomic<AsyncDumps *> async_dumps{nullptr};
+
+static void write_dump(const AsyncDumps::Dump &dump) {
+    ensure_dir_exists_for_file(dump.path);
+    if (dump.values.width() > 0) {
+        save_npy(dump.values, dump.path);
+        return;
+    }
+    save_image(dump.img, dump.path, dump.options);
+}
+
+// The log line is printed by the caller (so the log order does not depend on the workers)
+template <typename T>
+static void log_dump(const std::string &path, const Image<T> &img) {
     std::cerr << "[debug_io] saving " << path << " (" << img.width() << "x" << img.height() << "x" << img.channels() << ")" << std::endl;
-    ensure_dir_exists_for_file(path);
-    save_image(img, path);
 }
 
-void dump_image(const std::string &path, const image32f &img32f, float void_value) {
-    image8u img = normalize(img32f, void_value);
-    dump_image(path, img);
+static void dump(AsyncDumps::Dump dump) {
+    if (AsyncDumps *async = async_dumps.load()) {
+        async->push(std::move(dump));
+        return;
+    }
+    write_dump(dump);
+}
+
+static void dump_owned_image(const std::string &path, image8u img, SavePreset preset) {
+    log_dump(path, img);
+    dump(AsyncDumps::Dump{path, std::move(img), image32f(), save_options(preset)});
+}
+
+void dump_image(const std::string &path, const image8u &img, SavePreset preset) {
+    log_dump(path, img);
+    if (!async_dumps.load()) {
+        // synchronous write, no copy
+        ensure_dir_exists_for_file(path);
+        save_image(img, path, save_options(preset));
+        return;
+    }
+    dump(AsyncDumps::Dump{path, img, image32f(), save_options(preset)});
+}
+
+void dump_image(const std::string &path, image8u &&img, SavePreset preset) {
+    dump_owned_image(path, std::move(img), preset);
+}
+
+void dump_image(const std::string &path, const image32f &img32f, float void_value, SavePreset preset) {
+    if (std::filesystem::path(path).extension() == ".npy") {
+        log_dump(path, img32f);
+        dump(AsyncDumps::Dump{path, image8u(), img32f, save_options(preset)});
+        return;
+    }
+    dump_owned_image(path, normalize(img32f, void_value), preset);
+}
+
+void dump_image(const std::string &path, const BitMask &mask, SavePreset preset) {
+    dump_owned_image(path, mask.toImage(), preset);
+}
+
+void dump_image(const std::string &path, const RunLengthMask &mask, SavePreset preset) {
+    dump_owned_image(path, mask.toImage(), preset);
+}
+
+AsyncDumps::AsyncDumps() : AsyncDumps(Options{}) {}
+
+AsyncDumps::AsyncDumps(const Options &options) : options_(options) {
+    rassert(options_.threads >= 1, "AsyncDumps needs at least one thread", options_.threads);
+    rassert(options_.maxQueued >= 1, "AsyncDumps queue can't be empty", options_.maxQueued);
+    AsyncDumps *expected = nullptr;
+    rassert(async_dumps.compare_exchange_strong(expected, this), "Only one AsyncDumps can exist at a time");
+    for (int i = 0; i < options_.threads; ++i) threads_.emplace_back([this] { worker(); });
+}
+
+AsyncDumps::~AsyncDumps() {
+    async_dumps.store(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for (std::thread &thread: threads_) thread.join();
+    if (error_) {
+        try {
+            std::rethrow_exception(error_);
+        } catch (const std::exception &e) {
+            std::cerr << "[debug_io] async dump failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+void AsyncDumps::push(Dump dump) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return static_cast<int>(queue_.size()) < options_.maxQueued; });
+    queue_.push_back(std::move(dump));
+    lock.unlock();
+    changed_.notify_all();
+}
+
+void AsyncDumps::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return queue_.empty() && inFlight_ == 0; });
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void AsyncDumps::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return; // stopping and everything is written
+        Dump job = std::move(queue_.front());
+        queue_.pop_front();
+        ++inFlight_;
+        lock.unlock();
+        changed_.notify_all();
+
+        std::exception_ptr error;
+        try {
+            write_dump(job);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        job = Dump{};
+
+        lock.lock();
+        --inFlight_;
+        if (error && !error_) error_ = error;
+        changed_.notify_all();
+    }
 }
 
 } // namespace debug_io
\ No newline at end of file
@@ -1,23 +1,103 @@
 #pragma once
 
-#include <string>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <libimages/bit_mask.h>
 #include <libimages/image.h>
+#include <libimages/image_io.h>
+#include <libimages/run_length_mask.h>
 
 namespace debug_io {
 
+// Which debug visualizations are wanted (process-wide, thread-safe). Callers check enabled() before building an image
+// for dump_image, so with Level::Off nothing is allocated or drawn. By default everything is enabled.
+enum class Category { Segmentation, Objects, Matching, Assembly };
+//   Off     - nothing
+//   Results - final images of the category
+//   Steps   - also intermediate steps
+//   All     - also per-pair plots (expensive: one image per compared pair)
+enum class Level { Off, Results, Steps, All };
+
+void set_level(Level level); // for all categories
+void set_level(Category category, Level level);
+Level level(Category category);
+// true if visualizations of that level are wanted for the category
+bool enabled(Category category, Level level = Level::Results);
+
 // Creates parent directories for a filepath (if needed). No-op if already exists.
 void ensure_dir_exists_for_file(const std::string &filepath);
 
 // Maps float image to 8-bit grayscale using max value (typical for magnitudes, pixels with void_values ignored and colored green).
 image8u normalize(const image32f &img, float void_value=std::numeric_limits<float>::max());
 
+image8u normalize(const image16f &img, float void_value=std::numeric_limits<float>::max());
+
 // Maps each value to random color (except pixels with void_value - they will be colored black)
 image8u colorize_labels(const image32i &labels, int void_value=std::numeric_limits<int>::max(), std::uint32_t seed = 0);
+// Same colors as for the 32-bit labels (see to_labels16)
+image8u colorize_labels(const image16u &labels, int void_value=std::numeric_limits<std::uint16_t>::max(), std::uint32_t seed = 0);
+
+// Save helpers that creates parent directory (if it still doesn't exist).
+// preset trades file size for writing speed (see SavePreset), f.e. SavePreset::Fastest or .ppm/.pgm for intermediate masks.
+// While an AsyncDumps exists, they only queue the image (a copy) and return.
+void dump_image(const std::string &path, const image8u &img, SavePreset preset=SavePreset::Small);
+// Takes img over, so that with an AsyncDumps it is queued without the copy (f.e. a visualization built only to be saved)
+void dump_image(const std::string &path, image8u &&img, SavePreset preset=SavePreset::Small);
+// path with .npy extension saves raw values (see save_npy), otherwise they are normalized (see normalize)
+void dump_image(const std::string &path, const image32f &img, float void_value=std::numeric_limits<float>::max(),
+                SavePreset preset=SavePreset::Small);
+void dump_image(const std::string &path, const BitMask &mask, SavePreset preset=SavePreset::Small); // as 0/255 image
+void dump_image(const std::string &path, const RunLengthMask &mask, SavePreset preset=SavePreset::Small); // as 0/255 image
+
+// Moves encoding and writing of dump_image calls (from any thread) to background workers while it exists,
+// so that debug visualizations stop costing time on the critical path. At most maxQueued images wait to be written,
+// dump_image blocks when the queue is full. Only one can exist at a time.
+class AsyncDumps final {
+  public:
+    struct Options {
+        int threads = 1;
+        int maxQueued = 16;
+    };
+
+    AsyncDumps();
+    explicit AsyncDumps(const Options &options);
+    // Writes everything still queued, write errors are only reported to std::cerr (use flush() to get them)
+    ~AsyncDumps();
+
+    AsyncDumps(const AsyncDumps &) = delete;
+    AsyncDumps &operator=(const AsyncDumps &) = delete;
+
+    // Blocks until all queued images are written, rethrows the first write error since the previous flush()
+    void flush();
+
+    struct Dump {
+        std::string path;
+        image8u img;
+        image32f values; // instead of img for .npy
+        SaveOptions options;
+    };
+
+    // Called by dump_image
+    void push(Dump dump);
+
+  private:
+    void worker();
 
-// Save helpers that creates parent directory (if it still doesn't exist)
-void dump_image(const std::string &path, const image8u &img);
-void dump_image(const std::string &path, const image32f &img, float void_value=std::numeric_limits<float>::max());
+    Options options_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Dump> queue_;
+    int inFlight_ = 0;
+    std::exception_ptr error_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
 
 } // namespace debug_io
\ No newline at end of file
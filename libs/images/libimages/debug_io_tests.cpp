@@ -3,10 +3,15 @@
 #include <gtest/gtest.h>
 
 #include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
 #include <libbase/runtime_assert.h>
 #include <libimages/image_io.h>
 #include <libimages/tests_utils.h>
 
+#include <cmath>
+#include <cstring>
+#include <map>
+
 TEST(debug_io, loadImageAndSaveCopy) {
     configureWorkingDirectory();
 
@@ -43,4 +48,124 @@ TEST(debug_io, colorizeLabels) {
     labels(6, 5) = void_value;
     labels(6, 6) = void_value;
     debug_io::dump_image(getUnitCaseDebugDir() + "colorized32i.jpg", debug_io::colorize_labels(labels, void_value));
-}
\ No newline at end of file
+}
+TEST(debug_io, colorizeLabelsDenseMatchesSparse) {
+    // random labels in runs, first appearances are not in label order
+    FastRandom r(5);
+    image32i dense(300, 200, 1);
+    for (int j = 0; j < dense.height(); ++j) {
+        for (int i = 0; i < dense.width(); ++i) {
+            dense(j, i) = (i % 7 == 0) ? r.nextInt(-1, 400) : dense(j, std::max(0, i - 1));
+        }
+    }
+    // the same partition with labels far apart (no table over their range), colors must be the same
+    image32i sparse(dense.width(), dense.height(), 1);
+    for (int j = 0; j < dense.height(); ++j)
+        for (int i = 0; i < dense.width(); ++i)
+            sparse(j, i) = dense(j, i) == -1 ? -1 : dense(j, i) * 1000003 - 7;
+
+    const image8u fromDense = debug_io::colorize_labels(dense, -1, 3);
+    EXPECT_EQ(fromDense.toVector(), debug_io::colorize_labels(sparse, -1, 3).toVector());
+
+    std::map<int, std::vector<std::uint8_t>> colors;
+    for (int j = 0; j < dense.height(); ++j) {
+        for (int i = 0; i < dense.width(); ++i) {
+            const std::vector<std::uint8_t> c(fromDense.ptr(j, i), fromDense.ptr(j, i) + 3);
+            if (dense(j, i) == -1) {
+                EXPECT_EQ(c, std::vector<std::uint8_t>(3, 0));
+                continue;
+            }
+            auto [it, inserted] = colors.emplace(dense(j, i), c);
+            ASSERT_EQ(it->second, c);
+        }
+    }
+}
+
+TEST(debug_io, normalizeScalesByMaxIgnoringVoid) {
+    const float void_value = -1.0f;
+    image32f img(130, 70, 1);
+    for (int j = 0; j < img.height(); ++j)
+        for (int i = 0; i < img.width(); ++i)
+            img(j, i) = 0.25f * static_cast<float>((i * 3 + j * 5) % 97);
+    img(10, 20) = void_value;
+    const float maxv = 0.25f * 96.0f;
+
+    const image8u out = debug_io::normalize(img, void_value);
+    ASSERT_EQ(out.channels(), 3);
+    for (int j = 0; j < img.height(); ++j) {
+        for (int i = 0; i < img.width(); ++i) {
+            if (img(j, i) == void_value) continue;
+            const std::uint8_t v = static_cast<std::uint8_t>(std::lround(img(j, i) * (255.0f / maxv)));
+            ASSERT_EQ(out(j, i, 0), v);
+            ASSERT_EQ(out(j, i, 2), v);
+        }
+    }
+}
+
+TEST(debug_io, asyncDumpsWriteTheSameFiles) {
+    configureWorkingDirectory();
+
+    image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const std::string dir = getUnitCaseDebugDir();
+    debug_io::dump_image(dir + "sync.png", img);
+    {
+        debug_io::AsyncDumps::Options options;
+        options.threads = 2;
+        options.maxQueued = 1;
+        debug_io::AsyncDumps async(options);
+        for (int i = 0; i < 4; ++i) {
+            debug_io::dump_image(dir + "async/" + std::to_string(i) + ".png", img);
+        }
+        img.fill(0); // the queued images are copies
+        async.flush();
+        EXPECT_THROW(debug_io::AsyncDumps(), assertion_error);
+    }
+
+    const image8u expected = load_image(dir + "sync.png");
+    for (int i = 0; i < 4; ++i) {
+        const image8u written = load_image(dir + "async/" + std::to_string(i) + ".png");
+        ASSERT_EQ(written.size(), expected.size());
+        EXPECT_EQ(std::memcmp(written.data(), expected.data(), expected.stride_elements() * expected.height()), 0);
+    }
+}
+
+TEST(debug_io, asyncDumpTakesMovedImageOver) {
+    configureWorkingDirectory();
+
+    const image8u img = load_image("data/00_photo_six_parts_downscaled_x4.jpg");
+    const std::string dir = getUnitCaseDebugDir();
+    {
+        debug_io::AsyncDumps async;
+        image8u visualization = img;
+        debug_io::dump_image(dir + "moved.png", std::move(visualization));
+        EXPECT_EQ(visualization.data(), nullptr); // queued itself, not a copy
+        async.flush();
+    }
+    const image8u written = load_image(dir + "moved.png");
+    EXPECT_EQ(written.toVector(), img.toVector());
+}
+
+TEST(debug_io, asyncDumpErrorIsRethrownByFlush) {
+    configureWorkingDirectory();
+
+    debug_io::AsyncDumps async;
+    debug_io::dump_image(getUnitCaseDebugDir() + "unsupported.bmp", image8u(4, 4, 3));
+    EXPECT_THROW(async.flush(), assertion_error);
+    debug_io::dump_image(getUnitCaseDebugDir() + "fine.png", image8u(4, 4, 3));
+    EXPECT_NO_THROW(async.flush());
+}
+
+TEST(debug_io, levels) {
+    EXPECT_TRUE(debug_io::enabled(debug_io::Category::Matching, debug_io::Level::All));
+
+    debug_io::set_level(debug_io::Level::Results);
+    debug_io::set_level(debug_io::Category::Objects, debug_io::Level::Off);
+    EXPECT_TRUE(debug_io::enabled(debug_io::Category::Segmentation));
+    EXPECT_FALSE(debug_io::enabled(debug_io::Category::Segmentation, debug_io::Level::Steps));
+    EXPECT_FALSE(debug_io::enabled(debug_io::Category::Objects));
+    EXPECT_FALSE(debug_io::enabled(debug_io::Category::Objects, debug_io::Level::Off));
+    EXPECT_EQ(debug_io::level(debug_io::Category::Objects), debug_io::Level::Off);
+
+    debug_io::set_level(debug_io::Level::All);
+    EXPECT_TRUE(debug_io::enabled(debug_io::Category::Objects, debug_io::Level::Steps));
+}
@@ -1,12 +1,16 @@
 #include "draw.h"
 
 #include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/channels.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
 #include <type_traits>
 #include <variant>
+#include <vector>
 
 namespace {
 
@@ -29,46 +33,102 @@ OutT convertComponent(float v) {
     }
 }
 
+// Components are converted once per call: 1-channel images take the first one (R), 1-channel colors are replicated
 template <typename T, typename C>
-void drawPointImpl(Image<T>& image, point2i pixel, const C& cc, int size) {
+std::array<T, 4> stampValue(ImageView<T> image, const C& cc) {
+    rassert(image.channels() == 1 || image.channels() == 3, 98237124, "Only 1 or 3 channel images supported");
+    std::array<T, 4> v{}; // the 4th one is never used, only keeps the 4-channel instantiation in bounds
+    for (int c = 0; c < 3; ++c) v[c] = convertComponent<T>(cc(cc.channels() == 1 ? 0 : c));
+    return v;
+}
+
+template <typename T, typename C>
+void drawPointImpl(ImageView<T> image, point2i pixel, const C& cc, int size) {
     rassert(pixel.x >= 0 && pixel.x < image.width() && pixel.y >= 0 && pixel.y < image.height(),
             98237123, "Pixel out of bounds");
 
-    for (int y = pixel.y - size / 2; y <= pixel.y + size / 2; ++y) {
-        for (int x = pixel.x - size / 2; x <= pixel.x + size / 2; ++x) {
-            if (x < 0 || x >= image.width() || y < 0 || y >= image.height())
-                continue;
-
-            if (image.channels() == 1) {
-                // If Color<T> is RGB -> use channel 0 (R).
-                const auto v = (cc.channels() == 1) ? cc(0) : cc(0);
-                image(y, x) = convertComponent<T>(v);
-            } else {
-                rassert(image.channels() == 3, 98237124, "Only 1 or 3 channel images supported");
-
-                if (cc.channels() == 1) {
-                    const auto v = convertComponent<T>(cc(0));
-                    image(y, x, 0) = v;
-                    image(y, x, 1) = v;
-                    image(y, x, 2) = v;
-                } else {
-                    image(y, x, 0) = convertComponent<T>(cc(0));
-                    image(y, x, 1) = convertComponent<T>(cc(1));
-                    image(y, x, 2) = convertComponent<T>(cc(2));
-                }
-            }
+    const std::array<T, 4> v = stampValue(image, cc);
+
+    const int x0 = std::max(0, pixel.x - size / 2);
+    const int x1 = std::min(image.width() - 1, pixel.x + size / 2);
+    const int y0 = std::max(0, pixel.y - size / 2);
+    const int y1 = std::min(image.height() - 1, pixel.y + size / 2);
+    dispatch_channels(image.channels(), [&](auto channels) {
+        for (int y = y0; y <= y1; ++y) {
+            T* px = image.ptr(y, x0);
+            for (int x = x0; x <= x1; ++x, px += channels)
+                for (int c = 0; c < channels; ++c) px[c] = v[c];
         }
-    }
+    });
 }
 
-} // namespace
+// Covered pixels of a batch above which rows are filled in parallel
+constexpr long long parallel_min_pixels = 1 << 16;
 
+struct Span {
+    int y, x0, x1; // [x0, x1] of row y
+};
+
+// Union of the squares around in-bounds centers, same pixels as drawPointImpl for each of them, but every
+// covered pixel is written once: squares of a center row are merged into disjoint spans, and each image row fills
+// the union of spans of the center rows within size / 2 of it. Rows are independent, so large batches fill in parallel.
 template <typename T>
-void drawSegment(Image<T>& image, point2i from, point2i to, Color<T> c, int size) {
-    // Allow drawing partially outside, but at least handle empty image
-    rassert(image.width() > 0 && image.height() > 0, 91283712);
+void fillStamps(ImageView<T> image, std::vector<point2i>& centers, const std::array<T, 4>& v, int size) {
+    if (centers.empty()) return;
+    const int half = size / 2;
+    const int w = image.width();
+    const int h = image.height();
+
+    std::sort(centers.begin(), centers.end(), [](point2i a, point2i b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+    std::vector<Span> spans;
+    for (point2i p : centers) {
+        const int x0 = std::max(0, p.x - half);
+        const int x1 = std::min(w - 1, p.x + half);
+        if (!spans.empty() && spans.back().y == p.y && x0 <= spans.back().x1 + 1) {
+            spans.back().x1 = std::max(spans.back().x1, x1);
+        } else {
+            spans.push_back({p.y, x0, x1});
+        }
+    }
+
+    const int rowFrom = std::max(0, spans.front().y - half);
+    const int rowTo = std::min(h, spans.back().y + half + 1);
+    long long covered = 0;
+    for (const Span& span : spans) covered += static_cast<long long>(span.x1 - span.x0 + 1) * (2 * half + 1);
 
-    // Bresenham on integer grid
+    dispatch_channels(image.channels(), [&](auto channels) {
+        parallelFor(rowFrom, rowTo, 0, [&](int from, int to) {
+            std::vector<std::pair<int, int>> row;
+            auto first = std::lower_bound(spans.begin(), spans.end(), from - half,
+                                          [](const Span& span, int y) { return span.y < y; });
+            for (int y = from; y < to; ++y) {
+                while (first != spans.end() && first->y < y - half) ++first;
+                row.clear();
+                for (auto it = first; it != spans.end() && it->y <= y + half; ++it) row.emplace_back(it->x0, it->x1);
+                if (row.empty()) continue;
+                std::sort(row.begin(), row.end());
+
+                auto fill = [&](int x0, int x1) {
+                    T* px = image.ptr(y, x0);
+                    for (int x = x0; x <= x1; ++x, px += channels)
+                        for (int c = 0; c < channels; ++c) px[c] = v[c];
+                };
+                int x0 = row[0].first, x1 = row[0].second;
+                for (std::size_t k = 1; k < row.size(); ++k) {
+                    if (row[k].first > x1 + 1) {
+                        fill(x0, x1);
+                        x0 = row[k].first;
+                    }
+                    x1 = std::max(x1, row[k].second);
+                }
+                fill(x0, x1);
+            }
+        }, covered >= parallel_min_pixels);
+    });
+}
+
+// Bresenham on integer grid, only pixels inside the image (the segment itself may go outside)
+void appendSegmentPixels(int w, int h, point2i from, point2i to, std::vector<point2i>& pixels) {
     int x0 = from.x;
     int y0 = from.y;
     const int x1 = to.x;
@@ -82,10 +142,7 @@ void drawSegment(Image<T>& image, point2i from, point2i to, Color<T> c, int size
     int err = dx - dy;
 
     while (true) {
-        // drawPointImpl already checks bounds for the center pixel, so we must guard it here
-        if (x0 >= 0 && x0 < image.width() && y0 >= 0 && y0 < image.height()) {
-            drawPointImpl(image, point2i{x0, y0}, c, size);
-        }
+        if (x0 >= 0 && x0 < w && y0 >= 0 && y0 < h) pixels.push_back(point2i{x0, y0});
 
         if (x0 == x1 && y0 == y1) break;
 
@@ -96,23 +153,110 @@ void drawSegment(Image<T>& image, point2i from, point2i to, Color<T> c, int size
 }
 
 template <typename T>
-void drawPoint(Image<T>& image, point2i pixel, Color<T> c, int size) {
+void drawPixels(ImageView<T> image, std::vector<point2i>& pixels, const std::array<T, 4>& v, int size) {
+    if (size / 2 > 0) {
+        fillStamps(image, pixels, v, size);
+        return;
+    }
+    // size / 2 == 0 - a stamp is the pixel itself
+    dispatch_channels(image.channels(), [&](auto channels) {
+        for (point2i p : pixels) {
+            T* px = image.ptr(p.y, p.x);
+            for (int c = 0; c < channels; ++c) px[c] = v[c];
+        }
+    });
+}
+
+} // namespace
+
+template <typename T>
+void drawPolyline(ImageView<T> image, std::span<const point2i> vertices, Color<T> c, int size, bool closed) {
+    rassert(image.width() > 0 && image.height() > 0, 91283713);
+    if (vertices.empty()) return;
+    const std::array<T, 4> v = stampValue(image, c);
+
+    std::vector<point2i> pixels;
+    const std::size_t n = vertices.size();
+    const std::size_t segments = (closed && n > 2) ? n : n - 1;
+    if (segments == 0) appendSegmentPixels(image.width(), image.height(), vertices[0], vertices[0], pixels);
+    for (std::size_t i = 0; i < segments; ++i) {
+        appendSegmentPixels(image.width(), image.height(), vertices[i], vertices[(i + 1) % n], pixels);
+    }
+    drawPixels(image, pixels, v, size);
+}
+
+template <typename T>
+void drawSegment(ImageView<T> image, point2i from, point2i to, Color<T> c, int size) {
+    // Allow drawing partially outside, but at least handle empty image
+    rassert(image.width() > 0 && image.height() > 0, 91283712);
+    const std::array<T, 4> v = stampValue(image, c);
+
+    std::vector<point2i> pixels;
+    appendSegmentPixels(image.width(), image.height(), from, to, pixels);
+    drawPixels(image, pixels, v, size);
+}
+
+template <typename T>
+void drawPoint(ImageView<T> image, point2i pixel, Color<T> c, int size) {
     drawPointImpl(image, pixel, c, size);
 }
 
 template <typename T>
-void drawPoints(Image<T>& image, const std::vector<point2i>& pixels, Color<T> c, int size) {
+void drawPoints(ImageView<T> image, std::span<const point2i> pixels, Color<T> c, int size) {
+    if (size / 2 == 0 || pixels.size() <= 1) {
+        for (const auto& p : pixels) {
+            drawPointImpl(image, p, c, size);
+        }
+        return;
+    }
     for (const auto& p : pixels) {
-        drawPoint(image, p, c, size);
+        rassert(p.x >= 0 && p.x < image.width() && p.y >= 0 && p.y < image.height(), 98237123, "Pixel out of bounds");
     }
+    std::vector<point2i> centers(pixels.begin(), pixels.end());
+    fillStamps(image, centers, stampValue(image, c), size);
+}
+
+template <typename T>
+void drawSegment(Image<T>& image, point2i from, point2i to, Color<T> c, int size) {
+    drawSegment(ImageView<T>(image), from, to, c, size);
+}
+
+template <typename T>
+void drawPolyline(Image<T>& image, std::span<const point2i> vertices, Color<T> c, int size, bool closed) {
+    drawPolyline(ImageView<T>(image), vertices, c, size, closed);
+}
+
+template <typename T>
+void drawPoint(Image<T>& image, point2i pixel, Color<T> c, int size) {
+    drawPointImpl(ImageView<T>(image), pixel, c, size);
+}
+
+template <typename T>
+void drawPoints(Image<T>& image, std::span<const point2i> pixels, Color<T> c, int size) {
+    drawPoints(ImageView<T>(image), pixels, c, size);
 }
 
 // Explicit instantiations
 template void drawSegment<std::uint8_t>(Image<std::uint8_t>& image, point2i from, point2i to, Color<uint8_t> c, int size);
 template void drawSegment<float>(Image<float>& image, point2i from, point2i to, Color<float> c, int size);
 
+template void drawPolyline<std::uint8_t>(Image<std::uint8_t>& image, std::span<const point2i> vertices, Color<uint8_t> c, int size, bool closed);
+template void drawPolyline<float>(Image<float>& image, std::span<const point2i> vertices, Color<float> c, int size, bool closed);
+
 template void drawPoint<std::uint8_t>(Image<std::uint8_t>& image, point2i pixel, Color<uint8_t> c, int size);
 template void drawPoint<float>(Image<float>& image, point2i pixel, Color<float> c, int size);
 
-template void drawPoints<std::uint8_t>(Image<std::uint8_t>& image, const std::vector<point2i>& pixels, Color<uint8_t> c, int size);
-template void drawPoints<float>(Image<float>& image, const std::vector<point2i>& pixels, Color<float> c, int size);
+template void drawPoints<std::uint8_t>(Image<std::uint8_t>& image, std::span<const point2i> pixels, Color<uint8_t> c, int size);
+template void drawPoints<float>(Image<float>& image, std::span<const point2i> pixels, Color<float> c, int size);
+
+template void drawSegment<std::uint8_t>(ImageView<std::uint8_t> image, point2i from, point2i to, Color<uint8_t> c, int size);
+template void drawSegment<float>(ImageView<float> image, point2i from, point2i to, Color<float> c, int size);
+
+template void drawPolyline<std::uint8_t>(ImageView<std::uint8_t> image, std::span<const point2i> vertices, Color<uint8_t> c, int size, bool closed);
+template void drawPolyline<float>(ImageView<float> image, std::span<const point2i> vertices, Color<float> c, int size, bool closed);
+
+template void drawPoint<std::uint8_t>(ImageView<std::uint8_t> image, point2i pixel, Color<uint8_t> c, int size);
+template void drawPoint<float>(ImageView<float> image, point2i pixel, Color<float> c, int size);
+
+template void drawPoints<std::uint8_t>(ImageView<std::uint8_t> image, std::span<const point2i> pixels, Color<uint8_t> c, int size);
+template void drawPoints<float>(ImageView<float> image, std::span<const point2i> pixels, Color<float> c, int size);
@@ -1,23 +1,52 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include <libbase/point2.h>
 #include <libimages/image.h>
+#include <libimages/image_view.h>
 
 #include "color.h"
 
+// Points and lines are stamped with squares of side 2 * (size / 2) + 1 (clipped by the image). Thick lines and batches of thick
+// points are rasterized as merged per-row spans, so every covered pixel is written once (large batches in parallel)
+// and the cost follows the covered area rather than the number of stamps times size^2.
+
 template <typename T>
 void drawSegment(Image<T>& image, point2i from, point2i to, Color<T> c, int size=1);
 
+// Segments between consecutive vertices (and from the last one to the first if closed), shared pixels drawn once
+template <typename T>
+void drawPolyline(Image<T>& image, std::span<const point2i> vertices, Color<T> c, int size=1, bool closed=false);
+
 template <typename T>
 void drawPoint(Image<T>& image, point2i pixel, Color<T> c, int size=1);
 
 template <typename T>
-void drawPoints(Image<T>& image, const std::vector<point2i>& pixels, Color<T> c, int size=1);
+void drawPoints(Image<T>& image, std::span<const point2i> pixels, Color<T> c, int size=1);
+
+// Same as above but draw into a view (coordinates are relative to the view)
+template <typename T>
+void drawSegment(ImageView<T> image, point2i from, point2i to, Color<T> c, int size=1);
+
+template <typename T>
+void drawPolyline(ImageView<T> image, std::span<const point2i> vertices, Color<T> c, int size=1, bool closed=false);
+
+template <typename T>
+void drawPoint(ImageView<T> image, point2i pixel, Color<T> c, int size=1);
+
+template <typename T>
+void drawPoints(ImageView<T> image, std::span<const point2i> pixels, Color<T> c, int size=1);
 
 extern template void drawPoint<std::uint8_t>(Image<std::uint8_t>& image, point2i pixel, Color<uint8_t> c, int size);
 extern template void drawPoint<float>(Image<float>& image, point2i pixel, Color<float> c, int size);
 
-extern template void drawPoints<std::uint8_t>(Image<std::uint8_t>& image, const std::vector<point2i>& pixels, Color<uint8_t> c, int size);
-extern template void drawPoints<float>(Image<float>& image, const std::vector<point2i>& pixels, Color<float> c, int size);
+extern template void drawPoints<std::uint8_t>(Image<std::uint8_t>& image, std::span<const point2i> pixels, Color<uint8_t> c, int size);
+extern template void drawPoints<float>(Image<float>& image, std::span<const point2i> pixels, Color<float> c, int size);
+
+extern template void drawPoint<std::uint8_t>(ImageView<std::uint8_t> image, point2i pixel, Color<uint8_t> c, int size);
+extern template void drawPoint<float>(ImageView<float> image, point2i pixel, Color<float> c, int size);
+
+extern template void drawPoints<std::uint8_t>(ImageView<std::uint8_t> image, std::span<const point2i> pixels, Color<uint8_t> c, int size);
+extern template void drawPoints<float>(ImageView<float> image, std::span<const point2i> pixels, Color<float> c, int size);
@@ -4,9 +4,12 @@
 
 #include <libbase/configure_working_directory.h>
 
+#include <libbase/fast_random.h>
 #include <libimages/debug_io.h>
 #include <libimages/tests_utils.h>
 
+#include <vector>
+
 TEST(draw, drawPoint_gray_u8) {
     configureWorkingDirectory();
 
@@ -78,3 +81,49 @@ TEST(draw, rgbColor_to_grayImage_takes_first_channel) {
 
     debug_io::dump_image(getUnitCaseDebugDir() + "draw.jpg", img);
 }
+
+TEST(draw, thickPointsBatchMatchesPointByPoint) {
+    FastRandom r(17);
+    for (int channels : {1, 3}) {
+        for (int size : {2, 3, 5, 10}) {
+            // sparse and dense batches, the dense one is large enough to be filled in parallel
+            for (int n : {40, 20000}) {
+                image8u expected(203, 151, channels);
+                expected.fill(7);
+                image8u actual = expected;
+                std::vector<point2i> pts;
+                for (int k = 0; k < n; ++k) pts.push_back({r.nextInt(0, expected.width() - 1), r.nextInt(0, expected.height() - 1)});
+                const color8u c(200, 100, 50);
+
+                for (const point2i& p : pts) drawPoint(expected, p, c, size);
+                drawPoints(actual, pts, c, size);
+                ASSERT_EQ(actual.toVector(), expected.toVector()) << channels << " " << size << " " << n;
+            }
+        }
+    }
+}
+
+TEST(draw, thickPolylineMatchesSegmentsAndClipsOutside) {
+    const std::vector<point2i> vertices = {{-10, 5}, {40, 30}, {60, -7}, {90, 70}, {20, 55}};
+    for (int size : {1, 4, 7}) {
+        for (bool closed : {false, true}) {
+            image32f expected(80, 60, 3);
+            expected.fill(0.0f);
+            image32f actual = expected;
+            const color32f c(1.0f, 2.0f, 3.0f);
+
+            for (std::size_t i = 0; i + 1 < vertices.size(); ++i) drawSegment(expected, vertices[i], vertices[i + 1], c, size);
+            if (closed) drawSegment(expected, vertices.back(), vertices.front(), c, size);
+            drawPolyline(actual, vertices, c, size, closed);
+            ASSERT_EQ(actual.toVector(), expected.toVector()) << size << " " << closed;
+        }
+    }
+
+    // thick segment covers the stamp of every Bresenham pixel and nothing else
+    image8u img(30, 20, 1);
+    img.fill(0);
+    drawSegment(img, point2i{5, 10}, point2i{24, 10}, color8u(static_cast<std::uint8_t>(255)), 5);
+    for (int y = 0; y < img.height(); ++y)
+        for (int x = 0; x < img.width(); ++x)
+            EXPECT_EQ(img(y, x), (x >= 3 && x <= 26 && y >= 8 && y <= 12) ? 255 : 0) << x << " " << y;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+// IEEE 754 binary16 storage type for intermediate images (image16f): half the bytes of float with 11 significant bits
+// (relative error <= 2^-11, integers up to 2048 are exact, range +-65504). There is no arithmetic: values are converted
+// to float for computations and back for storage (whole rows at once by algorithms/float16_kernels.h, with F16C if available).
+class float16 final {
+  public:
+    float16() = default;
+    explicit float16(float v) noexcept : bits_(fromFloat(v)) {}
+    explicit operator float() const noexcept { return toFloat(bits_); }
+
+    std::uint16_t bits() const noexcept { return bits_; }
+    static float16 fromBits(std::uint16_t bits) noexcept {
+        float16 h;
+        h.bits_ = bits;
+        return h;
+    }
+
+    bool operator==(const float16 &other) const noexcept { return bits_ == other.bits_; }
+
+    // Round to nearest even, values beyond the range become infinities, NaNs stay NaNs
+    static std::uint16_t fromFloat(float v) noexcept {
+        std::uint32_t x = std::bit_cast<std::uint32_t>(v);
+        const std::uint32_t sign = (x >> 16) & 0x8000u;
+        x &= 0x7FFFFFFFu;
+        if (x >= 0x7F800000u) return static_cast<std::uint16_t>(sign | 0x7C00u | (x > 0x7F800000u ? 0x200u | ((x >> 13) & 0x3FFu) : 0u));
+        if (x >= 0x477FF000u) return static_cast<std::uint16_t>(sign | 0x7C00u); // >= 65520 rounds to infinity
+        if (x < 0x38800000u) {
+            // subnormal: adding 0.5 leaves the value in the units of 2^-24 in the low mantissa bits, rounded by the FPU
+            const float shifted = std::bit_cast<float>(x) + 0.5f;
+            return static_cast<std::uint16_t>(sign | (std::bit_cast<std::uint32_t>(shifted) - 0x3F000000u));
+        }
+        const std::uint32_t odd = (x >> 13) & 1u;
+        x += 0xC8000FFFu + odd; // rebias the exponent (-112 << 23) and round to nearest even, a carry bumps the exponent
+        return static_cast<std::uint16_t>(sign | (x >> 13));
+    }
+
+    static float toFloat(std::uint16_t h) noexcept {
+        const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+        const std::uint32_t exponent = (h >> 10) & 0x1Fu;
+        const std::uint32_t mantissa = h & 0x3FFu;
+        if (exponent == 0) {
+            const float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f; // * 2^-24, exact
+            return std::bit_cast<float>(sign | std::bit_cast<std::uint32_t>(magnitude));
+        }
+        if (exponent == 31) return std::bit_cast<float>(sign | 0x7F800000u | (mantissa << 13));
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+  private:
+    std::uint16_t bits_ = 0;
+};
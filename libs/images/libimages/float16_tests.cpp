@@ -0,0 +1,60 @@
+#include "float16.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+TEST(float16, knownValues) {
+    EXPECT_EQ(float16(0.0f).bits(), 0x0000);
+    EXPECT_EQ(float16(-0.0f).bits(), 0x8000);
+    EXPECT_EQ(float16(1.0f).bits(), 0x3C00);
+    EXPECT_EQ(float16(-2.0f).bits(), 0xC000);
+    EXPECT_EQ(float16(65504.0f).bits(), 0x7BFF);                       // max
+    EXPECT_EQ(float16(65519.0f).bits(), 0x7BFF);                       // rounds down to max
+    EXPECT_EQ(float16(65520.0f).bits(), 0x7C00);                       // tie rounds to even: infinity
+    EXPECT_EQ(float16(std::numeric_limits<float>::max()).bits(), 0x7C00);
+    EXPECT_EQ(float16(std::ldexp(1.0f, -14)).bits(), 0x0400);          // min normal
+    EXPECT_EQ(float16(std::ldexp(1.0f, -24)).bits(), 0x0001);          // min subnormal
+    EXPECT_EQ(float16(std::ldexp(1.0f, -25)).bits(), 0x0000);          // tie rounds to even: zero
+    EXPECT_EQ(float16(std::ldexp(3.0f, -25)).bits(), 0x0002);          // 1.5 units, tie rounds to even: 2
+    EXPECT_EQ(float16(2049.0f).bits(), float16(2048.0f).bits());       // tie, 2048 has even mantissa
+    EXPECT_EQ(float16(2051.0f).bits(), float16(2052.0f).bits());
+    EXPECT_TRUE(std::isnan(static_cast<float>(float16(std::numeric_limits<float>::quiet_NaN()))));
+    EXPECT_EQ(static_cast<float>(float16(-std::numeric_limits<float>::infinity())), -std::numeric_limits<float>::infinity());
+
+    for (int v = -2048; v <= 2048; ++v) ASSERT_EQ(static_cast<float>(float16(float(v))), float(v));
+}
+
+TEST(float16, everyValueRoundTrips) {
+    for (std::uint32_t bits = 0; bits <= 0xFFFF; ++bits) {
+        const float16 h = float16::fromBits(static_cast<std::uint16_t>(bits));
+        const float f = static_cast<float>(h);
+        if (std::isnan(f)) {
+            ASSERT_TRUE(std::isnan(static_cast<float>(float16(f)))) << bits;
+            continue;
+        }
+        ASSERT_EQ(float16(f).bits(), bits) << bits;
+    }
+}
+
+#if defined(__FLT16_MAX__)
+TEST(float16, matchesCompilerConversion) {
+    FastRandom r(239);
+    for (int iter = 0; iter < 200000; ++iter) {
+        // random bits cover all exponents, subnormals and rounding ties
+        std::uint32_t bits = static_cast<std::uint32_t>(r.nextInt(0, 0xFFFF)) << 16 | static_cast<std::uint32_t>(r.nextInt(0, 0xFFFF));
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        if (std::isnan(f)) continue;
+        const _Float16 expected = static_cast<_Float16>(f);
+        std::uint16_t expectedBits;
+        std::memcpy(&expectedBits, &expected, sizeof(expectedBits));
+        ASSERT_EQ(float16(f).bits(), expectedBits) << f;
+    }
+}
+#endif
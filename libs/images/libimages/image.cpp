@@ -1,30 +1,128 @@
 #include "image.h"
 
+#include <libbase/memory_tracker.h>
 #include <libbase/runtime_assert.h>
 
 #include <algorithm>
 #include <string>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+template <typename T> const char *memory_category_name();
+template <> const char *memory_category_name<std::uint8_t>() { return "image8u"; }
+template <> const char *memory_category_name<std::uint16_t>() { return "image16u"; }
+template <> const char *memory_category_name<float16>() { return "image16f"; }
+template <> const char *memory_category_name<int>() { return "image32i"; }
+template <> const char *memory_category_name<float>() { return "image32f"; }
+
+template <typename T> int memory_category() {
+    static const int category = memory::category(memory_category_name<T>());
+    return category;
+}
+
+} // namespace
 
 template <typename T> Image<T>::Image() = default;
 
+template <typename T> Image<T>::~Image() { release_buffer(); }
+
+template <typename T> void Image<T>::release_buffer() noexcept {
+    if (buffer_.data() == nullptr) return;
+    memory::freed(memory_category<T>(), buffer_.bytes());
+    buffer_.reset();
+}
+
 template <typename T>
-void Image<T>::init(int width, int height, int channels) {
+void Image<T>::init(int width, int height, int channels, ImageInit init, ImagePool &pool) {
+    static_assert(std::is_trivially_copyable_v<T>, "Image buffers are raw memory");
+    rassert(width > 0 && height > 0 && channels > 0, "Invalid image size", width, height, channels);
     w_ = width;
     h_ = height;
     c_ = channels;
-    data_ = std::vector<T>((size_t) width * height * channels);
-    rassert(width > 0 && height > 0 && channels > 0, "Invalid image size", width, height, channels);
+    release_buffer();
+    buffer_ = pool.acquire(elements_count() * sizeof(T));
+    memory::allocated(memory_category<T>(), buffer_.bytes());
+    data_ = static_cast<T *>(buffer_.data());
+    if (init == ImageInit::Zero) {
+        std::fill(data_, data_ + elements_count(), T());
+    }
 }
 
 template <typename T>
 Image<T>::Image(int width, int height, int channels) {
-    init(width, height, channels);
+    init(width, height, channels, ImageInit::Zero, ImagePool::global());
+}
+
+template <typename T>
+Image<T>::Image(int width, int height, int channels, ImageInit init, ImagePool &pool) {
+    this->init(width, height, channels, init, pool);
 }
 
 template <typename T>
 Image<T>::Image(std::tuple<int, int, int> size) {
     auto [width, height, channels] = size;
-    init(width, height, channels);
+    init(width, height, channels, ImageInit::Zero, ImagePool::global());
+}
+
+template <typename T>
+Image<T>::Image(std::tuple<int, int, int> size, ImageInit init, ImagePool &pool) {
+    auto [width, height, channels] = size;
+    this->init(width, height, channels, init, pool);
+}
+
+template <typename T>
+Image<T>::Image(int width, int height, int channels, ImageBuffer buffer) {
+    static_assert(std::is_trivially_copyable_v<T>, "Image buffers are raw memory");
+    rassert(width > 0 && height > 0 && channels > 0, "Invalid image size", width, height, channels);
+    const std::size_t bytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) *
+                              static_cast<std::size_t>(channels) * sizeof(T);
+    rassert(buffer.bytes() >= bytes, "Buffer is smaller than the image", buffer.bytes(), bytes);
+    w_ = width;
+    h_ = height;
+    c_ = channels;
+    buffer_ = std::move(buffer);
+    memory::allocated(memory_category<T>(), buffer_.bytes());
+    data_ = static_cast<T *>(buffer_.data());
+}
+
+template <typename T>
+Image<T>::Image(const Image &other) {
+    *this = other;
+}
+
+template <typename T>
+Image<T> &Image<T>::operator=(const Image &other) {
+    if (this == &other) return *this;
+    if (other.data_ == nullptr) {
+        *this = Image();
+        return *this;
+    }
+    if (size() != other.size()) {
+        ImagePool &pool = other.buffer_.pool() ? *other.buffer_.pool() : ImagePool::global();
+        init(other.w_, other.h_, other.c_, ImageInit::Uninitialized, pool);
+    }
+    std::copy(other.data_, other.data_ + other.elements_count(), data_);
+    return *this;
+}
+
+template <typename T>
+Image<T>::Image(Image &&other) noexcept
+    : w_(std::exchange(other.w_, 0)), h_(std::exchange(other.h_, 0)), c_(std::exchange(other.c_, 0)),
+      buffer_(std::move(other.buffer_)), data_(std::exchange(other.data_, nullptr)) {}
+
+template <typename T>
+Image<T> &Image<T>::operator=(Image &&other) noexcept {
+    if (this != &other) {
+        w_ = std::exchange(other.w_, 0);
+        h_ = std::exchange(other.h_, 0);
+        c_ = std::exchange(other.c_, 0);
+        release_buffer();
+        buffer_ = std::move(other.buffer_);
+        data_ = std::exchange(other.data_, nullptr);
+    }
+    return *this;
 }
 
 template <typename T> int Image<T>::width() const noexcept { return w_; }
@@ -39,16 +137,23 @@ template <typename T> std::size_t Image<T>::stride_elements() const noexcept {
     return static_cast<std::size_t>(w_) * static_cast<std::size_t>(c_);
 }
 
-template <typename T> T *Image<T>::data() noexcept { return data_.data(); }
+template <typename T> T *Image<T>::data() noexcept { return data_; }
 
-template <typename T> const T *Image<T>::data() const noexcept { return data_.data(); }
+template <typename T> const T *Image<T>::data() const noexcept { return data_; }
 
 template <typename T> std::vector<T> Image<T>::toVector() const {
-    std::vector<T> copy = data_;
-    return copy;
+    return std::vector<T>(data_, data_ + elements_count());
 }
 
-template <typename T> void Image<T>::fill(const T &value) { std::fill(data_.begin(), data_.end(), value); }
+template <typename T> void Image<T>::toVector(std::vector<T> &out) const { out.assign(data_, data_ + elements_count()); }
+
+template <typename T> void Image<T>::fill(const T &value) { std::fill(data_, data_ + elements_count(), value); }
+
+template <typename T> void Image<T>::ensureSize(int width, int height, int channels) {
+    if (data_ != nullptr && w_ == width && h_ == height && c_ == channels) return;
+    ImagePool &pool = buffer_.pool() ? *buffer_.pool() : ImagePool::global();
+    init(width, height, channels, ImageInit::Uninitialized, pool);
+}
 
 template <typename T> void Image<T>::check_bounds_2d(int j, int i, std::source_location loc) const {
     rassert(i >= 0 && i < w_ && j >= 0 && j < h_, 78497218931,
@@ -94,5 +199,7 @@ template <typename T> const T &Image<T>::operator()(int j, int i, int c, std::so
 
 // Explicit instantiations (avoid recompiling template code in every TU)
 template class Image<std::uint8_t>;
+template class Image<std::uint16_t>;
+template class Image<float16>;
 template class Image<int>;
 template class Image<float>;
@@ -3,15 +3,54 @@
 #include <cstddef>
 #include <cstdint>
 #include <source_location>
+#include <span>
+#include <tuple>
 #include <vector>
 
+#include <libbase/runtime_assert.h>
+#include <libimages/float16.h>
+#include <libimages/image_pool.h>
+
+// Bounds checks in fast accessors (row/ptr/at) are compiled out unless LIBIMAGES_CHECKED_FAST_ACCESS is defined.
+// libimages defines it PUBLIC with LIBIMAGES_ASSERT_LEVEL >= 2 (or LIBIMAGES_CHECKED_FAST_ACCESS=ON, when hunting
+// an out-of-bounds bug), so every translation unit that inlines them has the same definition (not RASSERT_LEVEL,
+// which is per translation unit, see libbase/runtime_assert.h).
+// Checked operator() is always checked regardless of this flag.
+// The fast accessors are noexcept only without the checks, so that a failed one throws assertion_error (not terminate).
+#if defined(LIBIMAGES_CHECKED_FAST_ACCESS)
+#define LIBIMAGES_FAST_ACCESS_CHECK(condition, ...) rassert((condition), ##__VA_ARGS__)
+#define LIBIMAGES_FAST_ACCESS_NOEXCEPT
+#else
+#define LIBIMAGES_FAST_ACCESS_CHECK(condition, ...) rassert_disabled(condition)
+#define LIBIMAGES_FAST_ACCESS_NOEXCEPT noexcept
+#endif
+
+// Zero - pixels are value-initialized (default), Uninitialized - for outputs that get fully overwritten anyway
+enum class ImageInit { Zero, Uninitialized };
+
+// Pixels are stored in a 64-byte aligned ImageBuffer taken from ImagePool::global() (or from the given pool),
+// so that temporaries of the same size are recycled instead of being allocated again.
+// Bytes of the buffers held by images are counted per pixel type as memory categories "image8u", "image16u",
+// "image16f", "image32i" and "image32f" (see libbase/memory_tracker.h).
 template <typename T> class Image final {
   public:
     using value_type = T;
 
     Image();
     Image(int width, int height, int channels);
+    Image(int width, int height, int channels, ImageInit init, ImagePool &pool = ImagePool::global());
     Image(std::tuple<int, int, int> size);
+    Image(std::tuple<int, int, int> size, ImageInit init, ImagePool &pool = ImagePool::global());
+    // Adopts buffer (of at least width * height * channels elements, f.e. already filled by a decoder) as the pixels
+    // without a copy
+    Image(int width, int height, int channels, ImageBuffer buffer);
+
+    // Copy gets its own buffer from the same pool
+    Image(const Image &other);
+    Image &operator=(const Image &other);
+    Image(Image &&other) noexcept;
+    Image &operator=(Image &&other) noexcept;
+    ~Image();
 
     int width() const noexcept;
     int height() const noexcept;
@@ -24,9 +63,17 @@ template <typename T> class Image final {
     T *data() noexcept;
     const T *data() const noexcept;
     std::vector<T> toVector() const;
+    // Into out, reusing its capacity (f.e. the same vector for every frame); pixels live in an ImageBuffer of the pool,
+    // so a vector can not take them over and there is no toVector() &&
+    void toVector(std::vector<T> &out) const;
 
     void fill(const T &value);
 
+    // Keeps the buffer (and whatever pixels it has) if the image already is width x height x channels, otherwise takes
+    // an uninitialized buffer of that size from the pool of the current one: for destinations of algorithms that are
+    // owned by the caller and reused, so that processing of same-sized inputs allocates nothing
+    void ensureSize(int width, int height, int channels);
+
     // Access for grayscale images (channels == 1)
     T &operator()(int j, int i, std::source_location loc = std::source_location::current());
     const T &operator()(int j, int i, std::source_location loc = std::source_location::current()) const;
@@ -35,21 +82,66 @@ template <typename T> class Image final {
     T &operator()(int j, int i, int c, std::source_location loc = std::source_location::current());
     const T &operator()(int j, int i, int c, std::source_location loc = std::source_location::current()) const;
 
+    // Fast path for hot loops: no bounds checks (see LIBIMAGES_CHECKED_FAST_ACCESS) and no source_location.
+    // Row j consists of stride_elements() interleaved values: [px0c0, px0c1, ..., px1c0, ...].
+    // Next row starts exactly stride_elements() after the previous one.
+    T *ptr(int j) LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(j >= 0 && j < h_, 78497218932, j, h_);
+        return data_ + static_cast<std::size_t>(j) * row_elements();
+    }
+    const T *ptr(int j) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(j >= 0 && j < h_, 78497218933, j, h_);
+        return data_ + static_cast<std::size_t>(j) * row_elements();
+    }
+
+    // Pointer to the first channel of pixel (j, i)
+    T *ptr(int j, int i) LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(i >= 0 && i < w_, 78497218934, i, w_);
+        return ptr(j) + static_cast<std::size_t>(i) * static_cast<std::size_t>(c_);
+    }
+    const T *ptr(int j, int i) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(i >= 0 && i < w_, 78497218935, i, w_);
+        return ptr(j) + static_cast<std::size_t>(i) * static_cast<std::size_t>(c_);
+    }
+
+    std::span<T> row(int j) LIBIMAGES_FAST_ACCESS_NOEXCEPT { return {ptr(j), row_elements()}; }
+    std::span<const T> row(int j) const LIBIMAGES_FAST_ACCESS_NOEXCEPT { return {ptr(j), row_elements()}; }
+
+    // Unchecked counterpart of operator()
+    T &at(int j, int i, int c = 0) LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(c >= 0 && c < c_, 65735424322, c, c_);
+        return ptr(j, i)[c];
+    }
+    const T &at(int j, int i, int c = 0) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(c >= 0 && c < c_, 65735424323, c, c_);
+        return ptr(j, i)[c];
+    }
+
   private:
     int w_ = 0;
     int h_ = 0;
     int c_ = 0;
-    std::vector<T> data_;
+    ImageBuffer buffer_;
+    T *data_ = nullptr; // == buffer_.data()
+
+    std::size_t row_elements() const noexcept { return static_cast<std::size_t>(w_) * static_cast<std::size_t>(c_); }
+    std::size_t elements_count() const noexcept { return row_elements() * static_cast<std::size_t>(h_); }
 
-    void init(int w, int h, int c);
+    void init(int w, int h, int c, ImageInit init, ImagePool &pool);
+    void release_buffer() noexcept;
     void check_bounds_2d(int j, int i, std::source_location loc) const;
     void check_bounds_3d(int j, int i, int c, std::source_location loc) const;
     std::size_t index(int j, int i, int c) const;
 };
 
 extern template class Image<std::uint8_t>;
+extern template class Image<std::uint16_t>;
+extern template class Image<float16>;
+extern template class Image<int>;
 extern template class Image<float>;
 
 using image8u = Image<std::uint8_t>;
+using image16u = Image<std::uint16_t>; // f.e. labels of up to 65535 objects
+using image16f = Image<float16>;       // f.e. float intermediates that tolerate 11 significant bits
 using image32i = Image<int>;
 using image32f = Image<float>;
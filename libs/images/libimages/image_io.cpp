@@ -1,19 +1,29 @@
 #include <libimages/image_io.h>
 
 #include <algorithm>
+#include <bit>
 #include <cctype>
+#include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <filesystem>
+#include <fstream>
 #include <string>
 #include <vector>
 
 #include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/algorithms/downsample.h>
+#include <libimages/mapped_file.h>
+#include <libimages/png_stream_writer.h>
 
 #define LIBIMAGES_USE_STB
 
 #if defined(LIBIMAGES_USE_STB)
 #include <stb_image.h>
+#include <stb_image_allocator.h>
 #include <stb_image_write.h>
 #elif defined(LIBIMAGES_USE_SYSTEM)
 #include <jpeglib.h>
@@ -36,87 +46,354 @@ static std::string file_ext_lower(const std::string &path) {
     return to_lower_copy(path.substr(pos + 1));
 }
 
-} // namespace libimages
+static void check_load_options(const LoadOptions &options) {
+    const int d = options.scale_denom;
+    rassert(d == 1 || d == 2 || d == 4 || d == 8, "Unsupported scale_denom (expected 1, 2, 4 or 8)", d);
+}
+
+// Keeps the first exception of the sink, so that it does not unwind through C encoders (f.e. libjpeg, libpng or stb
+// callbacks), all writes after it are skipped. rethrow() after the encoder is done.
+class SinkGuard {
+  public:
+    explicit SinkGuard(const ImageSink &sink) : sink_(sink) {}
+
+    void write(const void *data, std::size_t size) noexcept {
+        if (error_ || size == 0)
+            return;
+        try {
+            sink_(static_cast<const std::uint8_t *>(data), size);
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    void rethrow() {
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+  private:
+    const ImageSink &sink_;
+    std::exception_ptr error_;
+};
+
+// Binary P6 (ppm: 3 channels, alpha is dropped row by row) or P5 (pgm: 1 channel)
+static void encode_pnm(const image8u &img, bool gray, const ImageSink &sink) {
+    const int w = img.width();
+    const int h = img.height();
+    const int c = img.channels();
+    if (gray) {
+        rassert(c == 1, "PGM expects 1-channel image", c);
+    } else {
+        rassert(c == 3 || c == 4, "PPM expects 3/4-channel image", c);
+    }
+
+    const std::string header = std::string(gray ? "P5" : "P6") + "\n" + std::to_string(w) + " " + std::to_string(h) + "\n255\n";
+    sink(reinterpret_cast<const std::uint8_t *>(header.data()), header.size());
+    std::vector<std::uint8_t> rgb(c == 4 ? static_cast<std::size_t>(w) * 3 : 0);
+    for (int j = 0; j < h; ++j) {
+        const std::uint8_t *src = img.ptr(j);
+        if (c != 4) {
+            sink(src, static_cast<std::size_t>(w) * static_cast<std::size_t>(c));
+            continue;
+        }
+        for (int i = 0; i < w; ++i) {
+            rgb[3 * i + 0] = src[4 * i + 0];
+            rgb[3 * i + 1] = src[4 * i + 1];
+            rgb[3 * i + 2] = src[4 * i + 2];
+        }
+        sink(rgb.data(), rgb.size());
+    }
+}
+
+// Backend encoders (defined below), the sink gets the bytes as soon as the backend produces them
+static void encode_png(const image8u &img, const ImageSink &sink);
+static void encode_jpeg(const image8u &img, int quality, const ImageSink &sink);
+
+// A thread of PngStreamWriter deflates at about 0.8 of the speed of stb (into a file about 10% smaller),
+// so on large images (f.e. assembled canvases) its pieces in parallel win already with two threads
+static bool parallel_png_is_faster(const image8u &img) {
+    constexpr std::size_t min_pixels = std::size_t(1) << 20;
+    return static_cast<std::size_t>(img.width()) * static_cast<std::size_t>(img.height()) >= min_pixels &&
+           TaskScheduler::global().concurrency() >= 2;
+}
+
+static bool is_supported_output_format(const std::string &ext) {
+    return ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "ppm" || ext == "pgm";
+}
+
+// Fallback of LoadOptions::scale_denom for decoders without reduced-size decoding
+static image8u reduce_decoded(image8u img, int scale_denom) {
+    if (scale_denom == 1)
+        return img;
+    const int w = (img.width() + scale_denom - 1) / scale_denom;
+    const int h = (img.height() + scale_denom - 1) / scale_denom;
+    return downsample(img, w, h, DownsampleMethod::Area);
+}
 
 #if defined(LIBIMAGES_USE_STB)
 
-image8u load_image(const std::string &path) {
-    const std::filesystem::path p = std::filesystem::u8path(path);
-    rassert(std::filesystem::exists(p),
-            "Please check working directory and relative input file path - input file does not exist", path);
-    rassert(std::filesystem::is_regular_file(p), "Input path is not a regular file", path);
+// While a decode runs on this thread, the first stb allocation of the output size (JPEG adds a spare byte) comes from
+// ImagePool, so that the decoder writes the pixels straight into the storage of the image.
+// If another buffer of that size is allocated first, the output is allocated later (after that one is freed) or
+// it comes from malloc and is copied.
+struct stb_decode_target {
+    std::size_t bytes = 0;
+    ImageBuffer buffer;
+    void *claimed = nullptr;
+};
+
+static thread_local stb_decode_target *decode_target = nullptr;
+
+static void *stb_target_malloc(std::size_t size) {
+    stb_decode_target *target = decode_target;
+    if (target && !target->claimed && (size == target->bytes || size == target->bytes + 1)) {
+        target->buffer = ImagePool::global().acquire(size);
+        target->claimed = target->buffer.data();
+        return target->claimed;
+    }
+    return std::malloc(size);
+}
 
-    int w = 0, h = 0, comp = 0;
-    if (!stbi_info(path.c_str(), &w, &h, &comp)) {
-        rassert(false, "stbi_info failed", path, stbi_failure_reason());
+static void stb_target_free(void *ptr) {
+    stb_decode_target *target = decode_target;
+    if (target && ptr && ptr == target->claimed) {
+        target->buffer.reset();
+        target->claimed = nullptr;
+        return;
     }
+    std::free(ptr);
+}
 
-    // Rule: RGB unless the file contains alpha (RGBA). Also: Gray+Alpha -> RGBA.
-    const int req_comp = (comp == 4 || comp == 2) ? 4 : 3;
+static void *stb_target_realloc(void *ptr, std::size_t size) {
+    stb_decode_target *target = decode_target;
+    if (target && ptr && ptr == target->claimed) {
+        if (size <= target->buffer.bytes()) return ptr;
+        void *moved = std::malloc(size);
+        if (moved) std::memcpy(moved, ptr, target->buffer.bytes());
+        stb_target_free(ptr);
+        return moved;
+    }
+    return std::realloc(ptr, size);
+}
+
+static const StbImageAllocator stb_target_allocator = {stb_target_malloc, stb_target_realloc, stb_target_free};
+
+// Runs decode (a call of stbi_load*) with the output of w x h x comp bytes going straight into the image
+template <typename Decode>
+static image8u decode_into_image(int w, int h, int comp, Decode &&decode) {
+    stb_decode_target target;
+    target.bytes = static_cast<std::size_t>(w) * static_cast<std::size_t>(h) * static_cast<std::size_t>(comp);
+    decode_target = &target;
+    stbi_set_thread_allocator(&stb_target_allocator);
+    int loaded_w = 0, loaded_h = 0;
+    unsigned char *ptr = decode(loaded_w, loaded_h);
+    stbi_set_thread_allocator(nullptr);
+    decode_target = nullptr;
 
-    int loaded_comp = 0;
-    unsigned char *ptr = stbi_load(path.c_str(), &w, &h, &loaded_comp, req_comp);
     if (!ptr) {
-        rassert(false, "stbi_load failed", path, stbi_failure_reason());
+        rassert(false, "stb decoding failed", stbi_failure_reason());
+    }
+    rassert(loaded_w == w && loaded_h == h, "Unexpected decoded size", loaded_w, loaded_h, w, h);
+    if (ptr == target.claimed) {
+        return image8u(w, h, comp, std::move(target.buffer));
     }
 
-    image8u img(w, h, req_comp);
-    const std::size_t n =
-        static_cast<std::size_t>(w) * static_cast<std::size_t>(h) * static_cast<std::size_t>(req_comp);
-    std::memcpy(img.data(), ptr, n * sizeof(std::uint8_t));
+    image8u img(w, h, comp, ImageInit::Uninitialized);
+    std::memcpy(img.data(), ptr, target.bytes);
     stbi_image_free(ptr);
     return img;
 }
 
-void save_image(const image8u &img, const std::string &path, int jpg_quality) {
+#endif
+
+} // namespace libimages
+
+SaveOptions save_options(SavePreset preset) {
+    SaveOptions options;
+    switch (preset) {
+    case SavePreset::Small:
+        break;
+    case SavePreset::Fast:
+        options.png = PngCompression::Fast;
+        options.jpg_quality = 85;
+        break;
+    case SavePreset::Fastest:
+        options.png = PngCompression::None;
+        options.jpg_quality = 75;
+        break;
+    }
+    return options;
+}
+
+void encode_image(const image8u &img, const std::string &format, const ImageSink &sink, const SaveOptions &options) {
     rassert(img.width() > 0 && img.height() > 0, "Empty image");
     rassert(img.channels() == 1 || img.channels() == 3 || img.channels() == 4, "Unsupported channel count",
             img.channels());
+    rassert(static_cast<bool>(sink), "Empty sink");
+
+    const std::string ext = libimages::to_lower_copy(format);
+    rassert(libimages::is_supported_output_format(ext), "Unsupported output format", format);
+
+    if (ext == "ppm" || ext == "pgm") {
+        libimages::encode_pnm(img, ext == "pgm", sink);
+    } else if (ext == "png" && (options.png != PngCompression::Default || libimages::parallel_png_is_faster(img))) {
+        PngStreamWriter writer(sink, img.width(), img.height(), img.channels(),
+                               options.png == PngCompression::None ? PngStreamWriter::Compression::Stored
+                                                                   : PngStreamWriter::Compression::Fixed);
+        writer.writeRows(img);
+        writer.finish();
+    } else if (ext == "png") {
+        libimages::encode_png(img, sink);
+    } else {
+        rassert(options.jpg_quality >= 1 && options.jpg_quality <= 100, "Invalid JPEG quality", options.jpg_quality);
+        libimages::encode_jpeg(img, options.jpg_quality, sink);
+    }
+}
 
+std::vector<std::uint8_t> encode_image(const image8u &img, const std::string &format, const SaveOptions &options) {
+    std::vector<std::uint8_t> bytes;
+    encode_image(img, format, memory_sink(bytes), options);
+    return bytes;
+}
+
+void save_image(const image8u &img, const std::string &path, const SaveOptions &options) {
     const std::string ext = libimages::file_ext_lower(path);
     rassert(!ext.empty(), "Output path must have an extension", path);
+    rassert(libimages::is_supported_output_format(ext), "Unsupported output extension", ext, path);
 
-    const int w = img.width();
-    const int h = img.height();
-    const int c = img.channels();
+    std::FILE *fp = std::fopen(path.c_str(), "wb");
+    rassert(fp != nullptr, "Failed to open file for writing", path);
+    try {
+        encode_image(img, ext, [fp, &path](const std::uint8_t *data, std::size_t size) {
+            rassert(std::fwrite(data, 1, size, fp) == size, "Failed to write", path);
+        }, options);
+    } catch (...) {
+        std::fclose(fp);
+        throw;
+    }
+    rassert(std::fclose(fp) == 0, "Failed to write", path);
+}
 
-    if (ext == "png") {
-        const int stride_bytes = w * c;
-        const int ok = stbi_write_png(path.c_str(), w, h, c, img.data(), stride_bytes);
-        rassert(ok != 0, "stbi_write_png failed", path);
-        return;
+void save_image(const image8u &img, const std::string &path, int jpg_quality) {
+    SaveOptions options;
+    options.jpg_quality = jpg_quality;
+    save_image(img, path, options);
+}
+
+void save_npy(const image32f &img, const std::string &path) {
+    rassert(img.width() > 0 && img.height() > 0, "Empty image");
+    rassert(libimages::file_ext_lower(path) == "npy", "Output path must have .npy extension", path);
+
+    std::string header = std::string("{'descr': '") + (std::endian::native == std::endian::little ? "<f4" : ">f4") +
+                         "', 'fortran_order': False, 'shape': (" + std::to_string(img.height()) + ", " +
+                         std::to_string(img.width()) +
+                         (img.channels() == 1 ? std::string(")") : ", " + std::to_string(img.channels()) + ")") + ", }";
+    // magic (6) + version (2) + header length (2) + header, padded with spaces and ended by \n to a multiple of 64
+    const std::size_t unpadded = 10 + header.size() + 1;
+    header.append((64 - unpadded % 64) % 64, ' ');
+    header.push_back('\n');
+
+    std::ofstream out(std::filesystem::u8path(path), std::ios::binary);
+    rassert(out.good(), "Failed to open file for writing", path);
+    const char preamble[8] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0};
+    out.write(preamble, sizeof(preamble));
+    const char length[2] = {static_cast<char>(header.size() & 0xFF), static_cast<char>(header.size() >> 8)};
+    out.write(length, sizeof(length));
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char *>(img.data()),
+              static_cast<std::streamsize>(img.stride_elements() * static_cast<std::size_t>(img.height()) * sizeof(float)));
+    out.close();
+    rassert(!out.fail(), "Failed to write", path);
+}
+
+image8u load_image_mapped(const std::string &path) {
+    const std::filesystem::path p = std::filesystem::u8path(path);
+    rassert(std::filesystem::exists(p), "Input file does not exist", path);
+    rassert(std::filesystem::is_regular_file(p), "Input path is not a regular file", path);
+
+    const MappedFile file(path);
+    rassert(file.size() > 0, "Input file is empty", path);
+    return load_image_from_memory(file.bytes());
+}
+
+#if defined(LIBIMAGES_USE_STB)
+
+image8u load_image(const std::string &path) {
+    const std::filesystem::path p = std::filesystem::u8path(path);
+    rassert(std::filesystem::exists(p),
+            "Please check working directory and relative input file path - input file does not exist", path);
+    rassert(std::filesystem::is_regular_file(p), "Input path is not a regular file", path);
+
+    int w = 0, h = 0, comp = 0;
+    if (!stbi_info(path.c_str(), &w, &h, &comp)) {
+        rassert(false, "stbi_info failed", path, stbi_failure_reason());
     }
 
-    if (ext == "jpg" || ext == "jpeg") {
-        rassert(jpg_quality >= 1 && jpg_quality <= 100, "Invalid JPEG quality", jpg_quality);
+    // Rule: RGB unless the file contains alpha (RGBA). Also: Gray+Alpha -> RGBA.
+    const int req_comp = (comp == 4 || comp == 2) ? 4 : 3;
+
+    return libimages::decode_into_image(w, h, req_comp, [&](int &loaded_w, int &loaded_h) {
+        int loaded_comp = 0;
+        return stbi_load(path.c_str(), &loaded_w, &loaded_h, &loaded_comp, req_comp);
+    });
+}
 
-        if (c == 4) {
-            // Drop alpha for JPEG.
-            std::vector<std::uint8_t> rgb(static_cast<std::size_t>(w) * static_cast<std::size_t>(h) * 3);
-            for (int j = 0; j < h; ++j) {
-                for (int i = 0; i < w; ++i) {
-                    const std::size_t src =
-                        (static_cast<std::size_t>(j) * static_cast<std::size_t>(w) + static_cast<std::size_t>(i)) * 4;
-                    const std::size_t dst =
-                        (static_cast<std::size_t>(j) * static_cast<std::size_t>(w) + static_cast<std::size_t>(i)) * 3;
-                    rgb[dst + 0] = img.data()[src + 0];
-                    rgb[dst + 1] = img.data()[src + 1];
-                    rgb[dst + 2] = img.data()[src + 2];
-                }
-            }
-            const int ok = stbi_write_jpg(path.c_str(), w, h, 3, rgb.data(), jpg_quality);
-            rassert(ok != 0, "stbi_write_jpg failed", path);
-            return;
-        }
+image8u load_image_from_memory(std::span<const std::uint8_t> bytes) {
+    rassert(!bytes.empty(), "Empty input buffer");
+    rassert(bytes.size() <= static_cast<std::size_t>(INT_MAX), "Input buffer is too large for stb", bytes.size());
+    const int len = static_cast<int>(bytes.size());
 
-        const int ok = stbi_write_jpg(path.c_str(), w, h, c, img.data(), jpg_quality);
-        rassert(ok != 0, "stbi_write_jpg failed", path);
-        return;
+    int w = 0, h = 0, comp = 0;
+    if (!stbi_info_from_memory(bytes.data(), len, &w, &h, &comp)) {
+        rassert(false, "stbi_info_from_memory failed", stbi_failure_reason());
     }
+    const int req_comp = (comp == 4 || comp == 2) ? 4 : 3;
+
+    return libimages::decode_into_image(w, h, req_comp, [&](int &loaded_w, int &loaded_h) {
+        int loaded_comp = 0;
+        return stbi_load_from_memory(bytes.data(), len, &loaded_w, &loaded_h, &loaded_comp, req_comp);
+    });
+}
+
+image8u load_image(const std::string &path, const LoadOptions &options) {
+    libimages::check_load_options(options);
+    return libimages::reduce_decoded(load_image(path), options.scale_denom);
+}
+
+image8u load_image_from_memory(std::span<const std::uint8_t> bytes, const LoadOptions &options) {
+    libimages::check_load_options(options);
+    return libimages::reduce_decoded(load_image_from_memory(bytes), options.scale_denom);
+}
+
+namespace libimages {
+
+static void stb_sink_write(void *context, void *data, int size) {
+    static_cast<SinkGuard *>(context)->write(data, static_cast<std::size_t>(size));
+}
+
+// stb deflates the whole image in memory, the sink gets it at once
+static void encode_png(const image8u &img, const ImageSink &sink) {
+    SinkGuard guard(sink);
+    const int stride_bytes = img.width() * img.channels();
+    const int ok = stbi_write_png_to_func(stb_sink_write, &guard, img.width(), img.height(), img.channels(), img.data(),
+                                          stride_bytes);
+    guard.rethrow();
+    rassert(ok != 0, "stbi_write_png failed");
+}
 
-    rassert(false, "Unsupported output extension", ext, path);
+// stb reads RGB of 4-channel pixels in place (alpha is ignored), so there is no conversion copy.
+// The sink gets the output by small buffers, as soon as they are encoded.
+static void encode_jpeg(const image8u &img, int quality, const ImageSink &sink) {
+    SinkGuard guard(sink);
+    const int ok = stbi_write_jpg_to_func(stb_sink_write, &guard, img.width(), img.height(), img.channels(), img.data(),
+                                          quality);
+    guard.rethrow();
+    rassert(ok != 0, "stbi_write_jpg failed");
 }
 
+} // namespace libimages
+
 #elif defined(LIBIMAGES_USE_SYSTEM)
 
 static image8u load_png(const std::string &path) {
@@ -167,7 +444,7 @@ static image8u load_png(const std::string &path) {
     rassert(rowbytes == static_cast<png_size_t>(w) * static_cast<png_size_t>(channels), "Unexpected PNG rowbytes", path,
             static_cast<unsigned long>(rowbytes));
 
-    image8u img(static_cast<int>(w), static_cast<int>(h), channels);
+    image8u img(static_cast<int>(w), static_cast<int>(h), channels, ImageInit::Uninitialized);
     std::vector<png_bytep> rows(static_cast<std::size_t>(h));
     for (png_uint_32 j = 0; j < h; ++j) {
         rows[static_cast<std::size_t>(j)] =
@@ -182,7 +459,8 @@ static image8u load_png(const std::string &path) {
     return img;
 }
 
-static image8u load_jpeg(const std::string &path) {
+// scale_denom > 1 makes libjpeg decode at reduced size from the DCT coefficients (much faster than a full decode)
+static image8u load_jpeg(const std::string &path, int scale_denom) {
     FILE *fp = std::fopen(path.c_str(), "rb");
     rassert(fp != nullptr, "Failed to open file", path);
 
@@ -196,6 +474,8 @@ static image8u load_jpeg(const std::string &path) {
     rassert(rc == 1, "jpeg_read_header failed", path);
 
     cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = static_cast<unsigned int>(scale_denom);
     jpeg_start_decompress(&cinfo);
 
     const int w = static_cast<int>(cinfo.output_width);
@@ -203,7 +483,7 @@ static image8u load_jpeg(const std::string &path) {
     const int channels = static_cast<int>(cinfo.output_components);
     rassert(channels == 3, "Unexpected JPEG components", channels);
 
-    image8u img(w, h, 3);
+    image8u img(w, h, 3, ImageInit::Uninitialized);
 
     std::vector<JSAMPLE> row(static_cast<std::size_t>(w) * 3);
     while (cinfo.output_scanline < cinfo.output_height) {
@@ -221,39 +501,168 @@ static image8u load_jpeg(const std::string &path) {
     return img;
 }
 
+struct png_memory_reader {
+    std::span<const std::uint8_t> bytes;
+    std::size_t offset = 0;
+};
+
+static void read_png_from_memory(png_structp png, png_bytep out, png_size_t count) {
+    auto *reader = static_cast<png_memory_reader *>(png_get_io_ptr(png));
+    if (reader->bytes.size() - reader->offset < count) {
+        png_error(png, "Unexpected end of PNG data");
+    }
+    std::memcpy(out, reader->bytes.data() + reader->offset, count);
+    reader->offset += count;
+}
+
+static image8u load_png_from_memory(std::span<const std::uint8_t> bytes) {
+    rassert(bytes.size() >= 8 && png_sig_cmp(bytes.data(), 0, 8) == 0, "Not a PNG buffer");
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    rassert(png != nullptr, "png_create_read_struct failed");
+    png_infop info = png_create_info_struct(png);
+    rassert(info != nullptr, "png_create_info_struct failed");
+
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        rassert(false, "libpng error while reading from memory");
+    }
+
+    png_memory_reader reader{bytes, 8};
+    png_set_read_fn(png, &reader, read_png_from_memory);
+    png_set_sig_bytes(png, 8);
+    png_read_info(png, info);
+
+    png_uint_32 w = 0, h = 0;
+    int bit_depth = 0, color_type = 0;
+    png_get_IHDR(png, info, &w, &h, &bit_depth, &color_type, nullptr, nullptr, nullptr);
+
+    if (bit_depth == 16)
+        png_set_strip_16(png);
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(png);
+    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+        png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(png);
+    if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(png);
+
+    png_read_update_info(png, info);
+
+    const int out_color_type = png_get_color_type(png, info);
+    const int channels = (out_color_type == PNG_COLOR_TYPE_RGB_ALPHA) ? 4 : 3;
+
+    const png_size_t rowbytes = png_get_rowbytes(png, info);
+    rassert(rowbytes == static_cast<png_size_t>(w) * static_cast<png_size_t>(channels), "Unexpected PNG rowbytes",
+            static_cast<unsigned long>(rowbytes));
+
+    image8u img(static_cast<int>(w), static_cast<int>(h), channels, ImageInit::Uninitialized);
+    std::vector<png_bytep> rows(static_cast<std::size_t>(h));
+    for (png_uint_32 j = 0; j < h; ++j) {
+        rows[static_cast<std::size_t>(j)] =
+            reinterpret_cast<png_bytep>(img.data() + static_cast<std::size_t>(j) * static_cast<std::size_t>(rowbytes));
+    }
+
+    png_read_image(png, rows.data());
+    png_read_end(png, nullptr);
+
+    png_destroy_read_struct(&png, &info, nullptr);
+    return img;
+}
+
+static image8u load_jpeg_from_memory(std::span<const std::uint8_t> bytes, int scale_denom) {
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<unsigned char *>(bytes.data()), static_cast<unsigned long>(bytes.size()));
+
+    const int rc = jpeg_read_header(&cinfo, TRUE);
+    rassert(rc == 1, "jpeg_read_header failed");
+
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = static_cast<unsigned int>(scale_denom);
+    jpeg_start_decompress(&cinfo);
+
+    const int w = static_cast<int>(cinfo.output_width);
+    const int h = static_cast<int>(cinfo.output_height);
+    const int channels = static_cast<int>(cinfo.output_components);
+    rassert(channels == 3, "Unexpected JPEG components", channels);
+
+    image8u img(w, h, 3, ImageInit::Uninitialized);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW rowptr = img.ptr(static_cast<int>(cinfo.output_scanline));
+        const JDIMENSION got = jpeg_read_scanlines(&cinfo, &rowptr, 1);
+        rassert(got == 1, "jpeg_read_scanlines failed");
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return img;
+}
+
+image8u load_image_from_memory(std::span<const std::uint8_t> bytes, const LoadOptions &options) {
+    rassert(!bytes.empty(), "Empty input buffer");
+    libimages::check_load_options(options);
+    if (bytes.size() >= 8 && png_sig_cmp(bytes.data(), 0, 8) == 0)
+        return libimages::reduce_decoded(load_png_from_memory(bytes), options.scale_denom);
+    if (bytes.size() >= 2 && bytes[0] == 0xFF && bytes[1] == 0xD8)
+        return load_jpeg_from_memory(bytes, options.scale_denom);
+
+    rassert(false, "Unsupported input format (neither PNG nor JPEG)");
+    return {};
+}
+
+image8u load_image_from_memory(std::span<const std::uint8_t> bytes) {
+    return load_image_from_memory(bytes, LoadOptions{});
+}
+
 image8u load_image(const std::string &path) {
+    return load_image(path, LoadOptions{});
+}
+
+image8u load_image(const std::string &path, const LoadOptions &options) {
+    libimages::check_load_options(options);
     const std::filesystem::path p = std::filesystem::u8path(path);
     rassert(std::filesystem::exists(p), "Input file does not exist", path);
     rassert(std::filesystem::is_regular_file(p), "Input path is not a regular file", path);
 
-    const std::string ext = file_ext_lower(path);
+    const std::string ext = libimages::file_ext_lower(path);
     rassert(!ext.empty(), "Input path must have an extension", path);
 
     if (ext == "png")
-        return load_png(path);
+        return libimages::reduce_decoded(load_png(path), options.scale_denom);
     if (ext == "jpg" || ext == "jpeg")
-        return load_jpeg(path);
+        return load_jpeg(path, options.scale_denom);
 
     rassert(false, "Unsupported input extension", ext, path);
     return {};
 }
 
-static void save_png(const image8u &img, const std::string &path) {
-    FILE *fp = std::fopen(path.c_str(), "wb");
-    rassert(fp != nullptr, "Failed to open file for writing", path);
+namespace libimages {
+
+static void png_sink_write(png_structp png, png_bytep data, png_size_t size) {
+    static_cast<SinkGuard *>(png_get_io_ptr(png))->write(data, size);
+}
+
+static void png_sink_flush(png_structp) {}
+
+static void encode_png(const image8u &img, const ImageSink &sink) {
+    SinkGuard guard(sink);
 
     png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    rassert(png != nullptr, "png_create_write_struct failed", path);
+    rassert(png != nullptr, "png_create_write_struct failed");
     png_infop info = png_create_info_struct(png);
-    rassert(info != nullptr, "png_create_info_struct failed", path);
+    rassert(info != nullptr, "png_create_info_struct failed");
 
     if (setjmp(png_jmpbuf(png))) {
         png_destroy_write_struct(&png, &info);
-        std::fclose(fp);
-        rassert(false, "libpng error while writing", path);
+        rassert(false, "libpng error while writing");
     }
 
-    png_init_io(png, fp);
+    png_set_write_fn(png, &guard, png_sink_write, png_sink_flush);
 
     const int w = img.width();
     const int h = img.height();
@@ -273,59 +682,63 @@ static void save_png(const image8u &img, const std::string &path) {
                  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
     png_write_info(png, info);
-
-    const std::size_t rowbytes = static_cast<std::size_t>(w) * static_cast<std::size_t>(c);
-    std::vector<png_bytep> rows(static_cast<std::size_t>(h));
     for (int j = 0; j < h; ++j) {
-        rows[static_cast<std::size_t>(j)] = const_cast<png_bytep>(
-            reinterpret_cast<png_const_bytep>(img.data() + static_cast<std::size_t>(j) * rowbytes));
+        png_write_row(png, const_cast<png_bytep>(reinterpret_cast<png_const_bytep>(img.ptr(j))));
     }
-
-    png_write_image(png, rows.data());
     png_write_end(png, nullptr);
 
     png_destroy_write_struct(&png, &info);
-    std::fclose(fp);
+    guard.rethrow();
 }
 
-static void save_jpeg(const image8u &img, const std::string &path, int quality) {
-    rassert(quality >= 1 && quality <= 100, "Invalid JPEG quality", quality);
+// libjpeg destination that passes every filled buffer to the sink
+struct jpeg_sink_destination {
+    jpeg_destination_mgr pub;
+    SinkGuard *guard = nullptr;
+    std::vector<JOCTET> buffer;
+};
+
+static void jpeg_sink_init(j_compress_ptr cinfo) {
+    auto *dest = reinterpret_cast<jpeg_sink_destination *>(cinfo->dest);
+    dest->pub.next_output_byte = dest->buffer.data();
+    dest->pub.free_in_buffer = dest->buffer.size();
+}
+
+static boolean jpeg_sink_empty(j_compress_ptr cinfo) {
+    auto *dest = reinterpret_cast<jpeg_sink_destination *>(cinfo->dest);
+    dest->guard->write(dest->buffer.data(), dest->buffer.size());
+    jpeg_sink_init(cinfo);
+    return TRUE;
+}
+
+static void jpeg_sink_term(j_compress_ptr cinfo) {
+    auto *dest = reinterpret_cast<jpeg_sink_destination *>(cinfo->dest);
+    dest->guard->write(dest->buffer.data(), dest->buffer.size() - dest->pub.free_in_buffer);
+}
 
+static void encode_jpeg(const image8u &img, int quality, const ImageSink &sink) {
     const int w = img.width();
     const int h = img.height();
     const int c = img.channels();
     rassert(c == 1 || c == 3 || c == 4, "Unsupported JPEG channel count", c);
 
-    // JPEG has no alpha
-    std::vector<std::uint8_t> tmp;
-    const std::uint8_t *src = img.data();
-    int write_c = c;
+    // JPEG has no alpha, it is dropped row by row
+    const int write_c = c == 4 ? 3 : c;
+    std::vector<JSAMPLE> rgb_row(c == 4 ? static_cast<std::size_t>(w) * 3 : 0);
 
-    if (c == 4) {
-        tmp.resize(static_cast<std::size_t>(w) * static_cast<std::size_t>(h) * 3);
-        for (int j = 0; j < h; ++j) {
-            for (int i = 0; i < w; ++i) {
-                const std::size_t s =
-                    (static_cast<std::size_t>(j) * static_cast<std::size_t>(w) + static_cast<std::size_t>(i)) * 4;
-                const std::size_t d =
-                    (static_cast<std::size_t>(j) * static_cast<std::size_t>(w) + static_cast<std::size_t>(i)) * 3;
-                tmp[d + 0] = src[s + 0];
-                tmp[d + 1] = src[s + 1];
-                tmp[d + 2] = src[s + 2];
-            }
-        }
-        src = tmp.data();
-        write_c = 3;
-    }
-
-    FILE *fp = std::fopen(path.c_str(), "wb");
-    rassert(fp != nullptr, "Failed to open file for writing", path);
+    SinkGuard guard(sink);
+    jpeg_sink_destination dest;
+    dest.guard = &guard;
+    dest.buffer.resize(std::size_t(1) << 16);
+    dest.pub.init_destination = jpeg_sink_init;
+    dest.pub.empty_output_buffer = jpeg_sink_empty;
+    dest.pub.term_destination = jpeg_sink_term;
 
     jpeg_compress_struct cinfo;
     jpeg_error_mgr jerr;
     cinfo.err = jpeg_std_error(&jerr);
     jpeg_create_compress(&cinfo);
-    jpeg_stdio_dest(&cinfo, fp);
+    cinfo.dest = &dest.pub;
 
     cinfo.image_width = w;
     cinfo.image_height = h;
@@ -336,39 +749,27 @@ static void save_jpeg(const image8u &img, const std::string &path, int quality)
     jpeg_set_quality(&cinfo, quality, TRUE);
     jpeg_start_compress(&cinfo, TRUE);
 
-    const std::size_t rowbytes = static_cast<std::size_t>(w) * static_cast<std::size_t>(write_c);
     while (cinfo.next_scanline < cinfo.image_height) {
-        JSAMPLE *row = const_cast<JSAMPLE *>(
-            reinterpret_cast<const JSAMPLE *>(src + static_cast<std::size_t>(cinfo.next_scanline) * rowbytes));
-        JSAMPROW rowptr = row;
+        const std::uint8_t *src = img.ptr(static_cast<int>(cinfo.next_scanline));
+        JSAMPROW rowptr = const_cast<JSAMPLE *>(reinterpret_cast<const JSAMPLE *>(src));
+        if (c == 4) {
+            for (int i = 0; i < w; ++i) {
+                rgb_row[3 * i + 0] = src[4 * i + 0];
+                rgb_row[3 * i + 1] = src[4 * i + 1];
+                rgb_row[3 * i + 2] = src[4 * i + 2];
+            }
+            rowptr = rgb_row.data();
+        }
         const JDIMENSION written = jpeg_write_scanlines(&cinfo, &rowptr, 1);
-        rassert(written == 1, "jpeg_write_scanlines failed", path);
+        rassert(written == 1, "jpeg_write_scanlines failed");
     }
 
     jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
-    std::fclose(fp);
+    guard.rethrow();
 }
 
-void save_image(const image8u &img, const std::string &path, int jpg_quality) {
-    rassert(img.width() > 0 && img.height() > 0, "Empty image");
-    rassert(img.channels() == 1 || img.channels() == 3 || img.channels() == 4, "Unsupported channel count",
-            img.channels());
-
-    const std::string ext = file_ext_lower(path);
-    rassert(!ext.empty(), "Output path must have an extension", path);
-
-    if (ext == "png") {
-        save_png(img, path);
-        return;
-    }
-    if (ext == "jpg" || ext == "jpeg") {
-        save_jpeg(img, path, jpg_quality);
-        return;
-    }
-
-    rassert(false, "Unsupported output extension", ext, path);
-}
+} // namespace libimages
 
 #endif
 
@@ -1,10 +1,59 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
 
 #include <libimages/image.h>
+#include <libimages/image_sink.h>
 
 image8u load_image(const std::string &path);
 
-// Saves 1/3/4-channel 8-bit image. For JPEG, alpha is dropped.
+struct LoadOptions {
+    // 1 (full resolution), 2, 4 or 8: the image is ceil(width / scale_denom) x ceil(height / scale_denom).
+    // JPEG is decoded at that size right away if the backend can (libjpeg DCT scaling), otherwise the full image
+    // is decoded and then downsampled (DownsampleMethod::Area).
+    int scale_denom = 1;
+};
+
+image8u load_image(const std::string &path, const LoadOptions &options);
+
+// The same for an encoded PNG/JPEG already in memory (f.e. a network buffer), the format is detected by its content
+image8u load_image_from_memory(std::span<const std::uint8_t> bytes);
+image8u load_image_from_memory(std::span<const std::uint8_t> bytes, const LoadOptions &options);
+
+// The same as load_image, but the file is decoded in place from its read-only memory mapping (see MappedFile)
+image8u load_image_mapped(const std::string &path);
+
+//   Default - deflate of the backend (stb, one thread), or the same as Fast for images of a megapixel and more
+//             when there are several threads (PngStreamWriter deflates pieces of the image in parallel)
+//   Fast    - adaptive row filters + fixed Huffman deflate (PngStreamWriter), in parallel on the task scheduler
+//   None    - no compression at all (the fastest)
+enum class PngCompression { Default, Fast, None };
+
+struct SaveOptions {
+    int jpg_quality = 95;
+    PngCompression png = PngCompression::Default;
+};
+
+// Speed/size trade-offs for the formats that have one (PNG, JPEG):
+//   Small   - the defaults (PngCompression::Default, JPEG quality 95)
+//   Fast    - PngCompression::Fast, JPEG quality 85
+//   Fastest - PngCompression::None, JPEG quality 75
+enum class SavePreset { Small, Fast, Fastest };
+SaveOptions save_options(SavePreset preset);
+
+// Saves 1/3/4-channel 8-bit image, the format is chosen by the extension: png, jpg/jpeg, ppm (3/4 channels, binary P6) or
+// pgm (1 channel, binary P5). PPM and PGM are raw pixels after a short header, i.e. the fastest to write.
+// For JPEG and PPM, alpha is dropped.
 void save_image(const image8u &img, const std::string &path, int jpg_quality = 95);
+void save_image(const image8u &img, const std::string &path, const SaveOptions &options);
+
+// Encodes into sink instead of a file (f.e. a memory buffer or a socket), format is one of the extensions above.
+// Bytes go to the sink as the encoder produces them, channels are converted row by row (no whole-image copies).
+void encode_image(const image8u &img, const std::string &format, const ImageSink &sink, const SaveOptions &options = {});
+std::vector<std::uint8_t> encode_image(const image8u &img, const std::string &format, const SaveOptions &options = {});
+
+// Saves raw float values (f.e. for analysis in numpy) as .npy: float32, shape (height, width) or (height, width, channels)
+void save_npy(const image32f &img, const std::string &path);
@@ -0,0 +1,174 @@
+#include "image_io.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libimages/debug_io.h>
+#include <libimages/tests_utils.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+const std::string kImage = "data/00_photo_six_parts_downscaled_x4.jpg";
+
+bool sameImages(const image8u &a, const image8u &b) {
+    if (a.size() != b.size()) return false;
+    return std::memcmp(a.data(), b.data(), a.stride_elements() * static_cast<std::size_t>(a.height())) == 0;
+}
+
+std::vector<std::uint8_t> readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+TEST(image_io, fromMemoryAndMappedAreTheSameAsFromFile) {
+    configureWorkingDirectory();
+
+    const image8u expected = load_image(kImage);
+    EXPECT_TRUE(sameImages(load_image_from_memory(readFile(kImage)), expected));
+    EXPECT_TRUE(sameImages(load_image_mapped(kImage), expected));
+}
+
+TEST(image_io, pngFromMemory) {
+    configureWorkingDirectory();
+
+    image8u img(5, 3, 4);
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 5; ++x) {
+            for (int c = 0; c < 4; ++c) img.at(y, x, c) = static_cast<std::uint8_t>(y * 50 + x * 10 + c);
+        }
+    }
+    const std::string path = getUnitCaseDebugDir() + "rgba.png";
+    debug_io::ensure_dir_exists_for_file(path);
+    save_image(img, path);
+    EXPECT_TRUE(sameImages(load_image_from_memory(readFile(path)), img));
+}
+
+TEST(image_io, reducedResolution) {
+    configureWorkingDirectory();
+
+    const image8u full = load_image(kImage);
+    for (int d : {2, 4, 8}) {
+        LoadOptions options;
+        options.scale_denom = d;
+        const image8u reduced = load_image(kImage, options);
+        EXPECT_EQ(reduced.width(), (full.width() + d - 1) / d);
+        EXPECT_EQ(reduced.height(), (full.height() + d - 1) / d);
+        EXPECT_EQ(reduced.channels(), full.channels());
+        EXPECT_TRUE(sameImages(load_image_from_memory(readFile(kImage), options), reduced));
+    }
+
+    LoadOptions unsupported;
+    unsupported.scale_denom = 3;
+    EXPECT_THROW(load_image(kImage, unsupported), assertion_error);
+    EXPECT_TRUE(sameImages(load_image(kImage, LoadOptions{}), full));
+}
+
+TEST(image_io, brokenInputsFail) {
+    configureWorkingDirectory();
+
+    const std::vector<std::uint8_t> garbage = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_THROW(load_image_from_memory(garbage), assertion_error);
+    EXPECT_THROW(load_image_from_memory({}), assertion_error);
+    EXPECT_THROW(load_image_mapped("data/no_such_image.jpg"), assertion_error);
+}
+
+TEST(image_io, fastPresetsAndRawFormatsKeepPixels) {
+    configureWorkingDirectory();
+
+    const image8u img = load_image(kImage);
+    const std::string dir = getUnitCaseDebugDir();
+    debug_io::ensure_dir_exists_for_file(dir + "x");
+    for (SavePreset preset : {SavePreset::Fast, SavePreset::Fastest}) {
+        const std::string path = dir + "preset" + std::to_string(static_cast<int>(preset)) + ".png";
+        save_image(img, path, save_options(preset));
+        EXPECT_TRUE(sameImages(load_image(path), img));
+    }
+    save_image(img, dir + "raw.ppm");
+    EXPECT_TRUE(sameImages(load_image(dir + "raw.ppm"), img));
+
+    image8u gray(7, 5, 1);
+    for (int y = 0; y < gray.height(); ++y) {
+        for (int x = 0; x < gray.width(); ++x) gray(y, x) = static_cast<std::uint8_t>(y * 30 + x);
+    }
+    save_image(gray, dir + "raw.pgm");
+    const image8u loaded = load_image(dir + "raw.pgm"); // gray is loaded as RGB
+    ASSERT_EQ(loaded.width(), 7);
+    EXPECT_EQ(loaded(4, 6, 1), 4 * 30 + 6);
+    EXPECT_THROW(save_image(img, dir + "rgb.pgm"), assertion_error);
+}
+
+TEST(image_io, npyHeaderAndValues) {
+    configureWorkingDirectory();
+
+    image32f values(3, 2, 1);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 3; ++x) values(y, x) = 0.5f * (y * 3 + x);
+    }
+    const std::string path = getUnitCaseDebugDir() + "values.npy";
+    debug_io::ensure_dir_exists_for_file(path);
+    save_npy(values, path);
+
+    const std::vector<std::uint8_t> bytes = readFile(path);
+    ASSERT_EQ(bytes.size(), 128 + 6 * sizeof(float));
+    EXPECT_EQ(std::memcmp(bytes.data(), "\x93NUMPY\x01\x00", 8), 0);
+    const std::string header(bytes.begin() + 10, bytes.begin() + 128);
+    EXPECT_NE(header.find("'shape': (2, 3)"), std::string::npos);
+    EXPECT_EQ(header.back(), '\n');
+    float last = 0.0f;
+    std::memcpy(&last, bytes.data() + 128 + 5 * sizeof(float), sizeof(float));
+    EXPECT_EQ(last, 2.5f);
+}
+
+TEST(image_io, encodeToSinkIsTheSameAsFile) {
+    configureWorkingDirectory();
+
+    const image8u img = load_image(kImage);
+    const std::string dir = getUnitCaseDebugDir();
+    debug_io::ensure_dir_exists_for_file(dir + "x");
+    for (const std::string format : {"png", "jpg", "ppm"}) {
+        for (SavePreset preset : {SavePreset::Small, SavePreset::Fast}) {
+            const std::string path = dir + "saved" + std::to_string(static_cast<int>(preset)) + "." + format;
+            save_image(img, path, save_options(preset));
+            const std::vector<std::uint8_t> encoded = encode_image(img, format, save_options(preset));
+            EXPECT_EQ(encoded, readFile(path)) << format;
+            EXPECT_TRUE(format == "jpg" || sameImages(load_image_from_memory(encoded), img)) << format;
+        }
+    }
+}
+
+TEST(image_io, alphaIsDroppedWithoutChangingJpeg) {
+    image8u rgb(37, 21, 3);
+    image8u rgba(37, 21, 4);
+    for (int y = 0; y < rgb.height(); ++y) {
+        for (int x = 0; x < rgb.width(); ++x) {
+            for (int c = 0; c < 3; ++c) rgba(y, x, c) = rgb(y, x, c) = static_cast<std::uint8_t>(x * 7 + y * 3 + c * 50);
+            rgba(y, x, 3) = static_cast<std::uint8_t>(x);
+        }
+    }
+    const std::vector<std::uint8_t> expected = encode_image(rgb, "jpg");
+    EXPECT_EQ(encode_image(rgba, "jpg"), expected);
+    const std::vector<std::uint8_t> expectedPpm = encode_image(rgb, "ppm");
+    EXPECT_EQ(encode_image(rgba, "ppm"), expectedPpm);
+}
+
+TEST(image_io, sinkErrorsArePropagated) {
+    const image8u img(16, 16, 3);
+    int calls = 0;
+    const ImageSink failing = [&calls](const std::uint8_t *, std::size_t) {
+        ++calls;
+        rassert(false, "sink is full");
+    };
+    for (const std::string format : {"png", "jpg", "pgm"}) {
+        EXPECT_THROW(encode_image(format == "pgm" ? image8u(4, 4, 1) : img, format, failing), assertion_error) << format;
+    }
+    EXPECT_EQ(calls, 3); // nothing is written after the failure
+    EXPECT_THROW(encode_image(img, "bmp"), assertion_error);
+}
@@ -0,0 +1,262 @@
+#include "image_pool.h"
+
+#include <libbase/memory_tracker.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+void *allocate_aligned(std::size_t bytes) {
+    return ::operator new(bytes, std::align_val_t{ImageBuffer::alignment});
+}
+
+void free_aligned(void *data) noexcept {
+    ::operator delete(data, std::align_val_t{ImageBuffer::alignment});
+}
+
+std::size_t round_up_to_alignment(std::size_t bytes) noexcept {
+    return (bytes + ImageBuffer::alignment - 1) / ImageBuffer::alignment * ImageBuffer::alignment;
+}
+
+int huge_pages_category() {
+    static const int category = memory::category("image huge pages");
+    return category;
+}
+
+#if defined(_WIN32)
+
+std::size_t large_page_size() noexcept {
+    static const std::size_t size = GetLargePageMinimum();
+    return size;
+}
+
+std::size_t mapping_bytes(std::size_t bytes, ImageMemory) noexcept {
+    const std::size_t page = large_page_size();
+    return (bytes + page - 1) / page * page;
+}
+
+// Large pages need SeLockMemoryPrivilege, without it (the usual case) VirtualAlloc fails and the buffer goes to the heap
+void *map_huge(std::size_t bytes, ImageMemory &kind) noexcept {
+    if (large_page_size() == 0) return nullptr;
+    void *data = VirtualAlloc(nullptr, mapping_bytes(bytes, ImageMemory::HugePages),
+                              MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (data) kind = ImageMemory::HugePages;
+    return data;
+}
+
+void unmap_huge(void *data, std::size_t, ImageMemory) noexcept { VirtualFree(data, 0, MEM_RELEASE); }
+
+#elif defined(__linux__)
+
+constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+std::size_t mapping_bytes(std::size_t bytes, ImageMemory) noexcept {
+    return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+}
+
+// Explicit huge pages first (there are none unless the admin reserved them in vm.nr_hugepages, then mmap fails at once),
+// then a mapping aligned to the huge page size, with the head and the tail cut off, advised to become transparent huge pages
+void *map_huge(std::size_t bytes, ImageMemory &kind) noexcept {
+    const std::size_t length = mapping_bytes(bytes, ImageMemory::HugePages);
+    void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+        kind = ImageMemory::HugePages;
+        return data;
+    }
+
+    void *reserved = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED) return nullptr;
+    const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(reserved);
+    const std::uintptr_t aligned = (begin + huge_page_size - 1) / huge_page_size * huge_page_size;
+    if (aligned > begin) munmap(reserved, aligned - begin);
+    if (aligned + length < begin + length + huge_page_size) {
+        munmap(reinterpret_cast<void *>(aligned + length), begin + length + huge_page_size - (aligned + length));
+    }
+    data = reinterpret_cast<void *>(aligned);
+    if (madvise(data, length, MADV_HUGEPAGE) != 0) {
+        // kernel without transparent huge pages: a plain mapping is no better than the heap
+        munmap(data, length);
+        return nullptr;
+    }
+    kind = ImageMemory::TransparentHugePages;
+    return data;
+}
+
+void unmap_huge(void *data, std::size_t bytes, ImageMemory kind) noexcept { munmap(data, mapping_bytes(bytes, kind)); }
+
+#else
+
+std::size_t mapping_bytes(std::size_t bytes, ImageMemory) noexcept { return bytes; }
+void *map_huge(std::size_t, ImageMemory &) noexcept { return nullptr; }
+void unmap_huge(void *, std::size_t, ImageMemory) noexcept {}
+
+#endif
+
+void free_block(void *data, std::size_t bytes, ImageMemory kind) noexcept {
+    if (kind == ImageMemory::Heap) return free_aligned(data);
+    unmap_huge(data, bytes, kind);
+    memory::freed(huge_pages_category(), mapping_bytes(bytes, kind));
+}
+
+} // namespace
+
+std::size_t residentHugePageBytes(const ImageBuffer &buffer) {
+    if (buffer.data() == nullptr || buffer.memory() == ImageMemory::Heap) return 0;
+    if (buffer.memory() == ImageMemory::HugePages) return buffer.bytes();
+#if defined(__linux__)
+    std::FILE *smaps = std::fopen("/proc/self/smaps", "r");
+    if (!smaps) return 0;
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(buffer.data());
+    std::size_t kb = 0;
+    bool inside = false;
+    char line[512];
+    while (std::fgets(line, sizeof(line), smaps)) {
+        unsigned long long from = 0, to = 0;
+        unsigned long long value = 0;
+        if (std::sscanf(line, "%llx-%llx ", &from, &to) == 2) {
+            if (inside) break; // the next mapping
+            inside = from <= address && address < to;
+        } else if (inside && std::sscanf(line, "AnonHugePages: %llu kB", &value) == 1) {
+            kb = static_cast<std::size_t>(value);
+        }
+    }
+    std::fclose(smaps);
+    return std::min(kb * 1024, buffer.bytes());
+#else
+    return 0;
+#endif
+}
+
+ImageBuffer::~ImageBuffer() { reset(); }
+
+ImageBuffer::ImageBuffer(ImageBuffer &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), bytes_(std::exchange(other.bytes_, 0)),
+      memory_(std::exchange(other.memory_, ImageMemory::Heap)), pool_(std::exchange(other.pool_, nullptr)) {}
+
+ImageBuffer &ImageBuffer::operator=(ImageBuffer &&other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        bytes_ = std::exchange(other.bytes_, 0);
+        memory_ = std::exchange(other.memory_, ImageMemory::Heap);
+        pool_ = std::exchange(other.pool_, nullptr);
+    }
+    return *this;
+}
+
+void ImageBuffer::reset() noexcept {
+    if (data_ == nullptr) return;
+    if (pool_) {
+        pool_->recycle(data_, bytes_, memory_);
+    } else {
+        free_block(data_, bytes_, memory_);
+    }
+    data_ = nullptr;
+    bytes_ = 0;
+    memory_ = ImageMemory::Heap;
+    pool_ = nullptr;
+}
+
+ImagePool::ImagePool(std::size_t maxCachedBytes, std::size_t hugePageThreshold)
+    : maxCachedBytes_(maxCachedBytes), hugePageThreshold_(hugePageThreshold) {}
+
+ImagePool::~ImagePool() { trim(); }
+
+ImageBuffer ImagePool::acquire(std::size_t bytes) {
+    if (bytes == 0) return {};
+    bytes = round_up_to_alignment(bytes);
+
+    bool huge = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(bytes);
+        if (it != cache_.end() && !it->second.empty()) {
+            const Block block = it->second.back();
+            it->second.pop_back();
+            stats_.cachedBytes -= bytes;
+            ++stats_.reuses;
+            return ImageBuffer(block.data, bytes, block.memory, this);
+        }
+        ++stats_.allocations;
+        huge = bytes >= hugePageThreshold_;
+    }
+
+    if (huge) {
+        ImageMemory kind = ImageMemory::Heap;
+        if (void *data = map_huge(bytes, kind)) {
+            memory::allocated(huge_pages_category(), mapping_bytes(bytes, kind));
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++(kind == ImageMemory::HugePages ? stats_.hugePageAllocations : stats_.transparentHugePageAllocations);
+            return ImageBuffer(data, bytes, kind, this);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.hugePageFallbacks;
+    }
+
+    return ImageBuffer(allocate_aligned(bytes), bytes, ImageMemory::Heap, this);
+}
+
+void ImagePool::recycle(void *data, std::size_t bytes, ImageMemory kind) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats_.cachedBytes + bytes <= maxCachedBytes_) {
+            try {
+                cache_[bytes].push_back({data, kind});
+                stats_.cachedBytes += bytes;
+                return;
+            } catch (const std::bad_alloc &) {
+                // fall through and release the memory
+            }
+        }
+    }
+    free_block(data, bytes, kind);
+}
+
+void ImagePool::trim() {
+    std::map<std::size_t, std::vector<Block>> cache;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cache.swap(cache_);
+        stats_.cachedBytes = 0;
+    }
+    for (auto &[bytes, blocks] : cache) {
+        for (const Block &block : blocks) {
+            free_block(block.data, bytes, block.memory);
+        }
+    }
+}
+
+void ImagePool::setMaxCachedBytes(std::size_t maxCachedBytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxCachedBytes_ = maxCachedBytes;
+        if (stats_.cachedBytes <= maxCachedBytes_) return;
+    }
+    trim();
+}
+
+void ImagePool::setHugePageThreshold(std::size_t hugePageThreshold) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hugePageThreshold_ = hugePageThreshold;
+}
+
+ImagePool::Stats ImagePool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+ImagePool &ImagePool::global() {
+    static ImagePool *pool = new ImagePool();
+    return *pool;
+}
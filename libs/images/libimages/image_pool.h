@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class ImagePool;
+
+// What backs a buffer: the aligned heap, or (for buffers of at least ImagePool::hugePageThreshold bytes) a mapping of
+// explicit huge pages (MAP_HUGETLB on Linux, MEM_LARGE_PAGES on Windows) or of regular pages advised to become
+// transparent huge pages (MADV_HUGEPAGE) - the kernel may still back them with small pages, see residentHugePageBytes
+enum class ImageMemory { Heap, HugePages, TransparentHugePages };
+
+// Owning, 64-byte aligned chunk of raw memory for image pixels.
+// On destruction the memory goes back to the pool it was acquired from (or to the system allocator if the pool is full).
+class ImageBuffer final {
+  public:
+    static constexpr std::size_t alignment = 64;
+
+    ImageBuffer() noexcept = default;
+    ~ImageBuffer();
+
+    ImageBuffer(const ImageBuffer &) = delete;
+    ImageBuffer &operator=(const ImageBuffer &) = delete;
+
+    ImageBuffer(ImageBuffer &&other) noexcept;
+    ImageBuffer &operator=(ImageBuffer &&other) noexcept;
+
+    void *data() const noexcept { return data_; }
+    // Usable size in bytes (requested size rounded up to alignment)
+    std::size_t bytes() const noexcept { return bytes_; }
+    ImagePool *pool() const noexcept { return pool_; }
+    ImageMemory memory() const noexcept { return memory_; }
+
+    void reset() noexcept;
+
+  private:
+    friend class ImagePool;
+
+    ImageBuffer(void *data, std::size_t bytes, ImageMemory memory, ImagePool *pool) noexcept
+        : data_(data), bytes_(bytes), memory_(memory), pool_(pool) {}
+
+    void *data_ = nullptr;
+    std::size_t bytes_ = 0;
+    ImageMemory memory_ = ImageMemory::Heap;
+    ImagePool *pool_ = nullptr;
+};
+
+// Bytes of the buffer currently backed by huge pages: all of them for ImageMemory::HugePages, the AnonHugePages of its
+// mapping in /proc/self/smaps for TransparentHugePages (adjacent mappings may be merged by the kernel and counted
+// together, the result is clamped to the buffer size), 0 for Heap and where it is unknown. Reads procfs, so not for hot paths.
+std::size_t residentHugePageBytes(const ImageBuffer &buffer);
+
+// Recycles image buffers of the same (aligned) size, so that processing many same-sized photos back to back
+// stops hitting the system allocator. Thread-safe.
+// All Image<T> allocate from ImagePool::global() unless another pool is passed explicitly.
+// Buffers of at least hugePageThreshold bytes (full-resolution images) are mapped with huge pages where the system
+// gives them, so that random access over them (labeling, warping) misses the TLB less; otherwise they fall back
+// to the heap. Bytes of live huge-page buffers are counted as the memory category "image huge pages".
+// Pool must outlive all buffers acquired from it.
+class ImagePool final {
+  public:
+    struct Stats {
+        std::size_t allocations = 0; // buffers taken from the system allocator
+        std::size_t reuses = 0;      // buffers handed back out from the cache
+        std::size_t cachedBytes = 0; // bytes currently kept in the cache
+        std::size_t hugePageAllocations = 0;            // allocations that got ImageMemory::HugePages
+        std::size_t transparentHugePageAllocations = 0; // ... ImageMemory::TransparentHugePages
+        std::size_t hugePageFallbacks = 0;              // allocations above the threshold that had to use the heap
+    };
+
+    static constexpr std::size_t default_max_cached_bytes = std::size_t(512) << 20;
+    static constexpr std::size_t default_huge_page_threshold = std::size_t(8) << 20;
+    static constexpr std::size_t no_huge_pages = static_cast<std::size_t>(-1);
+
+    explicit ImagePool(std::size_t maxCachedBytes = default_max_cached_bytes,
+                       std::size_t hugePageThreshold = default_huge_page_threshold);
+    ~ImagePool();
+
+    ImagePool(const ImagePool &) = delete;
+    ImagePool &operator=(const ImagePool &) = delete;
+
+    // Returned memory is not initialized
+    ImageBuffer acquire(std::size_t bytes);
+
+    // Frees all cached buffers
+    void trim();
+
+    void setMaxCachedBytes(std::size_t maxCachedBytes);
+    // For buffers acquired from now on (no_huge_pages - never); cached buffers keep their memory
+    void setHugePageThreshold(std::size_t hugePageThreshold);
+    Stats stats() const;
+
+    // Process-wide pool, never destroyed (so static images can safely outlive everything else)
+    static ImagePool &global();
+
+  private:
+    friend class ImageBuffer;
+
+    struct Block final {
+        void *data = nullptr;
+        ImageMemory memory = ImageMemory::Heap;
+    };
+
+    void recycle(void *data, std::size_t bytes, ImageMemory memory) noexcept;
+
+    mutable std::mutex mutex_;
+    std::map<std::size_t, std::vector<Block>> cache_; // aligned size -> free buffers
+    std::size_t maxCachedBytes_ = 0;
+    std::size_t hugePageThreshold_ = 0;
+    Stats stats_;
+};
@@ -0,0 +1,121 @@
+#include "image_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include <libimages/image.h>
+
+TEST(image_pool, buffersAreAligned) {
+    ImagePool pool;
+    for (std::size_t bytes : {1, 63, 64, 100, 4096 + 3}) {
+        ImageBuffer buffer = pool.acquire(bytes);
+        ASSERT_NE(buffer.data(), nullptr);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data()) % ImageBuffer::alignment, 0);
+        EXPECT_GE(buffer.bytes(), bytes);
+    }
+}
+
+TEST(image_pool, recyclesBuffersOfSameSize) {
+    ImagePool pool;
+
+    void *first = nullptr;
+    {
+        image8u img(100, 50, 3, ImageInit::Uninitialized, pool);
+        first = img.data();
+    }
+    EXPECT_EQ(pool.stats().allocations, 1);
+    EXPECT_GT(pool.stats().cachedBytes, 0);
+
+    image8u same(100, 50, 3, ImageInit::Zero, pool);
+    EXPECT_EQ(same.data(), first);
+    EXPECT_EQ(pool.stats().reuses, 1);
+    EXPECT_EQ(pool.stats().cachedBytes, 0);
+    EXPECT_EQ(same(49, 99, 2), 0);
+
+    image8u other(10, 10, 1, ImageInit::Zero, pool);
+    EXPECT_NE(other.data(), first);
+    EXPECT_EQ(pool.stats().allocations, 2);
+}
+
+TEST(image_pool, copiesAndMovesOwnBuffers) {
+    ImagePool pool;
+
+    image32f a(8, 4, 1, ImageInit::Zero, pool);
+    a(1, 2) = 5.0f;
+
+    image32f b = a;
+    EXPECT_NE(b.data(), a.data());
+    EXPECT_EQ(b(1, 2), 5.0f);
+    b(1, 2) = 7.0f;
+    EXPECT_EQ(a(1, 2), 5.0f);
+
+    const float *aData = a.data();
+    image32f c = std::move(a);
+    EXPECT_EQ(c.data(), aData);
+    EXPECT_EQ(c(1, 2), 5.0f);
+    EXPECT_EQ(a.data(), nullptr);
+
+    image32f empty;
+    c = empty;
+    EXPECT_EQ(c.data(), nullptr);
+    EXPECT_EQ(c.width(), 0);
+}
+
+TEST(image_pool, respectsCacheLimit) {
+    ImagePool pool(0);
+    {
+        image8u img(64, 64, 1, ImageInit::Uninitialized, pool);
+    }
+    EXPECT_EQ(pool.stats().cachedBytes, 0);
+
+    pool.setMaxCachedBytes(ImagePool::default_max_cached_bytes);
+    {
+        image8u img(64, 64, 1, ImageInit::Uninitialized, pool);
+    }
+    EXPECT_EQ(pool.stats().cachedBytes, 64 * 64);
+    pool.trim();
+    EXPECT_EQ(pool.stats().cachedBytes, 0);
+}
+
+TEST(image_pool, largeBuffersAskForHugePages) {
+    const std::size_t threshold = std::size_t(1) << 20;
+    ImagePool pool(ImagePool::default_max_cached_bytes, threshold);
+
+    {
+        ImageBuffer small = pool.acquire(threshold - ImageBuffer::alignment);
+        EXPECT_EQ(small.memory(), ImageMemory::Heap);
+        EXPECT_EQ(residentHugePageBytes(small), 0);
+    }
+
+    const std::size_t bytes = 3 * threshold + 100;
+    void *first = nullptr;
+    ImageMemory memory = ImageMemory::Heap;
+    {
+        ImageBuffer large = pool.acquire(bytes);
+        ASSERT_NE(large.data(), nullptr);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(large.data()) % ImageBuffer::alignment, 0);
+        EXPECT_GE(large.bytes(), bytes);
+        std::fill_n(static_cast<std::uint8_t *>(large.data()), large.bytes(), std::uint8_t(7));
+        EXPECT_LE(residentHugePageBytes(large), large.bytes());
+        first = large.data();
+        memory = large.memory();
+    }
+    const ImagePool::Stats stats = pool.stats();
+    // whether the system gives huge pages depends on the machine, but the request is always accounted
+    EXPECT_EQ(stats.hugePageAllocations + stats.transparentHugePageAllocations + stats.hugePageFallbacks, 1);
+    EXPECT_EQ(stats.hugePageFallbacks == 1, memory == ImageMemory::Heap);
+
+    // recycled with the memory it was mapped with
+    ImageBuffer again = pool.acquire(bytes);
+    EXPECT_EQ(again.data(), first);
+    EXPECT_EQ(again.memory(), memory);
+    EXPECT_EQ(static_cast<std::uint8_t *>(again.data())[bytes - 1], 7);
+
+    pool.setHugePageThreshold(ImagePool::no_huge_pages);
+    ImageBuffer heap = pool.acquire(bytes);
+    EXPECT_EQ(heap.memory(), ImageMemory::Heap);
+    EXPECT_EQ(pool.stats().hugePageFallbacks, stats.hugePageFallbacks);
+}
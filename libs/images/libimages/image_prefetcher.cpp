@@ -0,0 +1,82 @@
+#include "image_prefetcher.h"
+
+#include <libbase/runtime_assert.h>
+#include <libbase/timer.h>
+#include <libimages/image_io.h>
+
+#include <algorithm>
+#include <utility>
+
+ImagePrefetcher::ImagePrefetcher(std::vector<std::string> paths) : ImagePrefetcher(std::move(paths), Options{}) {}
+
+ImagePrefetcher::ImagePrefetcher(std::vector<std::string> paths, const Options &options)
+    : paths_(std::move(paths)), options_(options), slots_(paths_.size()) {
+    rassert(options.maxAhead >= 1, 8123094571001, options.maxAhead);
+    rassert(options.threads >= 1, 8123094571002, options.threads);
+    const int threads = std::min(options.threads, std::max(size(), 1));
+    for (int i = 0; i < threads; ++i) threads_.emplace_back([this] { worker(); });
+}
+
+ImagePrefetcher::~ImagePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for (std::thread &thread : threads_) thread.join();
+}
+
+bool ImagePrefetcher::hasNext() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextToTake_ < size();
+}
+
+bool ImagePrefetcher::canStartLocked() const {
+    if (nextToDecode_ >= size()) return false;
+    if (nextToDecode_ == nextToTake_) return true; // the caller waits (or is about to wait) for it
+    return nextToDecode_ < nextToTake_ + options_.maxAhead && readyBytes_ < options_.maxBytes;
+}
+
+void ImagePrefetcher::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        changed_.wait(lock, [this] { return stopping_ || canStartLocked(); });
+        if (stopping_) return;
+        const int i = nextToDecode_++;
+
+        lock.unlock();
+        Slot decoded;
+        Timer t;
+        try {
+            decoded.image = load_image(paths_[i]);
+        } catch (...) {
+            decoded.error = std::current_exception();
+        }
+        decoded.decodeSeconds = t.elapsed();
+        decoded.bytes = decoded.image.stride_elements() * static_cast<std::size_t>(decoded.image.height());
+        decoded.ready = true;
+        lock.lock();
+
+        readyBytes_ += decoded.bytes;
+        slots_[i] = std::move(decoded);
+        changed_.notify_all();
+    }
+}
+
+image8u ImagePrefetcher::next(double *decodeSeconds) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    rassert(nextToTake_ < size(), 8123094571003, nextToTake_, size());
+    const int i = nextToTake_;
+    changed_.wait(lock, [&] { return slots_[i].ready; });
+
+    Slot slot = std::move(slots_[i]);
+    slots_[i] = Slot{};
+    readyBytes_ -= slot.bytes;
+    ++nextToTake_;
+    lock.unlock();
+    changed_.notify_all();
+
+    if (decodeSeconds) *decodeSeconds = slot.decodeSeconds;
+    if (slot.error) std::rethrow_exception(slot.error);
+    return std::move(slot.image);
+}
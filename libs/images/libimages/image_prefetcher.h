@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libimages/image.h>
+
+// Loads (load_image) a list of images ahead of their use on background threads, so that decoding of the next images
+// overlaps with processing of the current one. Images are taken strictly in order.
+class ImagePrefetcher final {
+  public:
+    struct Options {
+        // images decoded (or being decoded) beyond the last taken one
+        int maxAhead = 2;
+        // no new decode starts while the decoded images waiting to be taken are that large
+        // (except the one the caller waits for, so that a single huge image does not stall)
+        std::size_t maxBytes = std::size_t(512) << 20;
+        int threads = 1;
+    };
+
+    explicit ImagePrefetcher(std::vector<std::string> paths);
+    ImagePrefetcher(std::vector<std::string> paths, const Options &options);
+    // Waits for the decodes in flight, images not taken yet are dropped
+    ~ImagePrefetcher();
+
+    ImagePrefetcher(const ImagePrefetcher &) = delete;
+    ImagePrefetcher &operator=(const ImagePrefetcher &) = delete;
+
+    int size() const noexcept { return static_cast<int>(slots_.size()); }
+    bool hasNext() const;
+
+    // Blocks until the next image is decoded, rethrows its load error (the following images are still available).
+    // decodeSeconds (if passed) gets the time the decoding itself took (most of it is hidden if it was decoded ahead).
+    image8u next(double *decodeSeconds = nullptr);
+
+  private:
+    struct Slot {
+        bool ready = false;
+        image8u image;
+        std::exception_ptr error;
+        double decodeSeconds = 0.0;
+        std::size_t bytes = 0;
+    };
+
+    bool canStartLocked() const;
+    void worker();
+
+    std::vector<std::string> paths_;
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Slot> slots_;
+    int nextToDecode_ = 0;
+    int nextToTake_ = 0;
+    std::size_t readyBytes_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,67 @@
+#include "image_prefetcher.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libimages/image_io.h>
+
+#include <cstring>
+
+namespace {
+
+const std::string kImage = "data/00_photo_six_parts_downscaled_x4.jpg";
+
+bool sameImages(const image8u &a, const image8u &b) {
+    if (a.size() != b.size()) return false;
+    return std::memcmp(a.data(), b.data(), a.stride_elements() * static_cast<std::size_t>(a.height())) == 0;
+}
+
+} // namespace
+
+TEST(image_prefetcher, imagesComeInOrder) {
+    configureWorkingDirectory();
+
+    const image8u expected = load_image(kImage);
+    ImagePrefetcher::Options options;
+    options.maxAhead = 2;
+    options.threads = 2;
+    ImagePrefetcher prefetcher({kImage, kImage, kImage, kImage}, options);
+    EXPECT_EQ(prefetcher.size(), 4);
+    int taken = 0;
+    while (prefetcher.hasNext()) {
+        double decodeSeconds = -1.0;
+        const image8u image = prefetcher.next(&decodeSeconds);
+        EXPECT_TRUE(sameImages(image, expected));
+        EXPECT_GE(decodeSeconds, 0.0);
+        ++taken;
+    }
+    EXPECT_EQ(taken, 4);
+    EXPECT_THROW(prefetcher.next(), assertion_error);
+}
+
+TEST(image_prefetcher, zeroBudgetDecodesOneAtATime) {
+    configureWorkingDirectory();
+
+    ImagePrefetcher::Options options;
+    options.maxBytes = 0;
+    ImagePrefetcher prefetcher({kImage, kImage}, options);
+    EXPECT_EQ(prefetcher.next().width(), load_image(kImage).width());
+    EXPECT_EQ(prefetcher.next().width(), load_image(kImage).width());
+    EXPECT_FALSE(prefetcher.hasNext());
+}
+
+TEST(image_prefetcher, errorIsRethrownForItsImageOnly) {
+    configureWorkingDirectory();
+
+    ImagePrefetcher prefetcher({"data/no_such_image.jpg", kImage});
+    EXPECT_THROW(prefetcher.next(), assertion_error);
+    EXPECT_GT(prefetcher.next().width(), 0);
+}
+
+TEST(image_prefetcher, dropsImagesNotTaken) {
+    configureWorkingDirectory();
+
+    ImagePrefetcher prefetcher({kImage, kImage, kImage});
+    EXPECT_GT(prefetcher.next().width(), 0);
+}
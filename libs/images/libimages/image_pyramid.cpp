@@ -0,0 +1,105 @@
+#include "image_pyramid.h"
+
+#include <libimages/algorithms/downsample.h>
+
+#include <libbase/runtime_assert.h>
+
+template <typename T>
+ImagePyramid<T>::ImagePyramid(Image<T> base) {
+    rassert(base.width() > 0 && base.height() > 0, 61237810001, base.width(), base.height());
+    int w = base.width();
+    int h = base.height();
+    int n = 1;
+    while (w > 1 || h > 1) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        ++n;
+    }
+    levels_.resize(static_cast<std::size_t>(n));
+    levels_[0] = std::make_unique<Image<T>>(std::move(base));
+}
+
+template <typename T>
+int ImagePyramid<T>::levelWidth(int i) const {
+    rassert(i >= 0 && i < levels(), 61237810002, i, levels());
+    int w = levels_[0]->width();
+    for (int k = 0; k < i; ++k) w = (w + 1) / 2;
+    return w;
+}
+
+template <typename T>
+int ImagePyramid<T>::levelHeight(int i) const {
+    rassert(i >= 0 && i < levels(), 61237810003, i, levels());
+    int h = levels_[0]->height();
+    for (int k = 0; k < i; ++k) h = (h + 1) / 2;
+    return h;
+}
+
+template <typename T>
+int ImagePyramid<T>::levelFor(int maxWidth, int maxHeight) const {
+    for (int i = 0; i < levels(); ++i) {
+        if (levelWidth(i) <= maxWidth && levelHeight(i) <= maxHeight) return i;
+    }
+    return levels() - 1;
+}
+
+template <typename T>
+const Image<T> &ImagePyramid<T>::level(int i) {
+    rassert(i >= 0 && i < levels(), 61237810004, i, levels());
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int built = i;
+    while (!levels_[built]) --built;
+    for (int k = built + 1; k <= i; ++k) {
+        levels_[k] = std::make_unique<Image<T>>(downsample_2x(*levels_[k - 1]));
+    }
+    return *levels_[i];
+}
+
+template <typename T>
+bool ImagePyramid<T>::isBuilt(int i) const {
+    rassert(i >= 0 && i < levels(), 61237810005, i, levels());
+    std::lock_guard<std::mutex> lock(mutex_);
+    return levels_[i] != nullptr;
+}
+
+template <typename T>
+std::size_t ImagePyramid<T>::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t bytes = 0;
+    for (const auto &level : levels_) {
+        if (level) bytes += bytesOf(*level);
+    }
+    return bytes;
+}
+
+template <typename T>
+void ImagePyramid<T>::evict(int i) {
+    rassert(i > 0 && i < levels(), 61237810006, i, levels());
+    std::lock_guard<std::mutex> lock(mutex_);
+    levels_[i].reset();
+}
+
+template <typename T>
+void ImagePyramid<T>::evictAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i = 1; i < levels_.size(); ++i) levels_[i].reset();
+}
+
+template <typename T>
+Image<T> ImagePyramid<T>::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rassert(!levels_.empty(), 61237810007);
+    Image<T> base = std::move(*levels_[0]);
+    levels_.clear();
+    return base;
+}
+
+template <typename T>
+std::size_t ImagePyramid<T>::bytesOf(const Image<T> &image) noexcept {
+    return static_cast<std::size_t>(image.width()) * static_cast<std::size_t>(image.height()) *
+           static_cast<std::size_t>(image.channels()) * sizeof(T);
+}
+
+template class ImagePyramid<std::uint8_t>;
+template class ImagePyramid<float>;
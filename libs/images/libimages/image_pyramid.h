@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <libimages/image.h>
+
+// Lazily built 2x pyramid of one image: level 0 is the source, level i+1 = downsample_2x(level i), down to 1x1.
+// Levels are computed on first access (from the nearest finer cached level) and cached,
+// so every consumer can fetch the resolution it needs without going back to the full-resolution source.
+// Thread-safe. References returned by level() stay valid until that level is evicted.
+template <typename T>
+class ImagePyramid final {
+  public:
+    explicit ImagePyramid(Image<T> base);
+
+    ImagePyramid(const ImagePyramid &) = delete;
+    ImagePyramid &operator=(const ImagePyramid &) = delete;
+
+    // Number of levels (the last one is 1x1)
+    int levels() const noexcept { return static_cast<int>(levels_.size()); }
+
+    // Size of a level without building it: ceil(width / 2^i) x ceil(height / 2^i)
+    int levelWidth(int i) const;
+    int levelHeight(int i) const;
+
+    // Finest level with width <= maxWidth and height <= maxHeight (the coarsest one if none fits)
+    int levelFor(int maxWidth, int maxHeight) const;
+
+    const Image<T> &level(int i);
+    bool isBuilt(int i) const;
+
+    // Bytes of pixels held by all cached levels (including level 0)
+    std::size_t memoryBytes() const;
+
+    // Drops cached level i > 0 (it will be rebuilt on next access), level 0 is always kept
+    void evict(int i);
+    // Drops all levels except level 0
+    void evictAll();
+    // Moves the source out when it is not needed as a pyramid anymore (all levels are dropped, levels() == 0)
+    Image<T> release();
+
+  private:
+    static std::size_t bytesOf(const Image<T> &image) noexcept;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Image<T>>> levels_;
+};
+
+using pyramid8u = ImagePyramid<std::uint8_t>;
+using pyramid32f = ImagePyramid<float>;
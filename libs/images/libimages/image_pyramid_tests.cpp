@@ -0,0 +1,82 @@
+#include "image_pyramid.h"
+
+#include <gtest/gtest.h>
+
+#include <libimages/algorithms/downsample.h>
+
+#include <cstdint>
+
+namespace {
+
+image8u makeGradient(int w, int h) {
+    image8u img(w, h, 3);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            for (int c = 0; c < 3; ++c)
+                img(y, x, c) = static_cast<std::uint8_t>((x * 3 + y * 5 + c * 40) % 256);
+    return img;
+}
+
+} // namespace
+
+TEST(image_pyramid, levelsAreBuiltLazilyAndMatchDownsample2x) {
+    const image8u src = makeGradient(37, 20);
+    pyramid8u pyramid(src);
+
+    // 37x20 -> 19x10 -> 10x5 -> 5x3 -> 3x2 -> 2x1 -> 1x1
+    ASSERT_EQ(pyramid.levels(), 7);
+    EXPECT_EQ(pyramid.levelWidth(2), 10);
+    EXPECT_EQ(pyramid.levelHeight(2), 5);
+    EXPECT_EQ(pyramid.levelWidth(6), 1);
+
+    EXPECT_TRUE(pyramid.isBuilt(0));
+    EXPECT_FALSE(pyramid.isBuilt(1));
+    EXPECT_EQ(pyramid.memoryBytes(), std::size_t(37 * 20 * 3));
+
+    const image8u &level2 = pyramid.level(2);
+    EXPECT_TRUE(pyramid.isBuilt(1));
+    EXPECT_TRUE(pyramid.isBuilt(2));
+    EXPECT_FALSE(pyramid.isBuilt(3));
+    EXPECT_EQ(level2.toVector(), downsample_2x(downsample_2x(src)).toVector());
+    EXPECT_EQ(pyramid.memoryBytes(), std::size_t((37 * 20 + 19 * 10 + 10 * 5) * 3));
+
+    // cached: same object
+    EXPECT_EQ(&pyramid.level(2), &level2);
+}
+
+TEST(image_pyramid, evictionKeepsBaseAndRebuilds) {
+    const image8u src = makeGradient(64, 48);
+    pyramid8u pyramid(src);
+    const std::vector<std::uint8_t> expected = pyramid.level(3).toVector();
+
+    pyramid.evictAll();
+    EXPECT_TRUE(pyramid.isBuilt(0));
+    EXPECT_FALSE(pyramid.isBuilt(3));
+    EXPECT_EQ(pyramid.memoryBytes(), std::size_t(64 * 48 * 3));
+
+    pyramid.level(2);
+    pyramid.evict(2);
+    // rebuilt from cached level 1 (intermediate level 2 is cached again on the way)
+    EXPECT_EQ(pyramid.level(3).toVector(), expected);
+    EXPECT_TRUE(pyramid.isBuilt(2));
+}
+
+TEST(image_pyramid, levelForSize) {
+    pyramid32f pyramid(image32f(100, 60, 1));
+    EXPECT_EQ(pyramid.levelFor(100, 60), 0);
+    EXPECT_EQ(pyramid.levelFor(50, 60), 1);
+    EXPECT_EQ(pyramid.levelFor(30, 30), 2); // 25x15
+    EXPECT_EQ(pyramid.levelFor(0, 0), pyramid.levels() - 1);
+}
+
+TEST(image_pyramid, releaseMovesTheSourceOut) {
+    const image8u src = makeGradient(37, 20);
+    pyramid8u pyramid(src);
+    const std::uint8_t *pixels = pyramid.level(0).data();
+    pyramid.level(3);
+    const image8u released = pyramid.release();
+    EXPECT_EQ(released.data(), pixels); // the buffer is not copied
+    EXPECT_EQ(released.toVector(), src.toVector());
+    EXPECT_EQ(pyramid.levels(), 0);
+    EXPECT_EQ(pyramid.memoryBytes(), 0u);
+}
@@ -0,0 +1,96 @@
+#include "image_row_reader.h"
+
+#include <libimages/image_io.h>
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+// Next header number of a PNM file: whitespace and # comments before it are skipped
+int readPnmNumber(std::ifstream &in, const std::string &path) {
+    int ch = in.get();
+    while (ch != EOF && (std::isspace(ch) || ch == '#')) {
+        if (ch == '#') {
+            while (ch != EOF && ch != '\n') ch = in.get();
+        }
+        ch = in.get();
+    }
+    rassert(ch != EOF && std::isdigit(ch), 81203410001, "Bad PNM header", path);
+    long long value = 0;
+    while (ch != EOF && std::isdigit(ch)) {
+        value = value * 10 + (ch - '0');
+        rassert(value <= 1 << 30, 81203410002, "Bad PNM header", path);
+        ch = in.get();
+    }
+    // exactly one whitespace character ends a number (after maxval pixels start right away)
+    rassert(ch != EOF && std::isspace(ch), 81203410003, "Bad PNM header", path);
+    return static_cast<int>(value);
+}
+
+} // namespace
+
+ImageRowReader::ImageRowReader(const std::string &path) : path_(path) {
+    rassert(std::filesystem::is_regular_file(std::filesystem::u8path(path)), 81203410004, "Input file does not exist", path);
+    open();
+}
+
+void ImageRowReader::open() {
+    next_ = 0;
+    in_ = std::ifstream(path_, std::ios::binary);
+    rassert(in_.is_open(), 81203410005, "Failed to open file", path_);
+    char magic[2] = {0, 0};
+    in_.read(magic, 2);
+    if (in_.gcount() == 2 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6')) {
+        c_ = magic[1] == '6' ? 3 : 1;
+        w_ = readPnmNumber(in_, path_);
+        h_ = readPnmNumber(in_, path_);
+        const int maxval = readPnmNumber(in_, path_);
+        rassert(w_ > 0 && h_ > 0, 81203410006, "Bad PNM size", w_, h_, path_);
+        rassert(maxval == 255, 81203410007, "Only 8-bit PNM is supported", maxval, path_);
+        dataOffset_ = in_.tellg();
+        return;
+    }
+    in_ = std::ifstream();
+    whole_ = load_image(path_);
+    w_ = whole_.width();
+    h_ = whole_.height();
+    c_ = whole_.channels();
+}
+
+image8u ImageRowReader::read(int rows) {
+    rassert(rows >= 1, 81203410008, rows);
+    const int n = std::min(rows, h_ - next_);
+    if (n <= 0) return {};
+    image8u band(w_, n, c_, ImageInit::Uninitialized);
+    const std::size_t rowBytes = static_cast<std::size_t>(w_) * c_;
+    for (int j = 0; j < n; ++j) {
+        if (streaming()) {
+            in_.read(reinterpret_cast<char *>(band.ptr(j)), static_cast<std::streamsize>(rowBytes));
+            rassert(static_cast<std::size_t>(in_.gcount()) == rowBytes, 81203410009, "Truncated PNM", next_ + j, path_);
+        } else {
+            std::memcpy(band.ptr(j), whole_.ptr(next_ + j), rowBytes);
+        }
+    }
+    next_ += n;
+    return band;
+}
+
+void ImageRowReader::rewind() {
+    if (!streaming()) {
+        next_ = 0;
+        return;
+    }
+    in_.clear();
+    in_.seekg(dataOffset_);
+    rassert(in_.good(), 81203410010, "Failed to seek", path_);
+    next_ = 0;
+}
+
+std::size_t ImageRowReader::memoryBytes() const noexcept {
+    return streaming() ? 0 : static_cast<std::size_t>(w_) * h_ * c_;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+#include <libimages/image.h>
+
+// Reads an image file top to bottom by bands of rows, f.e. for scans too large to be decoded whole.
+// Binary PPM (P6) and PGM (P5), what scanners usually write, are streamed: only the band being read is in memory.
+// PNG and JPEG are decoded by stb, which can not decode incrementally, so they are decoded whole on open
+// and only handed out by bands, streaming() tells which case it is.
+class ImageRowReader final {
+  public:
+    explicit ImageRowReader(const std::string &path);
+
+    int width() const noexcept { return w_; }
+    int height() const noexcept { return h_; }
+    int channels() const noexcept { return c_; }
+    bool streaming() const noexcept { return whole_.width() == 0; }
+
+    // Index of the first row that the next read returns
+    int nextRow() const noexcept { return next_; }
+    bool done() const noexcept { return next_ >= h_; }
+
+    // Next min(rows, height() - nextRow()) rows (rows >= 1), empty image if there are none left
+    image8u read(int rows);
+    // From the first row again (the file is read again)
+    void rewind();
+
+    // Bytes held by the reader itself between reads (the whole image if it is not streaming())
+    std::size_t memoryBytes() const noexcept;
+
+  private:
+    void open();
+
+    std::string path_;
+    std::ifstream in_;
+    std::streamoff dataOffset_ = 0;
+    image8u whole_;
+    int w_ = 0;
+    int h_ = 0;
+    int c_ = 0;
+    int next_ = 0;
+};
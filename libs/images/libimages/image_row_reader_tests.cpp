@@ -0,0 +1,96 @@
+#include "image_row_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libimages/image_io.h>
+#include <libimages/tests_utils.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+const std::string kImage = "data/00_photo_six_parts_downscaled_x4.jpg";
+
+// Rows [y0, y0 + band.height()) of image are band
+bool sameRows(const image8u &image, int y0, const image8u &band) {
+    if (band.width() != image.width() || band.channels() != image.channels()) return false;
+    const std::size_t rowBytes = static_cast<std::size_t>(image.width()) * image.channels();
+    for (int j = 0; j < band.height(); ++j) {
+        if (std::memcmp(image.ptr(y0 + j), band.ptr(j), rowBytes) != 0) return false;
+    }
+    return true;
+}
+
+void expectBands(ImageRowReader &reader, const image8u &expected, int rows) {
+    int y = 0;
+    while (!reader.done()) {
+        EXPECT_EQ(reader.nextRow(), y);
+        const image8u band = reader.read(rows);
+        ASSERT_EQ(band.height(), std::min(rows, expected.height() - y));
+        ASSERT_TRUE(sameRows(expected, y, band)) << y;
+        y += band.height();
+    }
+    EXPECT_EQ(y, expected.height());
+    EXPECT_EQ(reader.read(rows).width(), 0);
+}
+
+} // namespace
+
+TEST(image_row_reader, streamsPnmByBands) {
+    configureWorkingDirectory();
+
+    const image8u rgb = load_image(kImage);
+    const std::string ppm = getUnitCaseDebugDir() + "scan.ppm";
+    std::filesystem::create_directories(getUnitCaseDebugDir());
+    save_image(rgb, ppm);
+
+    ImageRowReader reader(ppm);
+    EXPECT_TRUE(reader.streaming());
+    EXPECT_EQ(reader.memoryBytes(), 0u);
+    EXPECT_EQ(reader.width(), rgb.width());
+    EXPECT_EQ(reader.height(), rgb.height());
+    EXPECT_EQ(reader.channels(), 3);
+    expectBands(reader, rgb, 100);
+    reader.rewind();
+    expectBands(reader, rgb, 1);
+
+    image8u gray(37, 11, 1);
+    for (int j = 0; j < gray.height(); ++j)
+        for (int i = 0; i < gray.width(); ++i) gray(j, i) = static_cast<std::uint8_t>(i * 7 + j * 13);
+    const std::string pgm = getUnitCaseDebugDir() + "scan.pgm";
+    save_image(gray, pgm);
+    ImageRowReader grayReader(pgm);
+    EXPECT_EQ(grayReader.channels(), 1);
+    expectBands(grayReader, gray, 4);
+}
+
+TEST(image_row_reader, handsOutDecodedJpegByBands) {
+    configureWorkingDirectory();
+
+    const image8u rgb = load_image(kImage);
+    ImageRowReader reader(kImage);
+    EXPECT_FALSE(reader.streaming());
+    EXPECT_EQ(reader.memoryBytes(), static_cast<std::size_t>(rgb.width()) * rgb.height() * 3);
+    expectBands(reader, rgb, 64);
+}
+
+TEST(image_row_reader, truncatedPnmThrows) {
+    configureWorkingDirectory();
+
+    std::filesystem::create_directories(getUnitCaseDebugDir());
+    const std::string path = getUnitCaseDebugDir() + "truncated.ppm";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "P6\n# comment\n4 3\n255\n";
+        out << std::string(4 * 3 * 2, 'x'); // 2 of 3 rows
+    }
+    ImageRowReader reader(path);
+    EXPECT_EQ(reader.width(), 4);
+    EXPECT_EQ(reader.height(), 3);
+    EXPECT_EQ(reader.read(2).height(), 2);
+    EXPECT_THROW(reader.read(1), assertion_error);
+}
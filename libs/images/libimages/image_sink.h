@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Receives encoded bytes in order (f.e. writes them to a file, appends them to a memory buffer or sends them to a socket).
+// Errors are reported by throwing, the encoder then stops.
+using ImageSink = std::function<void(const std::uint8_t *data, std::size_t size)>;
+
+// Sink that appends to bytes (which must outlive it)
+inline ImageSink memory_sink(std::vector<std::uint8_t> &bytes) {
+    return [&bytes](const std::uint8_t *data, std::size_t size) { bytes.insert(bytes.end(), data, data + size); };
+}
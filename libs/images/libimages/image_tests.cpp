@@ -0,0 +1,118 @@
+#include "image.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/memory_tracker.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image_view.h>
+
+#include <utility>
+
+TEST(image, rowPointersMatchCheckedAccess) {
+    image8u img(5, 3, 3);
+    for (int j = 0; j < img.height(); ++j) {
+        for (int i = 0; i < img.width(); ++i) {
+            for (int c = 0; c < img.channels(); ++c) {
+                img(j, i, c) = static_cast<unsigned char>(j * 50 + i * 5 + c);
+            }
+        }
+    }
+
+    for (int j = 0; j < img.height(); ++j) {
+        const unsigned char* row = img.ptr(j);
+        std::span<const unsigned char> span = std::as_const(img).row(j);
+        EXPECT_EQ(span.size(), static_cast<std::size_t>(img.width() * img.channels()));
+        EXPECT_EQ(span.data(), row);
+        for (int i = 0; i < img.width(); ++i) {
+            EXPECT_EQ(img.ptr(j, i), row + i * img.channels());
+            for (int c = 0; c < img.channels(); ++c) {
+                EXPECT_EQ(row[i * img.channels() + c], img(j, i, c));
+                EXPECT_EQ(img.at(j, i, c), img(j, i, c));
+            }
+        }
+    }
+}
+
+TEST(image, rowPointerWrites) {
+    image32f img(4, 2, 1);
+    img.fill(0.0f);
+
+    float* row = img.ptr(1);
+    for (int i = 0; i < img.width(); ++i) {
+        row[i] = static_cast<float>(i + 1);
+    }
+    img.at(0, 2) = 7.0f;
+
+    EXPECT_EQ(img(1, 0), 1.0f);
+    EXPECT_EQ(img(1, 3), 4.0f);
+    EXPECT_EQ(img(0, 2), 7.0f);
+    EXPECT_EQ(img(0, 0), 0.0f);
+}
+
+TEST(image, toVectorIntoReusesCapacity) {
+    image8u img(5, 3, 2);
+    for (int j = 0; j < img.height(); ++j)
+        for (int i = 0; i < img.width(); ++i)
+            for (int c = 0; c < img.channels(); ++c) img(j, i, c) = static_cast<unsigned char>(j * 10 + i * 2 + c);
+
+    std::vector<unsigned char> out;
+    out.reserve(100);
+    const unsigned char* storage = out.data();
+    img.toVector(out);
+    EXPECT_EQ(out, img.toVector());
+    EXPECT_EQ(out.data(), storage);
+}
+
+TEST(image, adoptsBufferWithoutCopy) {
+    ImageBuffer buffer = ImagePool::global().acquire(6 * 2 * 3 + 1);
+    unsigned char* data = static_cast<unsigned char*>(buffer.data());
+    for (int i = 0; i < 6 * 2 * 3; ++i) data[i] = static_cast<unsigned char>(i);
+
+    image8u img(6, 2, 3, std::move(buffer));
+    EXPECT_EQ(img.data(), data);
+    EXPECT_EQ(img(1, 2, 1), 6 * 3 + 2 * 3 + 1);
+
+    EXPECT_THROW(image8u(64, 64, 3, ImagePool::global().acquire(6 * 2 * 3)), assertion_error);
+}
+
+TEST(image, buffersAreCountedPerPixelType) {
+    const int category = memory::category("image32f");
+    const memory::Counters before = memory::counters(category);
+    {
+        image32f a(64, 32, 1);
+        const std::int64_t bytes = static_cast<std::int64_t>(64 * 32 * sizeof(float));
+        EXPECT_EQ(memory::counters(category).liveBytes, before.liveBytes + bytes);
+        EXPECT_EQ(memory::counters(category).allocations, before.allocations + 1);
+
+        image32f b = a;
+        image32f c = std::move(a);
+        EXPECT_EQ(memory::counters(category).liveBytes, before.liveBytes + 2 * bytes);
+        b = image32f(8, 8, 1);
+        EXPECT_EQ(memory::counters(category).liveBytes, before.liveBytes + bytes + 8 * 8 * static_cast<std::int64_t>(sizeof(float)));
+        EXPECT_GE(memory::counters(category).peakBytes, before.liveBytes + 2 * bytes);
+    }
+    EXPECT_EQ(memory::counters(category).liveBytes, before.liveBytes);
+}
+
+TEST(image, fastAccessChecksThrowWhenCompiledIn) {
+    image8u img(5, 3, 3);
+    const image8u_cview view(img);
+    BitMask mask(5, 3);
+#if defined(LIBIMAGES_CHECKED_FAST_ACCESS)
+    static_assert(!noexcept(img.ptr(0)) && !noexcept(view.at(0, 0)) && !noexcept(mask.test(0, 0)));
+    EXPECT_THROW(img.ptr(3), assertion_error);
+    EXPECT_THROW(img.at(0, 5), assertion_error);
+    EXPECT_THROW(img.row(-1), assertion_error);
+    EXPECT_THROW(view.at(0, 0, 3), assertion_error);
+    EXPECT_THROW(mask.test(3, 0), assertion_error);
+    try {
+        img.ptr(0, 7);
+        ADD_FAILURE() << "no assertion";
+    } catch (const assertion_error &e) {
+        EXPECT_EQ(e.code(), "78497218934");
+    }
+#else
+    static_assert(noexcept(img.ptr(0)) && noexcept(view.at(0, 0)) && noexcept(mask.test(0, 0)));
+#endif
+    EXPECT_EQ(img.ptr(2, 4), img.ptr(2) + 12);
+}
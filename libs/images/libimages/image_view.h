@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <source_location>
+#include <span>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include <libbase/runtime_assert.h>
+#include <libimages/image.h>
+
+// Non-owning view of a rectangular region of an image: pointer + width/height/channels + row stride.
+// T is either a pixel type (mutable view) or const pixel type (read-only view), f.e. ImageView<const std::uint8_t>.
+// View does not extend lifetime of underlying pixels - parent image must outlive all its views.
+// Unlike Image<T> rows are not required to be adjacent: row j starts stride_elements()*j after data().
+template <typename T> class ImageView final {
+  public:
+    using value_type = std::remove_const_t<T>;
+    using element_type = T;
+
+    ImageView() = default;
+
+    ImageView(T *data, int width, int height, int channels, std::size_t stride_elements) noexcept
+        : data_(data), w_(width), h_(height), c_(channels), stride_(stride_elements) {}
+
+    // Implicit views of whole image
+    ImageView(Image<value_type> &image) noexcept
+        : ImageView(image.data(), image.width(), image.height(), image.channels(), image.stride_elements()) {}
+
+    ImageView(const Image<value_type> &image) noexcept
+        requires std::is_const_v<T>
+        : ImageView(image.data(), image.width(), image.height(), image.channels(), image.stride_elements()) {}
+
+    // Mutable view -> read-only view
+    // (template, so that it is not treated as a copy constructor)
+    template <typename U>
+        requires(std::is_const_v<T> && std::is_same_v<U, value_type>)
+    ImageView(const ImageView<U> &other) noexcept
+        : ImageView(other.data(), other.width(), other.height(), other.channels(), other.stride_elements()) {}
+
+    int width() const noexcept { return w_; }
+    int height() const noexcept { return h_; }
+    int channels() const noexcept { return c_; }
+    std::tuple<int, int, int> size() const noexcept { return {w_, h_, c_}; }
+    bool empty() const noexcept { return w_ == 0 || h_ == 0; }
+
+    // Distance (in elements) between starts of adjacent rows, >= width * channels
+    std::size_t stride_elements() const noexcept { return stride_; }
+    // True if rows are adjacent in memory (f.e. whole Image<T> or full-width stripe)
+    bool is_contiguous() const noexcept { return stride_ == row_elements(); }
+
+    T *data() const noexcept { return data_; }
+
+    T *ptr(int j) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(j >= 0 && j < h_, 45129837610, j, h_);
+        return data_ + static_cast<std::size_t>(j) * stride_;
+    }
+
+    T *ptr(int j, int i) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(i >= 0 && i < w_, 45129837611, i, w_);
+        return ptr(j) + static_cast<std::size_t>(i) * static_cast<std::size_t>(c_);
+    }
+
+    std::span<T> row(int j) const LIBIMAGES_FAST_ACCESS_NOEXCEPT { return {ptr(j), row_elements()}; }
+
+    T &at(int j, int i, int c = 0) const LIBIMAGES_FAST_ACCESS_NOEXCEPT {
+        LIBIMAGES_FAST_ACCESS_CHECK(c >= 0 && c < c_, 45129837612, c, c_);
+        return ptr(j, i)[c];
+    }
+
+    // Checked access, same contract as Image<T>::operator()
+    T &operator()(int j, int i, std::source_location loc = std::source_location::current()) const {
+        rassert(c_ == 1, "(j,i) access is only valid for grayscale images", c_);
+        check_bounds(j, i, 0, loc);
+        return ptr(j, i)[0];
+    }
+
+    T &operator()(int j, int i, int c, std::source_location loc = std::source_location::current()) const {
+        check_bounds(j, i, c, loc);
+        return ptr(j, i)[c];
+    }
+
+    // Region [x, x+width) x [y, y+height) of this view
+    ImageView subview(int x, int y, int width, int height) const {
+        rassert(x >= 0 && y >= 0 && width >= 0 && height >= 0 && x + width <= w_ && y + height <= h_, 45129837613,
+                "Subview out of bounds:", "x=" + std::to_string(x) + " y=" + std::to_string(y),
+                "w=" + std::to_string(width) + " h=" + std::to_string(height),
+                "view=" + std::to_string(w_) + "x" + std::to_string(h_));
+        if (width == 0 || height == 0) return ImageView(data_, width, height, c_, stride_);
+        return ImageView(ptr(y, x), width, height, c_, stride_);
+    }
+
+    // Deep copy into a standalone image
+    Image<value_type> toImage() const {
+        rassert(!empty(), 45129837614, "Can't copy empty view");
+        Image<value_type> out(w_, h_, c_, ImageInit::Uninitialized);
+        for (int j = 0; j < h_; ++j) {
+            const T *src = ptr(j);
+            std::copy(src, src + row_elements(), out.ptr(j));
+        }
+        return out;
+    }
+
+  private:
+    T *data_ = nullptr;
+    int w_ = 0;
+    int h_ = 0;
+    int c_ = 0;
+    std::size_t stride_ = 0;
+
+    std::size_t row_elements() const noexcept { return static_cast<std::size_t>(w_) * static_cast<std::size_t>(c_); }
+
+    void check_bounds(int j, int i, int c, std::source_location loc) const {
+        rassert(i >= 0 && i < w_ && j >= 0 && j < h_ && c >= 0 && c < c_, 45129837615,
+                "Pixel out of bounds:", "j=" + std::to_string(j) + "/height=" + std::to_string(h_) + ",",
+                "i=" + std::to_string(i) + "/width=" + std::to_string(w_) + ",",
+                "c=" + std::to_string(c) + "/channels=" + std::to_string(c_), format_code_location(loc));
+    }
+};
+
+// Whether pixels of view lie in the buffer of image (f.e. view is a region of image): an algorithm that writes image
+// while it reads view has to compute into another buffer then
+template <typename T, typename U>
+bool overlaps(const ImageView<U> &view, const Image<T> &image) noexcept {
+    static_assert(std::is_same_v<std::remove_const_t<U>, T>);
+    if (view.empty() || image.data() == nullptr) return false;
+    const T *begin = view.data();
+    const T *end = view.ptr(view.height() - 1) + static_cast<std::size_t>(view.width()) * static_cast<std::size_t>(view.channels());
+    const T *imageBegin = image.data();
+    const T *imageEnd = imageBegin + image.stride_elements() * static_cast<std::size_t>(image.height());
+    return std::less<const T *>()(begin, imageEnd) && std::less<const T *>()(imageBegin, end);
+}
+
+using image8u_view = ImageView<std::uint8_t>;
+using image8u_cview = ImageView<const std::uint8_t>;
+using image32i_cview = ImageView<const int>;
+using image32f_view = ImageView<float>;
+using image32f_cview = ImageView<const float>;
@@ -0,0 +1,60 @@
+#include "image_view.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/runtime_assert.h>
+
+TEST(image_view, subviewSharesPixels) {
+    image8u img(6, 4, 3);
+    for (int j = 0; j < img.height(); ++j) {
+        for (int i = 0; i < img.width(); ++i) {
+            for (int c = 0; c < img.channels(); ++c) {
+                img(j, i, c) = static_cast<unsigned char>(j * 60 + i * 9 + c);
+            }
+        }
+    }
+
+    const image8u_view whole(img);
+    EXPECT_TRUE(whole.is_contiguous());
+    EXPECT_EQ(whole.stride_elements(), img.stride_elements());
+
+    const image8u_view part = whole.subview(2, 1, 3, 2);
+    EXPECT_EQ(part.width(), 3);
+    EXPECT_EQ(part.height(), 2);
+    EXPECT_EQ(part.channels(), 3);
+    EXPECT_FALSE(part.is_contiguous());
+    EXPECT_EQ(part.data(), img.ptr(1, 2));
+
+    for (int j = 0; j < part.height(); ++j) {
+        for (int i = 0; i < part.width(); ++i) {
+            for (int c = 0; c < part.channels(); ++c) {
+                EXPECT_EQ(part(j, i, c), img(j + 1, i + 2, c));
+                EXPECT_EQ(part.at(j, i, c), img(j + 1, i + 2, c));
+            }
+        }
+    }
+
+    // Writes through a view are visible in the parent
+    part(1, 2, 0) = 7;
+    EXPECT_EQ(img(2, 4, 0), 7);
+
+    // Nested subview keeps parent stride
+    const image8u_cview nested = image8u_cview(part).subview(1, 1, 2, 1);
+    EXPECT_EQ(nested.data(), img.ptr(2, 3));
+    EXPECT_EQ(nested.stride_elements(), img.stride_elements());
+
+    const image8u copy = part.toImage();
+    EXPECT_EQ(copy.width(), 3);
+    EXPECT_EQ(copy.height(), 2);
+    EXPECT_EQ(copy(1, 2, 0), 7);
+    EXPECT_EQ(copy(0, 0, 1), img(1, 2, 1));
+}
+
+TEST(image_view, boundsAreChecked) {
+    image32f img(5, 5, 1);
+    const image32f_cview view = image32f_cview(img).subview(1, 1, 3, 3);
+
+    EXPECT_THROW(view(3, 0), assertion_error);
+    EXPECT_THROW(view(0, -1), assertion_error);
+    EXPECT_THROW(view.subview(2, 2, 2, 1), assertion_error);
+}
@@ -0,0 +1,113 @@
+#include "mapped_file.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <filesystem>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string &path) {
+    const std::wstring widePath = std::filesystem::u8path(path).wstring();
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    rassert(file != INVALID_HANDLE_VALUE, "Failed to open file", path);
+
+    LARGE_INTEGER fileSize{};
+    const bool sized = GetFileSizeEx(file, &fileSize) != 0;
+    if (!sized || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        rassert(sized, "Failed to get file size", path);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file); // the mapping keeps the file open
+    rassert(mapping != nullptr, "CreateFileMapping failed", path);
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        rassert(false, "MapViewOfFile failed", path);
+    }
+    mapping_ = mapping;
+    data_ = static_cast<const std::uint8_t *>(view);
+    size_ = static_cast<std::size_t>(fileSize.QuadPart);
+}
+
+void MappedFile::reset() noexcept {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+      mapping_(std::exchange(other.mapping_, nullptr)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    rassert(fd >= 0, "Failed to open file", path);
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        rassert(false, "fstat failed", path);
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void *view = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    rassert(view != MAP_FAILED, "mmap failed", path);
+    data_ = static_cast<const std::uint8_t *>(view);
+    size_ = static_cast<std::size_t>(st.st_size);
+}
+
+void MappedFile::reset() noexcept {
+    if (data_) ::munmap(const_cast<std::uint8_t *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    reset();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile), so that its bytes can be parsed in place
+// without reading them into a buffer first. Empty files are not mapped (bytes() is empty).
+class MappedFile final {
+  public:
+    MappedFile() noexcept = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    std::span<const std::uint8_t> bytes() const noexcept { return {data_, size_}; }
+    std::size_t size() const noexcept { return size_; }
+
+    void reset() noexcept;
+
+  private:
+    const std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+#if defined(_WIN32)
+    void *mapping_ = nullptr; // HANDLE of the file mapping
+#endif
+};
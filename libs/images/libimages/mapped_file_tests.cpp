@@ -0,0 +1,40 @@
+#include "mapped_file.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+#include <libimages/debug_io.h>
+#include <libimages/tests_utils.h>
+
+#include <fstream>
+#include <string>
+#include <utility>
+
+TEST(mapped_file, bytesAreTheFileContent) {
+    configureWorkingDirectory();
+
+    const std::string path = getUnitCaseDebugDir() + "content.bin";
+    debug_io::ensure_dir_exists_for_file(path);
+    const std::string content = "mapped file content";
+    std::ofstream(path, std::ios::binary) << content;
+
+    MappedFile file(path);
+    ASSERT_EQ(file.size(), content.size());
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(file.bytes().data()), file.size()), content);
+
+    MappedFile moved = std::move(file);
+    EXPECT_EQ(file.size(), 0u);
+    EXPECT_EQ(moved.bytes()[0], 'm');
+}
+
+TEST(mapped_file, emptyAndMissingFiles) {
+    configureWorkingDirectory();
+
+    const std::string path = getUnitCaseDebugDir() + "empty.bin";
+    debug_io::ensure_dir_exists_for_file(path);
+    std::ofstream(path, std::ios::binary).close();
+    EXPECT_TRUE(MappedFile(path).bytes().empty());
+
+    EXPECT_THROW(MappedFile(getUnitCaseDebugDir() + "missing.bin"), assertion_error);
+}
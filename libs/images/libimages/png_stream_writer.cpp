@@ -0,0 +1,413 @@
+#include "png_stream_writer.h"
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr int kWindow = 32768;    // max distance of a match
+constexpr int kHashBits = 15;
+constexpr int kMaxChain = 64;     // candidates tried per position
+constexpr int kMinMatch = 3;
+constexpr int kMaxMatch = 258;
+constexpr std::size_t kChunkBytes = std::size_t(1) << 16;
+// Filtered bytes of rows deflated as one piece (the rows of a band are split into pieces of about this size)
+constexpr std::size_t kPieceBytes = std::size_t(256) << 10;
+
+constexpr std::array<int, 29> kLengthBase = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<int, 29> kLengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                              2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<int, 30> kDistBase = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                           193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<int, 30> kDistExtra = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                            6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+const std::array<std::uint32_t, 256> &crcTable() {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+std::uint32_t crcUpdate(std::uint32_t crc, const std::uint8_t *data, std::size_t size) {
+    const auto &table = crcTable();
+    for (std::size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+std::uint32_t adlerUpdate(std::uint32_t adler, const std::uint8_t *data, std::size_t size) {
+    std::uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0) {
+        const std::size_t n = std::min<std::size_t>(size, 5552); // the largest n for which sums do not overflow
+        for (std::size_t i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += n;
+        size -= n;
+    }
+    return (b << 16) | a;
+}
+
+// Adler-32 of a + b from the ones of a and b (as zlib adler32_combine)
+std::uint32_t adlerCombine(std::uint32_t adlerA, std::uint32_t adlerB, std::size_t sizeB) {
+    constexpr std::uint32_t base = 65521;
+    const std::uint32_t rem = static_cast<std::uint32_t>(sizeB % base);
+    std::uint32_t sum1 = adlerA & 0xFFFF;
+    std::uint32_t sum2 = static_cast<std::uint32_t>((std::uint64_t(rem) * sum1) % base);
+    sum1 += (adlerB & 0xFFFF) + base - 1;
+    sum2 += ((adlerA >> 16) & 0xFFFF) + ((adlerB >> 16) & 0xFFFF) + base - rem;
+    if (sum1 >= base) sum1 -= base;
+    if (sum1 >= base) sum1 -= base;
+    if (sum2 >= 2 * base) sum2 -= 2 * base;
+    if (sum2 >= base) sum2 -= base;
+    return (sum2 << 16) | sum1;
+}
+
+void putBE32(std::uint8_t *p, std::uint32_t v) {
+    p[0] = static_cast<std::uint8_t>(v >> 24);
+    p[1] = static_cast<std::uint8_t>(v >> 16);
+    p[2] = static_cast<std::uint8_t>(v >> 8);
+    p[3] = static_cast<std::uint8_t>(v);
+}
+
+std::uint32_t reverseBits(std::uint32_t code, int count) {
+    std::uint32_t res = 0;
+    for (int i = 0; i < count; ++i, code >>= 1) res = (res << 1) | (code & 1);
+    return res;
+}
+
+std::uint32_t hash3(const std::uint8_t *p) {
+    const std::uint32_t v = (std::uint32_t(p[0]) << 16) | (std::uint32_t(p[1]) << 8) | p[2];
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+int paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+// Row cur (rowBytes bytes, bpp per pixel) filtered against up with the type byte first into out (rowBytes + 1 bytes):
+// the filter with the smallest sum of absolute (signed) residuals, candidates is scratch of 5 * (rowBytes + 1)
+void filterRow(const std::uint8_t *cur, const std::uint8_t *up, int rowBytes, int bpp, std::uint8_t *candidates, std::uint8_t *out) {
+    int bestFilter = 0;
+    long bestSum = -1;
+    for (int f = 0; f < 5; ++f) {
+        std::uint8_t *candidate = candidates + static_cast<std::size_t>(f) * (rowBytes + 1);
+        candidate[0] = static_cast<std::uint8_t>(f);
+        long sum = 0;
+        for (int i = 0; i < rowBytes; ++i) {
+            const int a = i >= bpp ? cur[i - bpp] : 0;
+            const int b = up[i];
+            const int c = i >= bpp ? up[i - bpp] : 0;
+            int predicted = 0;
+            switch (f) {
+            case 1: predicted = a; break;
+            case 2: predicted = b; break;
+            case 3: predicted = (a + b) >> 1; break;
+            case 4: predicted = paeth(a, b, c); break;
+            default: break;
+            }
+            const std::uint8_t residual = static_cast<std::uint8_t>(cur[i] - predicted);
+            candidate[i + 1] = residual;
+            sum += std::abs(static_cast<int>(static_cast<std::int8_t>(residual)));
+        }
+        if (bestSum < 0 || sum < bestSum) {
+            bestSum = sum;
+            bestFilter = f;
+        }
+    }
+    std::memcpy(out, candidates + static_cast<std::size_t>(bestFilter) * (rowBytes + 1), static_cast<std::size_t>(rowBytes) + 1);
+}
+
+// Deflate bits packed from the least significant bit of every byte on
+struct BitWriter {
+    std::vector<std::uint8_t> *out = nullptr;
+    std::uint64_t buffer = 0;
+    int count = 0;
+
+    void put(std::uint32_t bits, int n) {
+        buffer |= std::uint64_t(bits) << count;
+        count += n;
+        while (count >= 8) {
+            out->push_back(static_cast<std::uint8_t>(buffer));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are packed starting from their most significant bit
+    void putHuffman(std::uint32_t code, int n) { put(reverseBits(code, n), n); }
+
+    void putLiteral(int value) {
+        if (value < 144) putHuffman(0x30 + value, 8);
+        else putHuffman(0x190 + value - 144, 9);
+    }
+
+    void putMatch(int length, int distance) {
+        int j = 0;
+        while (j + 1 < static_cast<int>(kLengthBase.size()) && kLengthBase[j + 1] <= length) ++j;
+        const int symbol = 257 + j;
+        if (symbol < 280) putHuffman(symbol - 256, 7);
+        else putHuffman(0xC0 + symbol - 280, 8);
+        if (kLengthExtra[j]) put(length - kLengthBase[j], kLengthExtra[j]);
+
+        int d = 0;
+        while (d + 1 < static_cast<int>(kDistBase.size()) && kDistBase[d + 1] <= distance) ++d;
+        putHuffman(d, 5);
+        if (kDistExtra[d]) put(distance - kDistBase[d], kDistExtra[d]);
+    }
+
+    // Empty stored block: the stream is byte-aligned after it
+    void syncFlush() {
+        put(0, 3);
+        if (count > 0) put(0, 8 - count);
+        static const std::uint8_t empty[4] = {0x00, 0x00, 0xFF, 0xFF};
+        out->insert(out->end(), empty, empty + 4);
+    }
+};
+
+// Bytes [from, to) of data as a non-final fixed Huffman block ended by a sync flush, so that pieces deflated
+// independently are just concatenated. Matches reach back up to the window into data before from
+// (the previous piece or the history of the previous band), which the decoder has by then.
+void deflatePiece(const std::uint8_t *data, int from, int to, std::vector<std::uint8_t> &out) {
+    thread_local std::vector<int> head, prev;
+    head.assign(std::size_t(1) << kHashBits, -1);
+    prev.resize(kWindow);
+
+    auto insert = [&](int pos) {
+        const std::uint32_t h = hash3(data + pos);
+        prev[pos & (kWindow - 1)] = head[h];
+        head[h] = pos;
+    };
+    for (int pos = std::max(0, from - kWindow); pos < from && pos + kMinMatch <= to; ++pos) insert(pos);
+
+    BitWriter bits;
+    bits.out = &out;
+    bits.put(0, 1); // not final
+    bits.put(1, 2); // fixed Huffman codes
+
+    int i = from;
+    while (i < to) {
+        int bestLen = 0, bestDist = 0;
+        if (i + kMinMatch <= to) {
+            const int maxLen = std::min(kMaxMatch, to - i);
+            int chain = kMaxChain;
+            // an entry of prev is overwritten only by a position a whole window later, so the chain is valid
+            // while candidates are within the window
+            for (int cand = head[hash3(data + i)]; cand >= 0 && i - cand <= kWindow && chain-- > 0;
+                 cand = prev[cand & (kWindow - 1)]) {
+                if (data[cand + bestLen] != data[i + bestLen]) continue;
+                int len = 0;
+                while (len < maxLen && data[cand + len] == data[i + len]) ++len;
+                if (len > bestLen) {
+                    bestLen = len;
+                    bestDist = i - cand;
+                    if (len == maxLen) break;
+                }
+            }
+            insert(i);
+        }
+        if (bestLen >= kMinMatch) {
+            bits.putMatch(bestLen, bestDist);
+            for (int k = i + 1; k < i + bestLen && k + kMinMatch <= to; ++k) insert(k);
+            i += bestLen;
+        } else {
+            bits.putLiteral(data[i]);
+            ++i;
+        }
+    }
+    bits.putHuffman(0, 7); // end of block (256)
+    bits.syncFlush();
+}
+
+} // namespace
+
+PngStreamWriter::PngStreamWriter(const std::string &path, int width, int height, int channels, Compression compression)
+    : path_(path), width_(width), height_(height), channels_(channels), compression_(compression) {
+    rassert(width > 0 && height > 0, 7612093481001, width, height);
+    rassert(channels == 1 || channels == 3 || channels == 4, 7612093481002, "Unsupported channel count", channels);
+
+    file_ = std::fopen(path.c_str(), "wb");
+    rassert(file_ != nullptr, 7612093481003, "Failed to open file for writing", path);
+    sink_ = [this](const std::uint8_t *data, std::size_t size) {
+        rassert(std::fwrite(data, 1, size, file_) == size, 7612093481011, "Failed to write", path_);
+    };
+    start();
+}
+
+PngStreamWriter::PngStreamWriter(ImageSink sink, int width, int height, int channels, Compression compression)
+    : path_("<sink>"), sink_(std::move(sink)), width_(width), height_(height), channels_(channels), compression_(compression) {
+    rassert(width > 0 && height > 0, 7612093481012, width, height);
+    rassert(channels == 1 || channels == 3 || channels == 4, 7612093481013, "Unsupported channel count", channels);
+    rassert(static_cast<bool>(sink_), 7612093481014, "Empty sink");
+    start();
+}
+
+void PngStreamWriter::start() {
+    const int width = width_;
+    const int height = height_;
+    const int channels = channels_;
+    const std::size_t rowBytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(channels);
+    if (compression_ == Compression::Fixed) prevRow_.assign(rowBytes, 0);
+
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    sink_(signature, sizeof(signature));
+
+    static const std::uint8_t colorTypes[5] = {0, 0, 4, 2, 6};
+    std::uint8_t ihdr[13] = {};
+    putBE32(ihdr + 0, static_cast<std::uint32_t>(width));
+    putBE32(ihdr + 4, static_cast<std::uint32_t>(height));
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = colorTypes[channels];
+    writeChunk("IHDR", ihdr, sizeof(ihdr));
+
+    // zlib header (32K window, no dictionary), deflate blocks have their own headers
+    pending_.push_back(0x78);
+    pending_.push_back(0x01);
+}
+
+PngStreamWriter::~PngStreamWriter() {
+    if (file_) std::fclose(file_);
+}
+
+void PngStreamWriter::writeRows(image8u_cview rows) {
+    rassert(!finished_, 7612093481005);
+    rassert(rows.width() == width_ && rows.channels() == channels_, 7612093481006, rows.width(), rows.channels(), width_, channels_);
+    rassert(rowsWritten_ + rows.height() <= height_, 7612093481007, rowsWritten_, rows.height(), height_);
+
+    const int rowBytes = width_ * channels_;
+    const int bpp = channels_;
+    band_.clear();
+    if (compression_ == Compression::Stored) {
+        for (int j = 0; j < rows.height(); ++j) {
+            band_.push_back(0); // filter None
+            band_.insert(band_.end(), rows.ptr(j), rows.ptr(j) + rowBytes);
+        }
+        rowsWritten_ += rows.height();
+        adler_ = adlerUpdate(adler_, band_.data(), band_.size());
+        storeBand();
+        if (pending_.size() >= kChunkBytes) flushBytes(false);
+        return;
+    }
+    if (rows.height() == 0) return;
+
+    // the band goes after the history, so that its first piece has matches into the previous band too
+    const std::size_t filteredRow = static_cast<std::size_t>(rowBytes) + 1;
+    band_.assign(history_.begin(), history_.end());
+    const std::size_t offset = history_.size();
+    band_.resize(offset + filteredRow * static_cast<std::size_t>(rows.height()));
+    rassert(band_.size() <= static_cast<std::size_t>(std::numeric_limits<int>::max()), 7612093481015, "Too large band", rows.height());
+
+    // pieces of whole rows, by bytes (not by threads), so that the file does not depend on the number of threads
+    const int rowsPerPiece = static_cast<int>(std::max<std::size_t>(1, kPieceBytes / filteredRow));
+    const int pieces = (rows.height() + rowsPerPiece - 1) / rowsPerPiece;
+    pieces_.resize(static_cast<std::size_t>(pieces));
+    pieceAdlers_.resize(static_cast<std::size_t>(pieces));
+
+    parallelForEach(0, pieces, [&](int piece) {
+        thread_local std::vector<std::uint8_t> candidates;
+        candidates.resize(5 * filteredRow);
+        const int j1 = std::min(rows.height(), (piece + 1) * rowsPerPiece);
+        for (int j = piece * rowsPerPiece; j < j1; ++j) {
+            const std::uint8_t *up = j == 0 ? prevRow_.data() : rows.ptr(j - 1);
+            filterRow(rows.ptr(j), up, rowBytes, bpp, candidates.data(), band_.data() + offset + filteredRow * static_cast<std::size_t>(j));
+        }
+    });
+    parallelForEach(0, pieces, [&](int piece) {
+        const std::size_t from = offset + filteredRow * static_cast<std::size_t>(piece) * rowsPerPiece;
+        const std::size_t to = std::min(band_.size(), from + filteredRow * static_cast<std::size_t>(rowsPerPiece));
+        pieces_[piece].clear();
+        deflatePiece(band_.data(), static_cast<int>(from), static_cast<int>(to), pieces_[piece]);
+        pieceAdlers_[piece] = adlerUpdate(1, band_.data() + from, to - from);
+    });
+
+    std::memcpy(prevRow_.data(), rows.ptr(rows.height() - 1), static_cast<std::size_t>(rowBytes));
+    rowsWritten_ += rows.height();
+    for (int piece = 0; piece < pieces; ++piece) {
+        const std::size_t from = offset + filteredRow * static_cast<std::size_t>(piece) * rowsPerPiece;
+        const std::size_t size = std::min(band_.size() - from, filteredRow * static_cast<std::size_t>(rowsPerPiece));
+        adler_ = adlerCombine(adler_, pieceAdlers_[piece], size);
+        pending_.insert(pending_.end(), pieces_[piece].begin(), pieces_[piece].end());
+        if (pending_.size() >= kChunkBytes) flushBytes(false);
+    }
+    const std::size_t keep = std::min<std::size_t>(band_.size(), kWindow);
+    history_.assign(band_.end() - static_cast<std::ptrdiff_t>(keep), band_.end());
+}
+
+void PngStreamWriter::finish() {
+    rassert(!finished_, 7612093481008);
+    rassert(rowsWritten_ == height_, 7612093481009, "Not all rows were written", rowsWritten_, height_);
+    finished_ = true;
+
+    if (compression_ == Compression::Fixed) {
+        // empty final fixed Huffman block: header bits 1 and 01, end of block (seven zero bits), padding
+        pending_.push_back(0x03);
+        pending_.push_back(0x00);
+    } else {
+        // empty final stored block
+        static const std::uint8_t empty[5] = {0x01, 0x00, 0x00, 0xFF, 0xFF};
+        pending_.insert(pending_.end(), empty, empty + 5);
+    }
+    std::uint8_t adler[4];
+    putBE32(adler, adler_);
+    pending_.insert(pending_.end(), adler, adler + 4);
+    flushBytes(true);
+    writeChunk("IEND", nullptr, 0);
+
+    if (file_) {
+        const bool closed = std::fclose(file_) == 0;
+        file_ = nullptr;
+        rassert(closed, 7612093481010, "Failed to write", path_);
+    }
+}
+
+void PngStreamWriter::storeBand() {
+    // non-final stored blocks of at most 65535 bytes, every block starts and ends byte-aligned
+    for (std::size_t from = 0; from < band_.size();) {
+        const std::size_t size = std::min<std::size_t>(band_.size() - from, 65535);
+        const std::uint8_t header[5] = {0x00, static_cast<std::uint8_t>(size), static_cast<std::uint8_t>(size >> 8),
+                                        static_cast<std::uint8_t>(~size), static_cast<std::uint8_t>(~size >> 8)};
+        pending_.insert(pending_.end(), header, header + 5);
+        pending_.insert(pending_.end(), band_.begin() + from, band_.begin() + from + size);
+        from += size;
+    }
+}
+
+void PngStreamWriter::flushBytes(bool all) {
+    if (pending_.empty()) return;
+    if (!all && pending_.size() < kChunkBytes) return;
+    writeChunk("IDAT", pending_.data(), pending_.size());
+    pending_.clear();
+}
+
+void PngStreamWriter::writeChunk(const char *type, const std::uint8_t *data, std::size_t size) {
+    std::uint8_t header[8];
+    putBE32(header, static_cast<std::uint32_t>(size));
+    std::memcpy(header + 4, type, 4);
+    std::uint32_t crc = crcUpdate(0xFFFFFFFFu, header + 4, 4);
+    if (size > 0) crc = crcUpdate(crc, data, size);
+    std::uint8_t footer[4];
+    putBE32(footer, crc ^ 0xFFFFFFFFu);
+
+    sink_(header, sizeof(header));
+    if (size > 0) sink_(data, size);
+    sink_(footer, sizeof(footer));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <libimages/image_sink.h>
+#include <libimages/image_view.h>
+
+// Writes an 8-bit PNG (1/3/4 channels) band of rows by band of rows, so that an image of any height is encoded with
+// the memory of a band: every row is filtered against the previous one (kept between bands), a band is deflated
+// into the single zlib stream and complete bytes go to IDAT chunks right away (to the file or to a sink).
+// Unlike save_image, the whole image never has to exist.
+// A band is split into pieces of rows of about 256 KB that are filtered and deflated in parallel (parallelFor, pigz-style):
+// every piece is a fixed Huffman block ended by a sync flush (an empty stored block), so that pieces are byte-aligned
+// and just concatenated, and matches of a piece reach back up to the 32 KB window into the previous piece
+// or the previous band. Pieces are cut by bytes, not by threads, so the file is the same for any number of threads.
+class PngStreamWriter final {
+  public:
+    //   Fixed  - adaptive row filters + fixed Huffman deflate (see above)
+    //   Stored - no filters, no compression (stored deflate blocks): the fastest, the file is about as large as the pixels
+    enum class Compression { Fixed, Stored };
+
+    PngStreamWriter(const std::string &path, int width, int height, int channels,
+                    Compression compression = Compression::Fixed);
+    // The same, but bytes go to sink (by chunks, as soon as they are complete)
+    PngStreamWriter(ImageSink sink, int width, int height, int channels, Compression compression = Compression::Fixed);
+    // Closes the file, finish() should be called before (otherwise the file is incomplete)
+    ~PngStreamWriter();
+
+    PngStreamWriter(const PngStreamWriter &) = delete;
+    PngStreamWriter &operator=(const PngStreamWriter &) = delete;
+
+    // The next rows of the image, same width and channels
+    void writeRows(image8u_cview rows);
+
+    // Writes the end of the stream, all height rows should be written by then
+    void finish();
+
+    int rowsWritten() const noexcept { return rowsWritten_; }
+
+  private:
+    void start();
+    void storeBand();
+    void flushBytes(bool all);
+    void writeChunk(const char *type, const std::uint8_t *data, std::size_t size);
+
+    std::FILE *file_ = nullptr; // only if constructed with a path
+    std::string path_;
+    ImageSink sink_;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 0;
+    Compression compression_ = Compression::Fixed;
+    int rowsWritten_ = 0;
+    bool finished_ = false;
+
+    std::vector<std::uint8_t> prevRow_; // unfiltered previous row (zeros before the first one)
+    std::vector<std::uint8_t> history_; // the last (up to 32 KB) filtered bytes of the previous bands
+    std::vector<std::uint8_t> band_;    // history_ and filtered rows of the current band, each with its filter type byte
+    std::vector<std::vector<std::uint8_t>> pieces_; // deflated pieces of the band
+    std::vector<std::uint32_t> pieceAdlers_;
+
+    std::uint32_t adler_ = 1;
+    std::vector<std::uint8_t> pending_; // deflated bytes of the next IDAT chunk
+};
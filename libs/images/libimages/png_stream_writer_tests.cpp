@@ -0,0 +1,151 @@
+#include "png_stream_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/cpu_budget.h>
+#include <libbase/fast_random.h>
+#include <libbase/runtime_assert.h>
+#include <libimages/debug_io.h>
+#include <libimages/image_io.h>
+#include <libimages/tests_utils.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Noise over smooth gradients, so that all filters and both literals and matches are used
+image8u testImage(int w, int h, int c, int seed) {
+    FastRandom r(seed);
+    image8u img(w, h, c);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const bool noisy = (x / 16 + y / 8) % 3 == 0;
+            for (int ch = 0; ch < c; ++ch) {
+                img.at(y, x, ch) = static_cast<std::uint8_t>(noisy ? r.nextInt(0, 255) : (x * (ch + 1) + y * 3) & 0xFF);
+            }
+        }
+    }
+    return img;
+}
+
+void writeInBands(const image8u &img, const std::string &path, const std::vector<int> &bands,
+                  PngStreamWriter::Compression compression = PngStreamWriter::Compression::Fixed) {
+    debug_io::ensure_dir_exists_for_file(path);
+    PngStreamWriter writer(path, img.width(), img.height(), img.channels(), compression);
+    int y = 0;
+    for (int rows : bands) {
+        writer.writeRows(image8u_cview(img).subview(0, y, img.width(), rows));
+        y += rows;
+    }
+    EXPECT_EQ(writer.rowsWritten(), img.height());
+    writer.finish();
+}
+
+} // namespace
+
+TEST(png_stream_writer, bandsDecodeToTheSameImage) {
+    configureWorkingDirectory();
+
+    const image8u img = testImage(123, 77, 3, 7);
+    const std::string path = getUnitCaseDebugDir() + "bands.png";
+    writeInBands(img, path, {1, 10, 33, 33});
+
+    const image8u loaded = load_image(path);
+    ASSERT_EQ(loaded.width(), img.width());
+    ASSERT_EQ(loaded.height(), img.height());
+    ASSERT_EQ(loaded.channels(), 3);
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x) {
+            for (int c = 0; c < 3; ++c) ASSERT_EQ(loaded.at(y, x, c), img.at(y, x, c));
+        }
+    }
+}
+
+TEST(png_stream_writer, storedBlocks) {
+    configureWorkingDirectory();
+
+    // the second band is larger than a stored block
+    const image8u img = testImage(300, 90, 3, 11);
+    const std::string path = getUnitCaseDebugDir() + "stored.png";
+    writeInBands(img, path, {7, 83}, PngStreamWriter::Compression::Stored);
+
+    const image8u loaded = load_image(path);
+    ASSERT_EQ(loaded.size(), img.size());
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x) {
+            for (int c = 0; c < 3; ++c) ASSERT_EQ(loaded.at(y, x, c), img.at(y, x, c));
+        }
+    }
+}
+
+TEST(png_stream_writer, grayAndAlpha) {
+    configureWorkingDirectory();
+
+    for (int channels : {1, 4}) {
+        const image8u img = testImage(200, 40, channels, channels);
+        const std::string path = getUnitCaseDebugDir() + "channels" + std::to_string(channels) + ".png";
+        writeInBands(img, path, {40});
+
+        // gray is loaded as RGB
+        const image8u loaded = load_image(path);
+        ASSERT_EQ(loaded.channels(), channels == 1 ? 3 : 4);
+        for (int y = 0; y < img.height(); ++y) {
+            for (int x = 0; x < img.width(); ++x) {
+                for (int c = 0; c < loaded.channels(); ++c) ASSERT_EQ(loaded.at(y, x, c), img.at(y, x, channels == 1 ? 0 : c));
+            }
+        }
+    }
+}
+
+TEST(png_stream_writer, rowsMustMatchTheHeader) {
+    configureWorkingDirectory();
+
+    const std::string path = getUnitCaseDebugDir() + "incomplete.png";
+    debug_io::ensure_dir_exists_for_file(path);
+    PngStreamWriter writer(path, 8, 4, 3);
+    EXPECT_THROW(writer.writeRows(image8u(7, 2, 3)), assertion_error);
+    writer.writeRows(image8u(8, 2, 3));
+    EXPECT_THROW(writer.writeRows(image8u(8, 3, 3)), assertion_error);
+    EXPECT_THROW(writer.finish(), assertion_error);
+}
+
+TEST(png_stream_writer, piecesDoNotDependOnThreads) {
+    configureWorkingDirectory();
+
+    // several pieces per band and bands not aligned to pieces
+    const image8u img = testImage(700, 500, 3, 13);
+    auto encode = [&] {
+        std::vector<std::uint8_t> bytes;
+        PngStreamWriter writer(memory_sink(bytes), img.width(), img.height(), img.channels());
+        for (int y = 0; y < img.height(); y += 230) {
+            writer.writeRows(image8u_cview(img).subview(0, y, img.width(), std::min(230, img.height() - y)));
+        }
+        writer.finish();
+        return bytes;
+    };
+    const std::vector<std::uint8_t> parallel = encode();
+    std::vector<std::uint8_t> serial;
+    {
+        ThreadBudgetScope single(1);
+        serial = encode();
+    }
+    EXPECT_EQ(parallel, serial);
+
+    const std::string path = getUnitCaseDebugDir() + "pieces.png";
+    debug_io::ensure_dir_exists_for_file(path);
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(std::fwrite(parallel.data(), 1, parallel.size(), file), parallel.size());
+    std::fclose(file);
+
+    const image8u loaded = load_image(path);
+    ASSERT_EQ(loaded.size(), img.size());
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x) {
+            for (int c = 0; c < 3; ++c) ASSERT_EQ(loaded.at(y, x, c), img.at(y, x, c));
+        }
+    }
+}
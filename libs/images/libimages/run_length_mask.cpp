@@ -0,0 +1,116 @@
+#include "run_length_mask.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <string>
+
+RunLengthMask::RunLengthMask(int width, int height) {
+    rassert(width > 0 && height > 0, "Invalid mask size", width, height);
+    w_ = width;
+    h_ = height;
+}
+
+RunLengthMask RunLengthMask::fromImage(const image8u &mask) {
+    rassert(mask.channels() == 1, 57381902901, mask.channels());
+
+    RunLengthMask res(mask.width(), mask.height());
+    for (int j = 0; j < res.h_; ++j) {
+        const std::uint8_t *src = mask.ptr(j);
+        int i = 0;
+        while (i < res.w_) {
+            rassert(src[i] == 0 || src[i] == 255, 57381902902, "mask must be 0/255", int(src[i]));
+            if (!src[i]) {
+                ++i;
+                continue;
+            }
+            const int x0 = i;
+            while (i < res.w_ && src[i] == 255) ++i;
+            res.runs_.push_back({j, x0, i});
+        }
+    }
+    return res;
+}
+
+RunLengthMask RunLengthMask::fromBitMask(const BitMask &mask) {
+    RunLengthMask res(mask.width(), mask.height());
+    for (int j = 0; j < res.h_; ++j) {
+        int i = 0;
+        while (i < res.w_) {
+            if (!mask.test(j, i)) {
+                ++i;
+                continue;
+            }
+            const int x0 = i;
+            while (i < res.w_ && mask.test(j, i)) ++i;
+            res.runs_.push_back({j, x0, i});
+        }
+    }
+    return res;
+}
+
+image8u RunLengthMask::toImage() const {
+    image8u res(w_, h_, 1, ImageInit::Zero);
+    for (const Run &run : runs_) {
+        std::fill(res.ptr(run.y) + run.x0, res.ptr(run.y) + run.x1, std::uint8_t(255));
+    }
+    return res;
+}
+
+BitMask RunLengthMask::toBitMask() const {
+    BitMask res(w_, h_);
+    for (const Run &run : runs_) {
+        for (int i = run.x0; i < run.x1; ++i) res.row(run.y)[i / BitMask::bits_per_word] |= BitMask::word_type(1) << (i % BitMask::bits_per_word);
+    }
+    return res;
+}
+
+void RunLengthMask::appendRun(int j, int x0, int x1) {
+    rassert(j >= 0 && j < h_, 57381902903, j, h_);
+    rassert(x0 >= 0 && x0 < x1 && x1 <= w_, 57381902904, x0, x1, w_);
+    if (!runs_.empty()) {
+        Run &last = runs_.back();
+        rassert(j > last.y || (j == last.y && x0 >= last.x1), 57381902905, "runs must be appended in order", j, x0, last.y, last.x1);
+        if (j == last.y && x0 == last.x1) {
+            last.x1 = x1;
+            return;
+        }
+    }
+    runs_.push_back({j, x0, x1});
+}
+
+std::span<const RunLengthMask::Run> RunLengthMask::rowRuns(int j) const {
+    rassert(j >= 0 && j < h_, 57381902906, j, h_);
+    auto from = std::lower_bound(runs_.begin(), runs_.end(), j, [](const Run &r, int y) { return r.y < y; });
+    auto to = std::upper_bound(from, runs_.end(), j, [](int y, const Run &r) { return y < r.y; });
+    return {from, to};
+}
+
+bool RunLengthMask::get(int j, int i) const {
+    rassert(i >= 0 && i < w_ && j >= 0 && j < h_, 57381902907,
+            "Pixel out of bounds:", "j=" + std::to_string(j) + "/height=" + std::to_string(h_),
+            "i=" + std::to_string(i) + "/width=" + std::to_string(w_));
+    // last run of the row that starts at or before i
+    const std::span<const Run> row = rowRuns(j);
+    auto it = std::upper_bound(row.begin(), row.end(), i, [](int x, const Run &r) { return x < r.x0; });
+    return it != row.begin() && i < (it - 1)->x1;
+}
+
+std::int64_t RunLengthMask::area() const noexcept {
+    std::int64_t res = 0;
+    for (const Run &run : runs_) res += run.x1 - run.x0;
+    return res;
+}
+
+bbox2i RunLengthMask::bbox() const noexcept {
+    bbox2i res;
+    for (const Run &run : runs_) {
+        res.include_pixel(run.x0, run.y);
+        res.include_pixel(run.x1 - 1, run.y);
+    }
+    return res;
+}
+
+bool RunLengthMask::operator==(const RunLengthMask &other) const noexcept {
+    return w_ == other.w_ && h_ == other.h_ && runs_ == other.runs_;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <libbase/bbox2.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+
+// Binary mask stored as horizontal runs of object pixels, sorted by (row, start), runs of a row never touch.
+// Piece masks are mostly a few long runs per row, so storage is O(runs) instead of O(width * height),
+// as are area() and bbox(). Pixel lookup is a binary search over runs.
+class RunLengthMask final {
+  public:
+    struct Run {
+        int y = 0;
+        int x0 = 0; // first pixel
+        int x1 = 0; // past the last pixel
+
+        bool operator==(const Run &other) const noexcept = default;
+    };
+
+    RunLengthMask() = default;
+    // No object pixels
+    RunLengthMask(int width, int height);
+
+    // Pixels of the mask must be 0 or 255
+    static RunLengthMask fromImage(const image8u &mask);
+    static RunLengthMask fromBitMask(const BitMask &mask);
+    image8u toImage() const;
+    BitMask toBitMask() const;
+
+    int width() const noexcept { return w_; }
+    int height() const noexcept { return h_; }
+    std::tuple<int, int> size() const noexcept { return {w_, h_}; }
+
+    // Appends object pixels [x0, x1) of row j, runs must be appended in (row, start) order;
+    // a run starting right where the previous one ends is merged into it
+    void appendRun(int j, int x0, int x1);
+
+    bool get(int j, int i) const;
+
+    std::span<const Run> runs() const noexcept { return runs_; }
+    std::span<const Run> rowRuns(int j) const;
+
+    std::int64_t area() const noexcept;
+    bbox2i bbox() const noexcept;
+    std::size_t memoryBytes() const noexcept { return runs_.capacity() * sizeof(Run); }
+
+    bool operator==(const RunLengthMask &other) const noexcept;
+    bool operator!=(const RunLengthMask &other) const noexcept { return !(*this == other); }
+
+  private:
+    int w_ = 0;
+    int h_ = 0;
+    std::vector<Run> runs_;
+};
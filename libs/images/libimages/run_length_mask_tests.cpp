@@ -0,0 +1,84 @@
+#include "run_length_mask.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/fast_random.h>
+#include <libimages/debug_io.h>
+#include <libimages/tests_utils.h>
+
+TEST(run_length_mask, roundTripThroughImageAndBitMask) {
+    configureWorkingDirectory();
+
+    const int w = 131;
+    const int h = 9;
+    image8u img(w, h, 1);
+    FastRandom r(239);
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            img(j, i) = r.nextInt(0, 3) ? 255 : 0;
+        }
+    }
+    img(0, 0) = 255;
+    img(h - 1, w - 1) = 255;
+
+    const RunLengthMask mask = RunLengthMask::fromImage(img);
+    EXPECT_EQ(mask.width(), w);
+    EXPECT_EQ(mask.height(), h);
+    EXPECT_EQ(mask.toImage().toVector(), img.toVector());
+    EXPECT_EQ(RunLengthMask::fromBitMask(BitMask::fromImage(img)), mask);
+    EXPECT_EQ(mask.toBitMask(), BitMask::fromImage(img));
+
+    std::int64_t ones = 0;
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            EXPECT_EQ(mask.get(j, i), img(j, i) == 255);
+            ones += img(j, i) == 255;
+        }
+        for (const RunLengthMask::Run &run : mask.rowRuns(j)) EXPECT_EQ(run.y, j);
+    }
+    EXPECT_EQ(mask.area(), ones);
+    EXPECT_EQ(mask.bbox().min, point2i(0, 0));
+    EXPECT_EQ(mask.bbox().max, point2i(w, h));
+
+    debug_io::dump_image(getUnitCaseDebugDir() + "mask.png", mask);
+}
+
+TEST(run_length_mask, appendRunMergesTouchingRuns) {
+    RunLengthMask mask(20, 5);
+    EXPECT_TRUE(mask.bbox().is_empty());
+    EXPECT_EQ(mask.area(), 0);
+
+    mask.appendRun(1, 3, 6);
+    mask.appendRun(1, 6, 9);
+    mask.appendRun(1, 11, 12);
+    mask.appendRun(3, 0, 2);
+    ASSERT_EQ(mask.runs().size(), 3u);
+    EXPECT_EQ(mask.rowRuns(1).size(), 2u);
+    EXPECT_EQ(mask.rowRuns(2).size(), 0u);
+    EXPECT_EQ(mask.area(), 6 + 1 + 2);
+    EXPECT_EQ(mask.bbox().min, point2i(0, 1));
+    EXPECT_EQ(mask.bbox().max, point2i(12, 4));
+    EXPECT_TRUE(mask.get(1, 8));
+    EXPECT_FALSE(mask.get(1, 9));
+    EXPECT_FALSE(mask.get(0, 3));
+
+    EXPECT_THROW(mask.appendRun(2, 0, 1), std::exception); // out of order
+    EXPECT_THROW(mask.appendRun(4, 5, 5), std::exception); // empty run
+}
+
+TEST(run_length_mask, pieceLikeMaskIsCompact) {
+    // filled disc, one run per row
+    const int size = 500;
+    image8u img(size, size, 1);
+    for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+            const int dx = i - size / 2;
+            const int dy = j - size / 2;
+            img(j, i) = (dx * dx + dy * dy < 200 * 200) ? 255 : 0;
+        }
+    }
+    const RunLengthMask mask = RunLengthMask::fromImage(img);
+    EXPECT_EQ(mask.runs().size(), 399u);
+    EXPECT_LT(mask.memoryBytes() * 20, static_cast<std::size_t>(size) * size);
+}
@@ -12,5 +12,5 @@ std::string getUnitCaseDebugDir() {
 
     const char* suite = info->test_suite_name();
     const char* name  = info->name();
-    return "debug/unit-tests/" + std::string(suite) + "/" + std::string(name) + "/";
+    return UNIT_TESTS_DEBUG_DIR + std::string(suite) + "/" + std::string(name) + "/";
 }
\ No newline at end of file
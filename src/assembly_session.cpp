@@ -0,0 +1,41 @@
+#include "assembly_session.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <iterator>
+#include <utility>
+
+AssemblySession::AssemblySession(int channels, const SideMatcherOptions &options)
+    : channels_(channels), options_(options) {
+    rassert(channels == 1 || channels == 3, 90200001, channels);
+    // see SideMatcher::matchAdded, checked here so that a session can not fail only on its first batch
+    rassert(options.canonicalLength == 0 && options.coarseCandidates == 0 && options.nearestCandidates == 0 && !options.earlyAbandon,
+            90200002, "Incremental matching needs the full enumeration of pairs");
+}
+
+void AssemblySession::addPieces(std::vector<std::vector<SideDescriptor>> sides, std::vector<image8u> images, std::vector<image8u> masks,
+                                std::vector<std::vector<point2i>> corners, bool with_openmp, SideMatcherStats *stats) {
+    const std::size_t count = sides.size();
+    rassert(images.size() == count && masks.size() == count && corners.size() == count, 90200003,
+            sides.size(), images.size(), masks.size(), corners.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        rassert(images[i].channels() == channels_, 90200004, images[i].channels(), channels_);
+        rassert(corners[i].size() == sides[i].size(), 90200005, corners[i].size(), sides[i].size());
+    }
+
+    std::move(sides.begin(), sides.end(), std::back_inserter(objSides_));
+    std::move(images.begin(), images.end(), std::back_inserter(objImages_));
+    std::move(masks.begin(), masks.end(), std::back_inserter(objMasks_));
+    std::move(corners.begin(), corners.end(), std::back_inserter(objCorners_));
+
+    SideMatcher(objSides_, channels_, options_).matchAdded(costs_, with_openmp, stats);
+    matchedSides_ = costs_.matchedSides();
+}
+
+PuzzleAssemblyResult AssemblySession::assemble(AssemblyMethod method, unsigned outputs) const {
+    return assemblePuzzle(objImages_, objMasks_, objCorners_, matchedSides_, method, outputs);
+}
+
+image8u AssemblySession::render(const PuzzleAssemblyResult &assembly, bool withLines) {
+    return tiles_.render(assembly, objImages_, objMasks_, objCorners_, withLines);
+}
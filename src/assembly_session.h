@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include <libbase/point2.h>
+#include <libimages/image.h>
+
+#include "puzzle_assembly.h"
+#include "side_costs.h"
+#include "side_matcher.h"
+#include "sides_comparison_utils.h"
+
+// A puzzle photographed in batches: keeps the side descriptors, the cost matrix and the matches of all pieces added
+// so far, so that a new batch costs only the comparisons of its sides with all sides (O(new x all) instead of all
+// O((4N)^2) pairs again). Matches are the same as SideMatcher::match of all pieces at once.
+class AssemblySession final {
+public:
+    // Options are used as by SideMatcher::matchAdded
+    explicit AssemblySession(int channels, const SideMatcherOptions &options = {});
+
+    // The next batch of pieces (numbered after the existing ones), the same data as for SideMatcher and assemblePuzzle
+    void addPieces(std::vector<std::vector<SideDescriptor>> sides, std::vector<image8u> images, std::vector<image8u> masks,
+                   std::vector<std::vector<point2i>> corners, bool with_openmp = true, SideMatcherStats *stats = nullptr);
+
+    int objects() const noexcept { return static_cast<int>(objSides_.size()); }
+    const SideCosts &costs() const noexcept { return costs_; }
+    // Of all pieces, updated by addPieces
+    const std::vector<std::vector<MatchedSide>> &matchedSides() const noexcept { return matchedSides_; }
+
+    // Placement of all pieces added so far (it is linear in pieces, so it is simply redone over the updated matches)
+    PuzzleAssemblyResult assemble(AssemblyMethod method = AssemblyMethod::CornerBFS, unsigned outputs = AssemblyOutputAll) const;
+    // The canvas of an assembly of these pieces (f.e. of assemble with AssemblyOutputGridOnly): pieces are never changed
+    // by addPieces, so the warped tiles of the previous render are blitted and only moved or new placements are warped
+    image8u render(const PuzzleAssemblyResult &assembly, bool withLines);
+    const WarpedTileCache &tiles() const noexcept { return tiles_; }
+
+private:
+    int channels_;
+    SideMatcherOptions options_;
+
+    std::vector<std::vector<SideDescriptor>> objSides_;
+    std::vector<image8u> objImages_;
+    std::vector<image8u> objMasks_;
+    std::vector<std::vector<point2i>> objCorners_;
+
+    SideCosts costs_;
+    std::vector<std::vector<MatchedSide>> matchedSides_;
+
+    WarpedTileCache tiles_;
+};
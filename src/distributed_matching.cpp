@@ -0,0 +1,384 @@
+#include "distributed_matching.h"
+
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+namespace {
+
+constexpr char kShardMagic[8] = {'C', 'V', 'P', 'S', 'H', 'A', 'R', 'D'};
+constexpr char kResultMagic[8] = {'C', 'V', 'P', 'M', 'A', 'T', 'C', 'H'};
+constexpr std::uint32_t kFormatVersion = 3;
+
+template <typename T>
+void put(std::ostream &out, const T &v) {
+    out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+T get(std::istream &in) {
+    T v{};
+    in.read(reinterpret_cast<char *>(&v), sizeof(T));
+    rassert(in.good(), 34712839743001, "Truncated matching shard or result");
+    return v;
+}
+
+void putHeader(std::ostream &out, const char (&magic)[8]) {
+    out.write(magic, sizeof(magic));
+    put(out, kFormatVersion);
+}
+
+void checkHeader(std::istream &in, const char (&magic)[8]) {
+    char fileMagic[8];
+    in.read(fileMagic, sizeof(fileMagic));
+    rassert(in.good() && std::memcmp(fileMagic, magic, sizeof(magic)) == 0, 34712839743002);
+    const std::uint32_t version = get<std::uint32_t>(in);
+    rassert(version == kFormatVersion, 34712839743003, version);
+}
+
+void putBlock(std::ostream &out, const MatchingBlock &block) {
+    put<std::int32_t>(out, block.fromObjA);
+    put<std::int32_t>(out, block.toObjA);
+    put<std::int32_t>(out, block.fromObjB);
+    put<std::int32_t>(out, block.toObjB);
+}
+
+MatchingBlock getBlock(std::istream &in) {
+    MatchingBlock block;
+    block.fromObjA = get<std::int32_t>(in);
+    block.toObjA = get<std::int32_t>(in);
+    block.fromObjB = get<std::int32_t>(in);
+    block.toObjB = get<std::int32_t>(in);
+    rassert(0 <= block.fromObjA && block.fromObjA <= block.toObjA && 0 <= block.fromObjB && block.fromObjB <= block.toObjB,
+            34712839743004, block.fromObjA, block.toObjA, block.fromObjB, block.toObjB);
+    return block;
+}
+
+bool sameBlock(const MatchingBlock &a, const MatchingBlock &b) {
+    return a.fromObjA == b.fromObjA && a.toObjA == b.toObjA && a.fromObjB == b.fromObjB && a.toObjB == b.toObjB;
+}
+
+bool isDiagonal(const MatchingBlock &block) {
+    return block.fromObjA == block.fromObjB && block.toObjA == block.toObjB;
+}
+
+// A block of planMatchingBlocks: on the diagonal or with pieces A before pieces B
+bool isPlanned(const MatchingBlock &block) {
+    return isDiagonal(block) || block.toObjA <= block.fromObjB;
+}
+
+} // namespace
+
+std::vector<MatchingBlock> planMatchingBlocks(int objects, int objectsPerBlock) {
+    rassert(objects >= 0 && objectsPerBlock > 0, 34712839743005, objects, objectsPerBlock);
+    std::vector<MatchingBlock> blocks;
+    for (int a = 0; a < objects; a += objectsPerBlock) {
+        for (int b = a; b < objects; b += objectsPerBlock) {
+            blocks.push_back({a, std::min(objects, a + objectsPerBlock), b, std::min(objects, b + objectsPerBlock)});
+        }
+    }
+    return blocks;
+}
+
+MatchingShard makeMatchingShard(const std::vector<std::vector<SideDescriptor>> &objSides, int channels,
+                                const SideMatcherOptions &options, const MatchingBlock &block) {
+    const int objects = static_cast<int>(objSides.size());
+    rassert(block.toObjA <= objects && block.toObjB <= objects, 34712839743006, block.toObjA, block.toObjB, objects);
+    MatchingShard shard;
+    shard.block = block;
+    shard.channels = channels;
+    shard.options = options;
+    for (int obj = 0; obj < objects; ++obj) {
+        const bool needed = (obj >= block.fromObjA && obj < block.toObjA) || (obj >= block.fromObjB && obj < block.toObjB);
+        if (!needed) continue;
+        shard.objects.push_back(obj);
+        shard.objSides.push_back(objSides[obj]);
+    }
+    return shard;
+}
+
+MatchingBlockResult matchShard(const MatchingShard &shard, bool with_openmp) {
+    const SideMatcherOptions &options = shard.options;
+    const MatchingBlock &block = shard.block;
+    rassert(options.canonicalLength == 0 && options.coarseCandidates == 0 && options.nearestCandidates == 0
+            && !options.earlyAbandon && !options.cost, 34712839743007, "Distributed matching needs the full enumeration of pairs");
+    rassert(isPlanned(block), 34712839743022, block.fromObjA, block.toObjA, block.fromObjB, block.toObjB);
+    const SideMatcher matcher(shard.objSides, shard.channels, options);
+    auto local = [&](int obj) {
+        auto it = std::lower_bound(shard.objects.begin(), shard.objects.end(), obj);
+        rassert(it != shard.objects.end() && *it == obj, 34712839743008, obj);
+        return static_cast<int>(it - shard.objects.begin());
+    };
+
+    // sides of both ranges in the serial order
+    auto rangeSides = [&](int from, int to) {
+        std::vector<std::pair<int, int>> sides;
+        for (int obj = from; obj < to; ++obj) {
+            for (int side = 0; side < static_cast<int>(shard.objSides[local(obj)].size()); ++side) sides.emplace_back(obj, side);
+        }
+        return sides;
+    };
+    const std::vector<std::pair<int, int>> sidesA = rangeSides(block.fromObjA, block.toObjA);
+    const std::vector<std::pair<int, int>> sidesB = rangeSides(block.fromObjB, block.toObjB);
+    auto descriptor = [&](const std::pair<int, int> &side) -> const SideDescriptor & {
+        return shard.objSides[local(side.first)][side.second];
+    };
+    const bool diagonal = isDiagonal(block);
+
+    // D(A, B) of every unordered pair (on the diagonal - with the piece of A before the piece of B), paired - whether it is a pair
+    const int na = static_cast<int>(sidesA.size()), nb = static_cast<int>(sidesB.size());
+    std::vector<float> differences(static_cast<std::size_t>(na) * nb, 0.0f);
+    std::vector<char> paired(static_cast<std::size_t>(na) * nb, 0);
+    int compared = 0;
+    #pragma omp parallel for schedule(dynamic, 4) reduction(+:compared) if(with_openmp)
+    for (int i = 0; i < na; ++i) {
+        const SideDescriptor &a = descriptor(sidesA[i]);
+        if (a.mostlyWhite) continue;
+        for (int j = 0; j < nb; ++j) {
+            if (sidesB[j].first <= sidesA[i].first) continue; // off the diagonal pieces B are all after pieces A
+            const SideDescriptor &b = descriptor(sidesB[j]);
+            if (b.mostlyWhite || !matcher.canMate(a, b)) continue;
+            differences[i * nb + j] = SideMatcher::compare(a, b, shard.channels, false, nullptr, options.alignmentShift).difference;
+            paired[i * nb + j] = 1;
+            ++compared;
+        }
+    }
+
+    // every side is reduced over the sides of the other range in the serial order, as SideMatcher::match does
+    MatchingBlockResult result;
+    result.block = block;
+    result.comparedPairs = compared;
+    for (const std::pair<int, int> &side: sidesA) result.sides.push_back({side.first, side.second, MatchedSide()});
+    if (!diagonal) {
+        for (const std::pair<int, int> &side: sidesB) result.sides.push_back({side.first, side.second, MatchedSide()});
+    }
+    const int count = static_cast<int>(result.sides.size());
+    #pragma omp parallel for schedule(dynamic, 16) if(with_openmp)
+    for (int k = 0; k < count; ++k) {
+        MatchedSide &matched = result.sides[k].matched;
+        if (k < na) {
+            for (int j = 0; j < nb; ++j) {
+                // on the diagonal the pair with the piece of B before the piece of A is the mirrored one
+                const bool mirrored = sidesB[j].first < sidesA[k].first;
+                const std::size_t at = mirrored ? static_cast<std::size_t>(j) * nb + k : static_cast<std::size_t>(k) * nb + j;
+                if (paired[at]) matched.consider(sidesB[j].first, sidesB[j].second, differences[at]);
+            }
+        } else {
+            const int j = k - na;
+            for (int i = 0; i < na; ++i) {
+                if (paired[i * nb + j]) matched.consider(sidesA[i].first, sidesA[i].second, differences[i * nb + j]);
+            }
+        }
+    }
+    return result;
+}
+
+void saveMatchingShard(std::ostream &out, const MatchingShard &shard) {
+    putHeader(out, kShardMagic);
+    putBlock(out, shard.block);
+    put<std::int32_t>(out, shard.channels);
+    put<std::uint8_t>(out, shard.options.geometricPrefilter);
+    put(out, shard.options.maxLengthRatio);
+    put(out, shard.options.flatBulge);
+    put<std::int32_t>(out, shard.options.alignmentShift);
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(shard.objects.size()));
+    for (std::size_t i = 0; i < shard.objects.size(); ++i) {
+        put<std::int32_t>(out, shard.objects[i]);
+        put<std::uint32_t>(out, static_cast<std::uint32_t>(shard.objSides[i].size()));
+        for (const SideDescriptor &d: shard.objSides[i]) {
+            put<std::int32_t>(out, d.samples);
+            put<std::int32_t>(out, d.channels);
+            put(out, d.profileBlurStrength);
+            put<std::uint8_t>(out, d.mostlyWhite);
+            put(out, d.signature.arcLength);
+            put(out, d.signature.chordLength);
+            put(out, d.signature.bulge);
+            const std::size_t plane = static_cast<std::size_t>(d.samples) * d.channels;
+            rassert(d.packed.size() == (d.mostlyWhite ? plane : 3 * plane), 34712839743009, d.packed.size(), plane);
+            out.write(reinterpret_cast<const char *>(d.packed.data()), static_cast<std::streamsize>(d.packed.size()));
+        }
+    }
+    rassert(out.good(), 34712839743010);
+}
+
+MatchingShard loadMatchingShard(std::istream &in) {
+    checkHeader(in, kShardMagic);
+    MatchingShard shard;
+    shard.block = getBlock(in);
+    shard.channels = get<std::int32_t>(in);
+    shard.options.geometricPrefilter = get<std::uint8_t>(in) != 0;
+    shard.options.maxLengthRatio = get<float>(in);
+    shard.options.flatBulge = get<float>(in);
+    shard.options.alignmentShift = get<std::int32_t>(in);
+    rassert(shard.options.alignmentShift >= 0, 34712839743021, shard.options.alignmentShift);
+    const std::uint32_t objects = get<std::uint32_t>(in);
+    for (std::uint32_t i = 0; i < objects; ++i) {
+        const int obj = get<std::int32_t>(in);
+        rassert(obj >= 0 && (shard.objects.empty() || obj > shard.objects.back()), 34712839743011, obj);
+        shard.objects.push_back(obj);
+        std::vector<SideDescriptor> &sides = shard.objSides.emplace_back(get<std::uint32_t>(in));
+        for (SideDescriptor &d: sides) {
+            d.samples = get<std::int32_t>(in);
+            d.channels = get<std::int32_t>(in);
+            d.profileBlurStrength = get<float>(in);
+            d.mostlyWhite = get<std::uint8_t>(in) != 0;
+            d.signature.arcLength = get<float>(in);
+            d.signature.chordLength = get<float>(in);
+            d.signature.bulge = get<float>(in);
+            rassert(d.samples >= 0 && d.channels == shard.channels, 34712839743012, d.samples, d.channels, shard.channels);
+            const std::size_t plane = static_cast<std::size_t>(d.samples) * d.channels;
+            d.packed.resize(d.mostlyWhite ? plane : 3 * plane);
+            in.read(reinterpret_cast<char *>(d.packed.data()), static_cast<std::streamsize>(d.packed.size()));
+            rassert(in.good(), 34712839743013);
+        }
+    }
+    return shard;
+}
+
+void saveMatchingBlockResult(std::ostream &out, const MatchingBlockResult &result) {
+    putHeader(out, kResultMagic);
+    putBlock(out, result.block);
+    put<std::int32_t>(out, result.comparedPairs);
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(result.sides.size()));
+    for (const MatchingBlockResult::Side &entry: result.sides) {
+        put<std::int32_t>(out, entry.objA);
+        put<std::int32_t>(out, entry.sideA);
+        put<std::int32_t>(out, entry.matched.objB);
+        put<std::int32_t>(out, entry.matched.sideB);
+        put(out, entry.matched.differenceBest);
+        put(out, entry.matched.differenceSecondBest);
+        put<std::int32_t>(out, entry.matched.candidates.size);
+        for (const SideCandidate &c: entry.matched.candidates) {
+            put<std::int32_t>(out, c.objB);
+            put<std::int32_t>(out, c.sideB);
+            put(out, c.cost);
+        }
+    }
+    rassert(out.good(), 34712839743014);
+}
+
+MatchingBlockResult loadMatchingBlockResult(std::istream &in) {
+    checkHeader(in, kResultMagic);
+    MatchingBlockResult result;
+    result.block = getBlock(in);
+    result.comparedPairs = get<std::int32_t>(in);
+    result.sides.resize(get<std::uint32_t>(in));
+    for (MatchingBlockResult::Side &entry: result.sides) {
+        entry.objA = get<std::int32_t>(in);
+        entry.sideA = get<std::int32_t>(in);
+        entry.matched.objB = get<std::int32_t>(in);
+        entry.matched.sideB = get<std::int32_t>(in);
+        entry.matched.differenceBest = get<float>(in);
+        entry.matched.differenceSecondBest = get<float>(in);
+        const int candidates = get<std::int32_t>(in);
+        rassert(candidates >= 0 && candidates <= SideCandidates::capacity, 34712839743015, candidates);
+        entry.matched.candidates.size = candidates;
+        for (int i = 0; i < candidates; ++i) {
+            SideCandidate &c = entry.matched.candidates.items[i];
+            c.objB = get<std::int32_t>(in);
+            c.sideB = get<std::int32_t>(in);
+            c.cost = get<float>(in);
+        }
+    }
+    return result;
+}
+
+MatchedSide mergeMatchedSides(const MatchedSide &earlier, const MatchedSide &later) {
+    MatchedSide res = earlier;
+    // later candidates of equal cost go first, as if inserted after the earlier ones in the serial order
+    for (int i = later.candidates.size - 1; i >= 0; --i) res.candidates.insert(later.candidates.items[i]);
+
+    if (later.differenceBest == -1) return res;
+    if (earlier.differenceBest == -1 || later.differenceBest <= earlier.differenceBest) {
+        // the last best of later still wins, and the best seen before it includes all of earlier
+        res.objB = later.objB;
+        res.sideB = later.sideB;
+        res.differenceBest = later.differenceBest;
+        res.differenceSecondBest = earlier.differenceBest == -1 || later.differenceSecondBest == -1
+                                       ? std::max(earlier.differenceBest, later.differenceSecondBest)
+                                       : std::min(earlier.differenceBest, later.differenceSecondBest);
+    }
+    return res;
+}
+
+std::vector<std::vector<MatchedSide>> mergeMatchingResults(const std::vector<std::vector<SideDescriptor>> &objSides,
+                                                           std::vector<MatchingBlockResult> results) {
+    const int objects = static_cast<int>(objSides.size());
+    std::vector<std::vector<MatchedSide>> matched(static_cast<std::size_t>(objects));
+    for (int obj = 0; obj < objects; ++obj) matched[obj].resize(objSides[obj].size());
+
+    // a block off the diagonal is also its mirror: the sides of its pieces B over its pieces A
+    std::vector<MatchingBlockResult> directed;
+    directed.reserve(2 * results.size());
+    for (MatchingBlockResult &result: results) {
+        const MatchingBlock &block = result.block;
+        rassert(isPlanned(block), 34712839743023, block.fromObjA, block.toObjA, block.fromObjB, block.toObjB);
+        if (isDiagonal(block)) {
+            directed.push_back(std::move(result));
+            continue;
+        }
+        MatchingBlockResult forward, mirrored;
+        forward.block = block;
+        mirrored.block = {block.fromObjB, block.toObjB, block.fromObjA, block.toObjA};
+        for (MatchingBlockResult::Side &entry: result.sides) {
+            (entry.objA < block.toObjA ? forward : mirrored).sides.push_back(std::move(entry));
+        }
+        directed.push_back(std::move(forward));
+        directed.push_back(std::move(mirrored));
+    }
+    results = std::move(directed);
+
+    // blocks of each side A are folded in the order of pieces B, so the arrival order does not matter
+    std::sort(results.begin(), results.end(), [](const MatchingBlockResult &a, const MatchingBlockResult &b) {
+        return a.block.fromObjB != b.block.fromObjB ? a.block.fromObjB < b.block.fromObjB : a.block.fromObjA < b.block.fromObjA;
+    });
+    std::vector<int> coveredB(static_cast<std::size_t>(objects), 0);
+    for (const MatchingBlockResult &result: results) {
+        const MatchingBlock &block = result.block;
+        rassert(block.toObjA <= objects && block.toObjB <= objects, 34712839743016, block.toObjA, block.toObjB, objects);
+        for (int objA = block.fromObjA; objA < block.toObjA; ++objA) {
+            rassert(coveredB[objA] == block.fromObjB, 34712839743017, objA, coveredB[objA], block.fromObjB);
+            coveredB[objA] = block.toObjB;
+        }
+        for (const MatchingBlockResult::Side &entry: result.sides) {
+            rassert(entry.objA >= block.fromObjA && entry.objA < block.toObjA && entry.sideA >= 0
+                    && entry.sideA < static_cast<int>(matched[entry.objA].size()), 34712839743018, entry.objA, entry.sideA);
+            MatchedSide &side = matched[entry.objA][entry.sideA];
+            side = mergeMatchedSides(side, entry.matched);
+        }
+    }
+    for (int obj = 0; obj < objects; ++obj) rassert(coveredB[obj] == objects, 34712839743019, obj, coveredB[obj]);
+    return matched;
+}
+
+std::vector<std::vector<MatchedSide>> matchDistributed(const std::vector<std::vector<SideDescriptor>> &objSides, int channels,
+                                                       const SideMatcherOptions &options, int objectsPerBlock,
+                                                       const MatchingShardRunner &runner, bool with_openmp) {
+    const std::vector<MatchingBlock> blocks = planMatchingBlocks(static_cast<int>(objSides.size()), objectsPerBlock);
+    std::vector<MatchingBlockResult> results(blocks.size());
+
+    const int count = static_cast<int>(blocks.size());
+    #pragma omp parallel for schedule(dynamic, 1) if(with_openmp)
+    for (int i = 0; i < count; ++i) {
+        std::ostringstream shard;
+        saveMatchingShard(shard, makeMatchingShard(objSides, channels, options, blocks[i]));
+        std::string resultBytes;
+        if (runner) {
+            resultBytes = runner(shard.str());
+        } else {
+            std::istringstream in(shard.str());
+            std::ostringstream out;
+            saveMatchingBlockResult(out, matchShard(loadMatchingShard(in), false));
+            resultBytes = out.str();
+        }
+        std::istringstream in(resultBytes);
+        results[i] = loadMatchingBlockResult(in);
+        rassert(sameBlock(results[i].block, blocks[i]), 34712839743020, i);
+    }
+    return mergeMatchingResults(objSides, std::move(results));
+}
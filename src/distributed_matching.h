@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "puzzle_assembly.h"
+#include "side_matcher.h"
+#include "sides_comparison_utils.h"
+
+// Matching of very large puzzles on several worker processes or nodes. The coordinator splits the pair space into
+// blocks of pieces A x pieces B (only the upper triangle: D(A, B) = D(B, A), see SideMatcher::match), serializes the sides
+// each block needs into a shard, workers match their shards independently and send back the per-side results of their
+// block in both directions, the coordinator merges them and runs assembly.
+// The merged result is exactly SideMatcher::match of the full enumeration of pairs (without canonicalLength,
+// coarseCandidates, nearestCandidates, earlyAbandon and cost), whatever the blocks and the order their results arrive in.
+
+// Pairs of sides A of pieces [fromObjA, toObjA) with sides B of pieces [fromObjB, toObjB)
+struct MatchingBlock final {
+    int fromObjA = 0;
+    int toObjA = 0;
+    int fromObjB = 0;
+    int toObjB = 0;
+};
+
+// Blocks of at most objectsPerBlock x objectsPerBlock pieces covering all unordered pairs, A-major: the diagonal ones
+// (the same range of pieces A and B) and those with all pieces A before all pieces B
+std::vector<MatchingBlock> planMatchingBlocks(int objects, int objectsPerBlock);
+
+// Everything a worker needs for one block: the block, the matcher options and the sides of the pieces of both ranges
+struct MatchingShard final {
+    MatchingBlock block;
+    int channels = 0;
+    SideMatcherOptions options;               // only the geometric prefilter and alignmentShift are used
+    std::vector<int> objects;                 // global numbers of the pieces in objSides, increasing
+    std::vector<std::vector<SideDescriptor>> objSides;
+};
+
+MatchingShard makeMatchingShard(const std::vector<std::vector<SideDescriptor>> &objSides, int channels,
+                                const SideMatcherOptions &options, const MatchingBlock &block);
+
+// For every side A of the block (in the (objA, sideA) order, white ones too): its MatchedSide over the sides B of the block,
+// then (off the diagonal) for every side B: its MatchedSide over the sides A of the block
+struct MatchingBlockResult final {
+    struct Side final {
+        int objA = -1;
+        int sideA = -1;
+        MatchedSide matched;
+    };
+
+    MatchingBlock block;
+    std::vector<Side> sides;
+    int comparedPairs = 0; // unordered, each one stands for both orders
+};
+
+// Every unordered pair of the block is compared once, as SideMatcher::match does (the side of the smaller piece first)
+MatchingBlockResult matchShard(const MatchingShard &shard, bool with_openmp = true);
+
+// Binary formats (little-endian, as in memory): side profiles are written as they are packed, without per-item
+// sizes, so that a shard is little more than the bytes of its descriptors. Loading asserts on a malformed input.
+void saveMatchingShard(std::ostream &out, const MatchingShard &shard);
+MatchingShard loadMatchingShard(std::istream &in);
+void saveMatchingBlockResult(std::ostream &out, const MatchingBlockResult &result);
+MatchingBlockResult loadMatchingBlockResult(std::istream &in);
+
+// The same MatchedSide as considering all candidates of earlier and then all candidates of later in the serial order
+MatchedSide mergeMatchedSides(const MatchedSide &earlier, const MatchedSide &later);
+
+// Results of blocks covering all pairs (in any order) merged into the result of SideMatcher::match
+std::vector<std::vector<MatchedSide>> mergeMatchingResults(const std::vector<std::vector<SideDescriptor>> &objSides,
+                                                           std::vector<MatchingBlockResult> results);
+
+// Sends the serialized shard to a worker and returns its serialized result, f.e. through files and a remote process
+using MatchingShardRunner = std::function<std::string(const std::string &shard)>;
+
+// Whole coordinator side: plans blocks, runs them (concurrently if with_openmp, a runner must be thread-safe then)
+// and merges. Without a runner every shard is matched in this process, through the same serialization.
+std::vector<std::vector<MatchedSide>> matchDistributed(const std::vector<std::vector<SideDescriptor>> &objSides, int channels,
+                                                       const SideMatcherOptions &options, int objectsPerBlock,
+                                                       const MatchingShardRunner &runner = {}, bool with_openmp = true);
@@ -0,0 +1,311 @@
+#include "distributed_matching.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "puzzle_solver.h"
+#include "tests_utils.h"
+
+namespace {
+
+struct MatcherInput final {
+    PuzzleSideDescriptors descriptors;
+    int channels = 0;
+};
+
+MatcherInput matcherInput(int rows, int cols, std::uint32_t seed) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle(rows, cols, seed);
+    const PuzzleSolver solver;
+    const PuzzleSegmentation segmentation = solver.segment(puzzle.image);
+    const PuzzlePieces pieces = solver.extractPieces(puzzle.image, segmentation.mask, segmentation.roi);
+    return {solver.describeSides(pieces, puzzle.image), pieces.channels()};
+}
+
+template <typename T>
+void shuffle(std::vector<T> &items, FastRandom &r) {
+    for (int k = static_cast<int>(items.size()) - 1; k > 0; --k) std::swap(items[k], items[r.nextInt(0, k)]);
+}
+
+std::string saved(const MatchingShard &shard) {
+    std::ostringstream out;
+    saveMatchingShard(out, shard);
+    return out.str();
+}
+
+std::string saved(const MatchingBlockResult &result) {
+    std::ostringstream out;
+    saveMatchingBlockResult(out, result);
+    return out.str();
+}
+
+std::string shardLoadError(const std::string &bytes) {
+    return assertionCode([&] {
+        std::istringstream in(bytes);
+        loadMatchingShard(in);
+    });
+}
+
+std::string resultLoadError(const std::string &bytes) {
+    return assertionCode([&] {
+        std::istringstream in(bytes);
+        loadMatchingBlockResult(in);
+    });
+}
+
+void expectSameBlocks(const MatchingBlock &a, const MatchingBlock &b) {
+    EXPECT_EQ(a.fromObjA, b.fromObjA);
+    EXPECT_EQ(a.toObjA, b.toObjA);
+    EXPECT_EQ(a.fromObjB, b.fromObjB);
+    EXPECT_EQ(a.toObjB, b.toObjB);
+}
+
+// Pieces of two sides with differences of few distinct values, so that best ones and candidates tie within and across blocks
+struct TiedDifferences final {
+    int objects = 7;
+    std::vector<float> differences; // [objA * 2 + sideA][objB * 2 + sideB], symmetric, 0 - not a pair
+    PuzzleSideDescriptors objSides = PuzzleSideDescriptors(7, std::vector<SideDescriptor>(2));
+
+    explicit TiedDifferences(std::uint32_t seed) {
+        FastRandom r(seed);
+        const int sides = 2 * objects;
+        differences.assign(static_cast<std::size_t>(sides) * sides, 0.0f);
+        for (int a = 0; a < sides; ++a) {
+            for (int b = a + 1; b < sides; ++b) {
+                if (a / 2 == b / 2 || a == 3 || b == 3) continue; // the same piece, and one side without pairs (f.e. a white one)
+                differences[a * sides + b] = differences[b * sides + a] = static_cast<float>(r.nextInt(0, 3));
+            }
+        }
+    }
+
+    float at(int objA, int sideA, int objB, int sideB) const { return differences[(objA * 2 + sideA) * 2 * objects + objB * 2 + sideB]; }
+
+    MatchedSide reduce(int objA, int sideA, int fromObjB, int toObjB) const {
+        MatchedSide matched;
+        for (int objB = fromObjB; objB < toObjB; ++objB) {
+            for (int sideB = 0; sideB < 2; ++sideB) {
+                if (objB != objA && at(objA, sideA, objB, sideB) > 0.0f) matched.consider(objB, sideB, at(objA, sideA, objB, sideB));
+            }
+        }
+        return matched;
+    }
+
+    // As matchShard reports the block: sides A over pieces B, then (off the diagonal) sides B over pieces A
+    MatchingBlockResult blockResult(const MatchingBlock &block) const {
+        MatchingBlockResult result;
+        result.block = block;
+        for (int objA = block.fromObjA; objA < block.toObjA; ++objA) {
+            for (int sideA = 0; sideA < 2; ++sideA) result.sides.push_back({objA, sideA, reduce(objA, sideA, block.fromObjB, block.toObjB)});
+        }
+        if (block.fromObjA != block.fromObjB) {
+            for (int objB = block.fromObjB; objB < block.toObjB; ++objB) {
+                for (int sideB = 0; sideB < 2; ++sideB) result.sides.push_back({objB, sideB, reduce(objB, sideB, block.fromObjA, block.toObjA)});
+            }
+        }
+        return result;
+    }
+};
+
+} // namespace
+
+TEST(distributed_matching, planCoversUpperTriangle) {
+    for (int objectsPerBlock : {1, 3, 20, 25}) {
+        SCOPED_TRACE("objectsPerBlock=" + std::to_string(objectsPerBlock));
+        std::vector<int> covered(20 * 20, 0);
+        for (const MatchingBlock &block: planMatchingBlocks(20, objectsPerBlock)) {
+            EXPECT_TRUE(block.fromObjA == block.fromObjB ? block.toObjA == block.toObjB : block.toObjA <= block.fromObjB);
+            // the pairs the block compares (on the diagonal - once)
+            for (int a = block.fromObjA; a < block.toObjA; ++a)
+                for (int b = std::max(a + 1, block.fromObjB); b < block.toObjB; ++b) ++covered[a * 20 + b];
+        }
+        for (int a = 0; a < 20; ++a) {
+            for (int b = a + 1; b < 20; ++b) EXPECT_EQ(covered[a * 20 + b], 1) << a << " " << b;
+        }
+    }
+}
+
+TEST(distributed_matching, equalsSideMatcher) {
+    const MatcherInput input = matcherInput(4, 5, 17);
+    for (bool prefilter : {false, true}) {
+        SideMatcherOptions options;
+        options.geometricPrefilter = prefilter;
+        SideMatcherStats stats;
+        const std::vector<std::vector<MatchedSide>> expected =
+            SideMatcher(input.descriptors, input.channels, options).match(true, {}, &stats);
+        // 20 pieces: one per block, blocks that do not divide them, one block
+        for (int objectsPerBlock : {1, 3, 7, 20, 25}) {
+            SCOPED_TRACE(std::string(prefilter ? "geometric prefilter" : "all pairs") + ", objectsPerBlock=" + std::to_string(objectsPerBlock));
+            expectSameMatches(matchDistributed(input.descriptors, input.channels, options, objectsPerBlock), expected);
+            expectSameMatches(matchDistributed(input.descriptors, input.channels, options, objectsPerBlock, {}, false), expected);
+
+            // every unordered pair is compared once
+            int compared = 0;
+            for (const MatchingBlock &block: planMatchingBlocks(20, objectsPerBlock)) {
+                compared += matchShard(makeMatchingShard(input.descriptors, input.channels, options, block)).comparedPairs;
+            }
+            EXPECT_EQ(compared, stats.comparedPairs - stats.mirroredPairs);
+        }
+    }
+}
+
+TEST(distributed_matching, runnerGetsSerializedShards) {
+    const MatcherInput input = matcherInput(3, 4, 239);
+    const SideMatcherOptions options;
+    const std::vector<std::vector<MatchedSide>> expected = SideMatcher(input.descriptors, input.channels, options).match();
+    int shards = 0;
+    const MatchingShardRunner runner = [&](const std::string &shard) {
+        ++shards;
+        std::istringstream in(shard);
+        return saved(matchShard(loadMatchingShard(in), false));
+    };
+    expectSameMatches(matchDistributed(input.descriptors, input.channels, options, 5, runner, false), expected);
+    EXPECT_EQ(shards, 6); // 12 pieces in ranges of 5, 5 and 2: 3 diagonal blocks and 3 above them (not 9)
+}
+
+TEST(distributed_matching, mergeIsIndependentOfTheOrderOfResults) {
+    const MatcherInput input = matcherInput(4, 5, 17);
+    const SideMatcherOptions options;
+    const std::vector<std::vector<MatchedSide>> expected = SideMatcher(input.descriptors, input.channels, options).match();
+    std::vector<MatchingBlockResult> results;
+    for (const MatchingBlock &block: planMatchingBlocks(20, 3)) {
+        results.push_back(matchShard(makeMatchingShard(input.descriptors, input.channels, options, block)));
+    }
+    FastRandom r(7);
+    for (int attempt = 0; attempt < 5; ++attempt) {
+        SCOPED_TRACE("attempt " + std::to_string(attempt));
+        shuffle(results, r);
+        expectSameMatches(mergeMatchingResults(input.descriptors, results), expected);
+    }
+}
+
+TEST(distributed_matching, mergeKeepsTheSerialOrderOfTies) {
+    for (std::uint32_t seed : {1u, 2u, 3u}) {
+        const TiedDifferences tied(seed);
+        std::vector<std::vector<MatchedSide>> expected(tied.objects, std::vector<MatchedSide>(2));
+        int tiedBest = 0, tiedCandidates = 0;
+        for (int obj = 0; obj < tied.objects; ++obj) {
+            for (int side = 0; side < 2; ++side) {
+                const MatchedSide &matched = expected[obj][side] = tied.reduce(obj, side, 0, tied.objects);
+                tiedBest += matched.differenceBest >= 0.0f && matched.differenceSecondBest == matched.differenceBest;
+                for (int k = 1; k < matched.candidates.size; ++k) {
+                    tiedCandidates += matched.candidates.items[k].cost == matched.candidates.items[k - 1].cost;
+                }
+            }
+        }
+        ASSERT_GT(tiedBest, 0);
+        ASSERT_GT(tiedCandidates, 0);
+        ASSERT_EQ(expected[1][1].objB, -1); // the side without pairs
+
+        FastRandom r(seed);
+        for (int objectsPerBlock : {1, 2, 3, 7}) {
+            SCOPED_TRACE("seed " + std::to_string(seed) + ", objectsPerBlock=" + std::to_string(objectsPerBlock));
+            std::vector<MatchingBlockResult> results;
+            for (const MatchingBlock &block: planMatchingBlocks(tied.objects, objectsPerBlock)) results.push_back(tied.blockResult(block));
+            shuffle(results, r);
+            expectSameMatches(mergeMatchingResults(tied.objSides, results), expected);
+        }
+    }
+}
+
+TEST(distributed_matching, shardsAndResultsRoundTrip) {
+    const MatcherInput input = matcherInput(3, 4, 239);
+    SideMatcherOptions options;
+    options.geometricPrefilter = true;
+    options.maxLengthRatio = 1.25f;
+    options.flatBulge = 0.07f;
+    options.alignmentShift = 2;
+    const MatchingBlock block{0, 5, 5, 10};
+    const MatchingShard shard = makeMatchingShard(input.descriptors, input.channels, options, block);
+    ASSERT_EQ(shard.objects.size(), 10u);
+
+    std::istringstream shardIn(saved(shard));
+    const MatchingShard loaded = loadMatchingShard(shardIn);
+    EXPECT_EQ(shardIn.peek(), std::char_traits<char>::eof());
+    expectSameBlocks(loaded.block, block);
+    EXPECT_EQ(loaded.channels, shard.channels);
+    EXPECT_EQ(loaded.options.geometricPrefilter, true);
+    EXPECT_EQ(loaded.options.maxLengthRatio, options.maxLengthRatio);
+    EXPECT_EQ(loaded.options.flatBulge, options.flatBulge);
+    EXPECT_EQ(loaded.options.alignmentShift, options.alignmentShift);
+    EXPECT_EQ(loaded.objects, shard.objects);
+    expectSameDescriptors(loaded.objSides, shard.objSides);
+
+    const MatchingBlockResult result = matchShard(loaded);
+    std::istringstream resultIn(saved(result));
+    const MatchingBlockResult loadedResult = loadMatchingBlockResult(resultIn);
+    EXPECT_EQ(resultIn.peek(), std::char_traits<char>::eof());
+    expectSameBlocks(loadedResult.block, block);
+    EXPECT_EQ(loadedResult.comparedPairs, result.comparedPairs);
+    ASSERT_EQ(loadedResult.sides.size(), result.sides.size());
+    for (std::size_t k = 0; k < result.sides.size(); ++k) {
+        EXPECT_EQ(loadedResult.sides[k].objA, result.sides[k].objA);
+        EXPECT_EQ(loadedResult.sides[k].sideA, result.sides[k].sideA);
+        expectSameMatches({{loadedResult.sides[k].matched}}, {{result.sides[k].matched}});
+    }
+}
+
+TEST(distributed_matching, malformedInputsFailTheirAsserts) {
+    const MatcherInput input = matcherInput(3, 4, 239);
+    const SideMatcherOptions options;
+    const MatchingShard shard = makeMatchingShard(input.descriptors, input.channels, options, {0, 4, 4, 8});
+    const std::string shardBytes = saved(shard);
+    const std::string resultBytes = saved(matchShard(shard));
+
+    std::string bytes = shardBytes;
+    bytes[0] = 'X';
+    EXPECT_EQ(shardLoadError(bytes), "34712839743002");
+    EXPECT_EQ(shardLoadError(resultBytes), "34712839743002"); // a result is not a shard
+    EXPECT_EQ(resultLoadError(shardBytes), "34712839743002");
+    bytes = shardBytes;
+    bytes[8] = 2; // the version after the magic
+    EXPECT_EQ(shardLoadError(bytes), "34712839743003");
+    bytes = resultBytes;
+    bytes[8] = 4;
+    EXPECT_EQ(resultLoadError(bytes), "34712839743003");
+    bytes = shardBytes;
+    bytes[12] = -1; // fromObjA
+    bytes[13] = bytes[14] = bytes[15] = -1;
+    EXPECT_EQ(shardLoadError(bytes), "34712839743004");
+
+    // every truncation fails an assert of a short read
+    for (std::size_t size : {std::size_t(0), std::size_t(5), std::size_t(10), std::size_t(20), shardBytes.size() / 2, shardBytes.size() - 1}) {
+        const std::string code = shardLoadError(shardBytes.substr(0, size));
+        EXPECT_TRUE(code == "34712839743001" || code == "34712839743002" || code == "34712839743013") << size << ": " << code;
+    }
+    for (std::size_t size : {std::size_t(0), std::size_t(20), resultBytes.size() / 2, resultBytes.size() - 1}) {
+        const std::string code = resultLoadError(resultBytes.substr(0, size));
+        EXPECT_TRUE(code == "34712839743001" || code == "34712839743002") << size << ": " << code;
+    }
+
+    MatchingShard unordered = shard;
+    std::swap(unordered.objects[0], unordered.objects[1]);
+    EXPECT_EQ(shardLoadError(saved(unordered)), "34712839743011");
+    MatchingShard otherChannels = shard;
+    otherChannels.channels = 1;
+    EXPECT_EQ(shardLoadError(saved(otherChannels)), "34712839743012");
+
+    // candidates of the first side: after the header, the block, comparedPairs, the count of sides and 6 fields of the side
+    bytes = resultBytes;
+    bytes[12 + 16 + 4 + 4 + 6 * 4] = SideCandidates::capacity + 1;
+    EXPECT_EQ(resultLoadError(bytes), "34712839743015");
+
+    // blocks that are not of the plan
+    const MatchingShard lower = makeMatchingShard(input.descriptors, input.channels, options, {4, 8, 0, 4});
+    EXPECT_EQ(assertionCode([&] { matchShard(lower); }), "34712839743022");
+    std::vector<MatchingBlockResult> results;
+    for (const MatchingBlock &block: planMatchingBlocks(12, 4)) results.push_back(matchShard(makeMatchingShard(input.descriptors, input.channels, options, block)));
+    std::vector<MatchingBlockResult> missing(results.begin() + 1, results.end());
+    EXPECT_EQ(assertionCode([&] { mergeMatchingResults(input.descriptors, missing); }), "34712839743017");
+    std::vector<MatchingBlockResult> twice = results;
+    twice.push_back(results.back());
+    EXPECT_EQ(assertionCode([&] { mergeMatchingResults(input.descriptors, twice); }), "34712839743017");
+    std::vector<MatchingBlockResult> mirrored = results;
+    std::swap(mirrored[1].block.fromObjA, mirrored[1].block.fromObjB);
+    std::swap(mirrored[1].block.toObjA, mirrored[1].block.toObjB);
+    EXPECT_EQ(assertionCode([&] { mergeMatchingResults(input.descriptors, mirrored); }), "34712839743023");
+}
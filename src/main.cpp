@@ -1,28 +1,50 @@
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <tuple>
 #include <libimages/draw.h>
-#include <libimages/algorithms/blur.h>
-#include <libimages/algorithms/downsample.h>
 #include <libimages/algorithms/grayscale.h>
 #include <libimages/algorithms/threshold_masking.h>
 #include <libimages/algorithms/morphology.h>
+#include <libimages/algorithms/resample.h>
 #include <libimages/algorithms/split_into_parts.h>
 #include <libimages/algorithms/extract_contour.h>
 #include <libimages/algorithms/simplify_contours.h>
 
+#include <libbase/autotuner.h>
+#include <libbase/cpu_budget.h>
 #include <libbase/stats.h>
+#include <libbase/task_scheduler.h>
 #include <libbase/timer.h>
 #include <libbase/fast_random.h>
+#include <libbase/memory_tracker.h>
+#include <libbase/profiler.h>
 #include <libbase/runtime_assert.h>
 #include <libbase/configure_working_directory.h>
+#include <libimages/bit_mask.h>
 #include <libimages/debug_io.h>
 #include <libimages/image.h>
 #include <libimages/image_io.h>
+#include <libimages/image_prefetcher.h>
+#include <libimages/image_pyramid.h>
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "sides_comparison_utils.h"
+#include "assembly_session.h"
+#include "piece_set.h"
 #include "puzzle_assembly.h"
+#include "puzzle_batch.h"
+#include "puzzle_service.h"
+#include "puzzle_solver.h"
+#include "side_matcher.h"
+#include "stage_cache.h"
+#include "tiled_segmentation.h"
 
 int main() {
     try {
@@ -42,12 +64,200 @@ int main() {
             // "03_eight_parts_shuffled2",
         };
 
-        // создание визуализации каждой пары сопоставлений занимает большое время, поэтому оставим этот выключатель на будущее
-        // когда нужен просто результат без анализа - можно будет выключить
-        bool draw_sides_matching_plots = true;
+        // какие отладочные картинки строить (выключенные даже не рисуются), по категориям:
+        // Segmentation - маски фона, Objects - картинки каждого кусочка, Matching - сопоставления сторон, Assembly - собранный пазл
+        // Off - ничего, Results - только итоговые, Steps - и промежуточные шаги, All - еще и графики каждой пары сторон
+        // создание визуализации каждой пары сопоставлений занимает большое время,
+        // когда нужен просто результат без анализа - можно выключить все через debug_io::Level::Off
+        debug_io::set_level(debug_io::Level::All);
+        const bool draw_sides_matching_plots = debug_io::enabled(debug_io::Category::Matching, debug_io::Level::All);
+
+        // пакетный режим: столько картинок обрабатываются одновременно (каждая - своей частью потоков, без переподписки ядер),
+        // в лог пишутся только раскладки и скорость (картинок в секунду), из отладочных картинок - только собранный пазл;
+        // 1 - картинки по одной, со всей отладочной визуализацией ниже, 0 - столько, сколько потоков
+        const int batch_concurrent_images = 1;
+        // файл набора кусочков (см. piece_set.h): в пакетном режиме кусочки и описания сторон всех картинок (например одного
+        // пазла, сфотографированного частями) пишутся в один файл, кусочки нумеруются картинка за картинкой; затем файл
+        // открывается заново и в лог пишется, за сколько он отображается в память и копируется обратно (пусто - не пишется)
+        const std::string batch_piece_set_path = "";
+
+        // режим сервиса: задания (байты картинки и параметры) по одному читаются из stdin, результаты пишутся в stdout
+        // (формат - в puzzle_service.h), процесс с его пулами потоков и буферов живет между заданиями;
+        // задержки заданий (гистограммы) - по команде stats и в stderr при завершении
+        const bool service_mode = false;
+
+        // следующие картинки декодируются в фоновых потоках, пока обрабатывается текущая
+        // (не больше prefetch_ahead картинок вперед и не больше prefetch_max_mb мегабайт декодированных ожидающих картинок)
+        const int prefetch_ahead = 2;
+        const int prefetch_max_mb = 512;
+
+        // потоков доступно столько, сколько разрешают квота CPU cgroup (лимит контейнера) и маска affinity, а не сколько ядер
+        // у машины - под них подстраиваются и пул задач, и OpenMP (если не задан OMP_NUM_THREADS);
+        // бюджет потоков этапа: > 0 - не больше стольких, <= 0 - все доступные, кроме стольких
+        // (этапы - как в PuzzleSolver: segment, extractPieces, describeSides, match, assemble, render; и decode)
+        limitOpenMPToAvailableCpus();
+        const int decode_threads = 1;
+        setStageThreads("decode", decode_threads);
+        // пока считается текущая картинка, следующие декодируются - оставляем им их потоки
+        for (const char *stage : {"segment", "extractPieces", "describeSides", "match"}) setStageThreads(stage, -decode_threads);
+        std::vector<std::string> to_process_paths;
+        for (const std::string &image_name: to_process) to_process_paths.push_back("data/" + image_name + ".jpg");
+        ImagePrefetcher::Options prefetch_options;
+        prefetch_options.maxAhead = prefetch_ahead;
+        prefetch_options.maxBytes = std::size_t(prefetch_max_mb) << 20;
+        prefetch_options.threads = stageThreads("decode");
+        ImagePrefetcher prefetcher(batch_concurrent_images == 1 && !service_mode ? to_process_paths : std::vector<std::string>(), prefetch_options);
+
+        // отладочные картинки кодируются и записываются на диск в фоновых потоках, а не на пути основного алгоритма
+        // (если в очереди уже async_dumps_queue картинок - dump_image ждет)
+        const bool async_debug_dumps = true;
+        const int async_dumps_threads = 1;
+        const int async_dumps_queue = 16;
+        std::unique_ptr<debug_io::AsyncDumps> async_dumps;
+        if (async_debug_dumps) {
+            debug_io::AsyncDumps::Options dumps_options;
+            dumps_options.threads = async_dumps_threads;
+            dumps_options.maxQueued = async_dumps_queue;
+            async_dumps = std::make_unique<debug_io::AsyncDumps>(dumps_options);
+        }
+
+        // все этапы алгоритма (сегментация, кусочки, описание сторон, сопоставление, сборка) - в PuzzleSolver,
+        // здесь задаются их параметры, а в цикле ниже - только вывод в лог и отладочная визуализация между этапами
+        PuzzleSolverOptions solver_options;
+        // порог фона = 1.5 * 90-й перцентиль яркости пикселей границы картинки
+        solver_options.thresholdScale = 1.5;
+        solver_options.thresholdPercentile = 90;
+        // DONE: сначала попробуем dilation + erosion, все ли хорошо поулчилось? нет ли выбросов?
+        // closing + opening, затем
+        // добавляем эрозию на один-два шага чтобы при взятии цветов для описания сторон - не брать случайно черные цвета с фона
+        // эта проблема особенно ярко заметна на белых сторонах - там много черных вкраплений
+        // и хорошо видно что график вместо того чтобы быть в высоких около-255 значениях - часто скакал вниз
+        // все шаги выполняются за один потоковый проход
+        const int strength = 6;
+        solver_options.morphology = {
+            morphology::dilateOp(strength),
+            morphology::erodeOp(strength),
+            morphology::erodeOp(strength),
+            morphology::dilateOp(strength),
+            morphology::erodeOp(2),
+        };
+        // 1 - маска считается в полном разрешении, 4 (или 2, 8) - сначала вся цепочка на уменьшенной в столько раз картинке,
+        // а в полном разрешении - только полоса вокруг найденных границ (работа пропорциональна длине контуров, а не площади);
+        // при сохранении промежуточных шагов сегментации (Level::Steps) всегда полное разрешение
+        solver_options.coarseScale = 1;
+        const bool with_openmp = true;
+        solver_options.with_openmp = with_openmp;
+        // DONE 2 посмотрите на графики и подумайте, может имеет смысл как-то воздействовать на снятые с границы цвета?
+        // например сгладить? сглаживание профилей сторон задается здесь
+        solver_options.sideBlurStrength = 4.0f;
+        SideMatcherOptions &matcher_options = solver_options.matcher;
+        // метрика отличия двух профилей, для A/B сравнения можно подставить другую, например
+        // profileCostFunction<profile_cost::L2, profile_cost::TrimmedMean<10>>(channels); nullptr - медиана L1 разниц
+        matcher_options.cost = nullptr;
+        // 0 - каждую пару сторон сравниваем на длине более короткой из них,
+        // иначе все стороны один раз приводятся к такой длине и все пары считаются одной плотной матрицей
+        matcher_options.canonicalLength = 0;
+        // 0 - сравниваем все пары сторон полностью, иначе сначала грубо (по коротким профилям) отбираем
+        // столько лучших кандидатов на каждую сторону и полностью сравниваем только их (на больших пазлах сильно быстрее)
+        matcher_options.coarseCandidates = 0;
+        // для пазлов из тысяч кусочков: 0 - перебираем пары как выше, иначе для каждой стороны берем столько
+        // ближайших сторон из индекса (дерево точек обзора по коротким профилям) и полностью сравниваем только их
+        matcher_options.nearestCandidates = 0;
+        // отбрасываем пары сторон, которые не могут состыковаться по форме (сильно разная длина, выступ к выступу),
+        // еще до сравнения цветов
+        matcher_options.geometricPrefilter = false;
+        // досрочно прекращаем сравнение пары, как только она точно хуже лучшей из уже найденных для этой стороны
+        // (работает только без графиков сопоставления, т.к. им нужны все разницы; на маленьких пазлах
+        // выгоднее считать каждую пару один раз для обеих сторон, т.к. дороже всего тут передискретизация профилей)
+        matcher_options.earlyAbandon = false;
+        // 0 - профили сторон сравниваются строго друг напротив друга, иначе сторона B сдвигается вдоль A не больше
+        // чем на столько отсчетов и пара сравнивается при лучшем сдвиге (помогает, если уголок найден чуть неточно)
+        matcher_options.alignmentShift = 0;
+        // CornerBFS - обход в ширину от уголка по взаимно лучшим сопоставлениям,
+        // Greedy - жадная выкладка по кандидатам каждой стороны (не требует симметрии и уголка, подходит для больших пазлов)
+        solver_options.assemblyMethod = AssemblyMethod::CornerBFS;
+        const PuzzleSolver solver(solver_options);
+
+        if (service_mode) {
+            debug_io::set_level(debug_io::Level::Off); // stdout - только ответы
+            PuzzleService service(solver_options);
+            service.serve(std::cin, std::cout);
+            std::cerr << service.stats().jobs << " jobs (" << service.stats().errors << " failed), latency: "
+                      << service.stats().latencyMs.summary() << " ms" << std::endl;
+            return 0;
+        }
+
+        if (batch_concurrent_images != 1) {
+            PuzzleBatchOptions batch_options;
+            batch_options.concurrentImages = batch_concurrent_images;
+            const unsigned batch_outputs = debug_io::enabled(debug_io::Category::Assembly) ? AssemblyOutputCanvas : AssemblyOutputGridOnly;
+            for (const std::string &image_name: to_process) std::filesystem::remove_all("debug/" + image_name + "/");
+            // кусочки и описания картинок для набора кусочков (у картинок, которые не получилось обработать, - пустые)
+            std::vector<PuzzlePieces> set_pieces(to_process.size());
+            std::vector<PuzzleSideDescriptors> set_descriptors(to_process.size());
+            PuzzleBatchStats batch_stats = solveBatch(solver, to_process_paths, [&](int index, PuzzleSolution &solution) {
+                const std::string &image_name = to_process[index];
+                std::cout << "image " << image_name << ": " << solution.pieces.count() << " objects extracted" << std::endl;
+                printGrid(std::cout, solution.assembly);
+                if (batch_outputs & AssemblyOutputCanvas) {
+                    debug_io::dump_image("debug/" + image_name + "/10_assembled.png", solution.assembly.assembled);
+                }
+                if (!batch_piece_set_path.empty()) {
+                    set_pieces[index] = std::move(solution.pieces);
+                    set_descriptors[index] = std::move(solution.descriptors);
+                }
+            }, batch_options, batch_outputs);
+            for (const auto &[index, error]: batch_stats.errors) {
+                std::cerr << "image " << to_process[index] << " failed: " << error << std::endl;
+            }
+            if (async_dumps) async_dumps->flush();
+            std::cout << batch_stats.images << " images processed (" << batch_stats.concurrentImages << " at once, "
+                      << batch_stats.threadsPerImage << " threads each): " << batch_stats.imagesPerSecond() << " images/sec" << std::endl;
+            std::cout << "all images processed in " << batch_stats.seconds << " sec" << std::endl;
+            if (!batch_piece_set_path.empty()) {
+                std::vector<PieceSetPhoto> photos;
+                for (std::size_t index = 0; index < to_process.size(); ++index) photos.push_back({set_pieces[index], set_descriptors[index]});
+                Timer t;
+                PieceSet::write(batch_piece_set_path, photos);
+                const double write_seconds = t.elapsed();
+                t.restart();
+                const PieceSet piece_set(batch_piece_set_path);
+                const double open_seconds = t.elapsed();
+                t.restart();
+                const PuzzlePieces all_pieces = piece_set.pieces();
+                const PuzzleSideDescriptors all_descriptors = piece_set.descriptors();
+                const double copy_seconds = t.elapsed();
+                std::cout << "piece set " << batch_piece_set_path << ": " << piece_set.count() << " pieces of " << piece_set.photos()
+                          << " images, " << piece_set.bytes() << " bytes written in " << write_seconds << " sec, opened in "
+                          << open_seconds << " sec, " << all_pieces.count() << " pieces and " << all_descriptors.size()
+                          << " descriptors copied out in " << copy_seconds << " sec" << std::endl;
+            }
+            return 0;
+        }
+
+        // кэш результатов этапов на диске (ключ - содержимое фотографии, параметры этапов и версия кода kStageCacheVersion):
+        // при подборе параметров сопоставления и сборки сегментация и выделение кусочков не пересчитываются
+        const bool use_stage_cache = false;
+        const StageCache stage_cache("debug/stage_cache");
+        // морфология с Method::Auto при первом вызове замеряет варианты ядер (VanHerk/Integral, параллельно или нет) и
+        // выбирает самый быстрый на этой машине (см. libbase/autotuner.h), с этим файлом выбор переживает перезапуск
+        const bool use_autotune_cache = false;
+        if (use_autotune_cache) autotune::setCacheFile("debug/autotune_cache.txt");
+        // 0 - сегментация всей фотографии в памяти, иначе - сегментация прямо из файла полосами строк с таким бюджетом памяти
+        // в байтах (см. segmentTiled - для сканов в гигапиксели, которые целиком в память не влезают), шаги тогда не рисуются
+        const std::size_t tiled_segmentation_max_bytes = 0;
+
+        // иерархический профайлер (PROFILE_SCOPE, см. libbase/profiler.h): в конце - таблица зон (сколько раз, суммарно,
+        // медиана, p90...) и debug/profile_trace.json для chrome://tracing или https://ui.perfetto.dev,
+        // плюс по каждой зоне число аллокаций, пик и оставшиеся байты кучи, а в конце - память по типам картинок
+        // (см. libbase/memory_tracker.h)
+        const bool profile_zones = false;
+        profiler::setEnabled(profile_zones);
 
         Timer all_images_t;
-        for (const std::string &image_name: to_process) {
+        for (int image_index = 0; image_index < (int) to_process.size(); ++image_index) {
+            PROFILE_SCOPE("image");
+            const std::string &image_name = to_process[image_index];
             Timer total_t;
             Timer t;
 
@@ -55,306 +265,421 @@ int main() {
             // удаляем папку чтобы не анализировать случайно старые визуализации
             std::filesystem::remove_all(debug_dir);
 
-            image8u image = load_image("data/" + image_name + ".jpg");
+            double decode_seconds = 0.0;
+            // фотография - нулевой уровень своей пирамиды: уменьшенные уровни (например грубый для сегментации с coarseScale)
+            // строятся при первом обращении и остаются в ней для следующих этапов
+            pyramid8u photo(prefetcher.next(&decode_seconds));
+            const image8u &image = photo.level(0);
             auto [w, h, c] = image.size();
             rassert(c == 3, 237045347618912, image.channels());
+            std::cout << "image decoded in " << decode_seconds << " sec" << std::endl;
             std::cout << "image loaded in " << t.elapsed() << " sec" << std::endl;
-            debug_io::dump_image(debug_dir + "00_input.jpg", image);
-
-            image32f grayscale = to_grayscale_float(image);
-            rassert(grayscale.channels() == 1, 2317812937193);
-            rassert(grayscale.width() == w && grayscale.height() == h, 7892137419283791);
-            debug_io::dump_image(debug_dir + "01_grayscale.jpg", grayscale);
-
-            std::vector<float> intensities_on_border;
-            for (int j = 0; j < h; ++j) {
-                for (int i = 0; i < w; ++i) {
-                    // пропускаем все пиксели кроме границы изображения
-                    if (i != 0 && i != w - 1 && j != 0 && j != h - 1)
-                        continue;
-                    intensities_on_border.push_back(grayscale(j, i));
+            const bool debug_segmentation_steps = debug_io::enabled(debug_io::Category::Segmentation, debug_io::Level::Steps);
+            if (debug_segmentation_steps) {
+                debug_io::dump_image(debug_dir + "00_input.jpg", image);
+            }
+
+            // полную grayscale картинку строим только ради отладочной визуализации,
+            // для порога и маски нужны лишь пиксели границы + один проход по RGB
+            if (debug_segmentation_steps) {
+                image32f grayscale = to_grayscale_float(image);
+                rassert(grayscale.channels() == 1, 2317812937193);
+                rassert(grayscale.width() == w && grayscale.height() == h, 7892137419283791);
+                debug_io::dump_image(debug_dir + "01_grayscale.jpg", grayscale);
+            }
+
+            // если фотография и параметры сегментации не менялись - кусочки (и ниже описания сторон) загружаются из кэша
+            // вместо повторной сегментации (тогда ее шаги не печатаются и не рисуются)
+            PuzzlePieces pieces;
+            // часть фотографии, вне которой маска пустая (после загрузки из кэша неизвестна - вся фотография)
+            bbox2i objects_roi;
+            objects_roi.include_pixel(0, 0);
+            objects_roi.include_pixel(w - 1, h - 1);
+            // номера объектов внутри objects_roi - такими, какими их разметило разбиение на компоненты связности
+            // (пусто, если кусочки загружены из кэша или сегментация была потоковой)
+            ObjectLabels object_labels;
+            const StageKey pieces_key = use_stage_cache ? StageCache::piecesKey(to_process_paths[image_index], solver_options) : StageKey();
+            if (use_stage_cache && stage_cache.loadPieces(pieces_key, pieces)) {
+                std::cout << "pieces loaded from stage cache " << pieces_key.hex() << std::endl;
+            } else if (tiled_segmentation_max_bytes > 0) {
+                t.restart();
+                TiledSegmentationOptions tiled_options;
+                tiled_options.maxBytes = tiled_segmentation_max_bytes;
+                TiledSegmentationStats tiled_stats;
+                pieces = segmentTiled(solver, to_process_paths[image_index], tiled_options, &tiled_stats);
+                std::cout << "background threshold=" << tiled_stats.backgroundThreshold << std::endl;
+                std::cout << "tiled segmentation: " << tiled_stats.bands << " bands of " << tiled_stats.bandRows << " rows, "
+                          << tiled_stats.workingBytes << " bytes at most, " << tiled_stats.runs << " runs"
+                          << (tiled_stats.streamed ? "" : " (decoded whole)") << " in " << t.elapsed() << " sec" << std::endl;
+                if (use_stage_cache) stage_cache.savePieces(pieces_key, pieces);
+            } else {
+                // DONE: найдем порог разделяющий яркость на фон и объект - background_threshold (по пикселям границы),
+                // DONE: построим маску объект-фон + выведем в лог процент пикселей на фоне
+                // маски храним упакованными по биту на пиксель - так морфология и разбиение на части читают в 8 раз меньше памяти
+                // DONE: сделаем маску более гладкой и точной через Морфологию (шаги задаются в solver_options.morphology)
+                // промежуточные маски сохраняются только для отладки
+                t.restart();
+                PuzzleSegmentation segmentation = solver.segment(photo, debug_segmentation_steps);
+                // DONE: какой инвариант мы можем проверить про размер intensities_on_border.size()? чем он должен быть равен?
+                // (проверяется в PuzzleSolver::segment: 2 * w + 2 * h - 4)
+                std::cout << "intensities on border: " << stats::summaryStats(segmentation.borderIntensities) << std::endl;
+                std::cout << "background threshold=" << segmentation.backgroundThreshold << std::endl;
+                if (segmentation.thresholded.width() > 0) {
+                    double is_foreground_sum = segmentation.thresholded.count();
+                    std::cout << "thresholded background: " << stats::toPercent(w * h - is_foreground_sum, 1.0 * w * h) << std::endl;
+                }
+                if (debug_segmentation_steps) {
+                    debug_io::dump_image(debug_dir + "02_is_foreground_mask.png", segmentation.thresholded, SavePreset::Fast);
+                }
+                std::cout << "segmentation in " << t.elapsed() << " sec" << std::endl;
+
+                // DONE 1 посмотрите на RGB графики тех сторон у которых нет и не может быть соседей, то есть у белых полос
+                // разумно ли они выглядят? с чем это может быть связано? как это исправить?
+                // промежуточные маски пишем быстрым (менее сжатым) PNG
+                if (debug_segmentation_steps) {
+                    debug_io::dump_image(debug_dir + "03_is_foreground_dilated.png", segmentation.steps[0], SavePreset::Fast);
+                    debug_io::dump_image(debug_dir + "04_is_foreground_dilated_eroded.png", segmentation.steps[1], SavePreset::Fast);
+                    debug_io::dump_image(debug_dir + "05_is_foreground_dilated_eroded_eroded.png", segmentation.steps[2], SavePreset::Fast);
+                }
+                if (debug_io::enabled(debug_io::Category::Segmentation)) {
+                    debug_io::dump_image(debug_dir + "06_is_foreground_dilated_eroded_eroded_dilated.png", segmentation.mask);
                 }
+
+                // кусочки (связные компоненты маски) сразу с контурами, углами и сторонами
+                // морфология и разбиение на кусочки - только внутри objects_roi
+                objects_roi = segmentation.roi;
+                pieces = solver.extractPieces(image, segmentation.mask, objects_roi,
+                                              debug_io::enabled(debug_io::Category::Segmentation) ? &object_labels : nullptr);
+                if (use_stage_cache) stage_cache.savePieces(pieces_key, pieces);
             }
-            // DONE: какой инвариант мы можем проверить про размер intensities_on_border.size()? чем он должен быть равен?
-            rassert(intensities_on_border.size() == 2 * w + 2 * h - 4, 7283197129381312);
-            std::cout << "intensities on border: " << stats::summaryStats(intensities_on_border) << std::endl;
-
-            // DONE: найдем порог разделяющий яркость на фон и объект - background_threshold
-            double background_threshold = 1.5 * stats::percentile(intensities_on_border, 90);
-            std::cout << "background threshold=" << background_threshold << std::endl;
-
-            // DONE: построим маску объект-фон + сохраним визуализацию на диск + выведем в лог процент пикселей на фоне
-            image8u is_foreground_mask = threshold_masking(grayscale, background_threshold);
-            double is_foreground_sum = stats::sum(is_foreground_mask.toVector());
-            std::cout << "thresholded background: " << stats::toPercent(w * h - is_foreground_sum / 255.0, 1.0 * w * h) << std::endl;
-            debug_io::dump_image(debug_dir + "02_is_foreground_mask.png", is_foreground_mask);
-
-            t.restart();
-            // DONE: сделаем маску более гладкой и точной через Морфологию
-            // DONE: сначала попробуем dilation + erosion, все ли хорошо поулчилось? нет ли выбросов?
-            int strength = 6;
-
-            const bool with_openmp = true;
-            image8u dilated_mask = morphology::dilate(is_foreground_mask, strength, with_openmp);
-            image8u dilated_eroded_mask = morphology::erode(dilated_mask, strength, with_openmp);
-            image8u dilated_eroded_eroded_mask = morphology::erode(dilated_eroded_mask, strength, with_openmp);
-            image8u dilated_eroded_eroded_dilated_mask = morphology::dilate(dilated_eroded_eroded_mask, strength, with_openmp);
-
-            // добавляем эрозию на один-два шага чтобы при взятии цветов для описания сторон - не брать случайно черные цвета с фона
-            // эта проблема особенно ярко заметна на белых сторонах - там много черных вкраплений
-            // и хорошо видно что график вместо того чтобы быть в высоких около-255 значениях - часто скакал вниз
-            dilated_eroded_eroded_dilated_mask = morphology::erode(dilated_eroded_eroded_dilated_mask, 2, with_openmp);
-
-            std::cout << "full morphology in " << t.elapsed() << " sec" << std::endl;
-
-            // DONE 1 посмотрите на RGB графики тех сторон у которых нет и не может быть соседей, то есть у белых полос
-            // разумно ли они выглядят? с чем это может быть связано? как это исправить?
-            debug_io::dump_image(debug_dir + "03_is_foreground_dilated.png", dilated_mask);
-            debug_io::dump_image(debug_dir + "04_is_foreground_dilated_eroded.png", dilated_eroded_mask);
-            debug_io::dump_image(debug_dir + "05_is_foreground_dilated_eroded_eroded.png", dilated_eroded_eroded_mask);
-            debug_io::dump_image(debug_dir + "06_is_foreground_dilated_eroded_eroded_dilated.png", dilated_eroded_eroded_dilated_mask);
-
-            is_foreground_mask = dilated_eroded_eroded_dilated_mask;
-            auto [objOffsets, objImages, objMasks] = splitObjects(image, is_foreground_mask);
-            int objects_count = objImages.size();
+            const std::vector<point2i> &objOffsets = pieces.offsets;
+            const std::vector<image8u> &objImages = pieces.images;
+            const std::vector<image8u> &objMasks = pieces.masks;
+            const std::vector<std::vector<point2i>> &objCorners = pieces.corners;
+            const PieceSides &objSides = pieces.sides;
+            int objects_count = pieces.count();
             std::cout << objects_count << " objects extracted" << std::endl;
             rassert(objects_count == 6 || objects_count == 8, 237189371298, objects_count);
 
             // визуализируем цветами компоненты связности - один объект - один цвет
-            image32i image_with_object_indices(image.width(), image.height(), 1);
-            for (int obj = 0; obj < objects_count; ++obj) {
-                // это отступ - координата верхнего левого угла объекта на оригинальной картинке
-                point2i offset = objOffsets[obj];
-
-                // это маска объекта
-                image8u mask = objMasks[obj];
-
-                for (int j = 0; j < mask.height(); ++j) {
-                    for (int i = 0; i < mask.width(); ++i) {
-                        // если объект в своей маске отмечен как "тут объект"
-                        if (mask(j, i) == 255) {
-                            // то рассчитываем координаты этого пикселя в оригинальной картинке и пишем туда наш номер (индексация с 1)
-                            int global_i = offset.x + i;
-                            int global_j = offset.y + j;
-                            image_with_object_indices(global_j, global_i) = obj + 1;
+            if (debug_io::enabled(debug_io::Category::Segmentation)) {
+                // номера объектов храним только внутри objects_roi (вне его объектов нет), на картинку кладем в ее место;
+                // обычно это готовая разметка из extractPieces (16-битная), иначе собираем ее из масок кусочков
+                if (object_labels.empty()) {
+                    object_labels.labels32 = image32i(objects_roi.width(), objects_roi.height(), 1);
+                    for (int obj = 0; obj < objects_count; ++obj) {
+                        // это отступ - координата верхнего левого угла объекта на оригинальной картинке (здесь - внутри objects_roi)
+                        point2i offset = objOffsets[obj] - objects_roi.min;
+
+                        // это маска объекта
+                        const image8u &mask = objMasks[obj];
+
+                        for (int j = 0; j < mask.height(); ++j) {
+                            for (int i = 0; i < mask.width(); ++i) {
+                                // если объект в своей маске отмечен как "тут объект"
+                                if (mask(j, i) == 255) {
+                                    // то рассчитываем координаты этого пикселя в оригинальной картинке и пишем туда наш номер (индексация с 1)
+                                    int global_i = offset.x + i;
+                                    int global_j = offset.y + j;
+                                    object_labels.labels32(global_j, global_i) = obj + 1;
+                                }
+                            }
                         }
                     }
                 }
+                const image8u colorized_roi = object_labels.labels16.width() > 0 ? debug_io::colorize_labels(object_labels.labels16, 0)
+                                                                                 : debug_io::colorize_labels(object_labels.labels32, 0);
+                image8u colorized_objects(image.width(), image.height(), 3);
+                for (int j = 0; j < colorized_roi.height(); ++j) {
+                    std::copy(colorized_roi.ptr(j), colorized_roi.ptr(j) + colorized_roi.width() * 3,
+                              colorized_objects.ptr(objects_roi.min.y + j) + objects_roi.min.x * 3);
+                }
+                debug_io::dump_image(debug_dir + "07_colorized_objects.jpg", std::move(colorized_objects));
+                object_labels = {}; // разметка больше не нужна
             }
-            debug_io::dump_image(debug_dir + "07_colorized_objects.jpg", debug_io::colorize_labels(image_with_object_indices, 0));
 
-            std::vector<std::vector<std::vector<point2i>>> objSides(objects_count);
-            std::vector<std::vector<point2i>> objCorners(objects_count);
-            for (int obj = 0; obj < objects_count; ++obj) {
+            // визуализации кусочков рисуются параллельно (кусочки независимы), а сохраняются потом по порядку кусочков,
+            // чтобы лог и файлы не зависели от числа потоков
+            std::vector<std::vector<std::function<void()>>> obj_dumps(objects_count);
+            parallelForEach(0, objects_count, [&](int obj) {
+                // визуализация переезжает в очередь сохранения без копии, а картинки и маски кусочков (они живут до сохранения)
+                // передаются ссылкой через std::cref
+                auto dump = [&](const std::string &path, auto visualization) {
+                    obj_dumps[obj].push_back([path, visualization = std::move(visualization)]() mutable { debug_io::dump_image(path, std::move(visualization)); });
+                };
                 std::string obj_debug_dir = debug_dir + "objects/object" + std::to_string(obj) + "/";
 
-                debug_io::dump_image(obj_debug_dir + "01_image.jpg", objImages[obj]);
-                debug_io::dump_image(obj_debug_dir + "02_mask.jpg", objMasks[obj]);
+                if (debug_io::enabled(debug_io::Category::Objects)) {
+                    dump(obj_debug_dir + "01_image.jpg", std::cref(objImages[obj]));
+                    dump(obj_debug_dir + "02_mask.jpg", std::cref(objMasks[obj]));
+                }
+                const bool debug_object_steps = debug_io::enabled(debug_io::Category::Objects, debug_io::Level::Steps);
 
                 // DONE реализуйте построение маски контура-периметра, нажмите Ctrl+Click на buildContourMask:
-                image8u objContourMask = buildContourMask(objMasks[obj]);
+                // сам контур обходим прямо по маске объекта (traceContour), маска контура нужна только для отладки
+                if (debug_object_steps) {
+                    image8u objContourMask = buildContourMask(objMasks[obj]);
+                    dump(obj_debug_dir + "03_mask_contour.jpg", std::move(objContourMask));
+                }
 
-                debug_io::dump_image(obj_debug_dir + "03_mask_contour.jpg", objContourMask);
+                const std::vector<point2i> &contour = pieces.contours[obj];
 
-                std::vector<point2i> contour = extractContour(objContourMask);
+                if (debug_object_steps) {
+                    // сделаем черную картинку чтобы визуализировать контур на ней
+                    image32f contour_visualization(objImages[obj].width(), objImages[obj].height(), 1);
 
-                // сделаем черную картинку чтобы визуализировать контур на ней
-                image32f contour_visualization(objImages[obj].width(), objImages[obj].height(), 1);
+                    // нарисуем на ней контур
+                    for (int i = 0; i < contour.size(); ++i) {
+                        point2i pixel = contour[i];
+                        // сделаем цвет тем ярче - чем дальше пиксель в контуре (чтобы проверить что он по часовой стрелке)
+                        drawPoint(contour_visualization, pixel, color32f(i * 255.0f / contour.size()));
+                    }
 
-                // нарисуем на ней контур
-                for (int i = 0; i < contour.size(); ++i) {
-                    point2i pixel = contour[i];
-                    // сделаем цвет тем ярче - чем дальше пиксель в контуре (чтобы проверить что он по часовой стрелке)
-                    drawPoint(contour_visualization, pixel, color32f(i * 255.0f / contour.size()));
+                    dump(obj_debug_dir + "04_mask_contour_clockwise.jpg", std::move(contour_visualization));
                 }
 
-                debug_io::dump_image(obj_debug_dir + "04_mask_contour_clockwise.jpg", contour_visualization);
-
                 // у нас теперь есть перечень пикселей на контуре объекта
                 // DONE реализуйте определение в этом контуре 4 вершин-углов и нарисуйте их на картинке, нажмите Ctrl+Click на simplifyContour:
-                std::vector<point2i> corners = simplifyContour(contour, 4);
-                objCorners[obj] = corners;
-                rassert(corners.size() == 4, 32174819274812);
-
-                // сделаем черную картинку чтобы визуализировать вершины-углы на ней
-                image32f corners_visualization(objImages[obj].width(), objImages[obj].height(), 1);
-                for (point2i corner: corners) {
-                    drawPoint(corners_visualization, corner, color32f(255.0f), 10);
-                }
-                debug_io::dump_image(obj_debug_dir + "05_corners_visualization.jpg", corners_visualization);
+                const std::vector<point2i> &corners = objCorners[obj];
 
-                // теперь извлечем стороны объекта
-                std::vector<std::vector<point2i>> sides = splitContourByCorners(contour, corners);
-                rassert(sides.size() == 4, 237897832141);
+                if (debug_object_steps) {
+                    // сделаем черную картинку чтобы визуализировать вершины-углы на ней
+                    image32f corners_visualization(objImages[obj].width(), objImages[obj].height(), 1);
+                    for (point2i corner: corners) {
+                        drawPoint(corners_visualization, corner, color32f(255.0f), 10);
+                    }
+                    dump(obj_debug_dir + "05_corners_visualization.jpg", std::move(corners_visualization));
+                }
 
-                // визуализируем каждую сторону объекта отдельным цветом:
-                image8u sides_visualization(objImages[obj].width(), objImages[obj].height(), 3);
-                FastRandom r(2391);
-                for (int i = 0; i < sides.size(); ++i) {
-                    color8u random_color = {(uint8_t) r.nextInt(0, 255), (uint8_t) r.nextInt(0, 255), (uint8_t) r.nextInt(0, 255)};
-                    color8u side_color = random_color;
-                    drawPoints(sides_visualization, sides[i], side_color);
+                // теперь извлечем стороны объекта (splitContourByCorners)
+                const PieceSides::Piece sides = objSides[obj];
+
+                if (debug_object_steps) {
+                    // визуализируем каждую сторону объекта отдельным цветом:
+                    image8u sides_visualization(objImages[obj].width(), objImages[obj].height(), 3);
+                    FastRandom r(2391);
+                    for (int i = 0; i < sides.size(); ++i) {
+                        color8u random_color = {(uint8_t) r.nextInt(0, 255), (uint8_t) r.nextInt(0, 255), (uint8_t) r.nextInt(0, 255)};
+                        color8u side_color = random_color;
+                        drawPoints(sides_visualization, sides[i], side_color);
+                    }
+                    dump(obj_debug_dir + "06_sides.jpg", std::move(sides_visualization));
                 }
-                debug_io::dump_image(obj_debug_dir + "06_sides.jpg", sides_visualization);
+            }, with_openmp);
+            for (const std::vector<std::function<void()>> &dumps: obj_dumps) {
+                for (const std::function<void()> &dump: dumps) dump();
+            }
 
-                objSides[obj] = sides;
+            // все что нужно знать о стороне для сопоставления (цвета в обоих направлениях, сглаженные профили, белая ли она)
+            // считаем один раз на сторону, а не заново для каждой пары сторон
+            const int channels = pieces.channels();
+            std::vector<std::vector<SideDescriptor>> objSideDescriptors;
+            const StageKey descriptors_key = StageCache::descriptorsKey(pieces_key, solver_options);
+            if (!use_stage_cache || !stage_cache.loadDescriptors(descriptors_key, objSideDescriptors)) {
+                objSideDescriptors = solver.describeSides(pieces);
+                if (use_stage_cache) stage_cache.saveDescriptors(descriptors_key, objSideDescriptors);
             }
 
+            // теперь будем сопоставлять каждую сторону объекта с каждой другой стороной другого объекта
+            // DONE 3, 4 метрика отличия двух сторон - медиана попиксельных разниц, см. SideMatcher::compare
+            // пары сторон сравниваются параллельно, а лучшие сопоставления выбираются в том же порядке что и раньше
+            // (objA, sideA, objB, sideB), поэтому ответ не зависит от числа потоков
+            std::cout << "matching sides with each other" << std::endl;
+            // false - каждый график пары сторон отдельным файлом (side0/diff=..._with_object1_side2.png),
+            // true - все графики одной стороны складываются в одну картинку-атлас side0_matches.png (сверху - лучшие),
+            // рядом side0_matches.txt с перечнем: y высота отличие объект сторона; предпросмотры кусочков в атласе уменьшены
+            // в matching_plots_atlas_preview_scale раз, а копия кусочка с отмеченной стороной рисуется один раз на сторону
+            const bool matching_plots_atlas = false;
+            const int matching_plots_atlas_preview_scale = 2;
+            // кусочек с отмеченной стороной рисуется один раз на сторону (нулевой уровень его пирамиды), а его уменьшенные
+            // предпросмотры - один раз на (кусочек, сторона, размер) из самого грубого уровня пирамиды, который не меньше
+            // предпросмотра: графики пар только складываются из готовых картинок, а полный размер не размывается заново;
+            // если предпросмотры и уровни пирамид заняли больше matching_previews_cache_mb мегабайт - кэш очищается и заполняется заново
+            const int matching_previews_cache_mb = 256;
+            // [obj][side] - пирамида кусочка с отмеченной стороной
+            std::vector<std::vector<std::unique_ptr<pyramid8u>>> marked_sides(objects_count);
+            auto markedSide = [&](int obj, int side) -> pyramid8u & {
+                if (marked_sides[obj].empty()) marked_sides[obj].resize(objSides[obj].size());
+                std::unique_ptr<pyramid8u> &marked = marked_sides[obj][side];
+                if (!marked) {
+                    image8u image_with_side = objImages[obj];
+                    drawPoints(image_with_side, objSides[obj][side], color8u(255, 0, 0), 5);
+                    marked = std::make_unique<pyramid8u>(std::move(image_with_side));
+                }
+                return *marked;
+            };
+            std::map<std::tuple<int, int, int, int>, image8u> side_previews; // (obj, side, width, height) -> предпросмотр
+            std::size_t side_previews_bytes = 0;
+            auto sidePreview = [&](int obj, int side, int width, int height) -> const image8u & {
+                const auto key = std::make_tuple(obj, side, width, height);
+                auto it = side_previews.find(key);
+                if (it != side_previews.end()) return it->second;
+                const std::size_t bytes = static_cast<std::size_t>(width) * height * 3;
+                if (side_previews_bytes + bytes > (std::size_t(matching_previews_cache_mb) << 20)) {
+                    side_previews.clear();
+                    for (std::vector<std::unique_ptr<pyramid8u>> &pyramids: marked_sides) {
+                        for (std::unique_ptr<pyramid8u> &pyramid: pyramids) if (pyramid) pyramid->evictAll();
+                    }
+                    side_previews_bytes = 0;
+                }
+                pyramid8u &marked = markedSide(obj, side);
+                int level = 0;
+                while (level + 1 < marked.levels() && marked.levelWidth(level + 1) >= width && marked.levelHeight(level + 1) >= height) ++level;
+                const std::size_t cached_bytes = marked.memoryBytes();
+                const image8u &source = marked.level(level);
+                side_previews_bytes += bytes + (marked.memoryBytes() - cached_bytes);
+                return side_previews.emplace(key, resample(source, width, height, source.width() / width)).first->second;
+            };
+            int atlas_objA = -1, atlas_sideA = -1;
+            std::vector<MatchPlot> atlas_plots;
+            auto flushMatchPlotsAtlas = [&]() {
+                if (atlas_plots.empty()) return;
+                const std::string atlas_path = debug_dir + "objects/object" + std::to_string(atlas_objA) + "/side" + std::to_string(atlas_sideA) + "_matches";
+                std::string index;
+                image8u atlas = stackMatchPlots(std::move(atlas_plots), index);
+                debug_io::dump_image(atlas_path + ".png", std::move(atlas), SavePreset::Fast);
+                std::ofstream(atlas_path + ".txt") << index;
+                atlas_plots.clear();
+            };
+
+            SideMatcher::Visitor drawMatchingPlot;
+            if (draw_sides_matching_plots) {
+                drawMatchingPlot = [&](const SideComparison &pair) {
+                    const int n = pair.a.size();
+                    const std::vector<color8u> &a = pair.a;
+                    const std::vector<color8u> &b = pair.b;
+                    const float total_difference = pair.difference;
+                    const int objA = pair.objA, sideA = pair.sideA, objB = pair.objB, sideB = pair.sideB;
+                    std::string obj_debug_dir = debug_dir + "objects/object" + std::to_string(objA) + "/";
+
+                    // сделаем небольшой предпросмотр обоих объектов с отмеченными сторонами
+                    int preview_image_width = n;
+                    int preview_image_height = n;
+                    if (matching_plots_atlas) {
+                        preview_image_width = std::max(1, n / matching_plots_atlas_preview_scale);
+                        preview_image_height = preview_image_width;
+                    }
+
+                    int colors_rgb_line_height = 10;
+                    int separator_line_height = 3;
+                    int graph_height = 100;
+                    // визуализируем наложение этих двух сторон
+                    image8u ab_visualization(preview_image_width + n, std::max(2 * preview_image_height,  2 * colors_rgb_line_height + 4 * separator_line_height + 2 * graph_height + graph_height), 3);
+
+                    // сначала нарисуем объект A + на нем отмеченная сторона A (готовый предпросмотр из кэша)
+                    point2i offset = {0, 0}; // это точка отступа - где находится угол следующего рисуемого объекта
+                    drawImage(ab_visualization, sidePreview(objA, sideA, preview_image_width, preview_image_height), offset);
+                    offset.y += preview_image_height; // смещаем отступ на высоту нарисованной картинки
+
+                    // затем объект B + на нем отмеченная сторона B
+                    drawImage(ab_visualization, sidePreview(objB, sideB, preview_image_width, preview_image_height), offset);
+                    offset.y += preview_image_height;
+
+                    // графики рисуем в правой части картинки
+                    offset = {preview_image_width, 0};
+
+                    // сначала наложим сами цвета обеих сторон
+                    drawRGBLine(ab_visualization, a, offset, colors_rgb_line_height);
+                    offset.y += colors_rgb_line_height;
+                    drawRGBLine(ab_visualization, b, offset, colors_rgb_line_height);
+                    offset.y += colors_rgb_line_height;
+
+                    std::vector<color8u> separator_line_colors(n, color8u(0, 255, 0));
+
+                    // затем построим графики яркости этих сторон - красным цветом график яркости RED канала, зеленым и синим - GREEN/BLUE соответственно
+                    drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
+                    offset.y += separator_line_height;
+                    drawGraph(ab_visualization, a, offset, graph_height);
+                    offset.y += graph_height;
+                    drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
+                    offset.y += separator_line_height;
+                    drawGraph(ab_visualization, b, offset, graph_height);
+                    offset.y += graph_height;
+                    drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
+                    offset.y += separator_line_height;
+
+                    // затем визуализируем графиком нашу метрику отличия
+                    float normalization_value = 100.0f; // график имеет шкалу от 0 до normalization_value
+                    std::vector<float> differences_graph(pair.differences.begin(), pair.differences.end());
+                    drawGraph(ab_visualization, differences_graph, offset, graph_height, normalization_value);
+                    offset.y += graph_height;
+                    drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
+                    offset.y += separator_line_height;
+
+                    if (matching_plots_atlas) {
+                        // графики приходят подряд по сторонам A, атлас стороны пишется, как только пошла следующая сторона
+                        if (objA != atlas_objA || sideA != atlas_sideA) {
+                            flushMatchPlotsAtlas();
+                            atlas_objA = objA;
+                            atlas_sideA = sideA;
+                        }
+                        atlas_plots.push_back(MatchPlot{objB, sideB, total_difference, std::move(ab_visualization)});
+                        return;
+                    }
+
+                    // заметьте что мы специально в начале файла пишем diff (еще и дополненный нулями)
+                    // благодаря этому мы прямо в списке файлов будем видеть лучшее и худшее сопоставление
+                    debug_io::dump_image(obj_debug_dir + "side" + std::to_string(sideA)
+                        + "/diff=" + pad(total_difference, 5) + "_with_object" + std::to_string(objB) + "_side" + std::to_string(sideB) + ".png",
+                        std::move(ab_visualization));
+                };
+            }
             // в этом векторе мы будем хранить сопоставления:
             // MatchedSide.objB - индекс сопоставленного объекта-кусочка пазла
             // MatchedSide.sideB - индекс сопоставленной стороны сопоставленного кусочка
             // MatchedSide.differenceBest - насколько отличаются цвета (по нашей метрике, 0 - совпадают идеально)
             // MatchedSide.differenceSecondBest - насколько отличаются цвета со второй по лучшевизне сопоставленной стороной
             //        (нужно для анализа "насколько наша метрика уверенно отличила правильный ответ от ложного")
+            // MatchedSide.candidates - несколько лучших кандидатов (по возрастанию отличия), по ним сборка разрешает
+            //        несимметричные сопоставления (A выбрала B, а B выбрала кого-то другого)
             // если сопоставления не нашлось: -1 -1 -1
-            std::vector<std::vector<MatchedSide>> objMatchedSides(objects_count);
-
-            // теперь будем сопоставлять каждую сторону объекта с каждой другой стороной другого объекта
-            std::cout << "matching sides with each other" << std::endl;
-            // перебираем объект А и его сторону для которой мы будем искать сопоставление
-            for (int objA = 0; objA < objects_count; ++objA) {
-                std::string obj_debug_dir = debug_dir + "objects/object" + std::to_string(objA) + "/";
-                objMatchedSides[objA].resize(objSides[objA].size());
-                rassert(objMatchedSides[objA][0].differenceBest == -1, 23423431);
-                for (int sideA = 0; sideA < objSides[objA].size(); ++sideA) {
-                    // мы знаем из каких пикселей брать цвета для этих точек
-                    const std::vector<point2i> pixelsA = objSides[objA][sideA];
-                    // извлекаем цвета пикселей из картинки объекта A
-                    const std::vector<color8u> colorsA = extractColors(objImages[objA], pixelsA);
-                    const int channels = objImages[objA].channels();
-
-                    if (isMostlyWhite(colorsA)) {
-                        // пропускаем стороны которые почти полностью белые - это край всего изображения
-                        // ждя них нет соседних кусочков паззла, значит не нужно их сопоставлять (в результате сопоставляя с кем-то случайным)
-                        continue;
-                    }
-
-                    // перебираем другой объект B и его сторону с которой мы хотим попробовать себя сравнить
-                    for (int objB = 0; objB < objects_count; ++objB) {
-                        if (objA == objB)
-                            continue;
-                        for (int sideB = 0; sideB < objSides[objB].size(); ++sideB) {
-                            // мы знаем из каких пикселей брать цвета для точек второй стороны B
-                            std::vector<point2i> pixelsB = objSides[objB][sideB];
-                            // разворачиваем пиксели стороны в обратном порядке, ведь мы хотим как zip-молнию
-                            // сравнить их пиксель за пикселем, каждый из этих списков пикселей стороны - по часовой стрелке
-                            // значит они как борящиеся друг против друга шестеренки трутся и расходятся в противоположных направлениях
-                            // поэтому нужно их сориентировать инвертировав порядок одного из них
-                            std::reverse(pixelsB.begin(), pixelsB.end()); // да, эту строку нужно раскомментировать
-                            // извлекаем цвета пикселей из картинки объекта A
-                            const std::vector<color8u> colorsB = extractColors(objImages[objB], pixelsB);
-                            rassert(channels == objImages[objB].channels(), 34712839741231);
-
-                            if (isMostlyWhite(colorsB)) {
-                                // пропускаем стороны которые почти полностью белые - это край всего изображения
-                                // ждя них нет соседних кусочков паззла, значит не нужно их сопоставлять (в результате сопоставляя с кем-то случайным)
-                                continue;
-                            }
-
-                            // чтобы удобно было сравнивать - нужно чтобы эти две стороны были выравнены по длине
-                            int n = std::min(colorsA.size(), colorsB.size());
-                            // DONE 2 посмотрите на графики и подумайте, может имеет смысл как-то воздействовать на снятые с границы цвета?
-                            // например сгладить? если решите попробовать - воспользуйтесь готовой функцией blur(std::vector<color8u> colors, float strength)
-                            float blur_strength = 4.0f;
-                            std::vector<color8u> a = downsample(blur(colorsA, blur_strength), n);
-                            std::vector<color8u> b = downsample(blur(colorsB, blur_strength), n);
-                            rassert(a.size() == n && b.size() == n, 2378192321);
-
-                            // теперь давайте в каждой паре пикселей оценим насколько сильно они отличаются
-                            std::vector<float> differences(n);
-                            for (int i = 0; i < n; ++i) {
-                                float d = 0;
-                                color8u colA = a[i];
-                                color8u colB = b[i];
-                                // DONE 3 реализуйте какую-то метрику сравнивающую насколько эти два цвета colA и colB отличаются
-                                for (int c = 0; c < channels; ++c) {
-                                    uint8_t colAChannelIntensity = colA(c);
-                                    uint8_t colBChannelIntensity = colB(c);
-                                    d += std::abs((int) colAChannelIntensity - colBChannelIntensity);
-                                }
-                                differences[i] = d;
-                            }
-                            for (int i = 0; i < n; ++i) {
-                                rassert(differences[i] >= 0.0f, 32423415214, differences[i]);
-                            }
-
-                            // DONE 4 и наконец финальный вердикт - насколько сильно отличаются эти две стороны? например это может быть медиана попиксельных разниц
-                            // (не забудьте про stats::median, stats:sum, stats::percentile)
-                            float total_difference = stats::median(differences); // это совсем простой вариант чтобы код просто компилировался - тут мы берем разницу первого попавшегося одного пикселя
-
-                            float previous_best = objMatchedSides[objA][sideA].differenceBest;
-                            if (previous_best == -1 || total_difference <= previous_best) {
-                                // если раньше сопоставления еще не было вовсе (-1)
-                                // если если наше сопоставление лучше (наша разница меньше старой)
-                                // то сохраняем текущее сопоставление как пока что лучший ответ (старый ответ становится вторым по лучшевизне)
-                                objMatchedSides[objA][sideA] = {objB, sideB, total_difference, previous_best};
-                            }
-
-                            if (draw_sides_matching_plots) {
-                                // сделаем небольшой предпросмотр обоих объектов с отмеченными сторонами
-                                int preview_image_width = n;
-                                int preview_image_height = n;
-
-                                int colors_rgb_line_height = 10;
-                                int separator_line_height = 3;
-                                int graph_height = 100;
-                                // визуализируем наложение этих двух сторон
-                                image8u ab_visualization(n + n, std::max(2 * preview_image_height,  2 * colors_rgb_line_height + 4 * separator_line_height + 2 * graph_height + graph_height), 3);
-
-                                // сначала нарисуем объект A + на нем отмеченная сторона A
-                                point2i offset = {0, 0}; // это точка отступа - где находится угол следующего рисуемого объекта
-                                image8u previewA = objImages[objA];
-                                drawPoints(previewA, objSides[objA][sideA], color8u(255, 0, 0), 5);
-                                previewA = downsample(blur(previewA, previewA.width() / preview_image_width), preview_image_width, preview_image_height);
-                                drawImage(ab_visualization, previewA, offset);
-                                offset.y += preview_image_height; // смещаем отступ на высоту нарисованной картинки
-
-                                // затем объект B + на нем отмеченная сторона B
-                                image8u previewB = objImages[objB];
-                                drawPoints(previewB, objSides[objB][sideB], color8u(255, 0, 0), 5);
-                                previewB = downsample(blur(previewB, previewB.width() / preview_image_width), preview_image_width, preview_image_height);
-                                drawImage(ab_visualization, previewB, offset);
-                                offset.y += preview_image_height;
-
-                                // графики рисуем в правой части картинки
-                                offset = {preview_image_width, 0};
-
-                                // сначала наложим сами цвета обеих сторон
-                                drawRGBLine(ab_visualization, a, offset, colors_rgb_line_height);
-                                offset.y += colors_rgb_line_height;
-                                drawRGBLine(ab_visualization, b, offset, colors_rgb_line_height);
-                                offset.y += colors_rgb_line_height;
-
-                                std::vector<color8u> separator_line_colors(n, color8u(0, 255, 0));
-
-                                // затем построим графики яркости этих сторон - красным цветом график яркости RED канала, зеленым и синим - GREEN/BLUE соответственно
-                                drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
-                                offset.y += separator_line_height;
-                                drawGraph(ab_visualization, a, offset, graph_height);
-                                offset.y += graph_height;
-                                drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
-                                offset.y += separator_line_height;
-                                drawGraph(ab_visualization, b, offset, graph_height);
-                                offset.y += graph_height;
-                                drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
-                                offset.y += separator_line_height;
-
-                                // затем визуализируем графиком нашу метрику отличия
-                                float normalization_value = 100.0f; // график имеет шкалу от 0 до normalization_value
-                                drawGraph(ab_visualization, differences, offset, graph_height, normalization_value);
-                                offset.y += graph_height;
-                                drawRGBLine(ab_visualization, separator_line_colors, offset, separator_line_height);
-                                offset.y += separator_line_height;
-
-                                // заметьте что мы специально в начале файла пишем diff (еще и дополненный нулями)
-                                // благодаря этому мы прямо в списке файлов будем видеть лучшее и худшее сопоставление
-                                debug_io::dump_image(obj_debug_dir + "side" + std::to_string(sideA)
-                                    + "/diff=" + pad(total_difference, 5) + "_with_object" + std::to_string(objB) + "_side" + std::to_string(sideB) + ".png",
-                                    ab_visualization);
-                            }
-                        }
-                    }
+            // полная матрица отличий всех пар сторон сохраняется на диск (рядом с папкой картинки, т.к. та удаляется на каждом запуске),
+            // если меняются только параметры сборки - можно загрузить ее вместо повторного сопоставления (графики тогда не рисуются)
+            const std::string side_costs_path = "debug/" + image_name + "_side_costs.bin";
+            const bool reuse_side_costs = false;
+            const int side_costs_candidates = 8; // сколько лучших кандидатов на каждую сторону записать в файл (для скриптов подбора параметров)
+            SideCosts side_costs;
+            bool side_costs_loaded = false;
+            if (reuse_side_costs && std::filesystem::exists(side_costs_path)) {
+                side_costs = loadSideCosts(side_costs_path);
+                // файл мог остаться от другого разбиения на кусочки и стороны
+                side_costs_loaded = side_costs.objects() == objects_count;
+                for (int obj = 0; side_costs_loaded && obj < objects_count; ++obj) {
+                    side_costs_loaded = side_costs.firstSide[obj + 1] - side_costs.firstSide[obj] == objSides[obj].size();
+                }
+            }
+            // если пазл фотографируют несколькими партиями: кусочки добавляются в сессию столькими партиями,
+            // и каждая партия сравнивается только с уже добавленными кусочками (ответ тот же, но графики не рисуются)
+            const int incremental_batches = 1;
+            std::vector<std::vector<MatchedSide>> objMatchedSides;
+            if (side_costs_loaded) {
+                std::cout << "side costs loaded from " << side_costs_path << std::endl;
+                objMatchedSides = side_costs.matchedSides();
+            } else if (incremental_batches > 1) {
+                AssemblySession session(channels, solver.options().matcher);
+                for (int batch = 0; batch < incremental_batches; ++batch) {
+                    const int from = objects_count * batch / incremental_batches;
+                    const int to = objects_count * (batch + 1) / incremental_batches;
+                    SideMatcherStats batch_stats;
+                    session.addPieces({objSideDescriptors.begin() + from, objSideDescriptors.begin() + to},
+                                      {objImages.begin() + from, objImages.begin() + to},
+                                      {objMasks.begin() + from, objMasks.begin() + to},
+                                      {objCorners.begin() + from, objCorners.begin() + to}, with_openmp, &batch_stats);
+                    std::cout << "batch " << batch << ": +" << (to - from) << " pieces, compared " << batch_stats.comparedPairs
+                              << " pairs of sides" << std::endl;
                 }
+                objMatchedSides = session.matchedSides();
+                side_costs = session.costs();
+                saveSideCosts(side_costs_path, side_costs, side_costs_candidates);
+            } else {
+                SideMatcherStats matcher_stats;
+                objMatchedSides = solver.match(pieces, objSideDescriptors, drawMatchingPlot, &matcher_stats, &side_costs);
+                flushMatchPlotsAtlas();
+                if (matcher_stats.comparedPairs < matcher_stats.pairs) {
+                    std::cout << "compared in full only " << matcher_stats.comparedPairs << "/" << matcher_stats.pairs << " pairs of sides ("
+                              << matcher_stats.geometryRejectedPairs << " rejected by shape)" << std::endl;
+                }
+                saveSideCosts(side_costs_path, side_costs, side_costs_candidates);
             }
 
             std::unordered_map<std::string, std::vector<std::vector<MatchedSide>>> correct_matches;
@@ -388,8 +713,13 @@ int main() {
 
             {
                 // нарисуем отрезками сопоставления между сторонами
+                // картинка нужна только для отладки, сами сопоставления печатаются в лог всегда;
+                // сама фотография дальше не нужна (у кусочков свои картинки), поэтому рисуем прямо на ней, без копии
+                // (забираем ее из пирамиды, image дальше не используется)
+                const bool draw_matched_sides = debug_io::enabled(debug_io::Category::Matching);
                 int segment_thickness = 5;
-                image8u segments_between_matched_sides = image;
+                image8u segments_between_matched_sides;
+                if (draw_matched_sides) segments_between_matched_sides = photo.release();
                 FastRandom r(2391);
                 int correct_matches_count = 0;
                 int incorrect_matches_count = 0;
@@ -398,10 +728,10 @@ int main() {
                     color8u random_color_for_object = {(uint8_t) r.nextInt(0, 255), (uint8_t) r.nextInt(0, 255), (uint8_t) r.nextInt(0, 255)};
                     point2i random_shift = {r.nextInt(-segment_thickness, segment_thickness), r.nextInt(-segment_thickness, segment_thickness)}; // это нужно чтобы встречные ребра не наслоились закрыв друг друга, а было легко видеть что это два ребра
                     for (int sideA = 0; sideA < objSides[objA].size(); ++sideA) {
-                        auto [objB, sideB, differenceBest, differenceSecondBest] = objMatchedSides[objA][sideA];
+                        auto [objB, sideB, differenceBest, differenceSecondBest, candidates] = objMatchedSides[objA][sideA];
 
                         if (correct_matches.count(image_name)) {
-                            auto [expectedObjB, expectedSideB, _, __] = correct_matches[image_name][objA][sideA];
+                            auto [expectedObjB, expectedSideB, _, __, ___] = correct_matches[image_name][objA][sideA];
                             if (expectedObjB == objB && expectedSideB == sideB) {
                                 correct_matches_count++;
                             } else {
@@ -420,21 +750,25 @@ int main() {
                         std::cout << "obj" << objA << "-side" <<sideA << " -> obj" << objB << "-side" << sideB << " with difference=" << differenceBest << " (second best: " << differenceSecondBest << ")" << std::endl;
                         point2i sideACenter = objOffsets[objA] + objSides[objA][sideA][objSides[objA][sideA].size() / 2]; // вершина в середине стороны A
                         point2i sideBCenter = objOffsets[objB] + objSides[objB][sideB][objSides[objB][sideB].size() / 2]; // вершина в середине сопоставленной с ней стороны B
-                        drawPoint(segments_between_matched_sides, random_shift + sideACenter, random_color_for_object, 4 * segment_thickness);
-                        drawSegment(segments_between_matched_sides, random_shift + sideACenter, random_shift + sideBCenter, random_color_for_object, segment_thickness);
+                        if (draw_matched_sides) {
+                            drawPoint(segments_between_matched_sides, random_shift + sideACenter, random_color_for_object, 4 * segment_thickness);
+                            drawSegment(segments_between_matched_sides, random_shift + sideACenter, random_shift + sideBCenter, random_color_for_object, segment_thickness);
+                        }
                     }
                 }
                 if (correct_matches.count(image_name)) {
                     std::cout << "correct matches: " << correct_matches_count << std::endl;
                     std::cout << "incorrect matches: " << incorrect_matches_count << std::endl;
                 }
-                debug_io::dump_image(debug_dir + "08_matched_sides.jpg", segments_between_matched_sides);
+                if (draw_matched_sides) {
+                    debug_io::dump_image(debug_dir + "08_matched_sides.jpg", std::move(segments_between_matched_sides));
+                }
             }
 
             // Занятие 7
             // Итак у нас есть:
             // 1) objOffsets, objImages, objMasks - извлеченные изображения объектов-кусочков (с маской и смещением указывающим на позицию в целой картинке)
-            // 2) objSides[obj][side] - vector<point2i> - координаты пикселей стороны side объекта obj (в его извлеченном изображении)
+            // 2) objSides[obj][side] - span<const point2i> - координаты пикселей стороны side объекта obj (в его извлеченном изображении)
             // 3) objMatchedSides[objA][sideA] = {objB, sideB, ...}; - информация о том с каким (objB, sideB) нас сопоставило, или (-1, -1) если мы являемся белым краем
 
             // План:
@@ -450,16 +784,42 @@ int main() {
             //    пока что в коде сделано наивно - везде ширина и толщина берется за 200 пикселей
             // 10) Найдем для каждого кусочка матрицу описывающую переход из его изображения в общий холст
             // 11) Спроецируем все кусочки этой матрицей
-            PuzzleAssemblyResult assembled = assemblePuzzle(objImages, objMasks, objCorners, objMatchedSides);
+            // какие картинки собранного пазла рисовать (AssemblyOutputGridOnly - только раскладка, например для пакетной обработки)
+            const unsigned assembly_outputs = debug_io::enabled(debug_io::Category::Assembly) ? AssemblyOutputAll : AssemblyOutputGridOnly;
+            // для очень больших пазлов: холст рисуется полосами по stream_band_rows строк сразу в PNG, целиком в памяти не хранится
+            const bool stream_assembled_output = false;
+            const int stream_band_rows = 256;
+            PuzzleAssemblyResult assembled = solver.assemble(pieces, objMatchedSides,
+                                                             stream_assembled_output ? AssemblyOutputGridOnly : assembly_outputs);
 
             printGrid(std::cout, assembled);
 
-            debug_io::dump_image(debug_dir + "09_assembled_with_lines.png", assembled.assembledWithLines);
-            debug_io::dump_image(debug_dir + "10_assembled.png", assembled.assembled);
+            if (stream_assembled_output) {
+                if (assembly_outputs & AssemblyOutputCanvasWithLines) {
+                    saveAssembledStreaming(debug_dir + "09_assembled_with_lines.png", assembled, objImages, objMasks, objCorners, true, stream_band_rows);
+                }
+                if (assembly_outputs & AssemblyOutputCanvas) {
+                    saveAssembledStreaming(debug_dir + "10_assembled.png", assembled, objImages, objMasks, objCorners, false, stream_band_rows);
+                }
+            } else {
+                if (assembly_outputs & AssemblyOutputCanvasWithLines) {
+                    debug_io::dump_image(debug_dir + "09_assembled_with_lines.png", assembled.assembledWithLines);
+                }
+                if (assembly_outputs & AssemblyOutputCanvas) {
+                    debug_io::dump_image(debug_dir + "10_assembled.png", assembled.assembled);
+                }
+            }
 
             std::cout << "image " << image_name << " processed in " << total_t.elapsed() << " sec" << std::endl;
         }
+        if (async_dumps) async_dumps->flush();
         std::cout << "all images processed in " << all_images_t.elapsed() << " sec" << std::endl;
+        if (profile_zones) {
+            profiler::setEnabled(false);
+            std::cout << profiler::summary();
+            std::cout << memory::summary();
+            profiler::writeChromeTrace("debug/profile_trace.json");
+        }
 
         return 0;
     } catch (const std::exception &e) {
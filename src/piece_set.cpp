@@ -0,0 +1,357 @@
+#include "piece_set.h"
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'V', 'P', 'P', 'I', 'E', 'C', 'E'};
+constexpr std::uint64_t kPixelsAlignment = 64;
+constexpr std::uint64_t kArrayAlignment = 8;
+
+std::uint64_t alignUp(std::uint64_t offset, std::uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static_assert(sizeof(point2i) == 2 * sizeof(std::int32_t) && std::is_trivially_copyable_v<point2i>);
+static_assert(sizeof(RunLengthMask::Run) == 3 * sizeof(std::int32_t) && std::is_trivially_copyable_v<RunLengthMask::Run>);
+
+} // namespace
+
+struct PieceSet::Header final {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t pieces;
+    std::uint32_t photos;
+    std::uint32_t channels;
+    std::uint64_t fileBytes;
+    std::uint64_t recordsOffset;
+    std::uint8_t reserved[24];
+};
+
+// 8-byte fields first, so that the layout has no padding
+struct PieceSet::PieceRecord final {
+    std::uint64_t pixelsOffset;  // height rows of width * channels bytes
+    std::uint64_t runsOffset;    // RunLengthMask::Run[runs], the mask is width x height
+    std::uint64_t cornersOffset; // point2i[corners]
+    std::uint64_t codesOffset;   // ChainContour::codes() of contourSize points
+    std::uint64_t sidesOffset;   // SideRecord[sides]
+    std::int32_t photo;
+    std::int32_t offsetX, offsetY;
+    std::int32_t width, height, channels;
+    std::int32_t runs;
+    std::int32_t corners;
+    std::int32_t contourSize;
+    std::int32_t contourX, contourY; // the first point
+    std::int32_t sides;
+};
+
+struct PieceSet::SideRecord final {
+    std::uint64_t packedOffset; // SideDescriptor::packed
+    std::uint32_t packedBytes;
+    std::int32_t samples;
+    std::int32_t channels;
+    float profileBlurStrength;
+    float arcLength, chordLength, bulge;
+    std::uint32_t mostlyWhite;
+};
+
+namespace {
+
+std::uint64_t codeWords(int contourSize) {
+    return contourSize <= 1 ? 0 : static_cast<std::uint64_t>((contourSize - 1 + ChainContour::steps_per_word - 1) / ChainContour::steps_per_word);
+}
+
+// What goes into the file after the records of the pieces, in this order: the first pass of PieceSet::write
+// computes the offsets of the records, the second one writes the bytes at them
+struct PieceData final {
+    const image8u *image = nullptr;
+    RunLengthMask mask;
+    ChainContour contour;
+    const std::vector<point2i> *corners = nullptr;
+    const std::vector<SideDescriptor> *sides = nullptr;
+};
+
+} // namespace
+
+void PieceSet::write(const std::string &path, const std::vector<PieceSetPhoto> &photos) {
+    std::vector<PieceRecord> records;
+    std::vector<PieceData> data;
+    int channels = 0;
+    for (std::size_t photo = 0; photo < photos.size(); ++photo) {
+        const PuzzlePieces &pieces = photos[photo].pieces;
+        const PuzzleSideDescriptors &descriptors = photos[photo].descriptors;
+        rassert(descriptors.empty() || static_cast<int>(descriptors.size()) == pieces.count(), 91000001, descriptors.size(), pieces.count());
+        if (pieces.count() > 0) {
+            rassert(channels == 0 || pieces.channels() == channels, 91000002, pieces.channels(), channels);
+            channels = pieces.channels();
+        }
+        for (int obj = 0; obj < pieces.count(); ++obj) {
+            const image8u &image = pieces.images[obj];
+            rassert(pieces.masks[obj].width() == image.width() && pieces.masks[obj].height() == image.height(), 91000003, obj);
+
+            PieceData d;
+            d.image = &image;
+            d.mask = RunLengthMask::fromImage(pieces.masks[obj]);
+            d.contour = ChainContour(pieces.contours[obj]);
+            d.corners = &pieces.corners[obj];
+            d.sides = descriptors.empty() ? nullptr : &descriptors[obj];
+
+            PieceRecord r{};
+            r.photo = static_cast<std::int32_t>(photo);
+            r.offsetX = pieces.offsets[obj].x;
+            r.offsetY = pieces.offsets[obj].y;
+            r.width = image.width();
+            r.height = image.height();
+            r.channels = image.channels();
+            r.runs = static_cast<std::int32_t>(d.mask.runs().size());
+            r.corners = static_cast<std::int32_t>(d.corners->size());
+            r.contourSize = d.contour.size();
+            const point2i first = d.contour.empty() ? point2i() : d.contour.at(0);
+            r.contourX = first.x;
+            r.contourY = first.y;
+            r.sides = d.sides ? static_cast<std::int32_t>(d.sides->size()) : 0;
+            records.push_back(r);
+            data.push_back(std::move(d));
+        }
+    }
+
+    // Layout
+    std::uint64_t cursor = alignUp(sizeof(Header) + records.size() * sizeof(PieceRecord), kPixelsAlignment);
+    auto place = [&](std::uint64_t bytes, std::uint64_t alignment) {
+        cursor = alignUp(cursor, alignment);
+        const std::uint64_t offset = cursor;
+        cursor += bytes;
+        return offset;
+    };
+    std::vector<std::vector<SideRecord>> sideRecords(records.size());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        PieceRecord &r = records[i];
+        r.pixelsOffset = place(static_cast<std::uint64_t>(r.width) * r.height * r.channels, kPixelsAlignment);
+        r.runsOffset = place(r.runs * sizeof(RunLengthMask::Run), kArrayAlignment);
+        r.cornersOffset = place(r.corners * sizeof(point2i), kArrayAlignment);
+        r.codesOffset = place(codeWords(r.contourSize) * sizeof(std::uint64_t), kArrayAlignment);
+        r.sidesOffset = place(r.sides * sizeof(SideRecord), kArrayAlignment);
+        for (int side = 0; side < r.sides; ++side) {
+            const SideDescriptor &d = (*data[i].sides)[side];
+            SideRecord s{};
+            s.packedBytes = static_cast<std::uint32_t>(d.packed.size());
+            s.packedOffset = place(d.packed.size(), kArrayAlignment);
+            s.samples = d.samples;
+            s.channels = d.channels;
+            s.profileBlurStrength = d.profileBlurStrength;
+            s.arcLength = d.signature.arcLength;
+            s.chordLength = d.signature.chordLength;
+            s.bulge = d.signature.bulge;
+            s.mostlyWhite = d.mostlyWhite ? 1 : 0;
+            sideRecords[i].push_back(s);
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kPieceSetVersion;
+    header.pieces = static_cast<std::uint32_t>(records.size());
+    header.photos = static_cast<std::uint32_t>(photos.size());
+    header.channels = static_cast<std::uint32_t>(channels);
+    header.fileBytes = cursor;
+    header.recordsOffset = sizeof(Header);
+
+    std::filesystem::create_directories(std::filesystem::absolute(path).parent_path());
+    const std::string tmp = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        rassert(out.is_open(), 91000004, tmp);
+        std::uint64_t written = 0;
+        auto write = [&](const void *bytes, std::uint64_t n) {
+            out.write(static_cast<const char *>(bytes), static_cast<std::streamsize>(n));
+            written += n;
+        };
+        auto writeAt = [&](std::uint64_t offset, const void *bytes, std::uint64_t n) {
+            static const char zeros[kPixelsAlignment] = {};
+            rassert(offset >= written, 91000005, offset, written);
+            while (written < offset) write(zeros, std::min<std::uint64_t>(offset - written, sizeof(zeros)));
+            write(bytes, n);
+        };
+
+        write(&header, sizeof(header));
+        write(records.data(), records.size() * sizeof(PieceRecord));
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const PieceRecord &r = records[i];
+            const PieceData &d = data[i];
+            const std::uint64_t rowBytes = static_cast<std::uint64_t>(r.width) * r.channels;
+            for (int y = 0; y < r.height; ++y) writeAt(r.pixelsOffset + y * rowBytes, d.image->ptr(y), rowBytes);
+            writeAt(r.runsOffset, d.mask.runs().data(), d.mask.runs().size_bytes());
+            writeAt(r.cornersOffset, d.corners->data(), d.corners->size() * sizeof(point2i));
+            writeAt(r.codesOffset, d.contour.codes().data(), d.contour.codes().size_bytes());
+            writeAt(r.sidesOffset, sideRecords[i].data(), sideRecords[i].size() * sizeof(SideRecord));
+            for (int side = 0; side < r.sides; ++side) {
+                writeAt(sideRecords[i][side].packedOffset, (*d.sides)[side].packed.data(), sideRecords[i][side].packedBytes);
+            }
+        }
+        writeAt(header.fileBytes, nullptr, 0);
+        rassert(out.good(), 91000006, tmp);
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+template <typename T>
+const T *PieceSet::at(std::uint64_t offset) const {
+    return reinterpret_cast<const T *>(file_.bytes().data() + offset);
+}
+
+PieceSet::PieceSet(const std::string &path) : file_(path) {
+    static_assert(sizeof(Header) == 64 && sizeof(PieceRecord) == 5 * 8 + 12 * 4 && sizeof(SideRecord) == 40);
+    const std::uint64_t size = file_.size();
+    rassert(size >= sizeof(Header), 91000007, "Not a piece set", path, size);
+    header_ = at<Header>(0);
+    rassert(std::memcmp(header_->magic, kMagic, sizeof(kMagic)) == 0, 91000008, "Not a piece set", path);
+    rassert(header_->version == kPieceSetVersion, 91000009, "Piece set of another version", path, header_->version, kPieceSetVersion);
+    rassert(header_->fileBytes == size, 91000010, "Truncated piece set", path, header_->fileBytes, size);
+    rassert(header_->recordsOffset % kArrayAlignment == 0 && header_->recordsOffset <= size
+            && header_->pieces <= (size - header_->recordsOffset) / sizeof(PieceRecord), 91000011, "Corrupted piece set", path);
+    records_ = at<PieceRecord>(header_->recordsOffset);
+
+    // every array of every record is within the file and aligned for its type
+    auto inside = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t itemBytes, std::uint64_t alignment) {
+        return offset % alignment == 0 && offset <= size && count <= (size - offset) / itemBytes;
+    };
+    for (int obj = 0; obj < count(); ++obj) {
+        const PieceRecord &r = records_[obj];
+        bool ok = r.photo >= 0 && static_cast<std::uint32_t>(r.photo) < header_->photos
+                  && r.width > 0 && r.height > 0 && r.channels == static_cast<std::int32_t>(header_->channels)
+                  && r.runs >= 0 && r.corners >= 0 && r.contourSize >= 0 && r.sides >= 0
+                  && inside(r.pixelsOffset, static_cast<std::uint64_t>(r.width) * r.height, r.channels, 1)
+                  && inside(r.runsOffset, r.runs, sizeof(RunLengthMask::Run), alignof(RunLengthMask::Run))
+                  && inside(r.cornersOffset, r.corners, sizeof(point2i), alignof(point2i))
+                  && inside(r.codesOffset, codeWords(r.contourSize), sizeof(std::uint64_t), alignof(std::uint64_t))
+                  && inside(r.sidesOffset, r.sides, sizeof(SideRecord), alignof(SideRecord));
+        // corners and the start of the contour are within the crop (that corners are on the contour is checked by pieces())
+        if (ok && r.contourSize > 0) ok = r.contourX >= 0 && r.contourX < r.width && r.contourY >= 0 && r.contourY < r.height;
+        for (int corner = 0; ok && corner < r.corners; ++corner) {
+            const point2i &p = at<point2i>(r.cornersOffset)[corner];
+            ok = r.contourSize > 0 && p.x >= 0 && p.x < r.width && p.y >= 0 && p.y < r.height;
+        }
+        for (int side = 0; ok && side < r.sides; ++side) {
+            const SideRecord &s = at<SideRecord>(r.sidesOffset)[side];
+            const std::uint64_t plane = static_cast<std::uint64_t>(std::max(s.samples, 0)) * std::max(s.channels, 0);
+            ok = s.packedBytes == (s.mostlyWhite ? plane : 3 * plane) && inside(s.packedOffset, s.packedBytes, 1, 1);
+        }
+        rassert(ok, 91000012, "Corrupted piece set", path, obj);
+    }
+}
+
+int PieceSet::count() const noexcept { return static_cast<int>(header_->pieces); }
+int PieceSet::photos() const noexcept { return static_cast<int>(header_->photos); }
+int PieceSet::channels() const noexcept { return static_cast<int>(header_->channels); }
+
+const PieceSet::PieceRecord &PieceSet::record(int obj) const {
+    rassert(obj >= 0 && obj < count(), 91000013, obj, count());
+    return records_[obj];
+}
+
+int PieceSet::photo(int obj) const { return record(obj).photo; }
+
+point2i PieceSet::offset(int obj) const {
+    const PieceRecord &r = record(obj);
+    return {r.offsetX, r.offsetY};
+}
+
+image8u_cview PieceSet::image(int obj) const {
+    const PieceRecord &r = record(obj);
+    return image8u_cview(at<std::uint8_t>(r.pixelsOffset), r.width, r.height, r.channels, static_cast<std::size_t>(r.width) * r.channels);
+}
+
+std::span<const RunLengthMask::Run> PieceSet::maskRuns(int obj) const {
+    const PieceRecord &r = record(obj);
+    return {at<RunLengthMask::Run>(r.runsOffset), static_cast<std::size_t>(r.runs)};
+}
+
+std::span<const point2i> PieceSet::corners(int obj) const {
+    const PieceRecord &r = record(obj);
+    return {at<point2i>(r.cornersOffset), static_cast<std::size_t>(r.corners)};
+}
+
+int PieceSet::sides(int obj) const { return record(obj).sides; }
+
+RunLengthMask PieceSet::mask(int obj) const {
+    const PieceRecord &r = record(obj);
+    RunLengthMask mask(r.width, r.height);
+    for (const RunLengthMask::Run &run : maskRuns(obj)) mask.appendRun(run.y, run.x0, run.x1);
+    return mask;
+}
+
+ChainContour PieceSet::contour(int obj) const {
+    const PieceRecord &r = record(obj);
+    return ChainContour::fromCodes({r.contourX, r.contourY}, r.contourSize,
+                                   {at<std::uint64_t>(r.codesOffset), static_cast<std::size_t>(codeWords(r.contourSize))});
+}
+
+SideDescriptor PieceSet::descriptor(int obj, int side) const {
+    const PieceRecord &r = record(obj);
+    rassert(side >= 0 && side < r.sides, 91000014, obj, side, r.sides);
+    const SideRecord &s = at<SideRecord>(r.sidesOffset)[side];
+    SideDescriptor d;
+    const std::uint8_t *packed = at<std::uint8_t>(s.packedOffset);
+    d.packed.assign(packed, packed + s.packedBytes);
+    d.samples = s.samples;
+    d.channels = s.channels;
+    d.profileBlurStrength = s.profileBlurStrength;
+    d.mostlyWhite = s.mostlyWhite != 0;
+    d.signature.arcLength = s.arcLength;
+    d.signature.chordLength = s.chordLength;
+    d.signature.bulge = s.bulge;
+    return d;
+}
+
+PuzzlePieces PieceSet::pieces(bool with_openmp) const {
+    const int n = count();
+    PuzzlePieces res;
+    res.offsets.resize(n);
+    res.images.resize(n);
+    res.masks.resize(n);
+    res.contours.resize(n);
+    res.corners.resize(n);
+    std::vector<ChainContour> contours(n);
+    // pieces are independent, each task writes only its own items
+    parallelForEach(0, n, [&](int obj) {
+        res.offsets[obj] = offset(obj);
+        res.images[obj] = image(obj).toImage();
+        res.masks[obj] = mask(obj).toImage();
+        contours[obj] = contour(obj);
+        res.contours[obj] = contours[obj].toPoints();
+        const std::span<const point2i> c = corners(obj);
+        res.corners[obj].assign(c.begin(), c.end());
+
+        // before PieceSides::split: the contour stays within the crop and every corner is a point of it
+        const PieceRecord &r = record(obj);
+        const std::vector<point2i> &points = res.contours[obj];
+        const bool inside = std::all_of(points.begin(), points.end(), [&](const point2i &p) {
+            return p.x >= 0 && p.x < r.width && p.y >= 0 && p.y < r.height;
+        });
+        const bool onContour = std::all_of(c.begin(), c.end(), [&](const point2i &corner) {
+            return std::find(points.begin(), points.end(), corner) != points.end();
+        });
+        const bool distinct = c.empty() || std::any_of(c.begin(), c.end(), [&](const point2i &corner) { return corner != c.front(); });
+        rassert(inside && onContour && distinct, 91000015, "Corrupted piece set", obj, inside, onContour, distinct);
+    }, with_openmp);
+    res.sides = PieceSides::split(contours, res.corners, with_openmp);
+    return res;
+}
+
+PuzzleSideDescriptors PieceSet::descriptors() const {
+    PuzzleSideDescriptors res(static_cast<std::size_t>(count()));
+    for (int obj = 0; obj < count(); ++obj) {
+        res[obj].reserve(static_cast<std::size_t>(sides(obj)));
+        for (int side = 0; side < sides(obj); ++side) res[obj].push_back(descriptor(obj, side));
+    }
+    return res;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <libbase/point2.h>
+#include <libimages/chain_contour.h>
+#include <libimages/image_view.h>
+#include <libimages/mapped_file.h>
+#include <libimages/run_length_mask.h>
+
+#include "puzzle_solver.h"
+
+// Bump when the layout changes, files of other versions are not opened
+inline constexpr std::uint32_t kPieceSetVersion = 1;
+
+// One photo of a piece set: its pieces and their descriptors (empty if the sides were not described)
+struct PieceSetPhoto final {
+    const PuzzlePieces &pieces;
+    const PuzzleSideDescriptors &descriptors;
+};
+
+// A piece set file mapped into memory and used in place: fixed-size records of all pieces go first, then crops
+// (rows as they are, 64-byte aligned), mask runs, corners, chain-coded contours (see ChainContour) and packed side
+// profiles, all referenced by file offsets. Opening checks the header and the records (O(pieces)) and parses nothing,
+// processes that map the same file share its pages in the page cache.
+class PieceSet final {
+public:
+    // A file that is not a piece set of kPieceSetVersion (or is truncated, or corrupted: arrays out of the file,
+    // corners out of their crops) fails an assertion
+    explicit PieceSet(const std::string &path);
+
+    // Pieces of several photos (f.e. of one puzzle photographed in parts) into one file, numbered photo after photo.
+    // Written to a temporary file and renamed, so that readers never map a partial one.
+    static void write(const std::string &path, const std::vector<PieceSetPhoto> &photos);
+
+    int count() const noexcept;
+    int photos() const noexcept;
+    int channels() const noexcept;
+    std::size_t bytes() const noexcept { return file_.size(); }
+
+    // Of piece obj, in place
+    int photo(int obj) const;      // index of its photo in write
+    point2i offset(int obj) const; // top-left corner of the piece in its photo
+    image8u_cview image(int obj) const;
+    std::span<const RunLengthMask::Run> maskRuns(int obj) const;
+    std::span<const point2i> corners(int obj) const;
+    int sides(int obj) const;      // described sides, 0 - no descriptors
+
+    // Copies
+    RunLengthMask mask(int obj) const;
+    ChainContour contour(int obj) const;
+    SideDescriptor descriptor(int obj, int side) const;
+
+    // All pieces (sides are split from the contours and corners, see PieceSides::split) and their descriptors,
+    // the same as extractPieces and describeSides of the photos gave, pieces in parallel.
+    // A contour that leaves its crop or misses a corner (a corrupted file that opened) fails an assertion before the split.
+    PuzzlePieces pieces(bool with_openmp = true) const;
+    PuzzleSideDescriptors descriptors() const;
+
+private:
+    struct Header;
+    struct PieceRecord;
+    struct SideRecord;
+
+    const PieceRecord &record(int obj) const;
+    template <typename T>
+    const T *at(std::uint64_t offset) const;
+
+    MappedFile file_;
+    const Header *header_ = nullptr;
+    const PieceRecord *records_ = nullptr;
+};
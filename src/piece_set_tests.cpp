@@ -0,0 +1,153 @@
+#include "piece_set.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tests_utils.h"
+
+namespace {
+
+struct PhotoPieces final {
+    PuzzlePieces pieces;
+    PuzzleSideDescriptors descriptors;
+};
+
+PhotoPieces photoPieces(int rows, int cols, std::uint32_t seed) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle(rows, cols, seed);
+    const PuzzleSolver solver;
+    const PuzzleSegmentation segmentation = solver.segment(puzzle.image);
+    PhotoPieces photo;
+    photo.pieces = solver.extractPieces(puzzle.image, segmentation.mask, segmentation.roi);
+    photo.descriptors = solver.describeSides(photo.pieces, puzzle.image);
+    return photo;
+}
+
+std::string readBytes(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    return bytes.str();
+}
+
+void writeBytes(const std::string &path, const std::string &bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename T>
+T load(const std::string &bytes, std::size_t offset) {
+    T v;
+    std::memcpy(&v, bytes.data() + offset, sizeof(T));
+    return v;
+}
+
+template <typename T>
+void store(std::string &bytes, std::size_t offset, const T &v) {
+    std::memcpy(bytes.data() + offset, &v, sizeof(T));
+}
+
+// Offsets of the layout (see PieceSet::Header, PieceRecord and SideRecord)
+constexpr std::size_t kVersionAt = 8;
+constexpr std::size_t kRecordsAt = 64;
+constexpr std::size_t kRecordBytes = 88;
+constexpr std::size_t kPixelsOffsetAt = 0, kCornersOffsetAt = 16, kSidesOffsetAt = 32, kCornersAt = 68;
+constexpr std::size_t kPackedBytesAt = 8;
+
+} // namespace
+
+TEST(piece_set, openedEqualsPipeline) {
+    const std::string dir = getUnitCaseDebugDir();
+    const PhotoPieces first = photoPieces(3, 4, 239);
+    const PhotoPieces second = photoPieces(4, 5, 17);
+
+    PieceSet::write(dir + "first.pieces", {{first.pieces, first.descriptors}});
+    const PieceSet one(dir + "first.pieces");
+    EXPECT_EQ(one.photos(), 1);
+    EXPECT_EQ(one.channels(), first.pieces.channels());
+    expectSamePieces(one.pieces(), first.pieces);
+    expectSamePieces(one.pieces(false), first.pieces);
+    expectSameDescriptors(one.descriptors(), first.descriptors);
+
+    // pieces of both photos numbered photo after photo, the second one without descriptors
+    const PuzzleSideDescriptors none;
+    PieceSet::write(dir + "both.pieces", {{first.pieces, first.descriptors}, {second.pieces, none}});
+    const PieceSet both(dir + "both.pieces");
+    ASSERT_EQ(both.count(), first.pieces.count() + second.pieces.count());
+    EXPECT_EQ(both.photos(), 2);
+    for (int obj = 0; obj < both.count(); ++obj) {
+        SCOPED_TRACE("piece " + std::to_string(obj));
+        const bool isFirst = obj < first.pieces.count();
+        const PuzzlePieces &pieces = isFirst ? first.pieces : second.pieces;
+        const int local = isFirst ? obj : obj - first.pieces.count();
+        EXPECT_EQ(both.photo(obj), isFirst ? 0 : 1);
+        EXPECT_EQ(both.offset(obj), pieces.offsets[local]);
+        expectSameImages(both.image(obj).toImage(), pieces.images[local]);
+        expectSameImages(both.mask(obj).toImage(), pieces.masks[local]);
+        EXPECT_EQ(both.contour(obj).toPoints(), pieces.contours[local]);
+        EXPECT_EQ(std::vector<point2i>(both.corners(obj).begin(), both.corners(obj).end()), pieces.corners[local]);
+        EXPECT_EQ(both.sides(obj), isFirst ? static_cast<int>(first.descriptors[local].size()) : 0);
+    }
+    const PuzzleSideDescriptors descriptors = both.descriptors();
+    expectSameDescriptors(PuzzleSideDescriptors(descriptors.begin(), descriptors.begin() + first.pieces.count()), first.descriptors);
+    for (int obj = first.pieces.count(); obj < both.count(); ++obj) EXPECT_TRUE(descriptors[obj].empty());
+}
+
+TEST(piece_set, malformedFilesFailTheirAsserts) {
+    const std::string dir = getUnitCaseDebugDir();
+    const PhotoPieces photo = photoPieces(3, 4, 239);
+    const std::string path = dir + "photo.pieces";
+    PieceSet::write(path, {{photo.pieces, photo.descriptors}});
+    const std::string bytes = readBytes(path);
+    ASSERT_GT(bytes.size(), kRecordsAt + kRecordBytes);
+    ASSERT_EQ(assertionCode([&] { PieceSet set(path); }), "");
+
+    auto openError = [&](const std::string &name, const std::string &corrupted) {
+        writeBytes(dir + name, corrupted);
+        return assertionCode([&] { PieceSet set(dir + name); });
+    };
+    std::string b = bytes;
+    b[0] = 'X';
+    EXPECT_EQ(openError("magic.pieces", b), "91000008");
+    b = bytes;
+    store<std::uint32_t>(b, kVersionAt, kPieceSetVersion + 1);
+    EXPECT_EQ(openError("version.pieces", b), "91000009");
+    EXPECT_EQ(openError("header.pieces", bytes.substr(0, 20)), "91000007");
+    EXPECT_EQ(openError("truncated.pieces", bytes.substr(0, bytes.size() - 1)), "91000010");
+    EXPECT_EQ(openError("longer.pieces", bytes + "x"), "91000010");
+
+    // arrays of a record out of the file
+    const std::size_t record = kRecordsAt + 3 * kRecordBytes;
+    b = bytes;
+    store<std::uint64_t>(b, record + kPixelsOffsetAt, bytes.size() - 64);
+    EXPECT_EQ(openError("pixels.pieces", b), "91000012");
+    b = bytes;
+    store<std::int32_t>(b, record + kCornersAt, 1 << 28);
+    EXPECT_EQ(openError("corners.pieces", b), "91000012");
+    // a side profile of another size, or out of the file
+    const std::size_t side = load<std::uint64_t>(bytes, record + kSidesOffsetAt);
+    b = bytes;
+    store<std::uint32_t>(b, side + kPackedBytesAt, load<std::uint32_t>(bytes, side + kPackedBytesAt) + 1);
+    EXPECT_EQ(openError("packed_bytes.pieces", b), "91000012");
+    b = bytes;
+    store<std::uint64_t>(b, side, bytes.size() - 8);
+    EXPECT_EQ(openError("packed_offset.pieces", b), "91000012");
+
+    // a corner out of the crop - on open, a corner within the crop but off the contour - before the sides are split
+    const std::size_t corner = load<std::uint64_t>(bytes, record + kCornersOffsetAt);
+    b = bytes;
+    store<std::int32_t>(b, corner, photo.pieces.images[3].width());
+    EXPECT_EQ(openError("corner_out.pieces", b), "91000012");
+    b = bytes;
+    store<std::int32_t>(b, corner, photo.pieces.images[3].width() / 2);
+    store<std::int32_t>(b, corner + 4, photo.pieces.images[3].height() / 2);
+    writeBytes(dir + "corner_off.pieces", b);
+    const PieceSet opened(dir + "corner_off.pieces");
+    EXPECT_EQ(assertionCode([&] { opened.pieces(); }), "91000015");
+    EXPECT_EQ(assertionCode([&] { opened.pieces(false); }), "91000015");
+}
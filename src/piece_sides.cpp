@@ -0,0 +1,69 @@
+#include "piece_sides.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/algorithms/simplify_contours.h>
+
+namespace {
+
+template <typename Contour>
+PieceSides splitContours(const std::vector<Contour> &contours, const std::vector<std::vector<point2i>> &corners, bool with_openmp) {
+    rassert(contours.size() == corners.size(), 90900001, contours.size(), corners.size());
+    const int n = static_cast<int>(contours.size());
+
+    // every piece gets room for the most points and sides it can have, so that pieces are written in parallel
+    std::vector<std::size_t> pointsFrom(n + 1, 0);
+    std::vector<std::size_t> sidesFrom(n + 1, 0);
+    for (int obj = 0; obj < n; ++obj) {
+        pointsFrom[obj + 1] = pointsFrom[obj] + static_cast<std::size_t>(contours[obj].size()) + corners[obj].size();
+        sidesFrom[obj + 1] = sidesFrom[obj] + std::max<std::size_t>(corners[obj].size(), 1);
+    }
+
+    PieceSides res;
+    res.points.resize(pointsFrom[n]);
+    std::vector<int> ends(sidesFrom[n]);
+    std::vector<int> counts(n);
+    parallelForEach(0, n, [&](int obj) {
+        const std::span<point2i> points = std::span<point2i>(res.points).subspan(pointsFrom[obj], pointsFrom[obj + 1] - pointsFrom[obj]);
+        const std::span<int> partEnds = std::span<int>(ends).subspan(sidesFrom[obj], sidesFrom[obj + 1] - sidesFrom[obj]);
+        counts[obj] = splitContourByCorners(contours[obj], corners[obj], points, partEnds);
+    }, with_openmp);
+
+    // offsets, and the points moved to the left if duplicated corners left a piece with less of them
+    res.firstSide.resize(n + 1);
+    res.sideBegin.reserve(sidesFrom[n] + 1);
+    int used = 0;
+    for (int obj = 0; obj < n; ++obj) {
+        const int from = static_cast<int>(pointsFrom[obj]);
+        const int pieceEnd = counts[obj] > 0 ? ends[sidesFrom[obj] + counts[obj] - 1] : 0;
+        if (from != used) std::copy(res.points.begin() + from, res.points.begin() + from + pieceEnd, res.points.begin() + used);
+        for (int k = 0; k < counts[obj]; ++k) res.sideBegin.push_back(used + ends[sidesFrom[obj] + k]);
+        used += pieceEnd;
+        res.firstSide[obj + 1] = res.firstSide[obj] + counts[obj];
+    }
+    res.points.resize(used);
+    return res;
+}
+
+} // namespace
+
+PieceSides PieceSides::split(const std::vector<std::vector<point2i>> &contours, const std::vector<std::vector<point2i>> &corners,
+                             bool with_openmp) {
+    return splitContours(contours, corners, with_openmp);
+}
+
+PieceSides PieceSides::split(const std::vector<ChainContour> &contours, const std::vector<std::vector<point2i>> &corners,
+                             bool with_openmp) {
+    return splitContours(contours, corners, with_openmp);
+}
+
+void PieceSides::addPiece(const std::vector<std::vector<point2i>> &sides) {
+    for (const std::vector<point2i> &side: sides) {
+        points.insert(points.end(), side.begin(), side.end());
+        sideBegin.push_back(static_cast<int>(points.size()));
+    }
+    firstSide.push_back(firstSide.back() + static_cast<int>(sides.size()));
+}
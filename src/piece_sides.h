@@ -0,0 +1,51 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <libbase/point2.h>
+#include <libimages/chain_contour.h>
+
+// Sides of all pieces of a puzzle in one point buffer with offset arrays (CSR) instead of a vector per side:
+// sides of piece obj are [firstSide[obj], firstSide[obj + 1]), points of side i are points[sideBegin[i], sideBegin[i + 1]).
+// Neighbouring sides of a piece share their corner, so the sides of a contour of n points with 4 corners have n + 4 points.
+struct PieceSides final {
+    std::vector<point2i> points;
+    std::vector<int> firstSide = {0}; // [pieces + 1]
+    std::vector<int> sideBegin = {0}; // [sides + 1]
+
+    // The sides of one piece, sides[obj][side] is a span of its points
+    class Piece final {
+      public:
+        Piece(const PieceSides &sides, int obj) : sides_(&sides), first_(sides.firstSide[obj]), count_(sides.firstSide[obj + 1] - first_) {}
+
+        int size() const noexcept { return count_; }
+        std::span<const point2i> operator[](int side) const { return sides_->side(first_ + side); }
+
+      private:
+        const PieceSides *sides_;
+        int first_;
+        int count_;
+    };
+
+    // Every contour split by its corners (see splitContourByCorners) straight into the buffer, contours in parallel
+    static PieceSides split(const std::vector<std::vector<point2i>> &contours, const std::vector<std::vector<point2i>> &corners,
+                            bool with_openmp);
+    // The same for chain-coded contours, parts are decoded straight into the buffer
+    static PieceSides split(const std::vector<ChainContour> &contours, const std::vector<std::vector<point2i>> &corners,
+                            bool with_openmp);
+
+    int pieces() const noexcept { return static_cast<int>(firstSide.size()) - 1; }
+    int sides() const noexcept { return firstSide.back(); }
+    int sides(int obj) const { return firstSide[obj + 1] - firstSide[obj]; }
+
+    Piece operator[](int obj) const { return Piece(*this, obj); }
+    // Side with flat index i = firstSide[obj] + side
+    std::span<const point2i> side(int i) const {
+        return std::span<const point2i>(points).subspan(sideBegin[i], sideBegin[i + 1] - sideBegin[i]);
+    }
+    std::span<const point2i> side(int obj, int side) const { return this->side(firstSide[obj] + side); }
+
+    // Appends a piece with these sides
+    void addPiece(const std::vector<std::vector<point2i>> &sides);
+};
@@ -2,17 +2,45 @@
 
 #include <libbase/runtime_assert.h>
 #include <libbase/stats.h>
+#include <libimages/debug_io.h>
 #include <libimages/draw.h>
+#include <libimages/png_stream_writer.h>
+#include <libimages/algorithms/warp_perspective.h>
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
-#include <deque>
+#include <cstring>
+#include <exception>
 #include <limits>
-#include <unordered_map>
+#include <map>
+#include <queue>
 #include <vector>
 
+void SideCandidates::insert(const SideCandidate& candidate) {
+    int pos = 0;
+    while (pos < size && items[static_cast<size_t>(pos)].cost < candidate.cost) ++pos;
+    if (pos == capacity) return;
+    for (int i = std::min(size, capacity - 1); i > pos; --i) items[static_cast<size_t>(i)] = items[static_cast<size_t>(i - 1)];
+    items[static_cast<size_t>(pos)] = candidate;
+    size = std::min(size + 1, capacity);
+}
+
+void MatchedSide::consider(int candidateObj, int candidateSide, float difference) {
+    // infinite difference means the comparison was abandoned early, the real cost is unknown
+    if (std::isfinite(difference)) candidates.insert({candidateObj, candidateSide, difference});
+
+    const float previousBest = differenceBest;
+    if (previousBest == -1 || difference <= previousBest) {
+        objB = candidateObj;
+        sideB = candidateSide;
+        differenceBest = difference;
+        differenceSecondBest = previousBest;
+    }
+}
+
 namespace {
 
 // Board directions: 0=RIGHT, 1=DOWN, 2=LEFT, 3=UP
@@ -37,7 +65,9 @@ struct PlacementState final {
     std::vector<int> deg;                       // degree per object (count of non-white sides)
 };
 
-static void buildSymmetricLinksOrDie(
+// Mutual best matches are linked as is. Sides whose best match points elsewhere are then paired greedily
+// by the cheapest of their candidates whose other side is also still free, the rest are left unlinked.
+static void buildSymmetricLinks(
     const std::vector<std::vector<MatchedSide>>& objMatchedSides,
     PlacementState& st) {
 
@@ -45,6 +75,9 @@ static void buildSymmetricLinksOrDie(
     st.links.assign(static_cast<size_t>(st.n), {SideLink{}, SideLink{}, SideLink{}, SideLink{}});
     st.deg.assign(static_cast<size_t>(st.n), 0);
 
+    std::vector<std::array<bool, 4>> unresolved(static_cast<size_t>(st.n), {false, false, false, false});
+    int unresolvedCount = 0;
+
     for (int objA = 0; objA < st.n; ++objA) {
         rassert(objMatchedSides[objA].size() == 4, 90100001, "Expected 4 sides per object", objA, (int)objMatchedSides[objA].size());
         for (int sA = 0; sA < 4; ++sA) {
@@ -65,20 +98,45 @@ static void buildSymmetricLinksOrDie(
 
             const auto& back = objMatchedSides[objB][sB];
 
-            // Symmetry requirement
-            const bool ok = (back.objB == objA && back.sideB == sA);
-            rassert(ok, 90100005,
-                    "Asymmetric match found:",
-                    "A=obj" + std::to_string(objA) + " side" + std::to_string(sA) +
-                    " -> B=obj" + std::to_string(objB) + " side" + std::to_string(sB) +
-                    ", but reverse is B=obj" + std::to_string(objB) + " side" + std::to_string(sB) +
-                    " -> obj" + std::to_string(back.objB) + " side" + std::to_string(back.sideB));
+            if (back.objB == objA && back.sideB == sA) {
+                st.links[static_cast<size_t>(objA)][static_cast<size_t>(sA)] = SideLink{objB, sB, ms.differenceBest};
+            } else {
+                unresolved[static_cast<size_t>(objA)][static_cast<size_t>(sA)] = true;
+                ++unresolvedCount;
+            }
+        }
+    }
 
-            st.links[static_cast<size_t>(objA)][static_cast<size_t>(sA)] = SideLink{objB, sB, ms.differenceBest};
+    if (unresolvedCount > 0) {
+        struct Proposal final {
+            float cost;
+            int objA, sA, objB, sB;
+        };
+        std::vector<Proposal> proposals;
+        for (int objA = 0; objA < st.n; ++objA) {
+            for (int sA = 0; sA < 4; ++sA) {
+                if (!unresolved[static_cast<size_t>(objA)][static_cast<size_t>(sA)]) continue;
+                for (const SideCandidate& c : objMatchedSides[objA][sA].candidates) {
+                    rassert(c.objB >= 0 && c.objB < st.n && c.sideB >= 0 && c.sideB < 4, 90100005, "Candidate out of range", objA, sA, c.objB, c.sideB);
+                    if (unresolved[static_cast<size_t>(c.objB)][static_cast<size_t>(c.sideB)]) {
+                        proposals.push_back({c.cost, objA, sA, c.objB, c.sideB});
+                    }
+                }
+            }
+        }
+        std::stable_sort(proposals.begin(), proposals.end(), [](const Proposal& a, const Proposal& b) { return a.cost < b.cost; });
+
+        for (const Proposal& p : proposals) {
+            bool& freeA = unresolved[static_cast<size_t>(p.objA)][static_cast<size_t>(p.sA)];
+            bool& freeB = unresolved[static_cast<size_t>(p.objB)][static_cast<size_t>(p.sB)];
+            if (!freeA || !freeB) continue;
+            freeA = freeB = false;
+            st.links[static_cast<size_t>(p.objA)][static_cast<size_t>(p.sA)] = SideLink{p.objB, p.sB, p.cost};
+            st.links[static_cast<size_t>(p.objB)][static_cast<size_t>(p.sB)] = SideLink{p.objA, p.sA, p.cost};
         }
     }
 
-    // degree = number of non-white sides (edges) (symmetry already ensured)
+    // degree = number of non-white sides (edges) (links are symmetric by construction)
     for (int obj = 0; obj < st.n; ++obj) {
         int d = 0;
         for (int s = 0; s < 4; ++s) {
@@ -88,9 +146,78 @@ static void buildSymmetricLinksOrDie(
     }
 }
 
+// Open-addressing map from a grid cell to the object placed there (at most cells of them),
+// cleared in O(1) between attempts by bumping the stamp, so its memory is reused
+class CellOccupancy final {
+public:
+    void reset(int cells) {
+        size_t capacity = 16;
+        while (capacity < 2 * static_cast<size_t>(std::max(cells, 1))) capacity *= 2;
+        if (slots_.size() < capacity) {
+            slots_.assign(capacity, Slot{});
+            stamp_ = 0;
+        }
+        if (++stamp_ == 0) {
+            std::fill(slots_.begin(), slots_.end(), Slot{});
+            stamp_ = 1;
+        }
+        mask_ = slots_.size() - 1;
+    }
+
+    // -1 if the cell is free
+    int at(int x, int y) const {
+        const std::uint64_t key = pack(x, y);
+        for (size_t i = slotOf(key);; i = (i + 1) & mask_) {
+            const Slot& slot = slots_[i];
+            if (slot.stamp != stamp_) return -1;
+            if (slot.key == key) return slot.obj;
+        }
+    }
+
+    // The cell must be free
+    void set(int x, int y, int obj) {
+        const std::uint64_t key = pack(x, y);
+        size_t i = slotOf(key);
+        while (slots_[i].stamp == stamp_) i = (i + 1) & mask_;
+        slots_[i] = Slot{key, obj, stamp_};
+    }
+
+private:
+    struct Slot final {
+        std::uint64_t key = 0;
+        int obj = -1;
+        std::uint32_t stamp = 0; // the slot is used if it equals the current stamp
+    };
+
+    static std::uint64_t pack(int x, int y) {
+        const std::uint32_t ux = static_cast<std::uint32_t>(x);
+        const std::uint32_t uy = static_cast<std::uint32_t>(y);
+        return (static_cast<std::uint64_t>(ux) << 32) | static_cast<std::uint64_t>(uy);
+    }
+
+    size_t slotOf(std::uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+    }
+
+    std::vector<Slot> slots_;
+    std::uint32_t stamp_ = 0;
+    size_t mask_ = 0;
+};
+
+// Scratch memory of placement attempts, reused from one corner candidate to the next
+struct PlacementWorkspace final {
+    CellOccupancy occ;
+    std::vector<int> queue;   // BFS queue, every object is pushed at most once
+    std::vector<int> cellObj; // row-major board for the final holes check
+};
+
+// Stops (returns false) as soon as cancelled becomes less than attempt - an earlier attempt has already decided
 static bool tryAssembleFromCorner(
     const PlacementState& st,
     int startObj,
+    PlacementWorkspace& ws,
+    const std::atomic<int>& cancelled,
+    int attempt,
     std::vector<int>& outObjX,
     std::vector<int>& outObjY,
     std::vector<int>& outObjRot,
@@ -106,12 +233,15 @@ static bool tryAssembleFromCorner(
     if (st.deg[static_cast<size_t>(startObj)] != 2) return false;
 
     // Find its 2 connected sides
-    std::vector<int> connSides;
-    connSides.reserve(2);
+    int connSides[2] = {-1, -1};
+    int connCount = 0;
     for (int s = 0; s < 4; ++s) {
-        if (st.links[static_cast<size_t>(startObj)][static_cast<size_t>(s)].objB != -1) connSides.push_back(s);
+        if (st.links[static_cast<size_t>(startObj)][static_cast<size_t>(s)].objB != -1) {
+            if (connCount == 2) return false;
+            connSides[connCount++] = s;
+        }
     }
-    if (connSides.size() != 2) return false;
+    if (connCount != 2) return false;
 
     const int a = connSides[0];
     const int b = connSides[1];
@@ -130,31 +260,27 @@ static bool tryAssembleFromCorner(
     rassert(mod4(sD + rotStart) == 1, 90100006, "Corner orientation mismatch", startObj, sR, sD, rotStart);
 
     // BFS placement in grid coordinates (can be negative; we'll shift later)
-    std::deque<int> q;
+    std::vector<int>& q = ws.queue;
+    q.clear();
+    q.reserve(static_cast<size_t>(n));
+    size_t qHead = 0;
 
     outObjX[static_cast<size_t>(startObj)] = 0;
     outObjY[static_cast<size_t>(startObj)] = 0;
     outObjRot[static_cast<size_t>(startObj)] = rotStart;
     q.push_back(startObj);
 
-    // Occupancy map: map grid coordinate -> obj
-    // We'll use unordered_map with 64-bit key (x,y) packed.
-    auto pack = [](int x, int y) -> std::uint64_t {
-        const std::uint32_t ux = static_cast<std::uint32_t>(x);
-        const std::uint32_t uy = static_cast<std::uint32_t>(y);
-        return (static_cast<std::uint64_t>(ux) << 32) | static_cast<std::uint64_t>(uy);
-    };
-
-    std::unordered_map<std::uint64_t, int> occ;
-    occ.reserve(static_cast<size_t>(n) * 2);
-    occ[pack(0, 0)] = startObj;
+    // Occupancy: grid coordinate -> obj
+    CellOccupancy& occ = ws.occ;
+    occ.reset(n);
+    occ.set(0, 0, startObj);
 
     int minX = 0, maxX = 0, minY = 0, maxY = 0;
     int placedCount = 1;
 
-    while (!q.empty()) {
-        const int objA = q.front();
-        q.pop_front();
+    while (qHead < q.size()) {
+        if (cancelled.load(std::memory_order_relaxed) < attempt) return false;
+        const int objA = q[qHead++];
 
         const int xA = outObjX[static_cast<size_t>(objA)];
         const int yA = outObjY[static_cast<size_t>(objA)];
@@ -176,15 +302,14 @@ static bool tryAssembleFromCorner(
             const int rotB = mod4(dirOpp - sideB);
 
             // Check occupancy consistency
-            const std::uint64_t key = pack(xB, yB);
-            auto it = occ.find(key);
-            if (it == occ.end()) {
-                occ[key] = objB;
+            const int existing = occ.at(xB, yB);
+            if (existing == -1) {
+                occ.set(xB, yB, objB);
             } else {
-                rassert(it->second == objB, 90100008,
+                rassert(existing == objB, 90100008,
                         "Grid cell conflict: two objects claim same cell",
                         "cell=(" + std::to_string(xB) + "," + std::to_string(yB) + ")",
-                        "existing=obj" + std::to_string(it->second),
+                        "existing=obj" + std::to_string(existing),
                         "new=obj" + std::to_string(objB));
             }
 
@@ -232,7 +357,8 @@ static bool tryAssembleFromCorner(
     if (outW * outH != n) return false;
 
     // Check full rectangular occupancy (no holes)
-    std::vector<int> cellObj(static_cast<size_t>(outW) * static_cast<size_t>(outH), -1);
+    std::vector<int>& cellObj = ws.cellObj;
+    cellObj.assign(static_cast<size_t>(outW) * static_cast<size_t>(outH), -1);
     for (int obj = 0; obj < n; ++obj) {
         const int x = outObjX[static_cast<size_t>(obj)];
         const int y = outObjY[static_cast<size_t>(obj)];
@@ -246,6 +372,206 @@ static bool tryAssembleFromCorner(
     return true;
 }
 
+// Rotates the whole board by 90 degrees clockwise: cell (x, y) of W x H goes to (H - 1 - y, x) of H x W,
+// board direction d goes to d + 1, so every piece gets one more clockwise turn
+static void rotateBoardClockwise(std::vector<int>& objX, std::vector<int>& objY, std::vector<int>& objRot, int& W, int& H) {
+    for (size_t obj = 0; obj < objX.size(); ++obj) {
+        const int x = objX[obj];
+        objX[obj] = H - 1 - objY[obj];
+        objY[obj] = x;
+        objRot[obj] = mod4(objRot[obj] + 1);
+    }
+    std::swap(W, H);
+}
+
+// Greedy placement on the top-K candidates, doesn't need symmetric matches nor a corner by degree:
+//  - the board grows from the seed piece (see greedySeeds),
+//  - then the frontier of the growing board is a priority queue of candidate edges (placed side -> candidate side),
+//    best buddies first, then by cost; an edge is applied if its cell is free and the new piece is consistent
+//    with all already placed neighbours (white sides face only the outside, non-white - only pieces or free cells),
+//  - white sides also fix the board bounds, no piece is placed beyond them.
+// Each candidate edge is pushed at most once per placed piece, so this is O(E log E) for E candidate edges.
+// The board is finally rotated so that the corner piece with the smallest index is at the top-left
+// (the same orientation as tryAssembleFromCorner gives). outCost is the total cost of the applied edges.
+static bool tryAssembleGreedy(
+    const std::vector<std::vector<MatchedSide>>& objMatchedSides,
+    int seed,
+    std::vector<int>& outObjX,
+    std::vector<int>& outObjY,
+    std::vector<int>& outObjRot,
+    int& outW,
+    int& outH,
+    double& outCost) {
+
+    const int n = static_cast<int>(objMatchedSides.size());
+    outObjX.assign(static_cast<size_t>(n), std::numeric_limits<int>::min());
+    outObjY.assign(static_cast<size_t>(n), std::numeric_limits<int>::min());
+    outObjRot.assign(static_cast<size_t>(n), -1);
+    if (n == 0) return false;
+    for (int obj = 0; obj < n; ++obj) {
+        rassert(objMatchedSides[obj].size() == 4, 90100015, "Expected 4 sides per object", obj, (int)objMatchedSides[obj].size());
+    }
+
+    auto isWhite = [&](int obj, int side) { return objMatchedSides[obj][side].objB == -1; };
+    auto isBestBuddy = [&](int objA, int sA, int objB, int sB) {
+        const MatchedSide& a = objMatchedSides[objA][sA];
+        const MatchedSide& b = objMatchedSides[objB][sB];
+        return a.objB == objB && a.sideB == sB && b.objB == objA && b.sideB == sA;
+    };
+
+    struct Edge final {
+        bool bestBuddy;
+        float cost;
+        std::int64_t order; // push order, for determinism among equal edges
+        int objA, sA, objB, sB;
+    };
+    // priority_queue pops the largest, so "less" means "worse"
+    auto worse = [](const Edge& a, const Edge& b) {
+        if (a.bestBuddy != b.bestBuddy) return !a.bestBuddy;
+        if (a.cost != b.cost) return a.cost > b.cost;
+        return a.order > b.order;
+    };
+    std::priority_queue<Edge, std::vector<Edge>, decltype(worse)> frontier(worse);
+    std::int64_t pushed = 0;
+
+    CellOccupancy occ;
+    occ.reset(n);
+
+    // bounds fixed by white sides, inclusive
+    int boundMinX = std::numeric_limits<int>::min(), boundMaxX = std::numeric_limits<int>::max();
+    int boundMinY = std::numeric_limits<int>::min(), boundMaxY = std::numeric_limits<int>::max();
+    auto inBounds = [&](int x, int y) { return x >= boundMinX && x <= boundMaxX && y >= boundMinY && y <= boundMaxY; };
+    auto objAt = [&](int x, int y) { return occ.at(x, y); };
+
+    // extents of the placed pieces, inclusive
+    int curMinX = 0, curMaxX = 0, curMinY = 0, curMaxY = 0;
+
+    // Checks piece obj with rotation rot in the free cell (x, y) against the bounds and the neighbours
+    auto consistent = [&](int obj, int rot, int x, int y) {
+        if (!inBounds(x, y)) return false;
+        for (int dir = 0; dir < 4; ++dir) {
+            const int side = mod4(dir - rot);
+            const int nx = x + dx4[dir];
+            const int ny = y + dy4[dir];
+            const int neighbour = objAt(nx, ny);
+            if (isWhite(obj, side)) {
+                if (neighbour != -1) return false;
+                // the board ends right here: on the already fixed bound, and nothing is placed beyond
+                if (dir == 0 && (boundMaxX != std::numeric_limits<int>::max() ? x != boundMaxX : x < curMaxX)) return false;
+                if (dir == 1 && (boundMaxY != std::numeric_limits<int>::max() ? y != boundMaxY : y < curMaxY)) return false;
+                if (dir == 2 && (boundMinX != std::numeric_limits<int>::min() ? x != boundMinX : x > curMinX)) return false;
+                if (dir == 3 && (boundMinY != std::numeric_limits<int>::min() ? y != boundMinY : y > curMinY)) return false;
+                continue;
+            }
+            if (!inBounds(nx, ny)) return false;
+            if (neighbour != -1 && isWhite(neighbour, mod4(dir + 2 - outObjRot[static_cast<size_t>(neighbour)]))) return false;
+        }
+        return true;
+    };
+
+    auto place = [&](int obj, int rot, int x, int y) {
+        outObjX[static_cast<size_t>(obj)] = x;
+        outObjY[static_cast<size_t>(obj)] = y;
+        outObjRot[static_cast<size_t>(obj)] = rot;
+        occ.set(x, y, obj);
+        curMinX = std::min(curMinX, x);
+        curMaxX = std::max(curMaxX, x);
+        curMinY = std::min(curMinY, y);
+        curMaxY = std::max(curMaxY, y);
+        for (int dir = 0; dir < 4; ++dir) {
+            const int side = mod4(dir - rot);
+            if (isWhite(obj, side)) {
+                if (dir == 0) boundMaxX = x;
+                if (dir == 1) boundMaxY = y;
+                if (dir == 2) boundMinX = x;
+                if (dir == 3) boundMinY = y;
+                continue;
+            }
+            if (objAt(x + dx4[dir], y + dy4[dir]) != -1) continue;
+            for (const SideCandidate& c : objMatchedSides[obj][side].candidates) {
+                frontier.push(Edge{isBestBuddy(obj, side, c.objB, c.sideB), c.cost, pushed++, obj, side, c.objB, c.sideB});
+            }
+        }
+    };
+
+    place(seed, 0, 0, 0);
+    int placedCount = 1;
+    outCost = 0.0;
+
+    while (!frontier.empty() && placedCount < n) {
+        const Edge e = frontier.top();
+        frontier.pop();
+        if (outObjRot[static_cast<size_t>(e.objB)] != -1) continue;
+
+        const int xA = outObjX[static_cast<size_t>(e.objA)];
+        const int yA = outObjY[static_cast<size_t>(e.objA)];
+        const int dir = mod4(e.sA + outObjRot[static_cast<size_t>(e.objA)]);
+        const int xB = xA + dx4[dir];
+        const int yB = yA + dy4[dir];
+        if (objAt(xB, yB) != -1) continue;
+
+        const int rotB = mod4(mod4(dir + 2) - e.sB);
+        if (!consistent(e.objB, rotB, xB, yB)) continue;
+
+        place(e.objB, rotB, xB, yB);
+        placedCount++;
+        outCost += e.cost;
+    }
+
+    if (placedCount != n) return false;
+
+    for (int obj = 0; obj < n; ++obj) {
+        outObjX[static_cast<size_t>(obj)] -= curMinX;
+        outObjY[static_cast<size_t>(obj)] -= curMinY;
+    }
+    outW = curMaxX - curMinX + 1;
+    outH = curMaxY - curMinY + 1;
+    // cells are distinct by construction, so n pieces fill the bounding box only without holes
+    if (outW * outH != n) return false;
+
+    int topLeft = -1;
+    int topLeftTurns = 0;
+    for (int obj = 0; obj < n && topLeft == -1; ++obj) {
+        const int x = outObjX[static_cast<size_t>(obj)];
+        const int y = outObjY[static_cast<size_t>(obj)];
+        // clockwise turns that bring this cell to (0, 0)
+        if (x == 0 && y == 0) { topLeft = obj; topLeftTurns = 0; }
+        else if (x == 0 && y == outH - 1) { topLeft = obj; topLeftTurns = 1; }
+        else if (x == outW - 1 && y == outH - 1) { topLeft = obj; topLeftTurns = 2; }
+        else if (x == outW - 1 && y == 0) { topLeft = obj; topLeftTurns = 3; }
+    }
+    for (int i = 0; i < topLeftTurns; ++i) rotateBoardClockwise(outObjX, outObjY, outObjRot, outW, outH);
+
+    return true;
+}
+
+// Pieces of up to count cheapest pairs of best buddies (each side is the best candidate of the other),
+// without repeats, or the first piece if there are no best buddies at all
+static std::vector<int> greedySeeds(const std::vector<std::vector<MatchedSide>>& objMatchedSides, int count) {
+    struct Buddies final {
+        float cost;
+        int obj;
+    };
+    std::vector<Buddies> buddies;
+    for (int obj = 0; obj < static_cast<int>(objMatchedSides.size()); ++obj) {
+        for (int s = 0; s < static_cast<int>(objMatchedSides[obj].size()); ++s) {
+            const MatchedSide& m = objMatchedSides[obj][s];
+            if (m.objB == -1) continue;
+            const MatchedSide& back = objMatchedSides[m.objB][m.sideB];
+            if (back.objB == obj && back.sideB == s) buddies.push_back({m.differenceBest, obj});
+        }
+    }
+    std::stable_sort(buddies.begin(), buddies.end(), [](const Buddies& a, const Buddies& b) { return a.cost < b.cost; });
+
+    std::vector<int> seeds;
+    for (const Buddies& b : buddies) {
+        if (static_cast<int>(seeds.size()) == count) break;
+        if (std::find(seeds.begin(), seeds.end(), b.obj) == seeds.end()) seeds.push_back(b.obj);
+    }
+    if (seeds.empty() && !objMatchedSides.empty()) seeds.push_back(0);
+    return seeds;
+}
+
 // Corner mapping:
 // piece corners are indexed 0..3 such that corner i is intersection of side(i-1) and side(i),
 // and side i spans corner i -> corner(i+1) in clockwise order.
@@ -263,8 +589,7 @@ static float dist2f(point2i a, point2i b) {
 
 static int medianRounded(const std::vector<float>& v, int fallback) {
     if (v.empty()) return fallback;
-    std::vector<float> tmp = v;
-    const float m = static_cast<float>(stats::median(tmp));
+    const float m = static_cast<float>(stats::median(v));
     const int r = (int)std::lround(std::max(1.0f, m));
     return r;
 }
@@ -316,14 +641,6 @@ static H3 invert3x3OrDie(const H3& M) {
     return inv;
 }
 
-static void applyH(const H3& H, double x, double y, double& ox, double& oy) {
-    const double* m = H.a;
-    const double w = m[6] * x + m[7] * y + m[8];
-    rassert(std::abs(w) > 1e-12, 90100012, "Invalid homography w");
-    ox = (m[0] * x + m[1] * y + m[2]) / w;
-    oy = (m[3] * x + m[4] * y + m[5]) / w;
-}
-
 static H3 solveHomography4ptOrDie(
     const std::array<point2f, 4>& src,
     const std::array<point2f, 4>& dst) {
@@ -393,67 +710,120 @@ static H3 solveHomography4ptOrDie(
     return H;
 }
 
-// ------------------- Sampling -------------------
-
-static inline uint8_t clamp_u8(int v) {
-    if (v < 0) return 0;
-    if (v > 255) return 255;
-    return static_cast<uint8_t>(v);
+// Canvas offsets of columns and rows (prefix sums of their sizes)
+static std::vector<int> prefixOffsets(const std::vector<int>& sizes) {
+    std::vector<int> off(sizes.size() + 1, 0);
+    for (size_t i = 0; i < sizes.size(); ++i) off[i + 1] = off[i] + sizes[i];
+    return off;
 }
 
-static void sampleBilinearRGB(const image8u& img, float x, float y, uint8_t& r, uint8_t& g, uint8_t& b) {
-    const int W = img.width();
-    const int H = img.height();
-    rassert(W > 0 && H > 0, 90100014);
-
-    // Clamp to image bounds
-    x = std::clamp(x, 0.0f, float(W - 1));
-    y = std::clamp(y, 0.0f, float(H - 1));
-
-    const int x0 = (int)std::floor(x);
-    const int y0 = (int)std::floor(y);
-    const int x1 = std::min(x0 + 1, W - 1);
-    const int y1 = std::min(y0 + 1, H - 1);
+// The piece placed into cell (gx, gy): its canvas rectangle and its corners at the board corners TL, TR, BR, BL
+struct CellWarp final {
+    int obj = -1;
+    int rot = 0;
+    int x0 = 0, y0 = 0, w = 0, h = 0;
+    std::array<point2i, 4> corners{};
+};
 
-    const float fx = x - float(x0);
-    const float fy = y - float(y0);
+static CellWarp cellWarp(
+    const PuzzleAssemblyResult& r,
+    const std::vector<std::vector<point2i>>& objCorners,
+    const std::vector<int>& xOff, const std::vector<int>& yOff,
+    int gx, int gy) {
+    const PlacedPiece pp = r.grid[gy * r.W + gx];
+    const auto& corners = objCorners[static_cast<size_t>(pp.obj)];
+
+    CellWarp c;
+    c.obj = pp.obj;
+    c.rot = pp.rot90;
+    c.x0 = xOff[static_cast<size_t>(gx)];
+    c.y0 = yOff[static_cast<size_t>(gy)];
+    c.w = xOff[static_cast<size_t>(gx + 1)] - c.x0;
+    c.h = yOff[static_cast<size_t>(gy + 1)] - c.y0;
+    // Source corners for these board corners, using rot
+    c.corners = {
+        corners[static_cast<size_t>(pieceCornerFromBoardCorner(3, pp.rot90))],
+        corners[static_cast<size_t>(pieceCornerFromBoardCorner(0, pp.rot90))],
+        corners[static_cast<size_t>(pieceCornerFromBoardCorner(1, pp.rot90))],
+        corners[static_cast<size_t>(pieceCornerFromBoardCorner(2, pp.rot90))]
+    };
+    return c;
+}
 
-    auto at = [&](int yy, int xx, int c) -> float {
-        if (img.channels() == 1) {
-            return float(img(yy, xx));
-        }
-        return float(img(yy, xx, c));
+// Inverse warping of the piece of a cell in the cell coordinates (its top-left corner at 0, 0) into the rows
+// [tileY0, tileY0 + tile.height()) of the cell held by tile, so that the pixels of a piece do not depend on where
+// its cell is on the canvas (and a cached tile is the same in any cell of its size)
+static void warpCellTile(const CellWarp& c, const image8u& srcImg, const image8u& srcMask, int tileY0, image8u& tile) {
+    const float w = (float)c.w;
+    const float h = (float)c.h;
+    std::array<point2f, 4> dst = {
+        point2f{0.0f, 0.0f}, // TL
+        point2f{w, 0.0f},    // TR
+        point2f{w, h},       // BR
+        point2f{0.0f, h}     // BL
     };
 
-    float c00r = at(y0, x0, 0), c00g = at(y0, x0, 1), c00b = at(y0, x0, 2);
-    float c10r = at(y0, x1, 0), c10g = at(y0, x1, 1), c10b = at(y0, x1, 2);
-    float c01r = at(y1, x0, 0), c01g = at(y1, x0, 1), c01b = at(y1, x0, 2);
-    float c11r = at(y1, x1, 0), c11g = at(y1, x1, 1), c11b = at(y1, x1, 2);
+    std::array<point2f, 4> src;
+    for (int i = 0; i < 4; ++i) src[i] = point2f{(float)c.corners[i].x, (float)c.corners[i].y};
 
-    float r0 = c00r * (1 - fx) + c10r * fx;
-    float g0 = c00g * (1 - fx) + c10g * fx;
-    float b0 = c00b * (1 - fx) + c10b * fx;
+    const H3 Hsrc2dst = solveHomography4ptOrDie(src, dst);
+    const H3 Hdst2src = invert3x3OrDie(Hsrc2dst);
 
-    float r1 = c01r * (1 - fx) + c11r * fx;
-    float g1 = c01g * (1 - fx) + c11g * fx;
-    float b1 = c01b * (1 - fx) + c11b * fx;
+    // Pixel centers are mapped to the piece, its masked pixels are sampled bilinearly
+    Homography dstToSrc;
+    std::copy(std::begin(Hdst2src.a), std::end(Hdst2src.a), dstToSrc.m);
+    warpPerspectiveMaskedBand(srcImg, srcMask, dstToSrc, tile, tileY0, 0, 0, c.w, c.h);
+}
 
-    float rf = r0 * (1 - fy) + r1 * fy;
-    float gf = g0 * (1 - fy) + g1 * fy;
-    float bf = b0 * (1 - fy) + b1 * fy;
+// Rows [tileY0, tileY0 + tile.height()) of the tile of a cell onto the canvas rows held by band (those that cross it)
+static void blitCellTile(const CellWarp& c, const image8u& tile, int tileY0, int bandY0, image8u& band) {
+    const int from = std::max(c.y0 + tileY0, bandY0);
+    const int to = std::min(c.y0 + tileY0 + tile.height(), bandY0 + band.height());
+    const size_t rowBytes = static_cast<size_t>(c.w) * 3;
+    for (int y = from; y < to; ++y) std::memcpy(band.ptr(y - bandY0, c.x0), tile.ptr(y - c.y0 - tileY0), rowBytes);
+}
 
-    r = clamp_u8((int)std::lround(rf));
-    g = clamp_u8((int)std::lround(gf));
-    b = clamp_u8((int)std::lround(bf));
+// Inverse warping of the piece placed into cell (gx, gy) into the canvas rows held by band
+static void warpCellIntoBand(
+    const PuzzleAssemblyResult& r,
+    const std::vector<image8u>& objImages,
+    const std::vector<image8u>& objMasks,
+    const std::vector<std::vector<point2i>>& objCorners,
+    const std::vector<int>& xOff, const std::vector<int>& yOff,
+    int gx, int gy, int bandY0, image8u& band) {
+    const CellWarp c = cellWarp(r, objCorners, xOff, yOff, gx, gy);
+    const int from = std::max(c.y0, bandY0);
+    const int to = std::min(c.y0 + c.h, bandY0 + band.height());
+    if (c.w <= 0 || from >= to) return;
+
+    // only the rows of the cell within the band, they are copied over whole (the canvas is black outside of pieces)
+    image8u tile(c.w, to - from, 3);
+    warpCellTile(c, objImages[static_cast<size_t>(c.obj)], objMasks[static_cast<size_t>(c.obj)], from - c.y0, tile);
+    blitCellTile(c, tile, from - c.y0, bandY0, band);
 }
 
-static bool maskNearestIsObject(const image8u& mask, float x, float y) {
-    const int W = mask.width();
-    const int H = mask.height();
-    const int xi = (int)std::lround(x);
-    const int yi = (int)std::lround(y);
-    if (xi < 0 || xi >= W || yi < 0 || yi >= H) return false;
-    return mask(yi, xi) == 255;
+// Grid lines between cells (3 pixels thick) over the canvas rows held by band
+static void drawGridLinesIntoBand(const std::vector<int>& xOff, const std::vector<int>& yOff, int bandY0, image8u& band) {
+    const int halfThickness = 1;
+    const color8u lineColor(0, 255, 0);
+    auto fill = [&](int x0, int y0, int x1, int y1) { // inclusive canvas coordinates
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, band.width() - 1);
+        y0 = std::max(y0 - bandY0, 0);
+        y1 = std::min(y1 - bandY0, band.height() - 1);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                for (int c = 0; c < 3; ++c) band.at(y, x, c) = lineColor(c);
+            }
+        }
+    };
+    const int canvasW = xOff.back();
+    const int canvasH = yOff.back();
+
+    // Vertical lines
+    for (size_t x = 1; x + 1 < xOff.size(); ++x) fill(xOff[x] - halfThickness, 0, xOff[x] + halfThickness, canvasH - 1);
+    // Horizontal lines
+    for (size_t y = 1; y + 1 < yOff.size(); ++y) fill(0, yOff[y] - halfThickness, canvasW - 1, yOff[y] + halfThickness);
 }
 
 } // namespace
@@ -462,7 +832,9 @@ PuzzleAssemblyResult assemblePuzzle(
     const std::vector<image8u>& objImages,
     const std::vector<image8u>& objMasks,
     const std::vector<std::vector<point2i>>& objCorners,
-    const std::vector<std::vector<MatchedSide>>& objMatchedSides) {
+    const std::vector<std::vector<MatchedSide>>& objMatchedSides,
+    AssemblyMethod method,
+    unsigned outputs) {
 
     const int objects_count = static_cast<int>(objImages.size());
     rassert((int)objMasks.size() == objects_count, 90100020);
@@ -473,32 +845,88 @@ PuzzleAssemblyResult assemblePuzzle(
         rassert(objCorners[i].size() == 4, 90100023, "Each object must have 4 corners", i, (int)objCorners[i].size());
     }
 
-    PlacementState st;
-    buildSymmetricLinksOrDie(objMatchedSides, st);
-
-    // Find corner candidates by degree==2
-    std::vector<int> cornersCandidates;
-    for (int obj = 0; obj < objects_count; ++obj) {
-        if (st.deg[static_cast<size_t>(obj)] == 2) cornersCandidates.push_back(obj);
-    }
-    rassert(!cornersCandidates.empty(), 90100024, "No corner candidates found (degree==2)");
-
     std::vector<int> objX, objY, objRot;
     int W = 0, H = 0;
 
-    bool assembled = false;
-    int usedStart = -1;
+    if (method == AssemblyMethod::Greedy) {
+        // Boards grown from several seeds in parallel, the cheapest one (the earliest seed among equal) wins
+        constexpr int greedySeedsCount = 4;
+        const std::vector<int> seeds = greedySeeds(objMatchedSides, greedySeedsCount);
+        const int attempts = static_cast<int>(seeds.size());
+        std::vector<std::vector<int>> attemptX(attempts), attemptY(attempts), attemptRot(attempts);
+        std::vector<int> attemptW(attempts), attemptH(attempts);
+        std::vector<double> attemptCost(attempts);
+        std::vector<char> attemptOk(attempts, 0);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < attempts; ++i) {
+            attemptOk[i] = tryAssembleGreedy(objMatchedSides, seeds[i], attemptX[i], attemptY[i], attemptRot[i],
+                                             attemptW[i], attemptH[i], attemptCost[i]);
+        }
 
-    for (int startObj : cornersCandidates) {
-        if (tryAssembleFromCorner(st, startObj, objX, objY, objRot, W, H)) {
+        int best = -1;
+        for (int i = 0; i < attempts; ++i) {
+            if (attemptOk[i] && (best == -1 || attemptCost[i] < attemptCost[best])) best = i;
+        }
+        rassert(best != -1, 90100029, "Greedy assembly failed");
+        objX = std::move(attemptX[best]);
+        objY = std::move(attemptY[best]);
+        objRot = std::move(attemptRot[best]);
+        W = attemptW[best];
+        H = attemptH[best];
+    } else {
+        PlacementState st;
+        buildSymmetricLinks(objMatchedSides, st);
+
+        // Find corner candidates by degree==2
+        std::vector<int> cornersCandidates;
+        for (int obj = 0; obj < objects_count; ++obj) {
+            if (st.deg[static_cast<size_t>(obj)] == 2) cornersCandidates.push_back(obj);
+        }
+        rassert(!cornersCandidates.empty(), 90100024, "No corner candidates found (degree==2)");
+
+        // Attempts run in parallel, each thread with its own workspace, but the result is the same as of the serial search:
+        // the earliest candidate that either assembles or fails with an error decides, all attempts after it are cancelled
+        const int attempts = static_cast<int>(cornersCandidates.size());
+        std::vector<std::vector<int>> attemptX(attempts), attemptY(attempts), attemptRot(attempts);
+        std::vector<int> attemptW(attempts), attemptH(attempts);
+        std::vector<char> attemptOk(attempts, 0);
+        std::vector<std::exception_ptr> attemptError(attempts);
+        std::atomic<int> decided(attempts);
+
+        #pragma omp parallel
+        {
+            PlacementWorkspace ws;
+
+            #pragma omp for schedule(dynamic, 1)
+            for (int i = 0; i < attempts; ++i) {
+                if (decided.load(std::memory_order_relaxed) < i) continue;
+                try {
+                    attemptOk[i] = tryAssembleFromCorner(st, cornersCandidates[i], ws, decided, i,
+                                                         attemptX[i], attemptY[i], attemptRot[i], attemptW[i], attemptH[i]);
+                } catch (...) {
+                    attemptError[i] = std::current_exception();
+                }
+                if (!attemptOk[i] && !attemptError[i]) continue;
+                int current = decided.load();
+                while (i < current && !decided.compare_exchange_weak(current, i)) {}
+            }
+        }
+
+        bool assembled = false;
+        for (int i = 0; i < attempts && !assembled; ++i) {
+            if (attemptError[i]) std::rethrow_exception(attemptError[i]);
+            if (!attemptOk[i]) continue;
             assembled = true;
-            usedStart = startObj;
-            break;
+            objX = std::move(attemptX[i]);
+            objY = std::move(attemptY[i]);
+            objRot = std::move(attemptRot[i]);
+            W = attemptW[i];
+            H = attemptH[i];
         }
-    }
 
-    rassert(assembled, 90100025, "Failed to assemble from any corner candidate");
-    (void)usedStart;
+        rassert(assembled, 90100025, "Failed to assemble from any corner candidate");
+    }
 
     // Build grid
     PuzzleAssemblyResult res;
@@ -573,104 +1001,129 @@ PuzzleAssemblyResult assemblePuzzle(
     for (int x = 0; x < W; ++x) res.colW[static_cast<size_t>(x)] = medianRounded(colWidths[static_cast<size_t>(x)], fallbackW);
     for (int y = 0; y < H; ++y) res.rowH[static_cast<size_t>(y)] = medianRounded(rowHeights[static_cast<size_t>(y)], fallbackH);
 
-    // Prefix sums
-    std::vector<int> xOff(static_cast<size_t>(W + 1), 0);
-    std::vector<int> yOff(static_cast<size_t>(H + 1), 0);
-    for (int x = 0; x < W; ++x) xOff[static_cast<size_t>(x + 1)] = xOff[static_cast<size_t>(x)] + res.colW[static_cast<size_t>(x)];
-    for (int y = 0; y < H; ++y) yOff[static_cast<size_t>(y + 1)] = yOff[static_cast<size_t>(y)] + res.rowH[static_cast<size_t>(y)];
-
+    const std::vector<int> xOff = prefixOffsets(res.colW);
+    const std::vector<int> yOff = prefixOffsets(res.rowH);
     const int canvasW = xOff[static_cast<size_t>(W)];
     const int canvasH = yOff[static_cast<size_t>(H)];
 
+    if ((outputs & AssemblyOutputAll) == 0) return res;
+
     // Assemble with inverse warping per cell
     res.assembled = image8u(canvasW, canvasH, 3);
     res.assembled.fill(0);
-
     for (int gy = 0; gy < H; ++gy) {
-        for (int gx = 0; gx < W; ++gx) {
-            const PlacedPiece pp = res.grid[gy * W + gx];
-            const int obj = pp.obj;
-            const int rot = pp.rot90;
-
-            const image8u& srcImg = objImages[static_cast<size_t>(obj)];
-            const image8u& srcMask = objMasks[static_cast<size_t>(obj)];
-            const auto& corners = objCorners[static_cast<size_t>(obj)];
-
-            // Destination rectangle corners
-            const float X0 = (float)xOff[static_cast<size_t>(gx)];
-            const float Y0 = (float)yOff[static_cast<size_t>(gy)];
-            const float X1 = (float)xOff[static_cast<size_t>(gx + 1)];
-            const float Y1 = (float)yOff[static_cast<size_t>(gy + 1)];
-
-            std::array<point2f, 4> dst = {
-                point2f{X0, Y0}, // TL
-                point2f{X1, Y0}, // TR
-                point2f{X1, Y1}, // BR
-                point2f{X0, Y1}  // BL
-            };
-
-            // Source corners for these board corners, using rot
-            const point2i TLi = corners[static_cast<size_t>(pieceCornerFromBoardCorner(3, rot))];
-            const point2i TRi = corners[static_cast<size_t>(pieceCornerFromBoardCorner(0, rot))];
-            const point2i BRi = corners[static_cast<size_t>(pieceCornerFromBoardCorner(1, rot))];
-            const point2i BLi = corners[static_cast<size_t>(pieceCornerFromBoardCorner(2, rot))];
-
-            std::array<point2f, 4> src = {
-                point2f{(float)TLi.x, (float)TLi.y},
-                point2f{(float)TRi.x, (float)TRi.y},
-                point2f{(float)BRi.x, (float)BRi.y},
-                point2f{(float)BLi.x, (float)BLi.y}
-            };
-
-            const H3 Hsrc2dst = solveHomography4ptOrDie(src, dst);
-            const H3 Hdst2src = invert3x3OrDie(Hsrc2dst);
-
-            const int ix0 = (int)std::floor(std::min(X0, X1));
-            const int iy0 = (int)std::floor(std::min(Y0, Y1));
-            const int ix1 = (int)std::ceil (std::max(X0, X1));
-            const int iy1 = (int)std::ceil (std::max(Y0, Y1));
-
-            for (int Y = iy0; Y < iy1; ++Y) {
-                if (Y < 0 || Y >= res.assembled.height()) continue;
-                for (int X = ix0; X < ix1; ++X) {
-                    if (X < 0 || X >= res.assembled.width()) continue;
-
-                    // Use pixel center
-                    double sx = 0.0, sy = 0.0;
-                    applyH(Hdst2src, (double)X + 0.5, (double)Y + 0.5, sx, sy);
-
-                    if (!maskNearestIsObject(srcMask, (float)sx, (float)sy)) continue;
-
-                    uint8_t rr = 0, gg = 0, bb = 0;
-                    sampleBilinearRGB(srcImg, (float)sx, (float)sy, rr, gg, bb);
-
-                    res.assembled(Y, X, 0) = rr;
-                    res.assembled(Y, X, 1) = gg;
-                    res.assembled(Y, X, 2) = bb;
-                }
-            }
-        }
+        for (int gx = 0; gx < W; ++gx) warpCellIntoBand(res, objImages, objMasks, objCorners, xOff, yOff, gx, gy, 0, res.assembled);
     }
 
-    // Add grid lines
-    res.assembledWithLines = res.assembled;
-    const int thickness = 3;
-    const color8u lineColor(0, 255, 0);
+    if (!(outputs & AssemblyOutputCanvasWithLines)) return res;
 
-    // Vertical lines
-    for (int x = 1; x < W; ++x) {
-        const int X = xOff[static_cast<size_t>(x)];
-        drawSegment(res.assembledWithLines, point2i{X, 0}, point2i{X, canvasH - 1}, lineColor, thickness);
-    }
-    // Horizontal lines
-    for (int y = 1; y < H; ++y) {
-        const int Y = yOff[static_cast<size_t>(y)];
-        drawSegment(res.assembledWithLines, point2i{0, Y}, point2i{canvasW - 1, Y}, lineColor, thickness);
+    // Add grid lines (over the same warp, taken over if the plain canvas is not needed)
+    if (outputs & AssemblyOutputCanvas) {
+        res.assembledWithLines = res.assembled;
+    } else {
+        res.assembledWithLines = std::move(res.assembled);
+        res.assembled = image8u();
     }
+    drawGridLinesIntoBand(xOff, yOff, 0, res.assembledWithLines);
 
     return res;
 }
 
+void renderAssembledBand(
+    const PuzzleAssemblyResult& r,
+    const std::vector<image8u>& objImages,
+    const std::vector<image8u>& objMasks,
+    const std::vector<std::vector<point2i>>& objCorners,
+    bool withLines, int bandY0, image8u& band) {
+    const std::vector<int> xOff = prefixOffsets(r.colW);
+    const std::vector<int> yOff = prefixOffsets(r.rowH);
+    rassert(band.width() == xOff.back() && band.channels() == 3, 90100031, band.width(), band.channels(), xOff.back());
+    rassert(bandY0 >= 0 && bandY0 + band.height() <= yOff.back(), 90100032, bandY0, band.height(), yOff.back());
+
+    band.fill(0);
+    for (int gy = 0; gy < r.H; ++gy) {
+        // only the cells that cross the band
+        if (yOff[static_cast<size_t>(gy + 1)] <= bandY0 || yOff[static_cast<size_t>(gy)] >= bandY0 + band.height()) continue;
+        for (int gx = 0; gx < r.W; ++gx) warpCellIntoBand(r, objImages, objMasks, objCorners, xOff, yOff, gx, gy, bandY0, band);
+    }
+    if (withLines) drawGridLinesIntoBand(xOff, yOff, bandY0, band);
+}
+
+void saveAssembledStreaming(
+    const std::string& path,
+    const PuzzleAssemblyResult& r,
+    const std::vector<image8u>& objImages,
+    const std::vector<image8u>& objMasks,
+    const std::vector<std::vector<point2i>>& objCorners,
+    bool withLines, int bandRows) {
+    rassert(bandRows > 0, 90100033, bandRows);
+    const std::vector<int> xOff = prefixOffsets(r.colW);
+    const std::vector<int> yOff = prefixOffsets(r.rowH);
+    const int canvasW = xOff.back();
+    const int canvasH = yOff.back();
+
+    debug_io::ensure_dir_exists_for_file(path);
+    PngStreamWriter writer(path, canvasW, canvasH, 3);
+    image8u band(canvasW, std::min(bandRows, canvasH), 3);
+    for (int bandY0 = 0; bandY0 < canvasH; bandY0 += band.height()) {
+        if (bandY0 + band.height() > canvasH) band = image8u(canvasW, canvasH - bandY0, 3); // the last band
+        renderAssembledBand(r, objImages, objMasks, objCorners, withLines, bandY0, band);
+        writer.writeRows(band);
+    }
+    writer.finish();
+}
+
+void WarpedTileCache::clear() {
+    tiles_.clear();
+    last_ = {};
+}
+
+size_t WarpedTileCache::bytes() const {
+    size_t total = 0;
+    for (const auto& [key, tile] : tiles_) total += static_cast<size_t>(tile.width()) * tile.height() * 3;
+    return total;
+}
+
+image8u WarpedTileCache::render(
+    const PuzzleAssemblyResult& r,
+    const std::vector<image8u>& objImages,
+    const std::vector<image8u>& objMasks,
+    const std::vector<std::vector<point2i>>& objCorners,
+    bool withLines) {
+    const std::vector<int> xOff = prefixOffsets(r.colW);
+    const std::vector<int> yOff = prefixOffsets(r.rowH);
+    image8u canvas(xOff.back(), yOff.back(), 3);
+    canvas.fill(0);
+
+    last_ = {};
+    std::map<Key, image8u> used;
+    for (int gy = 0; gy < r.H; ++gy) {
+        for (int gx = 0; gx < r.W; ++gx) {
+            const CellWarp c = cellWarp(r, objCorners, xOff, yOff, gx, gy);
+            if (c.w <= 0 || c.h <= 0) continue;
+            const image8u& srcImg = objImages[static_cast<size_t>(c.obj)];
+            const Key key{c.obj, c.rot, c.w, c.h, srcImg.width(), srcImg.height(), c.corners};
+
+            auto it = used.end();
+            if (auto node = tiles_.extract(key)) {
+                it = used.insert(std::move(node)).position;
+                ++last_.reused;
+            } else {
+                image8u tile(c.w, c.h, 3);
+                warpCellTile(c, srcImg, objMasks[static_cast<size_t>(c.obj)], 0, tile);
+                it = used.insert_or_assign(key, std::move(tile)).first;
+                ++last_.warped;
+            }
+            blitCellTile(c, it->second, 0, 0, canvas);
+        }
+    }
+    // tiles of the placements that are gone
+    tiles_.swap(used);
+
+    if (withLines) drawGridLinesIntoBand(xOff, yOff, 0, canvas);
+    return canvas;
+}
+
 void printGrid(std::ostream& os, const PuzzleAssemblyResult& r) {
     os << "Puzzle grid: W=" << r.W << " H=" << r.H << "\n";
     for (int y = 0; y < r.H; ++y) {
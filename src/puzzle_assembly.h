@@ -1,16 +1,46 @@
 #pragma once
 
+#include <array>
+#include <map>
 #include <vector>
 #include <ostream>
+#include <string>
+#include <tuple>
 
 #include <libbase/point2.h>
 #include <libimages/image.h>
 
+struct SideCandidate final {
+    int objB = -1;
+    int sideB = -1;
+    float cost = -1.0f;
+};
+
+// The best candidates of a side, sorted by cost (among equal costs - the later considered one first, so that
+// the first candidate is always the best match below), inline so that per-side lists do not allocate
+struct SideCandidates final {
+    static constexpr int capacity = 4;
+
+    std::array<SideCandidate, capacity> items{};
+    int size = 0;
+
+    const SideCandidate *begin() const noexcept { return items.data(); }
+    const SideCandidate *end() const noexcept { return items.data() + size; }
+
+    // Dropped if there are already capacity better candidates
+    void insert(const SideCandidate &candidate);
+};
+
 struct MatchedSide final {
     int objB = -1;
     int sideB = -1;
     float differenceBest = -1.0f;
     float differenceSecondBest = -1.0f;
+    SideCandidates candidates;
+
+    // A candidate that is not worse than the current best replaces it and the old best becomes the second.
+    // Candidates should be considered in the serial (objB, sideB) order.
+    void consider(int objB, int sideB, float difference);
 };
 
 struct PlacedPiece final {
@@ -29,14 +59,97 @@ struct PuzzleAssemblyResult final {
     std::vector<int> colW;
     std::vector<int> rowH;
 
+    // Rendered only if requested (see AssemblyOutput), empty otherwise
     image8u assembled;           // 10_assembled.png
     image8u assembledWithLines;  // 09_assembled_with_lines.png
 };
 
+enum class AssemblyMethod {
+    CornerBFS, // breadth-first from a corner piece (all corners in parallel, the first one in order wins) over the mutual
+               // best matches, any inconsistency fails the attempt
+    Greedy,    // from a few best buddies seeds (in parallel, the cheapest board wins) the cheapest consistent
+               // candidate edges around the growing board, O(E log E) per seed
+};
+
+// Canvases for assemblePuzzle to render (a mask of them), the grid, rotations and cell sizes are always computed
+enum AssemblyOutput : unsigned {
+    AssemblyOutputGridOnly = 0,
+    AssemblyOutputCanvas = 1u << 0,          // assembled
+    AssemblyOutputCanvasWithLines = 1u << 1, // assembledWithLines, a lines overlay on the same warp
+    AssemblyOutputAll = AssemblyOutputCanvas | AssemblyOutputCanvasWithLines,
+};
+
 PuzzleAssemblyResult assemblePuzzle(
     const std::vector<image8u>& objImages,
     const std::vector<image8u>& objMasks,
     const std::vector<std::vector<point2i>>& objCorners, // size=objects_count, each size=4, order consistent with side indices
-    const std::vector<std::vector<MatchedSide>>& objMatchedSides);
+    const std::vector<std::vector<MatchedSide>>& objMatchedSides, // CornerBFS resolves asymmetric best matches with the candidates
+    AssemblyMethod method = AssemblyMethod::CornerBFS,
+    unsigned outputs = AssemblyOutputAll);
+
+// Rows [bandY0, bandY0 + band.height()) of the canvas of r (band is 3-channel and as wide as the canvas),
+// the same pixels as assembled (or assembledWithLines) of assemblePuzzle
+void renderAssembledBand(
+    const PuzzleAssemblyResult& r,
+    const std::vector<image8u>& objImages,
+    const std::vector<image8u>& objMasks,
+    const std::vector<std::vector<point2i>>& objCorners,
+    bool withLines, int bandY0, image8u& band);
+
+// Renders the canvas of r band of rows by band of rows straight into a PNG file (see PngStreamWriter),
+// so that only a band is ever in memory, for canvases too large to be held as one image
+void saveAssembledStreaming(
+    const std::string& path,
+    const PuzzleAssemblyResult& r,
+    const std::vector<image8u>& objImages,
+    const std::vector<image8u>& objMasks,
+    const std::vector<std::vector<point2i>>& objCorners,
+    bool withLines, int bandRows = 256);
+
+// Warped pieces of a canvas, a tile per (piece, rotation, cell size, piece corners) in the cell coordinates, for
+// re-rendering of assemblies that change a few placements at a time (incremental assembly, review of a board):
+// a render blits the tiles of the placements it already had and warps only the new ones (a piece moved into a cell of
+// the same size keeps its tile). The pixels are the same as of assemblePuzzle and renderAssembledBand.
+// Only the tiles of the last render are kept. Piece images are not compared, clear() the cache if they change.
+class WarpedTileCache final {
+public:
+    struct Stats final {
+        int warped = 0; // cells warped by the last render
+        int reused = 0; // cells blitted from the cache
+    };
+
+    image8u render(
+        const PuzzleAssemblyResult& r,
+        const std::vector<image8u>& objImages,
+        const std::vector<image8u>& objMasks,
+        const std::vector<std::vector<point2i>>& objCorners,
+        bool withLines);
+
+    void clear();
+
+    int tiles() const noexcept { return static_cast<int>(tiles_.size()); }
+    size_t bytes() const;
+    const Stats& lastRender() const noexcept { return last_; }
+
+private:
+    struct Key final {
+        int obj, rot;
+        int cellW, cellH;
+        int pieceW, pieceH;
+        std::array<point2i, 4> corners; // at the board corners TL, TR, BR, BL
+
+        bool operator<(const Key& other) const noexcept {
+            const auto tie = [](const Key& k) {
+                return std::make_tuple(k.obj, k.rot, k.cellW, k.cellH, k.pieceW, k.pieceH,
+                                       k.corners[0].x, k.corners[0].y, k.corners[1].x, k.corners[1].y,
+                                       k.corners[2].x, k.corners[2].y, k.corners[3].x, k.corners[3].y);
+            };
+            return tie(*this) < tie(other);
+        }
+    };
+
+    std::map<Key, image8u> tiles_;
+    Stats last_;
+};
 
 void printGrid(std::ostream& os, const PuzzleAssemblyResult& r);
@@ -0,0 +1,173 @@
+#include "puzzle_assembly.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/fast_random.h>
+
+#include <limits>
+#include <sstream>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "puzzle_solver.h"
+#include "tests_utils.h"
+
+namespace {
+
+struct AssemblyInput final {
+    SyntheticPuzzle puzzle;
+    PuzzlePieces pieces;
+    std::vector<std::vector<MatchedSide>> matched;
+    std::vector<std::vector<MatchedSide>> groundTruth;
+};
+
+AssemblyInput assemblyInput(int rows, int cols, std::uint32_t seed) {
+    AssemblyInput input;
+    input.puzzle = smallSyntheticPuzzle(rows, cols, seed);
+    const PuzzleSolver solver;
+    const PuzzleSegmentation segmentation = solver.segment(input.puzzle.image);
+    input.pieces = solver.extractPieces(input.puzzle.image, segmentation.mask, segmentation.roi);
+    input.matched = solver.match(input.pieces, solver.describeSides(input.pieces, input.puzzle.image));
+    input.groundTruth = syntheticGroundTruth(input.puzzle, input.pieces);
+    return input;
+}
+
+PuzzleAssemblyResult assemble(const AssemblyInput &input, const std::vector<std::vector<MatchedSide>> &matched,
+                              AssemblyMethod method) {
+    return assemblePuzzle(input.pieces.images, input.pieces.masks, input.pieces.corners, matched, method, AssemblyOutputGridOnly);
+}
+
+// The grid of the assembly or the message it failed with
+std::string assemblyOutcome(const AssemblyInput &input, const std::vector<std::vector<MatchedSide>> &matched, AssemblyMethod method,
+                            int threads) {
+#ifdef _OPENMP
+    const int previous = omp_get_max_threads();
+    omp_set_num_threads(threads);
+#endif
+    std::ostringstream out;
+    try {
+        printGrid(out, assemble(input, matched, method));
+    } catch (const std::exception &e) {
+        out << "failed: " << e.what();
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(previous);
+#endif
+    return out.str();
+}
+
+} // namespace
+
+TEST(puzzle_assembly, candidatesKeepBestWithLaterFirstAmongEqual) {
+    SideCandidates candidates;
+    candidates.insert({1, 0, 5.0f});
+    candidates.insert({2, 0, 3.0f});
+    candidates.insert({3, 0, 5.0f}); // equal to the first one, considered later - goes before it
+    candidates.insert({4, 0, 9.0f});
+    ASSERT_EQ(candidates.size, SideCandidates::capacity);
+    EXPECT_EQ(candidates.items[0].objB, 2);
+    EXPECT_EQ(candidates.items[1].objB, 3);
+    EXPECT_EQ(candidates.items[2].objB, 1);
+    EXPECT_EQ(candidates.items[3].objB, 4);
+
+    candidates.insert({5, 0, 10.0f}); // worse than all of them
+    EXPECT_EQ(candidates.items[3].objB, 4);
+    candidates.insert({6, 0, 9.0f}); // equal to the worst one - replaces it
+    EXPECT_EQ(candidates.items[3].objB, 6);
+    candidates.insert({7, 0, 1.0f});
+    ASSERT_EQ(candidates.size, SideCandidates::capacity);
+    EXPECT_EQ(candidates.items[0].objB, 7);
+    EXPECT_EQ(candidates.items[3].objB, 1);
+}
+
+TEST(puzzle_assembly, considerTakesTheLastOfEqualDifferences) {
+    MatchedSide side;
+    side.consider(1, 2, 4.0f);
+    EXPECT_EQ(side.objB, 1);
+    EXPECT_EQ(side.differenceSecondBest, -1.0f);
+
+    side.consider(2, 3, 6.0f); // worse - neither the best nor the second best changes
+    EXPECT_EQ(side.objB, 1);
+    EXPECT_EQ(side.differenceBest, 4.0f);
+    EXPECT_EQ(side.differenceSecondBest, -1.0f);
+
+    side.consider(3, 0, 4.0f); // equal - the later one wins, the old best becomes the second
+    EXPECT_EQ(side.objB, 3);
+    EXPECT_EQ(side.sideB, 0);
+    EXPECT_EQ(side.differenceBest, 4.0f);
+    EXPECT_EQ(side.differenceSecondBest, 4.0f);
+
+    side.consider(4, 1, std::numeric_limits<float>::infinity()); // abandoned comparison
+    EXPECT_EQ(side.objB, 3);
+    EXPECT_EQ(side.candidates.size, 3);
+}
+
+TEST(puzzle_assembly, firstCandidateIsTheBestMatch) {
+    FastRandom r(31);
+    for (int iter = 0; iter < 200; ++iter) {
+        MatchedSide side;
+        const int n = r.nextInt(1, 40);
+        for (int k = 0; k < n; ++k) side.consider(k / 4, k % 4, static_cast<float>(r.nextInt(0, 8))); // many ties
+        ASSERT_GT(side.candidates.size, 0);
+        EXPECT_EQ(side.candidates.items[0].objB, side.objB);
+        EXPECT_EQ(side.candidates.items[0].sideB, side.sideB);
+        EXPECT_EQ(side.candidates.items[0].cost, side.differenceBest);
+        for (int k = 1; k < side.candidates.size; ++k) EXPECT_LE(side.candidates.items[k - 1].cost, side.candidates.items[k].cost);
+    }
+}
+
+TEST(puzzle_assembly, greedyAssemblesGroundTruth) {
+    for (std::uint32_t seed : {239u, 17u}) {
+        SCOPED_TRACE("seed " + std::to_string(seed));
+        const AssemblyInput input = assemblyInput(4, 5, seed);
+        expectAssembledAsGroundTruth(assemble(input, input.matched, AssemblyMethod::Greedy), input.groundTruth);
+    }
+}
+
+TEST(puzzle_assembly, greedyToleratesAmbiguousBestMatches) {
+    const AssemblyInput input = assemblyInput(4, 5, 17);
+    // a few true matches lose to their runner-up, as with repeated texture: the wrong candidate is the cheapest one,
+    // the best buddies of these sides are no longer mutual, but the true edges are still among the candidates
+    std::vector<std::vector<MatchedSide>> ambiguous = input.matched;
+    int spoiled = 0;
+    for (std::size_t obj = 0; obj < ambiguous.size() && spoiled < 3; obj += 3) {
+        for (MatchedSide &side : ambiguous[obj]) {
+            if (side.objB < 0 || side.candidates.size < 2) continue;
+            SideCandidate &best = side.candidates.items[0];
+            SideCandidate &second = side.candidates.items[1];
+            std::swap(best.objB, second.objB);
+            std::swap(best.sideB, second.sideB);
+            side.objB = best.objB;
+            side.sideB = best.sideB;
+            ++spoiled;
+            break;
+        }
+    }
+    ASSERT_EQ(spoiled, 3);
+    EXPECT_LT(scoreMatches(input.groundTruth, ambiguous).correct, scoreMatches(input.groundTruth, input.matched).correct);
+    expectAssembledAsGroundTruth(assemble(input, ambiguous, AssemblyMethod::Greedy), input.groundTruth);
+}
+
+TEST(puzzle_assembly, parallelAttemptsEqualSerial) {
+    const AssemblyInput input = assemblyInput(4, 5, 5);
+    FastRandom r(5);
+    for (int variant = 0; variant < 12; ++variant) {
+        SCOPED_TRACE("variant " + std::to_string(variant));
+        // variant 0 - the true matches, then more and more wrong best matches, so that the earlier corners
+        // (and later all of them) fail or throw and the cancelled attempts must not change which one decides
+        std::vector<std::vector<MatchedSide>> matched = input.matched;
+        for (int k = 0; k < variant; ++k) {
+            MatchedSide &side = matched[r.nextInt(0, static_cast<int>(matched.size()) - 1)][r.nextInt(0, 3)];
+            side.objB = r.nextInt(0, static_cast<int>(matched.size()) - 1);
+            side.sideB = r.nextInt(0, 3);
+        }
+        for (AssemblyMethod method : {AssemblyMethod::CornerBFS, AssemblyMethod::Greedy}) {
+            const std::string serial = assemblyOutcome(input, matched, method, 1);
+            EXPECT_EQ(assemblyOutcome(input, matched, method, 4), serial);
+            if (variant == 0) EXPECT_EQ(serial.find("failed"), std::string::npos);
+        }
+    }
+}
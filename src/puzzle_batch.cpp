@@ -0,0 +1,63 @@
+#include "puzzle_batch.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include <libbase/cpu_budget.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/timer.h>
+#include <libimages/async_io.h>
+#include <libimages/image_io.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+PuzzleBatchStats solveBatch(const PuzzleSolver &solver, const std::vector<std::string> &paths, const PuzzleBatchCallback &onSolved,
+                            const PuzzleBatchOptions &options, unsigned outputs) {
+    rassert(options.concurrentImages >= 0, 90400001, options.concurrentImages);
+    rassert(options.threadsPerImage >= 0, 90400002, options.threadsPerImage);
+
+    const int n = static_cast<int>(paths.size());
+    int threads = availableCpus();
+#ifdef _OPENMP
+    threads = std::min(threads, omp_get_max_threads()); // respects OMP_NUM_THREADS
+#endif
+    PuzzleBatchStats stats;
+    stats.images = n;
+    stats.concurrentImages = options.concurrentImages > 0 ? options.concurrentImages : std::clamp(n, 1, threads);
+    stats.threadsPerImage = options.threadsPerImage > 0 ? options.threadsPerImage : std::max(1, threads / stats.concurrentImages);
+
+    Timer t;
+    std::mutex mutex;
+#ifdef _OPENMP
+    const int levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(std::max(levels, 2)); // otherwise the kernels of an image would run on one thread
+#endif
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(stats.concurrentImages)
+    for (int i = 0; i < n; ++i) {
+#ifdef _OPENMP
+        omp_set_num_threads(stats.threadsPerImage); // only for the parallel regions opened by this image
+#endif
+        const ThreadBudgetScope budget(stats.threadsPerImage); // and at most as many for its parallelFor loops
+        try {
+            PuzzleSolution solution = solver.solve(load_image(paths[i]), outputs);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (onSolved) onSolved(i, solution);
+        } catch (const std::exception &e) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.errors.emplace_back(i, e.what());
+        }
+    }
+#ifdef _OPENMP
+    omp_set_max_active_levels(levels);
+#endif
+    stats.seconds = t.elapsed();
+    std::sort(stats.errors.begin(), stats.errors.end());
+    return stats;
+}
+
+coro::Task<PuzzleSolution> solveAsync(const PuzzleSolver &solver, std::string path, unsigned outputs, TaskScheduler &scheduler) {
+    const image8u image = co_await loadAsync(std::move(path), scheduler);
+    co_return solver.solve(image, outputs);
+}
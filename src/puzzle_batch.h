@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libbase/coro_task.h>
+#include <libbase/task_scheduler.h>
+
+#include "puzzle_solver.h"
+
+struct PuzzleBatchOptions final {
+    // Images solved at the same time, 0 - as many as there are threads (but not more than images)
+    int concurrentImages = 0;
+    // OpenMP threads of the kernels of one image (blur, morphology, matching...), 0 - threads / concurrentImages,
+    // so that both levels together do not oversubscribe the cores
+    int threadsPerImage = 0;
+};
+
+struct PuzzleBatchStats final {
+    int images = 0;
+    int concurrentImages = 0;
+    int threadsPerImage = 0;
+    double seconds = 0.0;
+    std::vector<std::pair<int, std::string>> errors; // index in paths and what() of the images that failed
+
+
+    double imagesPerSecond() const noexcept { return seconds > 0.0 ? images / seconds : 0.0; }
+};
+
+// Called for every solved image (index in paths), one call at a time, in the order in which images are solved
+using PuzzleBatchCallback = std::function<void(int index, PuzzleSolution &solution)>;
+
+// Loads and solves (PuzzleSolver::solve) all images, concurrentImages of them at once on one OpenMP team,
+// every image with its own nested team of threadsPerImage threads. Without OpenMP images are solved one by one.
+// An image that fails (to load or to be solved) is only recorded in errors, the others are still processed.
+PuzzleBatchStats solveBatch(const PuzzleSolver &solver, const std::vector<std::string> &paths, const PuzzleBatchCallback &onSolved,
+                            const PuzzleBatchOptions &options = {}, unsigned outputs = AssemblyOutputAll);
+
+// Awaitable load + solve of one photo (see libbase/coro_task.h): decoding runs on an I/O thread, the stages continue
+// on a scheduler worker, so that coro::whenAll over several photos overlaps decoding of some with solving of others.
+// Errors (of loading or of a stage) are rethrown to the awaiting coroutine.
+coro::Task<PuzzleSolution> solveAsync(const PuzzleSolver &solver, std::string path, unsigned outputs = AssemblyOutputAll,
+                                      TaskScheduler &scheduler = TaskScheduler::global());
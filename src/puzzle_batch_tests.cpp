@@ -0,0 +1,76 @@
+#include "puzzle_batch.h"
+
+#include <gtest/gtest.h>
+
+#include <libimages/image_io.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tests_utils.h"
+
+namespace {
+
+// Photos of two small synthetic puzzles
+std::vector<std::string> savePhotos(const std::string &dir) {
+    const std::vector<std::string> paths = {dir + "photo_239.png", dir + "photo_17.png"};
+    save_image(smallSyntheticPuzzle(3, 4, 239).image, paths[0]);
+    save_image(smallSyntheticPuzzle(4, 5, 17).image, paths[1]);
+    return paths;
+}
+
+void expectSameSolutions(const PuzzleSolution &a, const PuzzleSolution &b) {
+    expectSamePieces(a.pieces, b.pieces);
+    expectSameDescriptors(a.descriptors, b.descriptors);
+    expectSameMatches(a.matchedSides, b.matchedSides);
+    expectSameAssembly(a.assembly, b.assembly);
+}
+
+} // namespace
+
+TEST(puzzle_batch, whenAllOfSolveAsyncEqualsSolve) {
+    const std::vector<std::string> paths = savePhotos(getUnitCaseDebugDir());
+    const PuzzleSolver solver;
+    std::vector<coro::Task<PuzzleSolution>> tasks;
+    for (const std::string &path: paths) tasks.push_back(solveAsync(solver, path));
+    const std::vector<PuzzleSolution> solutions = coro::syncWait(coro::whenAll(std::move(tasks)));
+    ASSERT_EQ(solutions.size(), paths.size());
+    for (std::size_t k = 0; k < paths.size(); ++k) {
+        SCOPED_TRACE(paths[k]);
+        expectSameSolutions(solutions[k], solver.solve(load_image(paths[k])));
+    }
+}
+
+TEST(puzzle_batch, solveAsyncRethrowsErrors) {
+    const std::vector<std::string> paths = savePhotos(getUnitCaseDebugDir());
+    const PuzzleSolver solver;
+    EXPECT_ANY_THROW(coro::syncWait(solveAsync(solver, paths[0] + ".missing")));
+
+    std::vector<coro::Task<PuzzleSolution>> tasks;
+    tasks.push_back(solveAsync(solver, paths[0]));
+    tasks.push_back(solveAsync(solver, paths[1] + ".missing"));
+    EXPECT_ANY_THROW(coro::syncWait(coro::whenAll(std::move(tasks))));
+}
+
+TEST(puzzle_batch, solveBatchEqualsSolve) {
+    std::vector<std::string> paths = savePhotos(getUnitCaseDebugDir());
+    paths.insert(paths.begin() + 1, paths[0] + ".missing");
+    const PuzzleSolver solver;
+    std::map<int, PuzzleSolution> solutions;
+    PuzzleBatchOptions options;
+    options.concurrentImages = 2;
+    const PuzzleBatchStats stats = solveBatch(solver, paths, [&](int index, PuzzleSolution &solution) {
+        EXPECT_TRUE(solutions.emplace(index, std::move(solution)).second);
+    }, options);
+    EXPECT_EQ(stats.images, 3);
+    ASSERT_EQ(stats.errors.size(), 1u);
+    EXPECT_EQ(stats.errors[0].first, 1);
+    ASSERT_EQ(solutions.size(), 2u);
+    for (int index: {0, 2}) {
+        SCOPED_TRACE(paths[index]);
+        ASSERT_EQ(solutions.count(index), 1u);
+        expectSameSolutions(solutions[index], solver.solve(load_image(paths[index])));
+    }
+}
@@ -0,0 +1,172 @@
+#include "puzzle_service.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <libbase/timer.h>
+#include <libimages/image_io.h>
+
+namespace {
+
+void writeError(std::ostream &out, std::string what) {
+    std::replace(what.begin(), what.end(), '\n', ' '); // one line, the framing of the next response must stay intact
+    out << "error " << what << "\n";
+    out.flush();
+}
+
+double parseNumber(const std::string &key, const std::string &value) {
+    std::size_t end = 0;
+    double result = 0.0;
+    try {
+        result = std::stod(value, &end);
+    } catch (const std::exception &) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size()) throw std::invalid_argument("bad value of " + key + ": " + value);
+    return result;
+}
+
+// key=value tokens on top of the defaults, returns whether the canvas is requested
+bool parseOptions(std::istringstream &args, PuzzleSolverOptions &options) {
+    bool png = false;
+    std::string token;
+    while (args >> token) {
+        const std::size_t eq = token.find('=');
+        if (eq == std::string::npos) throw std::invalid_argument("expected key=value: " + token);
+        const std::string key = token.substr(0, eq), value = token.substr(eq + 1);
+        if (key == "threshold_scale") {
+            options.thresholdScale = parseNumber(key, value);
+        } else if (key == "threshold_percentile") {
+            options.thresholdPercentile = parseNumber(key, value);
+        } else if (key == "blur") {
+            options.sideBlurStrength = static_cast<float>(parseNumber(key, value));
+        } else if (key == "assembly") {
+            if (value == "corner_bfs") {
+                options.assemblyMethod = AssemblyMethod::CornerBFS;
+            } else if (value == "greedy") {
+                options.assemblyMethod = AssemblyMethod::Greedy;
+            } else {
+                throw std::invalid_argument("unknown assembly: " + value);
+            }
+        } else if (key == "png") {
+            if (value != "0" && value != "1") throw std::invalid_argument("bad value of png: " + value);
+            png = value == "1";
+        } else {
+            throw std::invalid_argument("unknown option: " + key);
+        }
+    }
+    return png;
+}
+
+} // namespace
+
+PuzzleService::PuzzleService(const PuzzleSolverOptions &defaults) : defaults_(defaults) {
+    (void) PuzzleSolver(defaults_); // the defaults are validated once, not with the first job
+}
+
+void PuzzleService::serve(std::istream &in, std::ostream &out) {
+    while (serveOne(in, out)) {
+    }
+}
+
+bool PuzzleService::serveOne(std::istream &in, std::ostream &out) {
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    std::string args;
+    std::getline(words, args);
+
+    if (command == "quit") return false;
+    if (command == "solve" || command == "frame") {
+        solve(args, in, out, command == "frame");
+    } else if (command == "stats") {
+        out << "stats jobs=" << stats_.jobs << " errors=" << stats_.errors << "\n";
+        out << "latency " << stats_.latencyMs.summary() << "\n";
+        out << "decode " << stats_.decodeMs.summary() << "\n";
+        out << "solve " << stats_.solveMs.summary() << "\n";
+        out.flush();
+    } else if (!command.empty()) {
+        writeError(out, "unknown command: " + command);
+    }
+    return true;
+}
+
+void PuzzleService::solve(const std::string &args, std::istream &in, std::ostream &out, bool frame) {
+    ++stats_.jobs;
+    std::istringstream words(args);
+    long long size = -1;
+    if (!(words >> size) || size < 0) {
+        ++stats_.errors;
+        writeError(out, "expected: solve|frame <bytes> [key=value ...]"); // no payload can be skipped without its size
+        return;
+    }
+    if (static_cast<unsigned long long>(size) > maxImageBytes) {
+        in.ignore(size);
+        ++stats_.errors;
+        writeError(out, "image is larger than " + std::to_string(maxImageBytes) + " bytes");
+        return;
+    }
+    std::vector<std::uint8_t> bytes(static_cast<std::size_t>(size));
+    in.read(reinterpret_cast<char *>(bytes.data()), size);
+    if (in.gcount() != size) {
+        ++stats_.errors;
+        writeError(out, "truncated image: " + std::to_string(in.gcount()) + " of " + std::to_string(size) + " bytes");
+        return;
+    }
+
+    Timer total_t;
+    try {
+        PuzzleSolverOptions options = defaults_;
+        const bool png = parseOptions(words, options);
+        const PuzzleSolver solver(options);
+
+        Timer t;
+        const image8u image = load_image_from_memory(bytes);
+        stats_.decodeMs.add(1000.0 * t.elapsed());
+        t.restart();
+        const unsigned outputs = png ? AssemblyOutputCanvas : AssemblyOutputGridOnly;
+        PuzzleAssemblyResult assembly;
+        VideoFrameStats frameStats;
+        if (frame) {
+            const PuzzleSolverOptions &current = video_ ? video_->solver().options() : options;
+            if (!video_ || current.thresholdScale != options.thresholdScale || current.thresholdPercentile != options.thresholdPercentile
+                || current.sideBlurStrength != options.sideBlurStrength) {
+                video_ = std::make_unique<VideoSegmenter>(options);
+            }
+            frameStats = video_->update(image);
+            assembly = solver.assemble(video_->pieces(), solver.match(video_->pieces(), video_->descriptors()), outputs);
+        } else {
+            assembly = solver.solve(image, outputs).assembly;
+        }
+        stats_.solveMs.add(1000.0 * t.elapsed());
+
+        const std::vector<std::uint8_t> canvas = png ? encode_image(assembly.assembled, "png", save_options(SavePreset::Fast))
+                                                     : std::vector<std::uint8_t>();
+        out << "ok " << assembly.W << " " << assembly.H << " " << canvas.size();
+        if (frame) {
+            out << " changed=" << frameStats.changedTiles << "/" << frameStats.tiles
+                << " updated=" << frameStats.updatedPieces << "/" << frameStats.pieces;
+        }
+        out << "\n";
+        for (int y = 0; y < assembly.H; ++y) {
+            for (int x = 0; x < assembly.W; ++x) {
+                const PlacedPiece &piece = assembly.grid[y * assembly.W + x];
+                out << (x > 0 ? " " : "") << piece.obj << ":" << piece.rot90;
+            }
+            out << "\n";
+        }
+        out.write(reinterpret_cast<const char *>(canvas.data()), static_cast<std::streamsize>(canvas.size()));
+        out.flush();
+    } catch (const std::exception &e) {
+        ++stats_.errors;
+        writeError(out, e.what());
+    }
+    stats_.latencyMs.add(1000.0 * total_t.elapsed());
+}
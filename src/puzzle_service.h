@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include <libbase/stats_accumulator.h>
+
+#include "puzzle_solver.h"
+#include "video_segmenter.h"
+
+// Per-request latencies (milliseconds, from the end of reading the request to the end of writing the response),
+// histograms of 1 ms buckets up to 10 s
+struct PuzzleServiceStats final {
+    int jobs = 0;
+    int errors = 0;
+    stats::Accumulator<double> latencyMs{0.0, 10000.0, 10000};
+    stats::Accumulator<double> decodeMs{0.0, 10000.0, 10000};
+    stats::Accumulator<double> solveMs{0.0, 10000.0, 10000};
+};
+
+// Long-running solver: jobs are read one after another from one stream and the results are written to another one,
+// so that the process, the task scheduler, the image pools and the caches of the kernels stay warm between jobs.
+// Text lines with binary payloads (stdin/stdout of the process, or a socket attached to them):
+//   solve <bytes> [key=value ...]\n<bytes of a PNG/JPEG>
+//       keys: threshold_scale, threshold_percentile, blur (sideBlurStrength), assembly (corner_bfs|greedy),
+//             png (0|1 - send the assembled canvas back), the others are the options the service was created with
+//   -> ok <W> <H> <png bytes>\n
+//      H lines of W "obj:rot90" cells\n
+//      <png bytes of the assembled canvas>
+//   -> error <what>\n (the service keeps serving)
+//   frame <bytes> [key=value ...]\n<bytes of a PNG/JPEG>
+//       the next frame of a video of the same scene: segmented incrementally (see VideoSegmenter), a frame with other
+//       segmentation or blur options starts a new video
+//   -> the same as for solve, the ok line ends with changed=<tiles>/<tiles> updated=<pieces>/<pieces>
+//   stats\n -> stats jobs=<n> errors=<n>\n latency <summary>\n decode <summary>\n solve <summary>\n
+//   quit\n (or the end of the input stream) - serve returns
+class PuzzleService final {
+public:
+    // Larger payloads are refused (and skipped) without being buffered
+    static constexpr std::size_t maxImageBytes = std::size_t(256) << 20;
+
+    explicit PuzzleService(const PuzzleSolverOptions &defaults);
+
+    // Serves requests until quit or the end of in
+    void serve(std::istream &in, std::ostream &out);
+    // Reads and answers one request, false on quit or the end of in
+    bool serveOne(std::istream &in, std::ostream &out);
+
+    const PuzzleServiceStats &stats() const noexcept { return stats_; }
+
+private:
+    void solve(const std::string &args, std::istream &in, std::ostream &out, bool frame);
+
+    PuzzleSolverOptions defaults_;
+    PuzzleServiceStats stats_;
+    std::unique_ptr<VideoSegmenter> video_; // of the frame jobs
+};
@@ -0,0 +1,150 @@
+#include "puzzle_service.h"
+
+#include <gtest/gtest.h>
+
+#include <libimages/image_io.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tests_utils.h"
+
+namespace {
+
+std::string request(const std::string &command, const std::vector<std::uint8_t> &bytes, const std::string &options = "") {
+    std::string result = command + " " + std::to_string(bytes.size()) + (options.empty() ? "" : " " + options) + "\n";
+    result.append(bytes.begin(), bytes.end());
+    return result;
+}
+
+// The grid lines of assembly, as the service writes them after the ok line
+std::string expectedGrid(const PuzzleAssemblyResult &assembly) {
+    std::ostringstream out;
+    for (int y = 0; y < assembly.H; ++y) {
+        for (int x = 0; x < assembly.W; ++x) {
+            const PlacedPiece &piece = assembly.grid[y * assembly.W + x];
+            out << (x > 0 ? " " : "") << piece.obj << ":" << piece.rot90;
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+std::string readLine(std::istream &in) {
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+} // namespace
+
+TEST(puzzle_service, solveAnswersAsSolver) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle();
+    const std::vector<std::uint8_t> png = encode_image(puzzle.image, "png", save_options(SavePreset::Fast));
+    PuzzleSolverOptions greedyOptions;
+    greedyOptions.assemblyMethod = AssemblyMethod::Greedy;
+    const PuzzleAssemblyResult expected = PuzzleSolver().solve(puzzle.image).assembly;
+    const PuzzleAssemblyResult greedy = PuzzleSolver(greedyOptions).solve(puzzle.image, AssemblyOutputGridOnly).assembly;
+
+    std::istringstream in(request("solve", png) + request("solve", png, "png=1") + request("solve", png, "assembly=greedy") + "quit\n"
+                          + request("solve", png));
+    std::ostringstream out;
+    PuzzleService service{PuzzleSolverOptions()};
+    service.serve(in, out);
+    EXPECT_EQ(service.stats().jobs, 3); // nothing after quit is read
+    EXPECT_EQ(service.stats().errors, 0);
+
+    std::istringstream answers(out.str());
+    const std::string size = std::to_string(expected.W) + " " + std::to_string(expected.H);
+    EXPECT_EQ(readLine(answers), "ok " + size + " 0");
+    std::string grid;
+    for (int y = 0; y < expected.H; ++y) grid += readLine(answers) + "\n";
+    EXPECT_EQ(grid, expectedGrid(expected));
+
+    const std::string withCanvas = readLine(answers);
+    ASSERT_EQ(withCanvas.rfind("ok " + size + " ", 0), 0u) << withCanvas;
+    const std::size_t canvasBytes = std::stoul(withCanvas.substr(withCanvas.rfind(' ') + 1));
+    for (int y = 0; y < expected.H; ++y) readLine(answers);
+    std::vector<std::uint8_t> canvas(canvasBytes);
+    answers.read(reinterpret_cast<char *>(canvas.data()), static_cast<std::streamsize>(canvasBytes));
+    ASSERT_EQ(static_cast<std::size_t>(answers.gcount()), canvasBytes);
+    expectSameImages(load_image_from_memory(canvas), expected.assembled);
+
+    EXPECT_EQ(readLine(answers), "ok " + std::to_string(greedy.W) + " " + std::to_string(greedy.H) + " 0");
+    grid.clear();
+    for (int y = 0; y < greedy.H; ++y) grid += readLine(answers) + "\n";
+    EXPECT_EQ(grid, expectedGrid(greedy));
+    EXPECT_EQ(readLine(answers), "");
+    EXPECT_TRUE(answers.eof());
+}
+
+TEST(puzzle_service, errorsKeepServing) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle();
+    const std::vector<std::uint8_t> png = encode_image(puzzle.image, "png", save_options(SavePreset::Fast));
+    const PuzzleAssemblyResult expected = PuzzleSolver().solve(puzzle.image, AssemblyOutputGridOnly).assembly;
+    const std::vector<std::uint8_t> garbage = {1, 2, 3, 4, 5};
+
+    std::istringstream in("hello\n" + request("solve", png, "blur") + request("solve", png, "assembly=none")
+                          + request("solve", png, "threshold_scale=x") + request("solve", garbage)
+                          + "solve " + std::to_string(PuzzleService::maxImageBytes + 1) + "\n" // skipped to the end of in
+                          + request("solve", png));
+    std::ostringstream out;
+    PuzzleService service{PuzzleSolverOptions()};
+    EXPECT_TRUE(service.serveOne(in, out)); // unknown command
+    for (int k = 0; k < 5; ++k) EXPECT_TRUE(service.serveOne(in, out));
+    EXPECT_FALSE(service.serveOne(in, out));
+    EXPECT_EQ(service.stats().jobs, 5);
+    EXPECT_EQ(service.stats().errors, 5);
+
+    std::istringstream answers(out.str());
+    EXPECT_EQ(readLine(answers), "error unknown command: hello");
+    EXPECT_EQ(readLine(answers), "error expected key=value: blur");
+    EXPECT_EQ(readLine(answers), "error unknown assembly: none");
+    EXPECT_EQ(readLine(answers), "error bad value of threshold_scale: x");
+    EXPECT_EQ(readLine(answers).rfind("error ", 0), 0u); // not an image
+    EXPECT_EQ(readLine(answers), "error image is larger than " + std::to_string(PuzzleService::maxImageBytes) + " bytes");
+    EXPECT_EQ(readLine(answers), "");
+
+    // jobs after the errors
+    std::istringstream after(request("solve", png) + "solve 100\nshort");
+    std::ostringstream afterOut;
+    service.serve(after, afterOut);
+    std::istringstream afterAnswers(afterOut.str());
+    EXPECT_EQ(readLine(afterAnswers), "ok " + std::to_string(expected.W) + " " + std::to_string(expected.H) + " 0");
+    for (int y = 0; y < expected.H; ++y) readLine(afterAnswers);
+    EXPECT_EQ(readLine(afterAnswers), "error truncated image: 5 of 100 bytes");
+    EXPECT_EQ(service.stats().jobs, 7);
+    EXPECT_EQ(service.stats().errors, 6);
+}
+
+TEST(puzzle_service, framesAreSegmentedIncrementally) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle();
+    const std::vector<std::uint8_t> png = encode_image(puzzle.image, "png", save_options(SavePreset::Fast));
+    const PuzzleAssemblyResult expected = PuzzleSolver().solve(puzzle.image, AssemblyOutputGridOnly).assembly;
+
+    std::istringstream in(request("frame", png) + request("frame", png) + request("frame", png, "threshold_scale=1.6") + "stats\n");
+    std::ostringstream out;
+    PuzzleService service{PuzzleSolverOptions()};
+    service.serve(in, out);
+
+    std::istringstream answers(out.str());
+    const std::string ok = "ok " + std::to_string(expected.W) + " " + std::to_string(expected.H) + " 0";
+    const std::string first = readLine(answers);
+    EXPECT_EQ(first.rfind(ok + " changed=", 0), 0u) << first;
+    EXPECT_NE(first.find(" updated=12/12"), std::string::npos) << first;
+    std::string grid;
+    for (int y = 0; y < expected.H; ++y) grid += readLine(answers) + "\n";
+    EXPECT_EQ(grid, expectedGrid(expected));
+
+    const std::string second = readLine(answers);
+    EXPECT_EQ(second.rfind(ok + " changed=0/", 0), 0u) << second;
+    EXPECT_NE(second.find(" updated=0/12"), std::string::npos) << second;
+    for (int y = 0; y < expected.H; ++y) readLine(answers);
+
+    const std::string third = readLine(answers); // other segmentation options - a new video
+    EXPECT_NE(third.find(" updated=12/12"), std::string::npos) << third;
+    for (int y = 0; y < expected.H; ++y) readLine(answers);
+    EXPECT_EQ(readLine(answers), "stats jobs=3 errors=0");
+}
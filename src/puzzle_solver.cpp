@@ -0,0 +1,193 @@
+#include "puzzle_solver.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <libbase/cpu_budget.h>
+#include <libbase/profiler.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/stats.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/algorithms/coarse_to_fine_mask.h>
+#include <libimages/algorithms/extract_contour.h>
+#include <libimages/algorithms/grayscale.h>
+#include <libimages/algorithms/simplify_contours.h>
+#include <libimages/algorithms/split_into_parts.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/image_view.h>
+
+PuzzleSolver::PuzzleSolver(const PuzzleSolverOptions &options) : options_(options) {
+    rassert(options_.thresholdPercentile >= 0.0 && options_.thresholdPercentile <= 100.0, 90300001, options_.thresholdPercentile);
+    rassert(!options_.morphology.empty(), 90300002);
+    rassert(options_.coarseScale >= 1 && (options_.coarseScale & (options_.coarseScale - 1)) == 0, 90300009, options_.coarseScale);
+}
+
+PuzzleSegmentation PuzzleSolver::segment(const image8u &image, bool keepSteps) const {
+    return segment(image, nullptr, keepSteps);
+}
+
+PuzzleSegmentation PuzzleSolver::segment(pyramid8u &photo, bool keepSteps) const {
+    return segment(photo.level(0), &photo, keepSteps);
+}
+
+PuzzleSegmentation PuzzleSolver::segment(const image8u &image, pyramid8u *pyramid, bool keepSteps) const {
+    PROFILE_SCOPE("segment");
+    const ThreadBudgetScope budget(stageThreads("segment"));
+    auto [w, h, c] = image.size();
+    rassert(c == 3, 90300003, c);
+
+    PuzzleSegmentation result;
+    result.borderIntensities = grayscale_border(image);
+    rassert(result.borderIntensities.size() == 2 * w + 2 * h - 4, 90300004, result.borderIntensities.size(), w, h);
+    result.backgroundThreshold = backgroundThreshold(result.borderIntensities);
+
+    result.roi.include_pixel(0, 0);
+    result.roi.include_pixel(w - 1, h - 1);
+    if (options_.coarseScale > 1 && !keepSteps) {
+        CoarseToFineOptions coarseToFine;
+        coarseToFine.scale = options_.coarseScale;
+        result.mask = pyramid ? thresholdMorphologyCoarseToFine(*pyramid, result.backgroundThreshold, options_.morphology, coarseToFine, options_.with_openmp)
+                              : thresholdMorphologyCoarseToFine(image, result.backgroundThreshold, options_.morphology, coarseToFine, options_.with_openmp);
+        return result;
+    }
+    result.thresholded = threshold_grayscale_bitmask(image, result.backgroundThreshold);
+
+    // farther than the support of the morphology from the thresholded foreground the mask is zero anyway,
+    // and within the roi the zero padding of its border is what the pixels around are, so the result is the same
+    int support = 0;
+    for (const morphology::Op &op: options_.morphology) support += op.strength;
+    const bbox2i foreground = result.thresholded.bounds();
+    if (!foreground.is_empty()) {
+        result.roi = bbox2i();
+        result.roi.include_pixel(std::max(0, foreground.min.x - support), std::max(0, foreground.min.y - support));
+        result.roi.include_pixel(std::min(w, foreground.max.x + support) - 1, std::min(h, foreground.max.y + support) - 1);
+    }
+    if (result.roi.width() == w && result.roi.height() == h) {
+        result.mask = morphology::pipeline(result.thresholded, options_.morphology, options_.with_openmp, keepSteps ? &result.steps : nullptr);
+        return result;
+    }
+
+    const point2i origin = result.roi.min;
+    std::vector<BitMask> steps;
+    const BitMask mask = morphology::pipeline(result.thresholded.crop(origin.x, origin.y, result.roi.width(), result.roi.height()),
+                                              options_.morphology, options_.with_openmp, keepSteps ? &steps : nullptr);
+    result.mask = BitMask(w, h);
+    result.mask.paste(mask, origin.x, origin.y);
+    for (const BitMask &step: steps) {
+        result.steps.emplace_back(w, h);
+        result.steps.back().paste(step, origin.x, origin.y);
+    }
+    return result;
+}
+
+double PuzzleSolver::backgroundThreshold(const std::vector<float> &borderIntensities) const {
+    return options_.thresholdScale * stats::percentile(borderIntensities, options_.thresholdPercentile);
+}
+
+PuzzlePieces PuzzleSolver::extractPieces(const image8u &image, const BitMask &mask, const bbox2i &roi,
+                                         ObjectLabels *labels) const {
+    PROFILE_SCOPE("extractPieces");
+    const ThreadBudgetScope budget(stageThreads("extractPieces"));
+    PuzzlePieces pieces;
+    if (roi.is_empty() || (roi.width() == mask.width() && roi.height() == mask.height())) {
+        std::tie(pieces.offsets, pieces.images, pieces.masks) = splitObjects(image, mask, options_.with_openmp, labels);
+    } else {
+        // pieces are cut straight from the roi of the photo, without a copy of the roi
+        std::tie(pieces.offsets, pieces.images, pieces.masks) = splitObjects(
+            image8u_cview(image).subview(roi.min.x, roi.min.y, roi.width(), roi.height()),
+            mask.crop(roi.min.x, roi.min.y, roi.width(), roi.height()), options_.with_openmp, labels);
+        for (point2i &offset: pieces.offsets) offset += roi.min;
+    }
+
+    const int n = pieces.count();
+    pieces.contours.resize(n);
+    pieces.corners.resize(n);
+    // pieces are independent, each task writes only its own items
+    parallelForEach(0, n, [&](int obj) { tracePiece(pieces, obj); }, options_.with_openmp);
+    splitSides(pieces);
+    return pieces;
+}
+
+void PuzzleSolver::tracePiece(PuzzlePieces &pieces, int obj) const {
+    PROFILE_SCOPE("tracePiece");
+    pieces.contours[obj] = traceContour(pieces.masks[obj]);
+    pieces.corners[obj] = simplifyContour(pieces.contours[obj], 4);
+    rassert(pieces.corners[obj].size() == 4, 90300005, obj, pieces.corners[obj].size());
+}
+
+void PuzzleSolver::splitSides(PuzzlePieces &pieces) const {
+    PROFILE_SCOPE("splitSides");
+    pieces.sides = PieceSides::split(pieces.contours, pieces.corners, options_.with_openmp);
+    for (int obj = 0; obj < pieces.count(); ++obj) rassert(pieces.sides.sides(obj) == 4, 90300006, obj, pieces.sides.sides(obj));
+}
+
+PuzzleSideDescriptors PuzzleSolver::describeSides(const PuzzlePieces &pieces) const {
+    PROFILE_SCOPE("describeSides");
+    const ThreadBudgetScope budget(stageThreads("describeSides"));
+    PuzzleSideDescriptors descriptors(pieces.count());
+    parallelForEach(0, pieces.count(), [&](int obj) { descriptors[obj] = describePiece(pieces, obj); }, options_.with_openmp);
+    return descriptors;
+}
+
+PuzzleSideDescriptors PuzzleSolver::describeSides(const PuzzlePieces &pieces, const image8u &frame) const {
+    PROFILE_SCOPE("describeSides");
+    const ThreadBudgetScope budget(stageThreads("describeSides"));
+    rassert(frame.width() > 0 && frame.channels() == pieces.channels(), 90300010, frame.width(), frame.channels(), pieces.channels());
+    PuzzleSideDescriptors descriptors(pieces.count());
+    parallelForEach(0, pieces.count(), [&](int obj) { descriptors[obj] = describePiece(pieces, obj, frame); }, options_.with_openmp);
+    return descriptors;
+}
+
+std::vector<SideDescriptor> PuzzleSolver::describePiece(const PuzzlePieces &pieces, int obj, image8u_cview frame) const {
+    std::vector<SideDescriptor> descriptors;
+    if (frame.width() > 0) {
+        for (int side = 0; side < pieces.sides.sides(obj); ++side) {
+            descriptors.push_back(buildSideDescriptor(frame, pieces.offsets[obj], pieces.sides.side(obj, side), options_.sideInset,
+                                                      options_.sideBlurStrength));
+        }
+        return descriptors;
+    }
+    rassert(pieces.images[obj].channels() == pieces.channels(), 90300007, obj, pieces.images[obj].channels());
+    for (int side = 0; side < pieces.sides.sides(obj); ++side) {
+        descriptors.push_back(buildSideDescriptor(pieces.images[obj], pieces.sides.side(obj, side), options_.sideBlurStrength));
+    }
+    return descriptors;
+}
+
+std::vector<std::vector<MatchedSide>> PuzzleSolver::match(const PuzzlePieces &pieces, const PuzzleSideDescriptors &descriptors,
+                                                          const SideMatcher::Visitor &visitor, SideMatcherStats *stats,
+                                                          SideCosts *costs) const {
+    PROFILE_SCOPE("match");
+    const ThreadBudgetScope budget(stageThreads("match"));
+    rassert(static_cast<int>(descriptors.size()) == pieces.count(), 90300008, descriptors.size(), pieces.count());
+    return SideMatcher(descriptors, pieces.channels(), options_.matcher).match(options_.with_openmp, visitor, stats, costs);
+}
+
+PuzzleAssemblyResult PuzzleSolver::assemble(const PuzzlePieces &pieces, const std::vector<std::vector<MatchedSide>> &matchedSides,
+                                            unsigned outputs) const {
+    PROFILE_SCOPE("assemble");
+    const ThreadBudgetScope budget(stageThreads("assemble"));
+    return assemblePuzzle(pieces.images, pieces.masks, pieces.corners, matchedSides, options_.assemblyMethod, outputs);
+}
+
+image8u PuzzleSolver::render(const PuzzleAssemblyResult &assembly, const PuzzlePieces &pieces, bool withLines,
+                             WarpedTileCache *tiles) const {
+    PROFILE_SCOPE("render");
+    const ThreadBudgetScope budget(stageThreads("render"));
+    if (tiles) return tiles->render(assembly, pieces.images, pieces.masks, pieces.corners, withLines);
+    const int canvasW = std::accumulate(assembly.colW.begin(), assembly.colW.end(), 0);
+    const int canvasH = std::accumulate(assembly.rowH.begin(), assembly.rowH.end(), 0);
+    image8u canvas(canvasW, canvasH, 3);
+    renderAssembledBand(assembly, pieces.images, pieces.masks, pieces.corners, withLines, 0, canvas);
+    return canvas;
+}
+
+PuzzleSolution PuzzleSolver::solve(const image8u &image, unsigned outputs) const {
+    PuzzleSolution solution;
+    solution.segmentation = segment(image);
+    solution.pieces = extractPieces(image, solution.segmentation.mask, solution.segmentation.roi);
+    solution.descriptors = describeSides(solution.pieces, image);
+    solution.matchedSides = match(solution.pieces, solution.descriptors);
+    solution.assembly = assemble(solution.pieces, solution.matchedSides, outputs);
+    return solution;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+
+#include <libbase/bbox2.h>
+#include <libbase/point2.h>
+#include <libimages/algorithms/morphology.h>
+#include <libimages/algorithms/split_into_parts.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+#include <libimages/image_pyramid.h>
+
+#include "piece_sides.h"
+#include "puzzle_assembly.h"
+#include "side_costs.h"
+#include "side_matcher.h"
+#include "sides_comparison_utils.h"
+
+struct PuzzleSolverOptions final {
+    // Background threshold = thresholdScale * thresholdPercentile-th percentile of intensities on the image border
+    double thresholdScale = 1.5;
+    double thresholdPercentile = 90.0;
+
+    // Applied to the thresholded mask in one streaming pass: closing + opening and a small erosion,
+    // so that side colors are not taken from the background
+    std::vector<morphology::Op> morphology = {
+        morphology::dilateOp(6),
+        morphology::erodeOp(6),
+        morphology::erodeOp(6),
+        morphology::dilateOp(6),
+        morphology::erodeOp(2),
+    };
+
+    // 1 - the mask is computed at full resolution, 2/4/8 - coarse to fine (see thresholdMorphologyCoarseToFine):
+    // on the 1/coarseScale level and only around its boundaries at full resolution
+    int coarseScale = 1;
+
+    float sideBlurStrength = 4.0f; // see buildSideDescriptor
+    // Side colors sampled from the whole photo (describeSides with the frame) are taken this many pixels inside
+    // of the piece along the normal of the side (bilinear, fractional), 0 - exactly the contour pixels
+    float sideInset = 0.0f;
+    SideMatcherOptions matcher;
+    AssemblyMethod assemblyMethod = AssemblyMethod::CornerBFS;
+    bool with_openmp = true;
+};
+
+// Output of PuzzleSolver::segment
+struct PuzzleSegmentation final {
+    std::vector<float> borderIntensities; // grayscale of the image perimeter (see grayscale_border)
+    double backgroundThreshold = 0.0;
+    BitMask thresholded;                  // foreground before morphology (empty if segmented coarse to fine)
+    std::vector<BitMask> steps;           // after every morphology op except the last one, only if requested
+    BitMask mask;                         // final foreground
+    bbox2i roi;                           // the mask is zero outside (the whole photo if segmented coarse to fine)
+};
+
+// Output of PuzzleSolver::extractPieces, every vector has an item per piece (and sides - a piece)
+struct PuzzlePieces final {
+    std::vector<point2i> offsets;                      // top-left corner of the piece in the photo
+    std::vector<image8u> images;
+    std::vector<image8u> masks;                        // 255 - piece pixel
+    std::vector<std::vector<point2i>> contours;        // clockwise, in piece coordinates
+    std::vector<std::vector<point2i>> corners;         // 4 per piece
+    PieceSides sides;                                  // 4 per piece, side i goes from corner i to corner i+1
+
+    int count() const noexcept { return static_cast<int>(images.size()); }
+    int channels() const noexcept { return images.empty() ? 0 : images[0].channels(); }
+};
+
+using PuzzleSideDescriptors = std::vector<std::vector<SideDescriptor>>; // [piece][side]
+
+struct PuzzleSolution final {
+    PuzzleSegmentation segmentation;
+    PuzzlePieces pieces;
+    PuzzleSideDescriptors descriptors;
+    std::vector<std::vector<MatchedSide>> matchedSides;
+    PuzzleAssemblyResult assembly;
+};
+
+// The whole pipeline as separate stages with typed inputs and outputs:
+//   segment -> extractPieces -> describeSides -> match -> assemble -> render
+// so that a caller can run only a part of it, inspect or replace any intermediate result, or run stages
+// of different photos in different threads (stages are const, the solver holds only options).
+class PuzzleSolver final {
+public:
+    explicit PuzzleSolver(const PuzzleSolverOptions &options = {});
+
+    const PuzzleSolverOptions &options() const noexcept { return options_; }
+
+    // Foreground mask of a 3-channel photo, keepSteps - also the intermediate masks (f.e. for debug dumps,
+    // they are full resolution ones, so keepSteps disables coarseScale)
+    PuzzleSegmentation segment(const image8u &image, bool keepSteps = false) const;
+    // The same of the photo at level 0 of the pyramid, with coarseScale the coarse level is fetched from the pyramid
+    // (and stays cached there for the other consumers of that resolution)
+    PuzzleSegmentation segment(pyramid8u &photo, bool keepSteps = false) const;
+    // The threshold of segment for these border intensities
+    double backgroundThreshold(const std::vector<float> &borderIntensities) const;
+
+    // Connected components of mask with their contours, corners and sides (pieces are processed in parallel),
+    // components are labelled only within roi if the mask is known to be zero outside it (empty - the whole mask);
+    // labels (if not null) get the label image of the pieces over roi (see splitObjects)
+    PuzzlePieces extractPieces(const image8u &image, const BitMask &mask, const bbox2i &roi = {},
+                               ObjectLabels *labels = nullptr) const;
+    // Contour and corners of piece obj from its mask (what extractPieces does for every piece)
+    void tracePiece(PuzzlePieces &pieces, int obj) const;
+    // Sides of all pieces from their contours and corners, into one buffer (pieces in parallel)
+    void splitSides(PuzzlePieces &pieces) const;
+
+    // A descriptor per side, pieces in parallel
+    PuzzleSideDescriptors describeSides(const PuzzlePieces &pieces) const;
+    // The same with colors sampled straight from the photo the pieces were extracted from (at their offsets),
+    // so that piece images are not read, with options().sideInset
+    PuzzleSideDescriptors describeSides(const PuzzlePieces &pieces, const image8u &frame) const;
+    // Descriptors of the sides of one piece (from the frame if it is not empty)
+    std::vector<SideDescriptor> describePiece(const PuzzlePieces &pieces, int obj, image8u_cview frame = {}) const;
+
+    // See SideMatcher::match, descriptors must be of these pieces
+    std::vector<std::vector<MatchedSide>> match(const PuzzlePieces &pieces, const PuzzleSideDescriptors &descriptors,
+                                                const SideMatcher::Visitor &visitor = {}, SideMatcherStats *stats = nullptr,
+                                                SideCosts *costs = nullptr) const;
+
+    PuzzleAssemblyResult assemble(const PuzzlePieces &pieces, const std::vector<std::vector<MatchedSide>> &matchedSides,
+                                  unsigned outputs = AssemblyOutputAll) const;
+
+    // The canvas of an assembly (without rendering it in assemble), the same pixels as its assembled/assembledWithLines;
+    // with tiles only the placements that are not in it yet are warped (see WarpedTileCache)
+    image8u render(const PuzzleAssemblyResult &assembly, const PuzzlePieces &pieces, bool withLines,
+                   WarpedTileCache *tiles = nullptr) const;
+
+    // All stages one after another
+    PuzzleSolution solve(const image8u &image, unsigned outputs = AssemblyOutputAll) const;
+
+private:
+    PuzzleSegmentation segment(const image8u &image, pyramid8u *pyramid, bool keepSteps) const;
+
+    PuzzleSolverOptions options_;
+};
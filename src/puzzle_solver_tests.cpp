@@ -0,0 +1,74 @@
+#include "puzzle_solver.h"
+
+#include <gtest/gtest.h>
+
+#include "synthetic_puzzle.h"
+#include "tests_utils.h"
+
+TEST(puzzle_solver, stagesEqualSolve) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle();
+    const PuzzleSolver solver;
+    const PuzzleSolution solution = solver.solve(puzzle.image);
+
+    const PuzzleSegmentation segmentation = solver.segment(puzzle.image);
+    EXPECT_EQ(segmentation.backgroundThreshold, solution.segmentation.backgroundThreshold);
+    EXPECT_TRUE(segmentation.mask == solution.segmentation.mask);
+    const PuzzlePieces pieces = solver.extractPieces(puzzle.image, segmentation.mask, segmentation.roi);
+    expectSamePieces(pieces, solution.pieces);
+    const PuzzleSideDescriptors descriptors = solver.describeSides(pieces, puzzle.image);
+    expectSameDescriptors(descriptors, solution.descriptors);
+    const std::vector<std::vector<MatchedSide>> matched = solver.match(pieces, descriptors);
+    expectSameMatches(matched, solution.matchedSides);
+    const PuzzleAssemblyResult assembly = solver.assemble(pieces, matched);
+    expectSameAssembly(assembly, solution.assembly);
+
+    expectSameImages(solver.render(solution.assembly, pieces, false), solution.assembly.assembled);
+    expectSameImages(solver.render(solution.assembly, pieces, true), solution.assembly.assembledWithLines);
+}
+
+TEST(puzzle_solver, solvesSyntheticPuzzle) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle();
+    const PuzzleSolution solution = PuzzleSolver().solve(puzzle.image, AssemblyOutputGridOnly);
+    ASSERT_EQ(solution.pieces.count(), puzzle.rows * puzzle.cols);
+
+    const std::vector<std::vector<MatchedSide>> groundTruth = syntheticGroundTruth(puzzle, solution.pieces);
+    const SyntheticMatchScore score = scoreMatches(groundTruth, solution.matchedSides);
+    EXPECT_EQ(score.correct, score.sides);
+    expectAssembledAsGroundTruth(solution.assembly, groundTruth);
+    EXPECT_TRUE(solution.assembly.assembled.width() == 0); // grid only
+}
+
+TEST(puzzle_solver, sameWithoutOpenMP) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle(4, 5, 17);
+    PuzzleSolverOptions serialOptions;
+    serialOptions.with_openmp = false;
+    const PuzzleSolution parallel = PuzzleSolver().solve(puzzle.image);
+    const PuzzleSolution serial = PuzzleSolver(serialOptions).solve(puzzle.image);
+    EXPECT_TRUE(parallel.segmentation.mask == serial.segmentation.mask);
+    expectSamePieces(parallel.pieces, serial.pieces);
+    expectSameDescriptors(parallel.descriptors, serial.descriptors);
+    expectSameMatches(parallel.matchedSides, serial.matchedSides);
+    expectSameAssembly(parallel.assembly, serial.assembly);
+}
+
+TEST(puzzle_solver, segmentsFromPyramid) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle(4, 5, 17);
+    for (int coarseScale: {1, 4}) {
+        SCOPED_TRACE("coarseScale " + std::to_string(coarseScale));
+        PuzzleSolverOptions options;
+        options.coarseScale = coarseScale;
+        const PuzzleSolver solver(options);
+        pyramid8u photo(puzzle.image);
+        const PuzzleSegmentation segmentation = solver.segment(photo);
+        const PuzzleSegmentation expected = solver.segment(puzzle.image);
+        EXPECT_EQ(segmentation.backgroundThreshold, expected.backgroundThreshold);
+        EXPECT_TRUE(segmentation.mask == expected.mask);
+        EXPECT_EQ(segmentation.roi.min, expected.roi.min);
+        EXPECT_EQ(segmentation.roi.max, expected.roi.max);
+        // the coarse level stays in the pyramid for the next consumer
+        EXPECT_EQ(photo.isBuilt(2), coarseScale == 4);
+    }
+    PuzzleSolverOptions options;
+    options.coarseScale = 3;
+    EXPECT_EQ(assertionCode([&] { PuzzleSolver solver(options); }), "90300009");
+}
@@ -0,0 +1,171 @@
+#include "side_costs.h"
+
+#include <libbase/runtime_assert.h>
+#include <libimages/debug_io.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+constexpr std::uint64_t kSectionAlignment = 64;
+
+std::uint64_t alignUp(std::uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+void writePadding(std::ostream &out, std::uint64_t &offset, std::uint64_t to) {
+    static const char zeros[kSectionAlignment] = {};
+    rassert(to >= offset && to - offset <= kSectionAlignment, 34712839742001, offset, to);
+    out.write(zeros, static_cast<std::streamsize>(to - offset));
+    offset = to;
+}
+
+void skipTo(std::istream &in, std::uint64_t &offset, std::uint64_t to) {
+    rassert(to >= offset, 34712839742002, offset, to);
+    in.ignore(static_cast<std::streamsize>(to - offset));
+    offset = to;
+}
+
+} // namespace
+
+SideCosts::SideCosts(const std::vector<int> &sidesPerObject) {
+    firstSide.assign(sidesPerObject.size() + 1, 0);
+    for (std::size_t obj = 0; obj < sidesPerObject.size(); ++obj) firstSide[obj + 1] = firstSide[obj] + sidesPerObject[obj];
+    const std::size_t n = static_cast<std::size_t>(sides());
+    costs.assign(n * n, std::numeric_limits<float>::quiet_NaN());
+}
+
+void SideCosts::addObjects(const std::vector<int> &sidesPerObject) {
+    if (firstSide.empty()) firstSide.push_back(0);
+    const std::size_t oldSides = static_cast<std::size_t>(sides());
+    for (int n : sidesPerObject) firstSide.push_back(firstSide.back() + n);
+    const std::size_t n = static_cast<std::size_t>(sides());
+
+    std::vector<float> grown(n * n, std::numeric_limits<float>::quiet_NaN());
+    for (std::size_t a = 0; a < oldSides; ++a) {
+        std::copy(costs.begin() + a * oldSides, costs.begin() + (a + 1) * oldSides, grown.begin() + a * n);
+    }
+    costs = std::move(grown);
+}
+
+float &SideCosts::at(int objA, int sideA, int objB, int sideB) {
+    return costs[static_cast<std::size_t>(flat(objA, sideA)) * sides() + flat(objB, sideB)];
+}
+
+float SideCosts::at(int objA, int sideA, int objB, int sideB) const {
+    return costs[static_cast<std::size_t>(flat(objA, sideA)) * sides() + flat(objB, sideB)];
+}
+
+std::vector<SideCosts::Candidate> SideCosts::topCandidates(int objA, int sideA, int k) const {
+    std::vector<Candidate> res;
+    for (int objB = 0; objB < objects(); ++objB) {
+        if (objB == objA) continue;
+        for (int sideB = 0; sideB < firstSide[objB + 1] - firstSide[objB]; ++sideB) {
+            const float cost = at(objA, sideA, objB, sideB);
+            if (!std::isnan(cost)) res.push_back({objB, sideB, cost});
+        }
+    }
+    // candidates are gathered in the order of flat indices, so a stable sort breaks ties by them
+    std::stable_sort(res.begin(), res.end(), [](const Candidate &a, const Candidate &b) { return a.cost < b.cost; });
+    if (static_cast<int>(res.size()) > k) res.resize(static_cast<std::size_t>(std::max(k, 0)));
+    return res;
+}
+
+std::vector<std::vector<MatchedSide>> SideCosts::matchedSides() const {
+    std::vector<std::vector<MatchedSide>> matched(static_cast<std::size_t>(objects()));
+    for (int objA = 0; objA < objects(); ++objA) {
+        matched[objA].resize(static_cast<std::size_t>(firstSide[objA + 1] - firstSide[objA]));
+        for (int sideA = 0; sideA < static_cast<int>(matched[objA].size()); ++sideA) {
+            for (int objB = 0; objB < objects(); ++objB) {
+                if (objB == objA) continue;
+                for (int sideB = 0; sideB < firstSide[objB + 1] - firstSide[objB]; ++sideB) {
+                    const float cost = at(objA, sideA, objB, sideB);
+                    if (!std::isnan(cost)) matched[objA][sideA].consider(objB, sideB, cost);
+                }
+            }
+        }
+    }
+    return matched;
+}
+
+void saveSideCosts(std::ostream &out, const SideCosts &costs, int candidatesPerSide) {
+    rassert(candidatesPerSide >= 0, 34712839742003, candidatesPerSide);
+    const std::size_t sides = static_cast<std::size_t>(costs.sides());
+    rassert(costs.costs.size() == sides * sides, 34712839742004, costs.costs.size(), sides);
+
+    SideCostsFileHeader header;
+    header.objects = static_cast<std::uint32_t>(costs.objects());
+    header.sides = static_cast<std::uint32_t>(sides);
+    header.candidatesPerSide = static_cast<std::uint32_t>(candidatesPerSide);
+    header.firstSideOffset = alignUp(sizeof(SideCostsFileHeader));
+    header.costsOffset = alignUp(header.firstSideOffset + sizeof(std::int32_t) * costs.firstSide.size());
+    header.candidatesOffset = alignUp(header.costsOffset + sizeof(float) * costs.costs.size());
+    header.fileSize = header.candidatesOffset + sizeof(SideCosts::Candidate) * sides * static_cast<std::size_t>(candidatesPerSide);
+
+    std::uint64_t offset = sizeof(header);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    writePadding(out, offset, header.firstSideOffset);
+    for (int first : costs.firstSide) {
+        const std::int32_t value = first;
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+    offset += sizeof(std::int32_t) * costs.firstSide.size();
+
+    writePadding(out, offset, header.costsOffset);
+    out.write(reinterpret_cast<const char *>(costs.costs.data()), static_cast<std::streamsize>(sizeof(float) * costs.costs.size()));
+    offset += sizeof(float) * costs.costs.size();
+
+    writePadding(out, offset, header.candidatesOffset);
+    std::vector<SideCosts::Candidate> row(static_cast<std::size_t>(candidatesPerSide));
+    for (int objA = 0; objA < costs.objects(); ++objA) {
+        for (int sideA = 0; sideA < costs.firstSide[objA + 1] - costs.firstSide[objA]; ++sideA) {
+            const std::vector<SideCosts::Candidate> top = costs.topCandidates(objA, sideA, candidatesPerSide);
+            std::fill(row.begin(), row.end(), SideCosts::Candidate{-1, -1, std::numeric_limits<float>::quiet_NaN()});
+            std::copy(top.begin(), top.end(), row.begin());
+            out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(sizeof(SideCosts::Candidate) * row.size()));
+        }
+    }
+    rassert(out.good(), 34712839742005);
+}
+
+void saveSideCosts(const std::string &path, const SideCosts &costs, int candidatesPerSide) {
+    debug_io::ensure_dir_exists_for_file(path);
+    std::ofstream out(path, std::ios::binary);
+    rassert(out.is_open(), 34712839742006, path);
+    saveSideCosts(out, costs, candidatesPerSide);
+}
+
+SideCosts loadSideCosts(std::istream &in) {
+    SideCostsFileHeader header;
+    const SideCostsFileHeader expected;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    rassert(in.good() && std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0, 34712839742007);
+    rassert(header.version == expected.version, 34712839742008, header.version);
+
+    std::uint64_t offset = sizeof(header);
+    skipTo(in, offset, header.firstSideOffset);
+    std::vector<std::int32_t> firstSide(static_cast<std::size_t>(header.objects) + 1);
+    in.read(reinterpret_cast<char *>(firstSide.data()), static_cast<std::streamsize>(sizeof(std::int32_t) * firstSide.size()));
+    offset += sizeof(std::int32_t) * firstSide.size();
+    rassert(in.good() && firstSide.front() == 0 && firstSide.back() == static_cast<std::int32_t>(header.sides), 34712839742009);
+
+    SideCosts res;
+    res.firstSide.assign(firstSide.begin(), firstSide.end());
+    res.costs.resize(static_cast<std::size_t>(header.sides) * header.sides);
+    skipTo(in, offset, header.costsOffset);
+    in.read(reinterpret_cast<char *>(res.costs.data()), static_cast<std::streamsize>(sizeof(float) * res.costs.size()));
+    rassert(in.good(), 34712839742010);
+    return res;
+}
+
+SideCosts loadSideCosts(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    rassert(in.is_open(), 34712839742011, path);
+    return loadSideCosts(in);
+}
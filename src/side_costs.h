@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "puzzle_assembly.h"
+
+// Results of SideMatcher::match as a full side-to-side cost matrix, so that assembly can be re-run (or tuned offline)
+// without matching again. Sides are numbered flat: side s of object obj is firstSide[obj] + s.
+struct SideCosts final {
+    using Candidate = SideCandidate;
+
+    std::vector<int> firstSide;  // [objects + 1]
+    std::vector<float> costs;    // [sides * sides], row - side A, column - side B, NaN - the pair was not compared
+
+    SideCosts() = default;
+    explicit SideCosts(const std::vector<int> &sidesPerObject);
+
+    // Appends objects with these numbers of sides, costs of all pairs with their sides are NaN
+    void addObjects(const std::vector<int> &sidesPerObject);
+
+    int objects() const noexcept { return static_cast<int>(firstSide.size()) - 1; }
+    int sides() const noexcept { return firstSide.empty() ? 0 : firstSide.back(); }
+    int flat(int obj, int side) const { return firstSide[obj] + side; }
+
+    float &at(int objA, int sideA, int objB, int sideB);
+    float at(int objA, int sideA, int objB, int sideB) const;
+
+    // Up to k compared sides B of other pieces sorted by (cost, flat index of B)
+    std::vector<Candidate> topCandidates(int objA, int sideA, int k) const;
+
+    // The same reduction as SideMatcher::match over the compared pairs in the serial (objA, sideA, objB, sideB) order
+    std::vector<std::vector<MatchedSide>> matchedSides() const;
+};
+
+// Binary artifact (little-endian, every section 64-byte aligned, so it can be memory-mapped as is):
+//   header:     SideCostsFileHeader
+//   firstSide:  int32[objects + 1]
+//   costs:      float32[sides * sides]
+//   candidates: SideCosts::Candidate[sides * candidatesPerSide], topCandidates of every side, unused tail has objB = -1
+struct SideCostsFileHeader final {
+    char magic[8] = {'C', 'V', 'P', 'C', 'O', 'S', 'T', 'S'};
+    std::uint32_t version = 1;
+    std::uint32_t objects = 0;
+    std::uint32_t sides = 0;
+    std::uint32_t candidatesPerSide = 0;
+    std::uint64_t firstSideOffset = 0;   // in bytes from the beginning of the file
+    std::uint64_t costsOffset = 0;
+    std::uint64_t candidatesOffset = 0;
+    std::uint64_t fileSize = 0;
+    std::uint8_t reserved[8] = {};
+};
+static_assert(sizeof(SideCostsFileHeader) == 64);
+static_assert(sizeof(SideCosts::Candidate) == 12);
+
+void saveSideCosts(std::ostream &out, const SideCosts &costs, int candidatesPerSide);
+void saveSideCosts(const std::string &path, const SideCosts &costs, int candidatesPerSide);
+
+// Candidate lists are derived data (see topCandidates), so only the matrix is loaded back
+SideCosts loadSideCosts(std::istream &in);
+SideCosts loadSideCosts(const std::string &path);
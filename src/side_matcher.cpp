@@ -0,0 +1,493 @@
+#include "side_matcher.h"
+
+#include <libbase/runtime_assert.h>
+#include <libbase/stats.h>
+#include <libbase/timer.h>
+#include <libimages/algorithms/profile_alignment.h>
+#include <libimages/algorithms/resample.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+// Profile of side resampled to length samples, planar into both rows (the second one reversed)
+void canonicalProfile(const SideDescriptor &side, int length, std::uint8_t *clockwise, std::uint8_t *counterClockwise) {
+    if (length <= side.length()) {
+        resamplePlanar(side.colors().data, side.length(), side.channels, length, side.profileBlurStrength, clockwise);
+    } else {
+        const PlanarProfileView profile = side.profile(false);
+        for (int c = 0; c < side.channels; ++c) {
+            const std::uint8_t *from = profile.channel(c);
+            std::uint8_t *to = clockwise + static_cast<std::size_t>(c) * length;
+            for (int i = 0; i < length; ++i) to[i] = from[static_cast<std::size_t>(i) * side.length() / length];
+        }
+    }
+    // exactly reversed (not resampled separately), so that the cost matrix is symmetric
+    for (int c = 0; c < side.channels; ++c) {
+        const std::uint8_t *from = clockwise + static_cast<std::size_t>(c) * length;
+        std::reverse_copy(from, from + length, counterClockwise + static_cast<std::size_t>(c) * length);
+    }
+}
+
+} // namespace
+
+CanonicalSideProfiles buildCanonicalSideProfiles(const std::vector<std::vector<SideDescriptor>> &objSides, int length, int channels) {
+    rassert(length > 0, 34712839741405, length);
+    CanonicalSideProfiles res;
+    res.rowOf.resize(objSides.size());
+    int rows = 0;
+    for (std::size_t obj = 0; obj < objSides.size(); ++obj) {
+        for (const SideDescriptor &side : objSides[obj]) {
+            res.rowOf[obj].push_back(side.mostlyWhite ? -1 : rows++);
+        }
+    }
+
+    res.clockwise = PlanarProfileMatrix8u(rows, length, channels);
+    res.counterClockwise = PlanarProfileMatrix8u(rows, length, channels);
+    for (std::size_t obj = 0; obj < objSides.size(); ++obj) {
+        for (std::size_t side = 0; side < objSides[obj].size(); ++side) {
+            const int row = res.rowOf[obj][side];
+            if (row == -1) continue;
+            const SideDescriptor &descriptor = objSides[obj][side];
+            rassert(descriptor.channels == channels, 34712839741416, descriptor.channels, channels);
+            canonicalProfile(descriptor, length, res.clockwise.rowData(row), res.counterClockwise.rowData(row));
+        }
+    }
+    return res;
+}
+
+VantagePointIndex buildSideIndex(const CanonicalSideProfiles &profiles) {
+    const PlanarProfileMatrix8u &rows = profiles.counterClockwise;
+    VantagePointIndex index(rows.length * rows.channels);
+    for (int row = 0; row < rows.rows; ++row) index.add(rows.row(row).data);
+    return index;
+}
+
+SideMatcher::SideMatcher(const std::vector<std::vector<SideDescriptor>> &objSides, int channels, const SideMatcherOptions &options)
+    : objSides_(objSides), channels_(channels), options_(options) {
+    rassert(channels == 1 || channels == 3, 34712839741401, channels);
+    rassert(options.canonicalLength >= 0, 34712839741406, options.canonicalLength);
+    rassert(options.coarseCandidates >= 0, 34712839741407, options.coarseCandidates);
+    rassert(options.coarseLength > 0, 34712839741408, options.coarseLength);
+    rassert(options.nearestCandidates >= 0, 34712839741409, options.nearestCandidates);
+    rassert(options.coarseCandidates == 0 || options.nearestCandidates == 0, 34712839741410,
+            options.coarseCandidates, options.nearestCandidates);
+    rassert(options.alignmentShift >= 0 && (options.alignmentShift == 0 || options.canonicalLength == 0), 34712839741416,
+            options.alignmentShift, options.canonicalLength);
+}
+
+SideComparison SideMatcher::compare(const SideDescriptor &a, const SideDescriptor &b, int channels, bool keepProfiles,
+                                    ProfileCostFunction cost, int maxShift) {
+    rassert(!a.mostlyWhite && !b.mostlyWhite, 34712839741402);
+
+    // both sides are aligned to the length of the shorter one, B is taken counter-clockwise (as a zipper)
+    const int n = std::min(a.length(), b.length());
+    SideComparison res;
+
+    // the shorter side is taken as is (a view of its packed profile in the needed orientation), only the longer one is
+    // resampled, into buffers of the thread that are reused from pair to pair
+    thread_local PlanarProfile8u scratchA, scratchB;
+    PlanarProfileView profileA = a.profileOfLength(n, false, scratchA);
+    PlanarProfileView profileB = b.profileOfLength(n, true, scratchB);
+    rassert(profileA.channels == channels && profileB.channels == channels, 34712839741403, profileA.channels, channels);
+    if (maxShift > 0) {
+        // both orders of a pair zip the same samples at the same shift, so the result can still be mirrored
+        thread_local PlanarProfile8u overlapA, overlapB;
+        const ProfileShift shift = bestProfileShift(profileA, profileB, maxShift);
+        shiftedOverlap(profileA, profileB, shift.shift, profileA, profileB, overlapA, overlapB);
+    }
+    if (!keepProfiles) {
+        // only the median is needed, so differences are not materialized
+        res.difference = static_cast<float>(cost ? cost(profileA, profileB) : profileCost(profileA, profileB).median);
+        return res;
+    }
+
+    profileDifferences(profileA, profileB, res.differences);
+    res.difference = static_cast<float>(cost ? cost(profileA, profileB) : stats::median(res.differences));
+    res.a = toColors(profileA);
+    res.b = toColors(profileB);
+    return res;
+}
+
+bool SideMatcher::costWithBound(const SideDescriptor &a, const SideDescriptor &b, int channels, double bound, float &difference,
+                                int *samples) {
+    rassert(!a.mostlyWhite && !b.mostlyWhite, 34712839741411);
+    const int n = std::min(a.length(), b.length());
+    thread_local PlanarProfile8u scratchA, scratchB;
+    const PlanarProfileView profileA = a.profileOfLength(n, false, scratchA);
+    const PlanarProfileView profileB = b.profileOfLength(n, true, scratchB);
+    rassert(profileA.channels == channels && profileB.channels == channels, 34712839741412, profileA.channels, channels);
+    double median = 0.0;
+    if (!profileMedianWithBound(profileA, profileB, bound, median, samples)) return false;
+    difference = static_cast<float>(median);
+    return true;
+}
+
+std::vector<SideComparison> SideMatcher::pruneByCoarseProfiles(std::vector<SideComparison> pairs, bool with_openmp) const {
+    const CanonicalSideProfiles coarse = buildCanonicalSideProfiles(objSides_, options_.coarseLength, channels_);
+    const int rows = coarse.clockwise.rows;
+    const std::vector<double> medians = profileMedianMatrixSymmetric(coarse.clockwise, coarse.counterClockwise, with_openmp);
+    auto coarseMedian = [&](const SideComparison &pair) {
+        return medians[static_cast<std::size_t>(coarse.rowOf[pair.objA][pair.sideA]) * rows + coarse.rowOf[pair.objB][pair.sideB]];
+    };
+
+    // pairs of one side A are contiguous
+    std::vector<SideComparison> kept;
+    std::vector<int> order;
+    for (std::size_t from = 0; from < pairs.size();) {
+        std::size_t to = from;
+        while (to < pairs.size() && pairs[to].objA == pairs[from].objA && pairs[to].sideA == pairs[from].sideA) ++to;
+
+        order.resize(to - from);
+        for (std::size_t k = 0; k < order.size(); ++k) order[k] = static_cast<int>(from + k);
+        const std::size_t candidates = std::min(order.size(), static_cast<std::size_t>(options_.coarseCandidates));
+        std::partial_sort(order.begin(), order.begin() + candidates, order.end(), [&](int l, int r) {
+            const double ml = coarseMedian(pairs[l]);
+            const double mr = coarseMedian(pairs[r]);
+            return ml != mr ? ml < mr : l < r;
+        });
+        std::sort(order.begin(), order.begin() + candidates);
+        for (std::size_t k = 0; k < candidates; ++k) kept.push_back(std::move(pairs[order[k]]));
+        from = to;
+    }
+    return kept;
+}
+
+bool SideMatcher::canMate(const SideDescriptor &a, const SideDescriptor &b) const {
+    if (!options_.geometricPrefilter) return true;
+    auto ratio = [](float x, float y) { return std::max(x, y) / std::max(std::min(x, y), 1.0f); };
+    if (ratio(a.signature.arcLength, b.signature.arcLength) > options_.maxLengthRatio) return false;
+    if (ratio(a.signature.chordLength, b.signature.chordLength) > options_.maxLengthRatio) return false;
+    auto kind = [&](float bulge) { return std::abs(bulge) < options_.flatBulge ? 0 : (bulge > 0 ? 1 : -1); };
+    return kind(a.signature.bulge) == -kind(b.signature.bulge);
+}
+
+std::vector<SideComparison> SideMatcher::allPairs(int &geometryRejected) const {
+    const int objects = static_cast<int>(objSides_.size());
+    std::vector<SideComparison> pairs;
+    for (int objA = 0; objA < objects; ++objA) {
+        for (int sideA = 0; sideA < static_cast<int>(objSides_[objA].size()); ++sideA) {
+            if (objSides_[objA][sideA].mostlyWhite) continue;
+            for (int objB = 0; objB < objects; ++objB) {
+                if (objA == objB) continue;
+                for (int sideB = 0; sideB < static_cast<int>(objSides_[objB].size()); ++sideB) {
+                    if (objSides_[objB][sideB].mostlyWhite) continue;
+                    if (!canMate(objSides_[objA][sideA], objSides_[objB][sideB])) {
+                        ++geometryRejected;
+                        continue;
+                    }
+                    SideComparison pair;
+                    pair.objA = objA;
+                    pair.sideA = sideA;
+                    pair.objB = objB;
+                    pair.sideB = sideB;
+                    pairs.push_back(std::move(pair));
+                }
+            }
+        }
+    }
+    return pairs;
+}
+
+std::vector<SideComparison> SideMatcher::nearestPairs(bool with_openmp, int &geometryRejected) const {
+    const CanonicalSideProfiles coarse = buildCanonicalSideProfiles(objSides_, options_.coarseLength, channels_);
+    const VantagePointIndex index = buildSideIndex(coarse);
+
+    std::vector<std::pair<int, int>> sideOfRow(static_cast<std::size_t>(coarse.clockwise.rows));
+    for (int obj = 0; obj < static_cast<int>(coarse.rowOf.size()); ++obj) {
+        for (int side = 0; side < static_cast<int>(coarse.rowOf[obj].size()); ++side) {
+            if (coarse.rowOf[obj][side] != -1) sideOfRow[coarse.rowOf[obj][side]] = {obj, side};
+        }
+    }
+
+    const int rows = coarse.clockwise.rows;
+    std::vector<std::vector<int>> neighbours(static_cast<std::size_t>(rows));
+    int rejected = 0;
+    #pragma omp parallel for schedule(dynamic, 4) reduction(+:rejected) if(with_openmp)
+    for (int rowA = 0; rowA < rows; ++rowA) {
+        const auto [objA, sideA] = sideOfRow[rowA];
+        auto accept = [&](int rowB) {
+            const auto [objB, sideB] = sideOfRow[rowB];
+            if (objB == objA) return false;
+            if (canMate(objSides_[objA][sideA], objSides_[objB][sideB])) return true;
+            ++rejected;
+            return false;
+        };
+        const std::vector<VantagePointIndex::Neighbour> found = index.nearest(coarse.clockwise.row(rowA).data, options_.nearestCandidates, accept);
+        for (const VantagePointIndex::Neighbour &n : found) neighbours[rowA].push_back(n.id);
+        // rows go in (obj, side) order, so pairs of side A keep the same order as in allPairs()
+        std::sort(neighbours[rowA].begin(), neighbours[rowA].end());
+    }
+    geometryRejected = rejected;
+
+    std::vector<SideComparison> pairs;
+    for (int rowA = 0; rowA < rows; ++rowA) {
+        for (int rowB : neighbours[rowA]) {
+            SideComparison pair;
+            pair.objA = sideOfRow[rowA].first;
+            pair.sideA = sideOfRow[rowA].second;
+            pair.objB = sideOfRow[rowB].first;
+            pair.sideB = sideOfRow[rowB].second;
+            pairs.push_back(std::move(pair));
+        }
+    }
+    return pairs;
+}
+
+std::vector<std::vector<MatchedSide>> SideMatcher::match(bool with_openmp, const Visitor &visitor, SideMatcherStats *stats, SideCosts *costs) const {
+    const Timer timer;
+    const int objects = static_cast<int>(objSides_.size());
+
+    // all pairs of non-white sides of different pieces
+    int totalPairs = 0;
+    int consideredPairs = 0;
+    {
+        std::vector<int> nonWhite(static_cast<std::size_t>(objects), 0);
+        int allSides = 0;
+        for (int obj = 0; obj < objects; ++obj) {
+            for (const SideDescriptor &side : objSides_[obj]) nonWhite[obj] += side.mostlyWhite ? 0 : 1;
+            allSides += static_cast<int>(objSides_[obj].size());
+        }
+        int allNonWhite = 0;
+        for (int n : nonWhite) allNonWhite += n;
+        for (int n : nonWhite) totalPairs += n * (allNonWhite - n);
+        for (int obj = 0; obj < objects; ++obj) {
+            const int n = static_cast<int>(objSides_[obj].size());
+            consideredPairs += n * (allSides - n);
+        }
+    }
+
+    int geometryRejected = 0;
+    std::vector<SideComparison> pairs;
+    if (options_.nearestCandidates > 0) {
+        pairs = nearestPairs(with_openmp, geometryRejected);
+    } else {
+        pairs = allPairs(geometryRejected);
+        if (options_.coarseCandidates > 0) pairs = pruneByCoarseProfiles(std::move(pairs), with_openmp);
+    }
+    const bool pruned = static_cast<int>(pairs.size()) < totalPairs;
+
+    if (stats) {
+        *stats = SideMatcherStats{};
+        stats->consideredPairs = consideredPairs;
+        stats->whiteRejectedPairs = consideredPairs - totalPairs;
+        stats->pairs = totalPairs;
+        stats->geometryRejectedPairs = geometryRejected;
+        stats->comparedPairs = static_cast<int>(pairs.size());
+        stats->prunedPairs = totalPairs - geometryRejected - stats->comparedPairs;
+    }
+
+    const bool keepProfiles = static_cast<bool>(visitor);
+    const int count = static_cast<int>(pairs.size());
+    std::int64_t comparedSamples = 0;
+    if (options_.canonicalLength > 0) {
+        comparedSamples = static_cast<std::int64_t>(count) * options_.canonicalLength;
+        const CanonicalSideProfiles profiles = buildCanonicalSideProfiles(objSides_, options_.canonicalLength, channels_);
+        const int rows = profiles.clockwise.rows;
+        // without pruning the dense matrix also compares the sides of the same piece, which is cheaper than gathering the needed rows
+        const ProfileCostFunction cost = options_.cost;
+        const bool dense = !pruned && !cost;
+        const std::vector<double> medians = dense ? profileMedianMatrixSymmetric(profiles.clockwise, profiles.counterClockwise, with_openmp)
+                                                  : std::vector<double>{};
+        #pragma omp parallel for schedule(dynamic, 16) if(with_openmp && !dense)
+        for (int k = 0; k < count; ++k) {
+            SideComparison &pair = pairs[k];
+            const int rowA = profiles.rowOf[pair.objA][pair.sideA];
+            const int rowB = profiles.rowOf[pair.objB][pair.sideB];
+            const PlanarProfileView profileA = profiles.clockwise.row(rowA);
+            const PlanarProfileView profileB = profiles.counterClockwise.row(rowB);
+            if (dense) {
+                pair.difference = static_cast<float>(medians[static_cast<std::size_t>(rowA) * rows + rowB]);
+            } else {
+                pair.difference = static_cast<float>(cost ? cost(profileA, profileB) : profileCost(profileA, profileB).median);
+            }
+            if (keepProfiles) {
+                pair.a = toColors(profileA);
+                pair.b = toColors(profileB);
+                profileDifferences(profileA, profileB, pair.differences);
+            }
+        }
+    } else if (options_.earlyAbandon && !keepProfiles && !options_.cost && options_.alignmentShift == 0) {
+        // pairs of one side A are contiguous, groups are independent
+        std::vector<int> groupBegins;
+        for (int k = 0; k < count; ++k) {
+            if (k == 0 || pairs[k].objA != pairs[k - 1].objA || pairs[k].sideA != pairs[k - 1].sideA) groupBegins.push_back(k);
+        }
+        groupBegins.push_back(count);
+
+        int abandoned = 0;
+        std::int64_t samples = 0;
+        const int groups = static_cast<int>(groupBegins.size()) - 1;
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+:abandoned, samples) if(with_openmp)
+        for (int g = 0; g < groups; ++g) {
+            // a pair changes the reduction below only if its difference is not greater than the best one before it
+            double best = std::numeric_limits<double>::infinity();
+            for (int k = groupBegins[g]; k < groupBegins[g + 1]; ++k) {
+                SideComparison &pair = pairs[k];
+                int pairSamples = 0;
+                if (costWithBound(objSides_[pair.objA][pair.sideA], objSides_[pair.objB][pair.sideB], channels_, best, pair.difference,
+                                  &pairSamples)) {
+                    best = std::min(best, static_cast<double>(pair.difference));
+                } else {
+                    pair.difference = std::numeric_limits<float>::infinity();
+                    ++abandoned;
+                }
+                samples += pairSamples;
+            }
+        }
+        comparedSamples = samples;
+        if (stats) stats->abandonedPairs = abandoned;
+    } else {
+        // Reversed profiles are exact reverses of the forward ones, so D(A, B) and D(B, A) zip the same two profiles
+        // from opposite ends: per-sample differences are reversed and the median is the same.
+        // Each unordered pair is compared once (as A < B in the serial order), the mirrored pair takes the reversed result.
+        std::vector<int> firstSide(static_cast<std::size_t>(objects) + 1, 0);
+        for (int obj = 0; obj < objects; ++obj) firstSide[obj + 1] = firstSide[obj] + static_cast<int>(objSides_[obj].size());
+        const std::int64_t sides = firstSide[objects];
+        auto key = [&](const SideComparison &pair) {
+            const std::int64_t a = firstSide[pair.objA] + pair.sideA;
+            const std::int64_t b = firstSide[pair.objB] + pair.sideB;
+            return std::min(a, b) * sides + std::max(a, b);
+        };
+
+        std::vector<std::int64_t> keys;
+        keys.reserve(pairs.size());
+        for (const SideComparison &pair : pairs) keys.push_back(key(pair));
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        auto sideOf = [&](std::int64_t flat) -> const SideDescriptor & {
+            const int obj = static_cast<int>(std::upper_bound(firstSide.begin(), firstSide.end(), flat) - firstSide.begin()) - 1;
+            return objSides_[obj][flat - firstSide[obj]];
+        };
+        const int unique = static_cast<int>(keys.size());
+        std::vector<SideComparison> results(static_cast<std::size_t>(unique));
+        #pragma omp parallel for schedule(dynamic, 4) if(with_openmp)
+        for (int k = 0; k < unique; ++k) {
+            results[k] = compare(sideOf(keys[k] / sides), sideOf(keys[k] % sides), channels_, keepProfiles, options_.cost,
+                                 options_.alignmentShift);
+        }
+        for (std::int64_t k : keys) comparedSamples += std::min(sideOf(k / sides).length(), sideOf(k % sides).length());
+
+        for (SideComparison &pair : pairs) {
+            const SideComparison &res = results[std::lower_bound(keys.begin(), keys.end(), key(pair)) - keys.begin()];
+            pair.difference = res.difference;
+            if (!keepProfiles) continue;
+            const bool mirrored = firstSide[pair.objA] + pair.sideA > firstSide[pair.objB] + pair.sideB;
+            if (mirrored) {
+                pair.a.assign(res.b.rbegin(), res.b.rend());
+                pair.b.assign(res.a.rbegin(), res.a.rend());
+                pair.differences.assign(res.differences.rbegin(), res.differences.rend());
+            } else {
+                pair.a = res.a;
+                pair.b = res.b;
+                pair.differences = res.differences;
+            }
+        }
+        if (stats) stats->mirroredPairs = count - unique;
+    }
+
+    std::vector<std::vector<MatchedSide>> matched(static_cast<std::size_t>(objects));
+    for (int obj = 0; obj < objects; ++obj) matched[obj].resize(objSides_[obj].size());
+
+    if (costs) {
+        std::vector<int> sidesPerObject;
+        for (int obj = 0; obj < objects; ++obj) sidesPerObject.push_back(static_cast<int>(objSides_[obj].size()));
+        *costs = SideCosts(sidesPerObject);
+        for (const SideComparison &pair : pairs) costs->at(pair.objA, pair.sideA, pair.objB, pair.sideB) = pair.difference;
+    }
+
+    // Serial reduction, see MatchedSide::consider
+    for (const SideComparison &pair : pairs) {
+        if (visitor) visitor(pair);
+
+        matched[pair.objA][pair.sideA].consider(pair.objB, pair.sideB, pair.difference);
+    }
+
+    if (stats) {
+        stats->comparedSamples = comparedSamples;
+        for (const std::vector<MatchedSide> &sides : matched) {
+            for (const MatchedSide &side : sides) {
+                if (side.objB == -1) continue;
+                stats->bestDifferences.push_back(side.differenceBest);
+                stats->secondBestDifferences.push_back(side.differenceSecondBest);
+                if (side.differenceSecondBest >= 0.0f) stats->margins.push_back(side.differenceSecondBest - side.differenceBest);
+            }
+        }
+        stats->seconds = timer.elapsed();
+    }
+    return matched;
+}
+
+void SideMatcher::matchAdded(SideCosts &costs, bool with_openmp, SideMatcherStats *stats) const {
+    rassert(options_.canonicalLength == 0 && options_.coarseCandidates == 0 && options_.nearestCandidates == 0 && !options_.earlyAbandon,
+            34712839741413, "Incremental matching needs the full enumeration of pairs");
+    const int objects = static_cast<int>(objSides_.size());
+    const int oldObjects = costs.firstSide.empty() ? 0 : costs.objects();
+    rassert(oldObjects <= objects, 34712839741414, oldObjects, objects);
+    for (int obj = 0; obj < oldObjects; ++obj) {
+        rassert(costs.firstSide[obj + 1] - costs.firstSide[obj] == static_cast<int>(objSides_[obj].size()), 34712839741415, obj);
+    }
+    std::vector<int> sidesPerObject;
+    for (int obj = oldObjects; obj < objects; ++obj) sidesPerObject.push_back(static_cast<int>(objSides_[obj].size()));
+    costs.addObjects(sidesPerObject);
+
+    // Unordered pairs (A before B in the flat order, as the symmetric sharing of match() compares them) with B of a new piece,
+    // D(A, B) = D(B, A) fills both cells
+    struct Pair {
+        int objA, sideA, objB, sideB;
+    };
+    std::vector<Pair> pairs;
+    int consideredPairs = 0, nonWhitePairs = 0, geometryRejected = 0;
+    for (int objB = oldObjects; objB < objects; ++objB) {
+        for (int sideB = 0; sideB < static_cast<int>(objSides_[objB].size()); ++sideB) {
+            for (int objA = 0; objA < objB; ++objA) {
+                consideredPairs += static_cast<int>(objSides_[objA].size());
+                if (objSides_[objB][sideB].mostlyWhite) continue;
+                for (int sideA = 0; sideA < static_cast<int>(objSides_[objA].size()); ++sideA) {
+                    if (objSides_[objA][sideA].mostlyWhite) continue;
+                    ++nonWhitePairs;
+                    if (!canMate(objSides_[objA][sideA], objSides_[objB][sideB])) {
+                        ++geometryRejected;
+                        continue;
+                    }
+                    pairs.push_back({objA, sideA, objB, sideB});
+                }
+            }
+        }
+    }
+
+    const Timer timer;
+    const int count = static_cast<int>(pairs.size());
+    std::vector<float> differences(static_cast<std::size_t>(count));
+    #pragma omp parallel for schedule(dynamic, 4) if(with_openmp)
+    for (int k = 0; k < count; ++k) {
+        const Pair &pair = pairs[k];
+        differences[k] = compare(objSides_[pair.objA][pair.sideA], objSides_[pair.objB][pair.sideB], channels_, false, options_.cost,
+                                 options_.alignmentShift).difference;
+    }
+    for (int k = 0; k < count; ++k) {
+        const Pair &pair = pairs[k];
+        costs.at(pair.objA, pair.sideA, pair.objB, pair.sideB) = differences[k];
+        costs.at(pair.objB, pair.sideB, pair.objA, pair.sideA) = differences[k];
+    }
+
+    if (stats) {
+        // in ordered pairs, as match() counts them
+        *stats = SideMatcherStats{};
+        stats->consideredPairs = 2 * consideredPairs;
+        stats->whiteRejectedPairs = 2 * (consideredPairs - nonWhitePairs);
+        stats->pairs = 2 * nonWhitePairs;
+        stats->geometryRejectedPairs = 2 * geometryRejected;
+        stats->comparedPairs = 2 * count;
+        stats->mirroredPairs = count;
+        for (const Pair &pair : pairs) {
+            stats->comparedSamples += std::min(objSides_[pair.objA][pair.sideA].length(), objSides_[pair.objB][pair.sideB].length());
+        }
+        stats->seconds = timer.elapsed();
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <libbase/vantage_point_tree.h>
+#include <libimages/algorithms/profile_cost_policies.h>
+#include <libimages/algorithms/profile_distance.h>
+#include <libimages/color.h>
+
+#include "puzzle_assembly.h"
+#include "side_costs.h"
+#include "sides_comparison_utils.h"
+
+// Comparison of side A (clockwise) with side B (counter-clockwise) of another piece
+struct SideComparison final {
+    int objA = -1;
+    int sideA = -1;
+    int objB = -1;
+    int sideB = -1;
+    float difference = -1.0f;      // median of per-sample differences (or SideMatcherOptions::cost), 0 - colors match perfectly
+
+    // Filled only when a visitor is passed to SideMatcher::match
+    std::vector<color8u> a;        // profile of side A resampled to the length of the shorter side (or to the canonical length)
+    std::vector<color8u> b;        // the same for side B
+    std::vector<int> differences;  // per-sample sum of absolute channel differences
+};
+
+// Profiles of all non-white sides resampled to one canonical length, so that all pairs are one dense batched computation
+struct CanonicalSideProfiles final {
+    std::vector<std::vector<int>> rowOf;     // [obj][side] -> row in the matrices, -1 for white sides
+    PlanarProfileMatrix8u clockwise;         // row per side, as side A
+    PlanarProfileMatrix8u counterClockwise;  // the same sides reversed, as side B
+};
+
+// Sides shorter than length are stretched (nearest sample of their full-length profile)
+CanonicalSideProfiles buildCanonicalSideProfiles(const std::vector<std::vector<SideDescriptor>> &objSides, int length, int channels);
+
+// Counter-clockwise profiles (sides as B) as embeddings, id of a side is its row in profiles.
+// Query it with a clockwise row to find sides that look like a continuation of side A.
+VantagePointIndex buildSideIndex(const CanonicalSideProfiles &profiles);
+
+struct SideMatcherOptions final {
+    // Difference of two aligned profiles, f.e. profileCostFunction<profile_cost::L2, profile_cost::TrimmedMean<10>>(channels).
+    // nullptr - median of per-sample L1 distances (has the fastest paths: histogram median, dense matrices, early abandon)
+    ProfileCostFunction cost = nullptr;
+
+    // 0: each pair is compared at the length of its shorter side,
+    // otherwise all sides are resampled once to canonicalLength samples and compared as a dense matrix
+    int canonicalLength = 0;
+
+    // Coarse-to-fine: if > 0, all pairs are first ranked by the median of coarseLength-sample profiles
+    // and only coarseCandidates best of them per side A are compared in full (fewer - faster, but a true match can be lost)
+    int coarseCandidates = 0;
+    int coarseLength = 16;
+
+    // For large puzzles: if > 0, pairs are not enumerated at all, instead for every side A its nearestCandidates
+    // nearest sides (L1 distance of coarseLength-sample profiles, see buildSideIndex) are compared in full
+    int nearestCandidates = 0;
+
+    // Geometric prefilter: pairs of sides that can not mate by their shape (see SideSignature) are rejected
+    // before any color work
+    bool geometricPrefilter = false;
+    float maxLengthRatio = 1.2f;  // longer / shorter, for arc lengths and for chord lengths
+    float flatBulge = 0.05f;      // sides with smaller |bulge| are flat, otherwise a tab or a blank, which mate only each other
+
+    // Pairs of one side A are compared in the serial order, each one stops as soon as it is surely worse than
+    // the best difference so far (see costWithBound) - it would not change the result anyway.
+    // Applies without canonicalLength, cost, alignmentShift and a visitor (plots need all differences), replaces the symmetric sharing.
+    // Abandoned pairs are not candidates (MatchedSide::candidates), so candidate lists can be shorter.
+    bool earlyAbandon = false;
+
+    // Sliding alignment: if > 0, each pair is compared at the shift of side B along side A (at most alignmentShift
+    // samples, see bestProfileShift) with the least SSD, only where both overlap, so that a corner found a few samples
+    // off does not spoil a true match. All shifts of a pair are evaluated at once by FFT. Not with canonicalLength,
+    // replaces earlyAbandon.
+    int alignmentShift = 0;
+};
+
+struct SideMatcherStats final {
+    int consideredPairs = 0;        // ordered pairs of sides of different pieces
+    int whiteRejectedPairs = 0;     // of them with a mostly white (border) side, never compared
+    int pairs = 0;                  // pairs of non-white sides of different pieces
+    int geometryRejectedPairs = 0;  // rejected by the geometric prefilter (with nearestCandidates - only the pairs the index search reached)
+    int prunedPairs = 0;            // rejected by the coarse stage or not found by the nearest sides index
+    int comparedPairs = 0;          // compared in full
+    int mirroredPairs = 0;          // of them took the result of the same pair compared as (B, A)
+    int abandonedPairs = 0;         // of them stopped early by earlyAbandon
+    std::int64_t comparedSamples = 0; // samples of the aligned profiles actually compared (a mirrored pair - once,
+                                      // an abandoned one - up to where it stopped)
+    double seconds = 0.0;           // wall time of the matching
+
+    // Per side with a match (in the (obj, side) order, only match() fills them): MatchedSide::differenceBest,
+    // differenceSecondBest (-1 if none) and their margin (only sides with both, second best minus best)
+    std::vector<float> bestDifferences;
+    std::vector<float> secondBestDifferences;
+    std::vector<float> margins;
+
+    double pairsPerSecond() const { return seconds > 0.0 ? comparedPairs / seconds : 0.0; }
+};
+
+// Compares every non-white side with every non-white side of the other pieces.
+// Pairs are evaluated in parallel, then reduced in the serial (objA, sideA, objB, sideB) order,
+// so the result does not depend on the number of threads.
+class SideMatcher final {
+public:
+    using Visitor = std::function<void(const SideComparison &)>;
+
+    // Descriptors must outlive the matcher
+    SideMatcher(const std::vector<std::vector<SideDescriptor>> &objSides, int channels, const SideMatcherOptions &options = {});
+
+    // Always true without options.geometricPrefilter
+    bool canMate(const SideDescriptor &a, const SideDescriptor &b) const;
+
+    // maxShift > 0 - at the best shift (see SideMatcherOptions::alignmentShift), profiles are then only the overlap
+    static SideComparison compare(const SideDescriptor &a, const SideDescriptor &b, int channels, bool keepProfiles,
+                                  ProfileCostFunction cost = nullptr, int maxShift = 0);
+
+    // The same difference as compare(), but false if it is surely greater than bound (then not computed to the end)
+    // samples (if any) gets the number of samples compared
+    static bool costWithBound(const SideDescriptor &a, const SideDescriptor &b, int channels, double bound, float &difference,
+                              int *samples = nullptr);
+
+    // For every side: the best match (the last one among equal differences) and the best difference seen before it.
+    // Visitor (if any) is called for every compared pair in the serial order, before that pair is reduced.
+    // Pairs pruned by the coarse stage are neither visited nor reduced.
+    // If costs is passed, it gets the difference of every compared pair (so that SideCosts::matchedSides gives the same result).
+    std::vector<std::vector<MatchedSide>> match(bool with_openmp = true, const Visitor &visitor = {},
+                                                SideMatcherStats *stats = nullptr, SideCosts *costs = nullptr) const;
+
+    // Incremental matching: costs holds the differences of the first costs.objects() pieces (f.e. from the previous
+    // call), the pieces after them are new. Only the pairs with a side of a new piece are compared and added to costs,
+    // so that costs.matchedSides() is the same as match() of all pieces. Only for the full enumeration of pairs
+    // (without canonicalLength, coarseCandidates, nearestCandidates and earlyAbandon).
+    void matchAdded(SideCosts &costs, bool with_openmp = true, SideMatcherStats *stats = nullptr) const;
+
+private:
+    std::vector<SideComparison> allPairs(int &geometryRejected) const;
+    // Pairs with options_.nearestCandidates nearest sides B for every side A
+    std::vector<SideComparison> nearestPairs(bool with_openmp, int &geometryRejected) const;
+    // Keeps (in the same order) only options_.coarseCandidates best pairs for every side A by the coarse median
+    std::vector<SideComparison> pruneByCoarseProfiles(std::vector<SideComparison> pairs, bool with_openmp) const;
+
+    const std::vector<std::vector<SideDescriptor>> &objSides_;
+    int channels_;
+    SideMatcherOptions options_;
+};
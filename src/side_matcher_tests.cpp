@@ -0,0 +1,120 @@
+#include "side_matcher.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <tuple>
+
+#include "puzzle_solver.h"
+#include "tests_utils.h"
+
+namespace {
+
+struct MatcherInput final {
+    PuzzlePieces pieces;
+    PuzzleSideDescriptors descriptors;
+};
+
+MatcherInput matcherInput(int rows, int cols, std::uint32_t seed) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle(rows, cols, seed);
+    const PuzzleSolver solver;
+    const PuzzleSegmentation segmentation = solver.segment(puzzle.image);
+    MatcherInput input;
+    input.pieces = solver.extractPieces(puzzle.image, segmentation.mask, segmentation.roi);
+    input.descriptors = solver.describeSides(input.pieces, puzzle.image);
+    return input;
+}
+
+// Every ordered pair compared on its own (no mirroring) and considered one by one in the (objA, sideA, objB, sideB) order
+std::vector<std::vector<MatchedSide>> serialReduction(const PuzzleSideDescriptors &objSides, int channels, const SideMatcher &matcher) {
+    const int objects = static_cast<int>(objSides.size());
+    std::vector<std::vector<MatchedSide>> matched(objects);
+    for (int objA = 0; objA < objects; ++objA) {
+        matched[objA].resize(objSides[objA].size());
+        for (int sideA = 0; sideA < static_cast<int>(objSides[objA].size()); ++sideA) {
+            if (objSides[objA][sideA].mostlyWhite) continue;
+            for (int objB = 0; objB < objects; ++objB) {
+                if (objB == objA) continue;
+                for (int sideB = 0; sideB < static_cast<int>(objSides[objB].size()); ++sideB) {
+                    const SideDescriptor &a = objSides[objA][sideA];
+                    const SideDescriptor &b = objSides[objB][sideB];
+                    if (b.mostlyWhite || !matcher.canMate(a, b)) continue;
+                    matched[objA][sideA].consider(objB, sideB, SideMatcher::compare(a, b, channels, false).difference);
+                }
+            }
+        }
+    }
+    return matched;
+}
+
+} // namespace
+
+TEST(side_matcher, parallelEqualsSerialReduction) {
+    const MatcherInput input = matcherInput(4, 5, 17);
+    for (bool prefilter : {false, true}) {
+        SCOPED_TRACE(prefilter ? "geometric prefilter" : "all pairs");
+        SideMatcherOptions options;
+        options.geometricPrefilter = prefilter;
+        const SideMatcher matcher(input.descriptors, input.pieces.channels(), options);
+
+        const std::vector<std::vector<MatchedSide>> expected = serialReduction(input.descriptors, input.pieces.channels(), matcher);
+        SideMatcherStats stats;
+        expectSameMatches(matcher.match(true, {}, &stats), expected);
+        expectSameMatches(matcher.match(false), expected);
+        EXPECT_GT(stats.mirroredPairs, 0);
+        if (prefilter) EXPECT_GT(stats.geometryRejectedPairs, 0);
+    }
+}
+
+TEST(side_matcher, visitorSeesPairsInSerialOrder) {
+    const MatcherInput input = matcherInput(3, 4, 239);
+    const SideMatcher matcher(input.descriptors, input.pieces.channels());
+    std::vector<SideComparison> visited;
+    const std::vector<std::vector<MatchedSide>> matched = matcher.match(true, [&](const SideComparison &pair) {
+        visited.push_back(pair);
+    });
+    ASSERT_FALSE(visited.empty());
+    for (std::size_t k = 1; k < visited.size(); ++k) {
+        const SideComparison &p = visited[k - 1];
+        const SideComparison &q = visited[k];
+        EXPECT_LT(std::make_tuple(p.objA, p.sideA, p.objB, p.sideB), std::make_tuple(q.objA, q.sideA, q.objB, q.sideB));
+    }
+    // mirrored pairs got the reversed per-sample differences of the compared ones, the same difference
+    for (const SideComparison &pair : visited) {
+        const SideComparison direct = SideMatcher::compare(input.descriptors[pair.objA][pair.sideA],
+                                                           input.descriptors[pair.objB][pair.sideB], input.pieces.channels(), true);
+        ASSERT_EQ(pair.difference, direct.difference);
+        ASSERT_EQ(pair.differences, direct.differences);
+    }
+    expectSameMatches(matched, matcher.match(false));
+}
+
+TEST(side_matcher, earlyAbandonKeepsBestMatches) {
+    const MatcherInput input = matcherInput(4, 5, 17);
+    SideMatcherOptions options;
+    options.earlyAbandon = true;
+    const SideMatcher matcher(input.descriptors, input.pieces.channels(), options);
+    const std::vector<std::vector<MatchedSide>> expected = serialReduction(input.descriptors, input.pieces.channels(), matcher);
+
+    SideMatcherStats stats;
+    const std::vector<std::vector<MatchedSide>> matched = matcher.match(true, {}, &stats);
+    EXPECT_GT(stats.abandonedPairs, 0);
+    expectSameMatches(matched, matcher.match(false));
+    for (std::size_t obj = 0; obj < expected.size(); ++obj) {
+        for (std::size_t side = 0; side < expected[obj].size(); ++side) {
+            const MatchedSide &e = expected[obj][side];
+            const MatchedSide &m = matched[obj][side];
+            EXPECT_EQ(m.objB, e.objB);
+            EXPECT_EQ(m.sideB, e.sideB);
+            EXPECT_EQ(m.differenceBest, e.differenceBest);
+            EXPECT_EQ(m.differenceSecondBest, e.differenceSecondBest);
+            // abandoned pairs are not candidates, the ones that are have the costs of the full comparison
+            ASSERT_LE(m.candidates.size, e.candidates.size);
+            if (e.candidates.size > 0) {
+                ASSERT_GT(m.candidates.size, 0);
+                EXPECT_EQ(m.candidates.items[0].cost, e.candidates.items[0].cost);
+            }
+            for (const SideCandidate &c : m.candidates) EXPECT_TRUE(std::isfinite(c.cost));
+        }
+    }
+}
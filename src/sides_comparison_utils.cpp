@@ -2,6 +2,9 @@
 
 #include <libbase/stats.h>
 #include <libbase/runtime_assert.h>
+#include <libimages/algorithms/bilinear_kernels.h>
+#include <libimages/algorithms/resample.h>
+#include <libimages/channels.h>
 
 #include <algorithm>
 #include <cmath>
@@ -36,7 +39,11 @@ inline int sample_index_round(int i, int n, int m) {
 
 } // namespace
 
-std::vector<color8u> extractColors(const image8u &image, const std::vector<point2i> &pixels) {
+std::vector<color8u> extractColors(const image8u &image, std::span<const point2i> pixels) {
+    return extractColors(image8u_cview(image), pixels);
+}
+
+std::vector<color8u> extractColors(image8u_cview image, std::span<const point2i> pixels) {
     rassert(image.channels() == 1 || image.channels() == 3, 983417231, image.channels());
 
     std::vector<color8u> out;
@@ -44,48 +51,153 @@ std::vector<color8u> extractColors(const image8u &image, const std::vector<point
 
     const int w = image.width();
     const int h = image.height();
-    const int c = image.channels();
-
-    for (const auto& p : pixels) {
-        rassert(p.x >= 0 && p.x < w && p.y >= 0 && p.y < h, 983417232);
+    dispatch_channels(image.channels(), [&](auto c) {
+        for (const auto& p : pixels) {
+            rassert(p.x >= 0 && p.x < w && p.y >= 0 && p.y < h, 983417232);
 
-        if (c == 3) {
-            out.emplace_back(image(p.y, p.x, 0), image(p.y, p.x, 1), image(p.y, p.x, 2));
-        } else {
-            uint8_t v = image(p.y, p.x);
-            out.emplace_back(v, v, v);
+            const uint8_t* px = image.ptr(p.y, p.x);
+            if constexpr (decltype(c)::value == 1) {
+                out.emplace_back(px[0], px[0], px[0]);
+            } else {
+                out.emplace_back(px[0], px[1], px[2]);
+            }
         }
-    }
+    });
 
     return out;
 }
 
 bool isMostlyWhite(const std::vector<color8u> &colors, double percentile, uint8_t percentileMinIntensity) {
-    std::vector<float> intensities;
+    std::vector<uint8_t> intensities;
+    intensities.reserve(colors.size() * 3);
     for (const color8u &color: colors) {
         for (int c = 0; c < color.channels(); ++c) {
             intensities.push_back(color(c));
         }
     }
+    return isMostlyWhite(intensities, percentile, percentileMinIntensity);
+}
+
+bool isMostlyWhite(std::span<const uint8_t> intensities, double percentile, uint8_t percentileMinIntensity) {
+    // uint8_t values let stats::percentile count a histogram instead of sorting
     double percentile_intensity = stats::percentile(intensities, percentile);
     bool is_mostly_white = percentile_intensity > percentileMinIntensity;
     return is_mostly_white;
 }
 
-void drawImage(image8u &image, image8u &image_part, point2i offset) {
+SideSignature buildSideSignature(std::span<const point2i> pixels) {
+    rassert(!pixels.empty(), 34712839741305);
+    SideSignature signature;
+    double arcLength = 0.0;
+    for (std::size_t i = 1; i < pixels.size(); ++i) arcLength += (pixels[i] - pixels[i - 1]).length();
+    signature.arcLength = static_cast<float>(arcLength);
+    const point2i chord = pixels.back() - pixels.front();
+    signature.chordLength = static_cast<float>(chord.length());
+    if (chord.norm2() == 0) return signature;
+
+    // cross product with the chord is the signed distance to it multiplied by the chord length
+    std::int64_t extreme = 0;
+    for (const point2i &p : pixels) {
+        const point2i d = p - pixels.front();
+        const std::int64_t cross = static_cast<std::int64_t>(chord.x) * d.y - static_cast<std::int64_t>(chord.y) * d.x;
+        if (std::abs(cross) > std::abs(extreme)) extreme = cross;
+    }
+    signature.bulge = static_cast<float>(static_cast<double>(extreme) / chord.norm2());
+    return signature;
+}
+
+namespace {
+
+// Finishes a side descriptor whose colors are already packed into the colors plane of side.packed
+void finishSideDescriptor(SideDescriptor &side, std::span<const point2i> pixels, float blurStrength) {
+    side.profileBlurStrength = blurStrength;
+    side.signature = buildSideSignature(pixels);
+    // percentile does not depend on the order of colors, so one check covers both directions (and planar samples)
+    const std::size_t plane = static_cast<std::size_t>(side.channels) * side.samples;
+    side.mostlyWhite = isMostlyWhite(std::span<const std::uint8_t>(side.packed.data(), plane));
+    if (side.mostlyWhite) {
+        side.packed.resize(plane);
+        return;
+    }
+    std::uint8_t *profile = side.packed.data() + plane;
+    std::uint8_t *reversed = profile + plane;
+    resamplePlanar(side.packed.data(), side.samples, side.channels, side.samples, blurStrength, profile);
+    for (int c = 0; c < side.channels; ++c) {
+        const std::uint8_t *from = profile + static_cast<std::size_t>(c) * side.samples;
+        std::reverse_copy(from, from + side.samples, reversed + static_cast<std::size_t>(c) * side.samples);
+    }
+}
+
+} // namespace
+
+SideDescriptor buildSideDescriptor(const image8u &image, std::span<const point2i> pixels, float blurStrength) {
+    const std::vector<color8u> colors = extractColors(image, pixels);
+
+    SideDescriptor side;
+    side.samples = static_cast<int>(colors.size());
+    side.channels = colors.empty() ? 0 : colors[0].channels();
+    side.packed.resize(3 * static_cast<std::size_t>(side.channels) * side.samples);
+    for (int i = 0; i < side.samples; ++i) {
+        for (int c = 0; c < side.channels; ++c) side.packed[static_cast<std::size_t>(c) * side.samples + i] = colors[i].at(c);
+    }
+    finishSideDescriptor(side, pixels, blurStrength);
+    return side;
+}
+
+SideDescriptor buildSideDescriptor(image8u_cview frame, point2i offset, std::span<const point2i> pixels, float inset,
+                                   float blurStrength) {
+    rassert(frame.channels() == 1 || frame.channels() == 3, 983417233, frame.channels());
+    const int n = static_cast<int>(pixels.size());
+
+    // inward normal from the chord of the neighbours two pixels away: contours are clockwise (y down),
+    // so the inside is to the right of the direction of the side
+    std::vector<float> xs(static_cast<std::size_t>(n)), ys(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        xs[i] = static_cast<float>(offset.x + pixels[i].x);
+        ys[i] = static_cast<float>(offset.y + pixels[i].y);
+        if (inset == 0.0f) continue;
+        const point2i t = pixels[std::min(i + 2, n - 1)] - pixels[std::max(i - 2, 0)];
+        const float length = std::sqrt(static_cast<float>(t.x * t.x + t.y * t.y));
+        if (length == 0.0f) continue;
+        xs[i] += inset * static_cast<float>(-t.y) / length;
+        ys[i] += inset * static_cast<float>(t.x) / length;
+    }
+
+    SideDescriptor side;
+    side.samples = n;
+    side.channels = n == 0 ? 0 : frame.channels();
+    side.packed.resize(3 * static_cast<std::size_t>(side.channels) * side.samples);
+    if (n > 0) {
+        const bilinear_kernels::Source source{frame.ptr(0), frame.width(), frame.height(), frame.channels(), frame.stride_elements()};
+        bilinear_kernels::best().sample(source, xs.data(), ys.data(), n, side.packed.data(), static_cast<std::size_t>(n));
+    }
+    finishSideDescriptor(side, pixels, blurStrength);
+    return side;
+}
+
+PlanarProfileView SideDescriptor::profileOfLength(int n, bool reversed, PlanarProfile8u &scratch) const {
+    rassert(!mostlyWhite, 34712839741303);
+    rassert(n > 0 && n <= length(), 34712839741304, n, length());
+    if (n == length()) return profile(reversed);
+    scratch.length = n;
+    scratch.channels = channels;
+    scratch.data.resize(static_cast<std::size_t>(channels) * n);
+    resamplePlanar(packed.data(), samples, channels, n, profileBlurStrength, scratch.data.data(), reversed);
+    return scratch;
+}
+
+void drawImage(image8u &image, const image8u &image_part, point2i offset) {
     rassert(offset.y + image_part.height() <= image.height(), 1231412431);
     rassert(offset.x + image_part.width() <= image.width(), 64534524523);
     rassert(image.channels() == image_part.channels(), 3427823974238);
+    // whole rows at once (same channels, so pixels are laid out the same way)
+    const std::size_t row_elements = static_cast<std::size_t>(image_part.width()) * image_part.channels();
     for (int j = 0; j < image_part.height(); ++j) {
-        for (int i = 0; i < image_part.width(); ++i) {
-            for (int c = 0; c < image_part.channels(); ++c) {
-                image(offset.y + j, offset.x + i, c) = image_part(j, i, c);
-            }
-        }
+        std::copy_n(image_part.ptr(j), row_elements, image.ptr(offset.y + j, offset.x));
     }
 }
 
-void drawRGBLine(image8u &image, std::vector<color8u> &a, point2i offset, int height) {
+void drawRGBLine(image8u &image, const std::vector<color8u> &a, point2i offset, int height) {
     rassert(image.channels() == 3, 981273641);
 
     rassert(offset.y + height <= image.height(), 1231412445631);
@@ -98,7 +210,7 @@ void drawRGBLine(image8u &image, std::vector<color8u> &a, point2i offset, int he
     }
 }
 
-void drawGraph(image8u &image, std::vector<color8u> &a, point2i offset, int height) {
+void drawGraph(image8u &image, const std::vector<color8u> &a, point2i offset, int height) {
     rassert(image.channels() == 3, 981273642);
 
     rassert(offset.y + height <= image.height(), 54656234);
@@ -126,7 +238,7 @@ void drawGraph(image8u &image, std::vector<color8u> &a, point2i offset, int heig
     }
 }
 
-void drawGraph(image8u &image, std::vector<float> &a, point2i offset, int height, float maxValue) {
+void drawGraph(image8u &image, const std::vector<float> &a, point2i offset, int height, float maxValue) {
     rassert(image.channels() == 3, 981273643);
 
     rassert(offset.y + height <= image.height(), 45654732452);
@@ -153,6 +265,31 @@ void drawGraph(image8u &image, std::vector<float> &a, point2i offset, int height
     }
 }
 
+// Stacks the plots of one side into one image by increasing difference,
+// index gets a "y height difference objB sideB" line per plot
+image8u stackMatchPlots(std::vector<MatchPlot> plots, std::string &index) {
+    rassert(!plots.empty(), 23478912374101);
+    std::stable_sort(plots.begin(), plots.end(), [](const MatchPlot &a, const MatchPlot &b) { return a.difference < b.difference; });
+
+    int width = 0, height = 0;
+    for (const MatchPlot &plot : plots) {
+        rassert(plot.image.channels() == 3, 23478912374102, plot.image.channels());
+        width = std::max(width, plot.image.width());
+        height += plot.image.height();
+    }
+
+    image8u atlas(width, height, 3);
+    index.clear();
+    int y = 0;
+    for (MatchPlot &plot : plots) {
+        index += std::to_string(y) + " " + std::to_string(plot.image.height()) + " " + std::to_string(plot.difference) + " "
+               + std::to_string(plot.objB) + " " + std::to_string(plot.sideB) + "\n";
+        drawImage(atlas, plot.image, {0, y});
+        y += plot.image.height();
+    }
+    return atlas;
+}
+
 // pad with zeros so that string has at least minLength symbols
 std::string pad(int v, int minLength) {
     const std::string s = std::to_string(v);
@@ -1,24 +1,84 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
+#include <span>
 #include <vector>
 
 #include <libbase/point2.h>
+#include <libimages/algorithms/profile_distance.h>
 #include <libimages/color.h>
 #include <libimages/image.h>
+#include <libimages/image_view.h>
 
 
-std::vector<color8u> extractColors(const image8u &image, const std::vector<point2i> &pixels);
+std::vector<color8u> extractColors(const image8u &image, std::span<const point2i> pixels);
+std::vector<color8u> extractColors(image8u_cview image, std::span<const point2i> pixels);
 
 bool isMostlyWhite(const std::vector<color8u> &colors, double percentile=5, uint8_t percentileMinIntensity=175);
+// The same over the channel values of the colors in any order (f.e. planar samples)
+bool isMostlyWhite(std::span<const uint8_t> intensities, double percentile=5, uint8_t percentileMinIntensity=175);
 
-void drawImage(image8u &image, image8u &image_part, point2i offset);
+// Shape of a side, independent of colors: sides that can mate have close lengths and opposite bulges
+struct SideSignature final {
+    float arcLength = 0.0f;    // length of the pixel path along the side
+    float chordLength = 0.0f;  // distance between its corners
+    float bulge = 0.0f;        // signed largest deviation from the chord divided by chord length,
+                               // tabs and blanks have opposite signs (contours of all pieces are traced in the same direction)
+};
 
-void drawRGBLine(image8u &image, std::vector<color8u> &a, point2i offset, int height);
+SideSignature buildSideSignature(std::span<const point2i> pixels);
 
-void drawGraph(image8u &image, std::vector<color8u> &a, point2i offset, int height);
+// Everything the matching needs about one side of a piece, built once per (piece, side) and then only read.
+// Sides are matched as a zipper: side A clockwise against side B counter-clockwise, so both orders are kept.
+// Samples are planar (see PlanarProfileView) and packed one after another into one buffer: colors along the side
+// clockwise, then the profile (colors blurred with profileBlurStrength) clockwise and counter-clockwise,
+// so that comparing two sides reads a few contiguous cache lines of each. White sides have no profiles.
+struct SideDescriptor final {
+    std::vector<std::uint8_t> packed;      // [(mostlyWhite ? 1 : 3) * channels * length()]
+    int samples = 0;
+    int channels = 0;
+    float profileBlurStrength = 0.0f;
+    bool mostlyWhite = false;              // border of the whole image: such sides have no neighbours
+    SideSignature signature;
 
-void drawGraph(image8u &image, std::vector<float> &a, point2i offset, int height, float maxValue=-1.0f);
+    int length() const noexcept { return samples; }
+
+    PlanarProfileView colors() const noexcept { return {packed.data(), samples, channels}; }
+    // Must not be white
+    PlanarProfileView profile(bool reversed) const noexcept {
+        return {packed.data() + static_cast<std::size_t>(reversed ? 2 : 1) * channels * samples, samples, channels};
+    }
+
+    // Profile resampled to n <= length() samples: the packed one when n == length(), otherwise resampled into scratch
+    PlanarProfileView profileOfLength(int n, bool reversed, PlanarProfile8u &scratch) const;
+};
+
+SideDescriptor buildSideDescriptor(const image8u &image, std::span<const point2i> pixels, float blurStrength);
+// The same for the piece at offset in the whole frame, without its crop: colors are bilinear samples of the frame at
+// offset + pixels moved by inset pixels along the inward normal of the side (0 - exactly the pixels, as above)
+SideDescriptor buildSideDescriptor(image8u_cview frame, point2i offset, std::span<const point2i> pixels, float inset,
+                                   float blurStrength);
+
+void drawImage(image8u &image, const image8u &image_part, point2i offset);
+
+void drawRGBLine(image8u &image, const std::vector<color8u> &a, point2i offset, int height);
+
+void drawGraph(image8u &image, const std::vector<color8u> &a, point2i offset, int height);
+
+void drawGraph(image8u &image, const std::vector<float> &a, point2i offset, int height, float maxValue=-1.0f);
+
+// Plot of one compared pair of sides (side A is the same for all plots of an atlas)
+struct MatchPlot final {
+    int objB = -1;
+    int sideB = -1;
+    float difference = 0.0f;
+    image8u image;
+};
+
+// Stacks the plots of one side top to bottom by increasing difference (rows narrower than the widest plot are black),
+// so that a side is written as one image instead of one per pair. index gets one line per plot: "y height difference objB sideB"
+image8u stackMatchPlots(std::vector<MatchPlot> plots, std::string &index);
 
 // pad with zeros so that string has at least minLength symbols
 std::string pad(int v, int minLength);
@@ -0,0 +1,348 @@
+#include "stage_cache.h"
+
+#include <libbase/runtime_assert.h>
+#include <libimages/mapped_file.h>
+#include <libimages/run_length_mask.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <thread>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'V', 'P', 'S', 'T', 'A', 'G', 'E'};
+constexpr std::uint32_t kPiecesKind = 1;
+constexpr std::uint32_t kDescriptorsKind = 2;
+
+class Writer final {
+public:
+    explicit Writer(std::ostream &out) : out_(out) {}
+
+    template <typename T>
+    void value(const T &v) {
+        out_.write(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    template <typename T>
+    void values(const std::vector<T> &vs) {
+        value<std::uint64_t>(vs.size());
+        out_.write(reinterpret_cast<const char *>(vs.data()), static_cast<std::streamsize>(sizeof(T) * vs.size()));
+    }
+
+    void points(std::span<const point2i> ps) {
+        value<std::uint64_t>(ps.size());
+        for (const point2i &p: ps) {
+            value<std::int32_t>(p.x);
+            value<std::int32_t>(p.y);
+        }
+    }
+
+    void image(const image8u &img) {
+        value<std::int32_t>(img.width());
+        value<std::int32_t>(img.height());
+        value<std::int32_t>(img.channels());
+        const std::size_t rowBytes = static_cast<std::size_t>(img.width()) * img.channels();
+        for (int y = 0; y < img.height(); ++y) out_.write(reinterpret_cast<const char *>(img.ptr(y)), static_cast<std::streamsize>(rowBytes));
+    }
+
+    void mask(const image8u &mask) {
+        const RunLengthMask rle = RunLengthMask::fromImage(mask);
+        value<std::int32_t>(rle.width());
+        value<std::int32_t>(rle.height());
+        value<std::uint64_t>(rle.runs().size());
+        for (const RunLengthMask::Run &run: rle.runs()) {
+            value<std::int32_t>(run.y);
+            value<std::int32_t>(run.x0);
+            value<std::int32_t>(run.x1);
+        }
+    }
+
+private:
+    std::ostream &out_;
+};
+
+// Every read checks the stream, a failed one (truncated or corrupted entry) only makes the result unusable
+class Reader final {
+public:
+    Reader(std::istream &in, std::uint64_t size) : in_(in), remaining_(size) {}
+
+    bool ok() const { return ok_ && in_.good(); }
+
+    template <typename T>
+    T value() {
+        T v{};
+        read(&v, sizeof(T));
+        return v;
+    }
+
+    // Number of the following items, each at least itemBytes long: a corrupted count that the rest of the file
+    // can not hold fails right away instead of turning into a huge allocation
+    std::uint64_t count(std::uint64_t itemBytes) {
+        const std::uint64_t n = value<std::uint64_t>();
+        if (n > remaining_ / itemBytes) ok_ = false;
+        return ok() ? n : 0;
+    }
+
+    template <typename T>
+    std::vector<T> values() {
+        std::vector<T> vs(count(sizeof(T)));
+        read(vs.data(), sizeof(T) * vs.size());
+        return vs;
+    }
+
+    std::vector<point2i> points() {
+        std::vector<point2i> ps(count(2 * sizeof(std::int32_t)));
+        for (point2i &p: ps) {
+            p.x = value<std::int32_t>();
+            p.y = value<std::int32_t>();
+        }
+        return ps;
+    }
+
+    image8u image() {
+        const int w = value<std::int32_t>(), h = value<std::int32_t>(), c = value<std::int32_t>();
+        if (!ok() || w <= 0 || h <= 0 || (c != 1 && c != 3 && c != 4)
+            || static_cast<std::uint64_t>(w) * h * c > remaining_) {
+            ok_ = false;
+            return {};
+        }
+        image8u img(w, h, c, ImageInit::Uninitialized);
+        const std::size_t rowBytes = static_cast<std::size_t>(w) * c;
+        for (int y = 0; y < h && ok(); ++y) read(img.ptr(y), rowBytes);
+        return img;
+    }
+
+    image8u mask() {
+        const int w = value<std::int32_t>(), h = value<std::int32_t>();
+        const std::uint64_t runs = count(3 * sizeof(std::int32_t));
+        if (!ok() || w <= 0 || h <= 0) {
+            ok_ = false;
+            return {};
+        }
+        RunLengthMask rle(w, h);
+        int prevY = -1, prevX1 = 0;
+        for (std::uint64_t i = 0; i < runs && ok(); ++i) {
+            const int y = value<std::int32_t>(), x0 = value<std::int32_t>(), x1 = value<std::int32_t>();
+            // the same order as appendRun requires, checked here so that a corrupted entry is a miss and not an assertion
+            if (y < 0 || y >= h || x0 < 0 || x1 <= x0 || x1 > w || y < prevY || (y == prevY && x0 <= prevX1)) {
+                ok_ = false;
+                break;
+            }
+            rle.appendRun(y, x0, x1);
+            prevY = y;
+            prevX1 = x1;
+        }
+        return ok() ? rle.toImage() : image8u();
+    }
+
+    void read(void *dst, std::uint64_t bytes) {
+        if (bytes > remaining_) ok_ = false;
+        if (!ok()) return;
+        in_.read(static_cast<char *>(dst), static_cast<std::streamsize>(bytes));
+        remaining_ -= bytes;
+    }
+
+private:
+
+    std::istream &in_;
+    std::uint64_t remaining_;
+    bool ok_ = true;
+};
+
+void writeHeader(Writer &w, std::uint32_t kind, const StageKey &key) {
+    for (char c: kMagic) w.value(c);
+    w.value(kStageCacheVersion);
+    w.value(kind);
+    w.value(key.value());
+    w.value(key.check());
+    w.value(key.bytes());
+    w.values(key.inputs());
+}
+
+bool readHeader(Reader &r, std::uint32_t kind, const StageKey &key) {
+    char magic[sizeof(kMagic)];
+    r.read(magic, sizeof(magic));
+    const std::uint32_t version = r.value<std::uint32_t>();
+    const std::uint32_t entryKind = r.value<std::uint32_t>();
+    if (!r.ok() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kStageCacheVersion || entryKind != kind) return false;
+    const std::uint64_t entryKey = r.value<std::uint64_t>();
+    const std::uint64_t entryCheck = r.value<std::uint64_t>();
+    const std::uint64_t entryBytes = r.value<std::uint64_t>();
+    const std::vector<std::uint8_t> entryInputs = r.values<std::uint8_t>();
+    return r.ok() && entryKey == key.value() && entryCheck == key.check() && entryBytes == key.bytes() && entryInputs == key.inputs();
+}
+
+// Writes to a file unique for this thread and renames it, so that readers see either no entry or a complete one
+template <typename WriteFn>
+void writeEntry(const std::string &path, WriteFn &&write) {
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    const std::string tmp = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        rassert(out.is_open(), 90500001, tmp);
+        Writer w(out);
+        write(w);
+        rassert(out.good(), 90500002, tmp);
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+} // namespace
+
+StageKey &StageKey::add(std::span<const std::uint8_t> bytes) {
+    for (std::uint8_t b: bytes) {
+        hash_ ^= b;
+        hash_ *= 1099511628211ull;
+        // a rotate-xor-multiply hash with another odd constant, so that inputs colliding in FNV-1a almost surely differ here
+        check_ = ((check_ << 23) | (check_ >> 41)) ^ b;
+        check_ *= 0xFF51AFD7ED558CCDull;
+    }
+    bytes_ += bytes.size();
+    return *this;
+}
+
+StageKey &StageKey::add(const std::string &value) {
+    addValue<std::uint64_t>(value.size());
+    const std::span<const std::uint8_t> bytes(reinterpret_cast<const std::uint8_t *>(value.data()), value.size());
+    keep(bytes);
+    return add(bytes);
+}
+
+void StageKey::keep(std::span<const std::uint8_t> bytes) {
+    if (bytes.empty()) return;
+    const std::size_t size = inputs_.size();
+    inputs_.resize(size + bytes.size());
+    std::memcpy(inputs_.data() + size, bytes.data(), bytes.size());
+}
+
+std::string StageKey::hex() const {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash_));
+    return buf;
+}
+
+StageCache::StageCache(std::string dir) : dir_(std::move(dir)) {}
+
+StageKey StageCache::piecesKey(const std::string &imagePath, const PuzzleSolverOptions &options) {
+    StageKey key;
+    key.addValue(kStageCacheVersion);
+    const MappedFile file(imagePath);
+    key.addValue<std::uint64_t>(file.size());
+    key.add(file.bytes());
+    key.addValue(options.thresholdScale);
+    key.addValue(options.thresholdPercentile);
+    key.addValue<std::uint64_t>(options.morphology.size());
+    for (const morphology::Op &op: options.morphology) {
+        key.addValue(static_cast<std::int32_t>(op.type));
+        key.addValue(static_cast<std::int32_t>(op.strength));
+    }
+    key.addValue(static_cast<std::int32_t>(options.coarseScale));
+    return key;
+}
+
+StageKey StageCache::descriptorsKey(const StageKey &piecesKey, const PuzzleSolverOptions &options) {
+    StageKey key = piecesKey;
+    key.addValue(options.sideBlurStrength);
+    return key;
+}
+
+std::string StageCache::path(const StageKey &key, const char *kind) const {
+    return dir_ + "/" + key.hex() + "." + kind;
+}
+
+void StageCache::savePieces(const StageKey &key, const PuzzlePieces &pieces) const {
+    writeEntry(path(key, "pieces"), [&](Writer &w) {
+        writeHeader(w, kPiecesKind, key);
+        w.value<std::uint64_t>(pieces.count());
+        for (int obj = 0; obj < pieces.count(); ++obj) {
+            w.value<std::int32_t>(pieces.offsets[obj].x);
+            w.value<std::int32_t>(pieces.offsets[obj].y);
+            w.image(pieces.images[obj]);
+            w.mask(pieces.masks[obj]);
+            w.points(pieces.contours[obj]);
+            w.points(pieces.corners[obj]);
+            w.value<std::uint64_t>(pieces.sides.sides(obj));
+            for (int side = 0; side < pieces.sides.sides(obj); ++side) w.points(pieces.sides.side(obj, side));
+        }
+    });
+}
+
+bool StageCache::loadPieces(const StageKey &key, PuzzlePieces &pieces) const {
+    std::ifstream in(path(key, "pieces"), std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return false;
+    Reader r(in, static_cast<std::uint64_t>(in.tellg()));
+    in.seekg(0);
+    if (!readHeader(r, kPiecesKind, key)) return false;
+
+    PuzzlePieces res;
+    const std::uint64_t n = r.count(1);
+    for (std::uint64_t obj = 0; obj < n && r.ok(); ++obj) {
+        const int x = r.value<std::int32_t>();
+        const int y = r.value<std::int32_t>();
+        res.offsets.emplace_back(x, y);
+        res.images.push_back(r.image());
+        res.masks.push_back(r.mask());
+        res.contours.push_back(r.points());
+        res.corners.push_back(r.points());
+        std::vector<std::vector<point2i>> sides(r.count(sizeof(std::uint64_t)));
+        for (std::vector<point2i> &side: sides) side = r.points();
+        res.sides.addPiece(sides);
+    }
+    if (!r.ok()) return false;
+    pieces = std::move(res);
+    return true;
+}
+
+void StageCache::saveDescriptors(const StageKey &key, const PuzzleSideDescriptors &descriptors) const {
+    writeEntry(path(key, "sides"), [&](Writer &w) {
+        writeHeader(w, kDescriptorsKind, key);
+        w.value<std::uint64_t>(descriptors.size());
+        for (const std::vector<SideDescriptor> &sides: descriptors) {
+            w.value<std::uint64_t>(sides.size());
+            for (const SideDescriptor &d: sides) {
+                w.value<std::int32_t>(d.samples);
+                w.value<std::int32_t>(d.channels);
+                w.values(d.packed);
+                w.value(d.profileBlurStrength);
+                w.value<std::uint8_t>(d.mostlyWhite);
+                w.value(d.signature.arcLength);
+                w.value(d.signature.chordLength);
+                w.value(d.signature.bulge);
+            }
+        }
+    });
+}
+
+bool StageCache::loadDescriptors(const StageKey &key, PuzzleSideDescriptors &descriptors) const {
+    std::ifstream in(path(key, "sides"), std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return false;
+    Reader r(in, static_cast<std::uint64_t>(in.tellg()));
+    in.seekg(0);
+    if (!readHeader(r, kDescriptorsKind, key)) return false;
+
+    PuzzleSideDescriptors res(r.count(sizeof(std::uint64_t)));
+    for (std::vector<SideDescriptor> &sides: res) {
+        sides.resize(r.count(1));
+        for (SideDescriptor &d: sides) {
+            d.samples = r.value<std::int32_t>();
+            d.channels = r.value<std::int32_t>();
+            d.packed = r.values<std::uint8_t>();
+            d.profileBlurStrength = r.value<float>();
+            d.mostlyWhite = r.value<std::uint8_t>() != 0;
+            const std::size_t plane = static_cast<std::size_t>(std::max(d.samples, 0)) * std::max(d.channels, 0);
+            if (d.packed.size() != (d.mostlyWhite ? plane : 3 * plane)) return false;
+            d.signature.arcLength = r.value<float>();
+            d.signature.chordLength = r.value<float>();
+            d.signature.bulge = r.value<float>();
+        }
+    }
+    if (!r.ok()) return false;
+    descriptors = std::move(res);
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "puzzle_solver.h"
+
+// Bump when a change of the stage code changes its results, so that old cache entries are not used anymore
+inline constexpr std::uint32_t kStageCacheVersion = 3;
+
+// Everything a stage result depends on: large inputs (the photo) only as two independent 64-bit hashes and their length,
+// small ones (options, sizes, the version) also as they are, so that an entry is checked against all of it
+// and a collision of the hash that names the entry file is a miss and not someone else's result
+class StageKey final {
+public:
+    // Only hashed
+    StageKey &add(std::span<const std::uint8_t> bytes);
+    // Hashed and kept in inputs()
+    StageKey &add(const std::string &value);
+    template <typename T>
+    StageKey &addValue(const T &value) {
+        const std::span<const std::uint8_t> bytes(reinterpret_cast<const std::uint8_t *>(&value), sizeof(T));
+        keep(bytes);
+        return add(bytes);
+    }
+
+    std::uint64_t value() const noexcept { return hash_; } // FNV-1a, names the entry
+    std::uint64_t check() const noexcept { return check_; } // the second hash
+    std::uint64_t bytes() const noexcept { return bytes_; }
+    const std::vector<std::uint8_t> &inputs() const noexcept { return inputs_; }
+    std::string hex() const;
+
+    bool operator==(const StageKey &other) const noexcept {
+        return hash_ == other.hash_ && check_ == other.check_ && bytes_ == other.bytes_ && inputs_ == other.inputs_;
+    }
+
+private:
+    void keep(std::span<const std::uint8_t> bytes);
+
+    std::uint64_t hash_ = 14695981039346656037ull;
+    std::uint64_t check_ = 0x9E3779B97F4A7C15ull;
+    std::uint64_t bytes_ = 0;
+    std::vector<std::uint8_t> inputs_;
+};
+
+// On-disk cache of stage results, content-addressed: an entry is a file named by the key of all inputs of the stages
+// that produced it, so that changes of the photo, of the options of these stages or of kStageCacheVersion simply
+// miss (old entries are never invalidated in place, the directory can be removed at any time).
+// Entries are written to a temporary file and renamed, so concurrent solvers never read a partial entry.
+// An entry keeps its whole key (see StageKey), one of another key under the same file name is a miss.
+class StageCache final {
+public:
+    explicit StageCache(std::string dir);
+
+    // Key of segment + extractPieces: bytes of the photo file, segmentation options and the version
+    static StageKey piecesKey(const std::string &imagePath, const PuzzleSolverOptions &options);
+    // Key of describeSides on top of those pieces
+    static StageKey descriptorsKey(const StageKey &piecesKey, const PuzzleSolverOptions &options);
+
+    // Masks are stored as runs (see RunLengthMask), images, contours, corners and sides as they are.
+    // False (and pieces unchanged) if there is no such entry or it is not readable.
+    bool loadPieces(const StageKey &key, PuzzlePieces &pieces) const;
+    void savePieces(const StageKey &key, const PuzzlePieces &pieces) const;
+
+    bool loadDescriptors(const StageKey &key, PuzzleSideDescriptors &descriptors) const;
+    void saveDescriptors(const StageKey &key, const PuzzleSideDescriptors &descriptors) const;
+
+    const std::string &dir() const noexcept { return dir_; }
+
+private:
+    std::string path(const StageKey &key, const char *kind) const;
+
+    std::string dir_;
+};
@@ -0,0 +1,122 @@
+#include "stage_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <libimages/image_io.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tests_utils.h"
+
+namespace {
+
+// A photo file of a small synthetic puzzle
+std::string savePhoto(const std::string &dir, std::uint32_t seed = 239) {
+    const std::string path = dir + "photo_" + std::to_string(seed) + ".png";
+    save_image(smallSyntheticPuzzle(3, 4, seed).image, path);
+    return path;
+}
+
+} // namespace
+
+TEST(stage_cache, entriesRoundTrip) {
+    const std::string dir = getUnitCaseDebugDir();
+    std::filesystem::remove_all(dir + "cache");
+    const std::string photo = savePhoto(dir);
+    const PuzzleSolver solver;
+    const image8u image = load_image(photo);
+    const PuzzleSegmentation segmentation = solver.segment(image);
+    const PuzzlePieces pieces = solver.extractPieces(image, segmentation.mask, segmentation.roi);
+    const PuzzleSideDescriptors descriptors = solver.describeSides(pieces);
+
+    const StageCache cache(dir + "cache");
+    const StageKey piecesKey = StageCache::piecesKey(photo, solver.options());
+    const StageKey descriptorsKey = StageCache::descriptorsKey(piecesKey, solver.options());
+    PuzzlePieces loadedPieces;
+    PuzzleSideDescriptors loadedDescriptors;
+    EXPECT_FALSE(cache.loadPieces(piecesKey, loadedPieces));
+    cache.savePieces(piecesKey, pieces);
+    cache.saveDescriptors(descriptorsKey, descriptors);
+    ASSERT_TRUE(cache.loadPieces(piecesKey, loadedPieces));
+    ASSERT_TRUE(cache.loadDescriptors(descriptorsKey, loadedDescriptors));
+    expectSamePieces(loadedPieces, pieces);
+    expectSameDescriptors(loadedDescriptors, descriptors);
+    EXPECT_FALSE(cache.loadDescriptors(piecesKey, loadedDescriptors)); // another key
+}
+
+TEST(stage_cache, everyInputChangesTheKey) {
+    const std::string dir = getUnitCaseDebugDir();
+    const std::string photo = savePhoto(dir);
+    const PuzzleSolverOptions base;
+    const StageKey baseKey = StageCache::piecesKey(photo, base);
+    EXPECT_TRUE(StageCache::piecesKey(photo, base) == baseKey);
+
+    const std::vector<std::function<void(PuzzleSolverOptions &)>> changes = {
+        [](PuzzleSolverOptions &o) { o.thresholdScale = 1.6; },
+        [](PuzzleSolverOptions &o) { o.thresholdPercentile = 80.0; },
+        [](PuzzleSolverOptions &o) { o.morphology.pop_back(); },
+        [](PuzzleSolverOptions &o) { o.morphology[0] = morphology::dilateOp(5); },
+        [](PuzzleSolverOptions &o) { o.morphology[0] = morphology::erodeOp(6); },
+        [](PuzzleSolverOptions &o) { o.coarseScale = 2; },
+    };
+    for (std::size_t k = 0; k < changes.size(); ++k) {
+        PuzzleSolverOptions options = base;
+        changes[k](options);
+        const StageKey key = StageCache::piecesKey(photo, options);
+        EXPECT_NE(key.value(), baseKey.value()) << "change " << k;
+        EXPECT_FALSE(key == baseKey) << "change " << k;
+    }
+    EXPECT_NE(StageCache::piecesKey(savePhoto(dir, 17), base).value(), baseKey.value());
+
+    PuzzleSolverOptions blurred = base;
+    blurred.sideBlurStrength += 1.0f;
+    EXPECT_NE(StageCache::descriptorsKey(baseKey, blurred).value(), StageCache::descriptorsKey(baseKey, base).value());
+    // options of the later stages are not inputs of these ones
+    PuzzleSolverOptions matcher = base;
+    matcher.matcher.geometricPrefilter = true;
+    EXPECT_TRUE(StageCache::piecesKey(photo, matcher) == baseKey);
+}
+
+TEST(stage_cache, entriesOfOtherKeysAndVersionsMiss) {
+    const std::string dir = getUnitCaseDebugDir();
+    std::filesystem::remove_all(dir + "cache");
+    const std::string photo = savePhoto(dir);
+    const StageCache cache(dir + "cache");
+    const PuzzleSolver solver;
+    const image8u image = load_image(photo);
+    const PuzzleSegmentation segmentation = solver.segment(image);
+    const PuzzlePieces pieces = solver.extractPieces(image, segmentation.mask, segmentation.roi);
+
+    const StageKey key = StageCache::piecesKey(photo, solver.options());
+    PuzzleSolverOptions otherOptions;
+    otherOptions.thresholdScale = 1.25;
+    const StageKey other = StageCache::piecesKey(photo, otherOptions);
+    cache.savePieces(key, pieces);
+    const std::string entry = dir + "cache/" + key.hex() + ".pieces";
+    ASSERT_TRUE(std::filesystem::exists(entry));
+
+    // the entry of key under the file name of other, as if their FNV-1a collided: the full key in the entry differs
+    std::filesystem::copy_file(entry, dir + "cache/" + other.hex() + ".pieces", std::filesystem::copy_options::overwrite_existing);
+    PuzzlePieces loaded;
+    EXPECT_FALSE(cache.loadPieces(other, loaded));
+    EXPECT_EQ(loaded.count(), 0);
+    ASSERT_TRUE(cache.loadPieces(key, loaded));
+
+    // an entry of another version of the stage code (the version follows the magic)
+    {
+        std::fstream file(entry, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8);
+        const std::uint32_t version = kStageCacheVersion + 1;
+        file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    }
+    EXPECT_FALSE(cache.loadPieces(key, loaded));
+
+    // a truncated entry
+    cache.savePieces(key, pieces);
+    std::filesystem::resize_file(entry, std::filesystem::file_size(entry) / 2);
+    EXPECT_FALSE(cache.loadPieces(key, loaded));
+}
@@ -0,0 +1,264 @@
+#include "synthetic_puzzle.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <span>
+
+#include <libbase/counter_random.h>
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/algorithms/downsample.h>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// Point (x, y) of a w x h image rotated clockwise by rot90 quarter turns
+point2i rotatePoint(point2i p, int w, int h, int rot90) {
+    for (int k = 0; k < rot90; ++k) {
+        p = {h - 1 - p.y, p.x};
+        std::swap(w, h);
+    }
+    return p;
+}
+
+// Tabs of the inner edges: hTab[r][c] - of the edge below cell (r, c), vTab[r][c] - right of it;
+// true - the tab belongs to the upper/left cell and sticks out into the lower/right one, false - the other way
+struct Edges final {
+    std::vector<std::vector<bool>> hTab;
+    std::vector<std::vector<bool>> vTab;
+};
+
+} // namespace
+
+image8u syntheticSource(int width, int height, std::uint32_t seed) {
+    rassert(width > 0 && height > 0, 90800001, width, height);
+    // streams of their own: the waves, the texture of every row of every channel (so that rows are filled in parallel)
+    const CounterRandom root(seed);
+    CounterRandom r = root.split(0);
+    struct Wave {
+        float kx, ky, phase, amplitude;
+    };
+    std::vector<Wave> waves[3];
+    for (std::vector<Wave> &channel: waves) {
+        for (int k = 0; k < 8; ++k) {
+            const float angle = r.nextFloat(0.0f, 2.0f * kPi);
+            const float wavelength = r.nextFloat(32.0f, 512.0f);
+            channel.push_back({std::cos(angle) * 2.0f * kPi / wavelength, std::sin(angle) * 2.0f * kPi / wavelength,
+                               r.nextFloat(0.0f, 2.0f * kPi), r.nextFloat(0.3f, 1.0f)});
+        }
+    }
+    image8u image(width, height, 3);
+    const CounterRandom textures = root.split(1);
+    for (int c = 0; c < 3; ++c) {
+        float norm = 0.0f;
+        for (const Wave &wave: waves[c]) norm += wave.amplitude;
+        const CounterRandom channelTexture = textures.split(c);
+        parallelForEach(0, height, [&](int j) {
+            CounterRandom texture = channelTexture.split(j);
+            for (int i = 0; i < width; ++i) {
+                float v = 0.0f;
+                for (const Wave &wave: waves[c]) v += wave.amplitude * std::sin(wave.kx * i + wave.ky * j + wave.phase);
+                const float t = texture.nextFloat(-8.0f, 8.0f);
+                image(j, i, c) = static_cast<std::uint8_t>(std::clamp(127.5f + 200.0f * v / norm + t, 0.0f, 255.0f));
+            }
+        });
+    }
+    return image;
+}
+
+SyntheticPuzzle generateSyntheticPuzzle(const image8u &source, const SyntheticPuzzleOptions &options) {
+    rassert(options.rows >= 1 && options.cols >= 1 && options.cellSize >= 8, 90800002, options.rows, options.cols, options.cellSize);
+    rassert(options.tabRadius >= 0.0f && options.tabRadius <= 0.2f, 90800003, options.tabRadius);
+    rassert(source.channels() == 3, 90800004, source.channels());
+    rassert(options.gap >= 2 && options.jitter >= 0 && options.noise >= 0, 90800005, options.gap, options.jitter, options.noise);
+    rassert(options.liftTo < 192 && options.whiteBorder >= 0, 90800011, options.liftTo, options.whiteBorder);
+    // streams of their own (see CounterRandom::split): the tabs of every cell, the shuffle, every piece and every row
+    // of the noise, so that pieces and rows are generated in parallel, the same with any number of threads,
+    // and the layout does not depend on the noise
+    const CounterRandom root(options.seed);
+    const CounterRandom tabsRandom = root.split(0), piecesRandom = root.split(2), noiseRandom = root.split(3);
+
+    const int s = options.cellSize;
+    SyntheticPuzzle puzzle;
+    puzzle.rows = options.rows;
+    puzzle.cols = options.cols;
+    const int sourceW = options.cols * s;
+    const int sourceH = options.rows * s;
+    if (source.width() == sourceW && source.height() == sourceH) {
+        puzzle.source = source;
+    } else {
+        const bool shrink = source.width() >= sourceW && source.height() >= sourceH;
+        puzzle.source = downsample(source, sourceW, sourceH, shrink ? DownsampleMethod::Area : DownsampleMethod::Nearest);
+    }
+    const float scale = (192.0f - options.liftTo) / 255.0f;
+    for (int j = 0; j < sourceH; ++j)
+        for (int i = 0; i < sourceW; ++i) {
+            const bool frame = std::min({i, j, sourceW - 1 - i, sourceH - 1 - j}) < options.whiteBorder;
+            for (int c = 0; c < 3; ++c) {
+                std::uint8_t &v = puzzle.source(j, i, c);
+                v = frame ? 255 : static_cast<std::uint8_t>(options.liftTo + std::lround(v * scale));
+            }
+        }
+
+    Edges edges;
+    edges.hTab.assign(options.rows, std::vector<bool>(options.cols));
+    edges.vTab.assign(options.rows, std::vector<bool>(options.cols));
+    for (int row = 0; row < options.rows; ++row)
+        for (int col = 0; col < options.cols; ++col) {
+            CounterRandom r = tabsRandom.split(row * options.cols + col);
+            edges.hTab[row][col] = r.nextInt(0, 1) == 1;
+            edges.vTab[row][col] = r.nextInt(0, 1) == 1;
+        }
+
+    // a tab is a disc of radius R centered R/2 beyond the middle of its edge, so it sticks out by 1.5R
+    const float radius = options.tabRadius * s;
+    const float shift = 0.5f * radius;
+    const int margin = options.tabRadius > 0.0f ? static_cast<int>(std::ceil(radius + shift)) + 1 : 0;
+    auto inDisc = [&](float x, float y, float cx, float cy) { return (x - cx) * (x - cx) + (y - cy) * (y - cy) < radius * radius; };
+    // the cell that pixel (x, y) of the source belongs to
+    auto owner = [&](int x, int y) -> std::pair<int, int> {
+        const int row = y / s;
+        const int col = x / s;
+        if (margin == 0) return {row, col};
+        const float px = x + 0.5f;
+        const float py = y + 0.5f;
+        const float midX = (col + 0.5f) * s;
+        const float midY = (row + 0.5f) * s;
+        if (row > 0 && edges.hTab[row - 1][col] && inDisc(px, py, midX, row * s + shift)) return {row - 1, col};
+        if (row + 1 < options.rows && !edges.hTab[row][col] && inDisc(px, py, midX, (row + 1) * s - shift)) return {row + 1, col};
+        if (col > 0 && edges.vTab[row][col - 1] && inDisc(px, py, col * s + shift, midY)) return {row, col - 1};
+        if (col + 1 < options.cols && !edges.vTab[row][col] && inDisc(px, py, (col + 1) * s - shift, midY)) return {row, col + 1};
+        return {row, col};
+    };
+
+    // slots of the layout: cols x rows, each fits any rotation of a piece with the jitter
+    const int extent = s + 2 * margin;
+    const int slotSize = extent + 2 * options.jitter;
+    const int pitch = slotSize + options.gap;
+    const int n = options.rows * options.cols;
+    std::vector<int> slotPieces(n);
+    std::iota(slotPieces.begin(), slotPieces.end(), 0);
+    if (options.shuffle) {
+        CounterRandom r = root.split(1);
+        for (int k = n - 1; k > 0; --k) std::swap(slotPieces[k], slotPieces[r.nextInt(0, k)]);
+    }
+    puzzle.image = image8u(options.cols * pitch + options.gap, options.rows * pitch + options.gap, 3);
+    puzzle.image.fill(options.background);
+    puzzle.pieces.resize(n);
+
+    // every piece is drawn within its own slot
+    parallelForEach(0, n, [&](int slot) {
+        const int piece = slotPieces[slot];
+        const int row = piece / options.cols;
+        const int col = piece % options.cols;
+        SyntheticPiece &p = puzzle.pieces[piece];
+        CounterRandom r = piecesRandom.split(piece);
+        p.row = row;
+        p.col = col;
+        p.rot90 = options.rotations ? r.nextInt(0, 3) : 0;
+        const point2i slotMin{options.gap + (slot % options.cols) * pitch, options.gap + (slot / options.cols) * pitch};
+        p.slot.include_pixel(slotMin.x, slotMin.y);
+        p.slot.include_pixel(slotMin.x + slotSize - 1, slotMin.y + slotSize - 1);
+        const point2i jitter{r.nextInt(-options.jitter, options.jitter), r.nextInt(-options.jitter, options.jitter)};
+        p.center = slotMin + point2i{slotSize / 2, slotSize / 2} + jitter;
+
+        // the cell with its margin in the source, pixels of the piece are moved to the photo rotated around the cell center
+        const int x0 = std::max(0, col * s - margin);
+        const int y0 = std::max(0, row * s - margin);
+        const int x1 = std::min(sourceW, (col + 1) * s + margin);
+        const int y1 = std::min(sourceH, (row + 1) * s + margin);
+        const point2i cellCenter = rotatePoint({col * s + s / 2 - (col * s - margin), row * s + s / 2 - (row * s - margin)}, extent,
+                                               extent, p.rot90);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                if (owner(x, y) != std::make_pair(row, col)) continue;
+                const point2i q = rotatePoint({x - (col * s - margin), y - (row * s - margin)}, extent, extent, p.rot90);
+                const point2i at = p.center + q - cellCenter;
+                for (int c = 0; c < 3; ++c) puzzle.image(at.y, at.x, c) = puzzle.source(y, x, c);
+            }
+        }
+    });
+
+    if (options.noise > 0) {
+        parallelForEach(0, puzzle.image.height(), [&](int j) {
+            CounterRandom r = noiseRandom.split(j);
+            for (int i = 0; i < puzzle.image.width(); ++i)
+                for (int c = 0; c < 3; ++c) {
+                    std::uint8_t &v = puzzle.image(j, i, c);
+                    v = static_cast<std::uint8_t>(std::clamp(v + r.nextInt(-options.noise, options.noise), 0, 255));
+                }
+        });
+    }
+    return puzzle;
+}
+
+std::vector<std::vector<MatchedSide>> syntheticGroundTruth(const SyntheticPuzzle &puzzle, const PuzzlePieces &pieces) {
+    const int n = static_cast<int>(puzzle.pieces.size());
+    rassert(pieces.count() == n, 90800006, pieces.count(), n);
+
+    // solver object of every synthetic piece, by the slot the object lies in
+    std::vector<int> objectOf(n, -1);
+    for (int obj = 0; obj < n; ++obj) {
+        const point2i center = pieces.offsets[obj] + point2i{pieces.masks[obj].width() / 2, pieces.masks[obj].height() / 2};
+        int found = -1;
+        for (int piece = 0; piece < n && found < 0; ++piece) {
+            const bbox2i &slot = puzzle.pieces[piece].slot;
+            if (center.x >= slot.min.x && center.x < slot.max.x && center.y >= slot.min.y && center.y < slot.max.y) found = piece;
+        }
+        rassert(found >= 0 && objectOf[found] < 0, 90800007, obj, found);
+        objectOf[found] = obj;
+    }
+
+    // side of every object in each direction of the photo (0 - up, 1 - right, 2 - down, 3 - left)
+    std::vector<std::array<int, 4>> sideTowards(n);
+    for (int piece = 0; piece < n; ++piece) {
+        const int obj = objectOf[piece];
+        std::array<int, 4> &towards = sideTowards[obj];
+        towards.fill(-1);
+        rassert(pieces.sides.sides(obj) == 4, 90800008, obj, pieces.sides.sides(obj));
+        for (int side = 0; side < 4; ++side) {
+            const std::span<const point2i> points = pieces.sides.side(obj, side);
+            const point2i v = pieces.offsets[obj] + points[points.size() / 2] - puzzle.pieces[piece].center;
+            const int dir = std::abs(v.x) > std::abs(v.y) ? (v.x > 0 ? 1 : 3) : (v.y > 0 ? 2 : 0);
+            rassert(towards[dir] < 0, 90800009, "Two sides in one direction", obj, side, towards[dir]);
+            towards[dir] = side;
+        }
+    }
+
+    const int dr[4] = {-1, 0, 1, 0};
+    const int dc[4] = {0, 1, 0, -1};
+    std::vector<std::vector<MatchedSide>> answers(n, std::vector<MatchedSide>(4));
+    for (int piece = 0; piece < n; ++piece) {
+        const SyntheticPiece &p = puzzle.pieces[piece];
+        for (int dir = 0; dir < 4; ++dir) { // in the picture
+            const int row = p.row + dr[dir];
+            const int col = p.col + dc[dir];
+            if (row < 0 || row >= puzzle.rows || col < 0 || col >= puzzle.cols) continue;
+            const int neighbour = row * puzzle.cols + col;
+            const int obj = objectOf[piece];
+            const int objB = objectOf[neighbour];
+            const int side = sideTowards[obj][(dir + p.rot90) % 4];
+            const int sideB = sideTowards[objB][((dir + 2) % 4 + puzzle.pieces[neighbour].rot90) % 4];
+            answers[obj][side] = MatchedSide(objB, sideB, 0.0f, 0.0f);
+        }
+    }
+    return answers;
+}
+
+SyntheticMatchScore scoreMatches(const std::vector<std::vector<MatchedSide>> &groundTruth,
+                                 const std::vector<std::vector<MatchedSide>> &matched) {
+    rassert(groundTruth.size() == matched.size(), 90800010, groundTruth.size(), matched.size());
+    SyntheticMatchScore score;
+    for (std::size_t obj = 0; obj < groundTruth.size(); ++obj) {
+        for (std::size_t side = 0; side < groundTruth[obj].size() && side < matched[obj].size(); ++side) {
+            const MatchedSide &expected = groundTruth[obj][side];
+            const MatchedSide &found = matched[obj][side];
+            score.correct += expected.objB == found.objB && expected.sideB == found.sideB;
+            ++score.sides;
+        }
+    }
+    return score;
+}
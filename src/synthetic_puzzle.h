@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <libbase/bbox2.h>
+#include <libbase/point2.h>
+#include <libimages/image.h>
+
+#include "puzzle_solver.h"
+
+struct SyntheticPuzzleOptions final {
+    int rows = 10;
+    int cols = 10;
+    int cellSize = 64;        // side of a piece without its tabs, the source is resized to cols x rows cells
+    float tabRadius = 0.12f;  // of a tab (a disc on every inner edge, cut out of the neighbour), in cells, 0 - straight cuts
+    bool rotations = true;    // every piece rotated by a random multiple of 90 degrees
+    bool shuffle = true;      // pieces laid out in a random order of the slots (row-major order of the grid otherwise)
+    int gap = 12;             // background between slots
+    int jitter = 4;           // random shift of a piece within its slot
+    std::uint8_t background = 16; // dark: the solver takes the background from the photo border and pieces above it
+    // source intensities are mapped to [liftTo, 192], so that pieces never merge with the background
+    // and their inner sides are never taken for the white border of the puzzle (see isMostlyWhite)
+    std::uint8_t liftTo = 64;
+    int whiteBorder = 4;          // the picture is framed in white, like the border of a real puzzle
+    int noise = 6;                // uniform per channel noise in [-noise, noise] of the whole photo
+    std::uint32_t seed = 239;
+};
+
+// A piece of the grid as it is laid out in the photo
+struct SyntheticPiece final {
+    int row = 0;
+    int col = 0;
+    int rot90 = 0;  // 0..3, clockwise
+    bbox2i slot;    // the piece lies inside (with the jitter)
+    point2i center; // of its cell in the photo
+};
+
+struct SyntheticPuzzle final {
+    image8u image;   // the photo of the laid out pieces
+    image8u source;  // the picture the pieces were cut from (cols * cellSize x rows * cellSize)
+    int rows = 0;
+    int cols = 0;
+    std::vector<SyntheticPiece> pieces; // row-major by (row, col)
+};
+
+// Colourful smooth picture (random sinusoids per channel plus a fine texture) to cut when no source is given
+image8u syntheticSource(int width, int height, std::uint32_t seed);
+
+// Cuts source (f.e. syntheticSource or a photo) into a rows x cols grid of jigsaw pieces and lays them out,
+// deterministic for the same options (with any number of threads)
+SyntheticPuzzle generateSyntheticPuzzle(const image8u &source, const SyntheticPuzzleOptions &options = {});
+
+// The ground truth in the format of MatchedSide per side of the solver pieces (like correct_matches of main):
+// objects of pieces are recognized by their slots, sides - by the direction from the cell center to their middle,
+// sides on the border of the picture are {-1, -1}
+std::vector<std::vector<MatchedSide>> syntheticGroundTruth(const SyntheticPuzzle &puzzle, const PuzzlePieces &pieces);
+
+// Sides whose best match is the ground truth one (and border sides without a match), of all sides
+struct SyntheticMatchScore final {
+    int correct = 0;
+    int sides = 0;
+};
+SyntheticMatchScore scoreMatches(const std::vector<std::vector<MatchedSide>> &groundTruth,
+                                 const std::vector<std::vector<MatchedSide>> &matched);
@@ -0,0 +1,56 @@
+#include "synthetic_puzzle.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/cpu_budget.h>
+
+#include "tests_utils.h"
+
+namespace {
+
+void expectSameLayout(const SyntheticPuzzle &a, const SyntheticPuzzle &b) {
+    ASSERT_EQ(a.pieces.size(), b.pieces.size());
+    for (std::size_t k = 0; k < a.pieces.size(); ++k) {
+        SCOPED_TRACE("piece " + std::to_string(k));
+        EXPECT_EQ(a.pieces[k].row, b.pieces[k].row);
+        EXPECT_EQ(a.pieces[k].col, b.pieces[k].col);
+        EXPECT_EQ(a.pieces[k].rot90, b.pieces[k].rot90);
+        EXPECT_EQ(a.pieces[k].slot.min, b.pieces[k].slot.min);
+        EXPECT_EQ(a.pieces[k].slot.max, b.pieces[k].slot.max);
+        EXPECT_EQ(a.pieces[k].center, b.pieces[k].center);
+    }
+}
+
+} // namespace
+
+TEST(synthetic_puzzle, sameWithAnyNumberOfThreads) {
+    const SyntheticPuzzle parallel = smallSyntheticPuzzle(4, 5, 17);
+    SyntheticPuzzle serial;
+    {
+        ThreadBudgetScope oneThread(1);
+        serial = smallSyntheticPuzzle(4, 5, 17);
+    }
+    expectSameImages(parallel.source, serial.source);
+    expectSameImages(parallel.image, serial.image);
+    expectSameLayout(parallel, serial);
+}
+
+TEST(synthetic_puzzle, layoutDoesNotDependOnTheNoise) {
+    const image8u source = syntheticSource(5 * 64, 4 * 64, 17);
+    SyntheticPuzzleOptions options;
+    options.rows = 4;
+    options.cols = 5;
+    options.seed = 17;
+    const SyntheticPuzzle noisy = generateSyntheticPuzzle(source, options);
+    options.noise = 0;
+    const SyntheticPuzzle clean = generateSyntheticPuzzle(source, options);
+    expectSameLayout(noisy, clean);
+
+    options.seed = 18;
+    const SyntheticPuzzle other = generateSyntheticPuzzle(source, options);
+    bool differs = false;
+    for (std::size_t k = 0; k < other.pieces.size(); ++k) {
+        differs |= other.pieces[k].rot90 != clean.pieces[k].rot90 || other.pieces[k].center != clean.pieces[k].center;
+    }
+    EXPECT_TRUE(differs);
+}
@@ -0,0 +1,20 @@
+#include <gtest/gtest.h>
+
+#include <libbase/task_scheduler.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Parallel stages of the solver run on several threads even on a machine with one CPU,
+// so that the checks against the serial results really compare parallel runs
+int main(int argc, char **argv) {
+    TaskScheduler::Options options;
+    options.threads = 3;
+    TaskScheduler::setGlobalOptions(options);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+#include "tests_utils.h"
+
+#include <gtest/gtest.h>
+
+#include <libbase/configure_working_directory.h>
+#include <libbase/runtime_assert.h>
+
+#include <algorithm>
+#include <filesystem>
+
+std::string getUnitCaseDebugDir() {
+    configureWorkingDirectory();
+    const ::testing::TestInfo *info = ::testing::UnitTest::GetInstance()->current_test_info();
+    rassert(info != nullptr, 90990001);
+    const std::string dir = UNIT_TESTS_DEBUG_DIR + std::string(info->test_suite_name()) + "/" + std::string(info->name()) + "/";
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+std::string assertionCode(const std::function<void()> &f) {
+    try {
+        f();
+    } catch (const assertion_error &e) {
+        return e.code();
+    }
+    return std::string();
+}
+
+SyntheticPuzzle smallSyntheticPuzzle(int rows, int cols, std::uint32_t seed) {
+    SyntheticPuzzleOptions options;
+    options.rows = rows;
+    options.cols = cols;
+    options.cellSize = 64;
+    options.seed = seed;
+    const image8u source = syntheticSource(cols * options.cellSize, rows * options.cellSize, seed);
+    return generateSyntheticPuzzle(source, options);
+}
+
+void expectSameImages(const image8u &a, const image8u &b) {
+    ASSERT_EQ(a.size(), b.size());
+    EXPECT_TRUE(a.toVector() == b.toVector());
+}
+
+void expectSamePieces(const PuzzlePieces &a, const PuzzlePieces &b) {
+    ASSERT_EQ(a.count(), b.count());
+    for (int obj = 0; obj < a.count(); ++obj) {
+        SCOPED_TRACE("piece " + std::to_string(obj));
+        EXPECT_EQ(a.offsets[obj], b.offsets[obj]);
+        expectSameImages(a.images[obj], b.images[obj]);
+        expectSameImages(a.masks[obj], b.masks[obj]);
+        EXPECT_EQ(a.contours[obj], b.contours[obj]);
+        EXPECT_EQ(a.corners[obj], b.corners[obj]);
+    }
+    EXPECT_EQ(a.sides.points, b.sides.points);
+    EXPECT_EQ(a.sides.firstSide, b.sides.firstSide);
+    EXPECT_EQ(a.sides.sideBegin, b.sides.sideBegin);
+}
+
+void expectSameDescriptors(const PuzzleSideDescriptors &a, const PuzzleSideDescriptors &b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t obj = 0; obj < a.size(); ++obj) {
+        ASSERT_EQ(a[obj].size(), b[obj].size()) << "piece " << obj;
+        for (std::size_t side = 0; side < a[obj].size(); ++side) {
+            SCOPED_TRACE("piece " + std::to_string(obj) + " side " + std::to_string(side));
+            const SideDescriptor &x = a[obj][side];
+            const SideDescriptor &y = b[obj][side];
+            EXPECT_EQ(x.packed, y.packed);
+            EXPECT_EQ(x.samples, y.samples);
+            EXPECT_EQ(x.channels, y.channels);
+            EXPECT_EQ(x.profileBlurStrength, y.profileBlurStrength);
+            EXPECT_EQ(x.mostlyWhite, y.mostlyWhite);
+            EXPECT_EQ(x.signature.arcLength, y.signature.arcLength);
+            EXPECT_EQ(x.signature.chordLength, y.signature.chordLength);
+            EXPECT_EQ(x.signature.bulge, y.signature.bulge);
+        }
+    }
+}
+
+void expectSameMatches(const std::vector<std::vector<MatchedSide>> &a, const std::vector<std::vector<MatchedSide>> &b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t obj = 0; obj < a.size(); ++obj) {
+        ASSERT_EQ(a[obj].size(), b[obj].size()) << "piece " << obj;
+        for (std::size_t side = 0; side < a[obj].size(); ++side) {
+            SCOPED_TRACE("piece " + std::to_string(obj) + " side " + std::to_string(side));
+            const MatchedSide &x = a[obj][side];
+            const MatchedSide &y = b[obj][side];
+            EXPECT_EQ(x.objB, y.objB);
+            EXPECT_EQ(x.sideB, y.sideB);
+            EXPECT_EQ(x.differenceBest, y.differenceBest);
+            EXPECT_EQ(x.differenceSecondBest, y.differenceSecondBest);
+            ASSERT_EQ(x.candidates.size, y.candidates.size);
+            for (int k = 0; k < x.candidates.size; ++k) {
+                EXPECT_EQ(x.candidates.items[k].objB, y.candidates.items[k].objB) << "candidate " << k;
+                EXPECT_EQ(x.candidates.items[k].sideB, y.candidates.items[k].sideB) << "candidate " << k;
+                EXPECT_EQ(x.candidates.items[k].cost, y.candidates.items[k].cost) << "candidate " << k;
+            }
+        }
+    }
+}
+
+void expectSameAssembly(const PuzzleAssemblyResult &a, const PuzzleAssemblyResult &b) {
+    ASSERT_EQ(a.W, b.W);
+    ASSERT_EQ(a.H, b.H);
+    ASSERT_EQ(a.grid.size(), b.grid.size());
+    for (std::size_t k = 0; k < a.grid.size(); ++k) {
+        EXPECT_EQ(a.grid[k].obj, b.grid[k].obj) << "cell " << k;
+        EXPECT_EQ(a.grid[k].rot90, b.grid[k].rot90) << "cell " << k;
+    }
+    EXPECT_EQ(a.colW, b.colW);
+    EXPECT_EQ(a.rowH, b.rowH);
+    expectSameImages(a.assembled, b.assembled);
+    expectSameImages(a.assembledWithLines, b.assembledWithLines);
+}
+
+void expectAssembledAsGroundTruth(const PuzzleAssemblyResult &assembly,
+                                  const std::vector<std::vector<MatchedSide>> &groundTruth) {
+    const int n = static_cast<int>(groundTruth.size());
+    ASSERT_EQ(assembly.W * assembly.H, n);
+    std::vector<int> placed(n, 0);
+    for (const PlacedPiece &p : assembly.grid) {
+        ASSERT_TRUE(p.obj >= 0 && p.obj < n);
+        ++placed[p.obj];
+    }
+    EXPECT_EQ(std::count(placed.begin(), placed.end(), 1), n);
+
+    auto neighbours = [&](int a, int b) {
+        return std::any_of(groundTruth[a].begin(), groundTruth[a].end(), [b](const MatchedSide &m) { return m.objB == b; });
+    };
+    for (int y = 0; y < assembly.H; ++y)
+        for (int x = 0; x < assembly.W; ++x) {
+            const int obj = assembly.grid[y * assembly.W + x].obj;
+            if (x + 1 < assembly.W) EXPECT_TRUE(neighbours(obj, assembly.grid[y * assembly.W + x + 1].obj)) << x << " " << y;
+            if (y + 1 < assembly.H) EXPECT_TRUE(neighbours(obj, assembly.grid[(y + 1) * assembly.W + x].obj)) << x << " " << y;
+        }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <libimages/image.h>
+
+#include "puzzle_solver.h"
+#include "synthetic_puzzle.h"
+
+// Helpers of the solver tests (*_tests.cpp of src/)
+
+// unit-tests/<suite>/<test>/ of the current test in the build tree (as in libimages), created; configures the working directory
+std::string getUnitCaseDebugDir();
+
+// Code of the rassert that f fails (assertion_error::code), empty if f does not throw one
+std::string assertionCode(const std::function<void()> &f);
+
+// A rows x cols synthetic puzzle of small cells that every stage of the solver handles in milliseconds
+SyntheticPuzzle smallSyntheticPuzzle(int rows = 3, int cols = 4, std::uint32_t seed = 239);
+
+// Field by field with gtest expectations (pixels, points, packed profiles, candidates), so that a mismatch names the piece
+void expectSameImages(const image8u &a, const image8u &b);
+void expectSamePieces(const PuzzlePieces &a, const PuzzlePieces &b);
+void expectSameDescriptors(const PuzzleSideDescriptors &a, const PuzzleSideDescriptors &b);
+void expectSameMatches(const std::vector<std::vector<MatchedSide>> &a, const std::vector<std::vector<MatchedSide>> &b);
+void expectSameAssembly(const PuzzleAssemblyResult &a, const PuzzleAssemblyResult &b);
+
+// Every two pieces next to each other on the board are neighbours in the picture (by the ground truth of syntheticGroundTruth)
+// and every piece is placed once
+void expectAssembledAsGroundTruth(const PuzzleAssemblyResult &assembly,
+                                  const std::vector<std::vector<MatchedSide>> &groundTruth);
@@ -0,0 +1,264 @@
+#include "tiled_segmentation.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <numeric>
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/algorithms/grayscale.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/image_row_reader.h>
+#include <libimages/run_length_mask.h>
+
+namespace {
+
+using word_type = BitMask::word_type;
+
+struct LabelledRun final {
+    int y = 0;
+    int x0 = 0; // first pixel
+    int x1 = 0; // past the last pixel
+    int label = 0;
+};
+
+// Union-find that grows by a label per new run
+class Labels final {
+public:
+    int make() {
+        parent_.push_back(static_cast<int>(parent_.size()));
+        return parent_.back();
+    }
+
+    int find(int label) {
+        while (parent_[label] != label) {
+            parent_[label] = parent_[parent_[label]];
+            label = parent_[label];
+        }
+        return label;
+    }
+
+    int unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a > b) std::swap(a, b);
+        parent_[b] = a;
+        return a;
+    }
+
+private:
+    std::vector<int> parent_;
+};
+
+// Calls f(x0, x1) for every run of set bits of a mask row
+template <typename F>
+void forEachRun(const word_type *row, int words, F &&f) {
+    int x0 = -1;
+    for (int k = 0; k < words; ++k) {
+        word_type word = row[k];
+        int bit = 0;
+        while (bit < BitMask::bits_per_word) {
+            if (x0 < 0) {
+                const word_type rest = word >> bit;
+                if (rest == 0) break;
+                bit += std::countr_zero(rest);
+                x0 = k * BitMask::bits_per_word + bit;
+            } else {
+                const word_type rest = ~word >> bit;
+                if (rest == 0) break;
+                bit += std::countr_zero(rest);
+                f(x0, k * BitMask::bits_per_word + bit);
+                x0 = -1;
+            }
+        }
+    }
+    if (x0 >= 0) f(x0, words * BitMask::bits_per_word); // bits past the width are zero, so only for w % 64 == 0
+}
+
+} // namespace
+
+PuzzlePieces segmentTiled(const PuzzleSolver &solver, const std::string &path, const TiledSegmentationOptions &options,
+                          TiledSegmentationStats *stats) {
+    const PuzzleSolverOptions &solverOptions = solver.options();
+    ImageRowReader reader(path);
+    const int w = reader.width();
+    const int h = reader.height();
+    rassert(reader.channels() == 3, 90700001, reader.channels(), path);
+
+    int support = 0;
+    for (const morphology::Op &op: solverOptions.morphology) support += op.strength;
+
+    // per row of a band: the row itself, its thresholded bits read ahead and in the window, the window result;
+    // the halo rows of the window are there for every band
+    const int words = (w + BitMask::bits_per_word - 1) / BitMask::bits_per_word;
+    const std::size_t wordBytes = static_cast<std::size_t>(words) * sizeof(word_type);
+    const std::size_t perRow = static_cast<std::size_t>(w) * 3 + 4 * wordBytes;
+    const std::size_t fixed = 3 * static_cast<std::size_t>(2 * support) * wordBytes;
+    rassert(options.maxBytes >= fixed + perRow, 90700002, "Memory budget is too small for a row of the scan", options.maxBytes,
+            fixed + perRow);
+    const int bandRows = static_cast<int>(std::min<std::size_t>(h, (options.maxBytes - fixed) / perRow));
+
+    TiledSegmentationStats local;
+    TiledSegmentationStats &st = stats ? *stats : local;
+    st = {};
+    st.bandRows = bandRows;
+    st.streamed = reader.streaming();
+    auto account = [&](std::size_t bytes) { st.workingBytes = std::max(st.workingBytes, bytes); };
+
+    // 1. the border in the order of grayscale_border
+    std::vector<float> border;
+    border.reserve(static_cast<std::size_t>(2 * w + 2 * std::max(0, h - 2)));
+    while (!reader.done()) {
+        const int y0 = reader.nextRow();
+        const image8u band = reader.read(bandRows);
+        account(band.width() * static_cast<std::size_t>(band.height()) * 3);
+        for (int j = 0; j < band.height(); ++j) {
+            const int y = y0 + j;
+            auto intensity = [&](int i) {
+                const std::uint8_t *px = band.ptr(j, i);
+                return grayscale_intensity(px[0], px[1], px[2]);
+            };
+            if (y == 0 || y == h - 1) {
+                for (int i = 0; i < w; ++i) border.push_back(intensity(i));
+            } else {
+                border.push_back(intensity(0));
+                if (w > 1) border.push_back(intensity(w - 1));
+            }
+        }
+    }
+    st.backgroundThreshold = solver.backgroundThreshold(border);
+    const float threshold = static_cast<float>(st.backgroundThreshold);
+
+    // 2. thresholded rows [thresholdedY0, thresholdedY0 + thresholded.size()) are kept while a window needs them,
+    // the window of a band is the band with the support of the morphology above and below: zero padding of the pipeline
+    // is then what the scan is outside of it, so the rows of the band are exactly the full resolution mask
+    reader.rewind();
+    std::deque<std::vector<word_type>> thresholded;
+    int thresholdedY0 = 0;
+    Labels labels;
+    std::vector<LabelledRun> runs;
+    std::size_t previousBegin = 0; // runs of the previous row are [previousBegin, previousEnd)
+    std::size_t previousEnd = 0;
+    for (int y0 = 0; y0 < h; y0 += bandRows) {
+        const int y1 = std::min(h, y0 + bandRows);
+        const int windowY0 = std::max(0, y0 - support);
+        const int windowY1 = std::min(h, y1 + support);
+        std::size_t bandBytes = 0;
+        while (thresholdedY0 + static_cast<int>(thresholded.size()) < windowY1) {
+            const image8u band = reader.read(bandRows);
+            bandBytes = std::max(bandBytes, band.width() * static_cast<std::size_t>(band.height()) * 3);
+            const BitMask bits = threshold_grayscale_bitmask(band, threshold);
+            for (int j = 0; j < bits.height(); ++j) thresholded.emplace_back(bits.row(j), bits.row(j) + words);
+            account(bandBytes + (thresholded.size() + bits.height()) * wordBytes);
+        }
+        while (thresholdedY0 < windowY0) {
+            thresholded.pop_front();
+            ++thresholdedY0;
+        }
+
+        BitMask window(w, windowY1 - windowY0);
+        for (int j = 0; j < window.height(); ++j) {
+            std::memcpy(window.row(j), thresholded[windowY0 + j - thresholdedY0].data(), wordBytes);
+        }
+        const BitMask mask = morphology::pipeline(window, solverOptions.morphology, solverOptions.with_openmp);
+        account(bandBytes + (thresholded.size() + 2 * static_cast<std::size_t>(window.height())) * wordBytes);
+        ++st.bands;
+
+        // runs of a row join the 8-connected runs of the previous row: [x0, x1) touches [p0, p1) if p0 <= x1 && x0 <= p1
+        for (int y = y0; y < y1; ++y) {
+            const std::size_t rowBegin = runs.size();
+            std::size_t p = previousBegin;
+            forEachRun(mask.row(y - windowY0), words, [&](int x0, int x1) {
+                while (p < previousEnd && runs[p].x1 < x0) ++p;
+                int label = -1;
+                for (std::size_t q = p; q < previousEnd && runs[q].x0 <= x1; ++q) {
+                    label = label < 0 ? labels.find(runs[q].label) : labels.unite(label, runs[q].label);
+                }
+                runs.push_back({y, x0, x1, label < 0 ? labels.make() : label});
+            });
+            previousBegin = rowBegin;
+            previousEnd = runs.size();
+        }
+    }
+    st.runs = runs.size();
+
+    // components in the order of connectedComponents: by the top-left corner of the bbox, then by the first pixel
+    std::vector<int> componentOfRoot;
+    std::vector<int> componentOfRun(runs.size());
+    std::vector<bbox2i> bboxes;
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        const int root = labels.find(runs[r].label);
+        if (root >= static_cast<int>(componentOfRoot.size())) componentOfRoot.resize(root + 1, -1);
+        if (componentOfRoot[root] < 0) {
+            componentOfRoot[root] = static_cast<int>(bboxes.size());
+            bboxes.emplace_back();
+        }
+        const int component = componentOfRoot[root];
+        componentOfRun[r] = component;
+        bboxes[component].include_pixel(runs[r].x0, runs[r].y);
+        bboxes[component].include_pixel(runs[r].x1 - 1, runs[r].y);
+    }
+    const int n = static_cast<int>(bboxes.size());
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    // components are numbered by their first pixel in raster order already, so a stable sort breaks the ties
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return std::make_pair(bboxes[a].min.y, bboxes[a].min.x) < std::make_pair(bboxes[b].min.y, bboxes[b].min.x);
+    });
+    std::vector<int> rank(n);
+    for (int k = 0; k < n; ++k) rank[order[k]] = k;
+
+    PuzzlePieces pieces;
+    pieces.offsets.resize(n);
+    pieces.images.resize(n);
+    pieces.masks.resize(n);
+    pieces.contours.resize(n);
+    pieces.corners.resize(n);
+    std::vector<RunLengthMask> runMasks(n);
+    for (int k = 0; k < n; ++k) {
+        const bbox2i &bbox = bboxes[order[k]];
+        pieces.offsets[k] = bbox.min;
+        runMasks[k] = RunLengthMask(bbox.width(), bbox.height());
+    }
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        const int k = rank[componentOfRun[r]];
+        const point2i origin = pieces.offsets[k];
+        runMasks[k].appendRun(runs[r].y - origin.y, runs[r].x0 - origin.x, runs[r].x1 - origin.x);
+    }
+    runs = {};
+    for (int k = 0; k < n; ++k) pieces.masks[k] = runMasks[k].toImage();
+    runMasks = {};
+
+    // 3. crops of the components, allocated when the band reaches their first row
+    reader.rewind();
+    int opened = 0;
+    std::vector<int> active;
+    while (!reader.done()) {
+        const int y0 = reader.nextRow();
+        const image8u band = reader.read(bandRows);
+        account(band.width() * static_cast<std::size_t>(band.height()) * 3);
+        const int y1 = y0 + band.height();
+        while (opened < n && pieces.offsets[opened].y < y1) {
+            const bbox2i &bbox = bboxes[order[opened]];
+            pieces.images[opened] = image8u(bbox.width(), bbox.height(), 3, ImageInit::Uninitialized);
+            active.push_back(opened++);
+        }
+        for (int k: active) {
+            const point2i origin = pieces.offsets[k];
+            image8u &crop = pieces.images[k];
+            const int from = std::max(y0, origin.y);
+            const int to = std::min(y1, origin.y + crop.height());
+            for (int y = from; y < to; ++y) {
+                std::memcpy(crop.ptr(y - origin.y), band.ptr(y - y0, origin.x), static_cast<std::size_t>(crop.width()) * 3);
+            }
+        }
+        std::erase_if(active, [&](int k) { return pieces.offsets[k].y + pieces.images[k].height() <= y1; });
+    }
+
+    // pieces are independent, each task writes only its own items
+    parallelForEach(0, n, [&](int obj) { solver.tracePiece(pieces, obj); }, solverOptions.with_openmp);
+    solver.splitSides(pieces);
+    return pieces;
+}
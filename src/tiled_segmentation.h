@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "puzzle_solver.h"
+
+struct TiledSegmentationOptions final {
+    // Working memory of the segmentation: a band of the scan, its thresholded rows with the halo of the morphology
+    // and the morphology window (the rows of a band are chosen to fit). The runs of the foreground kept for labelling
+    // and the piece crops themselves are on top of it.
+    std::size_t maxBytes = std::size_t(256) << 20;
+};
+
+struct TiledSegmentationStats final {
+    int bandRows = 0;
+    int bands = 0;
+    double backgroundThreshold = 0.0;
+    std::size_t workingBytes = 0; // peak of the budgeted buffers
+    std::size_t runs = 0;         // foreground runs labelled (proportional to the length of the boundaries, not to the area)
+    bool streamed = false;        // the scan was never decoded whole (see ImageRowReader::streaming)
+};
+
+// segment + extractPieces of solver for a scan too large for memory, read by bands of rows (see ImageRowReader):
+//   1. the border of the scan - for the background threshold,
+//   2. every band is thresholded and goes through the morphology with a halo of the support of the morphology above
+//      and below (so that the mask is exactly the full resolution one), its rows are labelled as runs of foreground
+//      that merge with the runs of the previous row (8-connectivity), so components spanning bands are merged,
+//   3. the crops of the components are copied from the bands.
+// The scan is read three times, pieces are the same as of extractPieces (in the same order), coarseScale is not used.
+PuzzlePieces segmentTiled(const PuzzleSolver &solver, const std::string &path, const TiledSegmentationOptions &options = {},
+                          TiledSegmentationStats *stats = nullptr);
@@ -0,0 +1,67 @@
+#include "tiled_segmentation.h"
+
+#include <gtest/gtest.h>
+
+#include <libimages/image_io.h>
+
+#include <cstddef>
+#include <string>
+
+#include "tests_utils.h"
+
+namespace {
+
+PuzzlePieces segmentInMemory(const PuzzleSolver &solver, const std::string &path) {
+    const image8u image = load_image(path);
+    const PuzzleSegmentation segmentation = solver.segment(image);
+    return solver.extractPieces(image, segmentation.mask, segmentation.roi);
+}
+
+// Budgets from a few bands to the whole scan at once
+void expectSameAsInMemory(const std::string &path, bool streamed) {
+    const PuzzleSolver solver;
+    const PuzzlePieces reference = segmentInMemory(solver, path);
+    ASSERT_GT(reference.images.size(), 0u);
+    int previousBands = 0;
+    for (std::size_t maxBytes : {std::size_t(60) << 10, std::size_t(200) << 10, std::size_t(256) << 20}) {
+        SCOPED_TRACE("maxBytes=" + std::to_string(maxBytes));
+        TiledSegmentationOptions options;
+        options.maxBytes = maxBytes;
+        TiledSegmentationStats stats;
+        const PuzzlePieces pieces = segmentTiled(solver, path, options, &stats);
+        expectSamePieces(pieces, reference);
+        EXPECT_EQ(stats.streamed, streamed);
+        EXPECT_GE(stats.bands, 1);
+        if (previousBands > 0) EXPECT_LE(stats.bands, previousBands);
+        previousBands = stats.bands;
+        if (maxBytes == (std::size_t(60) << 10)) {
+            EXPECT_GT(stats.bands, 2); // so that components and the halo of the morphology span bands
+            EXPECT_LE(stats.workingBytes, maxBytes);
+        }
+    }
+}
+
+} // namespace
+
+TEST(tiled_segmentation, samePiecesAsInMemoryOnSamplePhoto) {
+    const std::string dir = getUnitCaseDebugDir();
+    const std::string jpg = "data/00_photo_six_parts_downscaled_x4.jpg";
+    const std::string ppm = dir + "photo.ppm";
+    save_image(load_image(jpg), ppm);
+
+    {
+        SCOPED_TRACE("ppm");
+        expectSameAsInMemory(ppm, true);
+    }
+    {
+        SCOPED_TRACE("jpg");
+        expectSameAsInMemory(jpg, false);
+    }
+}
+
+TEST(tiled_segmentation, samePiecesAsInMemoryOnSyntheticPuzzle) {
+    const std::string dir = getUnitCaseDebugDir();
+    const std::string ppm = dir + "photo.ppm";
+    save_image(smallSyntheticPuzzle(4, 5, 17).image, ppm);
+    expectSameAsInMemory(ppm, true);
+}
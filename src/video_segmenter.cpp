@@ -0,0 +1,214 @@
+#include "video_segmenter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+
+#include <libbase/runtime_assert.h>
+#include <libbase/task_scheduler.h>
+#include <libimages/algorithms/grayscale.h>
+#include <libimages/algorithms/morphology.h>
+#include <libimages/algorithms/split_into_parts.h>
+#include <libimages/algorithms/threshold_masking.h>
+#include <libimages/image_view.h>
+
+namespace {
+
+bbox2i makeBox(int x0, int y0, int x1, int y1) {
+    bbox2i box;
+    box.include_pixel(x0, y0);
+    box.include_pixel(x1 - 1, y1 - 1);
+    return box;
+}
+
+// box grown by margin on every side, clamped to the w x h frame
+bbox2i grown(const bbox2i &box, int margin, int w, int h) {
+    return makeBox(std::max(0, box.min.x - margin), std::max(0, box.min.y - margin),
+                   std::min(w, box.max.x + margin), std::min(h, box.max.y + margin));
+}
+
+bool intersects(const bbox2i &a, const bbox2i &b) {
+    return a.min.x < b.max.x && b.min.x < a.max.x && a.min.y < b.max.y && b.min.y < a.max.y;
+}
+
+bool sameMask(const image8u &a, const image8u &b) {
+    if (a.width() != b.width() || a.height() != b.height()) return false;
+    for (int y = 0; y < a.height(); ++y) {
+        if (!std::equal(a.ptr(y), a.ptr(y) + a.width(), b.ptr(y))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+VideoSegmenter::VideoSegmenter(const PuzzleSolverOptions &options, const VideoSegmenterOptions &videoOptions)
+    : solver_(options), options_(videoOptions) {
+    rassert(options_.tileSize > 0, 90600001, options_.tileSize);
+    rassert(options_.changeTolerance >= 0, 90600002, options_.changeTolerance);
+    rassert(options_.thresholdTolerance >= 0.0, 90600003, options_.thresholdTolerance);
+    for (const morphology::Op &op: options.morphology) support_ += op.strength;
+}
+
+void VideoSegmenter::reset() {
+    reference_ = image8u();
+}
+
+VideoFrameStats VideoSegmenter::update(const image8u &frame) {
+    auto [w, h, c] = frame.size();
+    rassert(c == 3, 90600004, c);
+    const int tile = options_.tileSize;
+
+    VideoFrameStats stats;
+    stats.tiles = ((w + tile - 1) / tile) * ((h + tile - 1) / tile);
+
+    bool full = reference_.width() != w || reference_.height() != h;
+    if (!full) {
+        const double threshold = solver_.backgroundThreshold(grayscale_border(frame));
+        full = std::abs(threshold - threshold_) > options_.thresholdTolerance;
+    }
+    if (full) {
+        PuzzleSegmentation segmentation = solver_.segment(frame);
+        threshold_ = segmentation.backgroundThreshold;
+        mask_ = std::move(segmentation.mask);
+        reference_ = frame;
+        pieces_ = solver_.extractPieces(frame, mask_);
+        descriptors_ = solver_.describeSides(pieces_);
+        stats.full = true;
+        stats.changedTiles = stats.tiles;
+        stats.regions = 1;
+        stats.pieces = stats.updatedPieces = pieces_.count();
+        return stats;
+    }
+
+    const std::vector<bbox2i> regions = changedRegions(frame, stats);
+    stats.regions = static_cast<int>(regions.size());
+    if (!regions.empty()) {
+        std::vector<bbox2i> written;
+        for (const bbox2i &region: regions) {
+            resegment(frame, region);
+            written.push_back(grown(region, support_, w, h));
+        }
+        updatePieces(frame, written, stats);
+    }
+    stats.pieces = pieces_.count();
+    return stats;
+}
+
+std::vector<bbox2i> VideoSegmenter::changedRegions(const image8u &frame, VideoFrameStats &stats) const {
+    auto [w, h, c] = frame.size();
+    const int tile = options_.tileSize;
+    const int tilesX = (w + tile - 1) / tile, tilesY = (h + tile - 1) / tile;
+
+    std::vector<char> changed(static_cast<std::size_t>(tilesX) * tilesY, 0);
+    parallelForEach(0, tilesY, [&](int ty) {
+        const int y0 = ty * tile, y1 = std::min(h, y0 + tile);
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const int from = tx * tile * c, to = std::min(w, (tx + 1) * tile) * c;
+            bool differs = false;
+            for (int y = y0; y < y1 && !differs; ++y) {
+                const std::uint8_t *a = frame.ptr(y), *b = reference_.ptr(y);
+                for (int k = from; k < to; ++k) {
+                    if (std::abs(int(a[k]) - int(b[k])) > options_.changeTolerance) {
+                        differs = true;
+                        break;
+                    }
+                }
+            }
+            changed[ty * tilesX + tx] = differs;
+        }
+    }, solver_.options().with_openmp);
+
+    // changed tiles of a row closer than both margins are one region: re-segmenting the gap is cheaper than two margins
+    const int maxGap = (2 * support_ + tile - 1) / tile;
+    std::vector<bbox2i> regions;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        int runFrom = -1, runTo = -1;
+        auto flush = [&] {
+            if (runFrom >= 0) regions.push_back(makeBox(runFrom * tile, ty * tile, std::min(w, runTo * tile), std::min(h, (ty + 1) * tile)));
+            runFrom = -1;
+        };
+        for (int tx = 0; tx < tilesX; ++tx) {
+            if (!changed[ty * tilesX + tx]) continue;
+            ++stats.changedTiles;
+            if (runFrom >= 0 && tx - runTo > maxGap) flush();
+            if (runFrom < 0) runFrom = tx;
+            runTo = tx + 1;
+        }
+        flush();
+    }
+    return regions;
+}
+
+void VideoSegmenter::resegment(const image8u &frame, const bbox2i &region) {
+    auto [w, h, c] = frame.size();
+    // the mask of written depends only on the pixels of crop, so it is exactly the mask of a full segment
+    // (at the frame border the crop is clamped the same way as the zero padding of the morphology)
+    const bbox2i written = grown(region, support_, w, h);
+    const bbox2i crop = grown(written, support_, w, h);
+
+    const image8u cropImage = image8u_cview(frame).subview(crop.min.x, crop.min.y, crop.width(), crop.height()).toImage();
+    const BitMask cropMask = morphology::pipeline(threshold_grayscale_bitmask(cropImage, threshold_), solver_.options().morphology,
+                                                  solver_.options().with_openmp);
+    for (int y = written.min.y; y < written.max.y; ++y) {
+        for (int x = written.min.x; x < written.max.x; ++x) {
+            mask_.set(y, x, cropMask.test(y - crop.min.y, x - crop.min.x));
+        }
+    }
+    for (int y = region.min.y; y < region.max.y; ++y) {
+        std::copy(frame.ptr(y) + region.min.x * c, frame.ptr(y) + region.max.x * c, reference_.ptr(y) + region.min.x * c);
+    }
+}
+
+void VideoSegmenter::updatePieces(const image8u &frame, const std::vector<bbox2i> &written, VideoFrameStats &stats) {
+    const SplitObjectsViews views = splitObjectsViews(frame, mask_, solver_.options().with_openmp);
+    const int n = views.objectsCount();
+
+    std::map<std::tuple<int, int, int, int>, int> previous; // bbox -> piece of the previous frames
+    for (int obj = 0; obj < pieces_.count(); ++obj) {
+        const point2i &offset = pieces_.offsets[obj];
+        previous.emplace(std::make_tuple(offset.x, offset.y, pieces_.masks[obj].width(), pieces_.masks[obj].height()), obj);
+    }
+
+    PuzzlePieces next;
+    next.offsets = views.offsets;
+    next.images.resize(n);
+    next.masks.resize(n);
+    next.contours.resize(n);
+    next.corners.resize(n);
+    PuzzleSideDescriptors nextDescriptors(n);
+    std::vector<int> updated;
+    for (int obj = 0; obj < n; ++obj) {
+        const point2i &offset = views.offsets[obj];
+        const int pw = views.images[obj].width(), ph = views.images[obj].height();
+        next.masks[obj] = views.objectMask(obj);
+
+        // a component that no re-segmented region reaches (with its 8-connected ring) is the same set of pixels
+        const bbox2i box = makeBox(offset.x - 1, offset.y - 1, offset.x + pw + 1, offset.y + ph + 1);
+        const bool touched = std::any_of(written.begin(), written.end(), [&](const bbox2i &r) { return intersects(r, box); });
+        auto old = previous.find(std::make_tuple(offset.x, offset.y, pw, ph));
+        if (!touched && old != previous.end() && sameMask(pieces_.masks[old->second], next.masks[obj])) {
+            const int prev = old->second;
+            next.images[obj] = std::move(pieces_.images[prev]);
+            next.contours[obj] = std::move(pieces_.contours[prev]);
+            next.corners[obj] = std::move(pieces_.corners[prev]);
+            nextDescriptors[obj] = std::move(descriptors_[prev]);
+            previous.erase(old);
+        } else {
+            next.images[obj] = views.images[obj].toImage();
+            updated.push_back(obj);
+        }
+    }
+
+    parallelForEach(0, static_cast<int>(updated.size()), [&](int k) { solver_.tracePiece(next, updated[k]); }, solver_.options().with_openmp);
+    // sides of all pieces are re-split into one buffer, it is a copy of their contours
+    solver_.splitSides(next);
+    parallelForEach(0, static_cast<int>(updated.size()), [&](int k) {
+        nextDescriptors[updated[k]] = solver_.describePiece(next, updated[k]);
+    }, solver_.options().with_openmp);
+
+    pieces_ = std::move(next);
+    descriptors_ = std::move(nextDescriptors);
+    stats.updatedPieces = static_cast<int>(updated.size());
+}
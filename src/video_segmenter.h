@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include <libbase/bbox2.h>
+#include <libimages/bit_mask.h>
+#include <libimages/image.h>
+
+#include "puzzle_solver.h"
+
+struct VideoSegmenterOptions final {
+    // Frames are compared with the previous ones by tiles of tileSize x tileSize pixels
+    int tileSize = 32;
+    // A tile changed if some channel of some pixel differs from the frame it was last segmented on by more than this
+    // (so that sensor noise does not re-segment the whole frame)
+    int changeTolerance = 12;
+    // The whole frame is re-segmented if its background threshold drifted by more than this (f.e. lighting changed)
+    double thresholdTolerance = 2.0;
+};
+
+struct VideoFrameStats final {
+    bool full = false;     // the whole frame was segmented (the first frame, another size or threshold drift)
+    int tiles = 0;
+    int changedTiles = 0;
+    int regions = 0;       // re-segmented rectangles (runs of changed tiles of a row of tiles)
+    int pieces = 0;
+    int updatedPieces = 0; // traced and described anew, the others are those of the previous frames
+};
+
+// Segmentation and pieces of a video stream of the same scene (f.e. a camera over a table):
+// only the tiles that changed since the previous frames are thresholded and go through the morphology again
+// (with a margin of the support of the morphology, so that the mask is exactly the one of a full segment there),
+// pieces are relabelled on the whole mask (cheap), but only pieces whose bbox touches a re-segmented region
+// are cropped, traced and described again, the others (with the same bbox) keep their crops and descriptors.
+// The background threshold is kept between frames as long as it does not drift, so that unchanged areas stay valid.
+class VideoSegmenter final {
+public:
+    explicit VideoSegmenter(const PuzzleSolverOptions &options, const VideoSegmenterOptions &videoOptions = {});
+
+    // Next 3-channel frame
+    VideoFrameStats update(const image8u &frame);
+    // The next frame is segmented fully
+    void reset();
+
+    const PuzzleSolver &solver() const noexcept { return solver_; }
+    const BitMask &mask() const noexcept { return mask_; }
+    double backgroundThreshold() const noexcept { return threshold_; }
+    const PuzzlePieces &pieces() const noexcept { return pieces_; }
+    const PuzzleSideDescriptors &descriptors() const noexcept { return descriptors_; }
+
+private:
+    // Tiles that differ from reference_, as runs of a row of tiles in pixels
+    std::vector<bbox2i> changedRegions(const image8u &frame, VideoFrameStats &stats) const;
+    void resegment(const image8u &frame, const bbox2i &region);
+    void updatePieces(const image8u &frame, const std::vector<bbox2i> &written, VideoFrameStats &stats);
+
+    PuzzleSolver solver_;
+    VideoSegmenterOptions options_;
+    int support_ = 0;  // how far a pixel of the input affects the mask (sum of the strengths of the morphology)
+
+    image8u reference_; // per tile - the frame that tile was last segmented on
+    double threshold_ = 0.0;
+    BitMask mask_;
+    PuzzlePieces pieces_;
+    PuzzleSideDescriptors descriptors_;
+};
@@ -0,0 +1,118 @@
+#include "video_segmenter.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tests_utils.h"
+
+namespace {
+
+// Piece obj of pieces removed from frame (its bbox filled with the background)
+image8u withoutPiece(const image8u &frame, const PuzzlePieces &pieces, int obj, std::uint8_t background) {
+    image8u result = frame;
+    const point2i &offset = pieces.offsets[obj];
+    for (int y = offset.y; y < offset.y + pieces.masks[obj].height(); ++y) {
+        for (int x = offset.x; x < offset.x + pieces.masks[obj].width(); ++x) {
+            for (int c = 0; c < 3; ++c) result(y, x, c) = background;
+        }
+    }
+    return result;
+}
+
+// Pixels of piece obj (under its mask) of from pasted into frame shifted by (dx, dy)
+image8u withPiece(const image8u &frame, const image8u &from, const PuzzlePieces &pieces, int obj, int dx, int dy) {
+    image8u result = frame;
+    const point2i &offset = pieces.offsets[obj];
+    const image8u &mask = pieces.masks[obj];
+    for (int y = 0; y < mask.height(); ++y) {
+        for (int x = 0; x < mask.width(); ++x) {
+            if (!mask(y, x)) continue;
+            for (int c = 0; c < 3; ++c) result(offset.y + y + dy, offset.x + x + dx, c) = from(offset.y + y, offset.x + x, c);
+        }
+    }
+    return result;
+}
+
+image8u brighter(const image8u &frame, int delta) {
+    image8u result = frame;
+    for (int y = 0; y < result.height(); ++y) {
+        for (int x = 0; x < result.width(); ++x) {
+            for (int c = 0; c < 3; ++c) result(y, x, c) = static_cast<std::uint8_t>(std::min(255, result(y, x, c) + delta));
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(video_segmenter, incrementalEqualsPerFrameSegmentation) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle(4, 5, 17);
+    const std::uint8_t background = SyntheticPuzzleOptions().background;
+    const PuzzleSolver solver;
+    const image8u &first = puzzle.image;
+    const PuzzleSegmentation firstSegmentation = solver.segment(first);
+    const PuzzlePieces firstPieces = solver.extractPieces(first, firstSegmentation.mask, firstSegmentation.roi);
+    ASSERT_EQ(firstPieces.count(), 20);
+
+    const image8u removed = withoutPiece(first, firstPieces, 7, background);
+    const image8u moved = withPiece(removed, first, firstPieces, 7, 5, 3);
+    const image8u twoRemoved = withoutPiece(moved, firstPieces, 12, background);
+    struct Frame {
+        std::string name;
+        image8u image;
+        bool full;
+    };
+    const std::vector<Frame> frames = {
+        {"first", first, true},
+        {"removed", removed, false},
+        {"same", removed, false},
+        {"moved", moved, false},
+        {"twoRemoved", twoRemoved, false},
+        {"first again", first, false},
+        {"lighter", brighter(first, 40), true}, // the background threshold drifted
+    };
+
+    VideoSegmenter video(solver.options());
+    for (const Frame &frame: frames) {
+        SCOPED_TRACE(frame.name);
+        const VideoFrameStats stats = video.update(frame.image);
+        EXPECT_EQ(stats.full, frame.full);
+
+        const PuzzleSegmentation segmentation = solver.segment(frame.image);
+        const PuzzlePieces pieces = solver.extractPieces(frame.image, segmentation.mask, segmentation.roi);
+        EXPECT_DOUBLE_EQ(video.backgroundThreshold(), segmentation.backgroundThreshold);
+        EXPECT_TRUE(video.mask() == segmentation.mask);
+        expectSamePieces(video.pieces(), pieces);
+        expectSameDescriptors(video.descriptors(), solver.describeSides(pieces));
+        EXPECT_EQ(stats.pieces, pieces.count());
+
+        if (frame.full) {
+            EXPECT_EQ(stats.changedTiles, stats.tiles);
+            EXPECT_EQ(stats.updatedPieces, stats.pieces);
+        } else if (frame.name == "same") {
+            EXPECT_EQ(stats.changedTiles, 0);
+            EXPECT_EQ(stats.updatedPieces, 0);
+        } else {
+            EXPECT_GT(stats.changedTiles, 0);
+            EXPECT_LT(stats.changedTiles, stats.tiles);
+            EXPECT_GT(stats.updatedPieces, 0);
+            EXPECT_LT(stats.updatedPieces, stats.pieces); // the other pieces kept their crops and descriptors
+        }
+    }
+}
+
+TEST(video_segmenter, resetSegmentsFully) {
+    const SyntheticPuzzle puzzle = smallSyntheticPuzzle();
+    const PuzzleSolver solver;
+    VideoSegmenter video(solver.options());
+    EXPECT_TRUE(video.update(puzzle.image).full);
+    EXPECT_FALSE(video.update(puzzle.image).full);
+    video.reset();
+    const VideoFrameStats stats = video.update(puzzle.image);
+    EXPECT_TRUE(stats.full);
+    EXPECT_EQ(stats.pieces, 12);
+}
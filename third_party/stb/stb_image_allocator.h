@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// Allocation functions of stb_image (STBI_MALLOC, STBI_REALLOC, STBI_FREE) for decodes on the calling thread,
+// so that a decoder can get its output straight in the caller's storage. nullptr - malloc, realloc and free.
+struct StbImageAllocator {
+    void *(*malloc)(std::size_t size);
+    void *(*realloc)(void *ptr, std::size_t size);
+    void (*free)(void *ptr);
+};
+
+void stbi_set_thread_allocator(const StbImageAllocator *allocator);
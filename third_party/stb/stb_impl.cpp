@@ -1,5 +1,26 @@
 // This translation unit compiles stb once for the whole project.
 
+#include "stb_image_allocator.h"
+
+#include <cstdlib>
+
+namespace {
+
+thread_local const StbImageAllocator *threadAllocator = nullptr;
+
+void *stbiMalloc(std::size_t size) { return threadAllocator ? threadAllocator->malloc(size) : std::malloc(size); }
+void *stbiRealloc(void *ptr, std::size_t size) { return threadAllocator ? threadAllocator->realloc(ptr, size) : std::realloc(ptr, size); }
+void stbiFree(void *ptr) { threadAllocator ? threadAllocator->free(ptr) : std::free(ptr); }
+
+} // namespace
+
+void stbi_set_thread_allocator(const StbImageAllocator *allocator) {
+    threadAllocator = allocator;
+}
+
+#define STBI_MALLOC(sz) stbiMalloc(sz)
+#define STBI_REALLOC(p, newsz) stbiRealloc(p, newsz)
+#define STBI_FREE(p) stbiFree(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 